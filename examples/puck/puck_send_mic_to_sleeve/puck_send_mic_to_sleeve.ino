@@ -36,6 +36,12 @@ using namespace audio_tactile;
 
 int16_t g_analog_mic_data[kAdcDataSize];
 bool g_new_mic_data;
+// If true, mic audio is sent IMA-ADPCM compressed as kAdpcmAudioSamples
+// messages, 35-byte payloads instead of 128 bytes. This is lossy, and the
+// sleeve firmware must support kAdpcmAudioSamples. It doesn't yet save serial
+// bandwidth, since SerialCom always transfers full 132-byte buffers.
+constexpr bool kUseAdpcmAudio = false;
+ImaAdpcmState g_adpcm_state;
 constexpr uint32_t kLedPin = 19;
 
 static uint16_t g_sin_wave_downsample[64] = {};
@@ -75,6 +81,7 @@ void setup() {
   g_sin_wave_downsample[7] = 75;
 
   ChannelMapInit(&g_channel_map, 10);
+  ImaAdpcmInit(&g_adpcm_state);
 
   // SAADC sample rate in Hz.
   constexpr float kSaadcSampleRateHz = 15625.0f;
@@ -176,6 +183,10 @@ void LoopMicMode() {
   if (g_pending_message.type() != MessageType::kNone) {
     SerialCom.tx_message() = g_pending_message;
     g_pending_message.set_type(MessageType::kNone);
+  } else if (g_amps_enabled && kUseAdpcmAudio) {
+    SerialCom.tx_message().WriteAdpcmAudioSamples(
+        Slice<const int16_t, kAdcDataSize>(g_analog_mic_data),
+        &g_adpcm_state);
   } else if (g_amps_enabled) {
     SerialCom.tx_message().WriteAudioSamples(
         Slice<const int16_t, kAdcDataSize>(g_analog_mic_data));
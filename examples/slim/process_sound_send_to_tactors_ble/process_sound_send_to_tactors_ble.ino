@@ -52,6 +52,7 @@
 #include "analog_external_mic.h"
 #include "battery_monitor.h"
 #include "ble_com.h"
+#include "dsp/convert_sample.h"
 #include "dsp/datestamp.h"
 #include "dsp/serialize.h"
 #include "flash_settings.h"
@@ -60,6 +61,7 @@
 #include "post_processor_cpp.h"
 #include "pwm_sleeve.h"
 #include "tactile/envelope_tracker.h"
+#include "tactile/stage_profiler.h"
 #include "tactile/tactile_pattern.h"
 #include "tactile/tap_out.h"
 #include "tactile_processor_cpp.h"
@@ -132,6 +134,7 @@ struct {
   TapOutToken smoothed_energy;
   TapOutToken noise_energy;
   TapOutToken tactile_output;
+  TapOutToken stage_profile;
 } g_tokens;
 
 #if defined(kPdmSelectPin) && defined(kTactileSwitchPin)
@@ -401,6 +404,7 @@ void HandleMessage(const Message& message) {
 
 void SetupTapOut() {
   TapOutSetTxFun([](const char* data, int size) { Serial.write(data, size); });
+  TapOutSetTxAvailableFun([]() { return Serial.availableForWrite(); });
 
   static const TapOutDescriptor kMicInputDescriptor =
       {"mic_input", "int16", 1, {kAdcDataSize}};
@@ -422,6 +426,17 @@ void SetupTapOut() {
   static const TapOutDescriptor kTactileOutputDescriptor =
       {"tactile_output", "uint8", 2, {kNumPwmValues, 8}};
   g_tokens.tactile_output = TapOutAddDescriptor(&kTactileOutputDescriptor);
+
+#if STAGE_PROFILER_ENABLED
+  // Profile with the Cortex-M4 DWT cycle counter as the clock.
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  StageProfilerSetClockFun([]() -> uint32_t { return DWT->CYCCNT; });
+  StageProfilerReset();
+  g_tokens.stage_profile =
+      TapOutAddDescriptor(&kStageProfilerTapOutDescriptor);
+#endif
 }
 
 void CaptureTapOutData() {
@@ -472,6 +487,8 @@ void CaptureTapOutData() {
     }
   }
 
+  StageProfilerCaptureTapOut(g_tokens.stage_profile);
+
   TapOutFinishedCaptureBuffer();
 }
 
@@ -534,20 +551,21 @@ void loop() {
     Serial.readBytes(data, size);
     TapOutReceiveMessage(data, size);
   }
+  if (kTapOutEnabled) {
+    TapOutFlush();  // Send queued sequenced capture buffers, if any.
+  }
 
   if (g_new_mic_data) {
-    // Convert ADC values to floats. The raw ADC values can swing from -2048 to
-    // 2048, (12 bits) for analog mic and 32,768 for PDM mic (16 bits)
-    float scale = TuningGetInputGain(&g_settings.tuning);
+    // Convert ADC values to floats, applying the input gain in the same pass.
+    // The raw ADC values can swing from -2048 to 2048, (12 bits) for analog
+    // mic and 32,768 for PDM mic (16 bits), so the analog mic gets an extra
+    // factor of 32768 / 2048 = 16.
+    float gain = TuningGetInputGain(&g_settings.tuning);
     if (g_settings.input == InputSelection::kAnalogMic) {
-      scale /= 2048.0f;
-    } else {
-      scale /= 32768.0f;
-    }
-
-    for (int i = 0; i < kAdcDataSize; ++i) {
-      g_audio_input[i] = scale * g_mic_data[i];
+      gain *= 16.0f;
     }
+    ConvertSampleArrayInt16ToFloatWithGain(g_mic_data, kAdcDataSize, gain,
+                                           g_audio_input);
 
     // Track the envelope of the input audio.
     if (EnvelopeTrackerProcessSamples(&g_envelope_tracker, g_audio_input,
@@ -0,0 +1,158 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of sustained WAV output while processing.
+//
+// Each iteration runs TactileProcessor on 10 s of 16 kHz noise in blocks of 64
+// samples and writes the tactile output to a WAV file as it is produced, the
+// way the tools dump tactile signals. Outputs beyond the 10 tactors are filled
+// by repeating tactors, to emulate higher channel counts. Write methods:
+//
+//   kNone:       No output, the processing-only baseline.
+//   kSyncPcm16:  Convert float -> int16, then WriteWavSamples() per block.
+//   kSyncFloat:  WriteWavSamplesFloat() per block.
+//   kAsyncFloat: AsyncWavWriterWrite() per block, with 4 buffers of 4096
+//                frames written by a background thread.
+//
+// The realtime_factor counter is seconds of audio processed per second of wall
+// time. Wall time is used since the I/O thread's CPU time isn't counted.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "src/dsp/write_wav_file.h"
+#include "src/tactile/tactile_processor.h"
+#include "extras/tools/async_wav_writer.h"
+#include "benchmark/benchmark.h"
+
+namespace {
+
+constexpr int kSampleRateHz = 16000;
+constexpr int kBlockSize = 64;
+constexpr int kNumBlocks = 10 * kSampleRateHz / kBlockSize;
+
+enum WriteMethod { kNone, kSyncPcm16, kSyncFloat, kAsyncFloat };
+
+}  // namespace
+
+// Args are {write method, number of output channels}.
+static void BM_ProcessAndWrite(benchmark::State& state) {
+  const WriteMethod method = static_cast<WriteMethod>(state.range(0));
+  const int num_channels = state.range(1);
+
+  TactileProcessorParams params;
+  TactileProcessorSetDefaultParams(&params);
+  params.frontend_params.input_sample_rate_hz = kSampleRateHz;
+  params.frontend_params.block_size = kBlockSize;
+  TactileProcessor* processor = TactileProcessorMake(&params);
+  if (processor == nullptr) {
+    state.SkipWithError("TactileProcessorMake failed");
+    return;
+  }
+
+  std::mt19937 rng(0);
+  std::normal_distribution<float> dist(0.0f, 0.1f);
+  std::vector<float> input(kNumBlocks * kBlockSize);
+  for (float& sample : input) {
+    sample = dist(rng);
+  }
+  std::vector<float> tactile(kTactileProcessorNumTactors * kBlockSize);
+  std::vector<float> output(num_channels * kBlockSize);
+  std::vector<int16_t> output_int16(output.size());
+
+  const char* filename = std::tmpnam(nullptr);
+  FILE* f = nullptr;
+  AsyncWavWriter* writer = nullptr;
+  if (method == kSyncPcm16 || method == kSyncFloat) {
+    f = std::fopen(filename, "wb");
+    if (f == nullptr) {
+      state.SkipWithError("Failed to open output");
+      return;
+    }
+    if (method == kSyncPcm16) {
+      WriteWavHeader(f, 0, kSampleRateHz, num_channels);
+    } else {
+      WriteWavHeaderFloat(f, 0, kSampleRateHz, num_channels);
+    }
+  } else if (method == kAsyncFloat) {
+    writer = AsyncWavWriterOpen(filename, kSampleRateHz, num_channels, 4096, 4);
+    if (writer == nullptr) {
+      state.SkipWithError("AsyncWavWriterOpen failed");
+      return;
+    }
+  }
+
+  for (auto _ : state) {
+    for (int b = 0; b < kNumBlocks; ++b) {
+      TactileProcessorProcessSamples(
+          processor, input.data() + b * kBlockSize, tactile.data());
+      for (int i = 0; i < kBlockSize; ++i) {
+        for (int c = 0; c < num_channels; ++c) {
+          output[i * num_channels + c] =
+              tactile[i * kTactileProcessorNumTactors +
+                      c % kTactileProcessorNumTactors];
+        }
+      }
+
+      switch (method) {
+        case kNone:
+          benchmark::DoNotOptimize(output.data());
+          break;
+        case kSyncPcm16:
+          for (size_t i = 0; i < output.size(); ++i) {
+            float value = 32767.0f * output[i];
+            value = (value > 32767.0f) ? 32767.0f : value;
+            value = (value < -32768.0f) ? -32768.0f : value;
+            output_int16[i] = static_cast<int16_t>(value);
+          }
+          WriteWavSamples(f, output_int16.data(), output_int16.size());
+          break;
+        case kSyncFloat:
+          WriteWavSamplesFloat(f, output.data(), output.size());
+          break;
+        case kAsyncFloat:
+          AsyncWavWriterWrite(writer, output.data(), kBlockSize);
+          break;
+      }
+    }
+  }
+
+  const double audio_seconds = static_cast<double>(kNumBlocks) * kBlockSize /
+                               kSampleRateHz;
+  state.counters["realtime_factor"] = benchmark::Counter(
+      state.iterations() * audio_seconds, benchmark::Counter::kIsRate);
+  state.SetBytesProcessed(state.iterations() * kNumBlocks * output.size() *
+                          (method == kSyncPcm16 ? 2 : 4));
+  if (writer != nullptr) {
+    state.counters["stalls"] = AsyncWavWriterNumStalls(writer);
+    AsyncWavWriterClose(writer);
+  }
+  if (f != nullptr) { std::fclose(f); }
+  std::remove(filename);
+  TactileProcessorFree(processor);
+}
+BENCHMARK(BM_ProcessAndWrite)
+    ->ArgsProduct({{kNone, kSyncPcm16, kSyncFloat, kAsyncFloat}, {10, 24}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,79 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of ClassifyPhoneme vs. ClassifyPhonemeBatch.
+//
+// Both benchmarks classify the same 1000 sliding windows (8 s of audio at the
+// classifier's 8 ms frame hop). The per-window version re-streams all weights
+// for every window, while the batched version runs each layer as a blocked
+// matrix-matrix product.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <random>
+#include <vector>
+
+#include "src/phonetics/classify_phoneme.h"
+#include "benchmark/benchmark.h"
+
+static constexpr int kNumOutputs = 1000;
+
+namespace {
+std::vector<float> RandomFrames() {
+  std::vector<float> frames(
+      (kNumOutputs + kClassifyPhonemeNumFrames - 1) *
+      kClassifyPhonemeNumChannels);
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  for (float& value : frames) {
+    value = dist(rng);
+  }
+  return frames;
+}
+}  // namespace
+
+static void BM_ClassifyPhoneme(benchmark::State& state) {
+  std::vector<float> frames = RandomFrames();
+  std::vector<ClassifyPhonemeLabels> labels(kNumOutputs);
+  std::vector<ClassifyPhonemeScores> scores(kNumOutputs);
+
+  for (auto _ : state) {
+    for (int t = 0; t < kNumOutputs; ++t) {
+      ClassifyPhoneme(frames.data() + t * kClassifyPhonemeNumChannels,
+                      &labels[t], &scores[t]);
+    }
+    benchmark::DoNotOptimize(scores.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumOutputs);
+}
+BENCHMARK(BM_ClassifyPhoneme);
+
+static void BM_ClassifyPhonemeBatch(benchmark::State& state) {
+  std::vector<float> frames = RandomFrames();
+  std::vector<ClassifyPhonemeLabels> labels(kNumOutputs);
+  std::vector<ClassifyPhonemeScores> scores(kNumOutputs);
+
+  for (auto _ : state) {
+    ClassifyPhonemeBatch(frames.data(), kNumOutputs,
+                         labels.data(), scores.data());
+    benchmark::DoNotOptimize(scores.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumOutputs);
+}
+BENCHMARK(BM_ClassifyPhonemeBatch);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,325 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of convert_sample array functions.
+//
+// This benchmark measures the time to convert a buffer of 1024 samples with the
+// ConvertSampleArray* functions, compared to loops calling the single-sample
+// functions (or for 24-bit and mu-law, assembling bytes and evaluating the
+// G.711 formula per sample). The *_Scalar benchmarks are the baselines.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <stdint.h>
+
+#include <random>
+#include <vector>
+
+#include "src/dsp/convert_sample.h"
+#include "benchmark/benchmark.h"
+
+static constexpr int kNumSamples = 1024;
+
+namespace {
+
+std::vector<int16_t> Int16TestValues() {
+  std::vector<int16_t> values(kNumSamples);
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> dist(INT16_MIN, INT16_MAX);
+  for (int16_t& value : values) {
+    value = static_cast<int16_t>(dist(rng));
+  }
+  return values;
+}
+
+std::vector<int32_t> Int32TestValues() {
+  std::vector<int32_t> values(kNumSamples);
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int32_t> dist(INT32_MIN, INT32_MAX);
+  for (int32_t& value : values) {
+    value = dist(rng);
+  }
+  return values;
+}
+
+std::vector<float> FloatTestValues() {
+  std::vector<float> values(kNumSamples);
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(-1.2f, 1.2f);
+  for (float& value : values) {
+    value = dist(rng);
+  }
+  return values;
+}
+
+std::vector<uint8_t> ByteTestValues(int num_bytes) {
+  std::vector<uint8_t> values(num_bytes);
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> dist(0, 255);
+  for (uint8_t& value : values) {
+    value = static_cast<uint8_t>(dist(rng));
+  }
+  return values;
+}
+
+int16_t MulawFormula(uint8_t code) {
+  const int inverted = ~code & 0xff;
+  const int exponent = (inverted >> 4) & 7;
+  const int magnitude = (((inverted & 0xf) << 3) + 0x84) << exponent;
+  return static_cast<int16_t>((inverted & 0x80) ? 0x84 - magnitude
+                                                : magnitude - 0x84);
+}
+
+}  // namespace
+
+// int16 -> float. _____________________________________________________________
+
+static void BM_Int16ToFloat_Scalar(benchmark::State& state) {
+  std::vector<int16_t> in = Int16TestValues();
+  std::vector<float> out(kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    for (int i = 0; i < kNumSamples; ++i) {
+      out[i] = ConvertSampleInt16ToFloat(in[i]);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_Int16ToFloat_Scalar);
+
+static void BM_Int16ToFloat(benchmark::State& state) {
+  std::vector<int16_t> in = Int16TestValues();
+  std::vector<float> out(kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    ConvertSampleArrayInt16ToFloat(in.data(), kNumSamples, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_Int16ToFloat);
+
+// Conversion followed by applying an input gain in a second pass, as done
+// previously on the devices.
+static void BM_Int16ToFloatThenGain_Scalar(benchmark::State& state) {
+  std::vector<int16_t> in = Int16TestValues();
+  std::vector<float> out(kNumSamples);
+  const float gain = 0.175f;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    for (int i = 0; i < kNumSamples; ++i) {
+      out[i] = ConvertSampleInt16ToFloat(in[i]);
+    }
+    benchmark::DoNotOptimize(out.data());
+    for (int i = 0; i < kNumSamples; ++i) {
+      out[i] *= gain;
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_Int16ToFloatThenGain_Scalar);
+
+static void BM_Int16ToFloatWithGain(benchmark::State& state) {
+  std::vector<int16_t> in = Int16TestValues();
+  std::vector<float> out(kNumSamples);
+  const float gain = 0.175f;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    ConvertSampleArrayInt16ToFloatWithGain(
+        in.data(), kNumSamples, gain, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_Int16ToFloatWithGain);
+
+// int32 -> float. _____________________________________________________________
+
+static void BM_Int32ToFloat_Scalar(benchmark::State& state) {
+  std::vector<int32_t> in = Int32TestValues();
+  std::vector<float> out(kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    for (int i = 0; i < kNumSamples; ++i) {
+      out[i] = ConvertSampleInt32ToFloat(in[i]);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_Int32ToFloat_Scalar);
+
+static void BM_Int32ToFloat(benchmark::State& state) {
+  std::vector<int32_t> in = Int32TestValues();
+  std::vector<float> out(kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    ConvertSampleArrayInt32ToFloat(in.data(), kNumSamples, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_Int32ToFloat);
+
+// float -> int16. _____________________________________________________________
+
+static void BM_FloatToInt16_Scalar(benchmark::State& state) {
+  std::vector<float> in = FloatTestValues();
+  std::vector<int16_t> out(kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    for (int i = 0; i < kNumSamples; ++i) {
+      out[i] = ConvertSampleFloatToInt16(in[i]);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_FloatToInt16_Scalar);
+
+static void BM_FloatToInt16(benchmark::State& state) {
+  std::vector<float> in = FloatTestValues();
+  std::vector<int16_t> out(kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    ConvertSampleArrayFloatToInt16(in.data(), kNumSamples, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_FloatToInt16);
+
+// float -> int32. _____________________________________________________________
+
+static void BM_FloatToInt32_Scalar(benchmark::State& state) {
+  std::vector<float> in = FloatTestValues();
+  std::vector<int32_t> out(kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    for (int i = 0; i < kNumSamples; ++i) {
+      out[i] = ConvertSampleFloatToInt32(in[i]);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_FloatToInt32_Scalar);
+
+static void BM_FloatToInt32(benchmark::State& state) {
+  std::vector<float> in = FloatTestValues();
+  std::vector<int32_t> out(kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    ConvertSampleArrayFloatToInt32(in.data(), kNumSamples, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_FloatToInt32);
+
+// Packed 24-bit <-> int32. ____________________________________________________
+
+static void BM_Packed24ToInt32_Scalar(benchmark::State& state) {
+  std::vector<uint8_t> in = ByteTestValues(3 * kNumSamples);
+  std::vector<int32_t> out(kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    const uint8_t* src = in.data();
+    for (int i = 0; i < kNumSamples; ++i, src += 3) {
+      out[i] = static_cast<int32_t>((static_cast<uint32_t>(src[0]) << 8) |
+                                    (static_cast<uint32_t>(src[1]) << 16) |
+                                    (static_cast<uint32_t>(src[2]) << 24));
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_Packed24ToInt32_Scalar);
+
+static void BM_Packed24ToInt32(benchmark::State& state) {
+  std::vector<uint8_t> in = ByteTestValues(3 * kNumSamples);
+  std::vector<int32_t> out(kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    ConvertSampleArrayPacked24ToInt32(in.data(), kNumSamples, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_Packed24ToInt32);
+
+static void BM_Int32ToPacked24_Scalar(benchmark::State& state) {
+  std::vector<int32_t> in = Int32TestValues();
+  std::vector<uint8_t> out(3 * kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    uint8_t* dest = out.data();
+    for (int i = 0; i < kNumSamples; ++i, dest += 3) {
+      const uint32_t value = static_cast<uint32_t>(in[i]);
+      dest[0] = static_cast<uint8_t>(value >> 8);
+      dest[1] = static_cast<uint8_t>(value >> 16);
+      dest[2] = static_cast<uint8_t>(value >> 24);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_Int32ToPacked24_Scalar);
+
+static void BM_Int32ToPacked24(benchmark::State& state) {
+  std::vector<int32_t> in = Int32TestValues();
+  std::vector<uint8_t> out(3 * kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    ConvertSampleArrayInt32ToPacked24(in.data(), kNumSamples, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_Int32ToPacked24);
+
+// Mu-law -> int16. ____________________________________________________________
+
+static void BM_MulawToInt16_Formula(benchmark::State& state) {
+  std::vector<uint8_t> in = ByteTestValues(kNumSamples);
+  std::vector<int16_t> out(kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    for (int i = 0; i < kNumSamples; ++i) {
+      out[i] = MulawFormula(in[i]);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_MulawToInt16_Formula);
+
+static void BM_MulawToInt16(benchmark::State& state) {
+  std::vector<uint8_t> in = ByteTestValues(kNumSamples);
+  std::vector<int16_t> out(kNumSamples);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(in.data());
+    ConvertSampleArrayMulawToInt16(in.data(), kNumSamples, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+}
+BENCHMARK(BM_MulawToInt16);
+
+BENCHMARK_MAIN();
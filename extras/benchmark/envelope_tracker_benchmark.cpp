@@ -0,0 +1,97 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of decoding EnvelopeTracker records, as in server-side ingestion
+// of kStatsRecord messages.
+//
+// BM_DecodeRecord: EnvelopeTrackerDecodeRecord, one record at a time.
+// BM_DecodeRecords: EnvelopeTrackerDecodeRecords, bulk decoding to columns.
+//
+// The arg is the number of records per call to BM_DecodeRecords, or the
+// number decoded in a loop for BM_DecodeRecord. items_per_second is records
+// decoded per second.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <random>
+#include <vector>
+
+#include "src/tactile/envelope_tracker.h"
+#include "benchmark/benchmark.h"
+
+namespace {
+
+// Makes `num_records` records by running the tracker on noise.
+std::vector<uint8_t> MakeRecords(int num_records) {
+  constexpr float kSampleRateHz = 16000.0f;
+  constexpr int kBlockSize = 64;
+  std::vector<uint8_t> records(num_records * kEnvelopeTrackerRecordBytes);
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+  EnvelopeTracker tracker;
+  EnvelopeTrackerInit(&tracker, kSampleRateHz);
+  float input[kBlockSize];
+
+  for (int r = 0; r < num_records;) {
+    const float amplitude = 0.1f + 0.9f * ((r / 3) % 2);
+    for (float& sample : input) { sample = amplitude * dist(rng); }
+    if (EnvelopeTrackerProcessSamples(&tracker, input, kBlockSize)) {
+      EnvelopeTrackerGetRecord(&tracker,
+                               &records[r * kEnvelopeTrackerRecordBytes]);
+      ++r;
+    }
+  }
+  return records;
+}
+
+}  // namespace
+
+static void BM_DecodeRecord(benchmark::State& state) {
+  const int num_records = state.range(0);
+  const std::vector<uint8_t> records = MakeRecords(num_records);
+  std::vector<float> decoded(num_records * kEnvelopeTrackerRecordPoints);
+
+  for (auto _ : state) {
+    for (int r = 0; r < num_records; ++r) {
+      EnvelopeTrackerDecodeRecord(&records[r * kEnvelopeTrackerRecordBytes],
+                                  &decoded[r * kEnvelopeTrackerRecordPoints]);
+    }
+    benchmark::DoNotOptimize(decoded.data());
+  }
+  state.SetItemsProcessed(state.iterations() * num_records);
+}
+BENCHMARK(BM_DecodeRecord)->Arg(1)->Arg(1024);
+
+static void BM_DecodeRecords(benchmark::State& state) {
+  const int num_records = state.range(0);
+  const std::vector<uint8_t> records = MakeRecords(num_records);
+  // Pad the stride, so that columns don't alias in the cache.
+  const int stride = num_records + 16;
+  std::vector<float> columns(stride * kEnvelopeTrackerRecordPoints);
+  EnvelopeTrackerDecoder decoder;
+  EnvelopeTrackerDecoderInit(&decoder);
+
+  for (auto _ : state) {
+    EnvelopeTrackerDecodeRecords(&decoder, records.data(), num_records,
+                                 stride, columns.data());
+    benchmark::DoNotOptimize(columns.data());
+  }
+  state.SetItemsProcessed(state.iterations() * num_records);
+}
+BENCHMARK(BM_DecodeRecords)->Arg(1)->Arg(16)->Arg(1024)->Arg(65536);
+
+BENCHMARK_MAIN();
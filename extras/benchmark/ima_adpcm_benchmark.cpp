@@ -0,0 +1,119 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of IMA-ADPCM encoding and decoding.
+//
+// Audio is coded in blocks of the size given by the arg. The input is 1 second
+// of synthetic speech-like audio at 16 kHz. Time is reported per block, and
+// items_per_second counts samples.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <math.h>
+
+#include <random>
+#include <vector>
+
+#include "src/cpp/ima_adpcm.h"
+#include "benchmark/benchmark.h"
+
+using ::audio_tactile::ImaAdpcmBlockSize;
+using ::audio_tactile::ImaAdpcmDecodeBlock;
+using ::audio_tactile::ImaAdpcmEncodeBlock;
+using ::audio_tactile::ImaAdpcmInit;
+using ::audio_tactile::ImaAdpcmState;
+using ::audio_tactile::Slice;
+
+namespace {
+
+constexpr int kNumSamples = 16000;
+
+// Generates a sum of harmonics with a syllable-rate envelope plus noise.
+std::vector<int16_t> MakeAudio() {
+  std::vector<int16_t> audio(kNumSamples);
+  std::mt19937 rng(0);
+  std::normal_distribution<float> noise_dist(0.0f, 200.0f);
+  for (int i = 0; i < kNumSamples; ++i) {
+    const float t = i / 16000.0f;
+    const float envelope = 0.5f + 0.5f * sin(6.2831853f * 4.0f * t);
+    float value = 0.0f;
+    for (int h = 1; h <= 8; ++h) {
+      value += sin(6.2831853f * 120.0f * h * t) / h;
+    }
+    audio[i] = static_cast<int16_t>(5000.0f * envelope * value +
+                                    noise_dist(rng));
+  }
+  return audio;
+}
+
+}  // namespace
+
+static void BM_ImaAdpcmEncode(benchmark::State& state) {
+  const int block_size = state.range(0);
+  const int num_blocks = kNumSamples / block_size;
+  const std::vector<int16_t> audio = MakeAudio();
+  std::vector<uint8_t> block(ImaAdpcmBlockSize(block_size));
+  ImaAdpcmState adpcm_state;
+  ImaAdpcmInit(&adpcm_state);
+
+  for (auto _ : state) {
+    for (int b = 0; b < num_blocks; ++b) {
+      ImaAdpcmEncodeBlock(
+          Slice<const int16_t>(audio.data() + b * block_size, block_size),
+          &adpcm_state, block.data());
+      benchmark::DoNotOptimize(block.data());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * num_blocks * block_size);
+  state.counters["ns_per_block"] = benchmark::Counter(
+      state.iterations() * num_blocks,
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_ImaAdpcmEncode)->Arg(64)->Arg(250);
+
+static void BM_ImaAdpcmDecode(benchmark::State& state) {
+  const int block_size = state.range(0);
+  const int num_blocks = kNumSamples / block_size;
+  const int block_bytes = ImaAdpcmBlockSize(block_size);
+  const std::vector<int16_t> audio = MakeAudio();
+  std::vector<uint8_t> encoded(num_blocks * block_bytes);
+  ImaAdpcmState adpcm_state;
+  ImaAdpcmInit(&adpcm_state);
+  for (int b = 0; b < num_blocks; ++b) {
+    ImaAdpcmEncodeBlock(
+        Slice<const int16_t>(audio.data() + b * block_size, block_size),
+        &adpcm_state, encoded.data() + b * block_bytes);
+  }
+  std::vector<int16_t> decoded(block_size);
+
+  for (auto _ : state) {
+    for (int b = 0; b < num_blocks; ++b) {
+      benchmark::DoNotOptimize(ImaAdpcmDecodeBlock(
+          Slice<const uint8_t>(encoded.data() + b * block_bytes, block_bytes),
+          Slice<int16_t>(decoded.data(), block_size)));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * num_blocks * block_size);
+  state.counters["ns_per_block"] = benchmark::Counter(
+      state.iterations() * num_blocks,
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_ImaAdpcmDecode)->Arg(64)->Arg(250);
+
+BENCHMARK_MAIN();
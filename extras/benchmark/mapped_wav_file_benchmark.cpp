@@ -0,0 +1,256 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of MappedWavFile vs. ReadWavFile on a large WAV file.
+//
+// A stereo WAV file of 16- or 24-bit PCM is generated in a temporary directory,
+// 1 GB by default, or set the size with env var MAPPED_WAV_BENCHMARK_MB. Each
+// benchmark iteration reads the whole file and sums the samples:
+//
+//   BM_ReadWavFile:          ReadWavFile() into memory, then sum.
+//   BM_MappedWavFileDirect:  Sum 16-bit samples in place from the mapping.
+//   BM_MappedWavFileBlocks:  Convert with MappedWavFileReadFloat() in blocks
+//                            of 4096 frames into a fixed buffer, then sum.
+//
+// Counters:
+//   anon_mb:  Growth in anonymous (heap) resident memory in MB while reading,
+//             i.e. memory that can't be reclaimed. ReadWavFile needs 4 bytes
+//             per sample, while mapped reading needs only the block buffer.
+//   file_mb:  Growth in file-backed resident memory in MB, i.e. mapped pages of
+//             the file. These are clean page cache pages that the OS may evict
+//             under memory pressure.
+// Memory is sampled from /proc/self/status, so counters are 0 on non-Linux.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "src/dsp/read_wav_file.h"
+#include "src/dsp/write_wav_file.h"
+#include "extras/tools/mapped_wav_file.h"
+#include "benchmark/benchmark.h"
+
+namespace {
+
+constexpr int kSampleRateHz = 48000;
+constexpr int kNumChannels = 2;
+constexpr size_t kBlockFrames = 4096;
+
+// Reads a field like "RssAnon:" from /proc/self/status in MB, or 0 if it fails.
+double ReadProcStatusMb(const char* field) {
+  FILE* f = std::fopen("/proc/self/status", "r");
+  if (f == nullptr) { return 0.0; }
+  char line[256];
+  double value_mb = 0.0;
+  const size_t field_length = std::strlen(field);
+  while (std::fgets(line, sizeof(line), f)) {
+    if (std::strncmp(line, field, field_length) == 0) {
+      value_mb = std::atof(line + field_length) / 1024.0;  // Value is in kB.
+      break;
+    }
+  }
+  std::fclose(f);
+  return value_mb;
+}
+
+// Generates a test WAV file of the requested bit depth, 16 or 24, once per
+// process. The file is deleted at exit.
+std::vector<std::string> generated_files;
+
+void DeleteGeneratedFiles() {
+  for (const std::string& filename : generated_files) {
+    std::remove(filename.c_str());
+  }
+}
+
+const char* GetWavFile(int bit_depth) {
+  static std::string filenames[2];
+  std::string& filename = filenames[bit_depth == 24];
+  if (!filename.empty()) { return filename.c_str(); }
+
+  size_t size_mb = 1024;
+  if (const char* env = std::getenv("MAPPED_WAV_BENCHMARK_MB")) {
+    size_mb = std::atoi(env);
+  }
+  const size_t num_frames =
+      (size_mb << 20) / (kNumChannels * (bit_depth / 8));
+
+  filename = std::tmpnam(nullptr);
+  if (generated_files.empty()) { std::atexit(DeleteGeneratedFiles); }
+  generated_files.push_back(filename);
+  FILE* f = std::fopen(filename.c_str(), "wb");
+  if (f == nullptr) { return nullptr; }
+  const size_t num_samples = num_frames * kNumChannels;
+  int ok = (bit_depth == 24)
+      ? WriteWavHeader24Bit(f, num_samples, kSampleRateHz, kNumChannels)
+      : WriteWavHeader(f, num_samples, kSampleRateHz, kNumChannels);
+
+  // Write a sawtooth in chunks.
+  std::vector<int32_t> chunk(kBlockFrames * kNumChannels);
+  std::vector<int16_t> chunk16(chunk.size());
+  for (size_t start = 0; ok && start < num_samples; start += chunk.size()) {
+    const size_t n = std::min(chunk.size(), num_samples - start);
+    for (size_t i = 0; i < n; ++i) {
+      chunk[i] = static_cast<int32_t>(static_cast<uint32_t>(start + i) << 12);
+      chunk16[i] = static_cast<int16_t>(chunk[i] >> 16);
+    }
+    ok = (bit_depth == 24) ? WriteWavSamples24Bit(f, chunk.data(), n)
+                           : WriteWavSamples(f, chunk16.data(), n);
+  }
+  if (std::fclose(f) != 0 || !ok) { return nullptr; }
+  return filename.c_str();
+}
+
+// Tracks growth in resident memory relative to the start of an iteration.
+struct MemoryTracker {
+  MemoryTracker()
+      : anon_start(ReadProcStatusMb("RssAnon:")),
+        file_start(ReadProcStatusMb("RssFile:")) {}
+
+  void Sample() {
+    anon_mb = std::max(anon_mb, ReadProcStatusMb("RssAnon:") - anon_start);
+    file_mb = std::max(file_mb, ReadProcStatusMb("RssFile:") - file_start);
+  }
+
+  double anon_start;
+  double file_start;
+  double anon_mb = 0.0;
+  double file_mb = 0.0;
+};
+
+void SetCounters(benchmark::State& state, const MemoryTracker& memory) {
+  state.counters["anon_mb"] = memory.anon_mb;
+  state.counters["file_mb"] = memory.file_mb;
+}
+
+}  // namespace
+
+// Arg is the bit depth.
+static void BM_ReadWavFile(benchmark::State& state) {
+  const int bit_depth = state.range(0);
+  const char* filename = GetWavFile(bit_depth);
+  if (filename == nullptr) {
+    state.SkipWithError("Failed to write WAV file");
+    return;
+  }
+
+  MemoryTracker memory;
+  size_t num_samples = 0;
+  for (auto _ : state) {
+    int num_channels;
+    int sample_rate_hz;
+    int32_t* samples = ReadWavFile(filename, &num_samples, &num_channels,
+                                   &sample_rate_hz);
+    if (samples == nullptr) {
+      state.SkipWithError("ReadWavFile failed");
+      return;
+    }
+    int64_t sum = 0;
+    for (size_t i = 0; i < num_samples; ++i) {
+      sum += samples[i];
+    }
+    benchmark::DoNotOptimize(sum);
+    memory.Sample();
+    std::free(samples);
+  }
+  state.SetItemsProcessed(state.iterations() * num_samples);
+  state.SetBytesProcessed(state.iterations() * num_samples * (bit_depth / 8));
+  SetCounters(state, memory);
+}
+BENCHMARK(BM_ReadWavFile)->Arg(16)->Arg(24)->Unit(benchmark::kMillisecond);
+
+static void BM_MappedWavFileDirect(benchmark::State& state) {
+  const char* filename = GetWavFile(16);
+  if (filename == nullptr) {
+    state.SkipWithError("Failed to write WAV file");
+    return;
+  }
+
+  MemoryTracker memory;
+  size_t num_samples = 0;
+  for (auto _ : state) {
+    MappedWavFile* wav = MappedWavFileOpen(filename);
+    const int16_t* samples =
+        (wav != nullptr) ? MappedWavFileInt16Samples(wav) : nullptr;
+    if (samples == nullptr) {
+      state.SkipWithError("MappedWavFileOpen failed");
+      MappedWavFileClose(wav);
+      return;
+    }
+    num_samples = wav->num_frames * wav->num_channels;
+    int64_t sum = 0;
+    for (size_t i = 0; i < num_samples; ++i) {
+      sum += samples[i];
+    }
+    benchmark::DoNotOptimize(sum);
+    memory.Sample();
+    MappedWavFileClose(wav);
+  }
+  state.SetItemsProcessed(state.iterations() * num_samples);
+  state.SetBytesProcessed(state.iterations() * num_samples * 2);
+  SetCounters(state, memory);
+}
+BENCHMARK(BM_MappedWavFileDirect)->Unit(benchmark::kMillisecond);
+
+// Arg is the bit depth.
+static void BM_MappedWavFileBlocks(benchmark::State& state) {
+  const int bit_depth = state.range(0);
+  const char* filename = GetWavFile(bit_depth);
+  if (filename == nullptr) {
+    state.SkipWithError("Failed to write WAV file");
+    return;
+  }
+
+  MemoryTracker memory;
+  std::vector<float> buffer(kBlockFrames * kNumChannels);
+  size_t num_samples = 0;
+  for (auto _ : state) {
+    MappedWavFile* wav = MappedWavFileOpen(filename);
+    if (wav == nullptr) {
+      state.SkipWithError("MappedWavFileOpen failed");
+      return;
+    }
+    num_samples = wav->num_frames * wav->num_channels;
+    double sum = 0.0;
+    for (size_t start = 0; start < wav->num_frames; start += kBlockFrames) {
+      const size_t n = MappedWavFileReadFloat(wav, start, kBlockFrames,
+                                              buffer.data()) * kNumChannels;
+      for (size_t i = 0; i < n; ++i) {
+        sum += buffer[i];
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+    memory.Sample();
+    MappedWavFileClose(wav);
+  }
+  state.SetItemsProcessed(state.iterations() * num_samples);
+  state.SetBytesProcessed(state.iterations() * num_samples * (bit_depth / 8));
+  SetCounters(state, memory);
+}
+BENCHMARK(BM_MappedWavFileBlocks)
+    ->Arg(16)
+    ->Arg(24)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,146 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of MessageFramer throughput.
+//
+// The input is a synthetic noisy stream of about 4 MB for each framer mode,
+// generated once. It has frames with random payload sizes. About 1 in 20 frames
+// has a corrupted byte, and about 1 in 10 frames is followed by a burst of
+// random garbage bytes. The first arg is the mode, 0 = kSerial or 1 = kBle.
+// The stream is pushed in chunks of the size given by the second arg, e.g. 20
+// bytes as from BLE notifications or 4096 bytes as from reading a file.
+// Throughput is reported in bytes_per_second.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "src/cpp/message_framer.h"
+#include "src/dsp/serialize.h"
+#include "benchmark/benchmark.h"
+
+using ::audio_tactile::Message;
+using ::audio_tactile::MessageFramer;
+using ::audio_tactile::MessageRecipient;
+using ::audio_tactile::MessageType;
+using ::audio_tactile::Slice;
+
+namespace {
+
+constexpr int kStreamSize = 4 << 20;
+
+// Generates a synthetic noisy stream of frames in `mode`.
+std::vector<uint8_t>* MakeNoisyStream(MessageFramer::Mode mode) {
+  auto* stream = new std::vector<uint8_t>;
+  stream->reserve(kStreamSize + MessageFramer::kMaxFrameSize);
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> byte_dist(0, 255);
+  std::uniform_int_distribution<int> size_dist(0, Message::kMaxPayloadSize);
+  std::uniform_int_distribution<int> event_dist(0, 99);
+  uint8_t payload[Message::kMaxPayloadSize];
+  uint8_t frame[MessageFramer::kMaxFrameSize];
+
+  while (static_cast<int>(stream->size()) < kStreamSize) {
+    const int payload_size = size_dist(rng);
+    for (int i = 0; i < payload_size; ++i) {
+      payload[i] = static_cast<uint8_t>(byte_dist(rng));
+    }
+    Message message;
+    message.set_type(MessageType::kAllTactorsSamples);
+    message.set_payload(Slice<const uint8_t>(payload, payload_size));
+    const int frame_size =
+        (mode == MessageFramer::Mode::kSerial)
+            ? MessageFramer::WriteSerialFrame(MessageRecipient::kSleeve,
+                                              &message, frame)
+            : MessageFramer::WriteBleFrame(&message, frame);
+    if (event_dist(rng) < 5) {  // Corrupt a byte.
+      frame[byte_dist(rng) % frame_size] ^= 0x10;
+    }
+    stream->insert(stream->end(), frame, frame + frame_size);
+
+    if (event_dist(rng) < 10) {  // Insert garbage.
+      const int num_garbage = 1 + byte_dist(rng) % 32;
+      for (int i = 0; i < num_garbage; ++i) {
+        stream->push_back(static_cast<uint8_t>(byte_dist(rng)));
+      }
+    }
+  }
+  return stream;
+}
+
+// Returns the synthetic noisy stream for `mode`.
+const std::vector<uint8_t>& NoisyStream(MessageFramer::Mode mode) {
+  static const std::vector<uint8_t>* serial_stream =
+      MakeNoisyStream(MessageFramer::Mode::kSerial);
+  static const std::vector<uint8_t>* ble_stream =
+      MakeNoisyStream(MessageFramer::Mode::kBle);
+  return (mode == MessageFramer::Mode::kSerial) ? *serial_stream : *ble_stream;
+}
+
+void ModeAndChunkSizeArgs(benchmark::internal::Benchmark* b) {
+  for (int mode : {0, 1}) {
+    for (int chunk_size : {1, 20, 256, 4096, 65536}) {
+      b->Args({mode, chunk_size});
+    }
+  }
+}
+
+}  // namespace
+
+static void BM_MessageFramer(benchmark::State& state) {
+  const MessageFramer::Mode mode = (state.range(0) == 0)
+                                       ? MessageFramer::Mode::kSerial
+                                       : MessageFramer::Mode::kBle;
+  const int chunk_size = state.range(1);
+  const std::vector<uint8_t>& stream = NoisyStream(mode);
+  const int stream_size = static_cast<int>(stream.size());
+  MessageFramer framer(mode);
+
+  for (auto _ : state) {
+    framer.Reset();
+    for (int start = 0; start < stream_size; start += chunk_size) {
+      framer.Push(stream.data() + start,
+                  std::min(chunk_size, stream_size - start));
+      const Message* message;
+      while ((message = framer.Next()) != nullptr) {
+        benchmark::DoNotOptimize(message);
+      }
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * stream_size);
+  state.counters["messages"] = framer.stats().messages;
+  state.counters["bad_frames"] = framer.stats().bad_frames;
+}
+BENCHMARK(BM_MessageFramer)
+    ->Apply(ModeAndChunkSizeArgs)
+    ->Unit(benchmark::kMillisecond);
+
+// For reference, time to compute Fletcher16 over the whole stream.
+static void BM_Fletcher16(benchmark::State& state) {
+  const std::vector<uint8_t>& stream = NoisyStream(MessageFramer::Mode::kBle);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        ::Fletcher16(stream.data(), stream.size(), /*init=*/1));
+  }
+  state.SetBytesProcessed(state.iterations() * stream.size());
+}
+BENCHMARK(BM_Fletcher16)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
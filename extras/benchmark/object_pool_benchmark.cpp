@@ -0,0 +1,119 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of allocating and freeing 132-byte buffers (the size of a serial
+// packet) with:
+//
+// BM_Malloc: malloc() and free().
+// BM_ObjectPool: single-threaded ObjectPool.
+// BM_ConcurrentPool: ConcurrentObjectPool.
+// BM_ConcurrentPoolBulk: ConcurrentObjectPool AllocateBulk() and FreeBulk().
+// BM_ConcurrentPoolCache: ConcurrentObjectPool through a per-thread Cache.
+//
+// Each iteration allocates a batch of 8 buffers and then frees them.
+// items_per_second is allocate + free pairs per second per thread. The
+// multithreaded variants share one pool (or the malloc heap) among threads.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <stdlib.h>
+
+#include "src/cpp/concurrent_object_pool.h"
+#include "src/cpp/object_pool.h"
+#include "benchmark/benchmark.h"
+
+using ::audio_tactile::ConcurrentObjectPool;
+using ::audio_tactile::ObjectPool;
+
+namespace {
+
+struct Buffer {
+  char bytes[132];
+};
+
+constexpr int kBatch = 8;
+constexpr int kMaxThreads = 8;
+constexpr int kPoolCapacity = 256;
+static_assert(kBatch * kMaxThreads <= kPoolCapacity,
+              "Pool must hold a batch for every thread.");
+
+ConcurrentObjectPool<Buffer, kPoolCapacity> g_concurrent_pool;
+
+}  // namespace
+
+static void BM_Malloc(benchmark::State& state) {
+  Buffer* buffers[kBatch];
+  for (auto _ : state) {
+    for (int i = 0; i < kBatch; ++i) {
+      buffers[i] = static_cast<Buffer*>(malloc(sizeof(Buffer)));
+    }
+    benchmark::DoNotOptimize(buffers);
+    for (int i = 0; i < kBatch; ++i) { free(buffers[i]); }
+  }
+  state.SetItemsProcessed(state.iterations() * kBatch);
+}
+BENCHMARK(BM_Malloc)->ThreadRange(1, kMaxThreads);
+
+static void BM_ObjectPool(benchmark::State& state) {
+  ObjectPool<Buffer, kPoolCapacity> pool;
+  Buffer* buffers[kBatch];
+  for (auto _ : state) {
+    for (int i = 0; i < kBatch; ++i) { buffers[i] = pool.Allocate(); }
+    benchmark::DoNotOptimize(buffers);
+    for (int i = 0; i < kBatch; ++i) { pool.Free(buffers[i]); }
+  }
+  state.SetItemsProcessed(state.iterations() * kBatch);
+}
+BENCHMARK(BM_ObjectPool);
+
+static void BM_ConcurrentPool(benchmark::State& state) {
+  Buffer* buffers[kBatch];
+  for (auto _ : state) {
+    for (int i = 0; i < kBatch; ++i) {
+      buffers[i] = g_concurrent_pool.Allocate();
+    }
+    benchmark::DoNotOptimize(buffers);
+    for (int i = 0; i < kBatch; ++i) { g_concurrent_pool.Free(buffers[i]); }
+  }
+  state.SetItemsProcessed(state.iterations() * kBatch);
+}
+BENCHMARK(BM_ConcurrentPool)->ThreadRange(1, kMaxThreads);
+
+static void BM_ConcurrentPoolBulk(benchmark::State& state) {
+  Buffer* buffers[kBatch];
+  for (auto _ : state) {
+    g_concurrent_pool.AllocateBulk(buffers, kBatch);
+    benchmark::DoNotOptimize(buffers);
+    g_concurrent_pool.FreeBulk(buffers, kBatch);
+  }
+  state.SetItemsProcessed(state.iterations() * kBatch);
+}
+BENCHMARK(BM_ConcurrentPoolBulk)->ThreadRange(1, kMaxThreads);
+
+static void BM_ConcurrentPoolCache(benchmark::State& state) {
+  decltype(g_concurrent_pool)::Cache<2 * kBatch> cache(&g_concurrent_pool);
+  Buffer* buffers[kBatch];
+  for (auto _ : state) {
+    for (int i = 0; i < kBatch; ++i) { buffers[i] = cache.Allocate(); }
+    benchmark::DoNotOptimize(buffers);
+    for (int i = 0; i < kBatch; ++i) { cache.Free(buffers[i]); }
+  }
+  state.SetItemsProcessed(state.iterations() * kBatch);
+}
+BENCHMARK(BM_ConcurrentPoolCache)->ThreadRange(1, kMaxThreads);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,211 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// CPU savings and label accuracy of PhonemeScheduler vs. ungated inference.
+//
+// The test signal imitates speech with pauses: the extras/test/testdata
+// phone_*.wav recordings, each followed by 0.75 s of pause, with background
+// noise at about -60 dBFS throughout (about 25% speech). BM_Ungated runs
+// CarlFrontend + ClassifyPhoneme on every block; BM_Gated runs
+// PhonemeScheduler. Counters:
+//
+//   eval_fraction:  Fraction of blocks on which the network ran.
+//   agreement:      Fraction of blocks where the phoneme label matches ungated.
+//   speech_recall:  Of blocks that ungated labels as speech, fraction that
+//                   PhonemeScheduler also labels as speech.
+//   vad_accuracy:   Fraction of blocks where speech vs. silence labels match
+//                   the true segmentation. The network tends to label some of
+//                   the noise in pauses as speech, while gating suppresses
+//                   this, so this may be higher for gated than ungated
+//                   inference.
+//
+// Run from the repo root so that the testdata files are found.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "src/dsp/read_wav_file.h"
+#include "src/frontend/carl_frontend.h"
+#include "src/phonetics/classify_phoneme.h"
+#include "src/phonetics/phoneme_scheduler.h"
+#include "benchmark/benchmark.h"
+
+namespace {
+
+constexpr int kBlockSize = kPhonemeSchedulerBlockSize;
+const char* kPhones[] = {"aa", "ae", "eh", "er", "ih", "iy", "uh", "uw", "z"};
+
+// True segmentation, 1 for samples of a phone recording, 0 in pauses.
+std::vector<bool>* is_phone_sample = nullptr;
+
+// Makes the speech-with-pauses test signal.
+const std::vector<float>& GetSignal() {
+  static std::vector<float>* signal = nullptr;
+  if (signal != nullptr) { return *signal; }
+  signal = new std::vector<float>;
+  is_phone_sample = new std::vector<bool>;
+
+  const int pause_samples = 3 * kPhonemeSchedulerSampleRateHz / 4;
+  for (const char* phone : kPhones) {
+    char wav_file[1024];
+    std::snprintf(wav_file, sizeof(wav_file),
+                  "extras/test/testdata/phone_%s.wav", phone);
+    size_t num_samples;
+    int num_channels;
+    int sample_rate_hz;
+    int16_t* samples = Read16BitWavFile(wav_file, &num_samples,
+                                        &num_channels, &sample_rate_hz);
+    if (samples == nullptr) {
+      std::fprintf(stderr, "Error reading \"%s\"\n", wav_file);
+      std::exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < num_samples; ++i) {
+      signal->push_back(samples[i] / 32768.0f);
+    }
+    free(samples);
+    is_phone_sample->insert(is_phone_sample->end(), num_samples, true);
+    signal->insert(signal->end(), pause_samples, 0.0f);
+    is_phone_sample->insert(is_phone_sample->end(), pause_samples, false);
+  }
+
+  std::mt19937 rng(0);
+  std::normal_distribution<float> noise(0.0f, 1e-3f);
+  for (float& sample : *signal) { sample += noise(rng); }
+  signal->resize(signal->size() / kBlockSize * kBlockSize);
+  return *signal;
+}
+
+int NumBlocks() { return GetSignal().size() / kBlockSize; }
+
+// Fraction of blocks where the speech/silence decision from `phonemes` matches
+// the true segmentation. A block counts as speech if any of the samples in the
+// classifier's window of kClassifyPhonemeNumFrames blocks are in a phone.
+double VadAccuracy(const std::vector<int>& phonemes) {
+  GetSignal();
+  int correct = 0;
+  for (int b = 0; b < NumBlocks(); ++b) {
+    bool is_speech = false;
+    for (int i = std::max(0, b + 1 - kClassifyPhonemeNumFrames) * kBlockSize;
+         i < (b + 1) * kBlockSize; ++i) {
+      is_speech = is_speech || (*is_phone_sample)[i];
+    }
+    correct += (is_speech == (phonemes[b] != 0));
+  }
+  return static_cast<double>(correct) / NumBlocks();
+}
+
+// Phoneme labels from ungated frontend + ClassifyPhoneme on every block.
+std::vector<int> RunUngated() {
+  const std::vector<float>& signal = GetSignal();
+  CarlFrontendParams params = kCarlFrontendDefaultParams;
+  params.input_sample_rate_hz = kPhonemeSchedulerSampleRateHz;
+  params.block_size = kBlockSize;
+  params.pcen_cross_channel_diffusivity = 60.0f;
+  CarlFrontend* frontend = CarlFrontendMake(&params);
+
+  const int num_channels = kClassifyPhonemeNumChannels;
+  const int window_size = kClassifyPhonemeNumFrames * num_channels;
+  std::vector<float> frames(window_size);
+  std::vector<float> input(kBlockSize);
+  std::vector<int> phonemes(NumBlocks(), 0);
+  for (int b = 0; b < NumBlocks(); ++b) {
+    std::memmove(frames.data(), frames.data() + num_channels,
+                 sizeof(float) * (window_size - num_channels));
+    std::copy(signal.begin() + b * kBlockSize,
+              signal.begin() + (b + 1) * kBlockSize, input.begin());
+    CarlFrontendProcessSamples(frontend, input.data(),
+                               frames.data() + window_size - num_channels);
+    if (b >= kClassifyPhonemeNumFrames - 1) {
+      ClassifyPhonemeLabels labels;
+      ClassifyPhoneme(frames.data(), &labels, nullptr);
+      phonemes[b] = labels.phoneme;
+    }
+  }
+
+  CarlFrontendFree(frontend);
+  return phonemes;
+}
+
+}  // namespace
+
+static void BM_Ungated(benchmark::State& state) {
+  std::vector<int> phonemes;
+  for (auto _ : state) {
+    phonemes = RunUngated();
+    benchmark::DoNotOptimize(phonemes.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NumBlocks());
+  state.counters["eval_fraction"] = 1.0;
+  state.counters["vad_accuracy"] = VadAccuracy(phonemes);
+}
+BENCHMARK(BM_Ungated);
+
+// Args are {silence_interval_blocks, hangover_blocks}.
+static void BM_Gated(benchmark::State& state) {
+  const std::vector<float>& signal = GetSignal();
+  const std::vector<int> ungated = RunUngated();
+  PhonemeSchedulerParams params;
+  PhonemeSchedulerSetDefaultParams(&params);
+  params.silence_interval_blocks = state.range(0);
+  params.hangover_blocks = state.range(1);
+  PhonemeScheduler* scheduler = PhonemeSchedulerMake(&params);
+
+  std::vector<int> phonemes(NumBlocks());
+  for (auto _ : state) {
+    PhonemeSchedulerReset(scheduler);
+    for (int b = 0; b < NumBlocks(); ++b) {
+      ClassifyPhonemeLabels labels;
+      PhonemeSchedulerProcessSamples(scheduler, &signal[b * kBlockSize],
+                                     &labels, nullptr);
+      phonemes[b] = labels.phoneme;
+    }
+    benchmark::DoNotOptimize(phonemes.data());
+  }
+
+  int agree = 0;
+  int ungated_speech = 0;
+  int recalled = 0;
+  for (int b = 0; b < NumBlocks(); ++b) {
+    agree += (phonemes[b] == ungated[b]);
+    if (ungated[b] != 0) {
+      ++ungated_speech;
+      recalled += (phonemes[b] != 0);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * NumBlocks());
+  state.counters["eval_fraction"] =
+      static_cast<double>(scheduler->num_evals) / scheduler->num_blocks;
+  state.counters["agreement"] = static_cast<double>(agree) / NumBlocks();
+  state.counters["speech_recall"] =
+      static_cast<double>(recalled) / ungated_speech;
+  state.counters["vad_accuracy"] = VadAccuracy(phonemes);
+  PhonemeSchedulerFree(scheduler);
+}
+BENCHMARK(BM_Gated)
+    ->Args({4, 12})
+    ->Args({8, 12})
+    ->Args({16, 12})
+    ->Args({8, 6})
+    ->Args({8, 25});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,231 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmarks of the puck -> sleeve protocol over emulated links.
+//
+// BM_LoopbackMessages: Host CPU cost of the protocol, sending kAudioSamples
+//   messages over an unlimited loopback link. Each is encoded, framed,
+//   checksummed, decoded, and dispatched. items_per_second is messages/s.
+//
+// BM_PtyMessages: Same over a pseudo-terminal pair, including the OS serial
+//   driver path.
+//
+// BM_LinkLatency: Streams audio messages every 4 ms (64 samples at 16 kHz)
+//   over a 1 Mbaud UART-like link (100 kB/s, 0.1 ms latency) for 10 s of
+//   virtual time. The first arg is the framing mode, and the second arg sets
+//   the bit error rate to 10^-arg (0 means no errors). Reports end-to-end
+//   latency from enqueueing the message to dispatch on the receiver, the
+//   fraction of messages lost, link utilization, and the max messages/s that
+//   the link could carry.
+//
+//   Framing mode 0 is kSerial, fixed 132-byte frames as sent by the current
+//   serial_com.cpp. With it, kAdpcmAudioSamples has the same capacity as
+//   kAudioSamples, and corrupted payloads are not detected, which also skews
+//   latency since messages are identified by a tag in the audio. Mode 1 is
+//   kBle, variable-length frames with a checksum. Its kAudioSamples vs.
+//   kAdpcmAudioSamples comparison applies only to a link that sends
+//   message.size() bytes per message, which the serial firmware does not yet
+//   do.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "extras/tools/serial_link_emulator.h"
+#include "benchmark/benchmark.h"
+
+using ::audio_tactile::FaultyTransport;
+using ::audio_tactile::ImaAdpcmInit;
+using ::audio_tactile::ImaAdpcmState;
+using ::audio_tactile::kAdcDataSize;
+using ::audio_tactile::LinkEndpoint;
+using ::audio_tactile::LoopbackLink;
+using ::audio_tactile::Message;
+using ::audio_tactile::MessageFramer;
+using ::audio_tactile::MessageType;
+using ::audio_tactile::PtyLink;
+using ::audio_tactile::Slice;
+using ::audio_tactile::Transport;
+
+namespace {
+
+int16_t g_audio[kAdcDataSize];
+int16_t g_received_audio[kAdcDataSize];
+
+// Sleeve-style dispatch of a received message.
+void HandleMessage(const Message& message) {
+  switch (message.type()) {
+    case MessageType::kAudioSamples:
+      message.ReadAudioSamples(
+          Slice<int16_t, kAdcDataSize>(g_received_audio));
+      break;
+    case MessageType::kAdpcmAudioSamples:
+      message.ReadAdpcmAudioSamples(
+          Slice<int16_t, kAdcDataSize>(g_received_audio));
+      break;
+    default:
+      break;
+  }
+}
+
+// Sends batches of audio messages from `tx` to `rx` and polls, counting
+// messages received.
+template <typename PollFun>
+void RunThroughput(benchmark::State& state, Transport* tx, Transport* rx,
+                   PollFun wait) {
+  constexpr int kBatch = 16;
+  LinkEndpoint puck(tx);
+  LinkEndpoint sleeve(rx);
+  int64_t num_received = 0;
+
+  for (auto _ : state) {
+    for (int i = 0; i < kBatch; ++i) {
+      puck.tx_message().WriteAudioSamples(
+          Slice<const int16_t, kAdcDataSize>(g_audio));
+      puck.SendTxMessage();
+    }
+    int batch_received = 0;
+    while (batch_received < kBatch) {
+      batch_received += sleeve.Poll(HandleMessage);
+      if (batch_received < kBatch) { wait(); }
+    }
+    num_received += batch_received;
+  }
+  state.SetItemsProcessed(num_received);
+}
+
+// Fills g_audio with a constant level that encodes `id` mod 256. A constant
+// block survives ADPCM coding with small error in the last sample.
+void TagAudio(int id) {
+  std::fill(g_audio, g_audio + kAdcDataSize,
+            static_cast<int16_t>((id % 256) * 100 - 12800));
+}
+
+// Returns the id of the most recent of `num_sent` messages matching the tag
+// of g_received_audio.
+int ReceivedId(int num_sent) {
+  const int residue =
+      std::max(0, g_received_audio[kAdcDataSize - 1] + 12850) / 100 % 256;
+  return num_sent - 1 - (num_sent - 1 - residue + 256) % 256;
+}
+
+}  // namespace
+
+static void BM_LoopbackMessages(benchmark::State& state) {
+  LoopbackLink link({/*bytes_per_second=*/0.0, /*latency_s=*/0.0});
+  RunThroughput(state, link.a(), link.b(), [] {});
+}
+BENCHMARK(BM_LoopbackMessages);
+
+static void BM_PtyMessages(benchmark::State& state) {
+  PtyLink link;
+  if (!link.Open()) {
+    state.SkipWithError("Pseudo-terminals are unavailable.");
+    return;
+  }
+  RunThroughput(state, link.a(), link.b(), [] {});
+}
+BENCHMARK(BM_PtyMessages);
+
+template <MessageType kType>
+static void BM_LinkLatency(benchmark::State& state) {
+  constexpr double kMessagePeriodS = 0.004;
+  constexpr double kDurationS = 10.0;
+  constexpr double kTickS = 0.0001;
+  constexpr double kBytesPerSecond = 100000.0;
+  const MessageFramer::Mode mode = (state.range(0) == 0)
+                                       ? MessageFramer::Mode::kSerial
+                                       : MessageFramer::Mode::kBle;
+  const double bit_error_rate =
+      (state.range(1) > 0) ? std::pow(10.0, -state.range(1)) : 0.0;
+
+  std::vector<double> latencies;
+  int num_sent = 0;
+  int frame_size = 0;
+  double utilization = 0.0;
+
+  for (auto _ : state) {
+    LoopbackLink link({kBytesPerSecond, /*latency_s=*/0.0001});
+    FaultyTransport faulty(link.a(), {bit_error_rate, 0.0, /*seed=*/0});
+    LinkEndpoint puck(&faulty, mode);
+    LinkEndpoint sleeve(link.b(), mode);
+    ImaAdpcmState adpcm_state;
+    ImaAdpcmInit(&adpcm_state);
+    std::vector<double> send_times;
+    latencies.clear();
+
+    const int num_ticks = static_cast<int>(kDurationS / kTickS);
+    const int ticks_per_message = static_cast<int>(kMessagePeriodS / kTickS);
+    for (int tick = 0; tick < num_ticks; ++tick) {
+      if (tick % ticks_per_message == 0) {
+        TagAudio(send_times.size());
+        if (kType == MessageType::kAdpcmAudioSamples) {
+          puck.tx_message().WriteAdpcmAudioSamples(
+              Slice<const int16_t, kAdcDataSize>(g_audio), &adpcm_state);
+        } else {
+          puck.tx_message().WriteAudioSamples(
+              Slice<const int16_t, kAdcDataSize>(g_audio));
+        }
+        frame_size = (mode == MessageFramer::Mode::kSerial)
+                         ? MessageFramer::kMaxFrameSize
+                         : puck.tx_message().size();
+        send_times.push_back(link.now());
+        puck.SendTxMessage();
+      }
+      link.AdvanceTime(kTickS);
+      sleeve.Poll([&](const Message& message) {
+        HandleMessage(message);
+        const int id = ReceivedId(send_times.size());
+        latencies.push_back(link.now() - send_times[id]);
+      });
+    }
+    num_sent = send_times.size();
+    utilization = link.stats().bytes_written / (kBytesPerSecond * kDurationS);
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  double mean = 0.0;
+  for (double latency : latencies) { mean += latency; }
+  mean /= std::max<int>(1, latencies.size());
+  state.counters["mean_latency_ms"] = 1000.0 * mean;
+  state.counters["p99_latency_ms"] =
+      latencies.empty() ? 0.0
+                        : 1000.0 * latencies[latencies.size() * 99 / 100];
+  state.counters["loss_rate"] =
+      1.0 - static_cast<double>(latencies.size()) / num_sent;
+  state.counters["utilization"] = utilization;
+  // Max messages/s the link could carry.
+  state.counters["capacity_messages_per_s"] = kBytesPerSecond / frame_size;
+}
+void ModeAndBitErrorArgs(benchmark::internal::Benchmark* b) {
+  for (int mode : {0, 1}) {
+    for (int bit_error_exponent : {0, 5, 4}) {
+      b->Args({mode, bit_error_exponent});
+    }
+  }
+}
+BENCHMARK_TEMPLATE(BM_LinkLatency, MessageType::kAudioSamples)
+    ->Apply(ModeAndBitErrorArgs)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_LinkLatency, MessageType::kAdpcmAudioSamples)
+    ->Apply(ModeAndBitErrorArgs)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,156 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of reading and writing Settings in the text format vs. the binary
+// settings blob, excluding flash IO.
+//
+// BM_ReadText: Settings::ReadFile on a text settings file held in memory.
+// BM_ReadBlob: ReadSettingsBlob on the equivalent blob.
+// BM_WriteText: Settings::WriteFile to an in-memory buffer.
+// BM_WriteBlob: WriteSettingsBlob.
+// BM_WriteBlobUnchanged: SettingsBlobWriter::Write when settings are unchanged,
+//   the common case when settings are saved periodically.
+//
+// The bytes counter is the size of the encoded settings.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <string.h>
+
+#include <string>
+
+#include "src/cpp/settings.h"
+#include "src/cpp/settings_blob.h"
+#include "benchmark/benchmark.h"
+
+using ::audio_tactile::InputSelection;
+using ::audio_tactile::kSettingsBlobMaxSize;
+using ::audio_tactile::ReadSettingsBlob;
+using ::audio_tactile::Settings;
+using ::audio_tactile::SettingsBlobWriter;
+using ::audio_tactile::Slice;
+using ::audio_tactile::WriteSettingsBlob;
+
+namespace {
+
+Settings MakeSettings() {
+  Settings settings;
+  strcpy(settings.device_name, "Pineapple");  // NOLINT
+  settings.input = InputSelection::kPdmMic;
+  for (int knob = 0; knob < kNumTuningKnobs; ++knob) {
+    settings.tuning.values[knob] = 10 * knob + 5;
+  }
+  for (int c = 0; c < settings.channel_map.num_output_channels; ++c) {
+    settings.channel_map.gains[c] = ChannelGainFromControlValue(63 - c);
+  }
+  return settings;
+}
+
+std::string WriteText(const Settings& settings) {
+  std::string text;
+  settings.WriteFile([&text](const char* line) {
+    text += line;
+    text += '\n';
+    return true;
+  });
+  return text;
+}
+
+}  // namespace
+
+static void BM_ReadText(benchmark::State& state) {
+  const std::string text = WriteText(MakeSettings());
+  Settings settings;
+  for (auto _ : state) {
+    const char* s = text.c_str();
+    settings.ReadFile(
+        [&s](char* buffer, int buffer_size) {
+          if (*s == '\0') { return false; }
+          const char* newline = strchr(s, '\n');
+          int size = newline ? (newline + 1 - s) : strlen(s);
+          if (size >= buffer_size) { size = buffer_size - 1; }
+          memcpy(buffer, s, size);
+          buffer[size] = '\0';
+          s += size;
+          return true;
+        },
+        [](int line_number, const char* message) {});
+    benchmark::DoNotOptimize(settings);
+  }
+  state.counters["bytes"] = text.size();
+}
+BENCHMARK(BM_ReadText);
+
+static void BM_ReadBlob(benchmark::State& state) {
+  uint8_t blob[kSettingsBlobMaxSize];
+  const int size = WriteSettingsBlob(
+      MakeSettings(), Slice<uint8_t, kSettingsBlobMaxSize>(blob));
+  Settings settings;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        ReadSettingsBlob(Slice<const uint8_t>(blob, size), &settings));
+    benchmark::DoNotOptimize(settings);
+  }
+  state.counters["bytes"] = size;
+}
+BENCHMARK(BM_ReadBlob);
+
+static void BM_WriteText(benchmark::State& state) {
+  const Settings settings = MakeSettings();
+  char file[1024];
+  for (auto _ : state) {
+    int size = 0;
+    settings.WriteFile([&](const char* line) {
+      const int length = strlen(line);
+      memcpy(file + size, line, length);
+      size += length;
+      file[size++] = '\n';
+      return true;
+    });
+    benchmark::DoNotOptimize(file);
+  }
+}
+BENCHMARK(BM_WriteText);
+
+static void BM_WriteBlob(benchmark::State& state) {
+  const Settings settings = MakeSettings();
+  uint8_t blob[kSettingsBlobMaxSize];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(WriteSettingsBlob(
+        settings, Slice<uint8_t, kSettingsBlobMaxSize>(blob)));
+    benchmark::DoNotOptimize(blob);
+  }
+}
+BENCHMARK(BM_WriteBlob);
+
+static void BM_WriteBlobUnchanged(benchmark::State& state) {
+  const Settings settings = MakeSettings();
+  SettingsBlobWriter writer;
+  int num_writes = 0;
+  auto write_fun = [&num_writes](const uint8_t* data, int size) {
+    ++num_writes;
+    return true;
+  };
+  writer.Write(settings, write_fun);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(writer.Write(settings, write_fun));
+  }
+  if (num_writes != 1) { state.SkipWithError("Unexpected write."); }
+}
+BENCHMARK(BM_WriteBlobUnchanged);
+
+BENCHMARK_MAIN();
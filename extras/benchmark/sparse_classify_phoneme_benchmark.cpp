@@ -0,0 +1,246 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Accuracy vs. sparsity vs. speed of a block-sparse phoneme classifier.
+//
+// The first two dense layers of the phoneme classifier (280x96 and 96x64) are
+// magnitude pruned to a target block sparsity, without fine tuning, and run
+// with SparseDenseReluLayer. The network is evaluated on the frames of the
+// extras/test/testdata/phone_*.wav recordings. Besides time, each benchmark
+// reports counters:
+//
+//   sparsity:  Fraction of blocks pruned in the first two layers.
+//   accuracy:  Fraction of windows whose top phoneme is the recorded phone.
+//   agreement: Fraction of windows whose top phoneme matches the unpruned net.
+//
+// Run from the repo root so that the testdata files are found. Accuracy of a
+// model exported with export_model_as_c_data.py --sparsity, which fine tunes
+// after pruning, should be higher than for the pruned-only model here.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "src/dsp/read_wav_file.h"
+#include "src/frontend/carl_frontend.h"
+#include "src/phonetics/classify_phoneme.h"
+#include "src/phonetics/classify_phoneme_params.h"
+#include "src/phonetics/nn_ops.h"
+#include "benchmark/benchmark.h"
+
+namespace {
+
+constexpr int kBlockSize = 128;
+const char* kPhones[] = {"aa", "ae", "eh", "er", "ih", "iy", "uh", "uw", "z"};
+
+struct Windows {
+  std::vector<float> frames;  // Network inputs, kInputUnits per window.
+  std::vector<int> labels;    // Recorded phone of each window.
+  int size() const { return labels.size(); }
+};
+
+int FindPhoneme(const char* name) {
+  for (int i = 0; i < kClassifyPhonemeNumPhonemes; ++i) {
+    if (!strcmp(name, kClassifyPhonemePhonemeNames[i])) { return i; }
+  }
+  return -1;
+}
+
+// Runs the frontend on the testdata WAVs and collects sliding windows.
+const Windows& GetWindows() {
+  static Windows* windows = nullptr;
+  if (windows != nullptr) { return *windows; }
+  windows = new Windows;
+
+  CarlFrontendParams params = kCarlFrontendDefaultParams;
+  params.input_sample_rate_hz = 16000.0f;
+  params.block_size = kBlockSize;
+  params.pcen_cross_channel_diffusivity = 60.0f;
+  CarlFrontend* frontend = CarlFrontendMake(&params);
+
+  for (const char* phone : kPhones) {
+    char wav_file[1024];
+    std::snprintf(wav_file, sizeof(wav_file),
+                  "extras/test/testdata/phone_%s.wav", phone);
+    size_t num_samples;
+    int num_channels;
+    int sample_rate_hz;
+    int16_t* samples = Read16BitWavFile(wav_file, &num_samples,
+                                        &num_channels, &sample_rate_hz);
+    if (samples == nullptr) {
+      std::fprintf(stderr, "Error reading \"%s\"\n", wav_file);
+      std::exit(EXIT_FAILURE);
+    }
+
+    CarlFrontendReset(frontend);
+    std::vector<float> frames;
+    float input[kBlockSize];
+    float frame[kNumCarlChannels];
+    for (size_t start = 0; start + kBlockSize <= num_samples;
+         start += kBlockSize) {
+      for (int i = 0; i < kBlockSize; ++i) {
+        input[i] = samples[start + i] / 32768.0f;
+      }
+      CarlFrontendProcessSamples(frontend, input, frame);
+      frames.insert(frames.end(), frame, frame + kNumCarlChannels);
+    }
+    free(samples);
+
+    const int num_frames = frames.size() / kNumCarlChannels;
+    const int label = FindPhoneme(phone);
+    for (int t = 0; t + kNumFrames <= num_frames; ++t) {
+      windows->frames.insert(
+          windows->frames.end(), frames.begin() + t * kNumCarlChannels,
+          frames.begin() + (t + kNumFrames) * kNumCarlChannels);
+      windows->labels.push_back(label);
+    }
+  }
+
+  CarlFrontendFree(frontend);
+  return *windows;
+}
+
+// Finds the block L2 norm threshold that prunes `sparsity` of the blocks.
+float PruneThreshold(const float* weights, int size, int block_size,
+                     float sparsity) {
+  std::vector<float> norms(size / block_size);
+  for (size_t b = 0; b < norms.size(); ++b) {
+    float sum = 0.0f;
+    for (int i = 0; i < block_size; ++i) {
+      sum += weights[b * block_size + i] * weights[b * block_size + i];
+    }
+    norms[b] = std::sqrt(sum);
+  }
+  const int num_pruned = static_cast<int>(sparsity * norms.size());
+  if (num_pruned == 0) { return 0.0f; }
+  std::nth_element(norms.begin(), norms.begin() + (num_pruned - 1),
+                   norms.end());
+  return norms[num_pruned - 1];
+}
+
+int ArgMax(const float* x, int size) {
+  return std::max_element(x, x + size) - x;
+}
+
+// Top phoneme from the unpruned network.
+int DenseTopPhoneme(const float* in) {
+  float buffer1[kDense1Units];
+  float buffer2[kDense2Units];
+  DenseReluLayer(kInputUnits, kDense1Units, in,
+                 kDense1Weights, kDense1Bias, buffer1);
+  DenseReluLayer(kDense1Units, kDense2Units, buffer1,
+                 kDense2Weights, kDense2Bias, buffer2);
+  DenseReluLayer(kDense2Units, kDense3Units, buffer2,
+                 kDense3Weights, kDense3Bias, buffer1);
+  DenseLinearLayer(kDense3Units, kPhonemeUnits, buffer1,
+                   kPhonemeWeights, kPhonemeBias, buffer2);
+  return ArgMax(buffer2, kPhonemeUnits);
+}
+
+// Top phoneme with sparse first and second layers.
+int SparseTopPhoneme(const BlockSparseMatrix* dense1,
+                     const BlockSparseMatrix* dense2, const float* in) {
+  float buffer1[kDense1Units];
+  float buffer2[kDense2Units];
+  SparseDenseReluLayer(dense1, in, kDense1Bias, buffer1);
+  SparseDenseReluLayer(dense2, buffer1, kDense2Bias, buffer2);
+  DenseReluLayer(kDense2Units, kDense3Units, buffer2,
+                 kDense3Weights, kDense3Bias, buffer1);
+  DenseLinearLayer(kDense3Units, kPhonemeUnits, buffer1,
+                   kPhonemeWeights, kPhonemeBias, buffer2);
+  return ArgMax(buffer2, kPhonemeUnits);
+}
+
+}  // namespace
+
+static void BM_DenseClassifier(benchmark::State& state) {
+  const Windows& windows = GetWindows();
+  std::vector<int> top(windows.size());
+
+  for (auto _ : state) {
+    for (int t = 0; t < windows.size(); ++t) {
+      top[t] = DenseTopPhoneme(windows.frames.data() + t * kInputUnits);
+    }
+    benchmark::DoNotOptimize(top.data());
+  }
+
+  int correct = 0;
+  for (int t = 0; t < windows.size(); ++t) {
+    correct += (top[t] == windows.labels[t]);
+  }
+  state.SetItemsProcessed(state.iterations() * windows.size());
+  state.counters["accuracy"] = static_cast<double>(correct) / windows.size();
+}
+BENCHMARK(BM_DenseClassifier);
+
+// Args are {sparsity percent, block size}.
+static void BM_SparseClassifier(benchmark::State& state) {
+  const float sparsity = state.range(0) / 100.0f;
+  const int block_size = state.range(1);
+  const Windows& windows = GetWindows();
+
+  BlockSparseMatrix* dense1 = BlockSparseMatrixMake(
+      kInputUnits, kDense1Units, block_size, kDense1Weights,
+      PruneThreshold(kDense1Weights, kInputUnits * kDense1Units,
+                     block_size, sparsity));
+  BlockSparseMatrix* dense2 = BlockSparseMatrixMake(
+      kDense1Units, kDense2Units, block_size, kDense2Weights,
+      PruneThreshold(kDense2Weights, kDense1Units * kDense2Units,
+                     block_size, sparsity));
+  if (dense1 == nullptr || dense2 == nullptr) {
+    state.SkipWithError("BlockSparseMatrixMake failed");
+    return;
+  }
+
+  std::vector<int> top(windows.size());
+  for (auto _ : state) {
+    for (int t = 0; t < windows.size(); ++t) {
+      top[t] = SparseTopPhoneme(dense1, dense2,
+                                windows.frames.data() + t * kInputUnits);
+    }
+    benchmark::DoNotOptimize(top.data());
+  }
+
+  int correct = 0;
+  int agree = 0;
+  for (int t = 0; t < windows.size(); ++t) {
+    correct += (top[t] == windows.labels[t]);
+    agree += (top[t] ==
+              DenseTopPhoneme(windows.frames.data() + t * kInputUnits));
+  }
+  const int total_blocks =
+      (kInputUnits * kDense1Units + kDense1Units * kDense2Units) / block_size;
+  const int kept_blocks =
+      BlockSparseMatrixNumBlocks(dense1) + BlockSparseMatrixNumBlocks(dense2);
+  state.SetItemsProcessed(state.iterations() * windows.size());
+  state.counters["sparsity"] = 1.0 - static_cast<double>(kept_blocks)
+      / total_blocks;
+  state.counters["accuracy"] = static_cast<double>(correct) / windows.size();
+  state.counters["agreement"] = static_cast<double>(agree) / windows.size();
+
+  BlockSparseMatrixFree(dense2);
+  BlockSparseMatrixFree(dense1);
+}
+BENCHMARK(BM_SparseClassifier)
+    ->ArgsProduct({{0, 25, 50, 75, 90}, {4, 8}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,124 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of playing TactilePatterns:
+//
+// BM_Synthesize: TactilePatternSynthesize(), interpreting ops while playing.
+// BM_Render: TactilePatternRender() of a precompiled timeline.
+// BM_CompileAndRender: TactilePatternCompileEx() plus rendering.
+//
+// The first arg selects the pattern: the connect, disconnect, and confirm
+// patterns (those of the goldens in extras/test/testdata), or the start up
+// pattern. The second arg is the block size in frames. Each iteration plays the
+// whole pattern to completion on 10 channels at the device tactile sample rate.
+// items_per_second is frames synthesized per second.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include "src/tactile/tactile_pattern.h"
+#include "benchmark/benchmark.h"
+
+namespace {
+
+constexpr float kSampleRateHz = 1953.125f;
+constexpr int kNumChannels = 10;
+constexpr int kMaxBlockSize = 64;
+
+// Gets the ex pattern selected by `index`.
+const uint8_t* GetPattern(int index, uint8_t* buffer) {
+  const char* kSimplePatterns[3] = {kTactilePatternConnect,
+                                    kTactilePatternDisconnect,
+                                    kTactilePatternConfirm};
+  if (index >= 3) { return kTactilePatternExStartUp; }
+  TactilePatternTranslateSimplePattern(kSimplePatterns[index], buffer,
+                                       kTactilePatternBufferSize);
+  return buffer;
+}
+
+TactilePatternTimeline g_timeline;
+
+void PatternAndBlockSizeArgs(benchmark::internal::Benchmark* b) {
+  for (int pattern = 0; pattern < 4; ++pattern) {
+    for (int block_size : {8, kMaxBlockSize}) {
+      b->Args({pattern, block_size});
+    }
+  }
+}
+
+}  // namespace
+
+static void BM_Synthesize(benchmark::State& state) {
+  uint8_t buffer[kTactilePatternBufferSize];
+  const uint8_t* pattern = GetPattern(state.range(0), buffer);
+  TactilePattern p;
+  TactilePatternInit(&p, kSampleRateHz, kNumChannels);
+  const int block_size = state.range(1);
+  float output[kMaxBlockSize * kNumChannels];
+  int64_t num_frames = 0;
+
+  for (auto _ : state) {
+    TactilePatternStartEx(&p, pattern);
+    do {
+      num_frames += block_size;
+    } while (TactilePatternSynthesize(&p, block_size, output));
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(num_frames);
+}
+BENCHMARK(BM_Synthesize)->Apply(PatternAndBlockSizeArgs);
+
+static void BM_Render(benchmark::State& state) {
+  uint8_t buffer[kTactilePatternBufferSize];
+  const uint8_t* pattern = GetPattern(state.range(0), buffer);
+  TactilePatternCompileEx(&g_timeline, kSampleRateHz, kNumChannels, pattern);
+  TactilePatternRenderer renderer;
+  const int block_size = state.range(1);
+  float output[kMaxBlockSize * kNumChannels];
+  int64_t num_frames = 0;
+
+  for (auto _ : state) {
+    TactilePatternRendererStart(&renderer, &g_timeline);
+    do {
+      num_frames += block_size;
+    } while (TactilePatternRender(&renderer, block_size, output));
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(num_frames);
+}
+BENCHMARK(BM_Render)->Apply(PatternAndBlockSizeArgs);
+
+static void BM_CompileAndRender(benchmark::State& state) {
+  uint8_t buffer[kTactilePatternBufferSize];
+  const uint8_t* pattern = GetPattern(state.range(0), buffer);
+  TactilePatternRenderer renderer;
+  const int block_size = state.range(1);
+  float output[kMaxBlockSize * kNumChannels];
+  int64_t num_frames = 0;
+
+  for (auto _ : state) {
+    TactilePatternCompileEx(&g_timeline, kSampleRateHz, kNumChannels, pattern);
+    TactilePatternRendererStart(&renderer, &g_timeline);
+    do {
+      num_frames += block_size;
+    } while (TactilePatternRender(&renderer, block_size, output));
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(num_frames);
+}
+BENCHMARK(BM_CompileAndRender)->Apply(PatternAndBlockSizeArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,82 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of TactileProcessor.
+//
+// This benchmark measures the time to process one second of 16 kHz audio for
+// several block sizes and vowel embedding hops. Compare vowel_hop = 2 or 4
+// against vowel_hop = 1 (per-block updates) to see the CPU saved by updating
+// the vowel embedding less often, and a non-power-of-two block_size like 48
+// against its power-of-two neighbors.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <random>
+#include <vector>
+
+#include "src/tactile/tactile_processor.h"
+#include "benchmark/benchmark.h"
+
+static constexpr float kSampleRateHz = 16000.0f;
+
+// Args are {block_size, vowel_hop}.
+static void BM_TactileProcessor(benchmark::State& state) {
+  const int block_size = state.range(0);
+  const int vowel_hop = state.range(1);
+  const int num_blocks = static_cast<int>(kSampleRateHz) / block_size;
+
+  TactileProcessorParams params;
+  TactileProcessorSetDefaultParams(&params);
+  params.frontend_params.input_sample_rate_hz = kSampleRateHz;
+  params.frontend_params.block_size = block_size;
+  params.vowel_hop = vowel_hop;
+  TactileProcessor* processor = TactileProcessorMake(&params);
+  if (processor == nullptr) {
+    state.SkipWithError("TactileProcessorMake failed");
+    return;
+  }
+
+  std::mt19937 rng(0);
+  std::normal_distribution<float> dist(0.0f, 0.1f);
+  std::vector<float> input(num_blocks * block_size);
+  for (float& sample : input) {
+    sample = dist(rng);
+  }
+  std::vector<float> output(kTactileProcessorNumTactors * block_size);
+
+  for (auto _ : state) {
+    for (int b = 0; b < num_blocks; ++b) {
+      TactileProcessorProcessSamples(
+          processor, input.data() + b * block_size, output.data());
+    }
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * num_blocks * block_size);
+
+  TactileProcessorFree(processor);
+}
+BENCHMARK(BM_TactileProcessor)
+    ->Args({64, 1})
+    ->Args({64, 2})
+    ->Args({64, 4})
+    ->Args({32, 1})
+    ->Args({32, 2})
+    ->Args({32, 4})
+    ->Args({48, 1})
+    ->Args({40, 1});
+
+BENCHMARK_MAIN();
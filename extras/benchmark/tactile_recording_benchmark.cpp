@@ -0,0 +1,179 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of tactile recording encode and decode.
+//
+// The signal is 10 s of 10-channel TactileProcessor output at 16 kHz for noise
+// input, generated once. BM_Encode writes it as a tactile recording in blocks
+// of 64 frames, BM_Decode reads it back in blocks of 64 stored frames, and
+// BM_Seek seeks to random frames and reads 64 frames. Args are the decimation
+// factor and the quantization bits.
+//
+// The realtime_factor counter is seconds of recorded signal per second of wall
+// time, and compression_ratio is the size as 16-bit PCM WAV at 16 kHz over the
+// size of the recording.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "src/tactile/tactile_processor.h"
+#include "extras/tools/tactile_recording.h"
+#include "benchmark/benchmark.h"
+
+namespace {
+
+constexpr int kSampleRateHz = 16000;
+constexpr int kBlockSize = 64;
+constexpr int kNumBlocks = 10 * kSampleRateHz / kBlockSize;
+constexpr int kNumFrames = kNumBlocks * kBlockSize;
+constexpr int kNumChannels = 10;  // kTactileProcessorNumTactors.
+constexpr double kDurationSeconds =
+    static_cast<double>(kNumFrames) / kSampleRateHz;
+
+// Returns 10 s of tactile output for noise input.
+const std::vector<float>& TactileSignal() {
+  static const std::vector<float>* signal = [] {
+    TactileProcessorParams params;
+    TactileProcessorSetDefaultParams(&params);
+    params.frontend_params.input_sample_rate_hz = kSampleRateHz;
+    params.frontend_params.block_size = kBlockSize;
+    TactileProcessor* processor = TactileProcessorMake(&params);
+    std::mt19937 rng(0);
+    std::normal_distribution<float> dist(0.0f, 0.1f);
+    std::vector<float> input(kBlockSize);
+    auto* output = new std::vector<float>(kNumFrames * kNumChannels);
+    for (int b = 0; b < kNumBlocks; ++b) {
+      for (float& sample : input) {
+        sample = dist(rng);
+      }
+      TactileProcessorProcessSamples(
+          processor, input.data(),
+          output->data() + b * kBlockSize * kNumChannels);
+    }
+    TactileProcessorFree(processor);
+    return output;
+  }();
+  return *signal;
+}
+
+bool Encode(const char* filename, int decimation_factor,
+            int quantization_bits) {
+  TactileRecordingParams params;
+  TactileRecordingSetDefaultParams(&params);
+  params.num_channels = kNumChannels;
+  params.input_sample_rate_hz = kSampleRateHz;
+  params.decimation_factor = decimation_factor;
+  params.quantization_bits = quantization_bits;
+  TactileRecordingWriter* writer =
+      TactileRecordingWriterOpen(filename, &params);
+  if (writer == nullptr) { return false; }
+  const std::vector<float>& signal = TactileSignal();
+  for (int b = 0; b < kNumBlocks; ++b) {
+    TactileRecordingWriterWrite(
+        writer, signal.data() + b * kBlockSize * kNumChannels, kBlockSize);
+  }
+  return TactileRecordingWriterClose(writer);
+}
+
+double CompressionRatio(const char* filename) {
+  FILE* f = std::fopen(filename, "rb");
+  std::fseek(f, 0, SEEK_END);
+  const long size = std::ftell(f);
+  std::fclose(f);
+  return (44.0 + 2.0 * kNumFrames * kNumChannels) / size;
+}
+
+}  // namespace
+
+static void BM_Encode(benchmark::State& state) {
+  const int decimation_factor = state.range(0);
+  const int quantization_bits = state.range(1);
+  TactileSignal();
+  const char* filename = std::tmpnam(nullptr);
+
+  for (auto _ : state) {
+    if (!Encode(filename, decimation_factor, quantization_bits)) {
+      state.SkipWithError("Encode failed");
+      return;
+    }
+  }
+
+  state.counters["realtime_factor"] = benchmark::Counter(
+      state.iterations() * kDurationSeconds, benchmark::Counter::kIsRate);
+  state.counters["compression_ratio"] = CompressionRatio(filename);
+  std::remove(filename);
+}
+BENCHMARK(BM_Encode)
+    ->ArgsProduct({{1, 4, 8}, {8, 12, 16}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_Decode(benchmark::State& state) {
+  const int decimation_factor = state.range(0);
+  const int quantization_bits = state.range(1);
+  const char* filename = std::tmpnam(nullptr);
+  if (!Encode(filename, decimation_factor, quantization_bits)) {
+    state.SkipWithError("Encode failed");
+    return;
+  }
+  TactileRecordingReader* reader = TactileRecordingReaderOpen(filename);
+  std::vector<float> samples(kBlockSize * kNumChannels);
+
+  for (auto _ : state) {
+    TactileRecordingReaderSeek(reader, 0);
+    while (TactileRecordingReaderRead(reader, samples.data(), kBlockSize) > 0) {
+      benchmark::DoNotOptimize(samples.data());
+    }
+  }
+
+  state.counters["realtime_factor"] = benchmark::Counter(
+      state.iterations() * kDurationSeconds, benchmark::Counter::kIsRate);
+  TactileRecordingReaderClose(reader);
+  std::remove(filename);
+}
+BENCHMARK(BM_Decode)
+    ->ArgsProduct({{1, 8}, {12}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_Seek(benchmark::State& state) {
+  const char* filename = std::tmpnam(nullptr);
+  if (!Encode(filename, 8, 12)) {
+    state.SkipWithError("Encode failed");
+    return;
+  }
+  TactileRecordingReader* reader = TactileRecordingReaderOpen(filename);
+  std::vector<float> samples(kBlockSize * kNumChannels);
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<size_t> dist(
+      0, reader->num_frames - kBlockSize);
+
+  for (auto _ : state) {
+    TactileRecordingReaderSeek(reader, dist(rng));
+    TactileRecordingReaderRead(reader, samples.data(), kBlockSize);
+    benchmark::DoNotOptimize(samples.data());
+  }
+
+  TactileRecordingReaderClose(reader);
+  std::remove(filename);
+}
+BENCHMARK(BM_Seek);
+
+BENCHMARK_MAIN();
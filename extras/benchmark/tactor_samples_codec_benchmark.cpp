@@ -0,0 +1,144 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Benchmark of compressing and decompressing all-tactors samples.
+//
+// Each benchmark runs over 1000 updates of synthetic samples of the kind
+// selected by the arg:
+//
+//   0: Silence, all samples at the midpoint.
+//   1: Envelope, smooth per-channel envelopes below 10 Hz.
+//   2: Carrier, 250 Hz sinusoids at the 2 kHz PWM update rate with envelopes.
+//   3: Noise, uniformly random samples.
+//
+// Time is per update (one frame of kNumTotalPwm x kNumPwmValues samples).
+// The compression_ratio counter is the mean compressed payload size divided
+// by the 96-byte kAllTactorsSamples payload, lower is better.
+//
+// NOTE: When running benchmarks, build with optimizations (-c opt) and disable
+// frequency scaling (sudo cpupower frequency-set --governor performance). For
+// accurate measurement, run for longer time with --benchmark_min_time=2.0.
+
+#include <math.h>
+
+#include <random>
+#include <vector>
+
+#include "src/cpp/tactor_samples_codec.h"
+#include "benchmark/benchmark.h"
+
+using ::audio_tactile::CompressTactorsSamples;
+using ::audio_tactile::DecompressTactorsSamples;
+using ::audio_tactile::kMaxCompressedTactorsSamplesSize;
+using ::audio_tactile::kNumAllTactorsSamples;
+using ::audio_tactile::kNumPwmValues;
+using ::audio_tactile::kNumTotalPwm;
+using ::audio_tactile::Slice;
+
+namespace {
+
+constexpr int kNumUpdates = 1000;
+constexpr float kPwmRateHz = 2000.0f;
+
+// Generates kNumUpdates updates of samples of the given kind.
+std::vector<uint8_t> MakeSamples(int kind) {
+  std::vector<uint8_t> samples(kNumUpdates * kNumAllTactorsSamples);
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> byte_dist(0, 255);
+  constexpr float kTwoPi = 6.2831853f;
+
+  for (int i = 0; i < static_cast<int>(samples.size()); ++i) {
+    const int c = i % kNumTotalPwm;
+    const float t = (i / kNumTotalPwm) / kPwmRateHz;
+    const float envelope = 0.5f + 0.5f * sin(kTwoPi * (1.0f + 0.7f * c) * t);
+    float value;
+    switch (kind) {
+      case 0:
+        value = 128.0f;
+        break;
+      case 1:
+        value = 20.0f + 200.0f * envelope;
+        break;
+      case 2:
+        value = 128.0f + 100.0f * envelope * sin(kTwoPi * 250.0f * t + c);
+        break;
+      default:
+        value = byte_dist(rng);
+        break;
+    }
+    samples[i] = static_cast<uint8_t>(value);
+  }
+  return samples;
+}
+
+}  // namespace
+
+static void BM_CompressTactorsSamples(benchmark::State& state) {
+  const std::vector<uint8_t> samples = MakeSamples(state.range(0));
+  uint8_t compressed[kMaxCompressedTactorsSamplesSize];
+  int64_t total_size = 0;
+
+  for (auto _ : state) {
+    total_size = 0;
+    for (int i = 0; i < kNumUpdates; ++i) {
+      total_size += CompressTactorsSamples(
+          Slice<const uint8_t, kNumAllTactorsSamples>(
+              samples.data() + i * kNumAllTactorsSamples),
+          Slice<uint8_t, kMaxCompressedTactorsSamplesSize>(compressed));
+      benchmark::DoNotOptimize(compressed);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * kNumUpdates);
+  state.counters["ns_per_update"] = benchmark::Counter(
+      state.iterations() * kNumUpdates,
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  state.counters["compression_ratio"] =
+      static_cast<double>(total_size) / (kNumUpdates * kNumAllTactorsSamples);
+}
+BENCHMARK(BM_CompressTactorsSamples)->DenseRange(0, 3);
+
+static void BM_DecompressTactorsSamples(benchmark::State& state) {
+  const std::vector<uint8_t> samples = MakeSamples(state.range(0));
+  std::vector<uint8_t> compressed(kNumUpdates *
+                                  kMaxCompressedTactorsSamplesSize);
+  std::vector<int> sizes(kNumUpdates);
+  for (int i = 0; i < kNumUpdates; ++i) {
+    sizes[i] = CompressTactorsSamples(
+        Slice<const uint8_t, kNumAllTactorsSamples>(
+            samples.data() + i * kNumAllTactorsSamples),
+        Slice<uint8_t, kMaxCompressedTactorsSamplesSize>(
+            compressed.data() + i * kMaxCompressedTactorsSamplesSize));
+  }
+  uint8_t recovered[kNumAllTactorsSamples];
+
+  for (auto _ : state) {
+    for (int i = 0; i < kNumUpdates; ++i) {
+      benchmark::DoNotOptimize(DecompressTactorsSamples(
+          Slice<const uint8_t>(
+              compressed.data() + i * kMaxCompressedTactorsSamplesSize,
+              sizes[i]),
+          Slice<uint8_t, kNumAllTactorsSamples>(recovered)));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * kNumUpdates);
+  state.counters["ns_per_update"] = benchmark::Counter(
+      state.iterations() * kNumUpdates,
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_DecompressTactorsSamples)->DenseRange(0, 3);
+
+BENCHMARK_MAIN();
@@ -156,18 +156,40 @@ class Resampler:
     """Resets to initial state."""
     self._impl.reset()
 
-  def process_samples(self, samples: np.ndarray) -> np.ndarray:
+  def process_samples(self,
+                      samples: np.ndarray,
+                      out: Optional[np.ndarray] = None) -> np.ndarray:
     """Processes samples in a streaming manner.
 
+    Channels are resampled independently, so a batch of independent streams
+    can be resampled in one call as the channels of a multichannel Resampler.
+    The GIL is released while resampling.
+
     Args:
       samples: 2D numpy array with np.float32 dtype of input samples with
         num_channels columns. The array may be 1D if num_channels = 1.
+      out: (Optional) Writeable C-contiguous np.float32 array or other buffer
+        protocol object to write output to in place, with the same shape as
+        the returned array. Use `next_num_output_frames` to get the number of
+        output frames.
 
     Returns:
       2D numpy array of resampled output. Or if num_channels = 1 and `samples`
-      is 1D, then the output is 1D.
+      is 1D, then the output is 1D. If `out` was passed, it is returned.
+    """
+    return self._impl.process_samples(samples, out)
+
+  def next_num_output_frames(self, num_input_frames: int) -> int:
+    """Number of output frames that process_samples would produce next.
+
+    Args:
+      num_input_frames: Integer, number of input frames.
+
+    Returns:
+      Number of output frames for processing `num_input_frames` frames in the
+      current state.
     """
-    return self._impl.process_samples(samples)
+    return self._impl.next_num_output_frames(num_input_frames)
 
   @property
   def rational_factor(self) -> fractions.Fraction:
@@ -328,6 +328,39 @@ class ResamplerTest(unittest.TestCase):
         np.testing.assert_allclose(streaming, nonstreaming, atol=1e-6,
                                    err_msg=message)
 
+  def test_out(self):
+    """Test Resampler writing to a caller-provided output buffer."""
+    np.random.seed(0)
+    input_samples = np.random.randn(500, 3).astype(np.float32)
+    resampler = dsp.Resampler(16000, 11025, num_channels=3)
+    expected = resampler.process_samples(input_samples)
+
+    resampler.reset()
+    num_output_frames = resampler.next_num_output_frames(len(input_samples))
+    self.assertEqual(num_output_frames, len(expected))
+    out = np.empty((num_output_frames, 3), np.float32)
+    result = resampler.process_samples(input_samples, out=out)
+    self.assertIs(result, out)
+    np.testing.assert_array_equal(out, expected)
+
+    with self.assertRaisesRegex(ValueError, 'out must have shape'):
+      resampler.process_samples(input_samples, out=out)
+    with self.assertRaisesRegex(ValueError, 'float32'):
+      resampler.process_samples(
+          input_samples[:0], out=np.empty((0, 3), np.float64))
+
+  def test_batch_as_channels(self):
+    """Test that channels are resampled as independent streams."""
+    np.random.seed(0)
+    streams = np.random.randn(4, 300).astype(np.float32)
+    batch = dsp.Resampler(16000, 8000, num_channels=len(streams))
+    batch_output = batch.process_samples(streams.T)
+
+    for stream, output in zip(streams, batch_output.T):
+      resampler = dsp.Resampler(16000, 8000)
+      np.testing.assert_allclose(
+          resampler.process_samples(stream), output, atol=1e-6)
+
 
 def make_24_bit_wav(samples, sample_rate_hz):
   """Makes a 24-bit WAV."""
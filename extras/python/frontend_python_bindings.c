@@ -18,7 +18,7 @@
  * These bindings wrap the carl_frontend.c library in frontend as a `frontend`
  * Python module containing a `CarlFrontend` Python class.
  *
- * The interface is as follows. See also carl_frontend_test.py for use example.
+ * The interface is as follows. See also frontend_test.py for use example.
  *
  * class CarlFrontend(object):
  *
@@ -35,12 +35,15 @@
  *                pcen_alpha=0.7,
  *                pcen_beta=0.2,
  *                pcen_gamma=1e-12,
- *                pcen_delta=0.001)
+ *                pcen_delta=0.001,
+ *                num_streams=1)
  *    """Constructor. [Wraps `CarlFrontendMake()` in the C library.]
  *
  *    Args:
  *      The arguments correspond to the CarlFrontendParams in carl_frontend.h in
- *      frontend. See that file for details.
+ *      frontend. See that file for details. Additionally, `num_streams` is the
+ *      number of independent streams to process in a batch. Each stream has
+ *      its own CarlFrontend state.
  *    Raises:
  *      ValueError: if parameters are invalid. (In this case, the C library may
  *        write additional details to stderr.)
@@ -54,18 +57,32 @@
  *  def block_size(self)
  *    """The block_size."""
  *
+ *  @property
+ *  def num_streams(self)
+ *    """Number of independent streams."""
+ *
  *  def reset(self)
  *    """Resets CarlFrontend to initial state. [Wraps `CarlFrontendReset()`.]"""
  *
- *  def process_samples(self, input_samples)
+ *  def process_samples(self, input_samples, out=None)
  *    """Process samples in a streaming manner.
  *
  *    Calls the C function `CarlFrontendProcessSamples()` on each input block.
+ *    The GIL is released while processing, so other Python threads may run,
+ *    but a CarlFrontend object should not be used by two threads at once.
  *
  *    Args:
- *      input_samples: numpy array. NOTE: Size must be a multiple of block_size.
+ *      input_samples: 1-D numpy array of shape (N,) if num_streams is 1, or
+ *        2-D array of shape (num_streams, N), where each row is an independent
+ *        stream. NOTE: N must be a multiple of block_size.
+ *      out: (Optional) Caller-provided output buffer, a writeable C-contiguous
+ *        float32 numpy array or other object supporting the buffer protocol,
+ *        with the shape described below. If given, the output is written to
+ *        it in place rather than to a newly allocated array.
  *    Returns:
- *      2-D array of shape (len(input_samples)/block_size, num_channels).
+ *      Array of shape (N/block_size, num_channels) for 1-D input, or
+ *      (num_streams, N/block_size, num_channels) for 2-D input. If `out` was
+ *      passed, it is returned.
  *    """
  *
  * NOTE: Using a tool like CLIF is generally a better idea than writing bindings
@@ -85,10 +102,12 @@
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include "src/frontend/carl_frontend.h"
 #include "numpy/arrayobject.h"
+#include "extras/python/numpy_util.h"
 
 typedef struct {
   PyObject_HEAD
-  CarlFrontend* frontend;
+  CarlFrontend** frontends;  /* Array of num_streams frontends. */
+  int num_streams;
 } CarlFrontendObject;
 
 /* Define `CarlFrontend.__init__`. */
@@ -108,48 +127,77 @@ static int CarlFrontendObjectInit(CarlFrontendObject* self, PyObject* args,
                                    "pcen_beta",
                                    "pcen_gamma",
                                    "pcen_delta",
+                                   "num_streams",
                                    NULL};
+  int num_streams = 1;
 
   if (!PyArg_ParseTupleAndKeywords(
-          args, kw, "|fifffffffffff:__init__", (char**)keywords,
+          args, kw, "|fifffffffffffi:__init__", (char**)keywords,
           &params.input_sample_rate_hz, &params.block_size,
           &params.highest_pole_frequency_hz, &params.min_pole_frequency_hz,
           &params.step_erbs, &params.envelope_cutoff_hz,
           &params.pcen_time_constant_s, &params.pcen_cross_channel_diffusivity,
           &params.pcen_init_value, &params.pcen_alpha, &params.pcen_beta,
-          &params.pcen_gamma, &params.pcen_delta)) {
+          &params.pcen_gamma, &params.pcen_delta, &num_streams)) {
     return -1;  /* PyArg_ParseTupleAndKeywords failed. */
+  } else if (num_streams < 1) {
+    PyErr_SetString(PyExc_ValueError, "num_streams must be positive");
+    return -1;
   }
 
-  self->frontend = CarlFrontendMake(&params);
-  if (self->frontend == NULL) {
-    PyErr_SetString(PyExc_ValueError, "Error making CarlFrontend");
+  self->frontends =
+      (CarlFrontend**)PyMem_Calloc(num_streams, sizeof(CarlFrontend*));
+  if (self->frontends == NULL) {
+    PyErr_NoMemory();
     return -1;
   }
+  self->num_streams = num_streams;
+  int i;
+  for (i = 0; i < num_streams; ++i) {
+    self->frontends[i] = CarlFrontendMake(&params);
+    if (self->frontends[i] == NULL) {
+      PyErr_SetString(PyExc_ValueError, "Error making CarlFrontend");
+      return -1;
+    }
+  }
   return 0;
 }
 
 static void CarlFrontendDealloc(CarlFrontendObject* self) {
-  CarlFrontendFree(self->frontend);
+  if (self->frontends) {
+    int i;
+    for (i = 0; i < self->num_streams; ++i) {
+      CarlFrontendFree(self->frontends[i]);
+    }
+    PyMem_Free(self->frontends);
+  }
   Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
 /* Define `CarlFrontend.reset()`. */
 static PyObject* CarlFrontendObjectReset(CarlFrontendObject* self,
                                          PyObject* args, PyObject* kw) {
-  CarlFrontendReset(self->frontend);
+  int i;
+  for (i = 0; i < self->num_streams; ++i) {
+    CarlFrontendReset(self->frontends[i]);
+  }
   Py_INCREF(Py_None);
   return (PyObject*)Py_None;
 }
 
 /* Define `CarlFrontend.num_channels` property getter. */
 static PyObject* CarlFrontendObjectNumChannels(CarlFrontendObject* self) {
-  return PyLong_FromLong(CarlFrontendNumChannels(self->frontend));
+  return PyLong_FromLong(CarlFrontendNumChannels(self->frontends[0]));
 }
 
 /* Define `CarlFrontend.block_size` property getter. */
 static PyObject* CarlFrontendObjectBlockSize(CarlFrontendObject* self) {
-  return PyLong_FromLong(CarlFrontendBlockSize(self->frontend));
+  return PyLong_FromLong(CarlFrontendBlockSize(self->frontends[0]));
+}
+
+/* Define `CarlFrontend.num_streams` property getter. */
+static PyObject* CarlFrontendObjectNumStreams(CarlFrontendObject* self) {
+  return PyLong_FromLong(self->num_streams);
 }
 
 /* Define `CarlFrontend.process_samples`. */
@@ -157,10 +205,11 @@ static PyObject* CarlFrontendObjectProcessSamples(CarlFrontendObject* self,
                                                   PyObject* args,
                                                   PyObject* kw) {
   PyObject* samples_arg = NULL;
-  static const char* keywords[] = {"samples", NULL};
+  PyObject* out_arg = NULL;
+  static const char* keywords[] = {"samples", "out", NULL};
 
-  if (!PyArg_ParseTupleAndKeywords(args, kw, "O:process_samples",
-                                   (char**)keywords, &samples_arg)) {
+  if (!PyArg_ParseTupleAndKeywords(args, kw, "O|O:process_samples",
+                                   (char**)keywords, &samples_arg, &out_arg)) {
     return NULL;  /* PyArg_ParseTupleAndKeywords failed. */
   }
 
@@ -177,42 +226,55 @@ static PyObject* CarlFrontendObjectProcessSamples(CarlFrontendObject* self,
   if (!samples) {  /* PyArray_DescrFromType failed. */
     /* PyArray_DescrFromType already set an error, so just need to return. */
     return NULL;
-  } else if (PyArray_NDIM(samples) != 1) {
-    PyErr_SetString(PyExc_ValueError, "expected 1-D array");
+  }
+
+  const int num_streams = self->num_streams;
+  const int ndim = PyArray_NDIM(samples);
+  if (!((ndim == 1 && num_streams == 1) ||
+        (ndim == 2 && PyArray_DIM(samples, 0) == num_streams))) {
+    PyErr_Format(PyExc_ValueError,
+                 "expected 1-D array or 2-D array of shape (%d, N)",
+                 num_streams);
     goto fail;
   }
 
-  const int block_size = CarlFrontendBlockSize(self->frontend);
-  const int num_channels = CarlFrontendNumChannels(self->frontend);
-  const int size = PyArray_SIZE(samples);
+  const int block_size = CarlFrontendBlockSize(self->frontends[0]);
+  const int num_channels = CarlFrontendNumChannels(self->frontends[0]);
+  const int size = PyArray_DIM(samples, ndim - 1);
   if (size % block_size != 0) {
     PyErr_SetString(PyExc_ValueError,
                     "input size must be a multiple of block_size");
     goto fail;
   }
+  const int num_blocks = size / block_size;
 
-  /* Create output numpy array. */
-  npy_intp output_dims[2];
-  output_dims[0] = size / block_size;
-  output_dims[1] = num_channels;
+  /* Get output numpy array, either the caller's `out` or a new array. */
+  npy_intp output_dims[3];
+  output_dims[0] = num_streams;
+  output_dims[1] = num_blocks;
+  output_dims[2] = num_channels;
   PyArrayObject* output =
-      (PyArrayObject*)PyArray_SimpleNew(2, output_dims, NPY_FLOAT);
-  if (!output) {  /* PyArray_SimpleNew failed. */
-    /* PyArray_SimpleNew already set an error, so clean up and return. */
+      GetOutputArray(out_arg, ndim + 1, output_dims + (2 - ndim));
+  if (!output) {  /* GetOutputArray failed. */
+    /* GetOutputArray already set an error, so clean up and return. */
     goto fail;
   }
 
   /* Process the samples. */
   float* samples_data = (float*)PyArray_DATA(samples);
   float* output_data = (float*)PyArray_DATA(output);
+  CarlFrontend** frontends = self->frontends;
 
   /* Release the GIL so that other threads can run while processing. */
   Py_BEGIN_ALLOW_THREADS
-  int i;
-  for (i = 0; i < output_dims[0]; ++i) {
-    CarlFrontendProcessSamples(self->frontend, samples_data, output_data);
-    samples_data += block_size;
-    output_data += num_channels;
+  int stream;
+  for (stream = 0; stream < num_streams; ++stream) {
+    int i;
+    for (i = 0; i < num_blocks; ++i) {
+      CarlFrontendProcessSamples(frontends[stream], samples_data, output_data);
+      samples_data += block_size;
+      output_data += num_channels;
+    }
   }
   Py_END_ALLOW_THREADS
 
@@ -239,6 +301,8 @@ static PyGetSetDef kCarlFrontendGetSetDef[] = {
      "Number of output channels."},
     {"block_size", (getter)CarlFrontendObjectBlockSize, NULL,
      "Input block size."},
+    {"num_streams", (getter)CarlFrontendObjectNumStreams, NULL,
+     "Number of independent streams."},
     {NULL} /* Sentinel */
 };
 
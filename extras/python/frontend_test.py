@@ -0,0 +1,118 @@
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy of
+# the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations under
+# the License.
+
+"""Tests for CarlFrontend Python bindings."""
+
+import threading
+import unittest
+
+import numpy as np
+
+from extras.python import frontend
+
+
+class CarlFrontendTest(unittest.TestCase):
+
+  def test_streaming(self):
+    np.random.seed(0)
+    input_samples = np.random.uniform(-0.1, 0.1, 20 * 64).astype(np.float32)
+    carl = frontend.CarlFrontend(block_size=64)
+    self.assertEqual(carl.num_streams, 1)
+
+    nonstreaming_outputs = carl.process_samples(input_samples)
+    self.assertEqual(nonstreaming_outputs.shape, (20, carl.num_channels))
+    self.assertTrue(np.all(np.isfinite(nonstreaming_outputs)))
+
+    carl.reset()
+    streaming_outputs = np.vstack([
+        carl.process_samples(input_block)
+        for input_block in input_samples.reshape(4, -1)])
+    np.testing.assert_array_equal(streaming_outputs, nonstreaming_outputs)
+
+  def test_out(self):
+    np.random.seed(0)
+    input_samples = np.random.uniform(-0.1, 0.1, 10 * 64).astype(np.float32)
+    carl = frontend.CarlFrontend(block_size=64)
+    expected = carl.process_samples(input_samples)
+
+    carl.reset()
+    out = np.empty((10, carl.num_channels), np.float32)
+    result = carl.process_samples(input_samples, out=out)
+    self.assertIs(result, out)
+    np.testing.assert_array_equal(out, expected)
+
+    # Any writeable buffer protocol object of the right shape may be used.
+    carl.reset()
+    buffer = bytearray(out.nbytes)
+    carl.process_samples(
+        input_samples, out=memoryview(buffer).cast('f', out.shape))
+    np.testing.assert_array_equal(
+        np.frombuffer(buffer, np.float32).reshape(out.shape), expected)
+
+    with self.assertRaisesRegex(ValueError, 'out must have shape'):
+      carl.process_samples(input_samples, out=np.empty((9, carl.num_channels),
+                                                       np.float32))
+    with self.assertRaisesRegex(ValueError, 'float32'):
+      carl.process_samples(input_samples, out=np.empty(out.shape))
+    with self.assertRaisesRegex(ValueError, 'C-contiguous'):
+      carl.process_samples(input_samples, out=np.empty(out.shape[::-1],
+                                                       np.float32).T)
+    with self.assertRaises(TypeError):
+      carl.process_samples(input_samples, out=[0.0] * out.size)
+
+  def test_batch(self):
+    np.random.seed(0)
+    num_streams = 3
+    input_samples = np.random.uniform(
+        -0.1, 0.1, (num_streams, 10 * 64)).astype(np.float32)
+    carl = frontend.CarlFrontend(block_size=64, num_streams=num_streams)
+    self.assertEqual(carl.num_streams, num_streams)
+
+    outputs = carl.process_samples(input_samples)
+    self.assertEqual(outputs.shape, (num_streams, 10, carl.num_channels))
+    # Each stream matches processing it alone.
+    for stream in range(num_streams):
+      single = frontend.CarlFrontend(block_size=64)
+      np.testing.assert_array_equal(
+          outputs[stream], single.process_samples(input_samples[stream]))
+
+    with self.assertRaisesRegex(ValueError, r'shape \(3, N\)'):
+      carl.process_samples(input_samples[0])
+    with self.assertRaisesRegex(ValueError, 'num_streams must be positive'):
+      frontend.CarlFrontend(num_streams=0)
+
+  def test_threads(self):
+    np.random.seed(0)
+    input_samples = np.random.uniform(-0.1, 0.1, 50 * 64).astype(np.float32)
+    expected = frontend.CarlFrontend(block_size=64).process_samples(
+        input_samples)
+    outputs = [None] * 4
+
+    def _worker(i):
+      # Each thread uses its own CarlFrontend.
+      outputs[i] = frontend.CarlFrontend(block_size=64).process_samples(
+          input_samples)
+
+    threads = [threading.Thread(target=_worker, args=(i,))
+               for i in range(len(outputs))]
+    for thread in threads:
+      thread.start()
+    for thread in threads:
+      thread.join()
+    for output in outputs:
+      np.testing.assert_array_equal(output, expected)
+
+
+if __name__ == '__main__':
+  unittest.main()
@@ -0,0 +1,73 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Numpy utilities shared by the Python bindings.
+ *
+ * NOTE: Functions are `static`, so that each extension module gets its own
+ * copy using its own numpy C API table from import_array().
+ */
+
+#ifndef AUDIO_TO_TACTILE_EXTRAS_PYTHON_NUMPY_UTIL_H_
+#define AUDIO_TO_TACTILE_EXTRAS_PYTHON_NUMPY_UTIL_H_
+
+#include "Python.h"
+/* Disallow Numpy 1.7 deprecated symbols. */
+#ifndef NPY_NO_DEPRECATED_API
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#endif
+#include "numpy/arrayobject.h"
+
+/* Gets the array to write output to, of shape `dims`. If `out_arg` is NULL or
+ * None, a new array is allocated. Otherwise `out_arg` is a caller-provided
+ * buffer, which must be a writeable C-contiguous float32 array or buffer
+ * protocol object of shape `dims`. It is then used in place without copying.
+ * Returns a new reference, or NULL with an exception set on failure.
+ */
+static PyArrayObject* GetOutputArray(PyObject* out_arg, int ndim,
+                                     npy_intp* dims) {
+  if (out_arg == NULL || out_arg == Py_None) {
+    return (PyArrayObject*)PyArray_SimpleNew(ndim, dims, NPY_FLOAT);
+  } else if (!PyArray_Check(out_arg) && !PyObject_CheckBuffer(out_arg)) {
+    PyErr_SetString(PyExc_TypeError, "out must support the buffer protocol");
+    return NULL;
+  }
+
+  /* With no dtype or requirements, PyArray_FromAny views out_arg's memory. */
+  PyArrayObject* out =
+      (PyArrayObject*)PyArray_FromAny(out_arg, NULL, 0, 0, 0, NULL);
+  if (!out) {
+    return NULL;
+  } else if (PyArray_TYPE(out) != NPY_FLOAT || !PyArray_ISNOTSWAPPED(out) ||
+             !PyArray_ISCARRAY(out)) {
+    PyErr_SetString(PyExc_ValueError,
+                    "out must be a writeable C-contiguous float32 array");
+    goto fail;
+  } else if (PyArray_NDIM(out) != ndim ||
+             !PyArray_CompareLists(PyArray_DIMS(out), dims, ndim)) {
+    PyObject* shape = PyArray_IntTupleFromIntp(ndim, dims);
+    if (shape) {
+      PyErr_Format(PyExc_ValueError, "out must have shape %R", shape);
+      Py_DECREF(shape);
+    }
+    goto fail;
+  }
+  return out;
+
+fail:
+  Py_DECREF(out);
+  return NULL;
+}
+
+#endif /* AUDIO_TO_TACTILE_EXTRAS_PYTHON_NUMPY_UTIL_H_ */
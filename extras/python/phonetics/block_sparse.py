@@ -0,0 +1,195 @@
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy of
+# the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations under
+# the License.
+
+"""Block-sparse pruning of dense layer weights.
+
+Weights of a dense layer are a matrix of shape [in_size, out_size]. Each column
+is partitioned into blocks of `block_size` consecutive inputs, and pruning
+zeros the blocks of smallest L2 norm. This matches the BlockSparseMatrix
+storage in src/phonetics/nn_ops.h, where format_block_sparse_c_data() produces
+C tables to initialize a BlockSparseMatrix.
+
+Typical use is to prune a trained model, fine tune it while holding the pruned
+blocks at zero, then export:
+
+  masks = block_sparse.block_prune_masks(params, sparsity, block_size, names)
+  params = block_sparse.apply_masks(params, masks)
+  # Fine tune, calling `params = block_sparse.apply_masks(params, masks)` after
+  # each update, e.g. with phone_model.train_model(post_update_fn=...).
+"""
+
+import textwrap
+from typing import Any, Dict, Iterable, List, Mapping
+
+import numpy as np
+
+# Max number of blocks, since BlockSparseMatrix indexes blocks with uint16_t.
+_MAX_BLOCKS = 0xffff
+
+_MAX_WIDTH = 80  # C output is wrapped to _MAX_WIDTH chars.
+
+
+def block_norms(w: np.ndarray, block_size: int) -> np.ndarray:
+  """Computes L2 norms of the block_size x 1 blocks of `w`.
+
+  Args:
+    w: 2D array of shape [in_size, out_size]. in_size must be a multiple of
+      block_size.
+    block_size: Integer, block size.
+  Returns:
+    Array of shape [in_size // block_size, out_size].
+  """
+  w = np.asarray(w)
+  if w.ndim != 2 or w.shape[0] % block_size != 0:
+    raise ValueError(f'Shape {w.shape} is not 2D with first dim a multiple of '
+                     f'block_size={block_size}')
+  blocks = w.reshape(w.shape[0] // block_size, block_size, w.shape[1])
+  return np.sqrt(np.sum(blocks.astype(np.float64)**2, axis=1))
+
+
+def block_prune_mask(w: np.ndarray,
+                     sparsity: float,
+                     block_size: int) -> np.ndarray:
+  """Makes a mask that zeros a `sparsity` fraction of the blocks of `w`.
+
+  The blocks with smallest L2 norm are pruned.
+
+  Args:
+    w: 2D array of shape [in_size, out_size].
+    sparsity: Float between 0 and 1, fraction of blocks to prune.
+    block_size: Integer, block size.
+  Returns:
+    Float array of the same shape as `w`, 0 in pruned blocks and 1 elsewhere.
+  """
+  if not 0.0 <= sparsity <= 1.0:
+    raise ValueError(f'sparsity must be between 0 and 1, got {sparsity}')
+  norms = block_norms(w, block_size)
+  num_pruned = int(sparsity * norms.size)
+  keep = np.ones(norms.size, dtype=bool)
+  keep[np.argsort(norms, axis=None, kind='stable')[:num_pruned]] = False
+  keep = keep.reshape(norms.shape)
+  return np.repeat(keep, block_size, axis=0).astype(np.asarray(w).dtype)
+
+
+def block_prune_masks(params: Mapping[str, Mapping[str, Any]],
+                      sparsity: float,
+                      block_size: int,
+                      module_names: Iterable[str]) -> Dict[str, np.ndarray]:
+  """Makes block prune masks for the 'w' weights of several modules.
+
+  Args:
+    params: Model params, e.g. hk.Params, a two-level mapping from module name
+      and param name to array.
+    sparsity: Float, fraction of blocks to prune in each module.
+    block_size: Integer, block size.
+    module_names: Names of the modules to prune.
+  Returns:
+    Dict of masks, keyed by module name.
+  """
+  return {name: block_prune_mask(params[name]['w'], sparsity, block_size)
+          for name in module_names}
+
+
+def apply_masks(params: Mapping[str, Mapping[str, Any]],
+                masks: Mapping[str, np.ndarray]) -> Dict[str, Dict[str, Any]]:
+  """Multiplies the 'w' weights of masked modules by their masks.
+
+  This is the fine-tuning hook: calling it after each optimizer update keeps
+  pruned blocks at zero. It works on numpy and jax arrays alike.
+
+  Args:
+    params: Model params.
+    masks: Dict of masks, as returned by block_prune_masks().
+  Returns:
+    New params with masks applied.
+  """
+  out = {}
+  for name, module in params.items():
+    module = dict(module)
+    if name in masks:
+      module['w'] = module['w'] * masks[name]
+    out[name] = module
+  return out
+
+
+def to_block_sparse(w: np.ndarray, block_size: int):
+  """Converts 2D weights to BlockSparseMatrix tables, dropping zero blocks.
+
+  Args:
+    w: 2D array of shape [in_size, out_size].
+    block_size: Integer, block size.
+  Returns:
+    (col_start, block_row, values) 3-tuple of 1D arrays, as documented for
+    BlockSparseMatrix in src/phonetics/nn_ops.h.
+  """
+  w = np.asarray(w)
+  nonzero = block_norms(w, block_size) > 0.0
+  if np.count_nonzero(nonzero) > _MAX_BLOCKS:
+    raise ValueError('Too many nonzero blocks')
+
+  col_start = [0]
+  block_row = []
+  values = []
+  for j in range(w.shape[1]):
+    for r in np.flatnonzero(nonzero[:, j]):
+      block_row.append(r)
+      values.append(w[r * block_size:(r + 1) * block_size, j])
+    col_start.append(len(block_row))
+
+  values = (np.concatenate(values) if values
+            else np.zeros(0, dtype=w.dtype))
+  return (np.array(col_start, dtype=np.uint16),
+          np.array(block_row, dtype=np.uint16),
+          values)
+
+
+def _format_c_definition(c_type: str, name: str, values: np.ndarray) -> str:
+  """Formats a 1D array as a wrapped C array definition."""
+  if c_type == 'float':
+    elements = ', '.join(f'{x:.6}f' for x in values)
+  else:
+    elements = ', '.join(str(int(x)) for x in values)
+  return textwrap.fill(
+      f'static const {c_type} {name}[{len(values)}] = {{{elements}}};',
+      _MAX_WIDTH, subsequent_indent='    ') + '\n'
+
+
+def format_block_sparse_c_data(name: str,
+                               w: np.ndarray,
+                               block_size: int) -> List[str]:
+  """Formats 2D weights as C tables and a BlockSparseMatrix.
+
+  For name = 'kFooWeights', this produces C definitions
+
+    static const uint16_t kFooWeightsColStart[...] = {...};
+    static const uint16_t kFooWeightsBlockRow[...] = {...};
+    static const float kFooWeightsValues[...] = {...};
+    static const BlockSparseMatrix kFooWeights = {...};
+
+  Args:
+    name: String, C name.
+    w: 2D array of shape [in_size, out_size].
+    block_size: Integer, block size.
+  Returns:
+    List of strings, one per C definition.
+  """
+  col_start, block_row, values = to_block_sparse(w, block_size)
+  in_size, out_size = np.asarray(w).shape
+  return [
+      _format_c_definition('uint16_t', name + 'ColStart', col_start),
+      _format_c_definition('uint16_t', name + 'BlockRow', block_row),
+      _format_c_definition('float', name + 'Values', values),
+      f'static const BlockSparseMatrix {name} = {{{in_size}, {out_size}, '
+      f'{block_size},\n    {name}ColStart, {name}BlockRow, {name}Values}};\n',
+  ]
@@ -0,0 +1,96 @@
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy of
+# the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations under
+# the License.
+
+"""Tests for block_sparse.py."""
+
+import unittest
+import numpy as np
+
+from extras.python.phonetics import block_sparse
+
+
+class BlockSparseTest(unittest.TestCase):
+
+  def test_block_prune_mask(self):
+    """Blocks with smallest norm are pruned, whole blocks at a time."""
+    np.random.seed(0)
+    w = np.random.randn(12, 5).astype(np.float32)
+    w[4:8, 2] *= 1e-3  # Make one block clearly smallest.
+
+    mask = block_sparse.block_prune_mask(w, sparsity=0.1, block_size=4)
+
+    self.assertEqual(mask.shape, w.shape)
+    # Mask is constant over each 4x1 block.
+    blocks = mask.reshape(3, 4, 5)
+    np.testing.assert_array_equal(blocks.min(axis=1), blocks.max(axis=1))
+    # 10% of 15 blocks = 1 block is pruned, which should be the small block.
+    self.assertEqual(np.sum(mask == 0), 4)
+    np.testing.assert_array_equal(mask[4:8, 2], 0)
+
+    with self.assertRaises(ValueError):
+      block_sparse.block_prune_mask(w, sparsity=0.5, block_size=5)
+
+  def test_apply_masks(self):
+    """apply_masks zeros pruned weights and leaves other params alone."""
+    np.random.seed(0)
+    params = {'linear': {'w': np.random.randn(8, 3), 'b': np.ones(3)},
+              'linear_1': {'w': np.random.randn(3, 2), 'b': np.ones(2)}}
+    masks = block_sparse.block_prune_masks(params, 0.5, 4, ['linear'])
+
+    pruned = block_sparse.apply_masks(params, masks)
+
+    np.testing.assert_array_equal(pruned['linear']['w'],
+                                  params['linear']['w'] * masks['linear'])
+    self.assertEqual(np.sum(masks['linear'] == 0), 12)
+    np.testing.assert_array_equal(pruned['linear']['b'], params['linear']['b'])
+    np.testing.assert_array_equal(pruned['linear_1']['w'],
+                                  params['linear_1']['w'])
+
+  def test_to_block_sparse(self):
+    """Sparse tables reproduce the dense matrix product."""
+    np.random.seed(0)
+    for block_size in (1, 4, 8):
+      w = np.random.randn(16, 6)
+      w *= block_sparse.block_prune_mask(w, 0.6, block_size)
+      x = np.random.randn(16)
+
+      col_start, block_row, values = block_sparse.to_block_sparse(
+          w, block_size)
+
+      self.assertEqual(len(col_start), 7)
+      self.assertEqual(len(values), block_size * len(block_row))
+      self.assertEqual(len(block_row), np.sum(w != 0) // block_size)
+      y = np.zeros(6)
+      for j in range(6):
+        for b in range(col_start[j], col_start[j + 1]):
+          k = block_row[b] * block_size
+          y[j] += np.dot(x[k:k + block_size],
+                         values[b * block_size:(b + 1) * block_size])
+      np.testing.assert_allclose(y, x.dot(w), atol=1e-12)
+
+  def test_format_block_sparse_c_data(self):
+    w = np.zeros((8, 2), np.float32)
+    w[4:8, 0] = [1.0, 2.0, 3.0, 4.0]
+
+    c_data = ''.join(block_sparse.format_block_sparse_c_data('kFoo', w, 4))
+
+    self.assertIn('static const uint16_t kFooColStart[3] = {0, 1, 1};', c_data)
+    self.assertIn('static const uint16_t kFooBlockRow[1] = {1};', c_data)
+    self.assertIn(
+        'static const float kFooValues[4] = {1.0f, 2.0f, 3.0f, 4.0f};', c_data)
+    self.assertIn('static const BlockSparseMatrix kFoo = {8, 2, 4,', c_data)
+
+
+if __name__ == '__main__':
+  unittest.main()
@@ -82,8 +82,33 @@
  *    }
  *   """
  *
+ * def classify_phoneme_scores_batch(frames, out=None):
+ *   """Gets scores for all windows of a batch of streams as an array.
+ *   [Wraps `ClassifyPhonemeBatch()` in the C library.]
+ *
+ *   Each window of NUM_FRAMES consecutive frames is classified, as by
+ *   classify_phoneme_scores(). The GIL is released while classifying.
+ *
+ *   Args:
+ *     frames: 2D array of shape [num_frames, NUM_CHANNELS] for one stream, or
+ *       3D array of shape [num_streams, num_frames, NUM_CHANNELS] for a batch
+ *       of independent streams, with num_frames >= NUM_FRAMES.
+ *     out: (Optional) Caller-provided output buffer, a writeable C-contiguous
+ *       float32 numpy array or other object supporting the buffer protocol,
+ *       with the shape described below. If given, scores are written to it in
+ *       place rather than to a newly allocated array.
+ *   Returns:
+ *     Array of shape [num_outputs, NUM_SCORES] for 2D input or
+ *     [num_streams, num_outputs, NUM_SCORES] for 3D input, where
+ *     num_outputs = num_frames - NUM_FRAMES + 1. Output t classifies the
+ *     window starting at frame t. Columns are named by SCORE_NAMES.
+ *   """
+ *
  * The expected number of frames and CARL channels are exposed as a module
- * constants `NUM_FRAMES` and `NUM_CHANNELS`.
+ * constants `NUM_FRAMES` and `NUM_CHANNELS`. The number of score columns is
+ * `NUM_SCORES`, and `SCORE_NAMES` lists their names: "phoneme:aa", etc. for
+ * phoneme scores, then "manner:nasal", etc., "place:front", etc., "vad",
+ * "vowel", "diphthong", "lax_vowel", and "voiced".
  *
  * NOTE: Using a tool like CLIF is generally a better idea than writing bindings
  * manually. We do it here anyway since as open sourced code it matters that it
@@ -103,10 +128,15 @@
 /* Disallow Numpy 1.7 deprecated symbols. */
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include "numpy/arrayobject.h"
+#include "extras/python/numpy_util.h"
 #include "src/phonetics/classify_phoneme.h"
 
 #define NUM_FRAMES kClassifyPhonemeNumFrames
 #define NUM_CHANNELS kClassifyPhonemeNumChannels
+#define NUM_SCORES (kClassifyPhonemeNumPhonemes + kClassifyPhonemeNumManners \
+                    + kClassifyPhonemeNumPlaces + 5)
+/* Number of windows that classify_phoneme_scores_batch() classifies at once. */
+#define kBatchChunkSize 256
 
 /* Convert input arg to numpy array with contiguous float32 data. The caller
  * must call Py_XDECREF on the returned object to release memory.
@@ -218,7 +248,9 @@ static PyObject* ClassifyPhonemeLabelsPython(
 
   const float* frames_data = (const float*)PyArray_DATA(frames);
   ClassifyPhonemeLabels labels;
+  Py_BEGIN_ALLOW_THREADS
   ClassifyPhoneme(frames_data, &labels, NULL);
+  Py_END_ALLOW_THREADS
   Py_DECREF(frames);
 
   PyObject* dict = PyDict_New();
@@ -259,7 +291,9 @@ static PyObject* ClassifyPhonemeScoresPython(
 
   const float* frames_data = (const float*)PyArray_DATA(frames);
   ClassifyPhonemeScores scores;
+  Py_BEGIN_ALLOW_THREADS
   ClassifyPhoneme(frames_data, NULL, &scores);
+  Py_END_ALLOW_THREADS
   Py_DECREF(frames);
 
   PyObject* dict = PyDict_New();
@@ -282,12 +316,119 @@ static PyObject* ClassifyPhonemeScoresPython(
   return dict;
 }
 
+/* Writes `scores` as a row of NUM_SCORES floats in SCORE_NAMES order. */
+static void FlattenScores(const ClassifyPhonemeScores* scores, float* row) {
+  memcpy(row, scores->phoneme, sizeof(scores->phoneme));
+  row += kClassifyPhonemeNumPhonemes;
+  memcpy(row, scores->manner, sizeof(scores->manner));
+  row += kClassifyPhonemeNumManners;
+  memcpy(row, scores->place, sizeof(scores->place));
+  row += kClassifyPhonemeNumPlaces;
+  row[0] = scores->vad;
+  row[1] = scores->vowel;
+  row[2] = scores->diphthong;
+  row[3] = scores->lax_vowel;
+  row[4] = scores->voiced;
+}
+
+/* Define `classify_phoneme_scores_batch()`. */
+static PyObject* ClassifyPhonemeScoresBatchPython(
+    PyObject* dummy, PyObject* args, PyObject* kw) {
+  PyObject* frames_arg;
+  PyObject* out_arg = NULL;
+  static const char* keywords[] = {"frames", "out", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, kw,
+                                   "O|O:classify_phoneme_scores_batch",
+                                   (char**)keywords, &frames_arg, &out_arg)) {
+    return NULL;  /* PyArg_ParseTupleAndKeywords failed. */
+  }
+
+  ClassifyPhonemeScores* scores = NULL;
+  PyArrayObject* output = NULL;
+  PyArrayObject* frames = (PyArrayObject*)PyArray_FromAny(
+      frames_arg, PyArray_DescrFromType(NPY_FLOAT), 0, 0,
+      NPY_ARRAY_ALIGNED | NPY_ARRAY_NOTSWAPPED | NPY_ARRAY_FORCECAST |
+          NPY_ARRAY_DEFAULT,
+      NULL);
+  if (!frames) {  /* PyArray_DescrFromType failed. */
+    /* PyArray_DescrFromType already set an error, so just need to return. */
+    return NULL;
+  }
+
+  const int ndim = PyArray_NDIM(frames);
+  if (!(ndim == 2 || ndim == 3) ||
+      PyArray_DIM(frames, ndim - 1) != NUM_CHANNELS ||
+      PyArray_DIM(frames, ndim - 2) < NUM_FRAMES) {
+    PyErr_Format(PyExc_ValueError,
+        "input must be a 2D or 3D array of shape ([num_streams,] num_frames, "
+        "%d) with num_frames >= %d", NUM_CHANNELS, NUM_FRAMES);
+    goto fail;
+  }
+  const int num_streams = (ndim == 3) ? PyArray_DIM(frames, 0) : 1;
+  const int num_frames = PyArray_DIM(frames, ndim - 2);
+  const int num_outputs = num_frames - NUM_FRAMES + 1;
+
+  /* Get output numpy array, either the caller's `out` or a new array. */
+  npy_intp output_dims[3];
+  output_dims[0] = num_streams;
+  output_dims[1] = num_outputs;
+  output_dims[2] = NUM_SCORES;
+  output = GetOutputArray(out_arg, ndim, output_dims + (3 - ndim));
+  if (!output) {  /* GetOutputArray failed. */
+    goto fail;
+  }
+  scores = (ClassifyPhonemeScores*)PyMem_Malloc(
+      kBatchChunkSize * sizeof(ClassifyPhonemeScores));
+  if (!scores) {
+    PyErr_NoMemory();
+    goto fail;
+  }
+
+  const float* frames_data = (const float*)PyArray_DATA(frames);
+  float* output_data = (float*)PyArray_DATA(output);
+
+  /* Release the GIL so that other threads can run while processing. */
+  Py_BEGIN_ALLOW_THREADS
+  int stream;
+  for (stream = 0; stream < num_streams; ++stream) {
+    int start;
+    for (start = 0; start < num_outputs; start += kBatchChunkSize) {
+      int chunk_size = num_outputs - start;
+      if (chunk_size > kBatchChunkSize) { chunk_size = kBatchChunkSize; }
+      ClassifyPhonemeBatch(frames_data + start * NUM_CHANNELS, chunk_size,
+                           NULL, scores);
+      int i;
+      for (i = 0; i < chunk_size; ++i) {
+        FlattenScores(&scores[i], output_data);
+        output_data += NUM_SCORES;
+      }
+    }
+    frames_data += num_frames * NUM_CHANNELS;
+  }
+  Py_END_ALLOW_THREADS
+
+  PyMem_Free(scores);
+  Py_DECREF(frames);
+  return (PyObject*)output;
+
+fail:
+  PyMem_Free(scores);
+  Py_XDECREF(output);
+  Py_DECREF(frames);
+  return NULL;
+}
+
 /* Module methods. */
 static PyMethodDef kModuleMethods[] = {
     {"classify_phoneme_labels", (PyCFunction)ClassifyPhonemeLabelsPython,
       METH_VARARGS | METH_KEYWORDS, "Gets phoneme classification labels."},
     {"classify_phoneme_scores", (PyCFunction)ClassifyPhonemeScoresPython,
       METH_VARARGS | METH_KEYWORDS, "Gets phoneme classification scores."},
+    {"classify_phoneme_scores_batch",
+      (PyCFunction)ClassifyPhonemeScoresBatchPython,
+      METH_VARARGS | METH_KEYWORDS,
+      "Gets phoneme classification scores for a batch of windows."},
     {NULL, NULL, 0, NULL} /* Sentinel */
 };
 
@@ -319,6 +460,38 @@ static PyObject* MakeListOfStrings(const char** names, int size) {
   return list;
 }
 
+/* Makes the list of score names for classify_phoneme_scores_batch(). */
+static PyObject* MakeScoreNames(void) {
+  static const char* kOtherScoreNames[5] = {
+      "vad", "vowel", "diphthong", "lax_vowel", "voiced"};
+  PyObject* list = PyList_New(0);
+  if (!list) { return NULL; }
+  int i;
+  for (i = 0; i < NUM_SCORES; ++i) {
+    int j = i;
+    PyObject* name;
+    if (j < kClassifyPhonemeNumPhonemes) {
+      name = PyUnicode_FromFormat(
+          "phoneme:%s", kClassifyPhonemePhonemeNames[j]);
+    } else if ((j -= kClassifyPhonemeNumPhonemes) <
+               kClassifyPhonemeNumManners) {
+      name = PyUnicode_FromFormat("manner:%s", kClassifyPhonemeMannerNames[j]);
+    } else if ((j -= kClassifyPhonemeNumManners) < kClassifyPhonemeNumPlaces) {
+      name = PyUnicode_FromFormat("place:%s", kClassifyPhonemePlaceNames[j]);
+    } else {
+      name = PyUnicode_FromString(
+          kOtherScoreNames[j - kClassifyPhonemeNumPlaces]);
+    }
+    if (!name || PyList_Append(list, name)) {
+      Py_XDECREF(name);
+      Py_DECREF(list);
+      return NULL;
+    }
+    Py_DECREF(name);
+  }
+  return list;
+}
+
 static void InitModule(PyObject* m) {
   /* Make `NUM_FRAMES` module int constant. */
   PyModule_AddIntMacro(m, NUM_FRAMES);
@@ -342,6 +515,12 @@ static void InitModule(PyObject* m) {
                                        kClassifyPhonemeNumPlaces);
   if (!places) { return; }
   PyModule_AddObject(m, "PLACES", places);
+
+  /* Make `NUM_SCORES` module int constant and `SCORE_NAMES` name list. */
+  PyModule_AddIntMacro(m, NUM_SCORES);
+  PyObject* score_names = MakeScoreNames();
+  if (!score_names) { return; }
+  PyModule_AddObject(m, "SCORE_NAMES", score_names);
 }
 
 PyMODINIT_FUNC PyInit_classify_phoneme(void) {
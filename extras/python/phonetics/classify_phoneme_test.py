@@ -95,6 +95,47 @@ class ClassifyPhonemeTest(unittest.TestCase):
       score_argmax = max(scores['phoneme'], key=scores['phoneme'].get)
       self.assertEqual(labels['phoneme'], score_argmax)
 
+  def test_scores_batch(self):
+    np.random.seed(0)
+    num_streams = 2
+    num_frames = classify_phoneme.NUM_FRAMES + 300
+    frames = np.random.rand(num_streams, num_frames,
+                            classify_phoneme.NUM_CHANNELS).astype(np.float32)
+    num_outputs = num_frames - classify_phoneme.NUM_FRAMES + 1
+
+    scores = classify_phoneme.classify_phoneme_scores_batch(frames)
+    self.assertEqual(scores.shape,
+                     (num_streams, num_outputs, classify_phoneme.NUM_SCORES))
+    self.assertEqual(len(classify_phoneme.SCORE_NAMES),
+                     classify_phoneme.NUM_SCORES)
+    column = {name: i for i, name in enumerate(classify_phoneme.SCORE_NAMES)}
+
+    # Windows match classify_phoneme_scores().
+    for stream, t in [(0, 0), (0, 299), (1, 5), (1, num_outputs - 1)]:
+      window = frames[stream, t:t + classify_phoneme.NUM_FRAMES]
+      expected = classify_phoneme.classify_phoneme_scores(window)
+      for phoneme in classify_phoneme.PHONEMES:
+        self.assertAlmostEqual(scores[stream, t, column['phoneme:' + phoneme]],
+                               expected['phoneme'][phoneme], delta=1e-5)
+      for manner in classify_phoneme.MANNERS:
+        self.assertAlmostEqual(scores[stream, t, column['manner:' + manner]],
+                               expected['manner'][manner], delta=1e-5)
+      for key in ('vad', 'vowel', 'diphthong', 'lax_vowel', 'voiced'):
+        self.assertAlmostEqual(scores[stream, t, column[key]], expected[key],
+                               delta=1e-5)
+
+    # A single stream may be passed as a 2D array, and output may be written
+    # to a caller-provided buffer.
+    out = np.empty((num_outputs, classify_phoneme.NUM_SCORES), np.float32)
+    result = classify_phoneme.classify_phoneme_scores_batch(frames[1], out=out)
+    self.assertIs(result, out)
+    np.testing.assert_allclose(out, scores[1], atol=1e-6)
+
+    with self.assertRaisesRegex(ValueError, 'out must have shape'):
+      classify_phoneme.classify_phoneme_scores_batch(frames, out=out)
+    with self.assertRaisesRegex(ValueError, 'num_frames >='):
+      classify_phoneme.classify_phoneme_scores_batch(frames[:, :2])
+
 
 if __name__ == '__main__':
   unittest.main()
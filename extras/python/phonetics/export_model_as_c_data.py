@@ -24,15 +24,28 @@ NOTE: This program does not convert model behavior to C; only the parameter data
 is exported. It is up to the user to understand the model architecture and
 parameter meanings. This may yet help in writing C implementations for inference
 on device.
+
+Optionally, dense layer weights may be block pruned with --sparsity. The blocks
+of smallest L2 norm are zeroed, the model is optionally fine tuned with
+--fine_tune_npz holding the pruned blocks at zero, and pruned weights are
+exported as BlockSparseMatrix tables (see src/phonetics/nn_ops.h) for use with
+SparseDenseReluLayer:
+
+  static const uint16_t kLinearWColStart[...] = {...};
+  static const uint16_t kLinearWBlockRow[...] = {...};
+  static const float kLinearWValues[...] = {...};
+  static const BlockSparseMatrix kLinearW = {...};
 """
 
+import dataclasses
 import textwrap
-from typing import Iterable
+from typing import Dict, Iterable, Optional, Sequence, Tuple
 
 from absl import app
 from absl import flags
 import numpy as np
 
+from extras.python.phonetics import block_sparse
 from extras.python.phonetics import hk_util
 from extras.python.phonetics import phone_model
 
@@ -42,6 +55,24 @@ flags.DEFINE_string('model', None, '[REQUIRED] Model params .pkl file.')
 
 flags.DEFINE_string('output', '/tmp/params.h', 'Output C file.')
 
+flags.DEFINE_float('sparsity', 0.0,
+                   'Fraction of weight blocks to prune in each sparse module. '
+                   'With the default of 0, all weights are exported as dense.')
+
+flags.DEFINE_integer('sparse_block_size', 4,
+                     'Block size for pruning. Sizes 4 and 8 have fast kernels.')
+
+flags.DEFINE_list('sparse_modules', None,
+                  'Modules to prune, e.g. "linear,linear_1". By default, '
+                  'all modules with weights whose input size is a multiple of '
+                  '--sparse_block_size are pruned.')
+
+flags.DEFINE_string('fine_tune_npz', None,
+                    '(Optional) Training data .npz file. If specified, the '
+                    'pruned model is fine tuned on this data.')
+
+flags.DEFINE_integer('fine_tune_epochs', 5, 'Number of fine-tuning epochs.')
+
 MAX_WIDTH = 80  # Output is wrapped to MAX_WIDTH chars.
 
 
@@ -55,36 +86,110 @@ def format_c_array(v: Iterable[float]) -> str:
   return '{' + ', '.join([f'{x:.6}f' for x in v]) + '}'
 
 
-def export_model_as_c_data(model_file: str, output_file: str) -> None:
+def prune_model(model: hk_util.TrainedModel,
+                sparsity: float,
+                block_size: int,
+                module_names: Optional[Sequence[str]] = None,
+                fine_tune_npz: Optional[str] = None,
+                fine_tune_epochs: int = 5
+                ) -> Tuple[hk_util.TrainedModel, Dict[str, np.ndarray]]:
+  """Block prunes a model and optionally fine tunes it.
+
+  Args:
+    model: TrainedModel.
+    sparsity: Float, fraction of blocks to prune in each module.
+    block_size: Integer, block size.
+    module_names: Names of modules to prune. If None, all modules with 2D
+      weights "w" whose input size is a multiple of block_size are pruned.
+    fine_tune_npz: (Optional) String, training data .npz file.
+    fine_tune_epochs: Integer, number of fine-tuning epochs.
+  Returns:
+    (model, masks) 2-tuple of the pruned TrainedModel and dict of prune masks
+    keyed by module name.
+  """
+  if module_names is None:
+    module_names = [name for name, module in model.params.items()
+                    if 'w' in module and np.ndim(module['w']) == 2
+                    and np.shape(module['w'])[0] % block_size == 0]
+
+  masks = block_sparse.block_prune_masks(
+      model.params, sparsity, block_size, module_names)
+  params = block_sparse.apply_masks(model.params, masks)
+
+  if fine_tune_npz:
+    meta = dataclasses.replace(model.meta, num_epochs=fine_tune_epochs)
+    dataset = phone_model.load_dataset(fine_tune_npz, meta.classes)
+    print(f'\nFine tuning pruned model for {fine_tune_epochs} epochs:')
+    model = phone_model.train_model(
+        meta, dataset, init_params=params,
+        post_update_fn=lambda p: block_sparse.apply_masks(p, masks))
+    params = block_sparse.apply_masks(model.params, masks)
+
+  model = hk_util.TrainedModel(model.model_object, meta=model.meta,
+                               params=params)
+  return model, masks
+
+
+def export_model_as_c_data(model_file: str,
+                           output_file: str,
+                           sparsity: float = 0.0,
+                           block_size: int = 4,
+                           sparse_modules: Optional[Sequence[str]] = None,
+                           fine_tune_npz: Optional[str] = None,
+                           fine_tune_epochs: int = 5) -> None:
   """Export model as C data.
 
   Args:
     model_file: String, model params pickle file.
     output_file: String, output C file to write.
+    sparsity: Float, fraction of blocks to prune. If 0, no pruning is done.
+    block_size: Integer, block size for pruning.
+    sparse_modules: Names of modules to prune, or None for the default.
+    fine_tune_npz: (Optional) String, training data for fine tuning.
+    fine_tune_epochs: Integer, number of fine-tuning epochs.
   """
   model = hk_util.TrainedModel.load(
       model_file, phone_model.model_fun, phone_model.Metadata)
 
+  sparse_names = set()
+  if sparsity > 0.0:
+    model, masks = prune_model(model, sparsity, block_size, sparse_modules,
+                               fine_tune_npz, fine_tune_epochs)
+    sparse_names = {name + '.w' for name in masks}
+
   s = []
   print('\nModel parameters:')
   print('  %-20s %-12s %s' % ('name', 'dtype', 'shape'))
   for name, array in hk_util.params_as_list(model.params):
-    name = 'k' + snake_case_to_camel(name.replace('.', '_'))
+    c_name = 'k' + snake_case_to_camel(name.replace('.', '_'))
     array = np.asarray(array)
-    print('  %-20s %-12s %s' % (name, array.dtype, array.shape))
+    print('  %-20s %-12s %s' % (c_name, array.dtype, array.shape))
+    if name in sparse_names:
+      s.extend(block_sparse.format_block_sparse_c_data(
+          c_name, array, block_size))
+      continue
     size = ' * '.join(map(str, array.shape))
     s.append(textwrap.fill(
-        f'static const float {name}[{size}] = '
+        f'static const float {c_name}[{size}] = '
         + format_c_array(array.flatten(order='F')) + ';',
         MAX_WIDTH, subsequent_indent='    ') + '\n')
 
+  header = '/* Model parameters. */\n\n'
+  if sparse_names:
+    header += ('/* Sparse weights use BlockSparseMatrix from '
+               'src/phonetics/nn_ops.h. */\n\n')
   with open(output_file, 'wt') as f:
-    f.write('/* Model parameters. */\n\n' + '\n'.join(s))
+    f.write(header + '\n'.join(s))
   print('Exported to ' + output_file)
 
 
 def main(_):
-  export_model_as_c_data(FLAGS.model, FLAGS.output)
+  export_model_as_c_data(FLAGS.model, FLAGS.output,
+                         sparsity=FLAGS.sparsity,
+                         block_size=FLAGS.sparse_block_size,
+                         sparse_modules=FLAGS.sparse_modules,
+                         fine_tune_npz=FLAGS.fine_tune_npz,
+                         fine_tune_epochs=FLAGS.fine_tune_epochs)
 
 
 if __name__ == '__main__':
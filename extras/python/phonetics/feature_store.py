@@ -0,0 +1,198 @@
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy of
+# the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations under
+# the License.
+
+"""Zero-copy reader of feature stores.
+
+A feature store is a chunked, memory-mappable file of labeled feature frames,
+written by the native extractor extras/tools/extract_carl_features.c. See
+extras/tools/feature_store.h for the format. The file is memory mapped, and
+features and labels are returned as read-only numpy views into the mapping, so
+nothing is copied or decompressed up front and a dataset larger than RAM can be
+streamed, e.g.
+
+  store = feature_store.FeatureStore('timit_train.feat')
+  for utterance in store:
+    # utterance.features has shape (num_frames, store.num_channels).
+    # utterance.labels has shape (num_frames,), indices into store.label_names.
+    ...
+
+write_feature_store() writes the same format from numpy arrays, e.g. to convert
+an existing dataset.
+"""
+
+import collections
+import struct
+from typing import Dict, Iterable, Iterator, List, Tuple
+
+import numpy as np
+
+_MAGIC = b'FEAT'
+_VERSION = 1
+_HEADER_SIZE = 64
+_CHUNK_ALIGNMENT = 64
+
+# Header fields after the magic: version, num_channels, frame_rate_hz,
+# num_utterances, num_labels, num_frames, index_offset.
+_HEADER_STRUCT = struct.Struct('<4sIIfIIQQ')
+
+_UTTERANCE_RECORD_DTYPE = np.dtype([
+    ('features_offset', '<u8'),
+    ('labels_offset', '<u8'),
+    ('num_frames', '<u8'),
+    ('name_offset', '<u4'),
+    ('name_length', '<u4'),
+])
+_LABEL_RECORD_DTYPE = np.dtype([
+    ('name_offset', '<u4'),
+    ('name_length', '<u4'),
+])
+
+Utterance = collections.namedtuple('Utterance', ['name', 'features', 'labels'])
+
+
+class FeatureStore:
+  """Memory-mapped feature store."""
+
+  def __init__(self, filename: str):
+    self._mapping = np.memmap(filename, dtype=np.uint8, mode='r')
+    if len(self._mapping) < _HEADER_SIZE:
+      raise ValueError(f'{filename} is not a feature store')
+    (magic, version, self.num_channels, self.frame_rate_hz, num_utterances,
+     num_labels, self.num_frames, index_offset) = _HEADER_STRUCT.unpack_from(
+         self._mapping[:_HEADER_STRUCT.size].tobytes())
+    if magic != _MAGIC:
+      raise ValueError(f'{filename} is not a feature store')
+    elif version != _VERSION:
+      raise ValueError(f'Unsupported feature store version {version}')
+
+    labels_start = (index_offset +
+                    num_utterances * _UTTERANCE_RECORD_DTYPE.itemsize)
+    strings_start = labels_start + num_labels * _LABEL_RECORD_DTYPE.itemsize
+    if strings_start > len(self._mapping):
+      raise ValueError(f'{filename} is truncated')
+    self._records = np.ndarray(
+        (num_utterances,), _UTTERANCE_RECORD_DTYPE, self._mapping,
+        index_offset)
+    label_records = np.ndarray(
+        (num_labels,), _LABEL_RECORD_DTYPE, self._mapping, labels_start)
+    strings = self._mapping[strings_start:].tobytes()
+
+    def _get_strings(records: np.ndarray) -> List[str]:
+      return [strings[offset:offset + length].decode('utf-8')
+              for offset, length in zip(records['name_offset'].tolist(),
+                                        records['name_length'].tolist())]
+
+    self.names = _get_strings(self._records)
+    self.label_names = _get_strings(label_records)
+    if np.any(self._records['features_offset'] +
+              4 * self.num_channels * self._records['num_frames'] >
+              index_offset) or np.any(
+                  self._records['labels_offset'] +
+                  2 * self._records['num_frames'] > index_offset):
+      raise ValueError(f'{filename} has an invalid index')
+
+  def __len__(self) -> int:
+    return len(self._records)
+
+  def __getitem__(self, i: int) -> Utterance:
+    return Utterance(self.names[i], self.features(i), self.labels(i))
+
+  def __iter__(self) -> Iterator[Utterance]:
+    for i in range(len(self)):
+      yield self[i]
+
+  def features(self, i: int) -> np.ndarray:
+    """Gets utterance i's features, a view of shape (num_frames, num_channels).
+    """
+    record = self._records[i]
+    return np.ndarray((int(record['num_frames']), self.num_channels),
+                      np.dtype('<f4'), self._mapping,
+                      int(record['features_offset']))
+
+  def labels(self, i: int) -> np.ndarray:
+    """Gets utterance i's labels, a view of shape (num_frames,)."""
+    record = self._records[i]
+    return np.ndarray((int(record['num_frames']),), np.dtype('<u2'),
+                      self._mapping, int(record['labels_offset']))
+
+  def label_counts(self) -> Dict[str, int]:
+    """Counts frames for each label over the whole store."""
+    counts = np.zeros(len(self.label_names), np.int64)
+    for i in range(len(self)):
+      counts += np.bincount(self.labels(i), minlength=len(counts))
+    return dict(zip(self.label_names, counts.tolist()))
+
+
+def write_feature_store(filename: str,
+                        utterances: Iterable[Tuple[str, np.ndarray,
+                                                   Iterable[str]]],
+                        frame_rate_hz: float) -> None:
+  """Writes a feature store.
+
+  Args:
+    filename: String, output filename.
+    utterances: Iterable of (name, features, labels) tuples, where `features`
+      is a 2D array of shape (num_frames, num_channels) and `labels` is a
+      sequence of num_frames label strings. The empty string means unlabeled.
+    frame_rate_hz: Float, frame rate in Hz.
+  """
+  label_index = {'': 0}
+  records = []
+  num_channels = None
+  num_frames = 0
+  with open(filename, 'wb') as f:
+    f.write(bytes(_HEADER_SIZE))
+    for name, features, labels in utterances:
+      features = np.asarray(features, np.dtype('<f4'))
+      if num_channels is None:
+        num_channels = features.shape[1]
+      if features.ndim != 2 or features.shape[1] != num_channels:
+        raise ValueError(f'Features for {name} have shape {features.shape}, '
+                         f'expected (num_frames, {num_channels})')
+      labels = np.array([label_index.setdefault(label, len(label_index))
+                         for label in labels], np.dtype('<u2'))
+      if len(labels) != len(features):
+        raise ValueError(f'Got {len(labels)} labels for {len(features)} '
+                         f'frames in {name}')
+      f.write(bytes(-f.tell() % _CHUNK_ALIGNMENT))
+      features_offset = f.tell()
+      f.write(features.tobytes())
+      f.write(bytes(-f.tell() % _CHUNK_ALIGNMENT))
+      labels_offset = f.tell()
+      f.write(labels.tobytes())
+      records.append((features_offset, labels_offset, len(features), name))
+      num_frames += len(features)
+
+    f.write(bytes(-f.tell() % 8))
+    index_offset = f.tell()
+    label_names = sorted(label_index, key=label_index.get)
+    strings = [name.encode('utf-8') for _, _, _, name in records] + [
+        label.encode('utf-8') for label in label_names]
+    string_offsets = np.cumsum([0] + [len(s) for s in strings])
+    index = np.zeros(len(records), _UTTERANCE_RECORD_DTYPE)
+    for i, (features_offset, labels_offset, n, _) in enumerate(records):
+      index[i] = (features_offset, labels_offset, n, string_offsets[i],
+                  len(strings[i]))
+    label_records = np.zeros(len(label_names), _LABEL_RECORD_DTYPE)
+    for i in range(len(label_names)):
+      j = len(records) + i
+      label_records[i] = (string_offsets[j], len(strings[j]))
+    f.write(index.tobytes())
+    f.write(label_records.tobytes())
+    f.write(b''.join(strings))
+
+    f.seek(0)
+    f.write(_HEADER_STRUCT.pack(_MAGIC, _VERSION, num_channels or 1,
+                                frame_rate_hz, len(records), len(label_names),
+                                num_frames, index_offset))
@@ -0,0 +1,90 @@
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License. You may obtain a copy of
+# the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+# License for the specific language governing permissions and limitations under
+# the License.
+
+"""Tests for feature_store."""
+
+import os
+import tempfile
+import unittest
+
+import numpy as np
+
+from extras.python.phonetics import feature_store
+
+
+class FeatureStoreTest(unittest.TestCase):
+
+  def setUp(self):
+    super().setUp()
+    self.filename = os.path.join(tempfile.mkdtemp(), 'test.feat')
+
+  def test_round_trip(self):
+    np.random.seed(0)
+    utterances = []
+    for i in range(5):
+      num_frames = 17 * i  # Includes an empty utterance.
+      features = np.random.randn(num_frames, 3).astype(np.float32)
+      labels = [('aa', 'iy', '')[(i + j) % 3] for j in range(num_frames)]
+      utterances.append((f'utterance{i}.wav', features, labels))
+    feature_store.write_feature_store(self.filename, utterances, 125.0)
+
+    store = feature_store.FeatureStore(self.filename)
+    self.assertEqual(len(store), 5)
+    self.assertEqual(store.num_channels, 3)
+    self.assertEqual(store.frame_rate_hz, 125.0)
+    self.assertEqual(store.num_frames, 17 * (0 + 1 + 2 + 3 + 4))
+    self.assertEqual(store.label_names[0], '')
+    self.assertCountEqual(store.label_names, ['', 'aa', 'iy'])
+
+    for (name, features, labels), utterance in zip(utterances, store):
+      self.assertEqual(utterance.name, name)
+      np.testing.assert_array_equal(utterance.features, features)
+      self.assertEqual([store.label_names[k] for k in utterance.labels],
+                       labels)
+
+    counts = store.label_counts()
+    self.assertEqual(sum(counts.values()), store.num_frames)
+    self.assertEqual(
+        counts['aa'],
+        sum(labels.count('aa') for _, _, labels in utterances))
+
+  def test_views_are_zero_copy(self):
+    features = np.arange(40, dtype=np.float32).reshape(10, 4)
+    feature_store.write_feature_store(
+        self.filename, [('a', features, ['x'] * 10)], 100.0)
+
+    store = feature_store.FeatureStore(self.filename)
+    view = store.features(0)
+    # The view points into the mapping rather than owning a copy.
+    self.assertFalse(view.flags.owndata)
+    self.assertFalse(view.flags.writeable)
+    self.assertEqual(view.ctypes.data % 64, 0)
+    np.testing.assert_array_equal(view, features)
+
+  def test_invalid(self):
+    with open(self.filename, 'wb') as f:
+      f.write(b'not a feature store' * 4)
+    with self.assertRaises(ValueError):
+      feature_store.FeatureStore(self.filename)
+
+    feature_store.write_feature_store(
+        self.filename, [('a', np.zeros((10, 2)), [''] * 10)], 100.0)
+    with open(self.filename, 'r+b') as f:
+      f.truncate(100)
+    with self.assertRaises(ValueError):
+      feature_store.FeatureStore(self.filename)
+
+
+if __name__ == '__main__':
+  unittest.main()
@@ -27,6 +27,12 @@ row gives the segment start and end indices and phonetic label, e.g.
 
 labels samples [0, 1502) as 'sil' (silence), [1502, 2492) as 'ae', and
 [2492, 4000) as 'sil'.
+
+For large corpora, extras/tools/extract_carl_features.c is a native parallel
+alternative for the feature computation. It writes a memory-mappable feature
+store with a label per frame, read as zero-copy numpy arrays with
+extras/python/phonetics/feature_store.py, so that training can stream data
+larger than RAM.
 """
 
 import collections
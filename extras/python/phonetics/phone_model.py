@@ -19,7 +19,7 @@ import functools
 import os
 import os.path
 import random
-from typing import Any, Dict, Mapping, Optional, Sequence, Tuple
+from typing import Any, Callable, Dict, Mapping, Optional, Sequence, Tuple
 
 from absl import flags
 import dataclasses
@@ -254,9 +254,24 @@ def model_fun(batch, meta: Metadata) -> Dict[str, jnp.ndarray]:
           'penalties': penalties}
 
 
-def train_model(meta: Metadata,
-                dataset: phone_util.Dataset) -> hk_util.TrainedModel:
-  """Train the model."""
+def train_model(
+    meta: Metadata,
+    dataset: phone_util.Dataset,
+    init_params: Optional[hk.Params] = None,
+    post_update_fn: Optional[Callable[[hk.Params], hk.Params]] = None,
+) -> hk_util.TrainedModel:
+  """Train the model.
+
+  Args:
+    meta: Metadata.
+    dataset: Training dataset.
+    init_params: (Optional) Params to start training from, e.g. to fine tune a
+      trained model. If None, params are randomly initialized.
+    post_update_fn: (Optional) Function applied to params after each update,
+      e.g. block_sparse.apply_masks to keep pruned weights at zero.
+  Returns:
+    TrainedModel.
+  """
   model = hk_util.transform(functools.partial(model_fun, meta=meta))
 
   # Split off a separate validation dataset.
@@ -281,9 +296,12 @@ def train_model(meta: Metadata,
   v_eval_batch = {'observed': v_eval_x[0], 'label': v_eval_y[0]}
 
   # Initialize network and optimizer.
-  seed = np.uint64(random.getrandbits(64))
-  params = model.init(jax.random.PRNGKey(seed),
-                      {'observed': train_x[0], 'label': train_y[0]})
+  if init_params is None:
+    seed = np.uint64(random.getrandbits(64))
+    params = model.init(jax.random.PRNGKey(seed),
+                        {'observed': train_x[0], 'label': train_y[0]})
+  else:
+    params = init_params
   optimizer = optax.adam(1e-3)
   opt_state = optimizer.init(params)
 
@@ -332,6 +350,8 @@ def train_model(meta: Metadata,
               f'{train_accuracy:.4f}, val acc = {val_accuracy:.4f}')
 
       params, opt_state = train_step(params, opt_state, train_batch)
+      if post_update_fn is not None:
+        params = post_update_fn(params)
 
   return hk_util.TrainedModel(model, meta=meta, params=params)
 
@@ -19,8 +19,15 @@
  * `q_resampler_python_bindings` Python module containing a `ResamplerImpl`
  * class and a `KernelImpl` class.
  *
- * The Python library q_resampler.py wraps these bindings to give a nicer
- * interface and type annotations.
+ * The Python library dsp.py wraps these bindings to give a nicer interface and
+ * type annotations.
+ *
+ * `ResamplerImpl.process_samples(samples, out=None)` releases the GIL while
+ * resampling. Channels are resampled independently, so a batch of independent
+ * streams may be processed in one call as channels of a multichannel
+ * resampler. If `out` is passed, it must be a writeable C-contiguous float32
+ * numpy array or other buffer protocol object of the output shape, and output
+ * is written to it in place instead of to a newly allocated array.
  *
  * NOTE: Using a tool like CLIF is generally a better idea than writing bindings
  * manually. We do it here anyway since as open sourced code it matters that it
@@ -38,6 +45,7 @@
 /* Disallow Numpy 1.7 deprecated symbols. */
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include "numpy/arrayobject.h"
+#include "extras/python/numpy_util.h"
 #include "structmember.h"
 #include "src/dsp/q_resampler.h"
 #include "src/dsp/q_resampler_kernel.h"
@@ -115,11 +123,14 @@ static PyObject* ResamplerImplObjectReset(ResamplerImplObject* self) {
 static PyObject* ResamplerImplObjectProcessSamples(
     ResamplerImplObject* self, PyObject* args, PyObject* kw) {
   PyObject* samples_arg = NULL;
-  static const char* keywords[] = {"samples", NULL};
+  PyObject* out_arg = NULL;
+  static const char* keywords[] = {"samples", "out", NULL};
 
-  /* "O:process_samples" => parse a single required arg as a PyObject. */
-  if (!PyArg_ParseTupleAndKeywords(args, kw, "O:process_samples",
-                                   (char**)keywords, &samples_arg)) {
+  /* "O|O:process_samples" => parse a required arg and an optional arg as
+   * PyObjects.
+   */
+  if (!PyArg_ParseTupleAndKeywords(args, kw, "O|O:process_samples",
+                                   (char**)keywords, &samples_arg, &out_arg)) {
     return NULL; /* PyArg_ParseTupleAndKeywords failed. */
   }
 
@@ -148,14 +159,14 @@ static PyObject* ResamplerImplObjectProcessSamples(
 
   const int num_input_frames = PyArray_DIM(samples, 0);
 
-  /* Create output numpy array. */
+  /* Get output numpy array, either the caller's `out` or a new array. */
   npy_intp output_dims[2];
   output_dims[0] = QResamplerNextNumOutputFrames(resampler, num_input_frames);
   output_dims[1] = num_channels;
-  PyArrayObject* output = (PyArrayObject*)PyArray_SimpleNew(
-      PyArray_NDIM(samples), output_dims, NPY_FLOAT);
-  if (!output) { /* PyArray_SimpleNew failed. */
-    /* PyArray_SimpleNew already set an error, so clean up and return. */
+  PyArrayObject* output =
+      GetOutputArray(out_arg, PyArray_NDIM(samples), output_dims);
+  if (!output) { /* GetOutputArray failed. */
+    /* GetOutputArray already set an error, so clean up and return. */
     goto fail;
   }
 
@@ -163,6 +174,9 @@ static PyObject* ResamplerImplObjectProcessSamples(
   const int max_input_frames = QResamplerMaxInputFrames(resampler);
   const float* samples_data = (const float*)PyArray_DATA(samples);
   float* output_data = (float*)PyArray_DATA(output);
+
+  /* Release the GIL so that other threads can run while processing. */
+  Py_BEGIN_ALLOW_THREADS
   int start;
   for (start = 0; start < num_input_frames; start += max_input_frames) {
     int block_input_frames = num_input_frames - start;
@@ -176,6 +190,7 @@ static PyObject* ResamplerImplObjectProcessSamples(
            sizeof(float) * block_output_frames * num_channels);
     output_data += block_output_frames * num_channels;
   }
+  Py_END_ALLOW_THREADS
 
   Py_DECREF(samples);
   return (PyObject*)output;
@@ -185,6 +200,17 @@ fail: /* If something went wrong above, we jump here and clean up. */
   return NULL;
 }
 
+/* Define `ResamplerImpl.next_num_output_frames`. */
+static PyObject* ResamplerImplObjectNextNumOutputFrames(
+    ResamplerImplObject* self, PyObject* args) {
+  int num_input_frames;
+  if (!PyArg_ParseTuple(args, "i:next_num_output_frames", &num_input_frames)) {
+    return NULL;
+  }
+  return Py_BuildValue("i", QResamplerNextNumOutputFrames(self->resampler,
+                                                          num_input_frames));
+}
+
 /* Define `ResamplerImpl.rational_factor` property getter. */
 static PyObject* ResamplerImplObjectRationalFactor(ResamplerImplObject* self) {
   int factor_numerator;
@@ -210,6 +236,9 @@ static PyMethodDef kResamplerImplMethods[] = {
      "Resets to initial state."},
     {"process_samples", (PyCFunction)ResamplerImplObjectProcessSamples,
      METH_VARARGS | METH_KEYWORDS, "Processes samples in a streaming manner."},
+    {"next_num_output_frames",
+     (PyCFunction)ResamplerImplObjectNextNumOutputFrames, METH_VARARGS,
+     "Number of output frames for the next process_samples call."},
     {NULL} /* Sentinel */
 };
 
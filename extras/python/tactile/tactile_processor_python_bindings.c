@@ -29,15 +29,21 @@
  *                input_sample_rate_hz=16000.0,
  *                block_size=16,
  *                decimation_factor=1,
- *                cutoff_hz=500.0)
+ *                cutoff_hz=500.0,
+ *                vowel_hop=1,
+ *                num_streams=1)
  *    """Constructor. [Wraps `TactileProcessorMake()` in the C library.]
  *
  *    Args:
  *      input_sample_rate_hz: Float, input audio sample rate in Hz.
- *      block_size: Integer, input block size. Must be a power of two.
+ *      block_size: Integer, input block size. Must be a multiple of
+ *        decimation_factor. Power-of-two sizes are cheapest.
  *      decimation_factor: Integer, decimation factor after computing the energy
  *        envelope.
  *      cutoff_hz: Float, cutoff in Hz for energy smoothing filters.
+ *      vowel_hop: Integer, number of blocks between vowel embedding updates.
+ *      num_streams: Integer, number of independent streams to process in a
+ *        batch. Each stream has its own TactileProcessor state.
  *    Raises:
  *      ValueError: if parameters are invalid. (In this case, the C library may
  *        write additional details to stderr.)
@@ -46,17 +52,26 @@
  *  def reset():
  *    """Resets to initial state."""
  *
- *  def process_samples(self, input_samples)
+ *  def process_samples(self, input_samples, out=None)
  *    """Process samples in a streaming manner.
  *
  *    Calls the C function `TactileProcessorProcessSamples()` on each input
- *    audio block.
+ *    audio block. The GIL is released while processing, so other Python
+ *    threads may run, but a TactileProcessor object should not be used by two
+ *    threads at once.
  *
  *    Args:
- *      input_samples: 1-D numpy array. Size must be a multiple of block_size.
+ *      input_samples: 1-D numpy array of shape (N,) if num_streams is 1, or
+ *        2-D array of shape (num_streams, N), where each row is an independent
+ *        stream. N must be a multiple of block_size.
+ *      out: (Optional) Caller-provided output buffer, a writeable C-contiguous
+ *        float32 numpy array or other object supporting the buffer protocol,
+ *        with the shape described below. If given, the output is written to
+ *        it in place rather than to a newly allocated array.
  *    Returns:
- *      2-D array of shape
- *        (len(input_samples) * decimation_factor / block_size, NUM_TACTORS).
+ *      Array of shape (N / decimation_factor, NUM_TACTORS) for 1-D input, or
+ *      (num_streams, N / decimation_factor, NUM_TACTORS) for 2-D input. If
+ *      `out` was passed, it is returned.
  *    """
  *
  *  @property
@@ -75,6 +90,10 @@
  *  def decimation_factor(self)
  *    """Decimation factor between input and output."""
  *
+ *  @property
+ *  def num_streams(self)
+ *    """Number of independent streams."""
+ *
  * NOTE: Using a tool like CLIF is generally a better idea than writing bindings
  * manually. We do it here anyway since as open sourced code it matters that it
  * is easy for others to build. Also, we use numpy, which CLIF does not natively
@@ -92,15 +111,17 @@
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include "src/tactile/tactile_processor.h"
 #include "numpy/arrayobject.h"
+#include "extras/python/numpy_util.h"
 #include "structmember.h"
 
 typedef struct {
   PyObject_HEAD
-  TactileProcessor* tactile_processor;
+  TactileProcessor** tactile_processors;  /* Array of num_streams processors. */
   float input_sample_rate_hz;
   float output_sample_rate_hz;
   int block_size;
   int decimation_factor;
+  int num_streams;
 } TactileProcessorObject;
 
 /* Define `TactileProcessor.__init__`. */
@@ -112,22 +133,40 @@ static int TactileProcessorObjectInit(TactileProcessorObject* self,
                                    "block_size",
                                    "decimation_factor",
                                    "cutoff_hz",
+                                   "vowel_hop",
+                                   "num_streams",
                                    NULL};
+  int num_streams = 1;
 
   if (!PyArg_ParseTupleAndKeywords(
-          args, kw, "|fiif:__init__", (char**)keywords,
+          args, kw, "|fiifii:__init__", (char**)keywords,
           &params.frontend_params.input_sample_rate_hz,
           &params.frontend_params.block_size,
           &params.decimation_factor,
-          &params.enveloper_params.energy_cutoff_hz)) {
+          &params.enveloper_params.energy_cutoff_hz,
+          &params.vowel_hop,
+          &num_streams)) {
     return -1;  /* PyArg_ParseTupleAndKeywords failed. */
+  } else if (num_streams < 1) {
+    PyErr_SetString(PyExc_ValueError, "num_streams must be positive");
+    return -1;
   }
 
-  self->tactile_processor = TactileProcessorMake(&params);
-  if (self->tactile_processor == NULL) {
-    PyErr_SetString(PyExc_ValueError, "Error making TactileProcessor");
+  self->tactile_processors = (TactileProcessor**)PyMem_Calloc(
+      num_streams, sizeof(TactileProcessor*));
+  if (self->tactile_processors == NULL) {
+    PyErr_NoMemory();
     return -1;
   }
+  self->num_streams = num_streams;
+  int i;
+  for (i = 0; i < num_streams; ++i) {
+    self->tactile_processors[i] = TactileProcessorMake(&params);
+    if (self->tactile_processors[i] == NULL) {
+      PyErr_SetString(PyExc_ValueError, "Error making TactileProcessor");
+      return -1;
+    }
+  }
   self->input_sample_rate_hz = params.frontend_params.input_sample_rate_hz;
   self->output_sample_rate_hz =
       params.frontend_params.input_sample_rate_hz / params.decimation_factor;
@@ -137,13 +176,22 @@ static int TactileProcessorObjectInit(TactileProcessorObject* self,
 }
 
 static void TactileProcessorDealloc(TactileProcessorObject* self) {
-  TactileProcessorFree(self->tactile_processor);
+  if (self->tactile_processors) {
+    int i;
+    for (i = 0; i < self->num_streams; ++i) {
+      TactileProcessorFree(self->tactile_processors[i]);
+    }
+    PyMem_Free(self->tactile_processors);
+  }
   Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
 /* Define `TactileProcessor.reset`. */
 static PyObject* TactileProcessorObjectReset(TactileProcessorObject* self) {
-  TactileProcessorReset(self->tactile_processor);
+  int i;
+  for (i = 0; i < self->num_streams; ++i) {
+    TactileProcessorReset(self->tactile_processors[i]);
+  }
   Py_INCREF(Py_None);
   return Py_None;
 }
@@ -152,10 +200,11 @@ static PyObject* TactileProcessorObjectReset(TactileProcessorObject* self) {
 static PyObject* TactileProcessorObjectProcessSamples(
     TactileProcessorObject* self, PyObject* args, PyObject* kw) {
   PyObject* samples_arg = NULL;
-  static const char* keywords[] = {"samples", NULL};
+  PyObject* out_arg = NULL;
+  static const char* keywords[] = {"samples", "out", NULL};
 
-  if (!PyArg_ParseTupleAndKeywords(args, kw, "O:process_samples",
-                                   (char**)keywords, &samples_arg)) {
+  if (!PyArg_ParseTupleAndKeywords(args, kw, "O|O:process_samples",
+                                   (char**)keywords, &samples_arg, &out_arg)) {
     return NULL;  /* PyArg_ParseTupleAndKeywords failed. */
   }
 
@@ -169,14 +218,21 @@ static PyObject* TactileProcessorObjectProcessSamples(
   if (!samples) {  /* PyArray_DescrFromType failed. */
     /* PyArray_DescrFromType already set an error, so just need to return. */
     return NULL;
-  } else if (PyArray_NDIM(samples) != 1) {
-    PyErr_SetString(PyExc_ValueError, "expected 1-D array");
+  }
+
+  const int num_streams = self->num_streams;
+  const int ndim = PyArray_NDIM(samples);
+  if (!((ndim == 1 && num_streams == 1) ||
+        (ndim == 2 && PyArray_DIM(samples, 0) == num_streams))) {
+    PyErr_Format(PyExc_ValueError,
+                 "expected 1-D array or 2-D array of shape (%d, N)",
+                 num_streams);
     goto fail;
   }
 
   const int block_size = self->block_size;
   const int decimation_factor = self->decimation_factor;
-  const int size = PyArray_SIZE(samples);
+  const int size = PyArray_DIM(samples, ndim - 1);
   if (size % block_size != 0) {
     PyErr_SetString(PyExc_ValueError,
                     "input size must be a multiple of block_size");
@@ -185,26 +241,36 @@ static PyObject* TactileProcessorObjectProcessSamples(
   const int tactile_samples_per_block =
       kTactileProcessorNumTactors * (block_size / decimation_factor);
 
-  /* Create output numpy array. */
-  npy_intp output_dims[2];
-  output_dims[0] = size / decimation_factor;
-  output_dims[1] = kTactileProcessorNumTactors;
+  /* Get output numpy array, either the caller's `out` or a new array. */
+  npy_intp output_dims[3];
+  output_dims[0] = num_streams;
+  output_dims[1] = size / decimation_factor;
+  output_dims[2] = kTactileProcessorNumTactors;
   PyArrayObject* output =
-      (PyArrayObject*)PyArray_SimpleNew(2, output_dims, NPY_FLOAT);
-  if (!output) {  /* PyArray_SimpleNew failed. */
-    /* PyArray_SimpleNew already set an error, so clean up and return. */
+      GetOutputArray(out_arg, ndim + 1, output_dims + (2 - ndim));
+  if (!output) {  /* GetOutputArray failed. */
+    /* GetOutputArray already set an error, so clean up and return. */
     goto fail;
   }
 
   /* Process the samples. */
   float* samples_data = (float*)PyArray_DATA(samples);
   float* output_data = (float*)PyArray_DATA(output);
-  int start;
-  for (start = 0; start < size; start += block_size) {
-    TactileProcessorProcessSamples(self->tactile_processor,
-        samples_data + start, output_data);
-    output_data += tactile_samples_per_block;
+  TactileProcessor** tactile_processors = self->tactile_processors;
+
+  /* Release the GIL so that other threads can run while processing. */
+  Py_BEGIN_ALLOW_THREADS
+  int stream;
+  for (stream = 0; stream < num_streams; ++stream) {
+    int start;
+    for (start = 0; start < size; start += block_size) {
+      TactileProcessorProcessSamples(tactile_processors[stream],
+          samples_data + start, output_data);
+      output_data += tactile_samples_per_block;
+    }
+    samples_data += size;
   }
+  Py_END_ALLOW_THREADS
 
   Py_DECREF(samples);
   return (PyObject*)output;
@@ -233,6 +299,8 @@ static PyMemberDef kTactileProcessorMembers[] = {
    offsetof(TactileProcessorObject, block_size), READONLY, ""},
   {"decimation_factor", T_INT,
    offsetof(TactileProcessorObject, decimation_factor), READONLY, ""},
+  {"num_streams", T_INT,
+   offsetof(TactileProcessorObject, num_streams), READONLY, ""},
   {NULL}  /* Sentinel. */
 };
 
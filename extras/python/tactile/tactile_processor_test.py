@@ -14,6 +14,7 @@
 
 """Tests for TactileProcessor Python bindings."""
 
+import threading
 import unittest
 
 import numpy as np
@@ -90,6 +91,66 @@ class TactileProcessorTest(unittest.TestCase):
     np.testing.assert_allclose(
         streaming_outputs, nonstreaming_outputs, atol=1e-9)
 
+  def test_out(self):
+    np.random.seed(0)
+    input_samples = np.random.uniform(-0.1, 0.1, 8 * 16).astype(np.float32)
+    processor = tactile_processor.TactileProcessor(decimation_factor=2)
+    expected = processor.process_samples(input_samples)
+
+    processor.reset()
+    out = np.empty((len(input_samples) // 2, tactile_processor.NUM_TACTORS),
+                   np.float32)
+    result = processor.process_samples(input_samples, out=out)
+    self.assertIs(result, out)
+    np.testing.assert_array_equal(out, expected)
+
+    with self.assertRaisesRegex(ValueError, 'out must have shape'):
+      processor.process_samples(input_samples, out=out[:-1])
+    with self.assertRaisesRegex(ValueError, 'float32'):
+      processor.process_samples(input_samples, out=out.astype(np.float64))
+
+  def test_batch(self):
+    np.random.seed(0)
+    num_streams = 3
+    input_samples = np.random.uniform(
+        -0.1, 0.1, (num_streams, 8 * 16)).astype(np.float32)
+    processor = tactile_processor.TactileProcessor(
+        decimation_factor=4, num_streams=num_streams)
+    self.assertEqual(processor.num_streams, num_streams)
+
+    outputs = processor.process_samples(input_samples)
+    self.assertEqual(outputs.shape, (num_streams, input_samples.shape[1] // 4,
+                                     tactile_processor.NUM_TACTORS))
+    # Each stream matches processing it alone.
+    for stream in range(num_streams):
+      single = tactile_processor.TactileProcessor(decimation_factor=4)
+      np.testing.assert_array_equal(
+          outputs[stream], single.process_samples(input_samples[stream]))
+
+    with self.assertRaisesRegex(ValueError, r'shape \(3, N\)'):
+      processor.process_samples(input_samples[:2])
+
+  def test_threads(self):
+    np.random.seed(0)
+    input_samples = np.random.uniform(-0.1, 0.1, 100 * 16).astype(np.float32)
+    expected = tactile_processor.TactileProcessor().process_samples(
+        input_samples)
+    outputs = [None] * 4
+
+    def _worker(i):
+      # Each thread uses its own TactileProcessor.
+      processor = tactile_processor.TactileProcessor()
+      outputs[i] = processor.process_samples(input_samples)
+
+    threads = [threading.Thread(target=_worker, args=(i,))
+               for i in range(len(outputs))]
+    for thread in threads:
+      thread.start()
+    for thread in threads:
+      thread.join()
+    for output in outputs:
+      np.testing.assert_array_equal(output, expected)
+
   def test_bad_input(self):
     processor = tactile_processor.TactileProcessor()
 
@@ -81,6 +81,7 @@
 #include "look_up.h"
 #include "post_processor_cpp.h"
 #include "dsp/channel_map.h"
+#include "dsp/convert_sample.h"
 #include "tactile/tactile_pattern.h"
 #include "tactile_processor_cpp.h"
 #include "two_wire.h"
@@ -191,11 +192,17 @@ void OnPwmSequenceEnd() {
 
 void HandleMessage(const Message& message) {
   switch (message.type()) {
-    case MessageType::kAudioSamples: {
+    case MessageType::kAudioSamples:
+    case MessageType::kAdpcmAudioSamples: {
       g_receiving_audio = true;
       g_streaming_tactile_playback = false;
-      message.ReadAudioSamples(
-          Slice<int16_t, kAdcDataSize>(g_mic_audio_int16));
+      if (message.type() == MessageType::kAdpcmAudioSamples) {
+        message.ReadAdpcmAudioSamples(
+            Slice<int16_t, kAdcDataSize>(g_mic_audio_int16));
+      } else {
+        message.ReadAudioSamples(
+            Slice<int16_t, kAdcDataSize>(g_mic_audio_int16));
+      }
       // Unblock the audio processing task.
       BaseType_t xHigherPriorityTaskWoken;
       xHigherPriorityTaskWoken = pdFALSE;
@@ -276,6 +283,16 @@ void HandleMessage(const Message& message) {
         g_streaming_tactile_playback = true;
       }
       break;
+    case MessageType::kCompressedTactorsSamples: {
+      // Decode to a local buffer, since a failed decode may have partially
+      // written it, and the PWM interrupt plays from the streaming buffer.
+      uint8_t samples[kPwmSamplesAllChannels];
+      if (message.ReadCompressedTactorsSamples(
+              Slice<uint8_t, kNumTotalPwm * kNumPwmValues>(samples))) {
+        memcpy(g_all_tactor_streaming_buffer, samples, sizeof(samples));
+        g_streaming_tactile_playback = true;
+      }
+    } break;
     default:
       // Handle an unknown op code event.
       NRF_LOG_RAW_INFO("== UNKNOWN MESSAGE TYPE ==\n");
@@ -330,12 +347,12 @@ static void TactileProcessorTaskFun(void*) {
           &g_tactile_pattern, g_tactile_processor.GetOutputBlockSize(),
           g_tactile_output);
     } else {
-      // Convert ADC values to floats. The raw ADC values can swing from -2048
-      // to 2048, so we scale by that value.
-      const float scale = TuningGetInputGain(&g_tuning_knobs) / 2048.0f;
-      for (int i = 0; i < kAdcDataSize; ++i) {
-        g_mic_audio_float[i] = scale * g_mic_audio_int16[i];
-      }
+      // Convert ADC values to floats, applying the input gain in the same
+      // pass. The raw ADC values can swing from -2048 to 2048, so the gain
+      // includes a factor of 32768 / 2048 = 16.
+      ConvertSampleArrayInt16ToFloatWithGain(
+          g_mic_audio_int16, kAdcDataSize,
+          16.0f * TuningGetInputGain(&g_tuning_knobs), g_mic_audio_float);
       // Process samples.
       g_tactile_output = g_tactile_processor.ProcessSamples(g_mic_audio_float);
     }
@@ -0,0 +1,298 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/cpp/concurrent_object_pool.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/dsp/logging.h"
+
+// NOLINTBEGIN(readability/check)
+
+namespace audio_tactile {
+
+// A dummy object for testing the pool, like in object_pool_test.cpp, but with
+// atomic counters so that it may be constructed and destructed concurrently.
+struct Object {
+  Object() : Object(0) {}
+  explicit Object(int label_in) : label(label_in) { ++constructor_count; }
+  ~Object() { ++destructor_count; }
+
+  int label;
+
+  static void ResetCounters() { constructor_count = destructor_count = 0; }
+  static std::atomic<int> constructor_count;
+  static std::atomic<int> destructor_count;
+};
+std::atomic<int> Object::constructor_count(0);
+std::atomic<int> Object::destructor_count(0);
+
+// Gets the state of the pool. Returns a string of length kCapacity, in which
+// the ith char is '*' if the ith object is live or '.' if it is free.
+template <typename PoolType>
+std::string PoolState(const PoolType& pool) {
+  std::string state(PoolType::kCapacity, ' ');
+  char is_live[PoolType::kCapacity];
+  PoolType::TestAccess::MarkLiveObjects(pool, is_live);
+  for (int i = 0; i < PoolType::kCapacity; ++i) {
+    state[i] = is_live[i] ? '*' : '.';
+  }
+  return state;
+}
+
+// Single-threaded behavior matches ObjectPool.
+void TestPoolBasic() {
+  puts("TestPoolBasic");
+  Object::ResetCounters();
+
+  {
+    ConcurrentObjectPool<Object, 5> pool;
+    using PoolType = decltype(pool);
+    CHECK(pool.num_free() == 5);
+    CHECK(PoolState(pool) == ".....");
+
+    Object* object_a = pool.Allocate('a');
+    Object* object_b = pool.Allocate('b');
+    Object* object_c = pool.Allocate('c');
+    CHECK(object_a && object_a->label == 'a');
+    CHECK(object_b && object_b->label == 'b');
+    CHECK(object_c && object_c->label == 'c');
+    CHECK(Object::constructor_count == 3);
+    CHECK(pool.num_live() == 3);
+    CHECK(PoolState(pool) == "***..");
+
+    pool.Free(object_b);
+    CHECK(Object::destructor_count == 1);
+    CHECK(PoolState(pool) == "*.*..");
+
+    Object* object_d = pool.Allocate('d');  // Reuses b.
+    CHECK(object_d == object_b);
+    CHECK(PoolType::TestAccess::GetObject(pool, 1) == object_d);
+
+    CHECK(pool.Allocate('e') != nullptr);
+    CHECK(pool.Allocate('f') != nullptr);
+    CHECK(pool.Allocate('g') == nullptr);  // Out of memory.
+    CHECK(pool.num_free() == 0);
+    CHECK(PoolState(pool) == "*****");
+    CHECK(Object::constructor_count == 6);
+
+    pool.Free(nullptr);  // Freeing null is a no-op.
+    CHECK(pool.num_free() == 0);
+  }
+
+  // Pool destructor destroyed the 5 remaining objects.
+  CHECK(Object::destructor_count == 6);
+}
+
+// Bulk allocation and freeing.
+void TestBulk() {
+  puts("TestBulk");
+  Object::ResetCounters();
+  ConcurrentObjectPool<Object, 100> pool;
+
+  Object* objects[120];
+  CHECK(pool.AllocateBulk(objects, 40) == 40);
+  CHECK(pool.num_live() == 40);
+  CHECK(Object::constructor_count == 40);
+  // Only 60 remain.
+  CHECK(pool.AllocateBulk(objects + 40, 80) == 60);
+  CHECK(pool.num_free() == 0);
+  CHECK(pool.AllocateBulk(objects, 1) == 0);
+
+  // All objects are distinct.
+  char is_live[100];
+  decltype(pool)::TestAccess::MarkLiveObjects(pool, is_live);
+  for (int i = 0; i < 100; ++i) { CHECK(is_live[i]); }
+  for (int i = 0; i < 100; ++i) {
+    for (int j = 0; j < i; ++j) { CHECK(objects[i] != objects[j]); }
+  }
+
+  objects[10] = nullptr;  // Null pointers are skipped.
+  pool.FreeBulk(objects, 100);
+  CHECK(pool.num_free() == 99);
+  CHECK(Object::destructor_count == 99);
+  CHECK(pool.AllocateBulk(objects, 100) == 99);
+}
+
+// Allocation through a per-thread cache.
+void TestCache() {
+  puts("TestCache");
+  Object::ResetCounters();
+  ConcurrentObjectPool<Object, 20> pool;
+
+  {
+    decltype(pool)::Cache<8> cache(&pool);
+    Object* objects[20];
+    objects[0] = cache.Allocate(7);
+    CHECK(objects[0] && objects[0]->label == 7);
+    CHECK(cache.num_cached() == 3);  // Refilled with 4, one allocated.
+    CHECK(pool.num_free() == 16);
+
+    for (int i = 1; i < 20; ++i) {
+      objects[i] = cache.Allocate(i);
+      CHECK(objects[i] != nullptr);
+    }
+    CHECK(cache.Allocate() == nullptr);
+    CHECK(pool.num_free() == 0);
+
+    for (int i = 0; i < 20; ++i) {
+      cache.Free(objects[i]);
+      CHECK(cache.num_cached() <= 8);
+    }
+    CHECK(Object::destructor_count == 20);
+    CHECK(pool.num_free() + cache.num_cached() == 20);
+  }
+
+  // Cache destructor returned its objects.
+  CHECK(pool.num_free() == 20);
+  CHECK(PoolState(pool) == std::string(20, '.'));
+}
+
+// Many threads allocate, use, and free objects concurrently. Each object is
+// written with a thread-unique label and checked before freeing, so that
+// allocating the same object twice would be detected.
+template <bool kUseCache>
+void RunStress(int num_threads, int num_iterations) {
+  constexpr int kCapacity = 64;
+  constexpr int kMaxHeld = 6;
+  ConcurrentObjectPool<Object, kCapacity> pool;
+  using PoolType = decltype(pool);
+  std::atomic<int> num_errors(0);
+  std::atomic<int> num_failed_allocations(0);
+  Object::ResetCounters();
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      PoolType::Cache<4> cache(&pool);
+      Object* held[kMaxHeld];
+      for (int iter = 0; iter < num_iterations; ++iter) {
+        const int num_held = 1 + (iter + t) % kMaxHeld;
+        int label = (t << 20) | (iter << 3);
+        int count = 0;
+        if (kUseCache) {
+          for (; count < num_held; ++count) {
+            if (!(held[count] = cache.Allocate(label + count))) { break; }
+          }
+        } else if (iter % 2) {
+          count = pool.AllocateBulk(held, num_held);
+          for (int i = 0; i < count; ++i) { held[i]->label = label + i; }
+        } else {
+          for (; count < num_held; ++count) {
+            if (!(held[count] = pool.Allocate(label + count))) { break; }
+          }
+        }
+        if (count < num_held) { ++num_failed_allocations; }
+
+        for (int i = 0; i < count; ++i) {
+          if (held[i]->label != label + i) { ++num_errors; }
+        }
+
+        if (kUseCache) {
+          for (int i = 0; i < count; ++i) { cache.Free(held[i]); }
+        } else if (iter % 3) {
+          pool.FreeBulk(held, count);
+        } else {
+          for (int i = 0; i < count; ++i) { pool.Free(held[i]); }
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) { thread.join(); }
+
+  CHECK(num_errors == 0);
+  CHECK(pool.num_free() == kCapacity);
+  CHECK(PoolState(pool) == std::string(kCapacity, '.'));
+  CHECK(Object::constructor_count == Object::destructor_count);
+  CHECK(Object::constructor_count > 0);
+  printf("  threads: %d, constructed: %d, failed allocations: %d\n",
+         num_threads, Object::constructor_count.load(),
+         num_failed_allocations.load());
+}
+
+void TestStress() {
+  puts("TestStress");
+  RunStress</*kUseCache=*/false>(8, 20000);
+  // With 16 threads each holding up to 6, the pool may be exhausted at times,
+  // exercising allocation failure.
+  RunStress</*kUseCache=*/false>(16, 10000);
+  RunStress</*kUseCache=*/true>(8, 20000);
+}
+
+// Objects are allocated by a producer thread and freed by a consumer thread,
+// as when passing buffers from an audio thread to a worker.
+void TestProducerConsumer() {
+  puts("TestProducerConsumer");
+  constexpr int kNumMessages = 100000;
+  ConcurrentObjectPool<Object, 16> pool;
+  std::mutex mutex;
+  std::deque<Object*> queue;
+  std::atomic<int> num_errors(0);
+
+  std::thread producer([&] {
+    for (int i = 0; i < kNumMessages;) {
+      Object* object = pool.Allocate(i);
+      if (object == nullptr) {
+        std::this_thread::yield();  // Pool exhausted, wait for consumer.
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      queue.push_back(object);
+      ++i;
+    }
+  });
+  std::thread consumer([&] {
+    for (int expected = 0; expected < kNumMessages;) {
+      Object* object = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!queue.empty()) {
+          object = queue.front();
+          queue.pop_front();
+        }
+      }
+      if (object == nullptr) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (object->label != expected++) { ++num_errors; }
+      pool.Free(object);
+    }
+  });
+  producer.join();
+  consumer.join();
+
+  CHECK(num_errors == 0);
+  CHECK(pool.num_free() == 16);
+}
+
+}  // namespace audio_tactile
+
+// NOLINTEND
+
+int main(int argc, char** argv) {
+  audio_tactile::TestPoolBasic();
+  audio_tactile::TestBulk();
+  audio_tactile::TestCache();
+  audio_tactile::TestStress();
+  audio_tactile::TestProducerConsumer();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,182 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/cpp/ima_adpcm.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "src/cpp/constants.h"
+#include "src/dsp/logging.h"
+#include "src/dsp/read_wav_file.h"
+
+// NOLINTBEGIN(readability/check)
+
+namespace audio_tactile {
+
+constexpr int kBlockSize = kAdcDataSize;
+
+// Encodes and decodes `input` in blocks of kBlockSize, and returns the decoded
+// audio.
+std::vector<int16_t> EncodeDecode(const std::vector<int16_t>& input) {
+  const int num_blocks = input.size() / kBlockSize;
+  std::vector<int16_t> output(num_blocks * kBlockSize);
+  ImaAdpcmState state;
+  ImaAdpcmInit(&state);
+  uint8_t block[ImaAdpcmBlockSize(kBlockSize)];
+
+  for (int b = 0; b < num_blocks; ++b) {
+    CHECK(ImaAdpcmEncodeBlock(
+              Slice<const int16_t>(input.data() + b * kBlockSize, kBlockSize),
+              &state, block) == ImaAdpcmBlockSize(kBlockSize));
+    CHECK(ImaAdpcmDecodeBlock(
+        Slice<const uint8_t>(block, ImaAdpcmBlockSize(kBlockSize)),
+        Slice<int16_t>(output.data() + b * kBlockSize, kBlockSize)));
+  }
+  return output;
+}
+
+// Computes the SNR in dB of `output` relative to `input`.
+double ComputeSnrDb(const std::vector<int16_t>& input,
+                    const std::vector<int16_t>& output) {
+  double signal_energy = 0.0;
+  double noise_energy = 0.0;
+  for (int i = 0; i < static_cast<int>(output.size()); ++i) {
+    const double error = static_cast<double>(output[i]) - input[i];
+    signal_energy += static_cast<double>(input[i]) * input[i];
+    noise_energy += error * error;
+  }
+  return 10.0 * log10(signal_energy / noise_energy);
+}
+
+// Speech recordings are coded with SNR of about 20-35 dB.
+void TestPhoneSnr(const char* phone) {
+  printf("TestPhoneSnr(\"%s\")\n", phone);
+  char wav_file[1024];
+  sprintf(wav_file, "extras/test/testdata/phone_%s.wav", phone);
+
+  size_t num_samples;
+  int num_channels;
+  int sample_rate_hz;
+  int16_t* samples = reinterpret_cast<int16_t*>(CHECK_NOTNULL(
+      Read16BitWavFile(wav_file, &num_samples, &num_channels,
+                       &sample_rate_hz)));
+  CHECK(num_channels == 1);
+  std::vector<int16_t> input(samples, samples + num_samples);
+  free(samples);
+
+  const double snr_db = ComputeSnrDb(input, EncodeDecode(input));
+  printf("  SNR: %.1f dB\n", snr_db);
+  CHECK(snr_db >= 18.0);
+}
+
+// Encoding in blocks gives the same codes as encoding all at once, and each
+// block decodes on its own, so losing a block doesn't affect the next.
+void TestBlocksAreIndependent() {
+  puts("TestBlocksAreIndependent");
+  std::mt19937 rng(0);
+  std::normal_distribution<float> noise_dist(0.0f, 300.0f);
+  std::vector<int16_t> input(4 * kBlockSize);
+  for (int i = 0; i < static_cast<int>(input.size()); ++i) {
+    input[i] = static_cast<int16_t>(8000.0f * sin(0.05f * i) +
+                                    noise_dist(rng));
+  }
+
+  ImaAdpcmState state;
+  ImaAdpcmInit(&state);
+  uint8_t whole[ImaAdpcmBlockSize(4 * kBlockSize)];
+  ImaAdpcmEncodeBlock(Slice<const int16_t>(input.data(), input.size()), &state,
+                      whole);
+
+  ImaAdpcmInit(&state);
+  uint8_t blocks[4][ImaAdpcmBlockSize(kBlockSize)];
+  for (int b = 0; b < 4; ++b) {
+    ImaAdpcmEncodeBlock(
+        Slice<const int16_t>(input.data() + b * kBlockSize, kBlockSize),
+        &state, blocks[b]);
+    CHECK(std::equal(blocks[b] + kImaAdpcmHeaderSize,
+                     blocks[b] + ImaAdpcmBlockSize(kBlockSize),
+                     whole + kImaAdpcmHeaderSize + b * kBlockSize / 2));
+  }
+
+  std::vector<int16_t> expected(input.size());
+  CHECK(ImaAdpcmDecodeBlock(
+      Slice<const uint8_t>(whole, sizeof(whole)),
+      Slice<int16_t>(expected.data(), expected.size())));
+  // Decode only the last block, as if the others were lost.
+  int16_t output[kBlockSize];
+  CHECK(ImaAdpcmDecodeBlock(Slice<const uint8_t>(blocks[3], sizeof(blocks[3])),
+                            Slice<int16_t>(output, kBlockSize)));
+  CHECK(std::equal(output, output + kBlockSize,
+                   expected.begin() + 3 * kBlockSize));
+}
+
+// Full-scale square waves saturate without overflow.
+void TestFullScale() {
+  puts("TestFullScale");
+  std::vector<int16_t> input(16 * kBlockSize);
+  for (int i = 0; i < static_cast<int>(input.size()); ++i) {
+    input[i] = ((i / 40) % 2) ? INT16_MAX : INT16_MIN;
+  }
+  std::vector<int16_t> output = EncodeDecode(input);
+  // After the step size adapts, the output tracks the input closely.
+  for (int i = 200; i < static_cast<int>(input.size()); ++i) {
+    if (i % 40 >= 20) {
+      CHECK(abs(output[i] - input[i]) < 1000);
+    }
+  }
+}
+
+// Blocks with the wrong size or an invalid header are rejected.
+void TestInvalid() {
+  puts("TestInvalid");
+  int16_t samples[kBlockSize] = {0};
+  ImaAdpcmState state;
+  ImaAdpcmInit(&state);
+  uint8_t block[ImaAdpcmBlockSize(kBlockSize)];
+  const int block_size = ImaAdpcmEncodeBlock(
+      Slice<const int16_t>(samples, kBlockSize), &state, block);
+
+  Slice<int16_t> output(samples, kBlockSize);
+  CHECK(ImaAdpcmDecodeBlock(Slice<const uint8_t>(block, block_size), output));
+  CHECK(!ImaAdpcmDecodeBlock(Slice<const uint8_t>(block, block_size - 1),
+                             output));
+  CHECK(!ImaAdpcmDecodeBlock(Slice<const uint8_t>(block, 0), output));
+  CHECK(!ImaAdpcmDecodeBlock(Slice<const uint8_t>(block, block_size),
+                             Slice<int16_t>(samples, kBlockSize - 1)));
+  block[2] = 89;  // Step index out of range.
+  CHECK(!ImaAdpcmDecodeBlock(Slice<const uint8_t>(block, block_size), output));
+}
+
+}  // namespace audio_tactile
+
+// NOLINTEND
+
+int main(int argc, char** argv) {
+  for (const char* phone : {"aa", "ae", "eh", "er", "ih", "iy", "uh", "uw",
+                            "z"}) {
+    audio_tactile::TestPhoneSnr(phone);
+  }
+  audio_tactile::TestBlocksAreIndependent();
+  audio_tactile::TestFullScale();
+  audio_tactile::TestInvalid();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
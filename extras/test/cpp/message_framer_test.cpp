@@ -0,0 +1,294 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/cpp/message_framer.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "src/dsp/logging.h"
+
+// NOLINTBEGIN(readability/check)
+
+namespace audio_tactile {
+
+using Mode = MessageFramer::Mode;
+
+const char* ModeName(Mode mode) {
+  return (mode == Mode::kSerial) ? "kSerial" : "kBle";
+}
+
+// Makes a message of `type` with random payload of `payload_size` bytes.
+Message RandomMessage(int type, int payload_size, std::mt19937* rng) {
+  std::uniform_int_distribution<int> byte_dist(0, 255);
+  std::vector<uint8_t> payload(payload_size);
+  for (uint8_t& b : payload) {
+    b = static_cast<uint8_t>(byte_dist(*rng));
+  }
+  Message message;
+  message.set_type(static_cast<MessageType>(type));
+  message.set_payload(Slice<const uint8_t>(payload.data(), payload_size));
+  return message;
+}
+
+// Appends `message` as a frame in `mode` to `stream`.
+void AppendFrame(Mode mode, Message message, std::vector<uint8_t>* stream) {
+  uint8_t frame[MessageFramer::kMaxFrameSize];
+  const int frame_size =
+      (mode == Mode::kSerial)
+          ? MessageFramer::WriteSerialFrame(MessageRecipient::kSleeve,
+                                            &message, frame)
+          : MessageFramer::WriteBleFrame(&message, frame);
+  stream->insert(stream->end(), frame, frame + frame_size);
+}
+
+bool MessagesEqual(const Message& a, const Message& b) {
+  return a.type() == b.type() && a.payload().size() == b.payload().size() &&
+         std::equal(a.payload().begin(), a.payload().end(),
+                    b.payload().begin());
+}
+
+// Runs `stream` through a MessageFramer in chunks of `chunk_size` bytes and
+// returns the messages found.
+std::vector<Message> RunFramer(const std::vector<uint8_t>& stream,
+                               int chunk_size, MessageFramer* framer) {
+  std::vector<Message> messages;
+  for (int start = 0; start < static_cast<int>(stream.size());
+       start += chunk_size) {
+    const int size =
+        std::min<int>(chunk_size, static_cast<int>(stream.size()) - start);
+    framer->Push(stream.data() + start, size);
+    const Message* message;
+    while ((message = framer->Next()) != nullptr) {
+      messages.push_back(*message);
+    }
+  }
+  return messages;
+}
+
+// Messages written as frames are recovered for any chunk size.
+void TestRoundTrip(Mode mode) {
+  printf("TestRoundTrip(%s)\n", ModeName(mode));
+  std::mt19937 rng(0);
+  std::vector<Message> expected;
+  std::vector<uint8_t> stream;
+  for (int i = 0; i < 50; ++i) {
+    const int payload_size = (i % 5 == 0) ? 0 : (i * 37) % 129;
+    expected.push_back(RandomMessage(1 + i % 36, payload_size, &rng));
+    AppendFrame(mode, expected.back(), &stream);
+  }
+  if (mode == Mode::kSerial) {
+    CHECK(stream.size() == 50 * Message::kMaxMessageSize);
+  }
+
+  for (int chunk_size : {1, 2, 7, 20, 64, 132, 1000, 100000}) {
+    MessageFramer framer(mode);
+    std::vector<Message> messages = RunFramer(stream, chunk_size, &framer);
+    CHECK(messages.size() == expected.size());
+    for (int i = 0; i < static_cast<int>(expected.size()); ++i) {
+      CHECK(MessagesEqual(messages[i], expected[i]));
+      if (mode == Mode::kSerial) {
+        CHECK(messages[i].recipient() == MessageRecipient::kSleeve);
+      } else {
+        CHECK(messages[i].VerifyChecksum());
+      }
+    }
+    CHECK(framer.stats().messages == expected.size());
+    CHECK(framer.stats().bad_frames == 0);
+    CHECK(framer.stats().skipped_bytes == 0);
+  }
+}
+
+// Frames entirely within the chunk are returned without copying.
+void TestZeroCopy(Mode mode) {
+  printf("TestZeroCopy(%s)\n", ModeName(mode));
+  std::mt19937 rng(0);
+  std::vector<uint8_t> stream;
+  for (int i = 0; i < 5; ++i) {
+    AppendFrame(mode, RandomMessage(13, 128, &rng), &stream);
+  }
+
+  MessageFramer framer(mode);
+  framer.Push(stream.data(), stream.size());
+  const Message* message = framer.Next();
+  CHECK(message != nullptr);
+  CHECK(message->data() == stream.data());
+}
+
+// Garbage between frames is skipped. In kSerial mode, garbage includes start
+// bytes with an invalid header.
+void TestGarbage(Mode mode) {
+  printf("TestGarbage(%s)\n", ModeName(mode));
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> byte_dist(0, 255);
+  std::vector<Message> expected;
+  std::vector<uint8_t> stream;
+  for (int i = 0; i < 30; ++i) {
+    for (int j = 0; j < i % 4; ++j) {
+      if (mode == Mode::kSerial) {
+        stream.push_back(Message::kPacketStart);
+        stream.push_back(0xff);  // Invalid recipient.
+      } else {
+        stream.push_back(static_cast<uint8_t>(byte_dist(rng)));
+        stream.push_back(static_cast<uint8_t>(byte_dist(rng)));
+      }
+    }
+    expected.push_back(RandomMessage(17, 96, &rng));
+    AppendFrame(mode, expected.back(), &stream);
+  }
+
+  for (int chunk_size : {1, 20, 4096}) {
+    MessageFramer framer(mode);
+    std::vector<Message> messages = RunFramer(stream, chunk_size, &framer);
+    CHECK(messages.size() == expected.size());
+    for (int i = 0; i < static_cast<int>(expected.size()); ++i) {
+      CHECK(MessagesEqual(messages[i], expected[i]));
+    }
+    CHECK(framer.stats().bad_frames > 0);
+    CHECK(framer.stats().skipped_bytes > 0);
+  }
+}
+
+// In kBle mode, a corrupted frame is dropped, and framing resumes with the next
+// frame.
+void TestBleCorruption() {
+  puts("TestBleCorruption");
+  std::mt19937 rng(0);
+  std::vector<Message> messages_in;
+  std::vector<uint8_t> stream;
+  std::vector<int> frame_starts;
+  for (int i = 0; i < 20; ++i) {
+    messages_in.push_back(RandomMessage(17, 40, &rng));
+    frame_starts.push_back(stream.size());
+    AppendFrame(Mode::kBle, messages_in.back(), &stream);
+  }
+  // Corrupt a payload byte of frame 3 and the size field of frame 10.
+  stream[frame_starts[3] + 10] ^= 0x21;
+  stream[frame_starts[10] + 3] = 128;
+
+  for (int chunk_size : {1, 33, 4096}) {
+    MessageFramer framer(Mode::kBle);
+    std::vector<Message> messages = RunFramer(stream, chunk_size, &framer);
+    CHECK(messages.size() == messages_in.size() - 2);
+    CHECK(framer.stats().bad_frames >= 2);
+    int j = 0;
+    for (int i = 0; i < static_cast<int>(messages_in.size()); ++i) {
+      if (i == 3 || i == 10) { continue; }
+      CHECK(MessagesEqual(messages[j++], messages_in[i]));
+    }
+  }
+}
+
+// In kSerial mode, a frame with a bad header is dropped. Without a checksum,
+// corrupted payload bytes are passed through.
+void TestSerialCorruption() {
+  puts("TestSerialCorruption");
+  std::mt19937 rng(0);
+  std::vector<Message> messages_in;
+  std::vector<uint8_t> stream;
+  for (int i = 0; i < 20; ++i) {
+    messages_in.push_back(RandomMessage(17, 40, &rng));
+    AppendFrame(Mode::kSerial, messages_in.back(), &stream);
+  }
+  const int kFrameSize = Message::kMaxMessageSize;
+  // Corrupt the start byte of frame 3, the size field of frame 10, and a
+  // payload byte of frame 15.
+  stream[3 * kFrameSize] ^= 0x21;
+  stream[10 * kFrameSize + 3] = 129;
+  stream[15 * kFrameSize + 10] ^= 0x21;
+
+  for (int chunk_size : {1, 33, 4096}) {
+    MessageFramer framer(Mode::kSerial);
+    std::vector<Message> messages = RunFramer(stream, chunk_size, &framer);
+    CHECK(messages.size() == messages_in.size() - 2);
+    CHECK(framer.stats().bad_frames >= 1);
+    int j = 0;
+    for (int i = 0; i < static_cast<int>(messages_in.size()); ++i) {
+      if (i == 3 || i == 10) { continue; }
+      CHECK(MessagesEqual(messages[j++], messages_in[i]) == (i != 15));
+    }
+  }
+}
+
+// A bad frame whose header claims a long payload must not swallow the valid
+// frames that follow it.
+void TestResyncWithinBadFrame(Mode mode) {
+  printf("TestResyncWithinBadFrame(%s)\n", ModeName(mode));
+  std::mt19937 rng(0);
+  std::vector<Message> expected;
+  std::vector<uint8_t> stream;
+  if (mode == Mode::kSerial) {
+    // Header with an invalid recipient.
+    stream = {Message::kPacketStart, 0x12, 17, 120};
+  } else {
+    // Header with a bad checksum.
+    stream = {0x12, 0x34, 17, 120};
+  }
+  for (int i = 0; i < 3; ++i) {
+    expected.push_back(RandomMessage(i + 1, 10, &rng));
+    AppendFrame(mode, expected.back(), &stream);
+  }
+  // Pad so the bad frame's claimed size is available.
+  stream.resize(stream.size() + 120, 0);
+
+  for (int chunk_size : {1, 3, 64, 4096}) {
+    MessageFramer framer(mode);
+    std::vector<Message> messages = RunFramer(stream, chunk_size, &framer);
+    CHECK(messages.size() == expected.size());
+    for (int i = 0; i < static_cast<int>(expected.size()); ++i) {
+      CHECK(MessagesEqual(messages[i], expected[i]));
+    }
+    // In kBle mode, positions within the bad frame may also have plausible
+    // headers.
+    CHECK(mode == Mode::kSerial ? framer.stats().bad_frames == 1
+                                : framer.stats().bad_frames >= 1);
+  }
+}
+
+// Reset() discards a partial frame.
+void TestReset(Mode mode) {
+  printf("TestReset(%s)\n", ModeName(mode));
+  std::mt19937 rng(0);
+  std::vector<uint8_t> stream;
+  AppendFrame(mode, RandomMessage(5, 20, &rng), &stream);
+
+  MessageFramer framer(mode);
+  framer.Push(stream.data(), 10);
+  CHECK(framer.Next() == nullptr);
+  framer.Reset();
+  framer.Push(stream.data() + 10, stream.size() - 10);
+  CHECK(framer.Next() == nullptr);
+  CHECK(framer.stats().messages == 0);
+}
+
+}  // namespace audio_tactile
+
+// NOLINTEND
+
+int main(int argc, char** argv) {
+  using audio_tactile::Mode;
+  for (Mode mode : {Mode::kSerial, Mode::kBle}) {
+    audio_tactile::TestRoundTrip(mode);
+    audio_tactile::TestZeroCopy(mode);
+    audio_tactile::TestGarbage(mode);
+    audio_tactile::TestResyncWithinBadFrame(mode);
+    audio_tactile::TestReset(mode);
+  }
+  audio_tactile::TestBleCorruption();
+  audio_tactile::TestSerialCorruption();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,325 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/cpp/message_scheduler.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "src/cpp/message_framer.h"
+#include "src/dsp/logging.h"
+#include "src/dsp/serialize.h"
+
+// NOLINTBEGIN(readability/check)
+
+namespace audio_tactile {
+
+// Makes a message of `type` with `payload_size` bytes. The first 4 bytes of
+// the payload are set to `id`.
+Message MakeMessage(MessageType type, int payload_size, uint32_t id) {
+  uint8_t payload[Message::kMaxPayloadSize] = {0};
+  LittleEndianWriteU32(id, payload);
+  Message message;
+  message.set_type(type);
+  message.set_payload(Slice<const uint8_t>(payload, payload_size));
+  return message;
+}
+
+uint32_t MessageId(const Message& message) {
+  return LittleEndianReadU32(message.payload().data());
+}
+
+// Splits `frame` into messages with MessageFramer in kBle mode.
+std::vector<Message> SplitFrame(const uint8_t* frame, int frame_size) {
+  MessageFramer framer(MessageFramer::Mode::kBle);
+  framer.Push(frame, frame_size);
+  std::vector<Message> messages;
+  const Message* message;
+  while ((message = framer.Next()) != nullptr) {
+    messages.push_back(*message);
+  }
+  CHECK(framer.stats().bad_frames == 0);
+  return messages;
+}
+
+// Small messages are coalesced into one frame, highest priority first.
+void TestCoalescing() {
+  puts("TestCoalescing");
+  MessageScheduler scheduler(244);
+  CHECK(scheduler.Enqueue(MakeMessage(MessageType::kTemperature, 4, 1),
+                          MessageScheduler::kHousekeeping));
+  CHECK(scheduler.Enqueue(MakeMessage(MessageType::kBatteryVoltage, 4, 2),
+                          MessageScheduler::kHousekeeping));
+  CHECK(scheduler.Enqueue(MakeMessage(MessageType::kAdpcmAudioSamples, 35, 3),
+                          MessageScheduler::kRealTime, 100));
+  CHECK(scheduler.Enqueue(MakeMessage(MessageType::kTuning, 20, 4),
+                          MessageScheduler::kNormal));
+  CHECK(scheduler.size() == 4);
+
+  uint8_t frame[244];
+  const int frame_size = scheduler.NextFrame(0, frame);
+  CHECK(frame_size == 4 * 4 + 4 + 4 + 35 + 20);
+  std::vector<Message> messages = SplitFrame(frame, frame_size);
+  CHECK(messages.size() == 4);
+  CHECK(MessageId(messages[0]) == 3);  // Real-time first.
+  CHECK(MessageId(messages[1]) == 4);  // Then normal.
+  CHECK(MessageId(messages[2]) == 1);  // Then housekeeping, FIFO.
+  CHECK(MessageId(messages[3]) == 2);
+  CHECK(scheduler.empty());
+  CHECK(scheduler.NextFrame(0, frame) == 0);
+  CHECK(scheduler.stats().frames == 1);
+  CHECK(scheduler.stats().messages == 4);
+}
+
+// Messages that don't fit wait for the next frame, while smaller messages fill
+// the leftover space.
+void TestMtu() {
+  puts("TestMtu");
+  MessageScheduler scheduler(132);
+  scheduler.Enqueue(MakeMessage(MessageType::kAllTactorsSamples, 96, 1),
+                    MessageScheduler::kRealTime);
+  scheduler.Enqueue(MakeMessage(MessageType::kAllTactorsSamples, 96, 2),
+                    MessageScheduler::kRealTime);
+  scheduler.Enqueue(MakeMessage(MessageType::kTemperature, 4, 3),
+                    MessageScheduler::kHousekeeping);
+
+  uint8_t frame[132];
+  std::vector<Message> messages =
+      SplitFrame(frame, scheduler.NextFrame(0, frame));
+  CHECK(messages.size() == 2);
+  CHECK(MessageId(messages[0]) == 1);
+  CHECK(MessageId(messages[1]) == 3);
+  messages = SplitFrame(frame, scheduler.NextFrame(0, frame));
+  CHECK(messages.size() == 1);
+  CHECK(MessageId(messages[0]) == 2);
+}
+
+// Background messages are limited by max_background_frame_size.
+void TestBackgroundFrameLimit() {
+  puts("TestBackgroundFrameLimit");
+  MessageScheduler scheduler(244);
+  scheduler.set_max_background_frame_size(20);
+  for (int i = 0; i < 3; ++i) {
+    scheduler.Enqueue(MakeMessage(MessageType::kTemperature, 4, i),
+                      MessageScheduler::kHousekeeping);
+  }
+  scheduler.Enqueue(MakeMessage(MessageType::kStatsRecord, 60, 3),
+                    MessageScheduler::kHousekeeping);
+
+  uint8_t frame[244];
+  CHECK(SplitFrame(frame, scheduler.NextFrame(0, frame)).size() == 2);
+  CHECK(SplitFrame(frame, scheduler.NextFrame(0, frame)).size() == 1);
+  // A message larger than the limit is still sent alone.
+  std::vector<Message> messages =
+      SplitFrame(frame, scheduler.NextFrame(0, frame));
+  CHECK(messages.size() == 1);
+  CHECK(MessageId(messages[0]) == 3);
+  CHECK(scheduler.empty());
+}
+
+// Messages past their deadline are dropped, and earlier deadlines go first.
+void TestDeadlines() {
+  puts("TestDeadlines");
+  MessageScheduler scheduler(132);
+  // Times near wraparound.
+  const uint32_t t0 = UINT32_MAX - 5;
+  scheduler.Enqueue(MakeMessage(MessageType::kAudioSamples, 128, 1),
+                    MessageScheduler::kRealTime, t0 + 2);
+  scheduler.Enqueue(MakeMessage(MessageType::kAudioSamples, 100, 2),
+                    MessageScheduler::kRealTime, t0 + 20);
+  scheduler.Enqueue(MakeMessage(MessageType::kAudioSamples, 100, 3),
+                    MessageScheduler::kRealTime, t0 + 10);
+
+  uint8_t frame[132];
+  std::vector<Message> messages =
+      SplitFrame(frame, scheduler.NextFrame(t0 + 5, frame));
+  CHECK(messages.size() == 1);
+  CHECK(MessageId(messages[0]) == 3);
+  CHECK(scheduler.stats().expired == 1);
+  CHECK(scheduler.NextFrame(t0 + 21, frame) == 0);
+  CHECK(scheduler.stats().expired == 2);
+}
+
+// When full, lower priority messages make room for higher priority ones.
+void TestOverflow() {
+  puts("TestOverflow");
+  MessageScheduler scheduler(132);
+  for (int i = 0; i < MessageScheduler::kCapacity; ++i) {
+    CHECK(scheduler.Enqueue(MakeMessage(MessageType::kStatsRecord, 10, i),
+                            MessageScheduler::kHousekeeping));
+  }
+  CHECK(!scheduler.Enqueue(MakeMessage(MessageType::kStatsRecord, 10, 100),
+                           MessageScheduler::kHousekeeping));
+  CHECK(scheduler.Enqueue(MakeMessage(MessageType::kAudioSamples, 10, 200),
+                          MessageScheduler::kRealTime));
+  CHECK(scheduler.size() == MessageScheduler::kCapacity);
+  CHECK(scheduler.stats().overflowed == 2);
+
+  uint8_t frame[132];
+  std::vector<Message> messages =
+      SplitFrame(frame, scheduler.NextFrame(0, frame));
+  CHECK(MessageId(messages[0]) == 200);
+  for (int i = 1; i < static_cast<int>(messages.size()); ++i) {
+    // The newest housekeeping message (id 15) was the one dropped.
+    CHECK(MessageId(messages[i]) == static_cast<uint32_t>(i - 1));
+  }
+}
+
+void TestDefaultPriority() {
+  puts("TestDefaultPriority");
+  CHECK(MessageScheduler::DefaultPriority(MessageType::kAudioSamples) ==
+        MessageScheduler::kRealTime);
+  CHECK(MessageScheduler::DefaultPriority(MessageType::kTactor7Samples) ==
+        MessageScheduler::kRealTime);
+  CHECK(MessageScheduler::DefaultPriority(MessageType::kBatteryVoltage) ==
+        MessageScheduler::kHousekeeping);
+  CHECK(MessageScheduler::DefaultPriority(MessageType::kTuning) ==
+        MessageScheduler::kNormal);
+}
+
+// Parameters of a simulated link.
+struct LinkParams {
+  const char* name;
+  // Max bytes per frame.
+  int mtu;
+  // Link throughput in bytes per ms.
+  double bytes_per_ms;
+  // Fixed latency per frame in ms, e.g. waiting for the next BLE connection
+  // event or driver overhead.
+  double frame_latency_ms;
+  // Scheduler's max_background_frame_size.
+  int max_background_frame_size;
+};
+
+// Simulates 10 s of traffic over a link and returns the p99 latency in ms of
+// sample messages. Audio sample messages are sent every 4 ms. Every 100 ms,
+// there is a burst of 12 housekeeping messages. If `use_scheduler` is false,
+// messages are sent one per frame in FIFO order for comparison.
+double SimulateLink(const LinkParams& link, bool use_scheduler) {
+  constexpr double kDurationMs = 10000.0;
+  constexpr double kTickMs = 0.05;
+  constexpr int kSamplesPeriodTicks = 80;  // 4 ms.
+  constexpr int kBurstPeriodTicks = 2000;  // 100 ms.
+
+  MessageScheduler scheduler(link.mtu);
+  scheduler.set_max_background_frame_size(link.max_background_frame_size);
+  std::deque<Message> fifo;
+  std::vector<double> enqueue_time_ms;
+  std::vector<double> sample_latencies_ms;
+  std::vector<uint8_t> frame(link.mtu);
+  double link_free_ms = 0.0;
+
+  const int num_ticks = static_cast<int>(kDurationMs / kTickMs);
+  for (int tick = 0; tick < num_ticks; ++tick) {
+    const double now_ms = tick * kTickMs;
+    std::vector<Message> arrivals;
+    if (tick % kSamplesPeriodTicks == 0) {
+      arrivals.push_back(MakeMessage(MessageType::kAdpcmAudioSamples, 35,
+                                     enqueue_time_ms.size()));
+      enqueue_time_ms.push_back(now_ms);
+    }
+    if (tick % kBurstPeriodTicks == 7) {
+      for (int i = 0; i < 12; ++i) {
+        const MessageType type = (i % 3 == 0)   ? MessageType::kStatsRecord
+                                 : (i % 3 == 1) ? MessageType::kTemperature
+                                                : MessageType::kBatteryVoltage;
+        arrivals.push_back(MakeMessage(
+            type, (type == MessageType::kStatsRecord) ? 60 : 4,
+            enqueue_time_ms.size()));
+        enqueue_time_ms.push_back(now_ms);
+      }
+    }
+    for (const Message& message : arrivals) {
+      if (use_scheduler) {
+        scheduler.Enqueue(message,
+                          MessageScheduler::DefaultPriority(message.type()));
+      } else {
+        fifo.push_back(message);
+      }
+    }
+
+    if (now_ms < link_free_ms) { continue; }  // Link is busy.
+    int frame_size = 0;
+    if (use_scheduler) {
+      frame_size = scheduler.NextFrame(tick, frame.data());
+    } else if (!fifo.empty()) {
+      frame_size = MessageFramer::WriteBleFrame(&fifo.front(), frame.data());
+      fifo.pop_front();
+    }
+    if (frame_size == 0) { continue; }
+
+    link_free_ms = now_ms + frame_size / link.bytes_per_ms;
+    const double delivered_ms = link_free_ms + link.frame_latency_ms;
+    for (const Message& message : SplitFrame(frame.data(), frame_size)) {
+      if (MessageScheduler::DefaultPriority(message.type()) ==
+          MessageScheduler::kRealTime) {
+        sample_latencies_ms.push_back(delivered_ms -
+                                      enqueue_time_ms[MessageId(message)]);
+      }
+    }
+  }
+
+  CHECK(!sample_latencies_ms.empty());
+  std::sort(sample_latencies_ms.begin(), sample_latencies_ms.end());
+  return sample_latencies_ms[sample_latencies_ms.size() * 99 / 100];
+}
+
+// On simulated links, the scheduler keeps the p99 latency of sample messages
+// low despite housekeeping bursts.
+void TestSimulatedLinks() {
+  puts("TestSimulatedLinks");
+  const LinkParams kLinks[] = {
+      // UART at 1 Mbaud, 10 bits per byte.
+      {"UART 1 Mbaud", 132, 100.0, 0.0, 132},
+      // UART at a lower baud rate to save power.
+      {"UART 250 kbaud", 132, 25.0, 0.0, 132},
+      // BLE with data length extension.
+      {"BLE", 244, 80.0, 1.0, 244},
+      // BLE on a congested link, with limited background frames.
+      {"BLE congested", 244, 30.0, 1.0, 70},
+  };
+
+  for (const LinkParams& link : kLinks) {
+    const double fifo_p99_ms = SimulateLink(link, false);
+    const double scheduler_p99_ms = SimulateLink(link, true);
+    printf("  %-16s sample p99 latency: FIFO %6.2f ms, scheduler %6.2f ms\n",
+           link.name, fifo_p99_ms, scheduler_p99_ms);
+    // With the scheduler, a sample message waits at most for one frame in
+    // flight, then is sent in the next frame.
+    const double bound_ms = 2.0 * link.mtu / link.bytes_per_ms +
+                            link.frame_latency_ms + 0.1;
+    CHECK(scheduler_p99_ms <= bound_ms);
+    CHECK(scheduler_p99_ms <= fifo_p99_ms);
+  }
+}
+
+}  // namespace audio_tactile
+
+// NOLINTEND
+
+int main(int argc, char** argv) {
+  audio_tactile::TestCoalescing();
+  audio_tactile::TestMtu();
+  audio_tactile::TestBackgroundFrameLimit();
+  audio_tactile::TestDeadlines();
+  audio_tactile::TestOverflow();
+  audio_tactile::TestDefaultPriority();
+  audio_tactile::TestSimulatedLinks();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
@@ -14,6 +14,9 @@
 
 #include "src/cpp/message.h"
 
+#include <math.h>
+#include <stdlib.h>
+
 #include <algorithm>
 #include <limits>
 #include <memory>
@@ -65,6 +68,56 @@ void TestAudioSamples() {
   CHECK(std::equal(recovered, recovered + kAdcDataSize, samples.begin()));
 }
 
+// Test the kAdpcmAudioSamples message.
+void TestAdpcmAudioSamples() {
+  puts("TestAdpcmAudioSamples");
+  int16_t samples[kAdcDataSize];
+  for (int i = 0; i < kAdcDataSize; ++i) {
+    samples[i] = static_cast<int16_t>(2000 * sin(0.2 * i));
+  }
+
+  ImaAdpcmState state;
+  ImaAdpcmInit(&state);
+  Message message;
+  // Write twice, so that the second message starts from an adapted state.
+  for (int i = 0; i < 2; ++i) {
+    message.WriteAdpcmAudioSamples(
+        Slice<const int16_t, kAdcDataSize>(samples), &state);
+  }
+  CHECK(message.type() == MessageType::kAdpcmAudioSamples);
+  CHECK(message.payload().size() == ImaAdpcmBlockSize(kAdcDataSize));
+
+  int16_t recovered[kAdcDataSize];
+  CHECK(message.ReadAdpcmAudioSamples(
+      Slice<int16_t, kAdcDataSize>(recovered)));
+  for (int i = 0; i < kAdcDataSize; ++i) {
+    CHECK(abs(recovered[i] - samples[i]) <= 200);
+  }
+  // Reading the wrong number of samples fails.
+  CHECK(!message.ReadAdpcmAudioSamples(Slice<int16_t>(recovered, 32)));
+
+  // Writing an odd number of samples or more than kMaxAdpcmAudioSamples fails
+  // and leaves the message unchanged.
+  const ImaAdpcmState state_before = state;
+  CHECK(!message.WriteAdpcmAudioSamples(
+      Slice<const int16_t>(samples, 31), &state));
+  int16_t too_many[Message::kMaxAdpcmAudioSamples + 2] = {0};
+  CHECK(!message.WriteAdpcmAudioSamples(
+      Slice<const int16_t, Message::kMaxAdpcmAudioSamples + 2>(too_many),
+      &state));
+  CHECK(state.predictor == state_before.predictor &&
+        state.step_index == state_before.step_index);
+  CHECK(message.payload().size() == ImaAdpcmBlockSize(kAdcDataSize));
+  CHECK(message.ReadAdpcmAudioSamples(
+      Slice<int16_t, kAdcDataSize>(recovered)));
+  // The max number of samples fills the payload.
+  int16_t max_samples[Message::kMaxAdpcmAudioSamples] = {0};
+  CHECK(message.WriteAdpcmAudioSamples(
+      Slice<const int16_t, Message::kMaxAdpcmAudioSamples>(max_samples),
+      &state));
+  CHECK(message.payload().size() == Message::kMaxPayloadSize);
+}
+
 // Test the kTactor*Samples messages
 void TestSingleTactorSamples() {
   puts("TestSingleTactorSamples");
@@ -113,6 +166,26 @@ void TestAllTactorsSamples() {
   CHECK(std::equal(recovered, recovered + kSize, samples.begin()));
 }
 
+// Test the kCompressedTactorsSamples message.
+void TestCompressedTactorsSamples() {
+  puts("TestCompressedTactorsSamples");
+  constexpr int kSize = kNumTotalPwm * kNumPwmValues;
+  uint8_t samples[kSize];
+  for (int i = 0; i < kSize; ++i) {  // Slow ramps compress well.
+    samples[i] = static_cast<uint8_t>(100 + (i % kNumTotalPwm) + i / 24);
+  }
+
+  Message message;
+  message.WriteCompressedTactorsSamples(Slice<uint8_t, kSize>(samples));
+  CHECK(message.type() == MessageType::kCompressedTactorsSamples);
+  CHECK(message.payload().size() < kSize);
+
+  uint8_t recovered[kSize];
+  CHECK(message.ReadCompressedTactorsSamples(
+      Slice<uint8_t, kSize>(recovered)));
+  CHECK(std::equal(recovered, recovered + kSize, samples));
+}
+
 // Test the kTemperature message.
 void TestTemperature() {
   puts("TestTemperature");
@@ -403,8 +476,10 @@ void TestSimpleMessages() {
 
 int main(int argc, char** argv) {
   audio_tactile::TestAudioSamples();
+  audio_tactile::TestAdpcmAudioSamples();
   audio_tactile::TestSingleTactorSamples();
   audio_tactile::TestAllTactorsSamples();
+  audio_tactile::TestCompressedTactorsSamples();
   audio_tactile::TestTemperature();
   audio_tactile::TestBatteryVoltage();
   audio_tactile::TestTuning();
@@ -0,0 +1,299 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/cpp/settings_blob.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "src/dsp/channel_map.h"
+#include "src/dsp/logging.h"
+#include "src/dsp/serialize.h"
+#include "src/tactile/tuning.h"
+
+// NOLINTBEGIN(readability/check)
+
+namespace audio_tactile {
+namespace {
+
+// Makes some non-default test settings.
+Settings MakeTestSettings() {
+  Settings settings;
+  strcpy(settings.device_name, "Pineapple");  // NOLINT
+  settings.input = InputSelection::kPdmMic;
+  settings.tuning.values[kKnobInputGain] = 123;
+  settings.tuning.values[kKnobOutputGain] = 72;
+  settings.channel_map.gains[0] = ChannelGainFromControlValue(10);
+  settings.channel_map.gains[1] = ChannelGainFromControlValue(0);
+  settings.channel_map.sources[0] = 2;
+  settings.channel_map.sources[1] = 0;
+  settings.channel_map.sources[2] = 1;
+  return settings;
+}
+
+std::vector<uint8_t> EncodeBlob(const Settings& settings) {
+  uint8_t blob[kSettingsBlobMaxSize];
+  const int size =
+      WriteSettingsBlob(settings, Slice<uint8_t, kSettingsBlobMaxSize>(blob));
+  CHECK(kSettingsBlobHeaderSize + kSettingsBlobChecksumSize < size);
+  CHECK(size <= kSettingsBlobMaxSize);
+  return std::vector<uint8_t>(blob, blob + size);
+}
+
+bool DecodeBlob(const std::vector<uint8_t>& blob, Settings* settings) {
+  return ReadSettingsBlob(Slice<const uint8_t>(blob.data(), blob.size()),
+                          settings);
+}
+
+// Recomputes the header payload size and checksum after editing `blob`.
+void FixUpBlob(std::vector<uint8_t>* blob) {
+  blob->resize(blob->size() - kSettingsBlobChecksumSize);
+  (*blob)[3] = blob->size() - kSettingsBlobHeaderSize;
+  const uint32_t checksum = Fletcher32(blob->data(), blob->size(), 1);
+  blob->resize(blob->size() + kSettingsBlobChecksumSize);
+  LittleEndianWriteU32(checksum,
+                       blob->data() + blob->size() - kSettingsBlobChecksumSize);
+}
+
+// Settings round trip through the blob encoding.
+void TestRoundTrip() {
+  puts("TestRoundTrip");
+  for (const Settings& settings : {Settings(), MakeTestSettings()}) {
+    std::vector<uint8_t> blob = EncodeBlob(settings);
+    CHECK(blob[0] == 'A' && blob[1] == 'S');
+    CHECK(blob[2] == kSettingsBlobVersion);
+
+    Settings recovered;
+    strcpy(recovered.device_name, "Overwritten");  // NOLINT
+    CHECK(DecodeBlob(blob, &recovered));
+    CHECK(recovered == settings);
+  }
+}
+
+// Settings with every field at max size round trip.
+void TestRoundTripMaxSize() {
+  puts("TestRoundTripMaxSize");
+  Settings settings;
+  memset(settings.device_name, 'x', kMaxDeviceNameLength);
+  settings.device_name[kMaxDeviceNameLength] = '\0';
+  for (int knob = 0; knob < kNumTuningKnobs; ++knob) {
+    settings.tuning.values[knob] = 255 - knob;
+  }
+  ChannelMapInit(&settings.channel_map, kChannelMapMaxChannels);
+  for (int c = 0; c < kChannelMapMaxChannels; ++c) {
+    settings.channel_map.sources[c] = kChannelMapMaxChannels - 1 - c;
+    settings.channel_map.gains[c] = ChannelGainFromControlValue(c * 2);
+  }
+
+  std::vector<uint8_t> blob = EncodeBlob(settings);
+  CHECK(static_cast<int>(blob.size()) == kSettingsBlobMaxSize);
+  Settings recovered;
+  CHECK(DecodeBlob(blob, &recovered));
+  CHECK(recovered == settings);
+}
+
+// Settings imported from the text format survive conversion to a blob.
+void TestTextImport() {
+  puts("TestTextImport");
+  const Settings settings = MakeTestSettings();
+  std::string text;
+  CHECK(settings.WriteFile([&text](const char* line) {
+    text += line;
+    text += '\n';
+    return true;
+  }));
+
+  Settings imported;
+  const char* s = text.c_str();
+  imported.ReadFile(
+      [&s](char* buffer, int buffer_size) {
+        if (*s == '\0') { return false; }
+        const char* newline = strchr(s, '\n');
+        int size = newline ? (newline + 1 - s) : strlen(s);
+        if (size >= buffer_size) { size = buffer_size - 1; }
+        memcpy(buffer, s, size);
+        buffer[size] = '\0';
+        s += size;
+        return true;
+      },
+      [](int line_number, const char* message) {
+        fprintf(stderr, "Reading error: %d: %s\n", line_number, message);
+        exit(EXIT_FAILURE);
+      });
+
+  Settings recovered;
+  CHECK(DecodeBlob(EncodeBlob(imported), &recovered));
+  CHECK(recovered == settings);
+}
+
+// Any single bit error or truncation is detected, leaving settings unchanged.
+void TestCorruption() {
+  puts("TestCorruption");
+  const std::vector<uint8_t> blob = EncodeBlob(MakeTestSettings());
+  const Settings original;
+
+  for (int bit = 0; bit < 8 * static_cast<int>(blob.size()); ++bit) {
+    std::vector<uint8_t> corrupted = blob;
+    corrupted[bit / 8] ^= 1 << (bit % 8);
+    Settings settings;
+    CHECK(!DecodeBlob(corrupted, &settings));
+    CHECK(settings == original);
+  }
+
+  for (int size = 0; size < static_cast<int>(blob.size()); ++size) {
+    Settings settings;
+    CHECK(!ReadSettingsBlob(Slice<const uint8_t>(blob.data(), size),
+                            &settings));
+    CHECK(settings == original);
+  }
+
+  // Erased flash reads as 0xff bytes.
+  std::vector<uint8_t> erased(blob.size(), 0xff);
+  Settings settings;
+  CHECK(!DecodeBlob(erased, &settings));
+}
+
+// Blobs with a valid checksum but invalid content are rejected.
+void TestInvalidFields() {
+  puts("TestInvalidFields");
+  const std::vector<uint8_t> blob = EncodeBlob(MakeTestSettings());
+  const int name_length = strlen("Pineapple");
+  const int input_offset = kSettingsBlobHeaderSize + 1 + name_length + 1;
+  const int channel_map_offset = input_offset + 1 + 1 + kNumTuningKnobs + 1;
+
+  {  // Unsupported version.
+    std::vector<uint8_t> modified = blob;
+    modified[2] = kSettingsBlobVersion + 1;
+    FixUpBlob(&modified);
+    Settings settings;
+    CHECK(!DecodeBlob(modified, &settings));
+  }
+  {  // Unknown input selection.
+    std::vector<uint8_t> modified = blob;
+    modified[input_offset] = 2;
+    FixUpBlob(&modified);
+    Settings settings;
+    CHECK(!DecodeBlob(modified, &settings));
+  }
+  {  // Source index beyond number of inputs.
+    std::vector<uint8_t> modified = blob;
+    modified[channel_map_offset + 2] = modified[channel_map_offset];
+    FixUpBlob(&modified);
+    Settings settings;
+    CHECK(!DecodeBlob(modified, &settings));
+  }
+  {  // Gain control value out of range.
+    std::vector<uint8_t> modified = blob;
+    const int num_out = modified[channel_map_offset + 1];
+    modified[channel_map_offset + 2 + num_out] = 64;
+    FixUpBlob(&modified);
+    Settings settings;
+    CHECK(!DecodeBlob(modified, &settings));
+  }
+  {  // Blocks appended by a newer writer are ignored.
+    std::vector<uint8_t> modified = blob;
+    const uint8_t extra_block[] = {3, 1, 2, 3};
+    modified.insert(modified.end() - kSettingsBlobChecksumSize, extra_block,
+                    extra_block + sizeof(extra_block));
+    FixUpBlob(&modified);
+    Settings settings;
+    CHECK(DecodeBlob(modified, &settings));
+    CHECK(settings == MakeTestSettings());
+  }
+}
+
+// SettingsBlobWriter only writes when the encoded settings change.
+void TestWriterSkipsUnchanged() {
+  puts("TestWriterSkipsUnchanged");
+  std::vector<uint8_t> flash;
+  int num_writes = 0;
+  auto write_fun = [&](const uint8_t* data, int size) {
+    flash.assign(data, data + size);
+    ++num_writes;
+    return true;
+  };
+
+  SettingsBlobWriter writer;
+  Settings settings = MakeTestSettings();
+  CHECK(writer.Changed(settings));
+  CHECK(writer.Write(settings, write_fun));
+  CHECK(num_writes == 1);
+  CHECK(!writer.Changed(settings));
+  CHECK(writer.Write(settings, write_fun));
+  CHECK(num_writes == 1);  // Unchanged, so not written.
+
+  // A gain change too small to change its control value doesn't rewrite.
+  settings.channel_map.gains[2] *= 0.9999f;
+  CHECK(writer.Write(settings, write_fun));
+  CHECK(num_writes == 1);
+
+  settings.tuning.values[kKnobOutputGain] = 73;
+  CHECK(writer.Changed(settings));
+  CHECK(writer.Write(settings, write_fun));
+  CHECK(num_writes == 2);
+  Settings recovered;
+  CHECK(DecodeBlob(flash, &recovered));
+  CHECK(recovered.tuning.values[kKnobOutputGain] == 73);
+
+  // After reading a blob on boot, writing the same settings is skipped.
+  SettingsBlobWriter boot_writer;
+  boot_writer.SetStored(Slice<const uint8_t>(flash.data(), flash.size()));
+  CHECK(boot_writer.Write(recovered, write_fun));
+  CHECK(num_writes == 2);
+  boot_writer.Reset();
+  CHECK(boot_writer.Write(recovered, write_fun));
+  CHECK(num_writes == 3);
+}
+
+// A failed write is retried on the next call.
+void TestWriterFailure() {
+  puts("TestWriterFailure");
+  bool fail = true;
+  int num_attempts = 0;
+  auto write_fun = [&](const uint8_t* data, int size) {
+    ++num_attempts;
+    return !fail;
+  };
+
+  SettingsBlobWriter writer;
+  const Settings settings = MakeTestSettings();
+  CHECK(!writer.Write(settings, write_fun));
+  CHECK(writer.Changed(settings));
+  fail = false;
+  CHECK(writer.Write(settings, write_fun));
+  CHECK(num_attempts == 2);
+  CHECK(!writer.Changed(settings));
+}
+
+}  // namespace
+}  // namespace audio_tactile
+
+// NOLINTEND
+
+int main(int argc, char** argv) {
+  audio_tactile::TestRoundTrip();
+  audio_tactile::TestRoundTripMaxSize();
+  audio_tactile::TestTextImport();
+  audio_tactile::TestCorruption();
+  audio_tactile::TestInvalidFields();
+  audio_tactile::TestWriterSkipsUnchanged();
+  audio_tactile::TestWriterFailure();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
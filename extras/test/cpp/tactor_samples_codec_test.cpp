@@ -0,0 +1,165 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/cpp/tactor_samples_codec.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <random>
+
+#include "src/dsp/logging.h"
+
+// NOLINTBEGIN(readability/check)
+
+namespace audio_tactile {
+
+constexpr int kSize = kNumAllTactorsSamples;
+constexpr int kMaxSize = kMaxCompressedTactorsSamplesSize;
+
+// Compresses and decompresses `samples`, checks that they are recovered
+// exactly, and returns the compressed size.
+int RoundTrip(const uint8_t* samples) {
+  uint8_t compressed[kMaxSize];
+  const int size = CompressTactorsSamples(Slice<const uint8_t, kSize>(samples),
+                                          Slice<uint8_t, kMaxSize>(compressed));
+  CHECK(1 <= size && size <= kMaxSize);
+
+  uint8_t recovered[kSize];
+  CHECK(DecompressTactorsSamples(Slice<const uint8_t>(compressed, size),
+                                 Slice<uint8_t, kSize>(recovered)));
+  CHECK(std::equal(recovered, recovered + kSize, samples));
+  return size;
+}
+
+// All-equal samples compress to the minimum size.
+void TestConstant() {
+  puts("TestConstant");
+  uint8_t samples[kSize];
+  for (int value : {0, 1, 128, 255}) {
+    std::fill(samples, samples + kSize, static_cast<uint8_t>(value));
+    CHECK(RoundTrip(samples) == 28);
+  }
+}
+
+// Smooth sinusoids, like envelopes of tactile signals, compress well.
+void TestSmooth() {
+  puts("TestSmooth");
+  uint8_t samples[kSize];
+  for (int start = 0; start < 200; start += 8) {
+    for (int frame = 0; frame < kNumPwmValues; ++frame) {
+      for (int c = 0; c < kNumTotalPwm; ++c) {
+        const float phase = 0.01f * (c + 1) * (start + frame);
+        samples[c + frame * kNumTotalPwm] =
+            static_cast<uint8_t>(128 + 100 * sin(phase));
+      }
+    }
+    CHECK(RoundTrip(samples) < kSize * 3 / 4);
+  }
+}
+
+// Extreme deltas of +/-128 and +/-127 are coded correctly.
+void TestExtremeDeltas() {
+  puts("TestExtremeDeltas");
+  uint8_t samples[kSize];
+  for (int i = 0; i < kSize; ++i) {
+    const int frame = i / kNumTotalPwm;
+    const int c = i % kNumTotalPwm;
+    samples[i] = (c % 2) ? ((frame % 2) ? 0 : 255) : ((frame % 2) ? 0 : 128);
+  }
+  RoundTrip(samples);
+}
+
+// Random samples don't compress, and fall back to raw at a 1-byte overhead.
+void TestRandom() {
+  puts("TestRandom");
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> byte_dist(0, 255);
+  std::uniform_int_distribution<int> amplitude_dist(0, 8);
+  uint8_t samples[kSize];
+  for (int trial = 0; trial < 500; ++trial) {
+    // Vary the amplitude of the noise to cover all Rice parameters.
+    const int amplitude = 1 << amplitude_dist(rng);
+    const int base = byte_dist(rng);
+    for (int i = 0; i < kSize; ++i) {
+      samples[i] = static_cast<uint8_t>(base + byte_dist(rng) % amplitude);
+    }
+    const int size = RoundTrip(samples);
+    if (amplitude == 256) { CHECK(size == kMaxSize); }
+  }
+}
+
+// Invalid or truncated input is rejected without reading out of bounds.
+void TestInvalid() {
+  puts("TestInvalid");
+  uint8_t samples[kSize];
+  for (int i = 0; i < kSize; ++i) {
+    samples[i] = static_cast<uint8_t>(i * i / 50);
+  }
+  uint8_t compressed[kMaxSize];
+  const int size = CompressTactorsSamples(Slice<const uint8_t, kSize>(samples),
+                                          Slice<uint8_t, kMaxSize>(compressed));
+  CHECK(size < kSize);
+
+  uint8_t recovered[kSize];
+  Slice<uint8_t, kSize> output(recovered);
+  // Empty input.
+  CHECK(!DecompressTactorsSamples(Slice<const uint8_t>(compressed, 0), output));
+  // Truncated input.
+  for (int n = 1; n < size - 1; ++n) {
+    CHECK(!DecompressTactorsSamples(Slice<const uint8_t>(compressed, n),
+                                    output));
+  }
+  // Unknown format.
+  compressed[0] = 2;
+  CHECK(!DecompressTactorsSamples(Slice<const uint8_t>(compressed, size),
+                                  output));
+  // Raw format with the wrong size.
+  compressed[0] = 0;
+  CHECK(!DecompressTactorsSamples(Slice<const uint8_t>(compressed, size),
+                                  output));
+  // Rice code with a unary part that is too long.
+  uint8_t all_ones[kMaxSize];
+  std::fill(all_ones, all_ones + kMaxSize, 0xff);
+  all_ones[0] = 1;
+  CHECK(!DecompressTactorsSamples(Slice<const uint8_t>(all_ones, kMaxSize),
+                                  output));
+
+  // Random garbage never crashes.
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> byte_dist(0, 255);
+  for (int trial = 0; trial < 1000; ++trial) {
+    const int n = byte_dist(rng) % kMaxSize;
+    for (int i = 0; i < n; ++i) {
+      compressed[i] = static_cast<uint8_t>(byte_dist(rng));
+    }
+    if (n > 0) { compressed[0] = 1; }
+    DecompressTactorsSamples(Slice<const uint8_t>(compressed, n), output);
+  }
+}
+
+}  // namespace audio_tactile
+
+// NOLINTEND
+
+int main(int argc, char** argv) {
+  audio_tactile::TestConstant();
+  audio_tactile::TestSmooth();
+  audio_tactile::TestExtremeDeltas();
+  audio_tactile::TestRandom();
+  audio_tactile::TestInvalid();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
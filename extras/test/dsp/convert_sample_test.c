@@ -18,6 +18,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "src/dsp/logging.h"
 
@@ -126,11 +127,167 @@ static void TestConvertFloatTo0_MaxValue(void) {
   CHECK(ConvertSampleFloatTo0_MaxValue(0.25f, 8192) == 5120);
 }
 
+/* Float test values, including out-of-range values and rounding ties. */
+static float RandTestFloat(void) {
+  switch (rand() % 4) {
+    case 0:
+      return 4.0f * RandUniform() - 2.0f;
+    case 1: /* Halfway between two int16 values. */
+      return ((rand() % 65536) - 32768 + 0.5f) / 32768.0f;
+    case 2:
+      return (rand() % 2) ? 1.0f : -1.0f;
+    default:
+      return 2.0f * RandUniform() - 1.0f;
+  }
+}
+
+/* The vectorized array functions should match the single-sample functions
+ * exactly, for any array length and alignment.
+ */
+static void TestArrayMatchesSingleSample(void) {
+  puts("TestArrayMatchesSingleSample");
+  const int kMaxNum = 40;
+  float in_float[41];
+  int16_t in_int16[41];
+  int32_t in_int32[41];
+  float out_float[41];
+  int16_t out_int16[41];
+  int32_t out_int32[41];
+  int offset;
+  int num;
+  int i;
+
+  for (offset = 0; offset < 2; ++offset) {
+    for (num = 0; num <= kMaxNum; ++num) {
+      for (i = 0; i < num; ++i) {
+        in_float[offset + i] = RandTestFloat();
+        in_int16[offset + i] = (int16_t)((rand() % 65536) - 32768);
+        in_int32[offset + i] = (int32_t)(4294967294.0 * (RandUniform() - 0.5));
+      }
+      in_int16[offset] = INT16_MIN;
+      in_int32[offset] = INT32_MIN;
+
+      ConvertSampleArrayFloatToInt16(in_float + offset, num, out_int16);
+      for (i = 0; i < num; ++i) {
+        CHECK(out_int16[i] == ConvertSampleFloatToInt16(in_float[offset + i]));
+      }
+      ConvertSampleArrayFloatToInt32(in_float + offset, num, out_int32);
+      for (i = 0; i < num; ++i) {
+        CHECK(out_int32[i] == ConvertSampleFloatToInt32(in_float[offset + i]));
+      }
+      ConvertSampleArrayInt16ToFloat(in_int16 + offset, num, out_float);
+      for (i = 0; i < num; ++i) {
+        CHECK(out_float[i] == ConvertSampleInt16ToFloat(in_int16[offset + i]));
+      }
+      ConvertSampleArrayInt32ToFloat(in_int32 + offset, num, out_float);
+      for (i = 0; i < num; ++i) {
+        CHECK(out_float[i] == ConvertSampleInt32ToFloat(in_int32[offset + i]));
+      }
+    }
+  }
+}
+
+static void TestConvertWithGain(void) {
+  puts("TestConvertWithGain");
+  const int kNum = 100;
+  const float kGain = 0.175f;
+  int16_t in_int16[100];
+  int32_t in_int32[100];
+  float out[100];
+  int i;
+  for (i = 0; i < kNum; ++i) {
+    in_int16[i] = (int16_t)((rand() % 65536) - 32768);
+    in_int32[i] = (int32_t)(4294967294.0 * (RandUniform() - 0.5));
+  }
+
+  ConvertSampleArrayInt16ToFloatWithGain(in_int16, kNum, kGain, out);
+  for (i = 0; i < kNum; ++i) {
+    CHECK(fabs(out[i] - kGain * ConvertSampleInt16ToFloat(in_int16[i]))
+          <= 1e-7f);
+  }
+  ConvertSampleArrayInt32ToFloatWithGain(in_int32, kNum, kGain, out);
+  for (i = 0; i < kNum; ++i) {
+    CHECK(fabs(out[i] - kGain * ConvertSampleInt32ToFloat(in_int32[i]))
+          <= 1e-7f);
+  }
+
+  /* With gain 16, 12-bit ADC values in [-2048, 2048] map to [-1, 1]. */
+  in_int16[0] = -2048;
+  in_int16[1] = 1024;
+  ConvertSampleArrayInt16ToFloatWithGain(in_int16, 2, 16.0f, out);
+  CHECK(out[0] == -1.0f);
+  CHECK(out[1] == 0.5f);
+}
+
+static void TestPacked24(void) {
+  puts("TestPacked24");
+  const int kMaxNum = 20;
+  const uint8_t kSentinel = 0xa5;
+  int32_t samples[20];
+  int32_t unpacked[20];
+  uint8_t packed[61];
+  int num;
+  int i;
+
+  for (num = 0; num <= kMaxNum; ++num) {
+    for (i = 0; i < num; ++i) {
+      samples[i] = (int32_t)(4294967294.0 * (RandUniform() - 0.5));
+    }
+    memset(packed, kSentinel, sizeof(packed));
+    ConvertSampleArrayInt32ToPacked24(samples, num, packed);
+    CHECK(packed[3 * num] == kSentinel);  /* Didn't write past the end. */
+    for (i = 0; i < num; ++i) {
+      const uint32_t value = (uint32_t)samples[i];
+      CHECK(packed[3 * i] == (uint8_t)(value >> 8));
+      CHECK(packed[3 * i + 1] == (uint8_t)(value >> 16));
+      CHECK(packed[3 * i + 2] == (uint8_t)(value >> 24));
+    }
+
+    ConvertSampleArrayPacked24ToInt32(packed, num, unpacked);
+    for (i = 0; i < num; ++i) {
+      /* Round trip preserves all but the low 8 bits. */
+      CHECK(unpacked[i] == (int32_t)((uint32_t)samples[i] & 0xffffff00));
+    }
+  }
+
+  const uint8_t kBytes[6] = {0x01, 0x02, 0x03, 0xff, 0xff, 0xff};
+  ConvertSampleArrayPacked24ToInt32(kBytes, 2, unpacked);
+  CHECK(unpacked[0] == INT32_C(0x03020100));
+  CHECK(unpacked[1] == -256);
+}
+
+static void TestMulaw(void) {
+  puts("TestMulaw");
+  uint8_t codes[256];
+  int16_t decoded[256];
+  int i;
+  for (i = 0; i < 256; ++i) {
+    codes[i] = (uint8_t)i;
+  }
+  ConvertSampleArrayMulawToInt16(codes, 256, decoded);
+  for (i = 0; i < 256; ++i) {
+    /* Compare with the G.711 decoding formula. */
+    const int inverted = ~i & 0xff;
+    const int exponent = (inverted >> 4) & 7;
+    const int magnitude = (((inverted & 0xf) << 3) + 0x84) << exponent;
+    const int expected = (inverted & 0x80) ? 0x84 - magnitude
+                                           : magnitude - 0x84;
+    CHECK(decoded[i] == expected);
+  }
+  CHECK(decoded[0x00] == -32124);
+  CHECK(decoded[0x80] == 32124);
+  CHECK(decoded[0xff] == 0);
+}
+
 int main(int argc, char** argv) {
   srand(0);
   TestConvertInt16ToFromFloat();
   TestConvertInt32ToFromFloat();
   TestConvertFloatTo0_MaxValue();
+  TestArrayMatchesSingleSample();
+  TestConvertWithGain();
+  TestPacked24();
+  TestMulaw();
 
   puts("PASS");
   return EXIT_SUCCESS;
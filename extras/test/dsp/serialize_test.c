@@ -337,6 +337,57 @@ static void TestFletcher16(void) {
   free(data);
 }
 
+/* A "naive" implementation of Fletcher-32 with modulo by 65535 on every
+ * step.
+ */
+static uint32_t Fletcher32Naive(const uint8_t* data, size_t size) {
+  uint32_t sum1 = 1;
+  uint32_t sum2 = 0;
+  size_t i;
+  for (i = 0; i < size; ++i) {
+    sum1 = (sum1 + data[i]) % 65535;
+    sum2 = (sum2 + sum1) % 65535;
+  }
+  return (sum2 << 16) | sum1;
+}
+
+/* Test Fletcher-32 checksum. */
+static void TestFletcher32(void) {
+  puts("TestFletcher32");
+  /* Large enough to span several blocks of the deferred modulo. */
+  const int size = 20000;
+  uint8_t* data = (uint8_t*)CHECK_NOTNULL(malloc(size));
+
+  /* Compare with naive implementation, including worst case all-0xff data. */
+  int trial;
+  for(trial = 0; trial < 3; ++trial) {
+    int i;
+    for (i = 0; i < size; ++i) {
+      data[i] = (trial == 0) ? 0xff : rand() % 256;
+    }
+    CHECK(Fletcher32(data, size, 1) == Fletcher32Naive(data, size));
+  }
+
+  /* Check that streaming computation across multiple calls agrees. */
+  const uint32_t nonstreaming = Fletcher32(data, size, 1);
+
+  uint32_t streaming = 1;
+  int start;
+  for (start = 0; start < size;) {
+    int block_size = rand() % 500;
+    if (size - start < block_size) { block_size = size - start; }
+    streaming = Fletcher32(data + start, block_size, streaming);
+    start += block_size;
+  }
+  CHECK(streaming == nonstreaming);
+
+  /* A single flipped bit changes the checksum. */
+  data[size / 2] ^= 4;
+  CHECK(Fletcher32(data, size, 1) != nonstreaming);
+
+  free(data);
+}
+
 int main(int argc, char** argv) {
   srand(0);
   TestU16();
@@ -349,6 +400,7 @@ int main(int argc, char** argv) {
   TestF64();
   TestFletcher8();
   TestFletcher16();
+  TestFletcher32();
 
   puts("PASS");
   return EXIT_SUCCESS;
@@ -18,6 +18,7 @@
 #include <string.h>
 
 #include "src/dsp/logging.h"
+#include "src/dsp/serialize.h"
 #include "src/dsp/write_wav_file_generic.h"
 
 /*
@@ -87,6 +88,18 @@ static const uint8_t kTest24BitMonoOddWavFile[90] = {
 /*                                          pad */
     0,  7,  0,  0,  254, 255, 0,  255, 127, 0};
 
+/* A 16kHz stereo float WAV file with samples {{0.5, -0.25}, {1.0, -1.0}}. */
+static const uint8_t kTestStereoFloatWavFile[96] = {
+/*  R   I   F   F                   W   A   V   E   f    m    t    _ */
+    82, 73, 70, 70, 88,  0,   0, 0, 87, 65, 86, 69, 102, 109, 116, 32,
+    40, 0,  0,  0,  254, 255, 2, 0, 128, 62, 0, 0, 0, 244, 1,   0,
+    8,  0,  32, 0,  22,  0,   32, 0, 3, 0,   0,  0, 3,   0,   0,   0,
+/*                                                f    a    c    t   */
+    0,  0,  16, 0,  128, 0,   0, 170, 0, 56, 155, 113, 102, 97, 99, 116,
+/*                                d    a    t    a                   */
+    4,  0,  0,  0,  2,   0,   0, 0, 100, 97, 116, 97, 16, 0,   0,   0,
+    0,  0,  0,  63, 0,   0, 128, 190, 0, 0, 128, 63,  0,  0, 128, 191};
+
 static void CheckFileBytes(const char* file_name, const uint8_t* expected_bytes,
                            size_t num_bytes) {
   uint8_t* bytes = CHECK_NOTNULL((uint8_t *) malloc(num_bytes + 1));
@@ -174,12 +187,70 @@ static void TestWriteMono24BitWavPadding(void) {
   remove(wav_file_name);
 }
 
+static void TestWriteStereoFloatWav(void) {
+  puts("TestWriteStereoFloatWav");
+  static const float kSamples[4] = {0.5f, -0.25f, 1.0f, -1.0f};
+  const char* wav_file_name = NULL;
+
+  wav_file_name = CHECK_NOTNULL(tmpnam(NULL));
+  CHECK(WriteWavFileFloat(wav_file_name, kSamples, 4, 16000, 2));
+
+  CheckFileBytes(wav_file_name, kTestStereoFloatWavFile, 96);
+  remove(wav_file_name);
+}
+
+static void TestWriteManyChannelFloatWavStreaming(void) {
+  puts("TestWriteManyChannelFloatWavStreaming");
+  const int kNumChannels = 12;
+  const int kNumFrames = 300;
+  const size_t num_samples = kNumChannels * kNumFrames;
+  float* samples = (float*)CHECK_NOTNULL(malloc(num_samples * sizeof(float)));
+  size_t i;
+  for (i = 0; i < num_samples; ++i) {
+    samples[i] = 0.001f * i - 1.0f;
+  }
+  const char* wav_file_name = NULL;
+
+  wav_file_name = CHECK_NOTNULL(tmpnam(NULL));
+  FILE* f = NULL;
+  CHECK(f = fopen(wav_file_name, "wb"));
+  CHECK(WriteWavHeaderFloat(f, 0, 16000, kNumChannels)); /* Dummy header. */
+  CHECK(WriteWavSamplesFloat(f, samples, 5 * kNumChannels));
+  CHECK(WriteWavSamplesFloat(f, samples + 5 * kNumChannels,
+                             num_samples - 5 * kNumChannels));
+  fseek(f, 0, SEEK_SET);
+  CHECK(WriteWavHeaderFloat(f, num_samples, 16000, kNumChannels));
+  fclose(f);
+
+  const size_t num_bytes = 80 + 4 * num_samples;
+  uint8_t* bytes = CHECK_NOTNULL((uint8_t*)malloc(num_bytes + 1));
+  CHECK(f = fopen(wav_file_name, "rb"));
+  CHECK(fread(bytes, 1, num_bytes + 1, f) == num_bytes);
+  fclose(f);
+  CHECK(LittleEndianReadU32(bytes + 4) == num_bytes - 8);
+  CHECK(LittleEndianReadU16(bytes + 20) == 0xFFFE);
+  CHECK(LittleEndianReadU16(bytes + 22) == kNumChannels);
+  CHECK(LittleEndianReadU32(bytes + 40) == 0); /* No speaker assignment. */
+  CHECK(LittleEndianReadU16(bytes + 44) == 3); /* IEEE float sub format. */
+  CHECK(LittleEndianReadU32(bytes + 68) == kNumFrames);
+  CHECK(LittleEndianReadU32(bytes + 76) == 4 * num_samples);
+  for (i = 0; i < num_samples; ++i) {
+    CHECK(LittleEndianReadF32(bytes + 80 + 4 * i) == samples[i]);
+  }
+
+  free(bytes);
+  free(samples);
+  remove(wav_file_name);
+}
+
 int main(int argc, char** argv) {
   TestWriteMonoWav();
   TestWriteMonoWavStreaming();
   TestWrite3ChannelWav();
   TestWriteMono24BitWav();
   TestWriteMono24BitWavPadding();
+  TestWriteStereoFloatWav();
+  TestWriteManyChannelFloatWavStreaming();
 
   puts("PASS");
   return EXIT_SUCCESS;
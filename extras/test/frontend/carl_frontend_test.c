@@ -115,13 +115,13 @@ static float FindMax(const float* values, int size, int* max_index) {
 }
 
 /* Tests response to sine wave inputs. */
-static void TestResponse(void) {
-  puts("TestResponse");
+static void TestResponse(int block_size) {
+  printf("TestResponse(%d)\n", block_size);
   CarlFrontendParams params = kCarlFrontendDefaultParams;
+  params.block_size = block_size;
   CarlFrontend* frontend = CHECK_NOTNULL(CarlFrontendMake(&params));
 
   const float dt = 1.0f / params.input_sample_rate_hz;
-  const int block_size = params.block_size;
   const int num_channels = CarlFrontendNumChannels(frontend);
   float* input = (float*)CHECK_NOTNULL(malloc(block_size * sizeof(float)));
   float* output = (float*)CHECK_NOTNULL(malloc(num_channels * sizeof(float)));
@@ -196,9 +196,9 @@ static void TestInvalidParameters(void) {
     params.step_erbs = 1e-6f;
     CHECK(CarlFrontendMake(&params) == NULL);
   }
-  { /* Non-power of 2 block_size. */
+  { /* Nonpositive block_size. */
     CarlFrontendParams params = kCarlFrontendDefaultParams;
-    params.block_size = 15;
+    params.block_size = 0;
     CHECK(CarlFrontendMake(&params) == NULL);
   }
   { /* Diffusivity too large for output sample rate. */
@@ -212,7 +212,8 @@ static void TestInvalidParameters(void) {
 
 int main(int argc, char** argv) {
   TestDesign();
-  TestResponse();
+  TestResponse(64);
+  TestResponse(48);  /* Non-power-of-two block_size. */
   TestInvalidParameters();
 
   puts("PASS");
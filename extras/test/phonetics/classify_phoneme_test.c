@@ -204,12 +204,71 @@ static void TestLabelOutput(void) {
   free(frames);
 }
 
+/* Checks that ClassifyPhonemeBatch matches calling ClassifyPhoneme on each
+ * sliding window of frames.
+ */
+static void TestBatch(int num_outputs) {
+  printf("TestBatch(%d)\n", num_outputs);
+  const int num_frames = num_outputs + kClassifyPhonemeNumFrames - 1;
+  const int kInputSize = num_frames * kClassifyPhonemeNumChannels;
+  float* frames = (float*)CHECK_NOTNULL(malloc(sizeof(float) * kInputSize));
+  ClassifyPhonemeLabels* labels = (ClassifyPhonemeLabels*)CHECK_NOTNULL(
+      malloc(sizeof(ClassifyPhonemeLabels) * num_outputs));
+  ClassifyPhonemeLabels* labels_no_scores =
+      (ClassifyPhonemeLabels*)CHECK_NOTNULL(
+          malloc(sizeof(ClassifyPhonemeLabels) * num_outputs));
+  ClassifyPhonemeScores* scores = (ClassifyPhonemeScores*)CHECK_NOTNULL(
+      malloc(sizeof(ClassifyPhonemeScores) * num_outputs));
+
+  int i;
+  for (i = 0; i < kInputSize; ++i) {
+    frames[i] = rand() / (float)RAND_MAX;
+  }
+
+  ClassifyPhonemeBatch(frames, num_outputs, labels, scores);
+  ClassifyPhonemeBatch(frames, num_outputs, labels_no_scores, NULL);
+
+  int t;
+  for (t = 0; t < num_outputs; ++t) {
+    ClassifyPhonemeLabels expected_labels;
+    ClassifyPhonemeScores expected_scores;
+    ClassifyPhoneme(frames + t * kClassifyPhonemeNumChannels,
+                    &expected_labels, &expected_scores);
+
+    CHECK(labels[t].phoneme == expected_labels.phoneme);
+    CHECK(labels[t].manner == expected_labels.manner);
+    CHECK(labels[t].place == expected_labels.place);
+    CHECK(labels[t].vad == expected_labels.vad);
+    CHECK(labels[t].voiced == expected_labels.voiced);
+    CHECK(labels_no_scores[t].phoneme == expected_labels.phoneme);
+
+    for (i = 0; i < kClassifyPhonemeNumPhonemes; ++i) {
+      CHECK(fabs(scores[t].phoneme[i] - expected_scores.phoneme[i]) <= 1e-6f);
+    }
+    for (i = 0; i < kClassifyPhonemeNumManners; ++i) {
+      CHECK(fabs(scores[t].manner[i] - expected_scores.manner[i]) <= 1e-6f);
+    }
+    for (i = 0; i < kClassifyPhonemeNumPlaces; ++i) {
+      CHECK(fabs(scores[t].place[i] - expected_scores.place[i]) <= 1e-6f);
+    }
+    CHECK(fabs(scores[t].vad - expected_scores.vad) <= 1e-6f);
+    CHECK(fabs(scores[t].voiced - expected_scores.voiced) <= 1e-6f);
+  }
+
+  free(scores);
+  free(labels_no_scores);
+  free(labels);
+  free(frames);
+}
+
 int main(int argc, char** argv) {
   srand(0);
   TestPhoneme("ae");
   TestPhoneme("er");
   TestPhoneme("z");
   TestLabelOutput();
+  TestBatch(1);
+  TestBatch(75);
 
   puts("PASS");
   return EXIT_SUCCESS;
@@ -64,6 +64,144 @@ static void FillRandomValues(float* x, int size) {
   }
 }
 
+/* Compares batched dense layers to calling the unbatched layer on each row. */
+static void TestDenseLayersBatch(int num_rows, int in_size, int in_stride,
+                                 int out_size) {
+  printf("TestDenseLayersBatch(%d, %d, %d, %d)\n",
+         num_rows, in_size, in_stride, out_size);
+  const int in_total = (num_rows - 1) * in_stride + in_size;
+  float* in = (float*) CHECK_NOTNULL(malloc(in_total * sizeof(float)));
+  float* weights = (float*) CHECK_NOTNULL(malloc(
+      in_size * out_size * sizeof(float)));
+  float* bias = (float*) CHECK_NOTNULL(malloc(out_size * sizeof(float)));
+  float* out = (float*) CHECK_NOTNULL(malloc(
+      num_rows * out_size * sizeof(float)));
+  float* expected = (float*) CHECK_NOTNULL(malloc(out_size * sizeof(float)));
+
+  FillRandomValues(in, in_total);
+  FillRandomValues(weights, in_size * out_size);
+  FillRandomValues(bias, out_size);
+
+  int relu;
+  for (relu = 0; relu <= 1; ++relu) {
+    if (relu) {
+      DenseReluLayerBatch(num_rows, in_size, in_stride, out_size,
+                          in, weights, bias, out);
+    } else {
+      DenseLinearLayerBatch(num_rows, in_size, in_stride, out_size,
+                            in, weights, bias, out);
+    }
+
+    int n;
+    for (n = 0; n < num_rows; ++n) {
+      if (relu) {
+        DenseReluLayer(in_size, out_size, in + n * in_stride,
+                       weights, bias, expected);
+      } else {
+        DenseLinearLayer(in_size, out_size, in + n * in_stride,
+                         weights, bias, expected);
+      }
+      int j;
+      for (j = 0; j < out_size; ++j) {
+        CHECK(fabs(out[n * out_size + j] - expected[j]) <= 1e-6f);
+      }
+    }
+  }
+
+  free(expected);
+  free(out);
+  free(bias);
+  free(weights);
+  free(in);
+}
+
+/* Tests sparse dense layers against dense layers on the same weights. */
+static void TestSparseDenseLayers(int block_size) {
+  printf("TestSparseDenseLayers(%d)\n", block_size);
+  const int kInSize = 24;
+  const int kOutSize = 7;
+  float* in = (float*) CHECK_NOTNULL(malloc(kInSize * sizeof(float)));
+  float* weights = (float*) CHECK_NOTNULL(malloc(
+      kInSize * kOutSize * sizeof(float)));
+  float* bias = (float*) CHECK_NOTNULL(malloc(kOutSize * sizeof(float)));
+  float* out = (float*) CHECK_NOTNULL(malloc(kOutSize * sizeof(float)));
+  float* expected = (float*) CHECK_NOTNULL(malloc(kOutSize * sizeof(float)));
+
+  FillRandomValues(in, kInSize);
+  FillRandomValues(weights, kInSize * kOutSize);
+  FillRandomValues(bias, kOutSize);
+
+  /* Zero out about half of the blocks. */
+  const int num_dense_blocks = kInSize * kOutSize / block_size;
+  int num_nonzero_blocks = 0;
+  int b;
+  for (b = 0; b < num_dense_blocks; ++b) {
+    if (rand() % 2) {
+      int i;
+      for (i = 0; i < block_size; ++i) {
+        weights[b * block_size + i] = 0.0f;
+      }
+    } else {
+      ++num_nonzero_blocks;
+    }
+  }
+
+  BlockSparseMatrix* sparse = CHECK_NOTNULL(BlockSparseMatrixMake(
+      kInSize, kOutSize, block_size, weights, 0.0f));
+  CHECK(BlockSparseMatrixNumBlocks(sparse) == num_nonzero_blocks);
+
+  int trial;
+  for (trial = 0; trial < 3; ++trial) {
+    FillRandomValues(in, kInSize);
+    int j;
+    SparseDenseLinearLayer(sparse, in, bias, out);
+    DenseLinearLayer(kInSize, kOutSize, in, weights, bias, expected);
+    for (j = 0; j < kOutSize; ++j) {
+      CHECK(fabs(out[j] - expected[j]) <= 1e-6f);
+    }
+    SparseDenseReluLayer(sparse, in, bias, out);
+    DenseReluLayer(kInSize, kOutSize, in, weights, bias, expected);
+    for (j = 0; j < kOutSize; ++j) {
+      CHECK(fabs(out[j] - expected[j]) <= 1e-6f);
+    }
+  }
+  BlockSparseMatrixFree(sparse);
+
+  /* With a pruning threshold, blocks with small norm are dropped. */
+  const float kThreshold = 0.3f;
+  sparse = CHECK_NOTNULL(BlockSparseMatrixMake(
+      kInSize, kOutSize, block_size, weights, kThreshold));
+  for (b = 0; b < num_dense_blocks; ++b) {
+    float norm_squared = 0.0f;
+    int i;
+    for (i = 0; i < block_size; ++i) {
+      norm_squared += weights[b * block_size + i] * weights[b * block_size + i];
+    }
+    if (norm_squared <= kThreshold * kThreshold) {
+      for (i = 0; i < block_size; ++i) {
+        weights[b * block_size + i] = 0.0f;
+      }
+    }
+  }
+  SparseDenseLinearLayer(sparse, in, bias, out);
+  DenseLinearLayer(kInSize, kOutSize, in, weights, bias, expected);
+  int j;
+  for (j = 0; j < kOutSize; ++j) {
+    CHECK(fabs(out[j] - expected[j]) <= 1e-5f);
+  }
+  BlockSparseMatrixFree(sparse);
+
+  /* in_size must be a multiple of block_size. */
+  CHECK(BlockSparseMatrixMake(kInSize + 1, kOutSize, block_size,
+                              weights, 0.0f) == NULL);
+
+  free(expected);
+  free(out);
+  free(bias);
+  free(weights);
+  free(in);
+}
+
 static void TestConv1DReluLayer(int in_channels, int out_channels) {
   printf("TestConv1DReluLayer(%d, %d)\n", in_channels, out_channels);
   const int kInFrames = 5;
@@ -165,6 +303,13 @@ static void TestSoftmax(void) {
 int main(int argc, char** argv) {
   srand(0);
   TestDenseLayers();
+  TestDenseLayersBatch(1, 3, 3, 2);
+  TestDenseLayersBatch(16, 8, 8, 4);
+  TestDenseLayersBatch(37, 20, 20, 11);  /* Leftover rows and columns. */
+  TestDenseLayersBatch(50, 35, 7, 9);  /* Overlapping input rows. */
+  TestSparseDenseLayers(4);
+  TestSparseDenseLayers(8);
+  TestSparseDenseLayers(3);
   TestConv1DReluLayer(1, 1);
   TestConv1DReluLayer(3, 2);
   TestConv1DReluLayer(2, 3);
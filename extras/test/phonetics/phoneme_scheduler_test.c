@@ -0,0 +1,212 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Tests for phoneme_scheduler.
+ */
+
+#include "src/phonetics/phoneme_scheduler.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/dsp/logging.h"
+#include "src/dsp/read_wav_file.h"
+
+#define kBlockSize kPhonemeSchedulerBlockSize
+
+/* Low-level background noise. */
+static float Noise(void) {
+  return 1e-4f * ((float)rand() / RAND_MAX - 0.5f);
+}
+
+/* In silence, the network runs once every `silence_interval_blocks` and the
+ * labels are silence.
+ */
+static void TestSilenceCadence(void) {
+  puts("TestSilenceCadence");
+  PhonemeSchedulerParams params;
+  PhonemeSchedulerSetDefaultParams(&params);
+  params.silence_interval_blocks = 10;
+  PhonemeScheduler* scheduler = CHECK_NOTNULL(PhonemeSchedulerMake(&params));
+
+  const int kNumBlocks = 200;
+  float input[kBlockSize];
+  int num_evals = 0;
+  int b;
+  for (b = 0; b < kNumBlocks; ++b) {
+    int i;
+    for (i = 0; i < kBlockSize; ++i) {
+      input[i] = Noise();
+    }
+    ClassifyPhonemeLabels labels;
+    ClassifyPhonemeScores scores;
+    const float prev_silence_score = scheduler->scores.phoneme[0];
+    const int evaluated = PhonemeSchedulerProcessSamples(scheduler, input,
+                                                         &labels, &scores);
+    num_evals += evaluated;
+    CHECK(labels.phoneme == 0);
+    CHECK(!labels.vad);
+    if (!evaluated) {  /* Held scores decay toward silence. */
+      CHECK(scores.phoneme[0] >= prev_silence_score);
+    }
+  }
+
+  CHECK(abs(num_evals - kNumBlocks / params.silence_interval_blocks) <= 1);
+  CHECK(scheduler->num_blocks == kNumBlocks);
+  CHECK(scheduler->num_evals == num_evals);
+
+  PhonemeSchedulerFree(scheduler);
+}
+
+/* Stationary noise above min_energy after a lead-in of digital silence should
+ * still be gated, with the network running at the silence cadence.
+ */
+static void TestNoiseAfterZeroLeadIn(void) {
+  puts("TestNoiseAfterZeroLeadIn");
+  PhonemeSchedulerParams params;
+  PhonemeSchedulerSetDefaultParams(&params);
+  params.silence_interval_blocks = 10;
+  PhonemeScheduler* scheduler = CHECK_NOTNULL(PhonemeSchedulerMake(&params));
+
+  const int kNumLeadInBlocks = 2;
+  const int kNumBlocks = 500;
+  float input[kBlockSize];
+  int num_evals = 0;
+  int b;
+  for (b = 0; b < kNumLeadInBlocks + kNumBlocks; ++b) {
+    int i;
+    for (i = 0; i < kBlockSize; ++i) {
+      /* Noise at about -50 dB, well above min_energy_db = -70 dB. */
+      input[i] = (b < kNumLeadInBlocks) ? 0.0f : 100.0f * Noise();
+    }
+    ClassifyPhonemeLabels labels;
+    ClassifyPhonemeScores scores;
+    const int evaluated = PhonemeSchedulerProcessSamples(scheduler, input,
+                                                         &labels, &scores);
+    if (b >= kNumLeadInBlocks) { num_evals += evaluated; }
+  }
+
+  /* Allow a few evaluations as the noise floor adapts. */
+  CHECK(num_evals <= kNumBlocks / params.silence_interval_blocks + 5);
+
+  PhonemeSchedulerFree(scheduler);
+}
+
+/* Runs on a phone recording padded with silence. The network should run on
+ * every block of the phone, giving the same labels as ungated classification,
+ * and the labels should return to silence after the hangover.
+ */
+static void TestPhoneWithSilence(void) {
+  puts("TestPhoneWithSilence");
+  size_t num_phone_samples;
+  int num_channels;
+  int sample_rate_hz;
+  int16_t* phone = (int16_t*)CHECK_NOTNULL(Read16BitWavFile(
+      "extras/test/testdata/phone_aa.wav", &num_phone_samples,
+      &num_channels, &sample_rate_hz));
+  CHECK(num_channels == 1);
+  CHECK(sample_rate_hz == kPhonemeSchedulerSampleRateHz);
+
+  const int kPadBlocks = 60;
+  const int phone_blocks = (int)num_phone_samples / kBlockSize;
+  const int num_blocks = kPadBlocks + phone_blocks + kPadBlocks;
+
+  PhonemeSchedulerParams params;
+  PhonemeSchedulerSetDefaultParams(&params);
+  PhonemeScheduler* scheduler = CHECK_NOTNULL(PhonemeSchedulerMake(&params));
+
+  /* Reference: frontend + ClassifyPhoneme on every block. */
+  CarlFrontendParams frontend_params = kCarlFrontendDefaultParams;
+  frontend_params.input_sample_rate_hz = kPhonemeSchedulerSampleRateHz;
+  frontend_params.block_size = kBlockSize;
+  frontend_params.pcen_cross_channel_diffusivity = 60.0f;
+  CarlFrontend* frontend = CHECK_NOTNULL(CarlFrontendMake(&frontend_params));
+  const int num_channels_carl = kClassifyPhonemeNumChannels;
+  const int window_size = kClassifyPhonemeNumFrames * num_channels_carl;
+  float* frames = (float*)CHECK_NOTNULL(malloc(sizeof(float) * window_size));
+
+  float input[kBlockSize];
+  int phone_evals = 0;
+  int last_speech_block = -1;
+  int b;
+  for (b = 0; b < num_blocks; ++b) {
+    const int phone_block = b - kPadBlocks;
+    int i;
+    for (i = 0; i < kBlockSize; ++i) {
+      input[i] = Noise();
+      if (0 <= phone_block && phone_block < phone_blocks) {
+        input[i] += phone[phone_block * kBlockSize + i] / 32768.0f;
+      }
+    }
+
+    ClassifyPhonemeLabels labels;
+    const int evaluated = PhonemeSchedulerProcessSamples(
+        scheduler, input, &labels, NULL);
+
+    /* CarlFrontendProcessSamples modifies `input`, so it runs second. */
+    memmove(frames, frames + num_channels_carl,
+            sizeof(float) * (window_size - num_channels_carl));
+    CarlFrontendProcessSamples(frontend, input,
+                               frames + window_size - num_channels_carl);
+    if (evaluated) {
+      ClassifyPhonemeLabels expected;
+      ClassifyPhoneme(frames, &expected, NULL);
+      CHECK(memcmp(&labels, &expected, sizeof(labels)) == 0);
+      if (labels.vad) { last_speech_block = b; }
+    }
+
+    if (0 <= phone_block && phone_block < phone_blocks) {
+      phone_evals += evaluated;
+    }
+    if (b == num_blocks - 1) {
+      /* Long after the phone, labels are back to silence. */
+      CHECK(labels.phoneme == 0);
+    }
+  }
+
+  CHECK(phone_evals == phone_blocks);
+  CHECK(last_speech_block >= kPadBlocks);
+  /* Overall, the network ran on well under all blocks. */
+  CHECK(scheduler->num_evals < num_blocks / 2);
+
+  free(frames);
+  CarlFrontendFree(frontend);
+  PhonemeSchedulerFree(scheduler);
+  free(phone);
+}
+
+static void TestInvalidParams(void) {
+  puts("TestInvalidParams");
+  PhonemeSchedulerParams params;
+  PhonemeSchedulerSetDefaultParams(&params);
+  params.silence_interval_blocks = 0;
+  CHECK(PhonemeSchedulerMake(&params) == NULL);
+
+  PhonemeSchedulerSetDefaultParams(&params);
+  params.score_decay = 1.5f;
+  CHECK(PhonemeSchedulerMake(&params) == NULL);
+}
+
+int main(int argc, char** argv) {
+  srand(0);
+  TestSilenceCadence();
+  TestNoiseAfterZeroLeadIn();
+  TestPhoneWithSilence();
+  TestInvalidParams();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
@@ -124,10 +124,68 @@ static void TestStreamingRandomBlockSizes(void) {
   free(input);
 }
 
+/* Bulk decoding matches decoding records one at a time. */
+static void TestDecodeRecords(void) {
+  puts("TestDecodeRecords");
+  /* Test with a number of records that isn't a multiple of the lane count. */
+  const int kNumRecords = 75;
+  const int kStride = 80;
+  uint8_t* records = (uint8_t*)CHECK_NOTNULL(
+      malloc(kNumRecords * kEnvelopeTrackerRecordBytes));
+  float* columns = (float*)CHECK_NOTNULL(
+      malloc(kEnvelopeTrackerRecordPoints * kStride * sizeof(float)));
+  EnvelopeTrackerDecoder decoder;
+  EnvelopeTrackerDecoderInit(&decoder);
+
+  /* Make some records by running the tracker on noise of varying amplitude.
+   * The rest of the records are random bytes, which may make the cumulative
+   * value wrap around.
+   */
+  EnvelopeTracker tracker;
+  EnvelopeTrackerInit(&tracker, kSampleRateHz);
+  float input[64];
+  int r = 0;
+  while (r < kNumRecords / 2) {
+    const float amplitude = (float)pow(10.0, -(r % 5));
+    int i;
+    for (i = 0; i < 64; ++i) {
+      input[i] = amplitude * (rand() / (float)RAND_MAX - 0.5f);
+    }
+    if (EnvelopeTrackerProcessSamples(&tracker, input, 64)) {
+      EnvelopeTrackerGetRecord(&tracker,
+                               records + r * kEnvelopeTrackerRecordBytes);
+      ++r;
+    }
+  }
+  for (; r < kNumRecords; ++r) {
+    int i;
+    for (i = 0; i < kEnvelopeTrackerRecordBytes; ++i) {
+      records[r * kEnvelopeTrackerRecordBytes + i] = (uint8_t)rand();
+    }
+  }
+
+  EnvelopeTrackerDecodeRecords(&decoder, records, kNumRecords, kStride,
+                               columns);
+
+  for (r = 0; r < kNumRecords; ++r) {
+    float expected[kEnvelopeTrackerRecordPoints];
+    EnvelopeTrackerDecodeRecord(records + r * kEnvelopeTrackerRecordBytes,
+                                expected);
+    int i;
+    for (i = 0; i < kEnvelopeTrackerRecordPoints; ++i) {
+      CHECK(columns[i * kStride + r] == expected[i]);
+    }
+  }
+
+  free(columns);
+  free(records);
+}
+
 int main(int argc, char** argv) {
   srand(0);
   TestBasic();
   TestStreamingRandomBlockSizes();
+  TestDecodeRecords();
 
   puts("PASS");
   return EXIT_SUCCESS;
@@ -0,0 +1,161 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Enable the PROFILE_STAGE_* macros in this file. */
+#define STAGE_PROFILER_ENABLED 1
+
+#include "src/tactile/stage_profiler.h"
+
+#include <string.h>
+
+#include "src/dsp/logging.h"
+#include "src/dsp/serialize.h"
+
+static uint32_t g_fake_ticks = 0;
+
+static uint32_t FakeClock(void) {
+  return g_fake_ticks;
+}
+
+/* Simulates a call to `stage` taking `ticks` clock ticks. */
+static void FakeCall(int stage, uint32_t ticks) {
+  PROFILE_STAGE_BEGIN(stage);
+  g_fake_ticks += ticks;
+  PROFILE_STAGE_END(stage);
+}
+
+static void TestRollingWindow(void) {
+  puts("TestRollingWindow");
+  StageProfilerSetClockFun(FakeClock);
+  StageProfilerReset();
+  StageProfilerStats stats;
+
+  int i;
+  for (i = 0; i < kStageProfilerWindow - 1; ++i) {
+    FakeCall(kProfileStageEnveloper, 100 + i);
+  }
+  /* Window is incomplete, so there are no stats yet. */
+  CHECK(!StageProfilerGetStats(kProfileStageEnveloper, &stats));
+  FakeCall(kProfileStageEnveloper, 100 + i);
+
+  CHECK(StageProfilerGetStats(kProfileStageEnveloper, &stats));
+  CHECK(stats.min == 100);
+  CHECK(stats.max == 100 + kStageProfilerWindow - 1);
+  /* Mean of 100, 101, ..., 163, rounded down. */
+  CHECK(stats.mean == 100 + (kStageProfilerWindow - 1) / 2);
+  /* Other stages are unaffected. */
+  CHECK(!StageProfilerGetStats(kProfileStageCarlFrontend, &stats));
+
+  /* Stats of the last complete window are kept while the next accumulates. */
+  for (i = 0; i < kStageProfilerWindow - 1; ++i) {
+    FakeCall(kProfileStageEnveloper, 7);
+  }
+  CHECK(StageProfilerGetStats(kProfileStageEnveloper, &stats));
+  CHECK(stats.min == 100);
+  FakeCall(kProfileStageEnveloper, 7);
+  CHECK(StageProfilerGetStats(kProfileStageEnveloper, &stats));
+  CHECK(stats.min == 7);
+  CHECK(stats.mean == 7);
+  CHECK(stats.max == 7);
+}
+
+static void TestClockWraparound(void) {
+  puts("TestClockWraparound");
+  StageProfilerSetClockFun(FakeClock);
+  StageProfilerReset();
+
+  g_fake_ticks = UINT32_MAX - 10;
+  int i;
+  for (i = 0; i < kStageProfilerWindow; ++i) {
+    FakeCall(kProfileStagePattern, 50);
+  }
+  StageProfilerStats stats;
+  CHECK(StageProfilerGetStats(kProfileStagePattern, &stats));
+  CHECK(stats.min == 50);
+  CHECK(stats.max == 50);
+}
+
+static void TestNoClock(void) {
+  puts("TestNoClock");
+  StageProfilerSetClockFun(NULL);
+  StageProfilerReset();
+
+  int i;
+  for (i = 0; i < kStageProfilerWindow; ++i) {
+    FakeCall(kProfileStagePostProcessor, 10);
+  }
+  StageProfilerStats stats;
+  CHECK(!StageProfilerGetStats(kProfileStagePostProcessor, &stats));
+  CHECK(StageProfilerNow() == 0);
+}
+
+static void TestCaptureTapOut(void) {
+  puts("TestCaptureTapOut");
+  StageProfilerSetClockFun(FakeClock);
+  StageProfilerReset();
+  TapOutClearDescriptors();
+  TapOutToken token = TapOutAddDescriptor(&kStageProfilerTapOutDescriptor);
+  CHECK(token != kInvalidTapOutToken);
+  CHECK(TapOutEnable(&token, 1));
+
+  int i;
+  for (i = 0; i < kStageProfilerWindow; ++i) {
+    FakeCall(kProfileStageCarlFrontend, (i % 2) ? 30 : 10);
+    FakeCall(kProfileStagePostProcessor, 5);
+  }
+
+  const TapOutSlice* slice = TapOutGetSlice(token);
+  CHECK(slice != NULL);
+  CHECK(slice->size == kNumProfileStages * 3 * 4);
+  memset(slice->data, 0xff, slice->size);
+  StageProfilerCaptureTapOut(token);
+
+  const uint8_t* data = slice->data;
+  int stage;
+  for (stage = 0; stage < kNumProfileStages; ++stage) {
+    const uint32_t min = LittleEndianReadU32(data);
+    const uint32_t mean = LittleEndianReadU32(data + 4);
+    const uint32_t max = LittleEndianReadU32(data + 8);
+    if (stage == kProfileStageCarlFrontend) {
+      CHECK(min == 10 && mean == 20 && max == 30);
+    } else if (stage == kProfileStagePostProcessor) {
+      CHECK(min == 5 && mean == 5 && max == 5);
+    } else {  /* Stages without a complete window are zeros. */
+      CHECK(min == 0 && mean == 0 && max == 0);
+    }
+    data += 12;
+  }
+
+  TapOutEnable(NULL, 0);
+}
+
+static void TestStageNames(void) {
+  puts("TestStageNames");
+  CHECK(!strcmp(StageProfilerStageName(kProfileStageCarlFrontend),
+                "CarlFrontend"));
+  CHECK(!strcmp(StageProfilerStageName(kProfileStagePattern), "Pattern"));
+  CHECK(StageProfilerStageName(kNumProfileStages) == NULL);
+}
+
+int main(int argc, char** argv) {
+  TestRollingWindow();
+  TestClockWraparound();
+  TestNoClock();
+  TestCaptureTapOut();
+  TestStageNames();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
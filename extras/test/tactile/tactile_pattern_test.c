@@ -567,6 +567,180 @@ static int WriteGoldens(const char* dir) {
          WritePattern(dir, "confirm", kTactilePatternConfirm);
 }
 
+/* Checks that rendering `timeline` matches synthesizing `ex_pattern` with the
+ * interpreter, streaming both with random block sizes.
+ */
+static void CheckRenderMatchesSynthesize(
+    const TactilePatternTimeline* timeline, const uint8_t* ex_pattern,
+    float sample_rate_hz, int num_channels) {
+  const int num_frames = (int)(3 * sample_rate_hz);
+  TactilePattern p;
+  TactilePatternInit(&p, sample_rate_hz, num_channels);
+  TactilePatternStartEx(&p, ex_pattern);
+  TactilePatternRenderer r;
+  TactilePatternRendererStart(&r, timeline);
+  CHECK(TactilePatternRendererIsActive(&r) == TactilePatternIsActive(&p));
+
+  float expected[150 * kTactilePatternMaxChannels];
+  float actual[150 * kTactilePatternMaxChannels];
+  int start;
+  for (start = 0; start < num_frames;) {
+    int block_size = RandomInt(150);
+    if (num_frames - start < block_size) {
+      block_size = num_frames - start;
+    }
+
+    const int expected_active =
+        TactilePatternSynthesize(&p, block_size, expected);
+    CHECK(TactilePatternRender(&r, block_size, actual) == expected_active);
+    int i;
+    for (i = 0; i < num_channels * block_size; ++i) {
+      CHECK(fabs(actual[i] - expected[i]) < 1e-6f);
+    }
+
+    start += block_size;
+  }
+
+  CHECK(!TactilePatternRendererIsActive(&r));
+}
+
+/* Test that compiled timelines render the same as the interpreter. */
+static void TestCompiledTimeline(void) {
+  puts("TestCompiledTimeline");
+  static const uint8_t kMovesAndGains[] = {
+    kTactilePatternOpSetWaveform + 1, kTactilePatternWaveformSin90Hz,
+    kTactilePatternOpSetWaveform + 0, kTactilePatternWaveformSin30Hz,
+    kTactilePatternOpSetGain + 1, 0xb2, /* Gain 0.7. */
+    kTactilePatternOpSetGain + 0, 0x1a, /* Gain 0.1. */
+    TACTILE_PATTERN_OP_PLAY_MS(80),
+    kTactilePatternOpMove, 0x10,
+    TACTILE_PATTERN_OP_PLAY_MS(80),
+    TACTILE_PATTERN_OP_PLAY_MS(80),
+    kTactilePatternOpSetAllWaveform, kTactilePatternWaveformChirp,
+    kTactilePatternOpSetGain + 0, 0x80, /* Gain 0.5. */
+    TACTILE_PATTERN_OP_PLAY_MS(80),
+    kTactilePatternOpMove, 0x02,
+    TACTILE_PATTERN_OP_PLAY_MS(140),
+    /* Move a chirp along a chain of channels in one step. */
+    kTactilePatternOpSetWaveform + 2, kTactilePatternWaveformChirp,
+    TACTILE_PATTERN_OP_PLAY_MS(100),
+    kTactilePatternOpMove, 0x23,
+    kTactilePatternOpMove, 0x35,
+    kTactilePatternOpSetGain + 5, 0x40,
+    TACTILE_PATTERN_OP_PLAY_MS(60),
+    /* Sustain a tone, which continues without fading. */
+    kTactilePatternOpSetAllGain, 0xff,
+    kTactilePatternOpSetAllWaveform, kTactilePatternWaveformSin60Hz,
+    TACTILE_PATTERN_OP_PLAY_MS(80),
+    kTactilePatternOpSetAllWaveform, kTactilePatternWaveformSin60Hz,
+    TACTILE_PATTERN_OP_PLAY_MS(80),
+    /* Zero gain sets the frequency of a silent channel. */
+    kTactilePatternOpSetGain + 4, 0x00,
+    kTactilePatternOpSetWaveform + 4, kTactilePatternWaveformSin350Hz,
+    TACTILE_PATTERN_OP_PLAY_MS(40),
+    kTactilePatternOpSetGain + 4, 0x80,
+    kTactilePatternOpSetWaveform + 4, kTactilePatternWaveformSin350Hz,
+    TACTILE_PATTERN_OP_PLAY_MS(40),
+    kTactilePatternOpEnd,
+  };
+  static const float kSampleRates[2] = {kSampleRateHz, 16000.0f};
+  static const int kNumChannels[3] = {6, 10, kTactilePatternMaxChannels};
+  static TactilePatternTimeline timeline;
+
+  int i;
+  for (i = 0; i < 2; ++i) {
+    const float sample_rate_hz = kSampleRates[i];
+    int j;
+    for (j = 0; j < 3; ++j) {
+      const int num_channels = kNumChannels[j];
+
+      CHECK(TactilePatternCompileEx(&timeline, sample_rate_hz, num_channels,
+                                    kMovesAndGains));
+      CheckRenderMatchesSynthesize(&timeline, kMovesAndGains,
+                                   sample_rate_hz, num_channels);
+      /* A timeline can be rendered again. */
+      CheckRenderMatchesSynthesize(&timeline, kMovesAndGains,
+                                   sample_rate_hz, num_channels);
+
+      CHECK(TactilePatternCompileEx(&timeline, sample_rate_hz, num_channels,
+                                    kTactilePatternExStartUp));
+      CheckRenderMatchesSynthesize(&timeline, kTactilePatternExStartUp,
+                                   sample_rate_hz, num_channels);
+
+      TactilePattern p;
+      TactilePatternInit(&p, sample_rate_hz, num_channels);
+      TactilePatternStartCalibrationTonesThresholds(&p, 3, 1, 0.3f);
+      CHECK(TactilePatternCompileEx(&timeline, sample_rate_hz, num_channels,
+                                    p.buffer));
+      CheckRenderMatchesSynthesize(&timeline, p.buffer,
+                                   sample_rate_hz, num_channels);
+
+      static const char* kSimplePatterns[4] =
+          {"66-A-A", "8A-6", "5-5", "/-/0F"};
+      int k;
+      for (k = 0; k < 4; ++k) {
+        CHECK(TactilePatternCompile(&timeline, sample_rate_hz, num_channels,
+                                    kSimplePatterns[k]));
+        uint8_t ex_pattern[kTactilePatternBufferSize];
+        CHECK(TactilePatternTranslateSimplePattern(
+            kSimplePatterns[k], ex_pattern, sizeof(ex_pattern)));
+        CheckRenderMatchesSynthesize(&timeline, ex_pattern,
+                                     sample_rate_hz, num_channels);
+      }
+    }
+  }
+
+  /* A null pattern compiles to an empty timeline, rendering silence. */
+  CHECK(TactilePatternCompileEx(&timeline, kSampleRateHz, 3, NULL));
+  CHECK(timeline.num_segments == 0);
+  TactilePatternRenderer r;
+  TactilePatternRendererStart(&r, &timeline);
+  CHECK(!TactilePatternRendererIsActive(&r));
+  float output[10 * 3];
+  CHECK(!TactilePatternRender(&r, 10, output));
+  for (i = 0; i < 10 * 3; ++i) { CHECK(output[i] == 0.0f); }
+
+  /* A tone sustained on all channels for the whole buffer. After the first
+   * segment, there are voices only for the fade out at the end.
+   */
+  uint8_t sustained[kTactilePatternBufferSize];
+  int n = 0;
+  while (n + 3 < kTactilePatternBufferSize) {
+    sustained[n++] = kTactilePatternOpSetAllWaveform;
+    sustained[n++] = kTactilePatternWaveformSin100Hz;
+    sustained[n++] = TACTILE_PATTERN_OP_PLAY_MS(60);
+  }
+  sustained[n++] = kTactilePatternOpEnd;
+  CHECK(TactilePatternCompileEx(&timeline, kSampleRateHz, 12, sustained));
+  CHECK(timeline.num_voices == 2 * 12);
+  CheckRenderMatchesSynthesize(&timeline, sustained, kSampleRateHz, 12);
+
+  /* Worst case for the number of voices: turn all channels on and off
+   * repeatedly, changing the state of every channel in every segment.
+   */
+  uint8_t on_off[kTactilePatternBufferSize];
+  n = 0;
+  for (i = 0; n + 4 < kTactilePatternBufferSize; ++i) {
+    on_off[n++] = kTactilePatternOpSetAllWaveform;
+    on_off[n++] = i % (kTactilePatternWaveformChirp + 1);
+    on_off[n++] = TACTILE_PATTERN_OP_PLAY_MS(20);
+    on_off[n++] = TACTILE_PATTERN_OP_PLAY_MS(20);
+  }
+  on_off[n++] = kTactilePatternOpEnd;
+  CHECK(TactilePatternCompileEx(&timeline, kSampleRateHz,
+                                kTactilePatternMaxChannels, on_off));
+  CHECK(timeline.num_voices > kTactilePatternMaxVoices - 2 * 16);
+  CheckRenderMatchesSynthesize(&timeline, on_off, kSampleRateHz,
+                               kTactilePatternMaxChannels);
+
+  /* Too many segments for the timeline. */
+  uint8_t long_pattern[kTactilePatternMaxSegments + 1];
+  memset(long_pattern, TACTILE_PATTERN_OP_PLAY_MS(20),
+         kTactilePatternMaxSegments);
+  long_pattern[kTactilePatternMaxSegments] = kTactilePatternOpEnd;
+  CHECK(!TactilePatternCompileEx(&timeline, kSampleRateHz, 3, long_pattern));
+}
+
 int main(int argc, char** argv) {
   srand(0);
   if (argc == 2 && StartsWith(argv[1], "--write_goldens=")) {
@@ -589,6 +763,7 @@ int main(int argc, char** argv) {
 
   TestCalibrationTones();
   TestCalibrationTonesThresholds();
+  TestCompiledTimeline();
 
   puts("PASS");
   return EXIT_SUCCESS;
@@ -205,10 +205,10 @@ static void TestReset(float sample_rate_hz, int decimation_factor) {
 }
 
 /* Runs TactileProcessor on a short WAV recording of a pure phone, and
- * checks that the intended tactor is the most active.
+ * accumulates the energy of each output channel into `energy`.
  */
-static void TestPhone(const char* phone, int intended_tactor) {
-  printf("TestPhone(%s)\n", phone);
+static void ComputePhoneEnergy(const char* phone, int block_size,
+                               int vowel_hop, float* energy) {
   char wav_file[1024];
   sprintf(wav_file,
           "extras/test/testdata/phone_%s.wav",
@@ -221,11 +221,9 @@ static void TestPhone(const char* phone, int intended_tactor) {
       wav_file, &num_samples, &num_channels, &sample_rate_hz));
   CHECK(num_channels == 1);
   float* input = (float*)CHECK_NOTNULL(
-      malloc(sizeof(float) * kBlockSize));
+      malloc(sizeof(float) * block_size));
   float* output = (float*)CHECK_NOTNULL(
-      malloc(sizeof(float) * kTactileProcessorNumTactors * kBlockSize));
-  float* energy = (float*)CHECK_NOTNULL(
-      malloc(sizeof(float) * kTactileProcessorNumTactors));
+      malloc(sizeof(float) * kTactileProcessorNumTactors * block_size));
   int c;
   for (c = 0; c < kTactileProcessorNumTactors; ++c) {
     energy[c] = 0.0f;
@@ -234,21 +232,22 @@ static void TestPhone(const char* phone, int intended_tactor) {
   TactileProcessorParams params;
   TactileProcessorSetDefaultParams(&params);
   params.frontend_params.input_sample_rate_hz = sample_rate_hz;
-  params.frontend_params.block_size = kBlockSize;
+  params.frontend_params.block_size = block_size;
+  params.vowel_hop = vowel_hop;
   TactileProcessor* tactile_processor = CHECK_NOTNULL(
       TactileProcessorMake(&params));
 
   int start;
   int i;
-  for (start = 0; start + kBlockSize < (int)num_samples; start += kBlockSize) {
-    for (i = 0; i < kBlockSize; ++i) {
+  for (start = 0; start + block_size < (int)num_samples; start += block_size) {
+    for (i = 0; i < block_size; ++i) {
       input[i] = input_int16[start + i] / 32768.0f;
     }
 
     TactileProcessorProcessSamples(tactile_processor, input, output);
 
     const float* tactile_signals = output;
-    for (i = 0; i < kBlockSize; ++i) {
+    for (i = 0; i < block_size; ++i) {
       for (c = 0; c < kTactileProcessorNumTactors; ++c) {
         /* Accumulate energy for each channel. */
         energy[c] += tactile_signals[c] * tactile_signals[c];
@@ -257,18 +256,99 @@ static void TestPhone(const char* phone, int intended_tactor) {
     }
   }
 
+  TactileProcessorFree(tactile_processor);
+  free(output);
+  free(input);
+  free(input_int16);
+}
+
+/* Runs TactileProcessor on a short WAV recording of a pure phone, and
+ * checks that the intended tactor is the most active.
+ */
+static void TestPhone(const char* phone, int intended_tactor,
+                      int block_size, int vowel_hop) {
+  printf("TestPhone(%s, %d, %d)\n", phone, block_size, vowel_hop);
+  float energy[10];
+  ComputePhoneEnergy(phone, block_size, vowel_hop, energy);
+
   /* The intended tactor has the largest energy in the vowel cluster. */
+  int c;
   for (c = 1; c <= 7; ++c) {
     if (c != intended_tactor) {
       CHECK(energy[intended_tactor] >= 1.65f * energy[c]);
     }
   }
+}
 
-  TactileProcessorFree(tactile_processor);
-  free(energy);
+/* Compares hex cluster weights with vowel_hop > 1 against updating the vowel
+ * embedding every block. Returns the mean absolute difference in weights.
+ */
+static float VowelHopWeightError(const char* phone, int vowel_hop) {
+  char wav_file[1024];
+  sprintf(wav_file,
+          "extras/test/testdata/phone_%s.wav",
+          phone);
+
+  size_t num_samples;
+  int num_channels;
+  int sample_rate_hz;
+  int16_t* input_int16 = (int16_t*)CHECK_NOTNULL(Read16BitWavFile(
+      wav_file, &num_samples, &num_channels, &sample_rate_hz));
+  CHECK(num_channels == 1);
+  float* input = (float*)CHECK_NOTNULL(
+      malloc(sizeof(float) * kBlockSize));
+  float* output = (float*)CHECK_NOTNULL(
+      malloc(sizeof(float) * kTactileProcessorNumTactors * kBlockSize));
+
+  TactileProcessorParams params;
+  TactileProcessorSetDefaultParams(&params);
+  params.frontend_params.input_sample_rate_hz = sample_rate_hz;
+  params.frontend_params.block_size = kBlockSize;
+  TactileProcessor* per_block = CHECK_NOTNULL(TactileProcessorMake(&params));
+  params.vowel_hop = vowel_hop;
+  TactileProcessor* hop = CHECK_NOTNULL(TactileProcessorMake(&params));
+
+  double sum_error = 0.0;
+  int count = 0;
+  int start;
+  int i;
+  for (start = 0; start + kBlockSize < (int)num_samples; start += kBlockSize) {
+    for (i = 0; i < kBlockSize; ++i) {
+      input[i] = input_int16[start + i] / 32768.0f;
+    }
+
+    TactileProcessorProcessSamples(per_block, input, output);
+    TactileProcessorProcessSamples(hop, input, output);
+
+    int c;
+    for (c = 0; c < 7; ++c) {
+      sum_error += fabs(per_block->vowel_hex_weights[c]
+                        - hop->vowel_hex_weights[c]);
+    }
+    count += 7;
+  }
+
+  TactileProcessorFree(hop);
+  TactileProcessorFree(per_block);
   free(output);
   free(input);
   free(input_int16);
+  return (float)(sum_error / count);
+}
+
+/* Checks that vowel_hop > 1 closely approximates per-block updates. Weights
+ * lag by up to `vowel_hop - 1` blocks, so the tolerance grows with the hop.
+ */
+static void TestVowelHopQuality(int vowel_hop) {
+  printf("TestVowelHopQuality(%d)\n", vowel_hop);
+  static const char* kPhones[] = {"aa", "ae", "eh", "er", "ih", "iy", "uh",
+                                  "uw"};
+  int i;
+  for (i = 0; i < (int)(sizeof(kPhones) / sizeof(*kPhones)); ++i) {
+    const float error = VowelHopWeightError(kPhones[i], vowel_hop);
+    printf("  %s: mean abs weight error %.4f\n", kPhones[i], error);
+    CHECK(error < 0.025f * vowel_hop);
+  }
 }
 
 int main(int argc, char** argv) {
@@ -279,9 +359,21 @@ int main(int argc, char** argv) {
     TestTones(48000.0f, decimation_factor);
     TestReset(48000.0f, decimation_factor);
   }
-  TestPhone("aa", 1);
-  TestPhone("eh", 5);
-  TestPhone("uw", 2);
+  TestPhone("aa", 1, kBlockSize, 1);
+  TestPhone("eh", 5, kBlockSize, 1);
+  TestPhone("uw", 2, kBlockSize, 1);
+  /* Non-power-of-two block_size. */
+  TestPhone("aa", 1, 48, 1);
+  TestPhone("eh", 5, 48, 1);
+  TestPhone("uw", 2, 48, 1);
+  /* Vowel embedding updated every 2 or 4 blocks. */
+  int vowel_hop;
+  for (vowel_hop = 2; vowel_hop <= 4; vowel_hop *= 2) {
+    TestPhone("aa", 1, kBlockSize, vowel_hop);
+    TestPhone("eh", 5, kBlockSize, vowel_hop);
+    TestPhone("uw", 2, kBlockSize, vowel_hop);
+    TestVowelHopQuality(vowel_hop);
+  }
 
   puts("PASS");
   return EXIT_SUCCESS;
@@ -63,6 +63,13 @@ static void TestDescriptors(void) {
   /* Compare bytes, but ignore the build date field. */
   CHECK(CheckBytes(g_tap_out_buffer, kExpected, 3));
   CHECK(CheckBytes(g_tap_out_buffer + 7, kExpected + 7, sizeof(kExpected) - 7));
+
+  /* Item sizes of the dtype codes above. */
+  CHECK(TapOutDTypeItemSize(9) == 4); /* float. */
+  CHECK(TapOutDTypeItemSize(11) == 1); /* text. */
+  CHECK(TapOutDTypeItemSize(5) == 4); /* uint32. */
+  CHECK(TapOutDTypeItemSize(0) == 0); /* Invalid codes. */
+  CHECK(TapOutDTypeItemSize(12) == 0);
 }
 
 static void TestSlices(void) {
@@ -216,6 +223,126 @@ static void TestCapture(void) {
   CHECK(g_tx_callback_called);
 }
 
+/* Simulated transmitter for sequenced capture. */
+static int g_tx_available = 0;
+static int g_num_sent = 0;
+static uint8_t g_sent[kTapOutBufferCapacity];
+static int g_sent_size = 0;
+
+static void RecordTx(const char* data, int size) {
+  CHECK(size <= g_tx_available);
+  memcpy(g_sent, data, size);
+  g_sent_size = size;
+  ++g_num_sent;
+}
+
+static int TxAvailable(void) { return g_tx_available; }
+
+/* Checks that the last sent message is a sequenced capture with `sequence` and
+ * `num_dropped`, and returns a pointer to its output data.
+ */
+static const uint8_t* CheckSequencedMessage(int sequence, int num_dropped) {
+  CHECK(g_sent_size >= 3 + kTapOutSequencedHeaderSize);
+  CHECK(g_sent[0] == kTapOutMarker);
+  CHECK(g_sent[1] == kTapOutMessageSequencedCapture);
+  CHECK(g_sent[2] == g_sent_size - 3);
+  CHECK(g_sent[3] == sequence && g_sent[4] == 0);
+  CHECK(g_sent[5] == num_dropped && g_sent[6] == 0);
+  return g_sent + 3 + kTapOutSequencedHeaderSize;
+}
+
+static void TestSequencedCapture(void) {
+  puts("TestSequencedCapture()");
+  const TapOutDescriptor kMic = {"Mic", "int16", 1, {8}};
+
+  TapOutClearDescriptors();
+  TapOutToken token_mic = TapOutAddDescriptor(&kMic);
+  TapOutToken token_c = TapOutAddDescriptor(&kCherry);
+  TapOutSetTxFun(RecordTx);
+  TapOutSetTxAvailableFun(TxAvailable);
+  g_tx_available = 1000;
+  g_num_sent = 0;
+
+  /* Simulate a StartSequencedCapture message, compressing the mic output. */
+  static const uint8_t kMessageStart[6] =
+      {kTapOutMarker, kTapOutMessageStartSequencedCapture, 3, 0x1, 1, 2};
+  TapOutReceiveMessage((const char*)kMessageStart, sizeof(kMessageStart));
+  CHECK(TapOutIsActive());
+  CHECK(g_num_sent == 0);
+
+  const TapOutSlice* slice_mic = TapOutGetSlice(token_mic);
+  const TapOutSlice* slice_c = TapOutGetSlice(token_c);
+  CHECK(slice_mic && slice_mic->size == 8 * 2);
+  CHECK(slice_c && slice_c->size == 9 * 4);
+  static const int16_t kMicData[8] =
+      {1000, 1001, 999, 999, 1063, 1000, -1000, -1000};
+  static const uint32_t kCherryTestData[9] =
+      {10, 20, 30, 40, 50, 60, 70, 80, UINT32_C(0x12345678)};
+  memcpy(slice_mic->data, kMicData, slice_mic->size);
+  memcpy(slice_c->data, kCherryTestData, slice_c->size);
+
+  TapOutFinishedCaptureBuffer();
+  CHECK(g_num_sent == 1);
+  const uint8_t* data = CheckSequencedMessage(0, 0);
+  /* Deltas 1000, 1, -2, 0, 64, -63, -2000, 0 are zigzag mapped to 2000, 2, 3,
+   * 0, 128, 125, 3999, 0 and varint coded.
+   */
+  static const uint8_t kExpectedMic[1 + 11] = {
+    kTapOutEncodingDelta,
+    0xd0, 0x0f, 0x02, 0x03, 0x00, 0x80, 0x01, 0x7d, 0x9f, 0x1f, 0x00,
+  };
+  CHECK(CheckBytes(data, kExpectedMic, sizeof(kExpectedMic)));
+  CHECK(CheckBytes(data + sizeof(kExpectedMic),
+                   (const uint8_t*)kCherryTestData, sizeof(kCherryTestData)));
+  CHECK(g_sent_size ==
+      3 + kTapOutSequencedHeaderSize + sizeof(kExpectedMic) + 9 * 4);
+
+  /* Data that doesn't compress is sent raw. */
+  static const int16_t kNoisyMicData[8] =
+      {20000, -20000, 20000, -20000, 20000, -20000, 20000, -20000};
+  memcpy(slice_mic->data, kNoisyMicData, slice_mic->size);
+  TapOutFinishedCaptureBuffer();
+  CHECK(g_num_sent == 2);
+  data = CheckSequencedMessage(1, 0);
+  CHECK(data[0] == kTapOutEncodingRaw);
+  CHECK(CheckBytes(data + 1, (const uint8_t*)kNoisyMicData, 16));
+
+  /* While the transmitter is busy, buffers queue in the ring. When the ring is
+   * full, further buffers are dropped.
+   */
+  g_tx_available = 10;
+  int i;
+  for (i = 0; i < kTapOutRingSize + 2; ++i) {
+    TapOutFinishedCaptureBuffer();
+  }
+  CHECK(g_num_sent == 2);
+  TapOutRingStats stats = TapOutGetRingStats();
+  CHECK(stats.sequence == 2 + kTapOutRingSize + 2);
+  CHECK(stats.num_queued == kTapOutRingSize);
+  CHECK(stats.num_dropped == 2);
+
+  /* Once the transmitter has room, queued buffers are sent in order. */
+  g_tx_available = 1000;
+  TapOutFlush();
+  CHECK(g_num_sent == 2 + kTapOutRingSize);
+  CheckSequencedMessage(1 + kTapOutRingSize, 0);
+  CHECK(TapOutGetRingStats().num_queued == 0);
+
+  /* The next buffer reports the drops. Its sequence number shows the gap. */
+  TapOutFinishedCaptureBuffer();
+  CheckSequencedMessage(2 + kTapOutRingSize + 2, 2);
+
+  /* Enabling regular capture ends sequenced capture. */
+  TapOutToken tokens[1];
+  tokens[0] = token_c;
+  CHECK(TapOutEnable(tokens, 1));
+  TapOutFinishedCaptureBuffer();
+  CHECK(g_sent_size == 3 + 9 * 4);
+  CHECK(g_sent[1] == kTapOutMessageCapture);
+
+  TapOutSetTxAvailableFun(NULL);
+}
+
 static void PrintToStderr(const char* message) {
   fprintf(stderr, "Error: TapOut: %s\n", message);
 }
@@ -230,6 +357,7 @@ int main(int argc, char** argv) {
   TestDescriptorShapeTooBig();
   TestBadToken();
   TestCapture();
+  TestSequencedCapture();
 
   puts("PASS");
   return EXIT_SUCCESS;
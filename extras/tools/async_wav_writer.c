@@ -0,0 +1,262 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Buffers are used in round-robin order. The caller fills buffer
+ * `num_submitted % num_buffers` without holding the lock, since the I/O thread
+ * never touches a buffer that hasn't been submitted. The I/O thread writes
+ * buffer `num_written % num_buffers`. So buffers [num_written, num_submitted)
+ * form the queue, and the caller waits while the queue is full.
+ */
+
+#include "extras/tools/async_wav_writer.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/dsp/serialize.h"
+#include "src/dsp/write_wav_file.h"
+
+/* Max number of samples in a WAV file of float samples, so that the data chunk
+ * size in bytes fits in a uint32 with some room for the header.
+ */
+#define kMaxSamples ((UINT32_MAX - 256) / 4)
+
+struct AsyncWavWriter {
+  FILE* f;
+  int sample_rate_hz;
+  int num_channels;
+  int num_buffers;
+  /* Capacity of each buffer in bytes, a multiple of 4 * num_channels. */
+  size_t buffer_capacity;
+  /* Buffers of samples already encoded as little endian float32. */
+  uint8_t** buffers;
+  /* Number of bytes in each buffer. */
+  size_t* buffer_sizes;
+  /* Total number of samples written with AsyncWavWriterWrite. */
+  size_t num_samples;
+  long num_stalls;
+
+  pthread_t io_thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  long num_submitted;  /* Guarded by `lock`. */
+  long num_written;  /* Guarded by `lock`. */
+  int closing;  /* Guarded by `lock`. */
+  int io_error;  /* Guarded by `lock`. */
+};
+
+static void* IoThread(void* arg) {
+  AsyncWavWriter* writer = (AsyncWavWriter*)arg;
+  pthread_mutex_lock(&writer->lock);
+  while (1) {
+    while (writer->num_written == writer->num_submitted && !writer->closing) {
+      pthread_cond_wait(&writer->cond, &writer->lock);
+    }
+    if (writer->num_written == writer->num_submitted) {
+      break;  /* Closing and the queue is empty. */
+    }
+
+    const int index = (int)(writer->num_written % writer->num_buffers);
+    pthread_mutex_unlock(&writer->lock);
+    /* Write without holding the lock so that the caller may fill other
+     * buffers meanwhile.
+     */
+    const size_t size = writer->buffer_sizes[index];
+    const int success =
+        (fwrite(writer->buffers[index], 1, size, writer->f) == size);
+    pthread_mutex_lock(&writer->lock);
+
+    if (!success) { writer->io_error = 1; }
+    ++writer->num_written;
+    pthread_cond_broadcast(&writer->cond);
+  }
+  pthread_mutex_unlock(&writer->lock);
+  return NULL;
+}
+
+/* Frees buffers and the writer struct. */
+static void FreeWriter(AsyncWavWriter* writer) {
+  if (writer->buffers != NULL) {
+    int i;
+    for (i = 0; i < writer->num_buffers; ++i) {
+      free(writer->buffers[i]);
+    }
+  }
+  free(writer->buffers);
+  free(writer->buffer_sizes);
+  free(writer);
+}
+
+AsyncWavWriter* AsyncWavWriterOpen(const char* filename,
+                                   int sample_rate_hz,
+                                   int num_channels,
+                                   int buffer_frames,
+                                   int num_buffers) {
+  if (sample_rate_hz <= 0 || num_channels <= 0 || buffer_frames <= 0 ||
+      num_buffers < 2) {
+    fprintf(stderr, "Error: Invalid AsyncWavWriter parameters.\n");
+    return NULL;
+  }
+  AsyncWavWriter* writer = (AsyncWavWriter*)malloc(sizeof(AsyncWavWriter));
+  if (writer == NULL) { return NULL; }
+  writer->sample_rate_hz = sample_rate_hz;
+  writer->num_channels = num_channels;
+  writer->num_buffers = num_buffers;
+  writer->buffer_capacity = (size_t)4 * num_channels * buffer_frames;
+  writer->buffer_sizes = (size_t*)calloc(num_buffers, sizeof(size_t));
+  writer->buffers = (uint8_t**)calloc(num_buffers, sizeof(uint8_t*));
+  writer->num_samples = 0;
+  writer->num_stalls = 0;
+  writer->num_submitted = 0;
+  writer->num_written = 0;
+  writer->closing = 0;
+  writer->io_error = 0;
+  if (writer->buffer_sizes == NULL || writer->buffers == NULL) {
+    FreeWriter(writer);
+    return NULL;
+  }
+  int i;
+  for (i = 0; i < num_buffers; ++i) {
+    if (!(writer->buffers[i] = (uint8_t*)malloc(writer->buffer_capacity))) {
+      FreeWriter(writer);
+      return NULL;
+    }
+  }
+
+  writer->f = fopen(filename, "wb");
+  if (writer->f == NULL) {
+    fprintf(stderr, "Error: Failed to open \"%s\" for writing.\n", filename);
+    FreeWriter(writer);
+    return NULL;
+  }
+  /* Write a dummy header. It is patched with the correct sizes on close. */
+  if (!WriteWavHeaderFloat(writer->f, 0, sample_rate_hz, num_channels)) {
+    fprintf(stderr, "Error: Failed to write \"%s\".\n", filename);
+    fclose(writer->f);
+    FreeWriter(writer);
+    return NULL;
+  }
+
+  if (pthread_mutex_init(&writer->lock, NULL) != 0) {
+    goto fail;
+  } else if (pthread_cond_init(&writer->cond, NULL) != 0) {
+    pthread_mutex_destroy(&writer->lock);
+    goto fail;
+  } else if (pthread_create(&writer->io_thread, NULL, IoThread, writer) != 0) {
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->lock);
+    goto fail;
+  }
+  return writer;
+
+fail:
+  fprintf(stderr, "Error: Failed to start AsyncWavWriter thread.\n");
+  fclose(writer->f);
+  FreeWriter(writer);
+  return NULL;
+}
+
+/* Submits the current buffer for writing, then waits until the next buffer is
+ * free. Returns 0 if an I/O error has occurred.
+ */
+static int SubmitBuffer(AsyncWavWriter* writer) {
+  pthread_mutex_lock(&writer->lock);
+  ++writer->num_submitted;
+  pthread_cond_broadcast(&writer->cond);
+  if (writer->num_submitted - writer->num_written >= writer->num_buffers) {
+    ++writer->num_stalls;
+    do {
+      pthread_cond_wait(&writer->cond, &writer->lock);
+    } while (writer->num_submitted - writer->num_written >=
+             writer->num_buffers);
+  }
+  const int io_error = writer->io_error;
+  pthread_mutex_unlock(&writer->lock);
+
+  const int index = (int)(writer->num_submitted % writer->num_buffers);
+  writer->buffer_sizes[index] = 0;
+  return !io_error;
+}
+
+int AsyncWavWriterWrite(AsyncWavWriter* writer,
+                        const float* samples,
+                        int num_frames) {
+  size_t num_samples = (size_t)num_frames * writer->num_channels;
+  if (num_samples > kMaxSamples - writer->num_samples) {
+    fprintf(stderr, "Error: AsyncWavWriter exceeded the WAV size limit.\n");
+    return 0;
+  }
+  writer->num_samples += num_samples;
+
+  /* The caller owns the current buffer, so it is filled without locking. */
+  int index = (int)(writer->num_submitted % writer->num_buffers);
+  while (num_samples > 0) {
+    uint8_t* dest = writer->buffers[index] + writer->buffer_sizes[index];
+    size_t chunk_samples =
+        (writer->buffer_capacity - writer->buffer_sizes[index]) / 4;
+    if (chunk_samples > num_samples) { chunk_samples = num_samples; }
+    size_t i;
+    for (i = 0; i < chunk_samples; ++i, dest += 4) {
+      LittleEndianWriteF32(samples[i], dest);
+    }
+    samples += chunk_samples;
+    num_samples -= chunk_samples;
+    writer->buffer_sizes[index] += 4 * chunk_samples;
+
+    if (writer->buffer_sizes[index] == writer->buffer_capacity) {
+      if (!SubmitBuffer(writer)) { return 0; }
+      index = (int)(writer->num_submitted % writer->num_buffers);
+    }
+  }
+  return 1;
+}
+
+long AsyncWavWriterNumStalls(const AsyncWavWriter* writer) {
+  return writer->num_stalls;
+}
+
+int AsyncWavWriterClose(AsyncWavWriter* writer) {
+  if (writer == NULL) { return 0; }
+  /* Submit the partially filled buffer, if any. */
+  const int index = (int)(writer->num_submitted % writer->num_buffers);
+  if (writer->buffer_sizes[index] > 0) {
+    pthread_mutex_lock(&writer->lock);
+    ++writer->num_submitted;
+    pthread_mutex_unlock(&writer->lock);
+  }
+
+  pthread_mutex_lock(&writer->lock);
+  writer->closing = 1;
+  pthread_cond_broadcast(&writer->cond);
+  pthread_mutex_unlock(&writer->lock);
+  pthread_join(writer->io_thread, NULL);
+  pthread_cond_destroy(&writer->cond);
+  pthread_mutex_destroy(&writer->lock);
+
+  /* Patch the header with the final sizes. */
+  int success = !writer->io_error;
+  success &= (fseek(writer->f, 0, SEEK_SET) == 0);
+  success &= WriteWavHeaderFloat(writer->f, writer->num_samples,
+                                 writer->sample_rate_hz, writer->num_channels);
+  success &= (fclose(writer->f) == 0);
+  if (!success) {
+    fprintf(stderr, "Error: AsyncWavWriter failed to write file.\n");
+  }
+
+  FreeWriter(writer);
+  return success;
+}
@@ -0,0 +1,79 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Streaming float WAV writer with asynchronous buffered output.
+ *
+ * AsyncWavWriter writes 32-bit float WAV files (see WriteWavHeaderFloat in
+ * src/dsp/write_wav_file.h) of any number of channels without blocking the
+ * caller on disk I/O. Samples are copied into one of a fixed set of buffers;
+ * when a buffer fills, it is handed through a bounded queue to a background
+ * thread that writes it to the file. The caller blocks only if all buffers are
+ * waiting to be written, i.e. if the disk can't keep up on average. The number
+ * of samples need not be known in advance; the header sizes are patched when
+ * the file is closed. Example:
+ *
+ *   AsyncWavWriter* writer = AsyncWavWriterOpen(
+ *       "out.wav", sample_rate_hz, num_channels, 4096, 4);
+ *   while (...) {
+ *     ... Process a block ...
+ *     AsyncWavWriterWrite(writer, output, block_size);
+ *   }
+ *   if (!AsyncWavWriterClose(writer)) {
+ *     // Handle error.
+ *   }
+ */
+
+#ifndef AUDIO_TO_TACTILE_EXTRAS_TOOLS_ASYNC_WAV_WRITER_H_
+#define AUDIO_TO_TACTILE_EXTRAS_TOOLS_ASYNC_WAV_WRITER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct AsyncWavWriter;
+typedef struct AsyncWavWriter AsyncWavWriter;
+
+/* Opens `filename` for writing and starts the background I/O thread. Each of
+ * the `num_buffers` buffers holds `buffer_frames` frames. Returns NULL on
+ * failure. The caller should close it with AsyncWavWriterClose().
+ */
+AsyncWavWriter* AsyncWavWriterOpen(const char* filename,
+                                   int sample_rate_hz,
+                                   int num_channels,
+                                   int buffer_frames,
+                                   int num_buffers);
+
+/* Writes `num_frames` frames of interleaved float samples. The samples are
+ * copied, so `samples` may be reused immediately. Blocks only if all buffers
+ * are queued for writing. Returns 1 on success, 0 if an I/O error has occurred
+ * or the file would exceed the 4 GB WAV size limit.
+ */
+int AsyncWavWriterWrite(AsyncWavWriter* writer,
+                        const float* samples,
+                        int num_frames);
+
+/* Number of times AsyncWavWriterWrite() has blocked waiting for a buffer. */
+long AsyncWavWriterNumStalls(const AsyncWavWriter* writer);
+
+/* Writes any buffered samples, stops the I/O thread, patches the header sizes,
+ * closes the file, and frees the writer. Returns 1 if the whole file was
+ * written successfully, 0 otherwise.
+ */
+int AsyncWavWriterClose(AsyncWavWriter* writer);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+#endif /* AUDIO_TO_TACTILE_EXTRAS_TOOLS_ASYNC_WAV_WRITER_H_ */
@@ -0,0 +1,126 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "extras/tools/async_wav_writer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/dsp/logging.h"
+#include "src/dsp/read_wav_file.h"
+
+static float RandUniform(void) { return (float)rand() / RAND_MAX - 0.5f; }
+
+/* Reads a float WAV file, checking its format. Returns the samples. */
+static float* ReadFloatWav(const char* filename, int expected_sample_rate_hz,
+                           int expected_num_channels, size_t* num_samples) {
+  FILE* f = CHECK_NOTNULL(fopen(filename, "rb"));
+  ReadWavInfo info;
+  CHECK(ReadWavHeader(f, &info));
+  CHECK(info.encoding == kIeeeFloat32Encoding);
+  CHECK(info.sample_rate_hz == expected_sample_rate_hz);
+  CHECK(info.num_channels == expected_num_channels);
+  *num_samples = info.remaining_samples;
+  float* samples = (float*)CHECK_NOTNULL(
+      malloc(sizeof(float) * (*num_samples + 1)));
+  CHECK(ReadWavSamples(f, &info, (int32_t*)samples, *num_samples) ==
+        *num_samples);
+  fclose(f);
+  return samples;
+}
+
+/* Writes random samples in chunks of random sizes, with small buffers so that
+ * many buffers are submitted, and checks that they are read back exactly.
+ */
+static void TestRoundTrip(int num_channels, int buffer_frames,
+                          int num_buffers) {
+  printf("TestRoundTrip(%d, %d, %d)\n",
+         num_channels, buffer_frames, num_buffers);
+  const int kSampleRateHz = 16000;
+  const int kNumFrames = 5000;
+  const size_t num_samples = (size_t)kNumFrames * num_channels;
+  float* samples = (float*)CHECK_NOTNULL(malloc(sizeof(float) * num_samples));
+  size_t i;
+  for (i = 0; i < num_samples; ++i) {
+    samples[i] = RandUniform();
+  }
+
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  AsyncWavWriter* writer = CHECK_NOTNULL(AsyncWavWriterOpen(
+      filename, kSampleRateHz, num_channels, buffer_frames, num_buffers));
+  int start = 0;
+  while (start < kNumFrames) {
+    int chunk_frames = rand() % 100;
+    if (chunk_frames > kNumFrames - start) {
+      chunk_frames = kNumFrames - start;
+    }
+    CHECK(AsyncWavWriterWrite(writer, samples + start * num_channels,
+                              chunk_frames));
+    start += chunk_frames;
+  }
+  CHECK(AsyncWavWriterNumStalls(writer) >= 0);
+  CHECK(AsyncWavWriterClose(writer));
+
+  size_t read_num_samples;
+  float* read_samples = ReadFloatWav(filename, kSampleRateHz, num_channels,
+                                     &read_num_samples);
+  CHECK(read_num_samples == num_samples);
+  CHECK(memcmp(read_samples, samples, sizeof(float) * num_samples) == 0);
+
+  free(read_samples);
+  free(samples);
+  remove(filename);
+}
+
+/* An empty file is still a valid WAV file. */
+static void TestEmpty(void) {
+  puts("TestEmpty");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  AsyncWavWriter* writer =
+      CHECK_NOTNULL(AsyncWavWriterOpen(filename, 8000, 10, 64, 2));
+  CHECK(AsyncWavWriterClose(writer));
+
+  size_t num_samples;
+  float* samples = ReadFloatWav(filename, 8000, 10, &num_samples);
+  CHECK(num_samples == 0);
+
+  free(samples);
+  remove(filename);
+}
+
+static void TestInvalidParams(void) {
+  puts("TestInvalidParams");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  CHECK(AsyncWavWriterOpen(filename, 0, 2, 64, 2) == NULL);
+  CHECK(AsyncWavWriterOpen(filename, 16000, 0, 64, 2) == NULL);
+  CHECK(AsyncWavWriterOpen(filename, 16000, 2, 0, 2) == NULL);
+  CHECK(AsyncWavWriterOpen(filename, 16000, 2, 64, 1) == NULL);
+  /* A directory that doesn't exist. */
+  CHECK(AsyncWavWriterOpen("/nonexistent/dir/out.wav", 16000, 2, 64, 2)
+        == NULL);
+}
+
+int main(int argc, char** argv) {
+  srand(0);
+  TestRoundTrip(1, 1000, 4);
+  TestRoundTrip(12, 7, 2);
+  TestRoundTrip(24, 64, 3);
+  TestEmpty();
+  TestInvalidParams();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Exports the compiled-in phonetics network weights as model files.
+ *
+ * Writes "<output_dir>/classify_phoneme.a2tm" and
+ * "<output_dir>/embed_vowel.a2tm" in the format of src/phonetics/model_data.h.
+ * These are a starting point for loading weights at runtime, e.g. with
+ * `run_classify_phoneme_on_wav --model=...`.
+ *
+ * Flags:
+ *  --output_dir=<path>  Directory in which to write the files (default ".").
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "extras/tools/model_file.h"
+#include "extras/tools/util.h"
+#include "src/phonetics/classify_phoneme.h"
+#include "src/phonetics/embed_vowel.h"
+
+static int WriteModel(const char* output_dir, const char* name,
+                      ModelDataType model_type,
+                      const ModelDataTensor* tensors, int num_tensors) {
+  char filename[1024];
+  snprintf(filename, sizeof(filename), "%s/%s.a2tm", output_dir, name);
+  if (!ModelFileWrite(filename, model_type, tensors, num_tensors)) {
+    return 0;
+  }
+  printf("Wrote %s (%d bytes)\n", filename,
+         (int)ModelDataSerializedSize(tensors, num_tensors));
+  return 1;
+}
+
+int main(int argc, char** argv) {
+  const char* output_dir = ".";
+  int i;
+  for (i = 1; i < argc; ++i) { /* Parse flags. */
+    if (StartsWith(argv[i], "--output_dir=")) {
+      output_dir = strchr(argv[i], '=') + 1;
+    } else {
+      fprintf(stderr, "Error: Invalid flag \"%s\"\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  ModelDataTensor classify_phoneme[kClassifyPhonemeModelNumTensors];
+  ClassifyPhonemeModelTensors(&kClassifyPhonemeDefaultModel, classify_phoneme);
+  ModelDataTensor embed_vowel[kEmbedVowelModelNumTensors];
+  EmbedVowelModelTensors(&kEmbedVowelDefaultModel, embed_vowel);
+
+  if (!WriteModel(output_dir, "classify_phoneme", kModelDataClassifyPhoneme,
+                  classify_phoneme, kClassifyPhonemeModelNumTensors) ||
+      !WriteModel(output_dir, "embed_vowel", kModelDataEmbedVowel,
+                  embed_vowel, kEmbedVowelModelNumTensors)) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
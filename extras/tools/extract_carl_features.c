@@ -0,0 +1,651 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Native parallel extraction of labeled CARL+PCEN features.
+ *
+ * This is a native counterpart of the feature computation in
+ * extras/python/phonetics/make_training_data.py. For each input .wav file
+ * with a .phn phone label file of the same name, the audio is mixed down to
+ * mono, resampled to the frontend sample rate if needed with QResampler, and
+ * run through CarlFrontendProcessSamples(), zero padding to a whole number of
+ * blocks. Each frame is labeled with the phone segment containing the frame's
+ * center sample, or with label 0 ("") if no segment contains it. Phone labels
+ * are stored as they appear in the .phn files; coalescing and exclusion of
+ * phones is left to the reader.
+ *
+ * Files are processed on a pool of threads, each reusing its own CarlFrontend,
+ * and utterances are appended to a feature store (see feature_store.h) as they
+ * finish. Read the output in Python with
+ * extras/python/phonetics/feature_store.py.
+ *
+ * The .phn format is as in TIMIT, one segment per line as
+ * "<start> <end> <label>" with sample indices at the .wav sample rate.
+ *
+ * Flags:
+ *  --input=<wavfile>          Input WAV file. May be repeated.
+ *  --input_list=<path>        Text file listing input WAV files, one per line.
+ *  --input_glob=<pattern>     Glob pattern of input WAV files, e.g.
+ *                             --input_glob='timit/train/dr1/fcjf0/s*.wav'.
+ *  --output=<path>            Output feature store file.
+ *  --num_threads=<int>        Number of threads (default: number of cores).
+ *  --block_size=<int>         Frontend block size (default 64).
+ *  --highest_pole_frequency_hz=<float>
+ *  --min_pole_frequency_hz=<float>
+ *  --step_erbs=<float>
+ *  --envelope_cutoff_hz=<float>
+ *  --pcen_time_constant_s=<float>
+ *  --pcen_cross_channel_diffusivity=<float>
+ *  --pcen_init_value=<float>
+ *  --pcen_alpha=<float>
+ *  --pcen_beta=<float>
+ *  --pcen_gamma=<float>
+ *  --pcen_delta=<float>
+ *                             CarlFrontendParams, with the same defaults as
+ *                             kCarlFrontendDefaultParams.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <glob.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "src/dsp/q_resampler.h"
+#include "src/frontend/carl_frontend.h"
+#include "extras/tools/feature_store.h"
+#include "extras/tools/mapped_wav_file.h"
+#include "extras/tools/util.h"
+
+#define kMaxThreads 256
+/* Number of input frames read and resampled at a time. */
+#define kChunkFrames 1024
+/* Max number of distinct labels in one .phn file. */
+#define kMaxLabelsPerFile 256
+
+/* Phone segment from a .phn file. */
+typedef struct {
+  long start;
+  long end;
+  int label;
+} Segment;
+
+/* State shared by all threads. */
+typedef struct {
+  CarlFrontendParams params;
+  FeatureStoreWriter* writer;
+  char** filenames;
+  int num_files;
+  pthread_mutex_t lock;
+  int next_file;  /* Guarded by `lock`. */
+} SharedState;
+
+typedef struct {
+  SharedState* shared;
+  int num_ok;
+  double audio_s;
+  size_t num_frames;
+
+  /* Per-thread processing state, reused from file to file. */
+  CarlFrontend* frontend;
+  int num_channels;
+  QResampler* resampler;
+  int resampler_sample_rate_hz;
+  float* input;
+  int input_capacity;
+  float* mono;
+  float* block;  /* Samples at the frontend rate, up to one block. */
+  int block_fill;
+  float* features;
+  size_t features_capacity;  /* In frames. */
+  size_t num_features;
+  Segment* segments;
+  int segments_capacity;
+} Worker;
+
+static double WallTimeSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* Gets the next file index, or -1 if all files are taken. */
+static int NextFile(SharedState* shared) {
+  pthread_mutex_lock(&shared->lock);
+  const int i = (shared->next_file < shared->num_files)
+      ? shared->next_file++ : -1;
+  pthread_mutex_unlock(&shared->lock);
+  return i;
+}
+
+/* Reads the .phn file for `wav_file` into worker->segments, interning labels
+ * in the feature store. Returns the number of segments, or -1 on failure.
+ */
+static int ReadPhoneSegments(Worker* worker, const char* wav_file) {
+  char phn_file[1024];
+  int stem_length = strlen(wav_file);
+  if (EndsWith(wav_file, ".wav") || EndsWith(wav_file, ".WAV")) {
+    stem_length -= 4;
+  }
+  snprintf(phn_file, sizeof(phn_file), "%.*s.phn", stem_length, wav_file);
+  FILE* f = fopen(phn_file, "r");
+  if (f == NULL) {
+    fprintf(stderr, "Error: .phn file not found: \"%s\"\n", phn_file);
+    return -1;
+  }
+
+  /* Cache label indices for this file to avoid locking for every segment. */
+  char label_names[kMaxLabelsPerFile][64];
+  int label_indices[kMaxLabelsPerFile];
+  int num_labels = 0;
+  int num_segments = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    long start;
+    long end;
+    char name[64];
+    if (sscanf(line, "%ld %ld %63s", &start, &end, name) != 3) {
+      continue;  /* Skip malformed lines, like phone_util.get_phone_times. */
+    }
+    int label = -1;
+    int i;
+    for (i = 0; i < num_labels; ++i) {
+      if (strcmp(label_names[i], name) == 0) {
+        label = label_indices[i];
+        break;
+      }
+    }
+    if (label < 0) {
+      label = FeatureStoreWriterLabelIndex(worker->shared->writer, name);
+      if (label < 0) { goto fail; }
+      if (num_labels < kMaxLabelsPerFile) {
+        strcpy(label_names[num_labels], name);
+        label_indices[num_labels++] = label;
+      }
+    }
+
+    if (num_segments == worker->segments_capacity) {
+      const int new_capacity = (worker->segments_capacity > 0)
+          ? 2 * worker->segments_capacity : 64;
+      Segment* new_segments = (Segment*)realloc(
+          worker->segments, sizeof(Segment) * new_capacity);
+      if (new_segments == NULL) { goto fail; }
+      worker->segments = new_segments;
+      worker->segments_capacity = new_capacity;
+    }
+    Segment* segment = &worker->segments[num_segments++];
+    segment->start = start;
+    segment->end = end;
+    segment->label = label;
+  }
+  fclose(f);
+  return num_segments;
+
+fail:
+  fclose(f);
+  return -1;
+}
+
+/* Runs the frontend on the samples in worker->block, which must be full, and
+ * appends the output frame to worker->features. Returns 1 on success.
+ */
+static int ProcessBlock(Worker* worker) {
+  const int num_channels = worker->num_channels;
+  if (worker->num_features == worker->features_capacity) {
+    const size_t new_capacity = (worker->features_capacity > 0)
+        ? 2 * worker->features_capacity : 1024;
+    float* new_features = (float*)realloc(
+        worker->features, sizeof(float) * new_capacity * num_channels);
+    if (new_features == NULL) { return 0; }
+    worker->features = new_features;
+    worker->features_capacity = new_capacity;
+  }
+  CarlFrontendProcessSamples(
+      worker->frontend, worker->block,
+      worker->features + worker->num_features * num_channels);
+  ++worker->num_features;
+  worker->block_fill = 0;
+  return 1;
+}
+
+/* Appends samples at the frontend rate, processing blocks as they fill. */
+static int AddSamples(Worker* worker, const float* samples, int num_samples) {
+  const int block_size = worker->shared->params.block_size;
+  int i;
+  for (i = 0; i < num_samples; ++i) {
+    worker->block[worker->block_fill++] = samples[i];
+    if (worker->block_fill == block_size && !ProcessBlock(worker)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Prepares `worker` for a file with the given sample rate and channels.
+ * Returns 1 on success, 0 on failure.
+ */
+static int PrepareWorker(Worker* worker, int sample_rate_hz, int num_channels) {
+  const float frontend_sample_rate_hz =
+      worker->shared->params.input_sample_rate_hz;
+  CarlFrontendReset(worker->frontend);
+  worker->block_fill = 0;
+  worker->num_features = 0;
+
+  if (sample_rate_hz == frontend_sample_rate_hz) {
+    /* No resampling needed. */
+  } else if (worker->resampler != NULL &&
+             worker->resampler_sample_rate_hz == sample_rate_hz) {
+    QResamplerReset(worker->resampler);
+  } else {
+    if (worker->resampler != NULL) { QResamplerFree(worker->resampler); }
+    worker->resampler = QResamplerMake(
+        sample_rate_hz, frontend_sample_rate_hz, 1, kChunkFrames, NULL);
+    worker->resampler_sample_rate_hz = sample_rate_hz;
+    if (worker->resampler == NULL) { return 0; }
+  }
+
+  if (num_channels * kChunkFrames > worker->input_capacity) {
+    free(worker->input);
+    worker->input_capacity = num_channels * kChunkFrames;
+    worker->input = (float*)malloc(sizeof(float) * worker->input_capacity);
+    if (worker->input == NULL) {
+      worker->input_capacity = 0;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Computes features for one file. Returns 1 on success. */
+static int ComputeFeatures(Worker* worker, const MappedWavFile* wav) {
+  const float frontend_sample_rate_hz =
+      worker->shared->params.input_sample_rate_hz;
+  const int block_size = worker->shared->params.block_size;
+  const int num_channels = wav->num_channels;
+  const float mix_scale = 1.0f / num_channels;
+  const int resample = (wav->sample_rate_hz != frontend_sample_rate_hz);
+  size_t start;
+  for (start = 0; start < wav->num_frames; start += kChunkFrames) {
+    const int num_read = (int)MappedWavFileReadFloat(
+        wav, start, kChunkFrames, worker->input);
+    /* Mix down to mono. */
+    const float* src = worker->input;
+    int i;
+    for (i = 0; i < num_read; ++i, src += num_channels) {
+      float sum = 0.0f;
+      int c;
+      for (c = 0; c < num_channels; ++c) {
+        sum += src[c];
+      }
+      worker->mono[i] = mix_scale * sum;
+    }
+
+    if (!resample) {
+      if (!AddSamples(worker, worker->mono, num_read)) { return 0; }
+    } else {
+      const int num_output = QResamplerProcessSamples(
+          worker->resampler, worker->mono, num_read);
+      if (!AddSamples(worker, QResamplerOutput(worker->resampler),
+                      num_output)) {
+        return 0;
+      }
+    }
+  }
+
+  if (resample) {
+    /* Flush the resampler, keeping output up to the end of the input. */
+    const size_t target = (size_t)ceil((double)wav->num_frames *
+        frontend_sample_rate_hz / wav->sample_rate_hz);
+    size_t num_samples =
+        worker->num_features * block_size + worker->block_fill;
+    int flush_frames = QResamplerFlushFrames(worker->resampler);
+    int i;
+    for (i = 0; i < kChunkFrames; ++i) {
+      worker->mono[i] = 0.0f;
+    }
+    while (flush_frames > 0 && num_samples < target) {
+      const int chunk_frames =
+          (flush_frames < kChunkFrames) ? flush_frames : kChunkFrames;
+      int num_output = QResamplerProcessSamples(
+          worker->resampler, worker->mono, chunk_frames);
+      if ((size_t)num_output > target - num_samples) {
+        num_output = (int)(target - num_samples);
+      }
+      if (!AddSamples(worker, QResamplerOutput(worker->resampler),
+                      num_output)) {
+        return 0;
+      }
+      num_samples += num_output;
+      flush_frames -= chunk_frames;
+    }
+  }
+
+  /* Zero pad to a whole number of blocks. */
+  if (worker->block_fill > 0) {
+    while (worker->block_fill < block_size) {
+      worker->block[worker->block_fill++] = 0.0f;
+    }
+    if (!ProcessBlock(worker)) { return 0; }
+  }
+  return 1;
+}
+
+/* Labels each frame with the segment containing its center sample. */
+static void LabelFrames(const Worker* worker, int num_segments,
+                        double wav_samples_per_frontend_sample,
+                        uint16_t* labels) {
+  const int block_size = worker->shared->params.block_size;
+  size_t i;
+  for (i = 0; i < worker->num_features; ++i) {
+    const long center = (long)(wav_samples_per_frontend_sample *
+                               (i * block_size + 0.5 * block_size));
+    int label = kFeatureStoreNoLabel;
+    int j;
+    for (j = 0; j < num_segments; ++j) {
+      const Segment* segment = &worker->segments[j];
+      if (segment->start <= center && center < segment->end) {
+        label = segment->label;
+        break;
+      }
+    }
+    labels[i] = (uint16_t)label;
+  }
+}
+
+/* Processes one file and appends it to the feature store. Returns 1 on
+ * success.
+ */
+static int ProcessFile(Worker* worker, const char* filename) {
+  const int num_segments = ReadPhoneSegments(worker, filename);
+  if (num_segments < 0) { return 0; }
+
+  MappedWavFile* wav = MappedWavFileOpen(filename);
+  if (wav == NULL) {
+    fprintf(stderr, "Error reading \"%s\"\n", filename);
+    return 0;
+  }
+  int ok = 0;
+  uint16_t* labels = NULL;
+  if (!PrepareWorker(worker, wav->sample_rate_hz, wav->num_channels) ||
+      !ComputeFeatures(worker, wav)) {
+    fprintf(stderr, "Error: Failed to process \"%s\"\n", filename);
+    goto done;
+  }
+
+  labels = (uint16_t*)malloc(
+      sizeof(uint16_t) * (worker->num_features > 0 ? worker->num_features : 1));
+  if (labels == NULL) { goto done; }
+  LabelFrames(worker, num_segments,
+              wav->sample_rate_hz / worker->shared->params.input_sample_rate_hz,
+              labels);
+  if (!FeatureStoreWriterAddUtterance(worker->shared->writer, filename,
+                                      worker->features, labels,
+                                      worker->num_features)) {
+    goto done;
+  }
+  worker->audio_s += (double)wav->num_frames / wav->sample_rate_hz;
+  worker->num_frames += worker->num_features;
+  ok = 1;
+
+done:
+  free(labels);
+  MappedWavFileClose(wav);
+  return ok;
+}
+
+static void* WorkerThread(void* arg) {
+  Worker* worker = (Worker*)arg;
+  int i;
+  while ((i = NextFile(worker->shared)) >= 0) {
+    worker->num_ok += ProcessFile(worker, worker->shared->filenames[i]);
+  }
+  return NULL;
+}
+
+static int InitWorker(Worker* worker, SharedState* shared) {
+  memset(worker, 0, sizeof(Worker));
+  worker->shared = shared;
+  worker->frontend = CarlFrontendMake(&shared->params);
+  if (worker->frontend == NULL) { return 0; }
+  worker->num_channels = CarlFrontendNumChannels(worker->frontend);
+  worker->mono = (float*)malloc(sizeof(float) * kChunkFrames);
+  worker->block = (float*)malloc(sizeof(float) * shared->params.block_size);
+  return worker->mono != NULL && worker->block != NULL;
+}
+
+static void FreeWorker(Worker* worker) {
+  if (worker->resampler != NULL) { QResamplerFree(worker->resampler); }
+  if (worker->frontend != NULL) { CarlFrontendFree(worker->frontend); }
+  free(worker->segments);
+  free(worker->features);
+  free(worker->block);
+  free(worker->mono);
+  free(worker->input);
+}
+
+/* Appends a copy of `filename` to `filenames`. Returns 1 on success. */
+static int AddFile(const char* filename, char*** filenames, int* num_files,
+                   int* capacity) {
+  if (*num_files == *capacity) {
+    const int new_capacity = (*capacity > 0) ? 2 * *capacity : 64;
+    char** new_filenames =
+        (char**)realloc(*filenames, sizeof(char*) * new_capacity);
+    if (new_filenames == NULL) { return 0; }
+    *filenames = new_filenames;
+    *capacity = new_capacity;
+  }
+  char* copy = (char*)malloc(strlen(filename) + 1);
+  if (copy == NULL) { return 0; }
+  strcpy(copy, filename);
+  (*filenames)[(*num_files)++] = copy;
+  return 1;
+}
+
+/* Adds files listed one per line in `list_file`. Returns 1 on success. */
+static int AddFilesFromList(const char* list_file, char*** filenames,
+                            int* num_files, int* capacity) {
+  FILE* f = fopen(list_file, "r");
+  if (f == NULL) {
+    fprintf(stderr, "Error: Failed to open \"%s\"\n", list_file);
+    return 0;
+  }
+  char line[1024];
+  int success = 1;
+  while (success && fgets(line, sizeof(line), f)) {
+    size_t length = strlen(line);
+    while (length > 0 && (line[length - 1] == '\n' ||
+                          line[length - 1] == '\r')) {
+      line[--length] = '\0';
+    }
+    if (length > 0) {
+      success = AddFile(line, filenames, num_files, capacity);
+    }
+  }
+  fclose(f);
+  return success;
+}
+
+/* Adds files matching glob `pattern`. Returns 1 on success. */
+static int AddFilesFromGlob(const char* pattern, char*** filenames,
+                            int* num_files, int* capacity) {
+  glob_t matches;
+  const int result = glob(pattern, 0, NULL, &matches);
+  if (result == GLOB_NOMATCH) {
+    fprintf(stderr, "Error: No files match \"%s\"\n", pattern);
+    return 0;
+  } else if (result != 0) {
+    fprintf(stderr, "Error: glob failed for \"%s\"\n", pattern);
+    return 0;
+  }
+  int success = 1;
+  size_t i;
+  for (i = 0; success && i < matches.gl_pathc; ++i) {
+    success = AddFile(matches.gl_pathv[i], filenames, num_files, capacity);
+  }
+  globfree(&matches);
+  return success;
+}
+
+int main(int argc, char** argv) {
+  SharedState shared;
+  shared.params = kCarlFrontendDefaultParams;
+  shared.writer = NULL;
+  shared.filenames = NULL;
+  shared.num_files = 0;
+  shared.next_file = 0;
+  const char* output = NULL;
+  int files_capacity = 0;
+  int num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  int status = EXIT_FAILURE;
+  int i;
+
+  for (i = 1; i < argc; ++i) { /* Parse flags. */
+    const char* value = strchr(argv[i], '=');
+    value = (value != NULL) ? value + 1 : "";
+    if (StartsWith(argv[i], "--input=")) {
+      if (!AddFile(value, &shared.filenames, &shared.num_files,
+                   &files_capacity)) {
+        goto done;
+      }
+    } else if (StartsWith(argv[i], "--input_list=")) {
+      if (!AddFilesFromList(value, &shared.filenames, &shared.num_files,
+                            &files_capacity)) {
+        goto done;
+      }
+    } else if (StartsWith(argv[i], "--input_glob=")) {
+      if (!AddFilesFromGlob(value, &shared.filenames, &shared.num_files,
+                            &files_capacity)) {
+        goto done;
+      }
+    } else if (StartsWith(argv[i], "--output=")) {
+      output = value;
+    } else if (StartsWith(argv[i], "--num_threads=")) {
+      num_threads = atoi(value);
+    } else if (StartsWith(argv[i], "--block_size=")) {
+      shared.params.block_size = atoi(value);
+    } else if (StartsWith(argv[i], "--highest_pole_frequency_hz=")) {
+      shared.params.highest_pole_frequency_hz = atof(value);
+    } else if (StartsWith(argv[i], "--min_pole_frequency_hz=")) {
+      shared.params.min_pole_frequency_hz = atof(value);
+    } else if (StartsWith(argv[i], "--step_erbs=")) {
+      shared.params.step_erbs = atof(value);
+    } else if (StartsWith(argv[i], "--envelope_cutoff_hz=")) {
+      shared.params.envelope_cutoff_hz = atof(value);
+    } else if (StartsWith(argv[i], "--pcen_time_constant_s=")) {
+      shared.params.pcen_time_constant_s = atof(value);
+    } else if (StartsWith(argv[i], "--pcen_cross_channel_diffusivity=")) {
+      shared.params.pcen_cross_channel_diffusivity = atof(value);
+    } else if (StartsWith(argv[i], "--pcen_init_value=")) {
+      shared.params.pcen_init_value = atof(value);
+    } else if (StartsWith(argv[i], "--pcen_alpha=")) {
+      shared.params.pcen_alpha = atof(value);
+    } else if (StartsWith(argv[i], "--pcen_beta=")) {
+      shared.params.pcen_beta = atof(value);
+    } else if (StartsWith(argv[i], "--pcen_gamma=")) {
+      shared.params.pcen_gamma = atof(value);
+    } else if (StartsWith(argv[i], "--pcen_delta=")) {
+      shared.params.pcen_delta = atof(value);
+    } else {
+      fprintf(stderr, "Error: Invalid flag \"%s\"\n", argv[i]);
+      goto done;
+    }
+  }
+
+  if (shared.num_files == 0) {
+    fprintf(stderr,
+            "Error: Must specify --input, --input_list, or --input_glob\n");
+    goto done;
+  } else if (output == NULL) {
+    fprintf(stderr, "Error: Must specify --output\n");
+    goto done;
+  } else if (shared.params.block_size <= 0) {
+    fprintf(stderr, "Error: block_size must be positive.\n");
+    goto done;
+  }
+  if (num_threads > shared.num_files) { num_threads = shared.num_files; }
+  if (!(1 <= num_threads && num_threads <= kMaxThreads)) {
+    fprintf(stderr, "Error: num_threads must be between 1 and %d.\n",
+            kMaxThreads);
+    goto done;
+  }
+
+  Worker workers[kMaxThreads];
+  if (!InitWorker(&workers[0], &shared)) {
+    fprintf(stderr, "Error: CarlFrontendMake failed.\n");
+    FreeWorker(&workers[0]);
+    goto done;
+  }
+  shared.writer = FeatureStoreWriterOpen(
+      output, workers[0].num_channels,
+      shared.params.input_sample_rate_hz / shared.params.block_size);
+  if (shared.writer == NULL) {
+    FreeWorker(&workers[0]);
+    goto done;
+  }
+  pthread_mutex_init(&shared.lock, NULL);
+
+  const double wall_start = WallTimeSeconds();
+  int num_workers = 1;
+  int t;
+  for (t = 1; t < num_threads; ++t) {
+    if (!InitWorker(&workers[t], &shared)) {
+      FreeWorker(&workers[t]);
+      break;
+    }
+    ++num_workers;
+  }
+  /* Thread 0 is the calling thread. */
+  pthread_t threads[kMaxThreads];
+  int started[kMaxThreads];
+  for (t = 1; t < num_workers; ++t) {
+    started[t] = (pthread_create(
+        &threads[t], NULL, WorkerThread, &workers[t]) == 0);
+  }
+  WorkerThread(&workers[0]);
+  int num_ok = 0;
+  double audio_s = 0.0;
+  size_t num_frames = 0;
+  for (t = 0; t < num_workers; ++t) {
+    if (t > 0 && started[t]) { pthread_join(threads[t], NULL); }
+    num_ok += workers[t].num_ok;
+    audio_s += workers[t].audio_s;
+    num_frames += workers[t].num_frames;
+    FreeWorker(&workers[t]);
+  }
+  pthread_mutex_destroy(&shared.lock);
+
+  const int closed = FeatureStoreWriterClose(shared.writer);
+  const double wall_s = WallTimeSeconds() - wall_start;
+  status = (closed && num_ok == shared.num_files)
+      ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  printf("Extracted %d of %d files, %.1f s of audio, %lu frames, in %.2f s "
+         "wall with %d threads.\n", num_ok, shared.num_files, audio_s,
+         (unsigned long)num_frames, wall_s, num_workers);
+  if (wall_s > 0.0) {
+    printf("Aggregate real-time factor: %.1fx.\n", audio_s / wall_s);
+  }
+
+done:
+  for (i = 0; i < shared.num_files; ++i) {
+    free(shared.filenames[i]);
+  }
+  free(shared.filenames);
+  return status;
+}
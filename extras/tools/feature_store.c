@@ -0,0 +1,473 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "extras/tools/feature_store.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/dsp/serialize.h"
+
+#define kMagic "FEAT"
+#define kVersion 1
+#define kHeaderSize 64
+#define kChunkAlignment 64
+#define kUtteranceRecordSize 32
+#define kLabelRecordSize 8
+
+static size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+static void EncodeHeader(int num_channels, float frame_rate_hz,
+                         uint32_t num_utterances, uint32_t num_labels,
+                         uint64_t num_frames, uint64_t index_offset,
+                         uint8_t* header) {
+  memset(header, 0, kHeaderSize);
+  memcpy(header, kMagic, 4);
+  LittleEndianWriteU32(kVersion, header + 4);
+  LittleEndianWriteU32((uint32_t)num_channels, header + 8);
+  LittleEndianWriteF32(frame_rate_hz, header + 12);
+  LittleEndianWriteU32(num_utterances, header + 16);
+  LittleEndianWriteU32(num_labels, header + 20);
+  LittleEndianWriteU64(num_frames, header + 24);
+  LittleEndianWriteU64(index_offset, header + 32);
+}
+
+typedef struct {
+  uint64_t features_offset;
+  uint64_t labels_offset;
+  uint64_t num_frames;
+  char* name;
+} UtteranceRecord;
+
+struct FeatureStoreWriter {
+  FILE* f;
+  int num_channels;
+  float frame_rate_hz;
+  pthread_mutex_t lock;
+  /* The following are guarded by `lock`. */
+  uint64_t file_offset;
+  uint64_t num_frames;
+  UtteranceRecord* utterances;
+  int num_utterances;
+  int utterances_capacity;
+  char** labels;
+  int num_labels;
+  int labels_capacity;
+  int io_error;
+};
+
+static char* CopyString(const char* s) {
+  char* copy = (char*)malloc(strlen(s) + 1);
+  if (copy != NULL) { strcpy(copy, s); }
+  return copy;
+}
+
+static void FreeWriter(FeatureStoreWriter* writer) {
+  int i;
+  for (i = 0; i < writer->num_utterances; ++i) {
+    free(writer->utterances[i].name);
+  }
+  for (i = 0; i < writer->num_labels; ++i) {
+    free(writer->labels[i]);
+  }
+  free(writer->utterances);
+  free(writer->labels);
+  pthread_mutex_destroy(&writer->lock);
+  free(writer);
+}
+
+FeatureStoreWriter* FeatureStoreWriterOpen(const char* filename,
+                                           int num_channels,
+                                           float frame_rate_hz) {
+  if (num_channels <= 0 || !(frame_rate_hz > 0.0f)) {
+    fprintf(stderr, "Error: Invalid feature store parameters.\n");
+    return NULL;
+  }
+  FeatureStoreWriter* writer =
+      (FeatureStoreWriter*)malloc(sizeof(FeatureStoreWriter));
+  if (writer == NULL) { return NULL; }
+  writer->num_channels = num_channels;
+  writer->frame_rate_hz = frame_rate_hz;
+  pthread_mutex_init(&writer->lock, NULL);
+  writer->file_offset = kHeaderSize;
+  writer->num_frames = 0;
+  writer->utterances = NULL;
+  writer->num_utterances = 0;
+  writer->utterances_capacity = 0;
+  writer->labels = NULL;
+  writer->num_labels = 0;
+  writer->labels_capacity = 0;
+  writer->io_error = 0;
+
+  if (FeatureStoreWriterLabelIndex(writer, "") != kFeatureStoreNoLabel) {
+    FreeWriter(writer);
+    return NULL;
+  }
+
+  writer->f = fopen(filename, "wb");
+  if (writer->f == NULL) {
+    fprintf(stderr, "Error: Failed to open \"%s\" for writing.\n", filename);
+    FreeWriter(writer);
+    return NULL;
+  }
+  /* Write a placeholder header. It is rewritten on close. */
+  uint8_t header[kHeaderSize];
+  memset(header, 0, kHeaderSize);
+  if (fwrite(header, 1, kHeaderSize, writer->f) != kHeaderSize) {
+    fprintf(stderr, "Error: Failed to write \"%s\".\n", filename);
+    fclose(writer->f);
+    FreeWriter(writer);
+    return NULL;
+  }
+  return writer;
+}
+
+int FeatureStoreWriterLabelIndex(FeatureStoreWriter* writer, const char* name) {
+  int index = -1;
+  pthread_mutex_lock(&writer->lock);
+  int i;
+  for (i = 0; i < writer->num_labels; ++i) {
+    if (strcmp(writer->labels[i], name) == 0) {
+      index = i;
+      goto done;
+    }
+  }
+  if (writer->num_labels == kFeatureStoreMaxLabels) {
+    fprintf(stderr, "Error: Too many labels.\n");
+    goto done;
+  }
+  if (writer->num_labels == writer->labels_capacity) {
+    const int new_capacity =
+        (writer->labels_capacity > 0) ? 2 * writer->labels_capacity : 64;
+    char** new_labels =
+        (char**)realloc(writer->labels, sizeof(char*) * new_capacity);
+    if (new_labels == NULL) { goto done; }
+    writer->labels = new_labels;
+    writer->labels_capacity = new_capacity;
+  }
+  if ((writer->labels[writer->num_labels] = CopyString(name)) != NULL) {
+    index = writer->num_labels++;
+  }
+
+done:
+  pthread_mutex_unlock(&writer->lock);
+  return index;
+}
+
+int FeatureStoreWriterAddUtterance(FeatureStoreWriter* writer,
+                                   const char* name,
+                                   const float* features,
+                                   const uint16_t* labels,
+                                   size_t num_frames) {
+  /* Serialize the chunk before taking the lock, so that threads only contend
+   * for the write itself.
+   */
+  const size_t num_values = num_frames * writer->num_channels;
+  const size_t labels_start = AlignUp(4 * num_values, kChunkAlignment);
+  const size_t chunk_size = labels_start + 2 * num_frames;
+  uint8_t* chunk = (uint8_t*)calloc(chunk_size > 0 ? chunk_size : 1, 1);
+  char* name_copy = CopyString(name);
+  if (chunk == NULL || name_copy == NULL) {
+    free(name_copy);
+    free(chunk);
+    return 0;
+  }
+  size_t i;
+  for (i = 0; i < num_values; ++i) {
+    LittleEndianWriteF32(features[i], chunk + 4 * i);
+  }
+  for (i = 0; i < num_frames; ++i) {
+    LittleEndianWriteU16(labels[i], chunk + labels_start + 2 * i);
+  }
+
+  int success = 0;
+  pthread_mutex_lock(&writer->lock);
+  if (writer->io_error) { goto done; }
+  if (writer->num_utterances == writer->utterances_capacity) {
+    const int new_capacity = (writer->utterances_capacity > 0)
+        ? 2 * writer->utterances_capacity : 256;
+    UtteranceRecord* new_utterances = (UtteranceRecord*)realloc(
+        writer->utterances, sizeof(UtteranceRecord) * new_capacity);
+    if (new_utterances == NULL) { goto done; }
+    writer->utterances = new_utterances;
+    writer->utterances_capacity = new_capacity;
+  }
+
+  /* Pad to align the chunk. */
+  static const uint8_t kZeros[kChunkAlignment] = {0};
+  const size_t padding =
+      AlignUp(writer->file_offset, kChunkAlignment) - writer->file_offset;
+  if (fwrite(kZeros, 1, padding, writer->f) != padding ||
+      fwrite(chunk, 1, chunk_size, writer->f) != chunk_size) {
+    fprintf(stderr, "Error: Failed to write feature store.\n");
+    writer->io_error = 1;
+    goto done;
+  }
+  UtteranceRecord* record = &writer->utterances[writer->num_utterances++];
+  record->features_offset = writer->file_offset + padding;
+  record->labels_offset = record->features_offset + labels_start;
+  record->num_frames = num_frames;
+  record->name = name_copy;
+  name_copy = NULL;
+  writer->file_offset += padding + chunk_size;
+  writer->num_frames += num_frames;
+  success = 1;
+
+done:
+  pthread_mutex_unlock(&writer->lock);
+  free(name_copy);
+  free(chunk);
+  return success;
+}
+
+/* Encodes the string table offset and length of `s` into `record`, and
+ * advances `*string_offset` past it.
+ */
+static void EncodeStringRecord(const char* s, uint32_t* string_offset,
+                               uint8_t* record) {
+  const uint32_t length = (uint32_t)strlen(s);
+  LittleEndianWriteU32(*string_offset, record);
+  LittleEndianWriteU32(length, record + 4);
+  *string_offset += length;
+}
+
+int FeatureStoreWriterClose(FeatureStoreWriter* writer) {
+  if (writer == NULL) { return 0; }
+  FILE* f = writer->f;
+  int success = !writer->io_error;
+
+  /* Align the index to 8 bytes. */
+  static const uint8_t kZeros[8] = {0};
+  const size_t padding = AlignUp(writer->file_offset, 8) - writer->file_offset;
+  success &= (fwrite(kZeros, 1, padding, f) == padding);
+  const uint64_t index_offset = writer->file_offset + padding;
+
+  uint32_t string_offset = 0;
+  int i;
+  for (i = 0; i < writer->num_utterances; ++i) {
+    const UtteranceRecord* utterance = &writer->utterances[i];
+    uint8_t record[kUtteranceRecordSize];
+    LittleEndianWriteU64(utterance->features_offset, record);
+    LittleEndianWriteU64(utterance->labels_offset, record + 8);
+    LittleEndianWriteU64(utterance->num_frames, record + 16);
+    EncodeStringRecord(utterance->name, &string_offset, record + 24);
+    success &= (fwrite(record, 1, kUtteranceRecordSize, f) ==
+                kUtteranceRecordSize);
+  }
+  for (i = 0; i < writer->num_labels; ++i) {
+    uint8_t record[kLabelRecordSize];
+    EncodeStringRecord(writer->labels[i], &string_offset, record);
+    success &= (fwrite(record, 1, kLabelRecordSize, f) == kLabelRecordSize);
+  }
+  for (i = 0; i < writer->num_utterances; ++i) {
+    const char* name = writer->utterances[i].name;
+    success &= (fwrite(name, 1, strlen(name), f) == strlen(name));
+  }
+  for (i = 0; i < writer->num_labels; ++i) {
+    const char* name = writer->labels[i];
+    success &= (fwrite(name, 1, strlen(name), f) == strlen(name));
+  }
+
+  /* Rewrite the header with the final sizes. */
+  uint8_t header[kHeaderSize];
+  EncodeHeader(writer->num_channels, writer->frame_rate_hz,
+               writer->num_utterances, writer->num_labels,
+               writer->num_frames, index_offset, header);
+  success &= (fseek(f, 0, SEEK_SET) == 0);
+  success &= (fwrite(header, 1, kHeaderSize, f) == kHeaderSize);
+  success &= (fclose(f) == 0);
+  if (!success) {
+    fprintf(stderr, "Error: Failed to write feature store.\n");
+  }
+
+  FreeWriter(writer);
+  return success;
+}
+
+static int IsLittleEndianHost(void) {
+  const uint16_t value = 1;
+  return *((const uint8_t*)&value) == 1;
+}
+
+/* Checks that string record `record` is within the string table. */
+static int ValidStringRecord(const MappedFeatureStore* store,
+                             const uint8_t* record) {
+  const uint64_t offset = LittleEndianReadU32(record);
+  const uint64_t length = LittleEndianReadU32(record + 4);
+  return offset + length <= store->strings_size;
+}
+
+/* Validates the header and index. Returns 1 if valid. */
+static int ValidateStore(MappedFeatureStore* store) {
+  const uint8_t* header = store->mapping;
+  if (store->mapping_size < kHeaderSize ||
+      memcmp(header, kMagic, 4) != 0 ||
+      LittleEndianReadU32(header + 4) != kVersion) {
+    return 0;
+  }
+  const uint32_t num_channels = LittleEndianReadU32(header + 8);
+  const uint32_t num_utterances = LittleEndianReadU32(header + 16);
+  const uint32_t num_labels = LittleEndianReadU32(header + 20);
+  const uint64_t num_frames = LittleEndianReadU64(header + 24);
+  const uint64_t index_offset = LittleEndianReadU64(header + 32);
+  const uint64_t index_size = (uint64_t)num_utterances * kUtteranceRecordSize +
+      (uint64_t)num_labels * kLabelRecordSize;
+  if (num_channels == 0 || num_channels > 1000000 ||
+      num_utterances > INT32_MAX || num_labels > kFeatureStoreMaxLabels ||
+      index_offset < kHeaderSize || index_offset % 8 != 0 ||
+      index_offset > store->mapping_size ||
+      index_size > store->mapping_size - index_offset) {
+    return 0;
+  }
+  store->num_channels = (int)num_channels;
+  store->frame_rate_hz = LittleEndianReadF32(header + 12);
+  store->num_utterances = (int)num_utterances;
+  store->num_labels = (int)num_labels;
+  store->num_frames = (size_t)num_frames;
+  store->index = store->mapping + index_offset;
+  store->label_records =
+      store->index + (size_t)num_utterances * kUtteranceRecordSize;
+  store->strings = (const char*)(store->label_records +
+                                 (size_t)num_labels * kLabelRecordSize);
+  store->strings_size = store->mapping_size - index_offset - index_size;
+
+  uint64_t total_frames = 0;
+  uint32_t i;
+  for (i = 0; i < num_utterances; ++i) {
+    const uint8_t* record = store->index + (size_t)i * kUtteranceRecordSize;
+    const uint64_t features_offset = LittleEndianReadU64(record);
+    const uint64_t labels_offset = LittleEndianReadU64(record + 8);
+    const uint64_t n = LittleEndianReadU64(record + 16);
+    /* Chunks lie between the header and the index, without overflow. */
+    if (features_offset < kHeaderSize || features_offset % 4 != 0 ||
+        labels_offset % 2 != 0 || n > index_offset ||
+        features_offset > index_offset ||
+        n * num_channels > (index_offset - features_offset) / 4 ||
+        labels_offset > index_offset ||
+        n > (index_offset - labels_offset) / 2 ||
+        !ValidStringRecord(store, record + 24)) {
+      return 0;
+    }
+    total_frames += n;
+  }
+  for (i = 0; i < num_labels; ++i) {
+    if (!ValidStringRecord(store,
+                           store->label_records + i * kLabelRecordSize)) {
+      return 0;
+    }
+  }
+  return total_frames == num_frames;
+}
+
+MappedFeatureStore* MappedFeatureStoreOpen(const char* filename) {
+  if (!IsLittleEndianHost()) {
+    fprintf(stderr, "Error: MappedFeatureStore requires little endian.\n");
+    return NULL;
+  }
+  const int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
+    perror("Error");
+    fprintf(stderr, "Error: Failed to open \"%s\".\n", filename);
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    fprintf(stderr, "Error: Failed to stat \"%s\" or it is empty.\n",
+            filename);
+    close(fd);
+    return NULL;
+  }
+
+  const size_t size = (size_t)st.st_size;
+  void* mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  /* The mapping remains valid after closing the descriptor. */
+  if (mapping == MAP_FAILED) {
+    perror("Error");
+    fprintf(stderr, "Error: Failed to mmap \"%s\".\n", filename);
+    return NULL;
+  }
+
+  MappedFeatureStore* store =
+      (MappedFeatureStore*)malloc(sizeof(MappedFeatureStore));
+  if (store == NULL) {
+    munmap(mapping, size);
+    return NULL;
+  }
+  store->mapping = (const uint8_t*)mapping;
+  store->mapping_size = size;
+
+  if (!ValidateStore(store)) {
+    fprintf(stderr, "Error: Invalid feature store \"%s\".\n", filename);
+    MappedFeatureStoreClose(store);
+    return NULL;
+  }
+  return store;
+}
+
+void MappedFeatureStoreClose(MappedFeatureStore* store) {
+  if (store != NULL) {
+    munmap((void*)store->mapping, store->mapping_size);
+    free(store);
+  }
+}
+
+void MappedFeatureStoreUtterance(const MappedFeatureStore* store,
+                                 int i,
+                                 const float** features,
+                                 const uint16_t** labels,
+                                 size_t* num_frames,
+                                 const char** name,
+                                 int* name_length) {
+  const uint8_t* record = store->index + (size_t)i * kUtteranceRecordSize;
+  if (features != NULL) {
+    *features = (const float*)(store->mapping + LittleEndianReadU64(record));
+  }
+  if (labels != NULL) {
+    *labels =
+        (const uint16_t*)(store->mapping + LittleEndianReadU64(record + 8));
+  }
+  if (num_frames != NULL) {
+    *num_frames = (size_t)LittleEndianReadU64(record + 16);
+  }
+  if (name != NULL) {
+    *name = store->strings + LittleEndianReadU32(record + 24);
+  }
+  if (name_length != NULL) {
+    *name_length = (int)LittleEndianReadU32(record + 28);
+  }
+}
+
+const char* MappedFeatureStoreLabelName(const MappedFeatureStore* store,
+                                        int label,
+                                        int* name_length) {
+  *name_length = 0;
+  if (!(0 <= label && label < store->num_labels)) { return NULL; }
+  const uint8_t* record =
+      store->label_records + (size_t)label * kLabelRecordSize;
+  if (!ValidStringRecord(store, record)) { return NULL; }
+  *name_length = (int)LittleEndianReadU32(record + 4);
+  return store->strings + LittleEndianReadU32(record);
+}
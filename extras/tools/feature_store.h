@@ -0,0 +1,159 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Chunked, memory-mappable store of labeled feature frames.
+ *
+ * A feature store holds frontend features for a corpus of utterances, e.g.
+ * CARL+PCEN frames for TIMIT, with a label per frame. Unlike a .npz archive,
+ * nothing needs to be decompressed or loaded up front: the file is mapped and
+ * each utterance's features and labels are used in place. This way training
+ * can stream a dataset larger than RAM.
+ * extras/python/phonetics/feature_store.py reads the same format as zero-copy
+ * numpy arrays.
+ *
+ * Each utterance is one chunk, appended as it is produced. The writer may be
+ * shared by multiple threads. The index is written on close.
+ *
+ * File layout, all little endian:
+ *
+ *   Offset  Size  Field
+ *   0       4     Magic "FEAT".
+ *   4       4     Format version, currently 1.
+ *   8       4     num_channels.
+ *   12      4     Frame rate in Hz, float32.
+ *   16      4     num_utterances.
+ *   20      4     num_labels.
+ *   24      8     num_frames, total over all utterances.
+ *   32      8     Byte offset of the index.
+ *   40      24    Reserved, 0.
+ *   64            Chunks. For each utterance, its features as a float32 array
+ *                 of shape [num_frames, num_channels], then its labels as a
+ *                 uint16 array of shape [num_frames]. Both start at 64-byte
+ *                 aligned offsets.
+ *   (index)       num_utterances records of 32 bytes:
+ *                   uint64 features offset,
+ *                   uint64 labels offset,
+ *                   uint64 num_frames,
+ *                   uint32 name offset in the string table,
+ *                   uint32 name length.
+ *                 num_labels records of 8 bytes:
+ *                   uint32 label name offset in the string table,
+ *                   uint32 label name length.
+ *                 String table, to the end of the file.
+ *
+ * Label 0 is reserved with name "" for frames not covered by any label.
+ */
+
+#ifndef AUDIO_TO_TACTILE_EXTRAS_TOOLS_FEATURE_STORE_H_
+#define AUDIO_TO_TACTILE_EXTRAS_TOOLS_FEATURE_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Label for frames not covered by any label. */
+#define kFeatureStoreNoLabel 0
+/* Max number of distinct labels, including kFeatureStoreNoLabel. */
+#define kFeatureStoreMaxLabels 65536
+
+struct FeatureStoreWriter;
+typedef struct FeatureStoreWriter FeatureStoreWriter;
+
+/* Opens `filename` for writing features with `num_channels` channels at frame
+ * rate `frame_rate_hz`. Returns NULL on failure. The caller should close it
+ * with FeatureStoreWriterClose().
+ */
+FeatureStoreWriter* FeatureStoreWriterOpen(const char* filename,
+                                           int num_channels,
+                                           float frame_rate_hz);
+
+/* Gets the label index for `name`, adding it to the label table if new.
+ * Returns -1 on failure or if there are too many labels. Thread safe.
+ */
+int FeatureStoreWriterLabelIndex(FeatureStoreWriter* writer, const char* name);
+
+/* Appends an utterance with `num_frames` frames. `features` has shape
+ * [num_frames, num_channels] and `labels` has shape [num_frames], with label
+ * indices from FeatureStoreWriterLabelIndex(). Returns 1 on success, 0 on
+ * failure. Thread safe; utterances are indexed in the order they are added.
+ */
+int FeatureStoreWriterAddUtterance(FeatureStoreWriter* writer,
+                                   const char* name,
+                                   const float* features,
+                                   const uint16_t* labels,
+                                   size_t num_frames);
+
+/* Writes the index, closes the file, and frees the writer. Returns 1 if the
+ * whole file was written successfully, 0 otherwise.
+ */
+int FeatureStoreWriterClose(FeatureStoreWriter* writer);
+
+typedef struct {
+  /* Number of channels per frame. */
+  int num_channels;
+  /* Frame rate in Hz. */
+  float frame_rate_hz;
+  /* Number of utterances. */
+  int num_utterances;
+  /* Number of labels, including kFeatureStoreNoLabel. */
+  int num_labels;
+  /* Total number of frames. */
+  size_t num_frames;
+
+  /* Private fields. */
+  const uint8_t* index;
+  const uint8_t* label_records;
+  const char* strings;
+  size_t strings_size;
+  const uint8_t* mapping;
+  size_t mapping_size;
+} MappedFeatureStore;
+
+/* Maps a feature store and validates its index. Returns NULL on failure. The
+ * caller should close it with MappedFeatureStoreClose().
+ */
+MappedFeatureStore* MappedFeatureStoreOpen(const char* filename);
+
+/* Unmaps a feature store. Pointers into the store are invalid afterward. */
+void MappedFeatureStoreClose(MappedFeatureStore* store);
+
+/* Gets utterance `i`, 0 <= i < num_utterances. Pointers are into the mapping.
+ * `features` has shape [*num_frames, num_channels]. The name is not
+ * nul-terminated; its length is returned in `*name_length`. Any of the output
+ * pointers may be NULL. The host must be little endian.
+ */
+void MappedFeatureStoreUtterance(const MappedFeatureStore* store,
+                                 int i,
+                                 const float** features,
+                                 const uint16_t** labels,
+                                 size_t* num_frames,
+                                 const char** name,
+                                 int* name_length);
+
+/* Gets the name of label `label`, not nul-terminated, and its length. Returns
+ * NULL with length 0 if `label` is not in [0, num_labels) or its name does not
+ * fit in the mapped file.
+ */
+const char* MappedFeatureStoreLabelName(const MappedFeatureStore* store,
+                                        int label,
+                                        int* name_length);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+#endif /* AUDIO_TO_TACTILE_EXTRAS_TOOLS_FEATURE_STORE_H_ */
@@ -0,0 +1,203 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "extras/tools/feature_store.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/dsp/logging.h"
+
+#define kNumChannels 5
+#define kNumThreads 4
+#define kUtterancesPerThread 25
+
+static const char* kLabelNames[4] = {"sil", "aa", "iy", "uw"};
+
+/* Deterministic feature value for an utterance, frame, and channel. */
+static float FeatureValue(int utterance, size_t frame, int channel) {
+  return utterance + 0.001f * frame + 0.1f * channel;
+}
+
+static size_t UtteranceNumFrames(int utterance) {
+  return (size_t)(utterance * 37) % 101;  /* Includes 0-frame utterances. */
+}
+
+typedef struct {
+  FeatureStoreWriter* writer;
+  int thread_index;
+} ThreadArgs;
+
+static void* WriterThread(void* arg) {
+  const ThreadArgs* args = (const ThreadArgs*)arg;
+  float* features = (float*)CHECK_NOTNULL(
+      malloc(sizeof(float) * 101 * kNumChannels));
+  uint16_t labels[101];
+  int k;
+  for (k = 0; k < kUtterancesPerThread; ++k) {
+    const int utterance = args->thread_index * kUtterancesPerThread + k;
+    const size_t num_frames = UtteranceNumFrames(utterance);
+    size_t i;
+    for (i = 0; i < num_frames; ++i) {
+      int c;
+      for (c = 0; c < kNumChannels; ++c) {
+        features[i * kNumChannels + c] = FeatureValue(utterance, i, c);
+      }
+      const char* label_name = kLabelNames[(utterance + i / 10) % 4];
+      labels[i] = (i % 7 == 0) ? kFeatureStoreNoLabel
+          : FeatureStoreWriterLabelIndex(args->writer, label_name);
+    }
+    char name[32];
+    sprintf(name, "utterance%d.wav", utterance);
+    CHECK(FeatureStoreWriterAddUtterance(
+        args->writer, name, features, labels, num_frames));
+  }
+  free(features);
+  return NULL;
+}
+
+/* Multiple threads write utterances concurrently. Reading back gets the same
+ * features and labels for every utterance, regardless of order.
+ */
+static void TestConcurrentWriteAndRead(void) {
+  puts("TestConcurrentWriteAndRead");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  FeatureStoreWriter* writer =
+      CHECK_NOTNULL(FeatureStoreWriterOpen(filename, kNumChannels, 250.0f));
+  pthread_t threads[kNumThreads];
+  ThreadArgs args[kNumThreads];
+  int t;
+  for (t = 0; t < kNumThreads; ++t) {
+    args[t].writer = writer;
+    args[t].thread_index = t;
+    CHECK(pthread_create(&threads[t], NULL, WriterThread, &args[t]) == 0);
+  }
+  for (t = 0; t < kNumThreads; ++t) {
+    CHECK(pthread_join(threads[t], NULL) == 0);
+  }
+  CHECK(FeatureStoreWriterClose(writer));
+
+  MappedFeatureStore* store = CHECK_NOTNULL(MappedFeatureStoreOpen(filename));
+  const int kNumUtterances = kNumThreads * kUtterancesPerThread;
+  CHECK(store->num_channels == kNumChannels);
+  CHECK(store->frame_rate_hz == 250.0f);
+  CHECK(store->num_utterances == kNumUtterances);
+  CHECK(store->num_labels == 5);
+
+  int name_length;
+  const char* label_name = MappedFeatureStoreLabelName(
+      store, kFeatureStoreNoLabel, &name_length);
+  CHECK(name_length == 0);
+  /* Out-of-range labels are rejected. */
+  CHECK(MappedFeatureStoreLabelName(store, -1, &name_length) == NULL);
+  CHECK(MappedFeatureStoreLabelName(store, store->num_labels, &name_length)
+        == NULL);
+  CHECK(name_length == 0);
+
+  int seen[kNumThreads * kUtterancesPerThread];
+  memset(seen, 0, sizeof(seen));
+  size_t total_frames = 0;
+  int i;
+  for (i = 0; i < store->num_utterances; ++i) {
+    const float* features;
+    const uint16_t* labels;
+    size_t num_frames;
+    const char* name;
+    MappedFeatureStoreUtterance(store, i, &features, &labels, &num_frames,
+                                &name, &name_length);
+    /* Features are aligned for in-place use. */
+    CHECK(((size_t)features) % 64 == 0);
+
+    char name_copy[32];
+    CHECK(name_length < (int)sizeof(name_copy));
+    memcpy(name_copy, name, name_length);
+    name_copy[name_length] = '\0';
+    int utterance;
+    CHECK(sscanf(name_copy, "utterance%d.wav", &utterance) == 1);
+    CHECK(0 <= utterance && utterance < kNumUtterances);
+    CHECK(!seen[utterance]);
+    seen[utterance] = 1;
+    CHECK(num_frames == UtteranceNumFrames(utterance));
+    total_frames += num_frames;
+
+    size_t j;
+    for (j = 0; j < num_frames; ++j) {
+      int c;
+      for (c = 0; c < kNumChannels; ++c) {
+        CHECK(features[j * kNumChannels + c] == FeatureValue(utterance, j, c));
+      }
+      label_name = MappedFeatureStoreLabelName(store, labels[j], &name_length);
+      if (j % 7 == 0) {
+        CHECK(labels[j] == kFeatureStoreNoLabel);
+      } else {
+        const char* expected = kLabelNames[(utterance + j / 10) % 4];
+        CHECK(name_length == (int)strlen(expected));
+        CHECK(memcmp(label_name, expected, name_length) == 0);
+      }
+    }
+  }
+  CHECK(store->num_frames == total_frames);
+
+  MappedFeatureStoreClose(store);
+  remove(filename);
+}
+
+static void TestEmptyAndInvalid(void) {
+  puts("TestEmptyAndInvalid");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  CHECK(FeatureStoreWriterOpen(filename, 0, 250.0f) == NULL);
+
+  FeatureStoreWriter* writer =
+      CHECK_NOTNULL(FeatureStoreWriterOpen(filename, 3, 100.0f));
+  CHECK(FeatureStoreWriterClose(writer));
+  MappedFeatureStore* store = CHECK_NOTNULL(MappedFeatureStoreOpen(filename));
+  CHECK(store->num_utterances == 0);
+  CHECK(store->num_frames == 0);
+  CHECK(store->num_labels == 1);
+  MappedFeatureStoreClose(store);
+
+  /* Truncating the file invalidates the index. */
+  writer = CHECK_NOTNULL(FeatureStoreWriterOpen(filename, 3, 100.0f));
+  const float features[6] = {1, 2, 3, 4, 5, 6};
+  const uint16_t labels[2] = {0, 0};
+  CHECK(FeatureStoreWriterAddUtterance(writer, "a", features, labels, 2));
+  CHECK(FeatureStoreWriterClose(writer));
+  FILE* f = CHECK_NOTNULL(fopen(filename, "rb"));
+  uint8_t buffer[512];
+  const size_t size = fread(buffer, 1, sizeof(buffer), f);
+  fclose(f);
+  f = CHECK_NOTNULL(fopen(filename, "wb"));
+  CHECK(fwrite(buffer, 1, size - 20, f) == size - 20);
+  fclose(f);
+  CHECK(MappedFeatureStoreOpen(filename) == NULL);
+
+  f = CHECK_NOTNULL(fopen(filename, "wb"));
+  CHECK(fwrite("not a feature store", 1, 19, f) == 19);
+  fclose(f);
+  CHECK(MappedFeatureStoreOpen(filename) == NULL);
+
+  remove(filename);
+  CHECK(MappedFeatureStoreOpen(filename) == NULL);
+}
+
+int main(int argc, char** argv) {
+  TestConcurrentWriteAndRead();
+  TestEmptyAndInvalid();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,298 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "extras/tools/mapped_wav_file.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/dsp/convert_sample.h"
+#include "src/dsp/read_wav_file_generic.h"
+#include "src/dsp/serialize.h"
+
+/* Cursor over the mapped bytes, used as the io_ptr of a WavReader. */
+typedef struct {
+  const uint8_t* position;
+  const uint8_t* end;
+} MemoryCursor;
+
+static size_t MemoryRead(void* bytes, size_t num_bytes, void* io_ptr) {
+  MemoryCursor* cursor = (MemoryCursor*)io_ptr;
+  const size_t available = (size_t)(cursor->end - cursor->position);
+  if (num_bytes > available) { num_bytes = available; }
+  memcpy(bytes, cursor->position, num_bytes);
+  cursor->position += num_bytes;
+  return num_bytes;
+}
+
+static int MemorySeek(size_t num_bytes, void* io_ptr) {
+  MemoryCursor* cursor = (MemoryCursor*)io_ptr;
+  if (num_bytes > (size_t)(cursor->end - cursor->position)) {
+    cursor->position = cursor->end;
+    return 1;
+  }
+  cursor->position += num_bytes;
+  return 0;
+}
+
+static int MemoryEof(void* io_ptr) {
+  MemoryCursor* cursor = (MemoryCursor*)io_ptr;
+  return cursor->position == cursor->end;
+}
+
+static int IsLittleEndianHost(void) {
+  const uint16_t value = 1;
+  return *((const uint8_t*)&value) == 1;
+}
+
+MappedWavFile* MappedWavFileOpen(const char* filename) {
+  const int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
+    perror("Error");
+    fprintf(stderr, "Error: Failed to open \"%s\".\n", filename);
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    fprintf(stderr, "Error: Failed to stat \"%s\" or it is empty.\n",
+            filename);
+    close(fd);
+    return NULL;
+  }
+
+  const size_t size = (size_t)st.st_size;
+  void* mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  /* The mapping remains valid after closing the descriptor. */
+  if (mapping == MAP_FAILED) {
+    perror("Error");
+    fprintf(stderr, "Error: Failed to mmap \"%s\".\n", filename);
+    return NULL;
+  }
+  /* Samples are typically read front to back, so ask for aggressive
+   * read-ahead. This is only advice, so failure is ignored.
+   */
+  posix_madvise(mapping, size, POSIX_MADV_SEQUENTIAL);
+
+  MappedWavFile* wav = (MappedWavFile*)malloc(sizeof(MappedWavFile));
+  if (wav == NULL) {
+    munmap(mapping, size);
+    return NULL;
+  }
+  wav->mapping = mapping;
+  wav->mapping_size = size;
+
+  MemoryCursor cursor;
+  cursor.position = (const uint8_t*)mapping;
+  cursor.end = cursor.position + size;
+  WavReader reader;
+  reader.io_ptr = &cursor;
+  reader.read_fun = MemoryRead;
+  reader.seek_fun = MemorySeek;
+  reader.eof_fun = MemoryEof;
+  reader.custom_chunk_fun = NULL;
+  ReadWavInfo info;
+  if (!ReadWavHeaderGeneric(&reader, &info)) {
+    fprintf(stderr, "Error: Invalid WAV file \"%s\".\n", filename);
+    MappedWavFileClose(wav);
+    return NULL;
+  }
+
+  /* The reader stops at the start of the data chunk. */
+  wav->data = cursor.position;
+  wav->num_channels = info.num_channels;
+  wav->sample_rate_hz = info.sample_rate_hz;
+  wav->encoding = info.encoding;
+  wav->bytes_per_sample = info.bit_depth / 8;
+
+  const size_t bytes_per_frame = (size_t)wav->bytes_per_sample *
+      wav->num_channels;
+  size_t num_frames = info.remaining_samples / wav->num_channels;
+  /* Tolerate a truncated data chunk, like ReadWavFile() does. */
+  const size_t available_frames =
+      (size_t)(cursor.end - cursor.position) / bytes_per_frame;
+  if (num_frames > available_frames) {
+    fprintf(stderr, "Warning: WAV file \"%s\" is truncated.\n", filename);
+    num_frames = available_frames;
+  }
+  wav->num_frames = num_frames;
+  return wav;
+}
+
+void MappedWavFileClose(MappedWavFile* wav) {
+  if (wav != NULL) {
+    munmap(wav->mapping, wav->mapping_size);
+    free(wav);
+  }
+}
+
+const int16_t* MappedWavFileInt16Samples(const MappedWavFile* wav) {
+  if (wav->encoding != kPcm16Encoding || ((size_t)wav->data) % 2 != 0 ||
+      !IsLittleEndianHost()) {
+    return NULL;
+  }
+  return (const int16_t*)wav->data;
+}
+
+const float* MappedWavFileFloatSamples(const MappedWavFile* wav) {
+  if (wav->encoding != kIeeeFloat32Encoding || ((size_t)wav->data) % 4 != 0 ||
+      !IsLittleEndianHost()) {
+    return NULL;
+  }
+  return (const float*)wav->data;
+}
+
+/* Number of samples to convert at a time through a stack buffer. */
+#define kChunkSamples 256
+
+/* Returns min(num_samples, kChunkSamples). */
+static int ChunkSize(size_t num_samples) {
+  return (num_samples < kChunkSamples) ? (int)num_samples : kChunkSamples;
+}
+
+/* Clamps a frame range to the file, returning the number of frames. */
+static size_t ClampFrames(const MappedWavFile* wav,
+                          size_t start_frame,
+                          size_t num_frames) {
+  if (start_frame >= wav->num_frames) { return 0; }
+  if (num_frames > wav->num_frames - start_frame) {
+    num_frames = wav->num_frames - start_frame;
+  }
+  return num_frames;
+}
+
+/* Converts a float sample to int32 in the same way as ReadWavFile(). */
+static int32_t FloatToInt32(float value) {
+  const float kLowest = INT32_MIN;
+  const float kMax = INT32_MAX;
+  float scaled = value * -kLowest;
+  scaled = scaled > kMax ? kMax : scaled;
+  scaled = scaled < kLowest ? kLowest : scaled;
+  if (scaled != scaled /* isnan(scaled) */) { scaled = 0; }
+  return (int32_t)scaled;
+}
+
+size_t MappedWavFileReadInt32(const MappedWavFile* wav,
+                              size_t start_frame,
+                              size_t num_frames,
+                              int32_t* samples) {
+  int16_t buffer_int16[kChunkSamples];
+  num_frames = ClampFrames(wav, start_frame, num_frames);
+  const size_t num_samples = num_frames * wav->num_channels;
+  const uint8_t* src = wav->data +
+      start_frame * wav->num_channels * wav->bytes_per_sample;
+  size_t i;
+
+  switch (wav->encoding) {
+    case kPcm16Encoding:
+      for (i = 0; i < num_samples; ++i, src += 2) {
+        samples[i] = (int32_t)(((uint32_t)src[0] << 16) |
+                               ((uint32_t)src[1] << 24));
+      }
+      break;
+    case kPcm24Encoding:
+      for (i = 0; i < num_samples; i += kChunkSamples) {
+        const int n = ChunkSize(num_samples - i);
+        ConvertSampleArrayPacked24ToInt32(src + 3 * i, n, samples + i);
+      }
+      break;
+    case kMuLawEncoding:
+      for (i = 0; i < num_samples; i += kChunkSamples) {
+        const int n = ChunkSize(num_samples - i);
+        int j;
+        ConvertSampleArrayMulawToInt16(src + i, n, buffer_int16);
+        for (j = 0; j < n; ++j) {
+          samples[i + j] = (int32_t)((uint32_t)(uint16_t)buffer_int16[j] << 16);
+        }
+      }
+      break;
+    case kIeeeFloat32Encoding:
+      for (i = 0; i < num_samples; ++i, src += 4) {
+        samples[i] = FloatToInt32(LittleEndianReadF32(src));
+      }
+      break;
+    case kIeeeFloat64Encoding:
+      for (i = 0; i < num_samples; ++i, src += 8) {
+        samples[i] = FloatToInt32((float)LittleEndianReadF64(src));
+      }
+      break;
+  }
+  return num_frames;
+}
+
+size_t MappedWavFileReadFloat(const MappedWavFile* wav,
+                              size_t start_frame,
+                              size_t num_frames,
+                              float* samples) {
+  int16_t buffer_int16[kChunkSamples];
+  int32_t buffer_int32[kChunkSamples];
+  num_frames = ClampFrames(wav, start_frame, num_frames);
+  const size_t num_samples = num_frames * wav->num_channels;
+  const size_t start_sample = start_frame * wav->num_channels;
+  const uint8_t* src = wav->data + start_sample * wav->bytes_per_sample;
+  const int16_t* samples_int16 = MappedWavFileInt16Samples(wav);
+  size_t i;
+
+  switch (wav->encoding) {
+    case kPcm16Encoding:
+      for (i = 0; i < num_samples; i += kChunkSamples) {
+        const int n = ChunkSize(num_samples - i);
+        if (samples_int16 != NULL) {  /* Convert directly from the mapping. */
+          ConvertSampleArrayInt16ToFloat(
+              samples_int16 + start_sample + i, n, samples + i);
+        } else {
+          int j;
+          for (j = 0; j < n; ++j) {
+            buffer_int16[j] = LittleEndianReadS16(src + 2 * (i + j));
+          }
+          ConvertSampleArrayInt16ToFloat(buffer_int16, n, samples + i);
+        }
+      }
+      break;
+    case kPcm24Encoding:
+      for (i = 0; i < num_samples; i += kChunkSamples) {
+        const int n = ChunkSize(num_samples - i);
+        ConvertSampleArrayPacked24ToInt32(src + 3 * i, n, buffer_int32);
+        ConvertSampleArrayInt32ToFloat(buffer_int32, n, samples + i);
+      }
+      break;
+    case kMuLawEncoding:
+      for (i = 0; i < num_samples; i += kChunkSamples) {
+        const int n = ChunkSize(num_samples - i);
+        ConvertSampleArrayMulawToInt16(src + i, n, buffer_int16);
+        ConvertSampleArrayInt16ToFloat(buffer_int16, n, samples + i);
+      }
+      break;
+    case kIeeeFloat32Encoding:
+      for (i = 0; i < num_samples; ++i, src += 4) {
+        samples[i] = LittleEndianReadF32(src);
+      }
+      break;
+    case kIeeeFloat64Encoding:
+      for (i = 0; i < num_samples; ++i, src += 8) {
+        samples[i] = (float)LittleEndianReadF64(src);
+      }
+      break;
+  }
+  return num_frames;
+}
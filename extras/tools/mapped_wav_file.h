@@ -0,0 +1,114 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Memory-mapped zero-copy WAV reader.
+ *
+ * ReadWavFile() allocates and converts the whole file up front, which for a
+ * multi-gigabyte corpus file costs as much memory as the file (or twice as
+ * much, for 16-bit data) before the first sample is processed.
+ * MappedWavFileOpen() instead maps the file read-only and parses the RIFF
+ * chunks in place with ReadWavHeaderGeneric(). Samples are paged in by the OS
+ * as they are accessed, and clean pages may be evicted under memory pressure.
+ *
+ * For 16-bit PCM and 32-bit float data, the samples may be used directly from
+ * the mapping. Samples are interleaved, so this is a strided view with stride
+ * num_channels of each channel:
+ *
+ *   MappedWavFile* wav = MappedWavFileOpen("speech.wav");
+ *   const int16_t* samples = MappedWavFileInt16Samples(wav);
+ *   if (samples != NULL) {
+ *     for (i = 0; i < wav->num_frames; ++i) {
+ *       int16_t sample = samples[i * wav->num_channels + channel];
+ *       ...
+ *     }
+ *   }
+ *   MappedWavFileClose(wav);
+ *
+ * For any encoding that ReadWavFile() supports, including 24-bit PCM and
+ * mu-law, MappedWavFileReadInt32() and MappedWavFileReadFloat() convert a range
+ * of frames on demand into a caller buffer, so that a large file can be
+ * processed block by block with a small fixed buffer.
+ */
+
+#ifndef AUDIO_TO_TACTILE_EXTRAS_TOOLS_MAPPED_WAV_FILE_H_
+#define AUDIO_TO_TACTILE_EXTRAS_TOOLS_MAPPED_WAV_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "src/dsp/read_wav_info.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  /* Number of channels, for example 2 for stereo. */
+  int num_channels;
+  /* Sample rate in Hz. */
+  int sample_rate_hz;
+  /* Encoding of the samples in the file, an EncodingType value from
+   * src/dsp/read_wav_info.h, e.g. kPcm16Encoding.
+   */
+  int encoding;
+  /* Number of frames. A frame is one sample for each channel. */
+  size_t num_frames;
+  /* Pointer to the start of the data chunk, within the mapping. */
+  const uint8_t* data;
+
+  /* Private fields. */
+  int bytes_per_sample;
+  void* mapping;
+  size_t mapping_size;
+} MappedWavFile;
+
+/* Maps a WAV file and parses its header. Returns NULL on failure. The caller
+ * should close it with MappedWavFileClose().
+ */
+MappedWavFile* MappedWavFileOpen(const char* filename);
+
+/* Unmaps a WAV file. Pointers into the file are invalid afterward. */
+void MappedWavFileClose(MappedWavFile* wav);
+
+/* Returns a pointer to the interleaved samples if the file is 16-bit PCM and
+ * they can be used in place (the data is 2-byte aligned and the host is little
+ * endian), otherwise NULL.
+ */
+const int16_t* MappedWavFileInt16Samples(const MappedWavFile* wav);
+
+/* Same as above for 32-bit float data, which must be 4-byte aligned. */
+const float* MappedWavFileFloatSamples(const MappedWavFile* wav);
+
+/* Reads up to `num_frames` frames starting at `start_frame` into `samples`,
+ * converting to int32 with the same convention as ReadWavFile(): samples are
+ * shifted into the most significant bits, and float samples are scaled by 2^31
+ * and clipped. Returns the number of frames read, less than `num_frames` if the
+ * end of the file was reached.
+ */
+size_t MappedWavFileReadInt32(const MappedWavFile* wav,
+                              size_t start_frame,
+                              size_t num_frames,
+                              int32_t* samples);
+
+/* Same as above, but converts to float with full scale in [-1, 1]. */
+size_t MappedWavFileReadFloat(const MappedWavFile* wav,
+                              size_t start_frame,
+                              size_t num_frames,
+                              float* samples);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+#endif /* AUDIO_TO_TACTILE_EXTRAS_TOOLS_MAPPED_WAV_FILE_H_ */
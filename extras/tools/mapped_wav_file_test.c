@@ -0,0 +1,260 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "extras/tools/mapped_wav_file.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/dsp/logging.h"
+#include "src/dsp/read_wav_file.h"
+#include "src/dsp/serialize.h"
+#include "src/dsp/write_wav_file.h"
+
+#define kSampleRateHz 16000
+#define kNumChannels 3
+#define kNumFrames 1000
+
+static int32_t RandInt32(void) {
+  return (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+}
+
+/* Writes a WAV file with a canonical 44-byte header and the given data. */
+static void WriteTestWav(const char* filename, int format_code,
+                         int bits_per_sample, int num_channels,
+                         const uint8_t* data, size_t num_bytes) {
+  const int block_align = num_channels * bits_per_sample / 8;
+  uint8_t header[44];
+  memcpy(header, "RIFF", 4);
+  LittleEndianWriteU32(36 + num_bytes, header + 4);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  LittleEndianWriteU32(16, header + 16);
+  LittleEndianWriteU16(format_code, header + 20);
+  LittleEndianWriteU16(num_channels, header + 22);
+  LittleEndianWriteU32(kSampleRateHz, header + 24);
+  LittleEndianWriteU32(kSampleRateHz * block_align, header + 28);
+  LittleEndianWriteU16(block_align, header + 32);
+  LittleEndianWriteU16(bits_per_sample, header + 34);
+  memcpy(header + 36, "data", 4);
+  LittleEndianWriteU32(num_bytes, header + 40);
+
+  FILE* f = CHECK_NOTNULL(fopen(filename, "wb"));
+  CHECK(fwrite(header, 1, sizeof(header), f) == sizeof(header));
+  CHECK(fwrite(data, 1, num_bytes, f) == num_bytes);
+  CHECK(fclose(f) == 0);
+}
+
+/* Checks that MappedWavFileReadInt32 matches ReadWavFile, reading in blocks of
+ * various sizes, and that MappedWavFileReadFloat matches within `tol`.
+ */
+static void CheckMatchesReadWavFile(const char* filename, float tol) {
+  size_t expected_num_samples;
+  int expected_num_channels;
+  int expected_sample_rate_hz;
+  int32_t* expected = CHECK_NOTNULL(ReadWavFile(
+      filename, &expected_num_samples, &expected_num_channels,
+      &expected_sample_rate_hz));
+
+  MappedWavFile* wav = CHECK_NOTNULL(MappedWavFileOpen(filename));
+  CHECK(wav->num_channels == expected_num_channels);
+  CHECK(wav->sample_rate_hz == expected_sample_rate_hz);
+  CHECK(wav->num_frames * wav->num_channels == expected_num_samples);
+
+  const int num_channels = wav->num_channels;
+  int32_t* samples_int32 = (int32_t*)CHECK_NOTNULL(
+      malloc(sizeof(int32_t) * expected_num_samples));
+  float* samples_float = (float*)CHECK_NOTNULL(
+      malloc(sizeof(float) * expected_num_samples));
+  const size_t kBlockSizes[3] = {1, 64, 333};
+  int k;
+  for (k = 0; k < 3; ++k) {
+    const size_t block_size = kBlockSizes[k];
+    size_t start;
+    for (start = 0; start < wav->num_frames; start += block_size) {
+      const size_t expected_frames = (start + block_size < wav->num_frames)
+          ? block_size : wav->num_frames - start;
+      CHECK(MappedWavFileReadInt32(wav, start, block_size,
+                                   samples_int32 + start * num_channels)
+            == expected_frames);
+      CHECK(MappedWavFileReadFloat(wav, start, block_size,
+                                   samples_float + start * num_channels)
+            == expected_frames);
+    }
+
+    CHECK(memcmp(samples_int32, expected,
+                 sizeof(int32_t) * expected_num_samples) == 0);
+    size_t i;
+    for (i = 0; i < expected_num_samples; ++i) {
+      CHECK(fabs(samples_float[i] - expected[i] / 2147483648.0) <= tol);
+    }
+  }
+
+  /* Reading at or past the end reads nothing. */
+  CHECK(MappedWavFileReadInt32(wav, wav->num_frames, 1, samples_int32) == 0);
+  CHECK(MappedWavFileReadFloat(wav, wav->num_frames + 5, 1, samples_float)
+        == 0);
+
+  free(samples_float);
+  free(samples_int32);
+  MappedWavFileClose(wav);
+  free(expected);
+}
+
+static void TestPcm16(void) {
+  puts("TestPcm16");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  const size_t num_samples = kNumFrames * kNumChannels;
+  int16_t* samples = (int16_t*)CHECK_NOTNULL(
+      malloc(sizeof(int16_t) * num_samples));
+  size_t i;
+  for (i = 0; i < num_samples; ++i) {
+    samples[i] = (int16_t)RandInt32();
+  }
+  samples[0] = INT16_MIN;
+  samples[1] = INT16_MAX;
+  CHECK(WriteWavFile(filename, samples, num_samples, kSampleRateHz,
+                     kNumChannels));
+
+  CheckMatchesReadWavFile(filename, 0.0f);
+
+  /* Samples are used in place. */
+  MappedWavFile* wav = CHECK_NOTNULL(MappedWavFileOpen(filename));
+  CHECK(wav->encoding == kPcm16Encoding);
+  const int16_t* mapped_samples = MappedWavFileInt16Samples(wav);
+  CHECK(mapped_samples != NULL);
+  CHECK((const uint8_t*)mapped_samples == wav->data);
+  CHECK(memcmp(mapped_samples, samples, sizeof(int16_t) * num_samples) == 0);
+  CHECK(MappedWavFileFloatSamples(wav) == NULL);
+  MappedWavFileClose(wav);
+
+  free(samples);
+  remove(filename);
+}
+
+static void TestPcm24(void) {
+  puts("TestPcm24");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  const size_t num_samples = kNumFrames * kNumChannels;
+  int32_t* samples = (int32_t*)CHECK_NOTNULL(
+      malloc(sizeof(int32_t) * num_samples));
+  size_t i;
+  for (i = 0; i < num_samples; ++i) {
+    samples[i] = (int32_t)((uint32_t)RandInt32() & 0xffffff00);
+  }
+  CHECK(WriteWavFile24Bit(filename, samples, num_samples, kSampleRateHz,
+                          kNumChannels));
+
+  CheckMatchesReadWavFile(filename, 0.0f);
+
+  MappedWavFile* wav = CHECK_NOTNULL(MappedWavFileOpen(filename));
+  CHECK(wav->encoding == kPcm24Encoding);
+  /* 24-bit data is not available in place. */
+  CHECK(MappedWavFileInt16Samples(wav) == NULL);
+  MappedWavFileClose(wav);
+
+  free(samples);
+  remove(filename);
+}
+
+static void TestMulaw(void) {
+  puts("TestMulaw");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  /* Write every mu-law code, so that decoding is checked for all of them. */
+  uint8_t data[256 * 2];
+  int i;
+  for (i = 0; i < 256; ++i) {
+    data[2 * i] = (uint8_t)i;
+    data[2 * i + 1] = (uint8_t)(255 - i);
+  }
+  WriteTestWav(filename, 7, 8, 2, data, sizeof(data));
+
+  CheckMatchesReadWavFile(filename, 0.0f);
+
+  remove(filename);
+}
+
+static void TestFloat32(void) {
+  puts("TestFloat32");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  const size_t num_samples = kNumFrames * kNumChannels;
+  uint8_t* data = (uint8_t*)CHECK_NOTNULL(malloc(4 * num_samples));
+  size_t i;
+  for (i = 0; i < num_samples; ++i) {
+    LittleEndianWriteF32(1.8f * rand() / RAND_MAX - 0.9f, data + 4 * i);
+  }
+  WriteTestWav(filename, 3, 32, kNumChannels, data, 4 * num_samples);
+
+  CheckMatchesReadWavFile(filename, 1.0f / 2147483648.0f);
+
+  MappedWavFile* wav = CHECK_NOTNULL(MappedWavFileOpen(filename));
+  CHECK(wav->encoding == kIeeeFloat32Encoding);
+  const float* mapped_samples = MappedWavFileFloatSamples(wav);
+  CHECK(mapped_samples != NULL);
+  for (i = 0; i < num_samples; ++i) {
+    CHECK(mapped_samples[i] == LittleEndianReadF32(data + 4 * i));
+  }
+  /* ReadFloat returns the stored values exactly. */
+  float* samples = (float*)CHECK_NOTNULL(malloc(sizeof(float) * num_samples));
+  CHECK(MappedWavFileReadFloat(wav, 0, kNumFrames, samples) == kNumFrames);
+  CHECK(memcmp(samples, mapped_samples, sizeof(float) * num_samples) == 0);
+  free(samples);
+  MappedWavFileClose(wav);
+
+  free(data);
+  remove(filename);
+}
+
+static void TestTruncatedAndInvalid(void) {
+  puts("TestTruncatedAndInvalid");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  uint8_t data[20];
+  memset(data, 0, sizeof(data));
+  /* Write a header claiming 40 bytes of data, but only write 20 bytes. */
+  WriteTestWav(filename, 1, 16, 2, data, sizeof(data));
+  FILE* f = CHECK_NOTNULL(fopen(filename, "r+b"));
+  uint8_t size_bytes[4];
+  LittleEndianWriteU32(40, size_bytes);
+  CHECK(fseek(f, 40, SEEK_SET) == 0);
+  CHECK(fwrite(size_bytes, 1, 4, f) == 4);
+  CHECK(fclose(f) == 0);
+
+  MappedWavFile* wav = CHECK_NOTNULL(MappedWavFileOpen(filename));
+  CHECK(wav->num_frames == 5);
+  MappedWavFileClose(wav);
+
+  /* A file that isn't WAV fails to open. */
+  f = CHECK_NOTNULL(fopen(filename, "wb"));
+  CHECK(fwrite("not a WAV file", 1, 14, f) == 14);
+  CHECK(fclose(f) == 0);
+  CHECK(MappedWavFileOpen(filename) == NULL);
+
+  remove(filename);
+  /* A nonexistent file fails to open. */
+  CHECK(MappedWavFileOpen(filename) == NULL);
+}
+
+int main(int argc, char** argv) {
+  srand(0);
+  TestPcm16();
+  TestPcm24();
+  TestMulaw();
+  TestFloat32();
+  TestTruncatedAndInvalid();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
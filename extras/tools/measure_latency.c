@@ -0,0 +1,532 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * End-to-end latency tracing from microphone sample to PWM output.
+ *
+ * This program simulates the sleeve firmware pipeline on the host and measures
+ * the latency from a sound onset at the microphone to the tactile response at
+ * the PWM output, broken down by stage. The pipeline is:
+ *
+ *   1. Mic block buffering. The SAADC collects `block_size` samples at
+ *      `sample_rate_hz` before the block is handed to processing.
+ *   2. Processing. TactileProcessor runs the CARL frontend and the Enveloper,
+ *      decimating by `decimation_factor`, then PostProcessor filters the
+ *      output. Wall time spent processing is set with --processing_ms.
+ *   3. PWM sync. Output is copied into the PWM buffer when the current PWM
+ *      sequence ends. The PWM period is the block period, and sequences end
+ *      --pwm_phase of a period after a block is complete.
+ *   4. PWM playback. The sequence plays the block's block_size /
+ *      decimation_factor output values (kNumPwmValues = 8 on the sleeve), each
+ *      held for decimation_factor input sample periods. With
+ *      --pwm_queue_sequences=1, output is queued a sequence ahead as with
+ *      ping-pong double buffering.
+ *
+ * Each block is tagged with the time of its first input sample, and the tag
+ * is advanced through the stages to give the time when the block is buffered,
+ * processed, and starts playing. Stages 1, 3, and 4 are buffering latencies.
+ * Stage 2 also has algorithmic latency from the filters, which is measured:
+ *
+ *  - PostProcessor group delay, computed from its impulse response as
+ *    tau(w) = Re{DFT[n h[n]](w) / DFT[h[n]](w)} at several frequencies.
+ *
+ *  - Onset latency, using tone bursts as onsets. For each Enveloper band, a
+ *    tone in that band is switched on after silence, and latency is the time
+ *    until the summed output of the band's tactors first reaches --threshold
+ *    of its peak. This is measured for TactileProcessor alone, after
+ *    PostProcessor, and at the PWM output. Onsets are swept over
+ *    --num_phases positions within a block, since latency depends on where
+ *    in the block the onset falls.
+ *
+ * Times in the output are in ms. As a check, the mean onset latency measured
+ * at the PWM output is compared with the sum of the mean algorithmic latency
+ * and the mean buffering latency. These differ slightly since the buffering
+ * latency depends on which frame within the block crosses the threshold.
+ *
+ * Example:
+ *   bazel run -c opt //extras/tools:measure_latency -- --processing_ms=1.5
+ *
+ * Flags:
+ *  --sample_rate_hz=<int>       Input sample rate (default 15625).
+ *  --block_size=<int>           Samples per block (default 64).
+ *  --decimation_factor=<int>    TactileProcessor decimation (default 8).
+ *  --processing_ms=<float>      Processing wall time per block (default 0).
+ *  --pwm_phase=<float>          Delay in PWM periods from block completion to
+ *                               the next PWM sequence end, in [0, 1)
+ *                               (default 0.5).
+ *  --pwm_queue_sequences=<int>  PWM sequences output is queued ahead before
+ *                               playing (default 0).
+ *  --threshold=<float>          Onset threshold as a fraction of the peak
+ *                               (default 0.5).
+ *  --num_phases=<int>           Onset positions to test per block (default 8).
+ *  --tone_amplitude=<float>     Onset tone amplitude (default 0.1).
+ *  --trace_csv=<path>           (Optional) Path to write per-block tags of the
+ *                               first onset trial.
+ *  --gain_db=<float>            Overall output gain in dB.
+ *  --cutoff_hz=<float>          PostProcessor lowpass cutoff in Hz
+ *                               (default 975).
+ *  --vowel_hop=<int>            Blocks between vowel embedding updates.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/dsp/decibels.h"
+#include "src/dsp/math_constants.h"
+#include "src/tactile/post_processor.h"
+#include "src/tactile/tactile_processor.h"
+#include "extras/tools/util.h"
+
+/* Same as kTactileProcessorNumTactors, as a constant for array sizes. */
+#define kNumTactors 10
+/* Silence before the onset, letting the processing settle. */
+#define kSettleSeconds 0.5
+/* Duration of the tone after the onset. */
+#define kToneSeconds 0.25
+/* Impulse response length for computing PostProcessor group delay. */
+#define kImpulseResponseSize 4096
+
+/* An onset test signal and the tactors that respond to it. */
+typedef struct {
+  const char* name;
+  float tone_hz;
+  int first_tactor;
+  int num_tactors;
+} OnsetBand;
+
+static const OnsetBand kOnsetBands[] = {
+  {"baseband", 150.0f, 0, 1},
+  {"vowel", 1000.0f, 1, 7},
+  {"sh fricative", 3000.0f, 8, 1},
+  {"fricative", 5000.0f, 9, 1},
+};
+#define kNumOnsetBands ((int)(sizeof(kOnsetBands) / sizeof(*kOnsetBands)))
+
+typedef struct {
+  int sample_rate_hz;
+  int block_size;
+  int decimation_factor;
+  double processing_samples;
+  double pwm_phase;
+  int pwm_queue_sequences;
+} PipelineConfig;
+
+/* Timestamps of a block as it moves through the pipeline, in units of input
+ * sample periods from the start of the input.
+ */
+typedef struct {
+  double first_sample;  /* Time of the block's first input sample. */
+  double mic_ready;     /* Block is completely buffered. */
+  double processed;     /* Processing is done and output is ready. */
+  double pwm_start;     /* PWM sequence playing the block's output starts. */
+} BlockTag;
+
+/* Running mean, min, and max. */
+typedef struct {
+  double sum;
+  double min;
+  double max;
+  int count;
+} Stats;
+
+static void StatsInit(Stats* stats) {
+  stats->sum = 0.0;
+  stats->min = HUGE_VAL;
+  stats->max = -HUGE_VAL;
+  stats->count = 0;
+}
+
+static void StatsAdd(Stats* stats, double value) {
+  stats->sum += value;
+  if (value < stats->min) { stats->min = value; }
+  if (value > stats->max) { stats->max = value; }
+  ++stats->count;
+}
+
+/* Advances a block tag through the pipeline stages. */
+static BlockTag TagBlock(const PipelineConfig* config, int block_index) {
+  const double block_size = config->block_size;
+  BlockTag tag;
+  tag.first_sample = block_index * block_size;
+  tag.mic_ready = tag.first_sample + block_size;
+  tag.processed = tag.mic_ready + config->processing_samples;
+  /* PWM sequences end at times (k + pwm_phase) * block_size. Output is copied
+   * at the first sequence end at or after processing is done.
+   */
+  const double k = ceil(tag.processed / block_size - config->pwm_phase - 1e-9);
+  tag.pwm_start = (k + config->pwm_phase + config->pwm_queue_sequences)
+      * block_size;
+  return tag;
+}
+
+/* Response of `band` in one output frame, the sum of its tactors. */
+static double BandResponse(const OnsetBand* band, const float* frame) {
+  double sum = 0.0;
+  int c;
+  for (c = 0; c < band->num_tactors; ++c) {
+    sum += fabs(frame[band->first_tactor + c]);
+  }
+  return sum;
+}
+
+/* Finds the first frame where the response reaches `threshold` of its peak
+ * from `start_frame` on. Returns -1 if there is no response.
+ */
+static int FindOnsetFrame(const OnsetBand* band, const float* frames,
+                          int num_frames, int start_frame, float threshold) {
+  double peak = 0.0;
+  int i;
+  for (i = start_frame; i < num_frames; ++i) {
+    const double response = BandResponse(band, frames + kNumTactors * i);
+    if (response > peak) { peak = response; }
+  }
+  if (peak <= 0.0) { return -1; }
+  for (i = start_frame; i < num_frames; ++i) {
+    if (BandResponse(band, frames + kNumTactors * i) >= threshold * peak) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* Computes PostProcessor group delay at `frequency_hz` in output samples. */
+static double PostProcessorGroupDelay(const float* impulse_response,
+                                      float output_rate_hz,
+                                      float frequency_hz) {
+  const double w = 2.0 * M_PI * frequency_hz / output_rate_hz;
+  double h_re = 0.0;
+  double h_im = 0.0;
+  double nh_re = 0.0;
+  double nh_im = 0.0;
+  int n;
+  for (n = 0; n < kImpulseResponseSize; ++n) {
+    const double c = cos(w * n);
+    const double s = -sin(w * n);
+    h_re += impulse_response[n] * c;
+    h_im += impulse_response[n] * s;
+    nh_re += n * impulse_response[n] * c;
+    nh_im += n * impulse_response[n] * s;
+  }
+  /* Re{(nh_re + i nh_im) / (h_re + i h_im)}. */
+  return (nh_re * h_re + nh_im * h_im) / (h_re * h_re + h_im * h_im);
+}
+
+static int WriteTraceCsv(const char* csv_file, const PipelineConfig* config,
+                         int num_blocks) {
+  FILE* f = fopen(csv_file, "w");
+  if (f == NULL) { return 0; }
+  const double ms_per_sample = 1000.0 / config->sample_rate_hz;
+  const double pwm_period_ms = config->block_size * ms_per_sample;
+  fprintf(f, "block,first_sample_ms,mic_ready_ms,processed_ms,pwm_start_ms,"
+          "pwm_end_ms\n");
+  int b;
+  for (b = 0; b < num_blocks; ++b) {
+    const BlockTag tag = TagBlock(config, b);
+    fprintf(f, "%d,%.4f,%.4f,%.4f,%.4f,%.4f\n", b,
+            tag.first_sample * ms_per_sample, tag.mic_ready * ms_per_sample,
+            tag.processed * ms_per_sample, tag.pwm_start * ms_per_sample,
+            tag.pwm_start * ms_per_sample + pwm_period_ms);
+  }
+  return fclose(f) == 0;
+}
+
+static void PrintStatsRow(const char* name, const Stats* stats,
+                          double ms_per_sample) {
+  printf("  %-30s %8.3f %8.3f %8.3f\n", name,
+         ms_per_sample * stats->sum / stats->count,
+         ms_per_sample * stats->min, ms_per_sample * stats->max);
+}
+
+int main(int argc, char** argv) {
+  TactileProcessorParams params;
+  TactileProcessorSetDefaultParams(&params);
+  PostProcessorParams post_processor_params;
+  PostProcessorSetDefaultParams(&post_processor_params);
+  /* Same cutoff as PostProcessorWrapper uses on the sleeve. */
+  post_processor_params.cutoff_hz = 975.0f;
+  PipelineConfig config;
+  config.sample_rate_hz = 15625;
+  config.block_size = 64;
+  config.decimation_factor = 8;
+  config.pwm_phase = 0.5;
+  config.pwm_queue_sequences = 0;
+  float processing_ms = 0.0f;
+  float threshold = 0.5f;
+  int num_phases = 8;
+  float tone_amplitude = 0.1f;
+  const char* trace_csv = NULL;
+
+  TactileProcessor* tactile_processor = NULL;
+  float* input = NULL;
+  float* tactile_output = NULL;
+  float* post_output = NULL;
+  float* impulse_response = NULL;
+  int status = EXIT_FAILURE;
+  int i;
+
+  for (i = 1; i < argc; ++i) {  /* Parse flags. */
+    if (StartsWith(argv[i], "--sample_rate_hz=")) {
+      config.sample_rate_hz = atoi(strchr(argv[i], '=') + 1);
+    } else if (StartsWith(argv[i], "--block_size=")) {
+      config.block_size = atoi(strchr(argv[i], '=') + 1);
+    } else if (StartsWith(argv[i], "--decimation_factor=")) {
+      config.decimation_factor = atoi(strchr(argv[i], '=') + 1);
+    } else if (StartsWith(argv[i], "--processing_ms=")) {
+      processing_ms = atof(strchr(argv[i], '=') + 1);
+    } else if (StartsWith(argv[i], "--pwm_phase=")) {
+      config.pwm_phase = atof(strchr(argv[i], '=') + 1);
+    } else if (StartsWith(argv[i], "--pwm_queue_sequences=")) {
+      config.pwm_queue_sequences = atoi(strchr(argv[i], '=') + 1);
+    } else if (StartsWith(argv[i], "--threshold=")) {
+      threshold = atof(strchr(argv[i], '=') + 1);
+    } else if (StartsWith(argv[i], "--num_phases=")) {
+      num_phases = atoi(strchr(argv[i], '=') + 1);
+    } else if (StartsWith(argv[i], "--tone_amplitude=")) {
+      tone_amplitude = atof(strchr(argv[i], '=') + 1);
+    } else if (StartsWith(argv[i], "--trace_csv=")) {
+      trace_csv = strchr(argv[i], '=') + 1;
+    } else if (StartsWith(argv[i], "--gain_db=")) {
+      post_processor_params.gain =
+          DecibelsToAmplitudeRatio(atof(strchr(argv[i], '=') + 1));
+    } else if (StartsWith(argv[i], "--cutoff_hz=")) {
+      post_processor_params.cutoff_hz = atof(strchr(argv[i], '=') + 1);
+    } else if (StartsWith(argv[i], "--vowel_hop=")) {
+      params.vowel_hop = atoi(strchr(argv[i], '=') + 1);
+    } else {
+      fprintf(stderr, "Error: Invalid flag \"%s\"\n", argv[i]);
+      goto fail;
+    }
+  }
+
+  const int block_size = config.block_size;
+  const int decimation_factor = config.decimation_factor;
+  if (config.sample_rate_hz <= 0 || block_size <= 0 ||
+      decimation_factor <= 0 || block_size % decimation_factor != 0) {
+    fprintf(stderr, "Error: block_size must be a positive multiple of "
+            "decimation_factor.\n");
+    goto fail;
+  } else if (!(0.0 <= config.pwm_phase && config.pwm_phase < 1.0) ||
+             config.pwm_queue_sequences < 0 || processing_ms < 0.0f) {
+    fprintf(stderr, "Error: Invalid PWM or processing timing.\n");
+    goto fail;
+  } else if (!(0.0f < threshold && threshold < 1.0f) || num_phases <= 0) {
+    fprintf(stderr, "Error: Invalid onset threshold or num_phases.\n");
+    goto fail;
+  }
+  config.processing_samples = 1e-3 * processing_ms * config.sample_rate_hz;
+
+  const double ms_per_sample = 1000.0 / config.sample_rate_hz;
+  const int num_pwm_values = block_size / decimation_factor;
+  const float output_rate_hz =
+      (float)config.sample_rate_hz / decimation_factor;
+  const int num_blocks = (int)ceil(
+      (kSettleSeconds + kToneSeconds) * config.sample_rate_hz / block_size) + 1;
+  const int num_samples = num_blocks * block_size;
+  const int num_frames = num_blocks * num_pwm_values;
+
+  params.frontend_params.input_sample_rate_hz = config.sample_rate_hz;
+  params.frontend_params.block_size = block_size;
+  params.decimation_factor = decimation_factor;
+  tactile_processor = TactileProcessorMake(&params);
+  if (tactile_processor == NULL) {
+    fprintf(stderr, "Error: Failed to create TactileProcessor.\n");
+    goto fail;
+  }
+  PostProcessor post_processor;
+  if (!PostProcessorInit(&post_processor, &post_processor_params,
+                         output_rate_hz, kNumTactors)) {
+    fprintf(stderr, "Error: Failed to initialize PostProcessor.\n");
+    goto fail;
+  }
+
+  input = (float*)malloc(sizeof(float) * num_samples);
+  tactile_output = (float*)malloc(sizeof(float) * kNumTactors * num_frames);
+  post_output = (float*)malloc(sizeof(float) * kNumTactors * num_frames);
+  impulse_response = (float*)malloc(
+      sizeof(float) * kNumTactors * kImpulseResponseSize);
+  if (input == NULL || tactile_output == NULL || post_output == NULL ||
+      impulse_response == NULL) {
+    fprintf(stderr, "Error: Memory allocation failed.\n");
+    goto fail;
+  }
+
+  printf("Pipeline: %d Hz, %d-sample blocks (%.3f ms), decimation %d, "
+         "%d PWM values per update\n\n", config.sample_rate_hz, block_size,
+         block_size * ms_per_sample, decimation_factor, num_pwm_values);
+
+  /* Buffering latencies from the block tags. Output frame j of a block is
+   * computable once input sample (j + 1) * decimation_factor - 1 has arrived,
+   * it waits for the rest of the block, for processing and PWM sync, and then
+   * for the j frames before it in the PWM sequence.
+   */
+  Stats mic_stats;
+  Stats processing_stats;
+  Stats sync_stats;
+  Stats playback_stats;
+  Stats buffering_stats;
+  StatsInit(&mic_stats);
+  StatsInit(&processing_stats);
+  StatsInit(&sync_stats);
+  StatsInit(&playback_stats);
+  StatsInit(&buffering_stats);
+  int b;
+  for (b = 0; b < num_blocks; ++b) {
+    const BlockTag tag = TagBlock(&config, b);
+    int j;
+    for (j = 0; j < num_pwm_values; ++j) {
+      const double computable = tag.first_sample + (j + 1) * decimation_factor;
+      const double plays = tag.pwm_start + j * decimation_factor;
+      StatsAdd(&mic_stats, tag.mic_ready - computable);
+      StatsAdd(&processing_stats, tag.processed - tag.mic_ready);
+      StatsAdd(&sync_stats, tag.pwm_start - tag.processed);
+      StatsAdd(&playback_stats, plays - tag.pwm_start);
+      StatsAdd(&buffering_stats, plays - computable);
+    }
+  }
+
+  printf("Buffering latency per output frame:  mean ms   min ms   max ms\n");
+  PrintStatsRow("mic block buffering", &mic_stats, ms_per_sample);
+  PrintStatsRow("processing", &processing_stats, ms_per_sample);
+  PrintStatsRow("PWM sequence sync", &sync_stats, ms_per_sample);
+  PrintStatsRow("PWM playback", &playback_stats, ms_per_sample);
+  PrintStatsRow("total buffering", &buffering_stats, ms_per_sample);
+
+  /* PostProcessor group delay from its impulse response. A small impulse is
+   * used to stay within the linear range below the clipping amplitude.
+   */
+  memset(impulse_response, 0,
+         sizeof(float) * kNumTactors * kImpulseResponseSize);
+  impulse_response[0] = 1e-3f;
+  PostProcessorProcessSamples(&post_processor, impulse_response,
+                              kImpulseResponseSize);
+  for (i = 0; i < kImpulseResponseSize; ++i) {
+    impulse_response[i] = impulse_response[kNumTactors * i];
+  }
+
+  printf("\nPostProcessor group delay:\n");
+  static const float kGroupDelayHz[] = {30.0f, 60.0f, 125.0f, 250.0f, 500.0f};
+  for (i = 0; i < (int)(sizeof(kGroupDelayHz) / sizeof(*kGroupDelayHz)); ++i) {
+    if (kGroupDelayHz[i] >= output_rate_hz / 2) { break; }
+    const double delay = PostProcessorGroupDelay(
+        impulse_response, output_rate_hz, kGroupDelayHz[i]);
+    printf("  %6.0f Hz %8.3f ms\n", kGroupDelayHz[i],
+           1000.0 * delay / output_rate_hz);
+  }
+
+  if (trace_csv && !WriteTraceCsv(trace_csv, &config, num_blocks)) {
+    fprintf(stderr, "Error: Failed to write \"%s\".\n", trace_csv);
+    goto fail;
+  }
+
+  printf("\nOnset latency over %d onset phases, threshold %.0f%% of peak:\n"
+         "  %-14s %8s %-19s %-19s %-19s %s\n", num_phases, 100.0 * threshold,
+         "band", "tone Hz", "TactileProcessor", "+ PostProcessor",
+         "PWM output", "stage sum");
+
+  const int settle_blocks = (int)(kSettleSeconds * config.sample_rate_hz
+                                  / block_size);
+  int band_index;
+  for (band_index = 0; band_index < kNumOnsetBands; ++band_index) {
+    const OnsetBand* band = &kOnsetBands[band_index];
+    Stats processor_stats;
+    Stats post_stats;
+    Stats pwm_stats;
+    StatsInit(&processor_stats);
+    StatsInit(&post_stats);
+    StatsInit(&pwm_stats);
+    int phase;
+    for (phase = 0; phase < num_phases; ++phase) {
+      /* Spread onsets over the block, including positions between output
+       * frames.
+       */
+      const int onset = settle_blocks * block_size
+          + (phase * (block_size + decimation_factor)) / num_phases;
+      const double radians_per_sample =
+          2.0 * M_PI * band->tone_hz / config.sample_rate_hz;
+      for (i = 0; i < num_samples; ++i) {
+        input[i] = (i < onset) ? 0.0f
+            : tone_amplitude * (float)sin(radians_per_sample * (i - onset));
+      }
+
+      TactileProcessorReset(tactile_processor);
+      PostProcessorReset(&post_processor);
+      for (b = 0; b < num_blocks; ++b) {
+        float* block_output = tactile_output + kNumTactors * num_pwm_values * b;
+        TactileProcessorProcessSamples(
+            tactile_processor, input + block_size * b, block_output);
+        float* block_post = post_output + kNumTactors * num_pwm_values * b;
+        memcpy(block_post, block_output,
+               sizeof(float) * kNumTactors * num_pwm_values);
+        PostProcessorProcessSamples(&post_processor, block_post,
+                                    num_pwm_values);
+      }
+
+      const int start_frame = settle_blocks * num_pwm_values;
+      const int processor_frame = FindOnsetFrame(
+          band, tactile_output, num_frames, start_frame, threshold);
+      const int post_frame = FindOnsetFrame(
+          band, post_output, num_frames, start_frame, threshold);
+      if (processor_frame < 0 || post_frame < 0) {
+        fprintf(stderr, "Error: No response to the %s onset.\n", band->name);
+        goto fail;
+      }
+
+      /* Algorithmic latency, from the onset to when the crossing frame is
+       * computable, assuming no buffering.
+       */
+      StatsAdd(&processor_stats,
+               (processor_frame + 1) * decimation_factor - onset);
+      const double post_latency = (post_frame + 1) * decimation_factor - onset;
+      StatsAdd(&post_stats, post_latency);
+
+      /* End-to-end latency, from the onset to when the PWM starts playing the
+       * crossing frame, using the tag of the block containing it.
+       */
+      const int frame_block = post_frame / num_pwm_values;
+      const int j = post_frame % num_pwm_values;
+      const BlockTag tag = TagBlock(&config, frame_block);
+      StatsAdd(&pwm_stats, tag.pwm_start + j * decimation_factor - onset);
+    }
+
+    const Stats* columns[3];
+    columns[0] = &processor_stats;
+    columns[1] = &post_stats;
+    columns[2] = &pwm_stats;
+    printf("  %-14s %8.0f", band->name, band->tone_hz);
+    int k;
+    for (k = 0; k < 3; ++k) {
+      char cell[32];
+      sprintf(cell, "%.2f [%.2f,%.2f]",
+              ms_per_sample * columns[k]->sum / columns[k]->count,
+              ms_per_sample * columns[k]->min,
+              ms_per_sample * columns[k]->max);
+      printf(" %-19s", cell);
+    }
+    /* Sum of the mean algorithmic and mean buffering latencies. */
+    printf(" %.2f\n", ms_per_sample * (post_stats.sum / post_stats.count
+        + buffering_stats.sum / buffering_stats.count));
+  }
+  printf("  (mean [min,max] in ms)\n");
+
+  status = EXIT_SUCCESS;
+fail:
+  free(impulse_response);
+  free(post_output);
+  free(tactile_output);
+  free(input);
+  TactileProcessorFree(tactile_processor);
+  return status;
+}
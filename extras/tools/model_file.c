@@ -0,0 +1,99 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "extras/tools/model_file.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ModelFile* ModelFileOpen(const char* filename) {
+  const int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
+    perror("Error");
+    fprintf(stderr, "Error: Failed to open \"%s\".\n", filename);
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    fprintf(stderr, "Error: Failed to stat \"%s\" or it is empty.\n",
+            filename);
+    close(fd);
+    return NULL;
+  }
+
+  const size_t size = (size_t)st.st_size;
+  void* mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  /* The mapping remains valid after closing the descriptor. */
+  if (mapping == MAP_FAILED) {
+    perror("Error");
+    fprintf(stderr, "Error: Failed to mmap \"%s\".\n", filename);
+    return NULL;
+  }
+
+  ModelFile* model_file = (ModelFile*)malloc(sizeof(ModelFile));
+  if (model_file == NULL) {
+    munmap(mapping, size);
+    return NULL;
+  }
+  model_file->mapping = mapping;
+  model_file->mapping_size = size;
+
+  if (!ModelDataParse(mapping, size, &model_file->data)) {
+    fprintf(stderr, "Error: Invalid model file \"%s\".\n", filename);
+    ModelFileClose(model_file);
+    return NULL;
+  }
+  return model_file;
+}
+
+void ModelFileClose(ModelFile* model_file) {
+  if (model_file != NULL) {
+    munmap(model_file->mapping, model_file->mapping_size);
+    free(model_file);
+  }
+}
+
+int ModelFileWrite(const char* filename,
+                   ModelDataType model_type,
+                   const ModelDataTensor* tensors,
+                   int num_tensors) {
+  const size_t size = ModelDataSerializedSize(tensors, num_tensors);
+  uint8_t* bytes = (uint8_t*)malloc(size);
+  if (bytes == NULL) { return 0; }
+
+  int success = 0;
+  if (ModelDataSerialize(model_type, tensors, num_tensors, bytes) == size) {
+    FILE* f = fopen(filename, "wb");
+    if (f == NULL) {
+      fprintf(stderr, "Error: Failed to open \"%s\" for writing.\n", filename);
+    } else {
+      success = (fwrite(bytes, 1, size, f) == size);
+      success &= (fclose(f) == 0);
+      if (!success) {
+        fprintf(stderr, "Error: Failed to write \"%s\".\n", filename);
+      }
+    }
+  }
+
+  free(bytes);
+  return success;
+}
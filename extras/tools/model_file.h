@@ -0,0 +1,72 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Memory-mapped model weight files for phonetics networks.
+ *
+ * ModelFileOpen() maps a file in the format described in
+ * src/phonetics/model_data.h read-only and validates it, including the
+ * checksum. Tensors are used in place from the mapping, so processes that
+ * open the same file share one page-cache copy of the weights. Example:
+ *
+ *   ModelFile* model_file = ModelFileOpen("classify_phoneme.a2tm");
+ *   ClassifyPhonemeModel model;
+ *   if (model_file == NULL ||
+ *       !ClassifyPhonemeModelFromData(&model_file->data, &model)) {
+ *     // Handle error.
+ *   }
+ *   ClassifyPhonemeWithModel(&model, frames, &labels, NULL);
+ *   ...
+ *   ModelFileClose(model_file);  // After last use of `model`.
+ */
+
+#ifndef AUDIO_TO_TACTILE_EXTRAS_TOOLS_MODEL_FILE_H_
+#define AUDIO_TO_TACTILE_EXTRAS_TOOLS_MODEL_FILE_H_
+
+#include <stddef.h>
+
+#include "src/phonetics/model_data.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  /* Parsed model data, pointing into the mapping. */
+  ModelData data;
+  /* Private fields. */
+  void* mapping;
+  size_t mapping_size;
+} ModelFile;
+
+/* Maps and validates a model file. Returns NULL on failure. The caller should
+ * close it with ModelFileClose().
+ */
+ModelFile* ModelFileOpen(const char* filename);
+
+/* Unmaps a model file. Tensors from the file are invalid afterward. */
+void ModelFileClose(ModelFile* model_file);
+
+/* Serializes tensors with ModelDataSerialize() and writes them to `filename`.
+ * Returns 1 on success, 0 on failure.
+ */
+int ModelFileWrite(const char* filename,
+                   ModelDataType model_type,
+                   const ModelDataTensor* tensors,
+                   int num_tensors);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+#endif /* AUDIO_TO_TACTILE_EXTRAS_TOOLS_MODEL_FILE_H_ */
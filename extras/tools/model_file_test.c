@@ -0,0 +1,212 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "extras/tools/model_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/dsp/logging.h"
+#include "src/dsp/serialize.h"
+#include "src/phonetics/classify_phoneme.h"
+#include "src/phonetics/embed_vowel.h"
+
+static float RandUniform(void) { return (float)rand() / RAND_MAX; }
+
+/* Checks that `p` points inside the mapping of `model_file`. */
+static int InMapping(const ModelFile* model_file, const float* p) {
+  const char* begin = (const char*)model_file->mapping;
+  return begin <= (const char*)p &&
+         (const char*)p < begin + model_file->mapping_size;
+}
+
+/* Writes the compiled-in ClassifyPhoneme model to a file, loads it, and checks
+ * that inference from the mapped tables matches the compiled-in weights.
+ */
+static void TestClassifyPhonemeRoundTrip(void) {
+  puts("TestClassifyPhonemeRoundTrip");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  ModelDataTensor tensors[kClassifyPhonemeModelNumTensors];
+  ClassifyPhonemeModelTensors(&kClassifyPhonemeDefaultModel, tensors);
+  CHECK(ModelFileWrite(filename, kModelDataClassifyPhoneme,
+                       tensors, kClassifyPhonemeModelNumTensors));
+
+  ModelFile* model_file = CHECK_NOTNULL(ModelFileOpen(filename));
+  CHECK(model_file->data.model_type == kModelDataClassifyPhoneme);
+  CHECK(model_file->data.num_tensors == kClassifyPhonemeModelNumTensors);
+  ClassifyPhonemeModel model;
+  CHECK(ClassifyPhonemeModelFromData(&model_file->data, &model));
+  CHECK(InMapping(model_file, model.dense1_weights));
+  CHECK(InMapping(model_file, model.voiced_output_bias));
+  /* Tensors are aligned for vectorized loads. */
+  CHECK(((size_t)model.dense1_weights & 15) == 0);
+  /* The wrong model type is rejected. */
+  EmbedVowelModel embed_vowel_model;
+  CHECK(!EmbedVowelModelFromData(&model_file->data, &embed_vowel_model));
+
+  const int num_channels = kClassifyPhonemeNumChannels;
+  const int num_frames = kClassifyPhonemeNumFrames;
+  float* frames = (float*)CHECK_NOTNULL(
+      malloc(sizeof(float) * num_channels * num_frames));
+  int trial;
+  for (trial = 0; trial < 5; ++trial) {
+    int i;
+    for (i = 0; i < num_channels * num_frames; ++i) {
+      frames[i] = RandUniform();
+    }
+
+    ClassifyPhonemeLabels expected_labels;
+    ClassifyPhonemeScores expected_scores;
+    ClassifyPhoneme(frames, &expected_labels, &expected_scores);
+    ClassifyPhonemeLabels labels;
+    ClassifyPhonemeScores scores;
+    ClassifyPhonemeWithModel(&model, frames, &labels, &scores);
+
+    CHECK(memcmp(&labels, &expected_labels, sizeof(labels)) == 0);
+    CHECK(memcmp(&scores, &expected_scores, sizeof(scores)) == 0);
+  }
+
+  free(frames);
+  ModelFileClose(model_file);
+  remove(filename);
+}
+
+/* Same as above for EmbedVowel. */
+static void TestEmbedVowelRoundTrip(void) {
+  puts("TestEmbedVowelRoundTrip");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  ModelDataTensor tensors[kEmbedVowelModelNumTensors];
+  EmbedVowelModelTensors(&kEmbedVowelDefaultModel, tensors);
+  CHECK(ModelFileWrite(filename, kModelDataEmbedVowel,
+                       tensors, kEmbedVowelModelNumTensors));
+
+  ModelFile* model_file = CHECK_NOTNULL(ModelFileOpen(filename));
+  EmbedVowelModel model;
+  CHECK(EmbedVowelModelFromData(&model_file->data, &model));
+  CHECK(InMapping(model_file, model.dense3_bias));
+
+  float frame[64];
+  int trial;
+  for (trial = 0; trial < 5; ++trial) {
+    int i;
+    for (i = 0; i < kEmbedVowelNumChannels; ++i) {
+      frame[i] = RandUniform();
+    }
+
+    float expected[2];
+    EmbedVowel(frame, expected);
+    float coord[2];
+    EmbedVowelWithModel(&model, frame, coord);
+    CHECK(coord[0] == expected[0]);
+    CHECK(coord[1] == expected[1]);
+  }
+
+  ModelFileClose(model_file);
+  remove(filename);
+}
+
+/* Reads a whole file into a malloc'd buffer. */
+static uint8_t* ReadFileBytes(const char* filename, size_t* size) {
+  FILE* f = CHECK_NOTNULL(fopen(filename, "rb"));
+  CHECK(fseek(f, 0, SEEK_END) == 0);
+  *size = (size_t)ftell(f);
+  rewind(f);
+  uint8_t* bytes = (uint8_t*)CHECK_NOTNULL(malloc(*size));
+  CHECK(fread(bytes, 1, *size, f) == *size);
+  fclose(f);
+  return bytes;
+}
+
+static void WriteFileBytes(const char* filename,
+                           const uint8_t* bytes, size_t size) {
+  FILE* f = CHECK_NOTNULL(fopen(filename, "wb"));
+  CHECK(fwrite(bytes, 1, size, f) == size);
+  CHECK(fclose(f) == 0);
+}
+
+/* Corrupted, truncated, or mismatched files are rejected. */
+static void TestInvalidFiles(void) {
+  puts("TestInvalidFiles");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  ModelDataTensor tensors[kEmbedVowelModelNumTensors];
+  EmbedVowelModelTensors(&kEmbedVowelDefaultModel, tensors);
+  CHECK(ModelFileWrite(filename, kModelDataEmbedVowel,
+                       tensors, kEmbedVowelModelNumTensors));
+  size_t size;
+  uint8_t* bytes = ReadFileBytes(filename, &size);
+
+  /* Flip one bit in the tensor data. */
+  bytes[size - 5] ^= 1;
+  WriteFileBytes(filename, bytes, size);
+  CHECK(ModelFileOpen(filename) == NULL);
+  bytes[size - 5] ^= 1;
+
+  /* Truncate the file. */
+  WriteFileBytes(filename, bytes, size - 4);
+  CHECK(ModelFileOpen(filename) == NULL);
+
+  /* Unsupported version. */
+  bytes[4] = 2;
+  WriteFileBytes(filename, bytes, size);
+  CHECK(ModelFileOpen(filename) == NULL);
+  bytes[4] = 1;
+
+  /* A tensor offset that is 4-byte but not 16-byte aligned, with the checksum
+   * updated to match.
+   */
+  uint8_t* entry = bytes + kModelDataHeaderSize;
+  const uint32_t offset = LittleEndianReadU32(entry + 24);
+  LittleEndianWriteU32(offset - 4, entry + 24);
+  LittleEndianWriteU32(
+      Fletcher32(bytes + kModelDataHeaderSize, size - kModelDataHeaderSize, 1),
+      bytes + 20);
+  WriteFileBytes(filename, bytes, size);
+  CHECK(ModelFileOpen(filename) == NULL);
+  LittleEndianWriteU32(offset, entry + 24);
+  LittleEndianWriteU32(
+      Fletcher32(bytes + kModelDataHeaderSize, size - kModelDataHeaderSize, 1),
+      bytes + 20);
+
+  /* Not a model file. */
+  bytes[0] = 'X';
+  WriteFileBytes(filename, bytes, size);
+  CHECK(ModelFileOpen(filename) == NULL);
+  bytes[0] = 'A';
+
+  /* The original bytes are valid. */
+  WriteFileBytes(filename, bytes, size);
+  ModelFile* model_file = CHECK_NOTNULL(ModelFileOpen(filename));
+  /* A tensor size mismatch is rejected. */
+  CHECK(ModelDataFindTensor(&model_file->data, "Dense1Bias", 17) == NULL);
+  CHECK(ModelDataFindTensor(&model_file->data, "Dense1Bias", 16) != NULL);
+  CHECK(ModelDataFindTensor(&model_file->data, "NoSuchTensor", 16) == NULL);
+  ModelFileClose(model_file);
+
+  CHECK(ModelFileOpen("nonexistent_model_file.a2tm") == NULL);
+
+  free(bytes);
+  remove(filename);
+}
+
+int main(int argc, char** argv) {
+  srand(0);
+  TestClassifyPhonemeRoundTrip();
+  TestEmbedVowelRoundTrip();
+  TestInvalidFiles();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
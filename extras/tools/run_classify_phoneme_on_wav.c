@@ -0,0 +1,372 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Runs CarlFrontend + ClassifyPhoneme on WAV files for offline labeling.
+ *
+ * This is a native counterpart of
+ * extras/python/phonetics/run_classify_phoneme_on_wav.py for transcribing
+ * datasets. Each input is mixed down to mono, resampled to 16 kHz, and run
+ * through the frontend. The classifier then runs over all windows of frames
+ * with ClassifyPhonemeBatch, optionally split over time across threads.
+ *
+ * For each input "<stem>.wav", a CSV file "<output_dir>/<stem>.csv" is written
+ * with one row per 8 ms frame. Columns are the time in seconds, the phoneme
+ * label, then scores for every phoneme, manner, and place category and the
+ * vad, vowel, diphthong, lax_vowel, and voiced scores.
+ *
+ * At the end, throughput is reported in audio-hours per CPU-minute.
+ *
+ * Flags:
+ *  --input=<path>       Input WAV file. May be repeated for several files.
+ *  --output_dir=<path>  Directory in which to write CSV score streams. If not
+ *                       specified, only throughput is reported.
+ *  --num_threads=<int>  Number of threads for classification (default 1).
+ *  --model=<path>       (Optional) Model file, as written by
+ *                       export_phonetics_models, to use instead of the
+ *                       compiled-in weights. The file is memory mapped.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "extras/tools/model_file.h"
+#include "extras/tools/util.h"
+#include "src/dsp/convert_sample.h"
+#include "src/dsp/q_resampler.h"
+#include "src/dsp/read_wav_file.h"
+#include "src/frontend/carl_frontend.h"
+#include "src/phonetics/classify_phoneme.h"
+
+#define kClassifierInputHz 16000
+#define kBlockSize 128
+#define kMaxInputs 4096
+#define kMaxThreads 64
+
+typedef struct {
+  const ClassifyPhonemeModel* model;
+  const float* frames;
+  int start;
+  int num_outputs;
+  ClassifyPhonemeScores* scores;
+  ClassifyPhonemeLabels* labels;
+} ClassifyJob;
+
+static void* ClassifyThread(void* arg) {
+  ClassifyJob* job = (ClassifyJob*)arg;
+  ClassifyPhonemeBatchWithModel(
+      job->model, job->frames + job->start * kClassifyPhonemeNumChannels,
+      job->num_outputs, job->labels + job->start, job->scores + job->start);
+  return NULL;
+}
+
+static double WallTimeSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* Reads WAV file as mono float samples at kClassifierInputHz. Returns NULL on
+ * failure. The caller should free the returned array.
+ */
+static float* ReadMonoSamples(const char* wav_file, int* num_samples) {
+  size_t num_read;
+  int num_channels;
+  int sample_rate_hz;
+  int32_t* samples_int32 = ReadWavFile(wav_file, &num_read, &num_channels,
+                                       &sample_rate_hz);
+  if (samples_int32 == NULL) { return NULL; }
+
+  const int num_frames = num_read / num_channels;
+  float* mono = (float*)malloc(
+      sizeof(float) * (num_frames > 0 ? num_frames : 1));
+  if (mono == NULL) {
+    free(samples_int32);
+    return NULL;
+  }
+  int i;
+  for (i = 0; i < num_frames; ++i) {  /* Mix down to mono. */
+    float sum = 0.0f;
+    int c;
+    for (c = 0; c < num_channels; ++c) {
+      sum += ConvertSampleInt32ToFloat(samples_int32[i * num_channels + c]);
+    }
+    mono[i] = sum / num_channels;
+  }
+  free(samples_int32);
+
+  if (sample_rate_hz == kClassifierInputHz) {
+    *num_samples = num_frames;
+    return mono;
+  }
+
+  /* Resample to kClassifierInputHz. */
+  const int kMaxInputFrames = 4096;
+  QResampler* resampler = QResamplerMake(
+      sample_rate_hz, kClassifierInputHz, 1, kMaxInputFrames, NULL);
+  if (resampler == NULL) {
+    free(mono);
+    return NULL;
+  }
+  const int capacity = QResamplerNextNumOutputFrames(resampler, num_frames) +
+                       QResamplerMaxOutputFrames(resampler);
+  float* resampled = (float*)malloc(sizeof(float) * capacity);
+  if (resampled == NULL) {
+    QResamplerFree(resampler);
+    free(mono);
+    return NULL;
+  }
+  int num_resampled = 0;
+  int start;
+  for (start = 0; start < num_frames; start += kMaxInputFrames) {
+    const int n = (num_frames - start < kMaxInputFrames)
+        ? num_frames - start : kMaxInputFrames;
+    const int num_out = QResamplerProcessSamples(resampler, mono + start, n);
+    if (num_resampled + num_out > capacity) { break; }
+    memcpy(resampled + num_resampled, QResamplerOutput(resampler),
+           sizeof(float) * num_out);
+    num_resampled += num_out;
+  }
+  QResamplerFree(resampler);
+  free(mono);
+  *num_samples = num_resampled;
+  return resampled;
+}
+
+/* Writes score streams as CSV. Returns 1 on success, 0 on failure. */
+static int WriteScoresCsv(const char* csv_file, int num_outputs,
+                          const ClassifyPhonemeLabels* labels,
+                          const ClassifyPhonemeScores* scores) {
+  FILE* f = fopen(csv_file, "w");
+  if (f == NULL) { return 0; }
+  int i;
+  fputs("time_s,label", f);
+  for (i = 0; i < kClassifyPhonemeNumPhonemes; ++i) {
+    fprintf(f, ",%s", kClassifyPhonemePhonemeNames[i]);
+  }
+  for (i = 0; i < kClassifyPhonemeNumManners; ++i) {
+    fprintf(f, ",%s", kClassifyPhonemeMannerNames[i]);
+  }
+  for (i = 0; i < kClassifyPhonemeNumPlaces; ++i) {
+    fprintf(f, ",%s", kClassifyPhonemePlaceNames[i]);
+  }
+  fputs(",vad,vowel,diphthong,lax_vowel,voiced\n", f);
+
+  const float frame_period_s = (float)kBlockSize / kClassifierInputHz;
+  int t;
+  for (t = 0; t < num_outputs; ++t) {
+    const ClassifyPhonemeScores* s = &scores[t];
+    /* Time at the end of the most recent frame in the window. */
+    fprintf(f, "%.3f,%s", (t + kClassifyPhonemeNumFrames) * frame_period_s,
+            kClassifyPhonemePhonemeNames[labels[t].phoneme]);
+    for (i = 0; i < kClassifyPhonemeNumPhonemes; ++i) {
+      fprintf(f, ",%.4f", s->phoneme[i]);
+    }
+    for (i = 0; i < kClassifyPhonemeNumManners; ++i) {
+      fprintf(f, ",%.4f", s->manner[i]);
+    }
+    for (i = 0; i < kClassifyPhonemeNumPlaces; ++i) {
+      fprintf(f, ",%.4f", s->place[i]);
+    }
+    fprintf(f, ",%.4f,%.4f,%.4f,%.4f,%.4f\n", s->vad, s->vowel, s->diphthong,
+            s->lax_vowel, s->voiced);
+  }
+  return fclose(f) == 0;
+}
+
+/* Makes "<output_dir>/<stem>.csv" from the input WAV path. */
+static void MakeCsvPath(const char* output_dir, const char* wav_file,
+                        char* csv_file, size_t csv_file_size) {
+  const char* base = strrchr(wav_file, '/');
+  base = (base != NULL) ? base + 1 : wav_file;
+  int stem_length = strlen(base);
+  if (EndsWith(base, ".wav") || EndsWith(base, ".WAV")) { stem_length -= 4; }
+  snprintf(csv_file, csv_file_size, "%s/%.*s.csv",
+           output_dir, stem_length, base);
+}
+
+int main(int argc, char** argv) {
+  const char* inputs[kMaxInputs];
+  int num_inputs = 0;
+  const char* output_dir = NULL;
+  int num_threads = 1;
+  const char* model_filename = NULL;
+  int i;
+
+  for (i = 1; i < argc; ++i) { /* Parse flags. */
+    if (StartsWith(argv[i], "--input=")) {
+      if (num_inputs >= kMaxInputs) {
+        fprintf(stderr, "Error: At most %d inputs supported.\n", kMaxInputs);
+        return EXIT_FAILURE;
+      }
+      inputs[num_inputs++] = strchr(argv[i], '=') + 1;
+    } else if (StartsWith(argv[i], "--output_dir=")) {
+      output_dir = strchr(argv[i], '=') + 1;
+    } else if (StartsWith(argv[i], "--num_threads=")) {
+      num_threads = atoi(strchr(argv[i], '=') + 1);
+    } else if (StartsWith(argv[i], "--model=")) {
+      model_filename = strchr(argv[i], '=') + 1;
+    } else {
+      fprintf(stderr, "Error: Invalid flag \"%s\"\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (num_inputs == 0) {
+    fprintf(stderr, "Error: Must specify --input\n");
+    return EXIT_FAILURE;
+  } else if (!(1 <= num_threads && num_threads <= kMaxThreads)) {
+    fprintf(stderr, "Error: num_threads must be between 1 and %d.\n",
+            kMaxThreads);
+    return EXIT_FAILURE;
+  }
+
+  ClassifyPhonemeModel model = kClassifyPhonemeDefaultModel;
+  ModelFile* model_file = NULL;
+  if (model_filename != NULL) {
+    model_file = ModelFileOpen(model_filename);
+    if (model_file == NULL ||
+        !ClassifyPhonemeModelFromData(&model_file->data, &model)) {
+      fprintf(stderr, "Error: Failed to load model \"%s\".\n",
+              model_filename);
+      ModelFileClose(model_file);
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* Make frontend to get CARL frames. The classifier expects input sample rate
+   * kClassifierInputHz, block_size=128, pcen_cross_channel_diffusivity=60, and
+   * otherwise the default frontend settings.
+   */
+  CarlFrontendParams frontend_params = kCarlFrontendDefaultParams;
+  frontend_params.input_sample_rate_hz = kClassifierInputHz;
+  frontend_params.block_size = kBlockSize;
+  frontend_params.pcen_cross_channel_diffusivity = 60.0f;
+  CarlFrontend* frontend = CarlFrontendMake(&frontend_params);
+  if (frontend == NULL) {
+    fprintf(stderr, "Error: CarlFrontendMake failed.\n");
+    ModelFileClose(model_file);
+    return EXIT_FAILURE;
+  }
+
+  int status = EXIT_SUCCESS;
+  double total_audio_s = 0.0;
+  const clock_t cpu_start = clock();
+  const double wall_start = WallTimeSeconds();
+
+  int n;
+  for (n = 0; n < num_inputs; ++n) {
+    int num_samples;
+    float* samples = ReadMonoSamples(inputs[n], &num_samples);
+    if (samples == NULL) {
+      fprintf(stderr, "Error reading \"%s\"\n", inputs[n]);
+      status = EXIT_FAILURE;
+      continue;
+    }
+    total_audio_s += (double)num_samples / kClassifierInputHz;
+
+    /* Run the frontend over the whole file. */
+    const int num_frames = num_samples / kBlockSize;
+    const int num_outputs = num_frames - (kClassifyPhonemeNumFrames - 1);
+    float* frames = (float*)malloc(
+        sizeof(float) * kClassifyPhonemeNumChannels *
+        (num_frames > 0 ? num_frames : 1));
+    ClassifyPhonemeLabels* labels = NULL;
+    ClassifyPhonemeScores* scores = NULL;
+    if (num_outputs > 0) {
+      labels = (ClassifyPhonemeLabels*)malloc(
+          sizeof(ClassifyPhonemeLabels) * num_outputs);
+      scores = (ClassifyPhonemeScores*)malloc(
+          sizeof(ClassifyPhonemeScores) * num_outputs);
+    }
+    if (frames == NULL || (num_outputs > 0 && (!labels || !scores))) {
+      fprintf(stderr, "Error: Out of memory.\n");
+      free(scores);
+      free(labels);
+      free(frames);
+      free(samples);
+      status = EXIT_FAILURE;
+      break;
+    }
+
+    CarlFrontendReset(frontend);
+    for (i = 0; i < num_frames; ++i) {
+      CarlFrontendProcessSamples(frontend, samples + i * kBlockSize,
+                                 frames + i * kClassifyPhonemeNumChannels);
+    }
+
+    if (num_outputs > 0) {
+      /* Split windows over time into contiguous ranges, one per thread. */
+      ClassifyJob jobs[kMaxThreads];
+      pthread_t threads[kMaxThreads];
+      int started[kMaxThreads];
+      const int threads_used =
+          (num_threads < num_outputs) ? num_threads : num_outputs;
+      int t;
+      for (t = 0; t < threads_used; ++t) {
+        jobs[t].model = &model;
+        jobs[t].frames = frames;
+        jobs[t].start = (int)((long)num_outputs * t / threads_used);
+        jobs[t].num_outputs =
+            (int)((long)num_outputs * (t + 1) / threads_used) - jobs[t].start;
+        jobs[t].labels = labels;
+        jobs[t].scores = scores;
+      }
+      for (t = 1; t < threads_used; ++t) {
+        started[t] = (pthread_create(
+            &threads[t], NULL, ClassifyThread, &jobs[t]) == 0);
+        if (!started[t]) {
+          ClassifyThread(&jobs[t]);  /* Fall back to the calling thread. */
+        }
+      }
+      ClassifyThread(&jobs[0]);
+      for (t = 1; t < threads_used; ++t) {
+        if (started[t]) { pthread_join(threads[t], NULL); }
+      }
+
+      if (output_dir != NULL) {
+        char csv_file[1024];
+        MakeCsvPath(output_dir, inputs[n], csv_file, sizeof(csv_file));
+        if (!WriteScoresCsv(csv_file, num_outputs, labels, scores)) {
+          fprintf(stderr, "Error writing \"%s\"\n", csv_file);
+          status = EXIT_FAILURE;
+        }
+      }
+    }
+
+    free(scores);
+    free(labels);
+    free(frames);
+    free(samples);
+  }
+
+  const double cpu_s = (double)(clock() - cpu_start) / CLOCKS_PER_SEC;
+  const double wall_s = WallTimeSeconds() - wall_start;
+  const double audio_hours = total_audio_s / 3600.0;
+  printf("Processed %d files, %.1f s of audio in %.2f s CPU, %.2f s wall.\n",
+         num_inputs, total_audio_s, cpu_s, wall_s);
+  if (cpu_s > 0.0) {
+    printf("Throughput: %.3f audio-hours per CPU-minute.\n",
+           audio_hours / (cpu_s / 60.0));
+  }
+
+  CarlFrontendFree(frontend);
+  ModelFileClose(model_file);
+  return status;
+}
@@ -66,7 +66,8 @@
  *  --gain_db=<float>          Overall output gain in dB.
  *  --mid_gain_db=<float>      Equalizer mid band gain in dB (default -10).
  *  --high_gain_db=<float>     Equalizer high band gain in dB (default -5.5).
- *  --block_size=<int>         TactileProcessor block_size. Must be power of 2.
+ *  --block_size=<int>         TactileProcessor block_size.
+ *  --vowel_hop=<int>          Blocks between vowel embedding updates.
  *  --chunk_size=<int>         Frames per PortAudio buffer. (Default 256).
  *  --cutoff_hz=<float>        Cutoff in Hz for energy smoothing filters.
  *  --fullscreen               Fullscreen display.
@@ -82,13 +83,13 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "src/dsp/fast_fun.h"
 #include "src/dsp/number_util.h"
 #include "src/dsp/read_wav_file.h"
 #include "src/tactile/post_processor.h"
 #include "src/tactile/tactile_processor.h"
 #include "extras/tools/channel_map_tui.h"
 #include "extras/tools/portaudio_device.h"
+#include "extras/tools/tactile_chunk_processor.h"
 #include "extras/tools/sdl/basic_sdl_app.h"
 #include "extras/tools/sdl/texture_from_rle_data.h"
 #include "extras/tools/sdl/window_icon.h"
@@ -121,7 +122,6 @@ typedef struct {
   int pa_initialized;              /* Whether PortAudio was initialized.     */
   PaError pa_error;                /* Last error returned from PortAudio.    */
   PaStream* pa_stream;             /* PortAudio output stream.               */
-  ChannelMap channel_map;
   float sample_rate_hz;
   int chunk_size;
 
@@ -131,12 +131,7 @@ typedef struct {
   int input_wav_size;
   int input_wav_pos;
 
-  float volume_decay_coeff;
-  volatile float volume[kNumTactors];
-
-  TactileProcessor* tactile_processor;
-  PostProcessor post_processor;
-  float* tactile_output;
+  TactileChunkProcessor* processor;
 } Engine;
 
 /* Loads the assets for a form factor. */
@@ -230,68 +225,6 @@ int ReadInputWav(Engine* engine, const char* input_wav) {
   return 1;
 }
 
-/* Processes one chunk of audio data. */
-void ProcessChunk(Engine* engine, float* input, float* output) {
-  const int block_size = CarlFrontendBlockSize(
-      engine->tactile_processor->frontend);
-  const int num_blocks = engine->chunk_size / block_size;
-  float energy_accum[kNumTactors] = {0.0f};
-  int b;
-
-  for (b = 0; b < num_blocks; ++b) {
-    float* tactile_output = engine->tactile_output;
-    /* Run audio-to-tactile processing. */
-    TactileProcessorProcessSamples(
-        engine->tactile_processor, input, tactile_output);
-
-    /* Accumulate signals for visualization. Do this before post processing. */
-    int i;
-    for (i = 0; i < block_size; ++i) {
-      int c;
-      for (c = 0; c < kNumTactors; ++c) {
-        energy_accum[c] += tactile_output[c] * tactile_output[c];
-      }
-      tactile_output += kNumTactors;
-    }
-
-    /* Apply equalization, clipping, and lowpass filtering. */
-    tactile_output = engine->tactile_output;
-    PostProcessorProcessSamples(
-        &engine->post_processor, tactile_output, block_size);
-
-    /* Map channels and apply channel gains. */
-    ChannelMapApply(&engine->channel_map, tactile_output, block_size, output);
-
-    input += block_size;
-    output += engine->channel_map.num_output_channels * block_size;
-  }
-
-  int c;
-  for (c = 0; c < kNumTactors; ++c) {
-    /* Convert tactile energy to perceived strength with Steven's power law.
-     * Perceived strength is roughly proportional to acceleration^0.55, which is
-     * proportional to sqrt(energy)^0.55.
-     *
-     * Different experiments have measured the exponent to be between 0.32 and
-     * 0.81. The exponent depends especially on the stimulus frequency. Over
-     * our range of interest 80-250 Hz, Ryu2010 measured 0.55.
-     *
-     * Reference: Ryu, "Psychophysical model for vibrotactile rendering in
-     * mobile devices," Presence 19.4 (2010): 364-387.
-     */
-    const float perceived = FastPow(1e-12f + energy_accum[c]
-        / (num_blocks * block_size), 0.55f * 0.5f);
-    /* Update engine->volume[c] according to
-     *   volume = max(rms, volume * volume_decay_coeff).
-     * This way the visualization follows the RMS with instantaneous attack but
-     * smoothed release, so that onsets are well represented.
-     */
-    float updated_volume = engine->volume[c] * engine->volume_decay_coeff;
-    if (perceived > updated_volume) { updated_volume = perceived; }
-    engine->volume[c] = updated_volume;
-  }
-}
-
 /* The audio thread calls this function for every chunk of audio. */
 int PortAudioCallback(const void *input_buffer, void *output_buffer,
     unsigned long chunk_size,
@@ -317,7 +250,7 @@ int PortAudioCallback(const void *input_buffer, void *output_buffer,
     engine->input_wav_pos += num_frames;
   }
 
-  ProcessChunk(engine, (float*)input, output);
+  TactileChunkProcessorProcessChunk(engine->processor, input, output);
   return paContinue;
 }
 
@@ -331,7 +264,8 @@ int StartPortAudio(Engine* engine, const char* input_device,
 
 
   /* Find PortAudio devices. */
-  const int output_channels = engine->channel_map.num_output_channels;
+  const int output_channels =
+      engine->processor->channel_map.num_output_channels;
   const int input_device_index =
       (input_wav) ? 0 : FindPortAudioDevice(input_device, 1, 0);
   const int output_device_index =
@@ -359,7 +293,7 @@ int StartPortAudio(Engine* engine, const char* input_device,
   printf("Output device: #%d %s\n",
          output_device_index, Pa_GetDeviceInfo(output_device_index)->name);
   printf("Output channels:\n");
-  ChannelMapPrint(&engine->channel_map);
+  ChannelMapPrint(&engine->processor->channel_map);
 
   /* Open and start PortAudio stream. */
   PaStreamParameters input_parameters;
@@ -408,8 +342,7 @@ int EngineInit(Engine* engine, int argc, char** argv) {
   engine->pa_error = paNoError;
   engine->pa_stream = NULL;
   engine->input_wav_samples = NULL;
-  engine->tactile_processor = NULL;
-  engine->tactile_output = NULL;
+  engine->processor = NULL;
   engine->selected_form_factor = 0;
   engine->keep_running = 1;
 
@@ -457,6 +390,8 @@ int EngineInit(Engine* engine, int argc, char** argv) {
           AmplitudeRatioToDecibels(atof(strchr(argv[i], '=') + 1));
     } else if (StartsWith(argv[i], "--block_size=")) {
       block_size = atoi(strchr(argv[i], '=') + 1);
+    } else if (StartsWith(argv[i], "--vowel_hop=")) {
+      params.vowel_hop = atoi(strchr(argv[i], '=') + 1);
     } else if (StartsWith(argv[i], "--chunk_size=")) {
       chunk_size = atoi(strchr(argv[i], '=') + 1);
     } else if (StartsWith(argv[i], "--cutoff_hz=")) {
@@ -476,8 +411,10 @@ int EngineInit(Engine* engine, int argc, char** argv) {
   if (!source_list) {
     fprintf(stderr, "Error: Must specify --channels.\n");
     return 0;
-  } else if (!ChannelMapParse(kNumTactors, source_list, gains_db_list,
-        &engine->channel_map)) {
+  }
+  ChannelMap channel_map;
+  if (!ChannelMapParse(kNumTactors, source_list, gains_db_list,
+                       &channel_map)) {
     return 0;
   }
 
@@ -501,39 +438,16 @@ int EngineInit(Engine* engine, int argc, char** argv) {
     engine->sample_rate_hz = sample_rate_hz;
   }
 
-  /* Create tactile processor.
+  /* Create tactile processing.
    * NOTE: This must be done before starting the audio thread.
    */
   params.frontend_params.input_sample_rate_hz = engine->sample_rate_hz;
   params.frontend_params.block_size = block_size;
   params.enveloper_params.energy_cutoff_hz = cutoff_hz;
 
-  engine->tactile_processor = TactileProcessorMake(&params);
-  if (engine->tactile_processor == NULL) {
-    fprintf(stderr, "Error: TactileProcessorInit failed.\n");
-    return 0;
-  }
-
-  /* Create PostProcessor. */
-  if (!PostProcessorInit(&engine->post_processor, &post_processor_params,
-                         TactileProcessorOutputSampleRateHz(&params),
-                         kTactileProcessorNumTactors)) {
-    return 0;
-  }
-
-  engine->tactile_output = malloc(sizeof(float) * kNumTactors * block_size);
-  if (engine->tactile_output == NULL) {
-    fprintf(stderr, "Error: Memory allocation failed.\n");
-    return 0;
-  }
-
-  int c;
-  for (c = 0; c < kNumTactors; ++c) {
-    engine->volume[c] = 0.0f;
-  }
-  const float kVolumeMeterTimeConstantSeconds = 0.05;
-  engine->volume_decay_coeff = (float)exp(
-      -chunk_size / (kVolumeMeterTimeConstantSeconds * sample_rate_hz));
+  engine->processor = TactileChunkProcessorMake(
+      &params, &post_processor_params, &channel_map, chunk_size);
+  if (engine->processor == NULL) { return 0; }
 
   /* Start PortAudio and audio thread. */
   if (!StartPortAudio(engine, input_device, input_wav, output_device)) {
@@ -557,8 +471,7 @@ void EngineTerminate(Engine* engine) {
     Pa_Terminate();
   }
 
-  free(engine->tactile_output);
-  TactileProcessorFree(engine->tactile_processor);
+  TactileChunkProcessorFree(engine->processor);
   free(engine->input_wav_samples);
 
   int i;
@@ -628,7 +541,7 @@ int main(int argc, char** argv) {
     int c;
     for (c = 0; c < kNumTactors; ++c) {
       /* Get volume for the cth tactor. */
-      float activation = engine.volume[c] / 0.4f;
+      float activation = engine.processor->volume[c] / 0.4f;
       if (activation < 0.0f) { activation = 0.0f; }
       if (activation > 1.0f) { activation = 1.0f; }
 
@@ -0,0 +1,652 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Headless batch runner of TactileProcessor over a corpus of WAV files.
+ *
+ * This is an offline counterpart of run_tactile_processor, for rendering
+ * tactile output for many files as fast as possible, e.g. to regression-check
+ * tuning changes across a corpus. Each input is mixed down to mono and run
+ * through TactileProcessor, PostProcessor, and the --channels ChannelMap, the
+ * same chain as in run_tactile_processor. Input is zero padded to a whole
+ * number of blocks.
+ *
+ * Files are processed in parallel, one file per thread at a time. To balance
+ * load when file durations vary, files are sorted by size and dealt largest
+ * first into a deque per thread. Each thread takes work from the front of its
+ * own deque, and when that is empty, steals from the back of another thread's.
+ *
+ * If --output_dir is set, output for each input "<stem>.wav" is written as a
+ * multichannel 32-bit float WAV file "<output_dir>/<stem>.wav". Note that
+ * inputs with the same stem in different directories overwrite each other.
+ *
+ * If --stats_csv is set, a CSV file is written with one row per input, in input
+ * order, with columns
+ *
+ *   file            Input filename.
+ *   ok              1 if the file was processed successfully, 0 otherwise.
+ *   sample_rate_hz  Input sample rate.
+ *   duration_s      Input duration in seconds.
+ *   cpu_s           CPU time spent processing the file.
+ *   realtime_factor duration_s / cpu_s.
+ *   clip_fraction   Fraction of output samples with magnitude >= 1.
+ *   rms_<c>         RMS of output channel c, for each channel (base 1).
+ *   peak_<c>        Max magnitude of output channel c, for each channel.
+ *
+ * At the end, the aggregate real-time factor (total audio duration over wall
+ * time) and CPU utilization are reported.
+ *
+ * Flags:
+ *  --input=<wavfile>          Input WAV file. May be repeated.
+ *  --input_list=<path>        Text file listing input WAV files, one per line.
+ *  --input_glob=<pattern>     Glob pattern of input WAV files, e.g.
+ *                             --input_glob='corpus/dev_*.wav'.
+ *  --output_dir=<path>        (Optional) Directory to write output WAV files.
+ *  --stats_csv=<path>         (Optional) Path to write per-file stats.
+ *  --num_threads=<int>        Number of threads (default: number of cores).
+ *  --channels=<list>          Channel mapping (default: 1,2,...,10).
+ *  --channel_gains_db=<list>  Gains in dB for each channel.
+ *  --gain_db=<float>          Overall output gain in dB.
+ *  --mid_gain_db=<float>      Equalizer mid band gain in dB (default -10).
+ *  --high_gain_db=<float>     Equalizer high band gain in dB (default -5.5).
+ *  --block_size=<int>         TactileProcessor block_size.
+ *  --vowel_hop=<int>          Blocks between vowel embedding updates.
+ *  --cutoff_hz=<float>        Cutoff in Hz for energy smoothing filters.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <glob.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "src/dsp/decibels.h"
+#include "src/tactile/post_processor.h"
+#include "src/tactile/tactile_processor.h"
+#include "extras/tools/async_wav_writer.h"
+#include "extras/tools/channel_map_tui.h"
+#include "extras/tools/mapped_wav_file.h"
+#include "extras/tools/util.h"
+
+#define kNumTactors kTactileProcessorNumTactors
+#define kMaxThreads 256
+#define kDefaultChannels "1,2,3,4,5,6,7,8,9,10"
+
+/* Settings shared by all threads. Read only while the threads run. */
+typedef struct {
+  TactileProcessorParams params;
+  PostProcessorParams post_processor_params;
+  ChannelMap channel_map;
+  const char* output_dir;
+} BatchConfig;
+
+/* One input file and its results. */
+typedef struct {
+  const char* filename;
+  long file_size;
+  int ok;
+  int sample_rate_hz;
+  double duration_s;
+  double cpu_s;
+  double clip_fraction;
+  double rms[kChannelMapMaxChannels];
+  float peak[kChannelMapMaxChannels];
+} Job;
+
+/* Deque of job indices. The owning thread pops from `begin`, other threads
+ * steal from `end`.
+ */
+typedef struct {
+  pthread_mutex_t lock;
+  int* items;
+  int begin;  /* Guarded by `lock`. */
+  int end;  /* Guarded by `lock`. */
+} WorkDeque;
+
+typedef struct {
+  const BatchConfig* config;
+  Job* jobs;
+  WorkDeque* deques;
+  int num_threads;
+  int thread_index;
+  int num_stolen;
+
+  /* Per-thread processing state, reused from file to file. */
+  TactileProcessor* processor;
+  int processor_sample_rate_hz;
+  PostProcessor post_processor;
+  float* input;
+  int input_capacity;
+  float* mono;
+  float* tactile;
+  float* output;
+} Worker;
+
+static double WallTimeSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static double ThreadCpuSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* Gets the next job index for `worker`, or -1 if all work is taken. */
+static int NextJob(Worker* worker) {
+  int i;
+  for (i = 0; i < worker->num_threads; ++i) {
+    const int is_own = (i == 0);
+    WorkDeque* deque =
+        &worker->deques[(worker->thread_index + i) % worker->num_threads];
+    int job = -1;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->begin < deque->end) {
+      job = is_own ? deque->items[deque->begin++] : deque->items[--deque->end];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    if (job >= 0) {
+      if (!is_own) { ++worker->num_stolen; }
+      return job;
+    }
+  }
+  return -1;  /* No new work is ever added, so we are done. */
+}
+
+/* Makes "<output_dir>/<stem>.wav" from the input WAV path. */
+static void MakeOutputPath(const char* output_dir, const char* wav_file,
+                           char* output_file, size_t output_file_size) {
+  const char* base = strrchr(wav_file, '/');
+  base = (base != NULL) ? base + 1 : wav_file;
+  int stem_length = strlen(base);
+  if (EndsWith(base, ".wav") || EndsWith(base, ".WAV")) { stem_length -= 4; }
+  snprintf(output_file, output_file_size, "%s/%.*s.wav",
+           output_dir, stem_length, base);
+}
+
+/* Prepares `worker` for a file with the given sample rate and channels.
+ * Returns 1 on success, 0 on failure.
+ */
+static int PrepareWorker(Worker* worker, int sample_rate_hz, int num_channels) {
+  const BatchConfig* config = worker->config;
+  TactileProcessorParams params = config->params;
+  params.frontend_params.input_sample_rate_hz = sample_rate_hz;
+  const int block_size = params.frontend_params.block_size;
+
+  if (worker->processor != NULL &&
+      worker->processor_sample_rate_hz == sample_rate_hz) {
+    TactileProcessorReset(worker->processor);
+  } else {
+    TactileProcessorFree(worker->processor);
+    worker->processor = TactileProcessorMake(&params);
+    worker->processor_sample_rate_hz = sample_rate_hz;
+    if (worker->processor == NULL) { return 0; }
+  }
+  /* Init also resets the filter states. */
+  if (!PostProcessorInit(&worker->post_processor,
+                         &config->post_processor_params,
+                         TactileProcessorOutputSampleRateHz(&params),
+                         kNumTactors)) {
+    return 0;
+  }
+
+  if (num_channels * block_size > worker->input_capacity) {
+    free(worker->input);
+    worker->input_capacity = num_channels * block_size;
+    worker->input = (float*)malloc(sizeof(float) * worker->input_capacity);
+    if (worker->input == NULL) {
+      worker->input_capacity = 0;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Processes one file, filling in the results in `job`. */
+static void ProcessFile(Worker* worker, Job* job) {
+  const BatchConfig* config = worker->config;
+  const ChannelMap* channel_map = &config->channel_map;
+  const int num_output_channels = channel_map->num_output_channels;
+  const double cpu_start = ThreadCpuSeconds();
+  job->ok = 0;
+
+  MappedWavFile* wav = MappedWavFileOpen(job->filename);
+  if (wav == NULL) {
+    fprintf(stderr, "Error reading \"%s\"\n", job->filename);
+    return;
+  }
+  job->sample_rate_hz = wav->sample_rate_hz;
+  job->duration_s = (double)wav->num_frames / wav->sample_rate_hz;
+
+  if (!PrepareWorker(worker, wav->sample_rate_hz, wav->num_channels)) {
+    fprintf(stderr, "Error: Failed to set up processing for \"%s\"\n",
+            job->filename);
+    MappedWavFileClose(wav);
+    return;
+  }
+  const int block_size = config->params.frontend_params.block_size;
+  const int output_block_size =
+      block_size / config->params.decimation_factor;
+
+  AsyncWavWriter* writer = NULL;
+  if (config->output_dir != NULL) {
+    char output_file[1024];
+    MakeOutputPath(config->output_dir, job->filename,
+                   output_file, sizeof(output_file));
+    const float output_sample_rate_hz =
+        (float)wav->sample_rate_hz / config->params.decimation_factor;
+    writer = AsyncWavWriterOpen(output_file,
+                                (int)(output_sample_rate_hz + 0.5f),
+                                num_output_channels, 4096, 4);
+    if (writer == NULL) {
+      MappedWavFileClose(wav);
+      return;
+    }
+  }
+
+  double sum_squares[kChannelMapMaxChannels];
+  long num_clipped = 0;
+  int c;
+  for (c = 0; c < num_output_channels; ++c) {
+    sum_squares[c] = 0.0;
+    job->peak[c] = 0.0f;
+  }
+
+  const int num_channels = wav->num_channels;
+  const float mix_scale = 1.0f / num_channels;
+  int ok = 1;
+  size_t num_output_frames = 0;
+  size_t start;
+  for (start = 0; start < wav->num_frames; start += block_size) {
+    const int num_read = (int)MappedWavFileReadFloat(
+        wav, start, block_size, worker->input);
+    /* Mix down to mono, zero padding the last block. */
+    const float* src = worker->input;
+    int i;
+    for (i = 0; i < num_read; ++i, src += num_channels) {
+      float sum = 0.0f;
+      for (c = 0; c < num_channels; ++c) {
+        sum += src[c];
+      }
+      worker->mono[i] = mix_scale * sum;
+    }
+    for (; i < block_size; ++i) {
+      worker->mono[i] = 0.0f;
+    }
+
+    TactileProcessorProcessSamples(
+        worker->processor, worker->mono, worker->tactile);
+    PostProcessorProcessSamples(
+        &worker->post_processor, worker->tactile, output_block_size);
+    ChannelMapApply(channel_map, worker->tactile, output_block_size,
+                    worker->output);
+
+    const float* out = worker->output;
+    for (i = 0; i < output_block_size; ++i, out += num_output_channels) {
+      for (c = 0; c < num_output_channels; ++c) {
+        const float magnitude = (out[c] < 0.0f) ? -out[c] : out[c];
+        sum_squares[c] += magnitude * magnitude;
+        if (magnitude > job->peak[c]) { job->peak[c] = magnitude; }
+        if (magnitude >= 1.0f) { ++num_clipped; }
+      }
+    }
+    num_output_frames += output_block_size;
+
+    if (writer != NULL &&
+        !AsyncWavWriterWrite(writer, worker->output, output_block_size)) {
+      ok = 0;
+      break;
+    }
+  }
+
+  if (writer != NULL && !AsyncWavWriterClose(writer)) { ok = 0; }
+  MappedWavFileClose(wav);
+
+  for (c = 0; c < num_output_channels; ++c) {
+    job->rms[c] = (num_output_frames > 0)
+        ? sqrt(sum_squares[c] / num_output_frames) : 0.0;
+  }
+  job->clip_fraction = (num_output_frames > 0)
+      ? (double)num_clipped / (num_output_frames * num_output_channels) : 0.0;
+  job->cpu_s = ThreadCpuSeconds() - cpu_start;
+  job->ok = ok;
+  if (!ok) {
+    fprintf(stderr, "Error writing output for \"%s\"\n", job->filename);
+  }
+}
+
+static void* WorkerThread(void* arg) {
+  Worker* worker = (Worker*)arg;
+  int job;
+  while ((job = NextJob(worker)) >= 0) {
+    ProcessFile(worker, &worker->jobs[job]);
+  }
+  return NULL;
+}
+
+static int InitWorker(Worker* worker, const BatchConfig* config) {
+  const int block_size = config->params.frontend_params.block_size;
+  worker->config = config;
+  worker->num_stolen = 0;
+  worker->processor = NULL;
+  worker->processor_sample_rate_hz = 0;
+  worker->input = NULL;
+  worker->input_capacity = 0;
+  worker->mono = (float*)malloc(sizeof(float) * block_size);
+  worker->tactile = (float*)malloc(sizeof(float) * kNumTactors * block_size);
+  worker->output = (float*)malloc(sizeof(float) *
+      config->channel_map.num_output_channels * block_size);
+  return worker->mono != NULL && worker->tactile != NULL &&
+         worker->output != NULL;
+}
+
+static void FreeWorker(Worker* worker) {
+  TactileProcessorFree(worker->processor);
+  free(worker->output);
+  free(worker->tactile);
+  free(worker->mono);
+  free(worker->input);
+}
+
+/* Appends a copy of `filename` to the `jobs` array. Returns 1 on success. */
+static int AddJob(const char* filename, Job** jobs, int* num_jobs,
+                  int* capacity) {
+  if (*num_jobs == *capacity) {
+    const int new_capacity = (*capacity > 0) ? 2 * *capacity : 64;
+    Job* new_jobs = (Job*)realloc(*jobs, sizeof(Job) * new_capacity);
+    if (new_jobs == NULL) { return 0; }
+    *jobs = new_jobs;
+    *capacity = new_capacity;
+  }
+  Job* job = &(*jobs)[*num_jobs];
+  memset(job, 0, sizeof(Job));
+  char* copy = (char*)malloc(strlen(filename) + 1);
+  if (copy == NULL) { return 0; }
+  strcpy(copy, filename);
+  job->filename = copy;
+  ++*num_jobs;
+  return 1;
+}
+
+/* Adds files listed one per line in `list_file`. Returns 1 on success. */
+static int AddJobsFromList(const char* list_file, Job** jobs, int* num_jobs,
+                           int* capacity) {
+  FILE* f = fopen(list_file, "r");
+  if (f == NULL) {
+    fprintf(stderr, "Error: Failed to open \"%s\"\n", list_file);
+    return 0;
+  }
+  char line[1024];
+  int success = 1;
+  while (success && fgets(line, sizeof(line), f)) {
+    size_t length = strlen(line);
+    while (length > 0 && (line[length - 1] == '\n' ||
+                          line[length - 1] == '\r')) {
+      line[--length] = '\0';
+    }
+    if (length > 0) {
+      success = AddJob(line, jobs, num_jobs, capacity);
+    }
+  }
+  fclose(f);
+  return success;
+}
+
+/* Adds files matching glob `pattern`. Returns 1 on success. */
+static int AddJobsFromGlob(const char* pattern, Job** jobs, int* num_jobs,
+                           int* capacity) {
+  glob_t matches;
+  const int result = glob(pattern, 0, NULL, &matches);
+  if (result == GLOB_NOMATCH) {
+    fprintf(stderr, "Error: No files match \"%s\"\n", pattern);
+    return 0;
+  } else if (result != 0) {
+    fprintf(stderr, "Error: glob failed for \"%s\"\n", pattern);
+    return 0;
+  }
+  int success = 1;
+  size_t i;
+  for (i = 0; success && i < matches.gl_pathc; ++i) {
+    success = AddJob(matches.gl_pathv[i], jobs, num_jobs, capacity);
+  }
+  globfree(&matches);
+  return success;
+}
+
+/* Job pointers sorted by decreasing file size. */
+static int CompareFileSizeDescending(const void* a, const void* b) {
+  const long size_a = (*(const Job* const*)a)->file_size;
+  const long size_b = (*(const Job* const*)b)->file_size;
+  return (size_a < size_b) - (size_a > size_b);
+}
+
+static int WriteStatsCsv(const char* csv_file, const Job* jobs, int num_jobs,
+                         int num_output_channels) {
+  FILE* f = fopen(csv_file, "w");
+  if (f == NULL) { return 0; }
+  int c;
+  fputs("file,ok,sample_rate_hz,duration_s,cpu_s,realtime_factor,"
+        "clip_fraction", f);
+  for (c = 1; c <= num_output_channels; ++c) { fprintf(f, ",rms_%d", c); }
+  for (c = 1; c <= num_output_channels; ++c) { fprintf(f, ",peak_%d", c); }
+  fputc('\n', f);
+
+  int n;
+  for (n = 0; n < num_jobs; ++n) {
+    const Job* job = &jobs[n];
+    fprintf(f, "%s,%d,%d,%.3f,%.4f,%.1f,%.6f", job->filename, job->ok,
+            job->sample_rate_hz, job->duration_s, job->cpu_s,
+            (job->cpu_s > 0.0) ? job->duration_s / job->cpu_s : 0.0,
+            job->clip_fraction);
+    for (c = 0; c < num_output_channels; ++c) {
+      fprintf(f, ",%.6f", job->rms[c]);
+    }
+    for (c = 0; c < num_output_channels; ++c) {
+      fprintf(f, ",%.6f", job->peak[c]);
+    }
+    fputc('\n', f);
+  }
+  return fclose(f) == 0;
+}
+
+int main(int argc, char** argv) {
+  BatchConfig config;
+  TactileProcessorSetDefaultParams(&config.params);
+  PostProcessorSetDefaultParams(&config.post_processor_params);
+  config.output_dir = NULL;
+  const char* stats_csv = NULL;
+  const char* source_list = kDefaultChannels;
+  const char* gains_db_list = NULL;
+  float cutoff_hz = 500.0f;
+  int num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  Job* jobs = NULL;
+  int num_jobs = 0;
+  int jobs_capacity = 0;
+  int status = EXIT_FAILURE;
+  int i;
+
+  for (i = 1; i < argc; ++i) { /* Parse flags. */
+    const char* value = strchr(argv[i], '=');
+    value = (value != NULL) ? value + 1 : "";
+    if (StartsWith(argv[i], "--input=")) {
+      if (!AddJob(value, &jobs, &num_jobs, &jobs_capacity)) { goto done; }
+    } else if (StartsWith(argv[i], "--input_list=")) {
+      if (!AddJobsFromList(value, &jobs, &num_jobs, &jobs_capacity)) {
+        goto done;
+      }
+    } else if (StartsWith(argv[i], "--input_glob=")) {
+      if (!AddJobsFromGlob(value, &jobs, &num_jobs, &jobs_capacity)) {
+        goto done;
+      }
+    } else if (StartsWith(argv[i], "--output_dir=")) {
+      config.output_dir = value;
+    } else if (StartsWith(argv[i], "--stats_csv=")) {
+      stats_csv = value;
+    } else if (StartsWith(argv[i], "--num_threads=")) {
+      num_threads = atoi(value);
+    } else if (StartsWith(argv[i], "--channels=")) {
+      source_list = value;
+    } else if (StartsWith(argv[i], "--channel_gains_db=")) {
+      gains_db_list = value;
+    } else if (StartsWith(argv[i], "--gain_db=")) {
+      config.post_processor_params.gain = DecibelsToAmplitudeRatio(atof(value));
+    } else if (StartsWith(argv[i], "--mid_gain_db=")) {
+      config.post_processor_params.mid_gain =
+          DecibelsToAmplitudeRatio(atof(value));
+    } else if (StartsWith(argv[i], "--high_gain_db=")) {
+      config.post_processor_params.high_gain =
+          DecibelsToAmplitudeRatio(atof(value));
+    } else if (StartsWith(argv[i], "--block_size=")) {
+      config.params.frontend_params.block_size = atoi(value);
+    } else if (StartsWith(argv[i], "--vowel_hop=")) {
+      config.params.vowel_hop = atoi(value);
+    } else if (StartsWith(argv[i], "--cutoff_hz=")) {
+      cutoff_hz = atof(value);
+    } else {
+      fprintf(stderr, "Error: Invalid flag \"%s\"\n", argv[i]);
+      goto done;
+    }
+  }
+  config.params.enveloper_params.energy_cutoff_hz = cutoff_hz;
+
+  if (num_jobs == 0) {
+    fprintf(stderr,
+            "Error: Must specify --input, --input_list, or --input_glob\n");
+    goto done;
+  } else if (config.params.frontend_params.block_size <= 0) {
+    fprintf(stderr, "Error: block_size must be positive.\n");
+    goto done;
+  } else if (!ChannelMapParse(kNumTactors, source_list, gains_db_list,
+                              &config.channel_map)) {
+    goto done;
+  }
+  if (num_threads > num_jobs) { num_threads = num_jobs; }
+  if (!(1 <= num_threads && num_threads <= kMaxThreads)) {
+    fprintf(stderr, "Error: num_threads must be between 1 and %d.\n",
+            kMaxThreads);
+    goto done;
+  }
+
+  /* Deal files, largest first, round robin into the per-thread deques. */
+  Job** by_size = (Job**)malloc(sizeof(Job*) * num_jobs);
+  int* deque_items = (int*)malloc(sizeof(int) * num_jobs);
+  WorkDeque deques[kMaxThreads];
+  Worker workers[kMaxThreads];
+  pthread_t threads[kMaxThreads];
+  int started[kMaxThreads];
+  if (by_size == NULL || deque_items == NULL) {
+    fprintf(stderr, "Error: Out of memory.\n");
+    free(deque_items);
+    free(by_size);
+    goto done;
+  }
+  for (i = 0; i < num_jobs; ++i) {
+    struct stat st;
+    jobs[i].file_size = (stat(jobs[i].filename, &st) == 0) ? st.st_size : 0;
+    by_size[i] = &jobs[i];
+  }
+  qsort(by_size, num_jobs, sizeof(Job*), CompareFileSizeDescending);
+  int t;
+  int offset = 0;
+  for (t = 0; t < num_threads; ++t) {
+    WorkDeque* deque = &deques[t];
+    pthread_mutex_init(&deque->lock, NULL);
+    deque->items = deque_items + offset;
+    deque->begin = 0;
+    deque->end = 0;
+    for (i = t; i < num_jobs; i += num_threads) {
+      deque->items[deque->end++] = (int)(by_size[i] - jobs);
+    }
+    offset += deque->end;
+  }
+  free(by_size);
+
+  const double wall_start = WallTimeSeconds();
+  int num_workers = 0;
+  for (t = 0; t < num_threads; ++t) {
+    Worker* worker = &workers[t];
+    if (!InitWorker(worker, &config)) {
+      fprintf(stderr, "Error: Out of memory.\n");
+      FreeWorker(worker);
+      break;
+    }
+    worker->jobs = jobs;
+    worker->deques = deques;
+    worker->num_threads = num_threads;
+    worker->thread_index = t;
+    ++num_workers;
+  }
+  /* Thread 0 is the calling thread. If a thread fails to start or a worker
+   * failed to initialize, its deque is drained by stealing.
+   */
+  for (t = 1; t < num_workers; ++t) {
+    started[t] = (pthread_create(
+        &threads[t], NULL, WorkerThread, &workers[t]) == 0);
+  }
+  if (num_workers > 0) { WorkerThread(&workers[0]); }
+  int num_stolen = 0;
+  for (t = 0; t < num_workers; ++t) {
+    if (t > 0 && started[t]) { pthread_join(threads[t], NULL); }
+    num_stolen += workers[t].num_stolen;
+    FreeWorker(&workers[t]);
+  }
+  const double wall_s = WallTimeSeconds() - wall_start;
+  for (t = 0; t < num_threads; ++t) {
+    pthread_mutex_destroy(&deques[t].lock);
+  }
+  free(deque_items);
+
+  double total_audio_s = 0.0;
+  double total_cpu_s = 0.0;
+  int num_ok = 0;
+  for (i = 0; i < num_jobs; ++i) {
+    if (jobs[i].ok) {
+      total_audio_s += jobs[i].duration_s;
+      ++num_ok;
+    }
+    total_cpu_s += jobs[i].cpu_s;
+  }
+  status = (num_workers > 0 && num_ok == num_jobs)
+      ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  if (stats_csv != NULL && !WriteStatsCsv(stats_csv, jobs, num_jobs,
+        config.channel_map.num_output_channels)) {
+    fprintf(stderr, "Error writing \"%s\"\n", stats_csv);
+    status = EXIT_FAILURE;
+  }
+
+  printf("Processed %d of %d files, %.1f s of audio in %.2f s wall "
+         "with %d threads (%d files stolen).\n",
+         num_ok, num_jobs, total_audio_s, wall_s, num_workers, num_stolen);
+  if (wall_s > 0.0 && num_workers > 0) {
+    printf("Aggregate real-time factor: %.1fx (CPU utilization %.0f%%).\n",
+           total_audio_s / wall_s,
+           100.0 * total_cpu_s / (wall_s * num_workers));
+  }
+
+done:
+  for (i = 0; i < num_jobs; ++i) {
+    free((char*)jobs[i].filename);
+  }
+  free(jobs);
+  return status;
+}
@@ -0,0 +1,200 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extras/tools/serial_link_emulator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace audio_tactile {
+
+LoopbackLink::LoopbackLink(const Params& params)
+    : params_(params),
+      now_(0.0),
+      a_(this, &a_to_b_, &b_to_a_),
+      b_(this, &b_to_a_, &a_to_b_),
+      stats_{0, 0} {
+  a_to_b_.send_end = 0.0;
+  b_to_a_.send_end = 0.0;
+}
+
+double LoopbackLink::IdleTime() const {
+  return std::max(a_to_b_.send_end, b_to_a_.send_end) + params_.latency_s;
+}
+
+int LoopbackLink::End::Write(const uint8_t* data, int size) {
+  const Params& params = link_->params_;
+  // Sending starts when the previous bytes are sent, or now if idle.
+  double t = std::max(tx_->send_end, link_->now_);
+  const double byte_time =
+      (params.bytes_per_second > 0.0) ? 1.0 / params.bytes_per_second : 0.0;
+  for (int i = 0; i < size; ++i) {
+    t += byte_time;
+    tx_->bytes.emplace_back(t + params.latency_s, data[i]);
+  }
+  tx_->send_end = t;
+  link_->stats_.bytes_written += size;
+  return size;
+}
+
+int LoopbackLink::End::Read(uint8_t* data, int size) {
+  int count = 0;
+  while (count < size && !rx_->bytes.empty() &&
+         rx_->bytes.front().first <= link_->now_) {
+    data[count++] = rx_->bytes.front().second;
+    rx_->bytes.pop_front();
+  }
+  link_->stats_.bytes_read += count;
+  return count;
+}
+
+PtyLink::PtyLink() {}
+
+PtyLink::~PtyLink() { Close(); }
+
+bool PtyLink::Open() {
+  Close();
+  master_.fd_ = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master_.fd_ < 0 || grantpt(master_.fd_) != 0 ||
+      unlockpt(master_.fd_) != 0) {
+    goto fail;
+  }
+  {
+    const char* name = ptsname(master_.fd_);
+    if (name == nullptr) { goto fail; }
+    slave_name_ = name;
+  }
+  slave_.fd_ = open(slave_name_.c_str(), O_RDWR | O_NOCTTY);
+  if (slave_.fd_ < 0) { goto fail; }
+
+  // Set raw mode so that bytes pass through unmodified.
+  for (int fd : {master_.fd_, slave_.fd_}) {
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) { goto fail; }
+    cfmakeraw(&tio);
+    if (tcsetattr(fd, TCSANOW, &tio) != 0 ||
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+      goto fail;
+    }
+  }
+  return true;
+
+fail:
+  Close();
+  return false;
+}
+
+void PtyLink::Close() {
+  for (FdTransport* end : {&master_, &slave_}) {
+    if (end->fd_ >= 0) {
+      close(end->fd_);
+      end->fd_ = -1;
+    }
+  }
+  slave_name_.clear();
+}
+
+int PtyLink::FdTransport::Write(const uint8_t* data, int size) {
+  int total = 0;
+  while (total < size) {
+    const ssize_t n = write(fd_, data + total, size - total);
+    if (n <= 0) {
+      if (n < 0 && errno == EINTR) { continue; }
+      break;  // Buffer full (EAGAIN) or error.
+    }
+    total += n;
+  }
+  return total;
+}
+
+int PtyLink::FdTransport::Read(uint8_t* data, int size) {
+  ssize_t n;
+  do {
+    n = read(fd_, data, size);
+  } while (n < 0 && errno == EINTR);
+  return (n > 0) ? static_cast<int>(n) : 0;
+}
+
+FaultyTransport::FaultyTransport(Transport* transport, const Params& params)
+    : transport_(transport),
+      params_(params),
+      rng_(params.seed),
+      gap_dist_(params.bit_error_rate > 0.0
+                    ? std::min(params.bit_error_rate, 1.0)
+                    : 0.5),
+      stats_{0, 0} {
+  bits_to_next_error_ = (params.bit_error_rate > 0.0)
+                            ? gap_dist_(rng_)
+                            : std::numeric_limits<int64_t>::max();
+}
+
+int FaultyTransport::Write(const uint8_t* data, int size) {
+  if (params_.drop_rate > 0.0 &&
+      std::uniform_real_distribution<double>(0.0, 1.0)(rng_) <
+          params_.drop_rate) {
+    ++stats_.writes_dropped;
+    return size;  // Bytes are lost, but the sender doesn't know.
+  }
+
+  const int64_t num_bits = 8 * static_cast<int64_t>(size);
+  if (bits_to_next_error_ >= num_bits) {
+    // Fast path: no errors in this write.
+    if (params_.bit_error_rate > 0.0) { bits_to_next_error_ -= num_bits; }
+    return transport_->Write(data, size);
+  }
+
+  std::string corrupted(reinterpret_cast<const char*>(data), size);
+  int64_t bit = bits_to_next_error_;
+  while (bit < num_bits) {
+    corrupted[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+    ++stats_.bits_flipped;
+    bit += 1 + gap_dist_(rng_);
+  }
+  bits_to_next_error_ = bit - num_bits;
+  return transport_->Write(
+      reinterpret_cast<const uint8_t*>(corrupted.data()), size);
+}
+
+bool LinkEndpoint::SendTxMessage() {
+  uint8_t frame[MessageFramer::kMaxFrameSize];
+  const int frame_size =
+      (framer_.mode() == MessageFramer::Mode::kSerial)
+          ? MessageFramer::WriteSerialFrame(MessageRecipient::kAll,
+                                            &tx_message_, frame)
+          : MessageFramer::WriteBleFrame(&tx_message_, frame);
+  return transport_->Write(frame, frame_size) == frame_size;
+}
+
+int LinkEndpoint::Poll(const Handler& handler) {
+  uint8_t buffer[256];
+  int num_handled = 0;
+  int size;
+  while ((size = transport_->Read(buffer, sizeof(buffer))) > 0) {
+    framer_.Push(buffer, size);
+    const Message* message;
+    while ((message = framer_.Next()) != nullptr) {
+      handler(*message);
+      ++num_handled;
+    }
+  }
+  return num_handled;
+}
+
+}  // namespace audio_tactile
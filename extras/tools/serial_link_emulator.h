@@ -0,0 +1,257 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Host emulation of the puck <-> sleeve serial link.
+//
+// The firmware link code (AudioTactileSerialCom, AudioTactileBleCom) is tied
+// to nRF hardware. This library emulates a link on the host, so that protocol
+// throughput, latency, and loss recovery can be evaluated without devices:
+//
+//  * `Transport` is a byte stream interface with nonblocking Read and Write.
+//
+//  * `LoopbackLink` is an in-process link between two Transports with a
+//    bandwidth cap and latency. It runs on a virtual clock advanced by the
+//    caller, so results are deterministic and independent of host speed.
+//
+//  * `PtyLink` is a link over a pseudo-terminal pair, exercising the OS serial
+//    driver path. The slave device name can also be opened by another process,
+//    e.g. a Python script using pyserial in place of a real device.
+//
+//  * `FaultyTransport` wraps a Transport, injecting bit errors and dropped
+//    writes into outgoing bytes.
+//
+//  * `LinkEndpoint` sends and receives Messages over a Transport, using the
+//    real Message encoding and MessageFramer, and dispatches each received
+//    Message to a handler, like the firmware's HandleMessage(). Framing is
+//    one of the MessageFramer modes:
+//
+//     - kSerial (default) models AudioTactileSerialCom: every message is sent
+//       as a fixed 132-byte frame with serial header and no checksum. So the
+//       bytes sent don't depend on the payload size, and bit errors in the
+//       payload are not detected.
+//
+//     - kBle sends only message.size() bytes per message, with the BLE header
+//       checksum, so corrupted messages are discarded. Use this to evaluate a
+//       variable-length link, which the serial firmware doesn't implement.
+//
+// Example:
+//
+//   LoopbackLink link({/*bytes_per_second=*/100000.0, /*latency_s=*/0.0005});
+//   FaultyTransport faulty(link.a(), {/*bit_error_rate=*/1e-5});
+//   LinkEndpoint puck(&faulty);
+//   LinkEndpoint sleeve(link.b());
+//
+//   puck.tx_message().WriteTemperature(30.0f);
+//   puck.SendTxMessage();
+//   link.AdvanceTime(0.01);
+//   sleeve.Poll([](const Message& message) { HandleMessage(message); });
+//
+
+#ifndef AUDIO_TO_TACTILE_EXTRAS_TOOLS_SERIAL_LINK_EMULATOR_H_
+#define AUDIO_TO_TACTILE_EXTRAS_TOOLS_SERIAL_LINK_EMULATOR_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <random>
+#include <string>
+
+#include "src/cpp/message.h"
+#include "src/cpp/message_framer.h"
+
+namespace audio_tactile {
+
+// Byte stream interface.
+class Transport {
+ public:
+  virtual ~Transport() = default;
+  // Writes `size` bytes. Returns the number of bytes written.
+  virtual int Write(const uint8_t* data, int size) = 0;
+  // Reads up to `size` bytes that are available without blocking. Returns the
+  // number of bytes read, or 0 if none are available.
+  virtual int Read(uint8_t* data, int size) = 0;
+};
+
+// In-process link with a bandwidth cap and latency on a virtual clock.
+class LoopbackLink {
+ public:
+  struct Params {
+    // Max throughput in each direction, or 0 for unlimited.
+    double bytes_per_second;
+    // Latency from when a byte is finished sending to when it is readable.
+    double latency_s;
+  };
+
+  // Link statistics, totals of both directions.
+  struct Stats {
+    int64_t bytes_written;
+    int64_t bytes_read;
+  };
+
+  explicit LoopbackLink(const Params& params);
+  LoopbackLink(const LoopbackLink&) = delete;
+  LoopbackLink& operator=(const LoopbackLink&) = delete;
+
+  // The two ends of the link. Bytes written to a() are read from b() and vice
+  // versa.
+  Transport* a() { return &a_; }
+  Transport* b() { return &b_; }
+
+  // Current virtual time in seconds.
+  double now() const { return now_; }
+  // Advances the virtual time.
+  void AdvanceTime(double seconds) { now_ += seconds; }
+  // Returns the time when the last byte written so far in either direction
+  // becomes readable.
+  double IdleTime() const;
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct Channel {
+    // Bytes in flight and the times when they become readable.
+    std::deque<std::pair<double, uint8_t>> bytes;
+    // Time when the sender finishes sending the bytes written so far.
+    double send_end;
+  };
+
+  class End : public Transport {
+   public:
+    End(LoopbackLink* link, Channel* tx, Channel* rx)
+        : link_(link), tx_(tx), rx_(rx) {}
+    int Write(const uint8_t* data, int size) override;
+    int Read(uint8_t* data, int size) override;
+
+   private:
+    LoopbackLink* link_;
+    Channel* tx_;
+    Channel* rx_;
+  };
+
+  Params params_;
+  double now_;
+  Channel a_to_b_;
+  Channel b_to_a_;
+  End a_;
+  End b_;
+  Stats stats_;
+};
+
+// Link over a pseudo-terminal pair in raw mode. Reads and writes are
+// nonblocking. This is POSIX only.
+class PtyLink {
+ public:
+  PtyLink();
+  ~PtyLink();
+  PtyLink(const PtyLink&) = delete;
+  PtyLink& operator=(const PtyLink&) = delete;
+
+  // Opens the pseudo-terminal pair. Returns false on failure.
+  bool Open();
+  // Closes the pseudo-terminal pair.
+  void Close();
+
+  // The master and slave ends of the link.
+  Transport* a() { return &master_; }
+  Transport* b() { return &slave_; }
+  // Device name of the slave end, e.g. "/dev/pts/3".
+  const std::string& slave_name() const { return slave_name_; }
+
+ private:
+  class FdTransport : public Transport {
+   public:
+    FdTransport() : fd_(-1) {}
+    int Write(const uint8_t* data, int size) override;
+    int Read(uint8_t* data, int size) override;
+    int fd_;
+  };
+
+  FdTransport master_;
+  FdTransport slave_;
+  std::string slave_name_;
+};
+
+// Transport wrapper that injects faults into written bytes.
+class FaultyTransport : public Transport {
+ public:
+  struct Params {
+    // Probability that each bit is flipped.
+    double bit_error_rate;
+    // Probability that each Write() call is dropped entirely, as when a
+    // packet is lost.
+    double drop_rate;
+    // Random seed.
+    uint32_t seed;
+  };
+
+  struct Stats {
+    int64_t bits_flipped;
+    int64_t writes_dropped;
+  };
+
+  FaultyTransport(Transport* transport, const Params& params);
+
+  int Write(const uint8_t* data, int size) override;
+  int Read(uint8_t* data, int size) override {
+    return transport_->Read(data, size);
+  }
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  Transport* transport_;
+  Params params_;
+  std::mt19937 rng_;
+  // Distribution of the number of error-free bits before the next bit error.
+  std::geometric_distribution<int64_t> gap_dist_;
+  // Number of error-free bits remaining before the next bit error.
+  int64_t bits_to_next_error_;
+  Stats stats_;
+};
+
+// Sends and receives Messages over a Transport.
+class LinkEndpoint {
+ public:
+  using Handler = std::function<void(const Message&)>;
+
+  explicit LinkEndpoint(
+      Transport* transport,
+      MessageFramer::Mode mode = MessageFramer::Mode::kSerial)
+      : transport_(transport), framer_(mode) {}
+
+  // Gets Message that will be transmitted.
+  Message& tx_message() { return tx_message_; }
+  // Sends tx_message. Returns false if the transport didn't accept all bytes.
+  bool SendTxMessage();
+
+  // Reads available bytes and calls `handler` for each valid Message
+  // received. Returns the number of Messages handled.
+  int Poll(const Handler& handler);
+
+  // Framing mode used to send and receive.
+  MessageFramer::Mode mode() const { return framer_.mode(); }
+  // Framing statistics of received bytes.
+  const MessageFramer::Stats& rx_stats() const { return framer_.stats(); }
+
+ private:
+  Transport* transport_;
+  Message tx_message_;
+  MessageFramer framer_;
+};
+
+}  // namespace audio_tactile
+
+#endif  // AUDIO_TO_TACTILE_EXTRAS_TOOLS_SERIAL_LINK_EMULATOR_H_
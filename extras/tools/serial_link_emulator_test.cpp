@@ -0,0 +1,253 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extras/tools/serial_link_emulator.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "src/dsp/logging.h"
+
+// NOLINTBEGIN(readability/check)
+
+namespace audio_tactile {
+
+// Receiver state updated by HandleMessage, like the sleeve firmware.
+struct Receiver {
+  int num_audio = 0;
+  int num_temperature = 0;
+  int num_tuning = 0;
+  int num_other = 0;
+  int16_t audio[kAdcDataSize];
+  float temperature = 0.0f;
+  TuningKnobs tuning;
+
+  void HandleMessage(const Message& message) {
+    switch (message.type()) {
+      case MessageType::kAudioSamples:
+        CHECK(message.ReadAudioSamples(
+            Slice<int16_t, kAdcDataSize>(audio)));
+        ++num_audio;
+        break;
+      case MessageType::kTemperature:
+        CHECK(message.ReadTemperature(&temperature));
+        ++num_temperature;
+        break;
+      case MessageType::kTuning:
+        CHECK(message.ReadTuning(&tuning));
+        ++num_tuning;
+        break;
+      default:
+        ++num_other;
+        break;
+    }
+  }
+};
+
+// Bytes become readable according to bandwidth and latency.
+void TestLoopbackTiming() {
+  puts("TestLoopbackTiming");
+  LoopbackLink link({/*bytes_per_second=*/10000.0, /*latency_s=*/0.001});
+  uint8_t data[100];
+  for (int i = 0; i < 100; ++i) { data[i] = static_cast<uint8_t>(i); }
+  CHECK(link.a()->Write(data, 100) == 100);
+  CHECK(fabs(link.IdleTime() - 0.011) < 1e-9);
+
+  uint8_t received[100];
+  CHECK(link.b()->Read(received, 100) == 0);
+  link.AdvanceTime(0.005);  // 4 ms of sending = 40 bytes.
+  CHECK(link.b()->Read(received, 100) == 40);
+  link.AdvanceTime(0.006);
+  CHECK(link.b()->Read(received + 40, 100) == 60);
+  for (int i = 0; i < 100; ++i) { CHECK(received[i] == i); }
+  // Nothing was sent the other way.
+  CHECK(link.a()->Read(received, 100) == 0);
+  CHECK(link.stats().bytes_written == 100);
+  CHECK(link.stats().bytes_read == 100);
+}
+
+// Messages are sent, received, and dispatched in both directions.
+void TestEndpointsOverLoopback(MessageFramer::Mode mode) {
+  printf("TestEndpointsOverLoopback(%s)\n",
+         (mode == MessageFramer::Mode::kSerial) ? "kSerial" : "kBle");
+  LoopbackLink link({/*bytes_per_second=*/100000.0, /*latency_s=*/0.0005});
+  LinkEndpoint puck(link.a(), mode);
+  LinkEndpoint sleeve(link.b(), mode);
+  Receiver sleeve_receiver;
+  Receiver puck_receiver;
+
+  int16_t audio[kAdcDataSize];
+  for (int i = 0; i < kAdcDataSize; ++i) { audio[i] = 100 * i - 3000; }
+  for (int i = 0; i < 10; ++i) {
+    puck.tx_message().WriteAudioSamples(
+        Slice<const int16_t, kAdcDataSize>(audio));
+    CHECK(puck.SendTxMessage());
+  }
+  TuningKnobs knobs = kDefaultTuningKnobs;
+  knobs.values[3] = 77;
+  puck.tx_message().WriteTuning(knobs);
+  CHECK(puck.SendTxMessage());
+  sleeve.tx_message().WriteTemperature(31.5f);
+  CHECK(sleeve.SendTxMessage());
+
+  link.AdvanceTime(link.IdleTime());
+  CHECK(sleeve.Poll([&](const Message& message) {
+          sleeve_receiver.HandleMessage(message);
+        }) == 11);
+  CHECK(puck.Poll([&](const Message& message) {
+          puck_receiver.HandleMessage(message);
+        }) == 1);
+
+  CHECK(sleeve_receiver.num_audio == 10);
+  CHECK(std::equal(audio, audio + kAdcDataSize, sleeve_receiver.audio));
+  CHECK(sleeve_receiver.num_tuning == 1);
+  CHECK(sleeve_receiver.tuning.values[3] == 77);
+  CHECK(puck_receiver.num_temperature == 1);
+  CHECK(puck_receiver.temperature == 31.5f);
+
+  if (mode == MessageFramer::Mode::kSerial) {
+    // Like the firmware, every message is sent as a full 132-byte frame.
+    CHECK(link.stats().bytes_written == 12 * Message::kMaxMessageSize);
+  } else {
+    CHECK(link.stats().bytes_written ==
+          10 * (4 + 2 * kAdcDataSize) + (4 + kNumTuningKnobs) + (4 + 4));
+  }
+}
+
+// In kBle mode, with bit errors and drops, corrupted messages are discarded
+// and the rest are received intact.
+void TestFaultInjection() {
+  puts("TestFaultInjection");
+  LoopbackLink link({/*bytes_per_second=*/0.0, /*latency_s=*/0.0});
+  FaultyTransport faulty(link.a(), {/*bit_error_rate=*/2e-4,
+                                    /*drop_rate=*/0.1, /*seed=*/1});
+  LinkEndpoint puck(&faulty, MessageFramer::Mode::kBle);
+  LinkEndpoint sleeve(link.b(), MessageFramer::Mode::kBle);
+
+  constexpr int kNumMessages = 2000;
+  std::vector<int> received;
+  for (int i = 0; i < kNumMessages; ++i) {
+    puck.tx_message().WriteTemperature(static_cast<float>(i));
+    puck.SendTxMessage();
+    sleeve.Poll([&](const Message& message) {
+      float value;
+      CHECK(message.type() == MessageType::kTemperature);
+      CHECK(message.ReadTemperature(&value));
+      received.push_back(static_cast<int>(value));
+    });
+  }
+
+  // Received messages are in order, with no duplicates.
+  for (int i = 1; i < static_cast<int>(received.size()); ++i) {
+    CHECK(received[i - 1] < received[i]);
+  }
+  const int num_lost = kNumMessages - static_cast<int>(received.size());
+  printf("  dropped writes: %d, bits flipped: %d, lost messages: %d\n",
+         static_cast<int>(faulty.stats().writes_dropped),
+         static_cast<int>(faulty.stats().bits_flipped), num_lost);
+  CHECK(faulty.stats().writes_dropped > 0);
+  CHECK(faulty.stats().bits_flipped > 0);
+  CHECK(sleeve.rx_stats().bad_frames > 0);
+  CHECK(num_lost >= faulty.stats().writes_dropped);
+  // Each bit error loses at most a couple of messages.
+  CHECK(num_lost <= faulty.stats().writes_dropped +
+                        2 * faulty.stats().bits_flipped);
+}
+
+// In kSerial mode, there is no checksum, so bit errors in the payload are
+// passed through, while messages are still framed.
+void TestSerialFaultInjection() {
+  puts("TestSerialFaultInjection");
+  LoopbackLink link({/*bytes_per_second=*/0.0, /*latency_s=*/0.0});
+  FaultyTransport faulty(link.a(), {/*bit_error_rate=*/1e-4,
+                                    /*drop_rate=*/0.0, /*seed=*/1});
+  LinkEndpoint puck(&faulty);
+  LinkEndpoint sleeve(link.b());
+
+  int16_t audio[kAdcDataSize];
+  for (int i = 0; i < kAdcDataSize; ++i) { audio[i] = 100 * i - 3000; }
+  constexpr int kNumMessages = 500;
+  Receiver receiver;
+  int num_corrupted = 0;
+  for (int i = 0; i < kNumMessages; ++i) {
+    puck.tx_message().WriteAudioSamples(
+        Slice<const int16_t, kAdcDataSize>(audio));
+    puck.SendTxMessage();
+    sleeve.Poll([&](const Message& message) {
+      if (message.type() != MessageType::kAudioSamples) { return; }
+      receiver.HandleMessage(message);
+      if (!std::equal(audio, audio + kAdcDataSize, receiver.audio)) {
+        ++num_corrupted;
+      }
+    });
+  }
+
+  printf("  bits flipped: %d, received: %d, corrupted: %d\n",
+         static_cast<int>(faulty.stats().bits_flipped), receiver.num_audio,
+         num_corrupted);
+  CHECK(faulty.stats().bits_flipped > 0);
+  CHECK(receiver.num_audio > kNumMessages / 2);
+  CHECK(num_corrupted > 0);
+}
+
+// Messages pass through a pseudo-terminal pair.
+void TestPty() {
+  puts("TestPty");
+  PtyLink link;
+  if (!link.Open()) {
+    puts("  Skipped: pseudo-terminals are unavailable.");
+    return;
+  }
+  CHECK(!link.slave_name().empty());
+  LinkEndpoint puck(link.a());
+  LinkEndpoint sleeve(link.b());
+  Receiver receiver;
+
+  for (int i = 0; i < 20; ++i) {
+    puck.tx_message().WriteTemperature(20.0f + i);
+    CHECK(puck.SendTxMessage());
+  }
+  for (int attempt = 0; attempt < 100 && receiver.num_temperature < 20;
+       ++attempt) {
+    sleeve.Poll([&](const Message& message) {
+      receiver.HandleMessage(message);
+    });
+    usleep(1000);
+  }
+  CHECK(receiver.num_temperature == 20);
+  CHECK(receiver.temperature == 39.0f);
+}
+
+}  // namespace audio_tactile
+
+// NOLINTEND
+
+int main(int argc, char** argv) {
+  audio_tactile::TestLoopbackTiming();
+  audio_tactile::TestEndpointsOverLoopback(
+      audio_tactile::MessageFramer::Mode::kSerial);
+  audio_tactile::TestEndpointsOverLoopback(
+      audio_tactile::MessageFramer::Mode::kBle);
+  audio_tactile::TestFaultInjection();
+  audio_tactile::TestSerialFaultInjection();
+  audio_tactile::TestPty();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
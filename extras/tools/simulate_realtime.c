@@ -0,0 +1,572 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Headless real-time deadline simulator for the tactile audio callback.
+ *
+ * run_tactile_processor and tactile_worker run TactileProcessor, PostProcessor,
+ * and a ChannelMap in a PortAudio callback, once per chunk of `chunk_size`
+ * frames. This program runs the same per-chunk processing, the
+ * TactileChunkProcessor that run_tactile_processor uses, with a simulated audio
+ * clock instead of audio hardware, to check whether it keeps up with real-time
+ * deadlines on a given machine and under adverse conditions.
+ *
+ * Chunk k "arrives" at time k * period, where period = chunk_size /
+ * sample_rate_hz. The callback is woken at the arrival time plus injected
+ * scheduling jitter, processes the chunk, and must finish by its deadline,
+ * --deadline_chunks periods after arrival. If a callback overruns, later chunks
+ * queue up as they would in the audio driver. Optionally, --load_threads
+ * threads spin to simulate CPU contention from other work.
+ *
+ * For each callback, the simulator records
+ *
+ *   wake delay      Time from chunk arrival to the callback starting.
+ *   process time    Wall time spent processing the chunk.
+ *   cpu time        CPU time of the callback thread spent processing the chunk.
+ *                   Process time minus cpu time is time the thread was
+ *                   preempted.
+ *   lateness        Finish time minus deadline. Positive is a deadline miss.
+ *   queue depth     Number of chunks that have arrived but not yet been
+ *                   processed when the callback starts, including its own.
+ *
+ * and prints summary statistics and histograms. With --trace_csv, per-callback
+ * values are written to a CSV file. With --max_misses, the exit status is
+ * failure if there are more deadline misses, so that the simulator can be used
+ * to regression-test real-time safety, e.g.
+ *
+ *   bazel run -c opt //extras/tools:simulate_realtime -- \
+ *       --chunk_size=64 --duration_s=30 --jitter_us=500 --load_threads=2 \
+ *       --max_misses=0
+ *
+ * Flags:
+ *  --input=<wavfile>          (Optional) Input WAV file, looped. If not set,
+ *                             input is white noise.
+ *  --sample_rate_hz=<int>     Sample rate for noise input (default 16000).
+ *  --chunk_size=<int>         Frames per callback (default 256).
+ *  --duration_s=<float>       Simulated duration in seconds (default 10).
+ *  --deadline_chunks=<float>  Deadline in chunk periods after arrival
+ *                             (default 1).
+ *  --jitter_us=<float>        Max uniformly-distributed wake delay in us.
+ *  --spike_us=<float>         Extra wake delay in us of occasional spikes.
+ *  --spike_probability=<float>  Probability of a spike per callback.
+ *  --load_threads=<int>       Number of CPU contention threads (default 0).
+ *  --load_duty=<float>        Fraction of time load threads spin (default 0.5).
+ *  --realtime                 Run the callback thread with SCHED_FIFO priority,
+ *                             as audio threads usually are. Needs privileges.
+ *  --seed=<int>               Random seed for jitter and noise input.
+ *  --trace_csv=<path>         (Optional) Path to write per-callback values.
+ *  --max_misses=<int>         (Optional) Fail if there are more misses.
+ *  --channels=<list>          Channel mapping (default: 1,2,...,10).
+ *  --channel_gains_db=<list>  Gains in dB for each channel.
+ *  --gain_db=<float>          Overall output gain in dB.
+ *  --block_size=<int>         TactileProcessor block_size.
+ *  --vowel_hop=<int>          Blocks between vowel embedding updates.
+ *  --cutoff_hz=<float>        Cutoff in Hz for energy smoothing filters.
+ *
+ * When built with --copt=-DSTAGE_PROFILER_ENABLED=1, per-stage processing times
+ * from StageProfiler over the last window are also printed.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/dsp/decibels.h"
+#include "src/dsp/number_util.h"
+#include "src/dsp/read_wav_file.h"
+#include "src/tactile/post_processor.h"
+#include "src/tactile/stage_profiler.h"
+#include "src/tactile/tactile_processor.h"
+#include "extras/tools/channel_map_tui.h"
+#include "extras/tools/tactile_chunk_processor.h"
+#include "extras/tools/util.h"
+
+#define kDefaultChannels "1,2,3,4,5,6,7,8,9,10"
+#define kMaxLoadThreads 64
+/* Load threads alternate between spinning and sleeping with this period. */
+#define kLoadPeriodNs 1000000
+/* Queue depths at or above this are counted in the last histogram bin. */
+#define kMaxQueueDepth 16
+/* Process time histogram bins, as a percentage of the chunk period. */
+#define kTimeBinPercent 5
+#define kNumTimeBins 40
+
+typedef struct {
+  pthread_mutex_t lock;
+  int keep_running;  /* Guarded by `lock`. */
+  float duty;
+} LoadState;
+
+/* Per-callback measurements, in microseconds. */
+typedef struct {
+  double wake_delay_us;
+  double process_us;
+  double cpu_us;
+  double lateness_us;
+  int queue_depth;
+} CallbackRecord;
+
+static int64_t NowNs(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* StageProfiler clock, in nanoseconds. */
+static uint32_t ProfilerClockNs(void) {
+  return (uint32_t)NowNs(CLOCK_MONOTONIC);
+}
+
+static void SleepUntilNs(int64_t t) {
+  struct timespec ts;
+  ts.tv_sec = (time_t)(t / 1000000000);
+  ts.tv_nsec = (long)(t % 1000000000);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {}
+}
+
+/* Uniform random value in [0, 1), from a 64-bit linear congruential
+ * generator. The simulator needs reproducibility rather than quality.
+ */
+static double RandomUniform(uint64_t* state) {
+  *state = *state * UINT64_C(6364136223846793005) +
+      UINT64_C(1442695040888963407);
+  return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Load thread, spinning for `duty` of each kLoadPeriodNs period. */
+static void* LoadThread(void* arg) {
+  LoadState* load = (LoadState*)arg;
+  const int64_t spin_ns = (int64_t)(load->duty * kLoadPeriodNs);
+  volatile double sink = 0.0;
+  int64_t period_start = NowNs(CLOCK_MONOTONIC);
+
+  while (1) {
+    pthread_mutex_lock(&load->lock);
+    const int keep_running = load->keep_running;
+    pthread_mutex_unlock(&load->lock);
+    if (!keep_running) { break; }
+
+    while (NowNs(CLOCK_MONOTONIC) - period_start < spin_ns) {
+      int i;
+      for (i = 0; i < 1000; ++i) { sink = sink * 0.999 + 1.0; }
+    }
+    period_start += kLoadPeriodNs;
+    SleepUntilNs(period_start);
+  }
+  return NULL;
+}
+
+/* Attempts to give the calling thread real-time priority. */
+static void SetRealtimePriority(void) {
+  struct sched_param param;
+  memset(&param, 0, sizeof(param));
+  param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+  if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+    fprintf(stderr, "Warning: Failed to set SCHED_FIFO priority. "
+            "Continuing with normal priority.\n");
+  }
+}
+
+/* Reads `filename` and mixes down to mono. Returns NULL on failure. */
+static float* ReadMonoWav(const char* filename, int* num_frames,
+                          int* sample_rate_hz) {
+  size_t num_samples;
+  int num_channels;
+  int32_t* samples = ReadWavFile(
+      filename, &num_samples, &num_channels, sample_rate_hz);
+  if (samples == NULL) { return NULL; }
+  *num_frames = (int)(num_samples / num_channels);
+  float* mono = (float*)malloc(sizeof(float) * (*num_frames > 0
+                                                ? *num_frames : 1));
+  if (mono == NULL) {
+    fprintf(stderr, "Error: Memory allocation failed.\n");
+    free(samples);
+    return NULL;
+  }
+  const float scale = 1.0f / ((float)INT32_MAX * num_channels);
+  int i;
+  for (i = 0; i < *num_frames; ++i) {
+    float sum = 0.0f;
+    int c;
+    for (c = 0; c < num_channels; ++c) {
+      sum += (float)samples[i * num_channels + c];
+    }
+    mono[i] = scale * sum;
+  }
+  free(samples);
+  return mono;
+}
+
+static int CompareDoubles(const void* a, const void* b) {
+  const double x = *(const double*)a;
+  const double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+/* Prints mean, percentiles, and max of `values`, which is sorted in place. */
+static void PrintStats(const char* name, double* values, int n) {
+  qsort(values, n, sizeof(double), CompareDoubles);
+  double sum = 0.0;
+  int i;
+  for (i = 0; i < n; ++i) { sum += values[i]; }
+  static const double kPercentiles[4] = {0.5, 0.9, 0.99, 0.999};
+  printf("%-14s %9.1f", name, sum / n);
+  for (i = 0; i < 4; ++i) {
+    printf(" %9.1f", values[(int)(kPercentiles[i] * (n - 1) + 0.5)]);
+  }
+  printf(" %9.1f\n", values[n - 1]);
+}
+
+/* Prints a histogram row with a bar scaled to `max_count`. */
+static void PrintHistogramRow(const char* label, int count, int max_count) {
+  const int bar = (int)(50.0 * count / max_count + 0.5);
+  printf("  %-12s %8d ", label, count);
+  int i;
+  for (i = 0; i < bar; ++i) { putchar('#'); }
+  putchar('\n');
+}
+
+static void PrintHistograms(const CallbackRecord* records, int n,
+                            double period_us) {
+  int depth_counts[kMaxQueueDepth + 1] = {0};
+  int time_counts[kNumTimeBins + 1] = {0};
+  int max_depth_count = 1;
+  int max_time_count = 1;
+  int i;
+  for (i = 0; i < n; ++i) {
+    int depth = records[i].queue_depth;
+    if (depth > kMaxQueueDepth) { depth = kMaxQueueDepth; }
+    if (depth < 0) { depth = 0; }
+    if (++depth_counts[depth] > max_depth_count) {
+      max_depth_count = depth_counts[depth];
+    }
+    int bin = (int)(100.0 * records[i].process_us /
+                    (period_us * kTimeBinPercent));
+    if (bin > kNumTimeBins) { bin = kNumTimeBins; }
+    if (++time_counts[bin] > max_time_count) {
+      max_time_count = time_counts[bin];
+    }
+  }
+
+  char label[32];
+  printf("\nQueue depth histogram:\n");
+  for (i = 0; i <= kMaxQueueDepth; ++i) {
+    if (depth_counts[i] == 0) { continue; }
+    sprintf(label, (i < kMaxQueueDepth) ? "%d" : ">= %d", i);
+    PrintHistogramRow(label, depth_counts[i], max_depth_count);
+  }
+
+  printf("\nProcess time histogram, %% of chunk period:\n");
+  for (i = 0; i <= kNumTimeBins; ++i) {
+    if (time_counts[i] == 0) { continue; }
+    if (i < kNumTimeBins) {
+      sprintf(label, "%d-%d%%", i * kTimeBinPercent,
+              (i + 1) * kTimeBinPercent);
+    } else {
+      sprintf(label, ">= %d%%", i * kTimeBinPercent);
+    }
+    PrintHistogramRow(label, time_counts[i], max_time_count);
+  }
+}
+
+#if STAGE_PROFILER_ENABLED
+/* Prints StageProfiler stats of each stage that has a complete window. */
+static void PrintStageProfile(void) {
+  printf("\nStage profile over the last %d calls:\n"
+         "%-14s %9s %9s %9s\n", kStageProfilerWindow, "(us)", "min", "mean",
+         "max");
+  int stage;
+  for (stage = 0; stage < kNumProfileStages; ++stage) {
+    StageProfilerStats stats;
+    if (StageProfilerGetStats(stage, &stats)) {
+      printf("%-14s %9.1f %9.1f %9.1f\n", StageProfilerStageName(stage),
+             1e-3 * stats.min, 1e-3 * stats.mean, 1e-3 * stats.max);
+    }
+  }
+}
+#endif
+
+static int WriteTraceCsv(const char* csv_file, const CallbackRecord* records,
+                         int n) {
+  FILE* f = fopen(csv_file, "w");
+  if (f == NULL) { return 0; }
+  fprintf(f, "callback,wake_delay_us,process_us,cpu_us,lateness_us,"
+          "queue_depth,missed\n");
+  int i;
+  for (i = 0; i < n; ++i) {
+    const CallbackRecord* r = &records[i];
+    fprintf(f, "%d,%.3f,%.3f,%.3f,%.3f,%d,%d\n", i, r->wake_delay_us,
+            r->process_us, r->cpu_us, r->lateness_us, r->queue_depth,
+            r->lateness_us > 0.0);
+  }
+  return fclose(f) == 0;
+}
+
+int main(int argc, char** argv) {
+  TactileProcessorParams params;
+  TactileProcessorSetDefaultParams(&params);
+  PostProcessorParams post_processor_params;
+  PostProcessorSetDefaultParams(&post_processor_params);
+  const char* input_wav = NULL;
+  const char* trace_csv = NULL;
+  const char* source_list = kDefaultChannels;
+  const char* gains_db_list = NULL;
+  int sample_rate_hz = 16000;
+  int chunk_size = 256;
+  float duration_s = 10.0f;
+  float deadline_chunks = 1.0f;
+  float jitter_us = 0.0f;
+  float spike_us = 0.0f;
+  float spike_probability = 0.0f;
+  int num_load_threads = 0;
+  float load_duty = 0.5f;
+  int realtime = 0;
+  int seed = 0;
+  int max_misses = -1;
+  float cutoff_hz = 500.0f;
+
+  ChannelMap channel_map;
+  TactileChunkProcessor* processor = NULL;
+  float* output = NULL;
+  float* input = NULL;
+  int input_size = 0;
+  CallbackRecord* records = NULL;
+  double* values = NULL;
+  LoadState load;
+  pthread_t load_threads[kMaxLoadThreads];
+  int num_started = 0;
+  int status = EXIT_FAILURE;
+  int i;
+
+  for (i = 1; i < argc; ++i) { /* Parse flags. */
+    const char* value = strchr(argv[i], '=');
+    value = (value != NULL) ? value + 1 : "";
+    if (StartsWith(argv[i], "--input=")) {
+      input_wav = value;
+    } else if (StartsWith(argv[i], "--sample_rate_hz=")) {
+      sample_rate_hz = atoi(value);
+    } else if (StartsWith(argv[i], "--chunk_size=")) {
+      chunk_size = atoi(value);
+    } else if (StartsWith(argv[i], "--duration_s=")) {
+      duration_s = atof(value);
+    } else if (StartsWith(argv[i], "--deadline_chunks=")) {
+      deadline_chunks = atof(value);
+    } else if (StartsWith(argv[i], "--jitter_us=")) {
+      jitter_us = atof(value);
+    } else if (StartsWith(argv[i], "--spike_us=")) {
+      spike_us = atof(value);
+    } else if (StartsWith(argv[i], "--spike_probability=")) {
+      spike_probability = atof(value);
+    } else if (StartsWith(argv[i], "--load_threads=")) {
+      num_load_threads = atoi(value);
+    } else if (StartsWith(argv[i], "--load_duty=")) {
+      load_duty = atof(value);
+    } else if (!strcmp(argv[i], "--realtime")) {
+      realtime = 1;
+    } else if (StartsWith(argv[i], "--seed=")) {
+      seed = atoi(value);
+    } else if (StartsWith(argv[i], "--trace_csv=")) {
+      trace_csv = value;
+    } else if (StartsWith(argv[i], "--max_misses=")) {
+      max_misses = atoi(value);
+    } else if (StartsWith(argv[i], "--channels=")) {
+      source_list = value;
+    } else if (StartsWith(argv[i], "--channel_gains_db=")) {
+      gains_db_list = value;
+    } else if (StartsWith(argv[i], "--gain_db=")) {
+      post_processor_params.gain = DecibelsToAmplitudeRatio(atof(value));
+    } else if (StartsWith(argv[i], "--block_size=")) {
+      params.frontend_params.block_size = atoi(value);
+    } else if (StartsWith(argv[i], "--vowel_hop=")) {
+      params.vowel_hop = atoi(value);
+    } else if (StartsWith(argv[i], "--cutoff_hz=")) {
+      cutoff_hz = atof(value);
+    } else {
+      fprintf(stderr, "Error: Invalid flag \"%s\"\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  uint64_t rng_state = (uint64_t)seed * 2 + 1;
+  if (input_wav != NULL) {
+    input = ReadMonoWav(input_wav, &input_size, &sample_rate_hz);
+    if (input == NULL) { goto done; }
+  }
+
+  const int block_size = params.frontend_params.block_size;
+  if (block_size <= 0 || chunk_size <= 0 || sample_rate_hz <= 0) {
+    fprintf(stderr, "Error: block_size, chunk_size, and sample_rate_hz must "
+            "be positive.\n");
+    goto done;
+  } else if (!(duration_s > 0.0f && deadline_chunks > 0.0f)) {
+    fprintf(stderr,
+            "Error: duration_s and deadline_chunks must be positive.\n");
+    goto done;
+  } else if (!(0 <= num_load_threads && num_load_threads <= kMaxLoadThreads)) {
+    fprintf(stderr, "Error: load_threads must be between 0 and %d.\n",
+            kMaxLoadThreads);
+    goto done;
+  } else if (!(0.0f <= load_duty && load_duty <= 1.0f)) {
+    fprintf(stderr, "Error: load_duty must be between 0 and 1.\n");
+    goto done;
+  } else if (!ChannelMapParse(kTactileChunkProcessorNumTactors, source_list,
+                              gains_db_list, &channel_map)) {
+    goto done;
+  }
+  if (chunk_size % block_size != 0) {
+    chunk_size = RoundUpToMultiple(chunk_size, block_size);
+    printf("chunk_size rounded up to %d frames.\n", chunk_size);
+  }
+
+  /* Make noise input, or pad WAV input to a whole number of chunks. */
+  if (input == NULL) {
+    input_size = sample_rate_hz;
+  }
+  const int padded_size = RoundUpToMultiple(
+      input_size > 0 ? input_size : 1, chunk_size);
+  float* padded = (float*)realloc(input, sizeof(float) * padded_size);
+  if (padded == NULL) {
+    fprintf(stderr, "Error: Memory allocation failed.\n");
+    goto done;
+  }
+  if (input == NULL) {
+    for (i = 0; i < input_size; ++i) {
+      padded[i] = 0.2f * (float)RandomUniform(&rng_state) - 0.1f;
+    }
+  }
+  input = padded;
+  for (i = input_size; i < padded_size; ++i) { input[i] = 0.0f; }
+  input_size = padded_size;
+
+  params.frontend_params.input_sample_rate_hz = sample_rate_hz;
+  params.enveloper_params.energy_cutoff_hz = cutoff_hz;
+  processor = TactileChunkProcessorMake(&params, &post_processor_params,
+                                        &channel_map, chunk_size);
+  if (processor == NULL) { goto done; }
+  output = (float*)malloc(
+      sizeof(float) * channel_map.num_output_channels * chunk_size);
+
+  const double period_ns = (1e9 * chunk_size) / sample_rate_hz;
+  const int num_callbacks = (int)ceil(duration_s * 1e9 / period_ns);
+  records = (CallbackRecord*)malloc(sizeof(CallbackRecord) * num_callbacks);
+  values = (double*)malloc(sizeof(double) * num_callbacks);
+  if (output == NULL || records == NULL || values == NULL) {
+    fprintf(stderr, "Error: Memory allocation failed.\n");
+    goto done;
+  }
+
+  printf("sample rate: %d Hz\n"
+         "chunk size: %d frames (%.2f ms), deadline %.2f ms\n"
+         "jitter: 0-%g us, spikes: %g us with probability %g\n"
+         "load threads: %d at %g%% duty\n",
+         sample_rate_hz, chunk_size, 1e-6 * period_ns,
+         1e-6 * deadline_chunks * period_ns, jitter_us, spike_us,
+         spike_probability, num_load_threads, 100.0 * load_duty);
+
+  load.keep_running = 1;
+  load.duty = load_duty;
+  pthread_mutex_init(&load.lock, NULL);
+  for (; num_started < num_load_threads; ++num_started) {
+    if (pthread_create(&load_threads[num_started], NULL,
+                       LoadThread, &load) != 0) {
+      fprintf(stderr, "Error: Failed to start load thread.\n");
+      break;
+    }
+  }
+  if (realtime) { SetRealtimePriority(); }
+  StageProfilerSetClockFun(ProfilerClockNs);
+  StageProfilerReset();
+
+  /* Run the simulated audio clock. */
+  const int64_t t0 = NowNs(CLOCK_MONOTONIC) + 10000000;
+  int num_misses = 0;
+  int k;
+  for (k = 0; k < num_callbacks; ++k) {
+    const int64_t arrival = t0 + (int64_t)(k * period_ns);
+    double delay_us = jitter_us * RandomUniform(&rng_state);
+    if (RandomUniform(&rng_state) < spike_probability) {
+      delay_us += spike_us;
+    }
+    SleepUntilNs(arrival + (int64_t)(1000.0 * delay_us));
+
+    const int64_t start = NowNs(CLOCK_MONOTONIC);
+    const int64_t cpu_start = NowNs(CLOCK_THREAD_CPUTIME_ID);
+    const float* chunk_input =
+        input + (int)(((int64_t)k * chunk_size) % input_size);
+    TactileChunkProcessorProcessChunk(processor, chunk_input, output);
+    const int64_t cpu_end = NowNs(CLOCK_THREAD_CPUTIME_ID);
+    const int64_t end = NowNs(CLOCK_MONOTONIC);
+
+    CallbackRecord* r = &records[k];
+    r->wake_delay_us = 1e-3 * (start - arrival);
+    r->process_us = 1e-3 * (end - start);
+    r->cpu_us = 1e-3 * (cpu_end - cpu_start);
+    r->lateness_us = 1e-3 * (end - (arrival + deadline_chunks * period_ns));
+    r->queue_depth = (int)floor((start - t0) / period_ns) - k + 1;
+    if (r->lateness_us > 0.0) { ++num_misses; }
+  }
+
+  pthread_mutex_lock(&load.lock);
+  load.keep_running = 0;
+  pthread_mutex_unlock(&load.lock);
+  for (i = 0; i < num_started; ++i) {
+    pthread_join(load_threads[i], NULL);
+  }
+  pthread_mutex_destroy(&load.lock);
+
+  printf("\n%d callbacks over %.1f s\n"
+         "%-14s %9s %9s %9s %9s %9s %9s\n", num_callbacks,
+         1e-9 * num_callbacks * period_ns, "(us)", "mean", "p50", "p90",
+         "p99", "p99.9", "max");
+  for (i = 0; i < num_callbacks; ++i) { values[i] = records[i].wake_delay_us; }
+  PrintStats("wake delay", values, num_callbacks);
+  for (i = 0; i < num_callbacks; ++i) { values[i] = records[i].process_us; }
+  PrintStats("process time", values, num_callbacks);
+  for (i = 0; i < num_callbacks; ++i) { values[i] = records[i].cpu_us; }
+  PrintStats("cpu time", values, num_callbacks);
+  for (i = 0; i < num_callbacks; ++i) { values[i] = records[i].lateness_us; }
+  PrintStats("lateness", values, num_callbacks);
+  printf("\nDeadline misses: %d of %d (%.3f%%)\n", num_misses, num_callbacks,
+         (100.0 * num_misses) / num_callbacks);
+  PrintHistograms(records, num_callbacks, 1e-3 * period_ns);
+#if STAGE_PROFILER_ENABLED
+  PrintStageProfile();
+#endif
+
+  status = EXIT_SUCCESS;
+  if (trace_csv != NULL && !WriteTraceCsv(trace_csv, records, num_callbacks)) {
+    fprintf(stderr, "Error writing \"%s\"\n", trace_csv);
+    status = EXIT_FAILURE;
+  }
+  if (max_misses >= 0 && num_misses > max_misses) {
+    fprintf(stderr, "Error: %d deadline misses exceeds --max_misses=%d.\n",
+            num_misses, max_misses);
+    status = EXIT_FAILURE;
+  }
+
+done:
+  free(values);
+  free(records);
+  free(output);
+  TactileChunkProcessorFree(processor);
+  free(input);
+  return status;
+}
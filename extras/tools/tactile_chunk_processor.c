@@ -0,0 +1,150 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "extras/tools/tactile_chunk_processor.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/dsp/fast_fun.h"
+
+/* Time constant of the volume meter's release. */
+static const float kVolumeMeterTimeConstantSeconds = 0.05f;
+
+TactileChunkProcessor* TactileChunkProcessorMake(
+    TactileProcessorParams* params,
+    const PostProcessorParams* post_processor_params,
+    const ChannelMap* channel_map, int chunk_size) {
+  const int block_size = params->frontend_params.block_size;
+  if (block_size <= 0 || chunk_size <= 0 || chunk_size % block_size != 0) {
+    fprintf(stderr, "Error: chunk_size must be a positive multiple of "
+            "block_size.\n");
+    return NULL;
+  }
+
+  TactileChunkProcessor* processor =
+      (TactileChunkProcessor*)malloc(sizeof(TactileChunkProcessor));
+  if (processor == NULL) {
+    fprintf(stderr, "Error: Memory allocation failed.\n");
+    return NULL;
+  }
+  processor->channel_map = *channel_map;
+  processor->chunk_size = chunk_size;
+  processor->tactile_output = NULL;
+
+  processor->tactile_processor = TactileProcessorMake(params);
+  if (processor->tactile_processor == NULL) {
+    fprintf(stderr, "Error: TactileProcessorMake failed.\n");
+    goto fail;
+  } else if (!PostProcessorInit(&processor->post_processor,
+                                post_processor_params,
+                                TactileProcessorOutputSampleRateHz(params),
+                                kTactileChunkProcessorNumTactors)) {
+    goto fail;
+  }
+
+  processor->tactile_output = (float*)malloc(
+      sizeof(float) * kTactileChunkProcessorNumTactors * block_size);
+  if (processor->tactile_output == NULL) {
+    fprintf(stderr, "Error: Memory allocation failed.\n");
+    goto fail;
+  }
+
+  int c;
+  for (c = 0; c < kTactileChunkProcessorNumTactors; ++c) {
+    processor->volume[c] = 0.0f;
+  }
+  processor->volume_decay_coeff = (float)exp(
+      -chunk_size / (kVolumeMeterTimeConstantSeconds *
+                     params->frontend_params.input_sample_rate_hz));
+  return processor;
+
+fail:
+  TactileChunkProcessorFree(processor);
+  return NULL;
+}
+
+void TactileChunkProcessorFree(TactileChunkProcessor* processor) {
+  if (processor) {
+    free(processor->tactile_output);
+    TactileProcessorFree(processor->tactile_processor);
+    free(processor);
+  }
+}
+
+void TactileChunkProcessorProcessChunk(TactileChunkProcessor* processor,
+                                       const float* input, float* output) {
+  const int num_tactors = kTactileChunkProcessorNumTactors;
+  const int block_size = CarlFrontendBlockSize(
+      processor->tactile_processor->frontend);
+  const int num_blocks = processor->chunk_size / block_size;
+  float energy_accum[kTactileChunkProcessorNumTactors] = {0.0f};
+  int b;
+
+  for (b = 0; b < num_blocks; ++b) {
+    float* tactile_output = processor->tactile_output;
+    /* Run audio-to-tactile processing. */
+    TactileProcessorProcessSamples(
+        processor->tactile_processor, input, tactile_output);
+
+    /* Accumulate signals for visualization. Do this before post processing. */
+    int i;
+    for (i = 0; i < block_size; ++i) {
+      int c;
+      for (c = 0; c < num_tactors; ++c) {
+        energy_accum[c] += tactile_output[c] * tactile_output[c];
+      }
+      tactile_output += num_tactors;
+    }
+
+    /* Apply equalization, clipping, and lowpass filtering. */
+    tactile_output = processor->tactile_output;
+    PostProcessorProcessSamples(
+        &processor->post_processor, tactile_output, block_size);
+
+    /* Map channels and apply channel gains. */
+    ChannelMapApply(&processor->channel_map, tactile_output, block_size,
+                    output);
+
+    input += block_size;
+    output += processor->channel_map.num_output_channels * block_size;
+  }
+
+  int c;
+  for (c = 0; c < num_tactors; ++c) {
+    /* Convert tactile energy to perceived strength with Steven's power law.
+     * Perceived strength is roughly proportional to acceleration^0.55, which is
+     * proportional to sqrt(energy)^0.55.
+     *
+     * Different experiments have measured the exponent to be between 0.32 and
+     * 0.81. The exponent depends especially on the stimulus frequency. Over
+     * our range of interest 80-250 Hz, Ryu2010 measured 0.55.
+     *
+     * Reference: Ryu, "Psychophysical model for vibrotactile rendering in
+     * mobile devices," Presence 19.4 (2010): 364-387.
+     */
+    const float perceived = FastPow(1e-12f + energy_accum[c]
+        / (num_blocks * block_size), 0.55f * 0.5f);
+    /* Update volume[c] according to
+     *   volume = max(rms, volume * volume_decay_coeff).
+     * This way the visualization follows the RMS with instantaneous attack but
+     * smoothed release, so that onsets are well represented.
+     */
+    float updated_volume = processor->volume[c] * processor->volume_decay_coeff;
+    if (perceived > updated_volume) { updated_volume = perceived; }
+    processor->volume[c] = updated_volume;
+  }
+}
@@ -0,0 +1,89 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Per-chunk tactile processing, as done in an audio callback.
+ *
+ * TactileChunkProcessor runs TactileProcessor, PostProcessor, and a ChannelMap
+ * on a chunk of audio, and updates a volume meter of each tactor's perceived
+ * strength for visualization. run_tactile_processor calls it from its
+ * PortAudio callback and simulate_realtime from its simulated audio clock, so
+ * that both run the same code path.
+ *
+ *   TactileChunkProcessor* processor = TactileChunkProcessorMake(
+ *       &params, &post_processor_params, &channel_map, chunk_size);
+ *   // In the audio callback:
+ *   TactileChunkProcessorProcessChunk(processor, input, output);
+ *   ...
+ *   TactileChunkProcessorFree(processor);
+ */
+
+#ifndef AUDIO_TO_TACTILE_EXTRAS_TOOLS_TACTILE_CHUNK_PROCESSOR_H_
+#define AUDIO_TO_TACTILE_EXTRAS_TOOLS_TACTILE_CHUNK_PROCESSOR_H_
+
+#include "src/dsp/channel_map.h"
+#include "src/tactile/post_processor.h"
+#include "src/tactile/tactile_processor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Same as kTactileProcessorNumTactors, as a constant for array sizes. */
+#define kTactileChunkProcessorNumTactors 10
+
+typedef struct {
+  TactileProcessor* tactile_processor;
+  PostProcessor post_processor;
+  /* Mapping from tactors to output channels. The channel gains may be changed
+   * between chunks.
+   */
+  ChannelMap channel_map;
+  /* Number of input frames per chunk, a multiple of the block size. */
+  int chunk_size;
+  /* Workspace for one block of TactileProcessor output. */
+  float* tactile_output;
+
+  float volume_decay_coeff;
+  /* Volume meter of each tactor's perceived strength, updated once per chunk.
+   * This is volatile, since a UI thread may read it while the audio thread
+   * writes it.
+   */
+  volatile float volume[kTactileChunkProcessorNumTactors];
+} TactileChunkProcessor;
+
+/* Makes a TactileChunkProcessor. `params` set the TactileProcessor, including
+ * the input sample rate, and `chunk_size` must be a multiple of its block size.
+ * The ChannelMap is copied. Returns NULL on failure. The caller should free it
+ * with TactileChunkProcessorFree() when done.
+ */
+TactileChunkProcessor* TactileChunkProcessorMake(
+    TactileProcessorParams* params,
+    const PostProcessorParams* post_processor_params,
+    const ChannelMap* channel_map, int chunk_size);
+
+/* Frees a TactileChunkProcessor. */
+void TactileChunkProcessorFree(TactileChunkProcessor* processor);
+
+/* Processes one chunk of `chunk_size` mono input frames to interleaved output
+ * with `channel_map.num_output_channels` channels, and updates the volume
+ * meter.
+ */
+void TactileChunkProcessorProcessChunk(TactileChunkProcessor* processor,
+                                       const float* input, float* output);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+#endif /* AUDIO_TO_TACTILE_EXTRAS_TOOLS_TACTILE_CHUNK_PROCESSOR_H_ */
@@ -0,0 +1,652 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Bitstream of a block: for each channel, 1 bit for the predictor order (0 =>
+ * first order, 1 => second order) and 5 bits for the Rice parameter k,
+ * followed by the channel's residuals. A residual r is zigzag mapped to
+ * u = 2|r| or 2|r| - 1, then coded as q = u >> k ones, a zero, and the low k
+ * bits of u. If q >= kEscapeQuotient, it is coded instead as kEscapeQuotient
+ * ones and u in kEscapeBits bits. Bits are packed LSB first.
+ */
+
+#include "extras/tools/tactile_recording.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/dsp/q_resampler.h"
+#include "src/dsp/serialize.h"
+
+#define kMagic "TREC"
+#define kVersion 1
+#define kHeaderSize 40
+#define kMaxRiceParam 31
+#define kEscapeQuotient 24
+/* Residuals are at most 4 * 2^15 in magnitude, so u < 2^19. */
+#define kEscapeBits 20
+/* Max number of input frames passed to the resampler at once. */
+#define kMaxInputFrames 1024
+
+void TactileRecordingSetDefaultParams(TactileRecordingParams* params) {
+  params->num_channels = 10;
+  params->input_sample_rate_hz = 16000.0f;
+  params->decimation_factor = 8;
+  params->quantization_bits = 12;
+  params->block_frames = 256;
+}
+
+/* Max number of bytes of an encoded block, including the frame count. */
+static size_t MaxBlockBytes(int block_frames, int num_channels) {
+  /* A residual takes at most kEscapeQuotient + 1 + k bits, where k <= 19 since
+   * u < 2^19, or kEscapeQuotient + kEscapeBits bits if escaped.
+   */
+  const size_t kMaxBitsPerSample = kEscapeQuotient + kEscapeBits + 1;
+  return 2 + ((size_t)block_frames * num_channels * kMaxBitsPerSample +
+              (size_t)num_channels * 6 + 7) / 8;
+}
+
+/* Writes or reads the header. */
+static void EncodeHeader(int num_channels, int quantization_bits,
+                         float sample_rate_hz, int decimation_factor,
+                         int block_frames, uint64_t num_frames,
+                         uint64_t index_offset, uint32_t num_blocks,
+                         uint8_t* header) {
+  memset(header, 0, kHeaderSize);
+  memcpy(header, kMagic, 4);
+  header[4] = kVersion;
+  header[5] = (uint8_t)num_channels;
+  header[6] = (uint8_t)quantization_bits;
+  LittleEndianWriteF32(sample_rate_hz, header + 8);
+  LittleEndianWriteU16((uint16_t)decimation_factor, header + 12);
+  LittleEndianWriteU16((uint16_t)block_frames, header + 14);
+  LittleEndianWriteU64(num_frames, header + 16);
+  LittleEndianWriteU64(index_offset, header + 24);
+  LittleEndianWriteU32(num_blocks, header + 32);
+}
+
+/* Predicts sample i of a channel from the previous samples in the block. Each
+ * block is coded independently, so the first samples use lower orders.
+ */
+static int32_t Predict(const int32_t* x, int stride, int i, int order) {
+  if (i == 0) {
+    return 0;
+  } else if (i == 1 || order == 1) {
+    return x[(i - 1) * stride];
+  } else {
+    return 2 * x[(i - 1) * stride] - x[(i - 2) * stride];
+  }
+}
+
+typedef struct {
+  uint8_t* bytes;
+  size_t size;
+  uint64_t buffer;
+  int num_bits;
+} BitWriter;
+
+/* Writes the low `num_bits` bits of `value`, num_bits <= 32. */
+static void WriteBits(BitWriter* w, uint32_t value, int num_bits) {
+  w->buffer |= (uint64_t)value << w->num_bits;
+  w->num_bits += num_bits;
+  while (w->num_bits >= 8) {
+    w->bytes[w->size++] = (uint8_t)w->buffer;
+    w->buffer >>= 8;
+    w->num_bits -= 8;
+  }
+}
+
+static void FlushBits(BitWriter* w) {
+  if (w->num_bits > 0) {
+    w->bytes[w->size++] = (uint8_t)w->buffer;
+  }
+  w->buffer = 0;
+  w->num_bits = 0;
+}
+
+struct TactileRecordingWriter {
+  FILE* f;
+  TactileRecordingParams params;
+  float scale;
+  QResampler* resampler;  /* NULL if decimation_factor is 1. */
+  size_t num_input_frames;
+  size_t num_frames;  /* Number of stored frames, including buffered ones. */
+
+  int32_t* block;  /* Quantized frames of the current block. */
+  int block_num_frames;
+  uint8_t* block_bytes;
+
+  uint64_t* block_offsets;
+  uint32_t num_blocks;
+  uint32_t block_offsets_capacity;
+  uint64_t file_offset;
+  int io_error;
+};
+
+static void FreeWriter(TactileRecordingWriter* writer) {
+  if (writer->resampler != NULL) { QResamplerFree(writer->resampler); }
+  free(writer->block_offsets);
+  free(writer->block_bytes);
+  free(writer->block);
+  free(writer);
+}
+
+TactileRecordingWriter* TactileRecordingWriterOpen(
+    const char* filename, const TactileRecordingParams* params) {
+  if (!(1 <= params->num_channels &&
+        params->num_channels <= kTactileRecordingMaxChannels) ||
+      !(params->input_sample_rate_hz > 0.0f) ||
+      !(1 <= params->decimation_factor && params->decimation_factor <= 1000) ||
+      !(4 <= params->quantization_bits && params->quantization_bits <= 16) ||
+      !(1 <= params->block_frames && params->block_frames <= 65535)) {
+    fprintf(stderr, "Error: Invalid TactileRecordingParams.\n");
+    return NULL;
+  }
+
+  TactileRecordingWriter* writer =
+      (TactileRecordingWriter*)malloc(sizeof(TactileRecordingWriter));
+  if (writer == NULL) { return NULL; }
+  writer->params = *params;
+  writer->scale = (float)(1 << (params->quantization_bits - 1));
+  writer->resampler = NULL;
+  writer->num_input_frames = 0;
+  writer->num_frames = 0;
+  writer->block = (int32_t*)malloc(
+      sizeof(int32_t) * params->block_frames * params->num_channels);
+  writer->block_num_frames = 0;
+  writer->block_bytes = (uint8_t*)malloc(
+      MaxBlockBytes(params->block_frames, params->num_channels));
+  writer->block_offsets = NULL;
+  writer->num_blocks = 0;
+  writer->block_offsets_capacity = 0;
+  writer->file_offset = kHeaderSize;
+  writer->io_error = 0;
+  if (writer->block == NULL || writer->block_bytes == NULL) {
+    FreeWriter(writer);
+    return NULL;
+  }
+
+  if (params->decimation_factor > 1) {
+    writer->resampler = QResamplerMake(
+        params->input_sample_rate_hz,
+        params->input_sample_rate_hz / params->decimation_factor,
+        params->num_channels, kMaxInputFrames, NULL);
+    if (writer->resampler == NULL) {
+      fprintf(stderr, "Error: QResamplerMake failed.\n");
+      FreeWriter(writer);
+      return NULL;
+    }
+  }
+
+  writer->f = fopen(filename, "wb");
+  if (writer->f == NULL) {
+    fprintf(stderr, "Error: Failed to open \"%s\" for writing.\n", filename);
+    FreeWriter(writer);
+    return NULL;
+  }
+  /* Write a placeholder header. It is rewritten on close. */
+  uint8_t header[kHeaderSize];
+  memset(header, 0, kHeaderSize);
+  if (fwrite(header, 1, kHeaderSize, writer->f) != kHeaderSize) {
+    fprintf(stderr, "Error: Failed to write \"%s\".\n", filename);
+    fclose(writer->f);
+    FreeWriter(writer);
+    return NULL;
+  }
+  return writer;
+}
+
+/* Encodes and writes the current block. */
+static void WriteBlock(TactileRecordingWriter* writer) {
+  const int num_channels = writer->params.num_channels;
+  const int num_frames = writer->block_num_frames;
+  BitWriter w;
+  w.bytes = writer->block_bytes;
+  w.size = 2;
+  w.buffer = 0;
+  w.num_bits = 0;
+  LittleEndianWriteU16((uint16_t)num_frames, writer->block_bytes);
+
+  int c;
+  for (c = 0; c < num_channels; ++c) {
+    const int32_t* x = writer->block + c;
+    /* Choose the predictor order with smaller sum of absolute residuals. */
+    uint64_t sum_abs[2] = {0, 0};
+    int i;
+    int order;
+    for (i = 0; i < num_frames; ++i) {
+      for (order = 1; order <= 2; ++order) {
+        const int32_t r = x[i * num_channels] -
+            Predict(x, num_channels, i, order);
+        sum_abs[order - 1] += (uint64_t)((r < 0) ? -r : r);
+      }
+    }
+    order = (sum_abs[1] < sum_abs[0]) ? 2 : 1;
+    /* Estimate the best Rice parameter from the mean zigzag value ~ 2 mean|r|.
+     * The expected code length is about k + 1 + mean(u) / 2^k, minimized
+     * roughly where 2^k ~ mean(u).
+     */
+    const uint64_t sum_u = 2 * sum_abs[order - 1];
+    int k = 0;
+    while (k < kMaxRiceParam && ((uint64_t)num_frames << (k + 1)) < sum_u) {
+      ++k;
+    }
+    WriteBits(&w, order - 1, 1);
+    WriteBits(&w, k, 5);
+
+    for (i = 0; i < num_frames; ++i) {
+      const int32_t r = x[i * num_channels] -
+          Predict(x, num_channels, i, order);
+      const uint32_t u = (r >= 0) ? 2 * (uint32_t)r : 2 * (uint32_t)(-r) - 1;
+      const uint32_t q = u >> k;
+      if (q < kEscapeQuotient) {
+        /* q ones followed by a zero. */
+        WriteBits(&w, (UINT32_C(1) << q) - 1, q + 1);
+        if (k > 0) { WriteBits(&w, u & ((UINT32_C(1) << k) - 1), k); }
+      } else {
+        WriteBits(&w, (UINT32_C(1) << kEscapeQuotient) - 1, kEscapeQuotient);
+        WriteBits(&w, u, kEscapeBits);
+      }
+    }
+  }
+  FlushBits(&w);
+
+  if (writer->num_blocks == writer->block_offsets_capacity) {
+    const uint32_t new_capacity = (writer->block_offsets_capacity > 0)
+        ? 2 * writer->block_offsets_capacity : 256;
+    uint64_t* new_offsets = (uint64_t*)realloc(
+        writer->block_offsets, sizeof(uint64_t) * new_capacity);
+    if (new_offsets == NULL) {
+      writer->io_error = 1;
+      return;
+    }
+    writer->block_offsets = new_offsets;
+    writer->block_offsets_capacity = new_capacity;
+  }
+  writer->block_offsets[writer->num_blocks++] = writer->file_offset;
+  if (fwrite(writer->block_bytes, 1, w.size, writer->f) != w.size) {
+    writer->io_error = 1;
+  }
+  writer->file_offset += w.size;
+  writer->block_num_frames = 0;
+}
+
+/* Quantizes and buffers stored-rate frames, writing blocks as they fill. */
+static void AddFrames(TactileRecordingWriter* writer,
+                      const float* frames, int num_frames) {
+  const int num_channels = writer->params.num_channels;
+  const float scale = writer->scale;
+  const float max_value = scale - 1.0f;
+  int i;
+  for (i = 0; i < num_frames; ++i) {
+    int32_t* dest = writer->block + writer->block_num_frames * num_channels;
+    int c;
+    for (c = 0; c < num_channels; ++c) {
+      float value = scale * frames[c];
+      if (!(value >= -scale)) { value = (value < 0.0f) ? -scale : 0.0f; }
+      if (value > max_value) { value = max_value; }
+      dest[c] = (int32_t)floor(value + 0.5f);
+    }
+    frames += num_channels;
+
+    if (++writer->block_num_frames == writer->params.block_frames) {
+      WriteBlock(writer);
+    }
+  }
+  writer->num_frames += num_frames;
+}
+
+int TactileRecordingWriterWrite(TactileRecordingWriter* writer,
+                                const float* samples,
+                                int num_frames) {
+  writer->num_input_frames += num_frames;
+  if (writer->resampler == NULL) {
+    AddFrames(writer, samples, num_frames);
+  } else {
+    const int num_channels = writer->params.num_channels;
+    while (num_frames > 0) {
+      const int chunk_frames =
+          (num_frames < kMaxInputFrames) ? num_frames : kMaxInputFrames;
+      const int num_output = QResamplerProcessSamples(
+          writer->resampler, samples, chunk_frames);
+      AddFrames(writer, QResamplerOutput(writer->resampler), num_output);
+      samples += chunk_frames * num_channels;
+      num_frames -= chunk_frames;
+    }
+  }
+  return !writer->io_error;
+}
+
+int TactileRecordingWriterClose(TactileRecordingWriter* writer) {
+  if (writer == NULL) { return 0; }
+  const TactileRecordingParams* params = &writer->params;
+  const int num_channels = params->num_channels;
+
+  if (writer->resampler != NULL) {
+    /* Flush the resampler with zeros, keeping stored frames up to the end of
+     * the input, i.e. ceil(num_input_frames / decimation_factor) frames.
+     */
+    const size_t target_num_frames =
+        (writer->num_input_frames + params->decimation_factor - 1) /
+        params->decimation_factor;
+    float* zeros = (float*)calloc(
+        (size_t)kMaxInputFrames * num_channels, sizeof(float));
+    if (zeros == NULL) {
+      writer->io_error = 1;
+    } else {
+      int flush_frames = QResamplerFlushFrames(writer->resampler);
+      while (flush_frames > 0 && writer->num_frames < target_num_frames) {
+        const int chunk_frames =
+            (flush_frames < kMaxInputFrames) ? flush_frames : kMaxInputFrames;
+        int num_output = QResamplerProcessSamples(
+            writer->resampler, zeros, chunk_frames);
+        if ((size_t)num_output > target_num_frames - writer->num_frames) {
+          num_output = (int)(target_num_frames - writer->num_frames);
+        }
+        AddFrames(writer, QResamplerOutput(writer->resampler), num_output);
+        flush_frames -= chunk_frames;
+      }
+      free(zeros);
+    }
+  }
+  if (writer->block_num_frames > 0) { WriteBlock(writer); }
+
+  /* Write the index. */
+  const uint64_t index_offset = writer->file_offset;
+  uint32_t i;
+  for (i = 0; i < writer->num_blocks; ++i) {
+    uint8_t bytes[8];
+    LittleEndianWriteU64(writer->block_offsets[i], bytes);
+    if (fwrite(bytes, 1, 8, writer->f) != 8) { writer->io_error = 1; }
+  }
+
+  /* Rewrite the header with the final sizes. */
+  uint8_t header[kHeaderSize];
+  EncodeHeader(num_channels, params->quantization_bits,
+               params->input_sample_rate_hz / params->decimation_factor,
+               params->decimation_factor, params->block_frames,
+               writer->num_frames, index_offset, writer->num_blocks, header);
+  int success = !writer->io_error;
+  success &= (fseek(writer->f, 0, SEEK_SET) == 0);
+  success &= (fwrite(header, 1, kHeaderSize, writer->f) == kHeaderSize);
+  success &= (fclose(writer->f) == 0);
+  if (!success) {
+    fprintf(stderr, "Error: Failed to write tactile recording.\n");
+  }
+
+  FreeWriter(writer);
+  return success;
+}
+
+typedef struct {
+  const uint8_t* bytes;
+  size_t size;
+  size_t pos;
+  uint64_t buffer;
+  int num_bits;
+  size_t bits_consumed;
+} BitReader;
+
+/* Fills the buffer to at least 57 bits, padding with zeros past the end. */
+static void Refill(BitReader* r) {
+  while (r->num_bits <= 56) {
+    const uint8_t byte = (r->pos < r->size) ? r->bytes[r->pos] : 0;
+    ++r->pos;
+    r->buffer |= (uint64_t)byte << r->num_bits;
+    r->num_bits += 8;
+  }
+}
+
+/* Reads `num_bits` bits, num_bits <= 32. */
+static uint32_t ReadBits(BitReader* r, int num_bits) {
+  if (r->num_bits < num_bits) { Refill(r); }
+  const uint32_t value =
+      (uint32_t)(r->buffer & ((UINT64_C(1) << num_bits) - 1));
+  r->buffer >>= num_bits;
+  r->num_bits -= num_bits;
+  r->bits_consumed += num_bits;
+  return value;
+}
+
+/* Reads a residual's unary quotient, up to kEscapeQuotient. */
+static int ReadQuotient(BitReader* r) {
+  if (r->num_bits < kEscapeQuotient + 1) { Refill(r); }
+  int q = 0;
+  while (q < kEscapeQuotient && ((r->buffer >> q) & 1)) { ++q; }
+  /* Consume the ones and the terminating zero, if not escaped. */
+  const int num_bits = (q < kEscapeQuotient) ? q + 1 : q;
+  r->buffer >>= num_bits;
+  r->num_bits -= num_bits;
+  r->bits_consumed += num_bits;
+  return q;
+}
+
+/* Reads and decodes block `b` into reader->block_samples. Returns 1 on
+ * success, 0 if the file is corrupt or on I/O error.
+ */
+static int DecodeBlock(TactileRecordingReader* reader, uint32_t b) {
+  const int num_channels = reader->num_channels;
+  const size_t size =
+      (size_t)(reader->block_offsets[b + 1] - reader->block_offsets[b]);
+  if (size < 2 ||
+      size > MaxBlockBytes(reader->block_frames, num_channels) ||
+      reader->block_offsets[b] > LONG_MAX ||
+      fseek(reader->f, (long)reader->block_offsets[b], SEEK_SET) != 0 ||
+      fread(reader->block_bytes, 1, size, reader->f) != size) {
+    goto fail;
+  }
+
+  const int num_frames = LittleEndianReadU16(reader->block_bytes);
+  const size_t expected_frames = (b + 1 < reader->num_blocks)
+      ? (size_t)reader->block_frames
+      : reader->num_frames - (size_t)b * reader->block_frames;
+  if ((size_t)num_frames != expected_frames) { goto fail; }
+
+  const int32_t max_abs = 1 << (reader->quantization_bits - 1);
+  BitReader r;
+  r.bytes = reader->block_bytes + 2;
+  r.size = size - 2;
+  r.pos = 0;
+  r.buffer = 0;
+  r.num_bits = 0;
+  r.bits_consumed = 0;
+
+  int c;
+  for (c = 0; c < num_channels; ++c) {
+    int32_t* x = reader->block_samples + c;
+    const int order = 1 + ReadBits(&r, 1);
+    const int k = ReadBits(&r, 5);
+    int i;
+    for (i = 0; i < num_frames; ++i) {
+      const int q = ReadQuotient(&r);
+      uint32_t u;
+      if (q < kEscapeQuotient) {
+        u = ((uint32_t)q << k) | ((k > 0) ? ReadBits(&r, k) : 0);
+      } else {
+        u = ReadBits(&r, kEscapeBits);
+      }
+      const int32_t residual = (u & 1) ? -(int32_t)((u + 1) / 2)
+                                       : (int32_t)(u / 2);
+      const int32_t value = Predict(x, num_channels, i, order) + residual;
+      if (!(-max_abs <= value && value < max_abs)) { goto fail; }
+      x[i * num_channels] = value;
+    }
+    if (r.bits_consumed > 8 * r.size) { goto fail; }  /* Read past the end. */
+  }
+
+  reader->current_block = b;
+  reader->block_num_frames = num_frames;
+  reader->position = 0;
+  return 1;
+
+fail:
+  fprintf(stderr, "Error: Tactile recording block %u is corrupt.\n",
+          (unsigned)b);
+  /* Make the error sticky, as if at the end, so that a read loop stops
+   * rather than restarting from the first block. Seeking clears this.
+   */
+  reader->current_block = reader->num_blocks;
+  reader->block_num_frames = 0;
+  reader->position = 0;
+  return 0;
+}
+
+TactileRecordingReader* TactileRecordingReaderOpen(const char* filename) {
+  TactileRecordingReader* reader =
+      (TactileRecordingReader*)malloc(sizeof(TactileRecordingReader));
+  if (reader == NULL) { return NULL; }
+  reader->block_offsets = NULL;
+  reader->block_bytes = NULL;
+  reader->block_samples = NULL;
+  reader->current_block = -1;
+  reader->block_num_frames = 0;
+  reader->position = 0;
+
+  reader->f = fopen(filename, "rb");
+  if (reader->f == NULL) {
+    fprintf(stderr, "Error: Failed to open \"%s\".\n", filename);
+    free(reader);
+    return NULL;
+  }
+
+  uint8_t header[kHeaderSize];
+  if (fread(header, 1, kHeaderSize, reader->f) != kHeaderSize ||
+      memcmp(header, kMagic, 4) != 0) {
+    fprintf(stderr, "Error: \"%s\" is not a tactile recording.\n", filename);
+    goto fail;
+  } else if (header[4] != kVersion) {
+    fprintf(stderr, "Error: Unsupported tactile recording version %d.\n",
+            header[4]);
+    goto fail;
+  }
+  reader->num_channels = header[5];
+  reader->quantization_bits = header[6];
+  reader->sample_rate_hz = LittleEndianReadF32(header + 8);
+  reader->decimation_factor = LittleEndianReadU16(header + 12);
+  reader->block_frames = LittleEndianReadU16(header + 14);
+  const uint64_t num_frames = LittleEndianReadU64(header + 16);
+  const uint64_t index_offset = LittleEndianReadU64(header + 24);
+  reader->num_blocks = LittleEndianReadU32(header + 32);
+  reader->num_frames = (size_t)num_frames;
+
+  if (!(1 <= reader->num_channels &&
+        reader->num_channels <= kTactileRecordingMaxChannels) ||
+      !(4 <= reader->quantization_bits && reader->quantization_bits <= 16) ||
+      !(reader->sample_rate_hz > 0.0f) || reader->decimation_factor < 1 ||
+      reader->block_frames < 1 ||
+      num_frames > (uint64_t)reader->num_blocks * reader->block_frames ||
+      (reader->num_blocks > 0 && num_frames <=
+       (uint64_t)(reader->num_blocks - 1) * reader->block_frames) ||
+      index_offset < kHeaderSize || index_offset > LONG_MAX) {
+    fprintf(stderr, "Error: \"%s\" has an invalid header.\n", filename);
+    goto fail;
+  }
+
+  reader->block_offsets = (uint64_t*)malloc(
+      sizeof(uint64_t) * ((size_t)reader->num_blocks + 1));
+  reader->block_bytes = (uint8_t*)malloc(
+      MaxBlockBytes(reader->block_frames, reader->num_channels));
+  reader->block_samples = (int32_t*)malloc(
+      sizeof(int32_t) * reader->block_frames * reader->num_channels);
+  if (reader->block_offsets == NULL || reader->block_bytes == NULL ||
+      reader->block_samples == NULL) {
+    fprintf(stderr, "Error: Out of memory.\n");
+    goto fail;
+  }
+
+  /* Read the index. Offsets must be increasing and before the index. */
+  if (fseek(reader->f, (long)index_offset, SEEK_SET) != 0) { goto fail; }
+  uint64_t previous = kHeaderSize;
+  uint32_t b;
+  for (b = 0; b < reader->num_blocks; ++b) {
+    uint8_t bytes[8];
+    if (fread(bytes, 1, 8, reader->f) != 8) {
+      fprintf(stderr, "Error: \"%s\" is truncated.\n", filename);
+      goto fail;
+    }
+    reader->block_offsets[b] = LittleEndianReadU64(bytes);
+    if (reader->block_offsets[b] < previous) {
+      fprintf(stderr, "Error: \"%s\" has an invalid index.\n", filename);
+      goto fail;
+    }
+    previous = reader->block_offsets[b];
+  }
+  if (index_offset < previous) {
+    fprintf(stderr, "Error: \"%s\" has an invalid index.\n", filename);
+    goto fail;
+  }
+  reader->block_offsets[reader->num_blocks] = index_offset;
+  return reader;
+
+fail:
+  TactileRecordingReaderClose(reader);
+  return NULL;
+}
+
+void TactileRecordingReaderClose(TactileRecordingReader* reader) {
+  if (reader == NULL) { return; }
+  fclose(reader->f);
+  free(reader->block_samples);
+  free(reader->block_bytes);
+  free(reader->block_offsets);
+  free(reader);
+}
+
+int TactileRecordingReaderSeek(TactileRecordingReader* reader, size_t frame) {
+  if (frame > reader->num_frames) { return 0; }
+  const uint32_t b = (uint32_t)(frame / reader->block_frames);
+  if (b >= reader->num_blocks) {  /* Seeking to the end. */
+    reader->current_block = reader->num_blocks;
+    reader->block_num_frames = 0;
+    reader->position = 0;
+    return 1;
+  }
+  if (reader->current_block != (long)b && !DecodeBlock(reader, b)) {
+    return 0;
+  }
+  reader->position = (int)(frame % reader->block_frames);
+  return 1;
+}
+
+int TactileRecordingReaderRead(TactileRecordingReader* reader,
+                               float* samples,
+                               int num_frames) {
+  const int num_channels = reader->num_channels;
+  const float scale = 1.0f / (1 << (reader->quantization_bits - 1));
+  int num_read = 0;
+  while (num_read < num_frames) {
+    if (reader->position >= reader->block_num_frames) {
+      const long next_block = reader->current_block + 1;
+      if (next_block >= (long)reader->num_blocks ||
+          !DecodeBlock(reader, (uint32_t)next_block)) {
+        break;
+      }
+    }
+    int n = reader->block_num_frames - reader->position;
+    if (n > num_frames - num_read) { n = num_frames - num_read; }
+    const int32_t* src =
+        reader->block_samples + reader->position * num_channels;
+    const int num_samples = n * num_channels;
+    int i;
+    for (i = 0; i < num_samples; ++i) {
+      samples[i] = scale * src[i];
+    }
+    samples += num_samples;
+    reader->position += n;
+    num_read += n;
+  }
+  return num_read;
+}
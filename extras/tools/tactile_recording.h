@@ -0,0 +1,187 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Compact seekable container for recorded tactile signals.
+ *
+ * Rendered tactile signals, e.g. 10-channel TactileProcessor output at 16 kHz,
+ * are band limited below 500 Hz and bounded in [-1, 1], so float WAV stores
+ * them wastefully. A tactile recording instead:
+ *
+ *  1. Decimates each channel by an integer factor with QResampler, e.g. by 8 to
+ *     2 kHz. Decimation is zero phase, so that stored frame k corresponds to
+ *     input frame k * decimation_factor.
+ *
+ *  2. Quantizes uniformly to `quantization_bits` bits over [-1, 1].
+ *
+ *  3. Splits the stream into blocks of `block_frames` stored frames. Within a
+ *     block, each channel is predicted with a first- or second-order fixed
+ *     predictor (whichever fits better) and the residuals are Rice coded with a
+ *     parameter chosen per channel per block. Blocks are coded independently.
+ *
+ *  4. Appends an index with the byte offset of every block, so that seeking to
+ *     any frame costs one fseek and decoding one block.
+ *
+ * Decoding is lossless with respect to the quantized decimated signal. For a
+ * signal band limited below the decimated Nyquist frequency, the error is about
+ * half the quantization step plus the resampler's passband ripple.
+ *
+ * File layout, all little endian:
+ *
+ *   Offset  Size  Field
+ *   0       4     Magic "TREC".
+ *   4       1     Format version, currently 1.
+ *   5       1     num_channels.
+ *   6       1     quantization_bits.
+ *   7       1     Reserved, 0.
+ *   8       4     Stored sample rate in Hz, float32.
+ *   12      2     decimation_factor.
+ *   14      2     block_frames.
+ *   16      8     num_frames, number of stored frames.
+ *   24      8     Byte offset of the index.
+ *   32      4     num_blocks.
+ *   36      4     Reserved, 0.
+ *   40            Blocks, each a uint16 number of frames then the bitstream.
+ *   (index)       num_blocks uint64 byte offsets of the blocks.
+ *
+ * Example:
+ *
+ *   TactileRecordingParams params;
+ *   TactileRecordingSetDefaultParams(&params);
+ *   params.num_channels = 10;
+ *   params.input_sample_rate_hz = 16000.0f;
+ *   TactileRecordingWriter* writer =
+ *       TactileRecordingWriterOpen("out.trec", &params);
+ *   while (...) {
+ *     TactileRecordingWriterWrite(writer, tactile_output, block_size);
+ *   }
+ *   TactileRecordingWriterClose(writer);
+ *
+ *   TactileRecordingReader* reader = TactileRecordingReaderOpen("out.trec");
+ *   TactileRecordingReaderSeek(reader, 2 * reader->sample_rate_hz);
+ *   TactileRecordingReaderRead(reader, samples, num_frames);
+ *   TactileRecordingReaderClose(reader);
+ */
+
+#ifndef AUDIO_TO_TACTILE_EXTRAS_TOOLS_TACTILE_RECORDING_H_
+#define AUDIO_TO_TACTILE_EXTRAS_TOOLS_TACTILE_RECORDING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max supported number of channels. */
+#define kTactileRecordingMaxChannels 32
+
+typedef struct {
+  /* Number of channels. */
+  int num_channels;
+  /* Sample rate of the samples passed to TactileRecordingWriterWrite(). */
+  float input_sample_rate_hz;
+  /* Integer decimation factor. The stored sample rate is
+   * input_sample_rate_hz / decimation_factor, whose Nyquist frequency should
+   * be above the signal bandwidth. Use 1 for no decimation.
+   */
+  int decimation_factor;
+  /* Bits per quantized sample, between 4 and 16. */
+  int quantization_bits;
+  /* Number of stored frames per block. Seeking decodes one block. */
+  int block_frames;
+} TactileRecordingParams;
+
+/* Sets `params` to defaults: decimation by 8 (16 kHz -> 2 kHz), 12-bit
+ * quantization, and 256-frame blocks. num_channels and input_sample_rate_hz
+ * are set to 10 and 16000 and should usually be overridden.
+ */
+void TactileRecordingSetDefaultParams(TactileRecordingParams* params);
+
+struct TactileRecordingWriter;
+typedef struct TactileRecordingWriter TactileRecordingWriter;
+
+/* Opens `filename` for writing. Returns NULL on failure. The caller should
+ * close it with TactileRecordingWriterClose().
+ */
+TactileRecordingWriter* TactileRecordingWriterOpen(
+    const char* filename, const TactileRecordingParams* params);
+
+/* Writes `num_frames` frames of interleaved samples at the input sample rate.
+ * Returns 1 on success, 0 on I/O error.
+ */
+int TactileRecordingWriterWrite(TactileRecordingWriter* writer,
+                                const float* samples,
+                                int num_frames);
+
+/* Flushes the decimation filter, writes the last block and the index, closes
+ * the file, and frees the writer. Returns 1 if the whole file was written
+ * successfully, 0 otherwise.
+ */
+int TactileRecordingWriterClose(TactileRecordingWriter* writer);
+
+typedef struct {
+  /* Number of channels. */
+  int num_channels;
+  /* Stored sample rate in Hz, the rate of samples returned by Read. */
+  float sample_rate_hz;
+  /* Decimation factor relative to the originally recorded sample rate. */
+  int decimation_factor;
+  /* Bits per quantized sample. */
+  int quantization_bits;
+  /* Total number of stored frames. */
+  size_t num_frames;
+
+  /* Private fields. */
+  FILE* f;
+  int block_frames;
+  uint32_t num_blocks;
+  uint64_t* block_offsets;  /* num_blocks + 1 offsets, the last is the index. */
+  uint8_t* block_bytes;
+  int32_t* block_samples;
+  int block_num_frames;  /* Frames in the decoded block. */
+  /* Index of the decoded block, -1 before the first block, or num_blocks at
+   * the end or after a corrupt block.
+   */
+  long current_block;
+  int position;  /* Read position within the decoded block. */
+} TactileRecordingReader;
+
+/* Opens a tactile recording and reads its index. Returns NULL on failure. The
+ * caller should close it with TactileRecordingReaderClose().
+ */
+TactileRecordingReader* TactileRecordingReaderOpen(const char* filename);
+
+/* Closes the file and frees the reader. */
+void TactileRecordingReaderClose(TactileRecordingReader* reader);
+
+/* Seeks to stored frame `frame`, so that the next read starts there. Returns 1
+ * on success, 0 if `frame` is past the end or the file is corrupt.
+ */
+int TactileRecordingReaderSeek(TactileRecordingReader* reader, size_t frame);
+
+/* Reads up to `num_frames` interleaved frames at the stored sample rate into
+ * `samples`, in [-1, 1]. Returns the number of frames read, less than
+ * `num_frames` at the end of the recording or if the file is corrupt. After
+ * reaching a corrupt block, Read returns 0 until a successful Seek.
+ */
+int TactileRecordingReaderRead(TactileRecordingReader* reader,
+                               float* samples,
+                               int num_frames);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+#endif /* AUDIO_TO_TACTILE_EXTRAS_TOOLS_TACTILE_RECORDING_H_ */
@@ -0,0 +1,334 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "extras/tools/tactile_recording.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/dsp/logging.h"
+#include "src/dsp/math_constants.h"
+#include "src/dsp/serialize.h"
+
+static float RandUniform(void) { return (float)rand() / RAND_MAX; }
+
+/* Writes `samples` as a tactile recording, in chunks of random size. */
+static void WriteRecording(const char* filename,
+                           const TactileRecordingParams* params,
+                           const float* samples, int num_frames) {
+  TactileRecordingWriter* writer =
+      CHECK_NOTNULL(TactileRecordingWriterOpen(filename, params));
+  int start = 0;
+  while (start < num_frames) {
+    int chunk_frames = 1 + rand() % 700;
+    if (chunk_frames > num_frames - start) {
+      chunk_frames = num_frames - start;
+    }
+    CHECK(TactileRecordingWriterWrite(
+        writer, samples + start * params->num_channels, chunk_frames));
+    start += chunk_frames;
+  }
+  CHECK(TactileRecordingWriterClose(writer));
+}
+
+/* Reads the whole recording in chunks of `chunk_frames`. */
+static float* ReadRecording(TactileRecordingReader* reader, int chunk_frames) {
+  const size_t num_samples = reader->num_frames * reader->num_channels;
+  float* samples = (float*)CHECK_NOTNULL(malloc(sizeof(float) * num_samples));
+  CHECK(TactileRecordingReaderSeek(reader, 0));
+  size_t start = 0;
+  while (start < reader->num_frames) {
+    const size_t expected = (start + chunk_frames <= reader->num_frames)
+        ? (size_t)chunk_frames : reader->num_frames - start;
+    CHECK(TactileRecordingReaderRead(
+              reader, samples + start * reader->num_channels, chunk_frames)
+          == (int)expected);
+    start += expected;
+  }
+  CHECK(TactileRecordingReaderRead(reader, samples, 1) == 0);
+  return samples;
+}
+
+/* Without decimation, decoding reproduces the quantized input exactly, so the
+ * error is at most half a quantization step.
+ */
+static void TestRoundTripWithoutDecimation(int quantization_bits) {
+  printf("TestRoundTripWithoutDecimation(%d)\n", quantization_bits);
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  TactileRecordingParams params;
+  TactileRecordingSetDefaultParams(&params);
+  params.num_channels = 3;
+  params.decimation_factor = 1;
+  params.quantization_bits = quantization_bits;
+  params.block_frames = 100;
+  const int kNumFrames = 1234;
+  const int num_samples = kNumFrames * params.num_channels;
+  float* input = (float*)CHECK_NOTNULL(malloc(sizeof(float) * num_samples));
+  int i;
+  for (i = 0; i < kNumFrames; ++i) {
+    /* Channel 0 is smooth, channel 1 is noise, and channel 2 is a ramp. */
+    input[3 * i] = 0.8f * sin(2.0 * M_PI * 0.01 * i);
+    input[3 * i + 1] = 2.0f * RandUniform() - 1.0f;
+    input[3 * i + 2] = -1.0f + 2.0f * i / kNumFrames;
+  }
+  input[1] = 1.0f;  /* Extremes are clamped into range. */
+  input[4] = -1.0f;
+  input[7] = 5.0f;
+  WriteRecording(filename, &params, input, kNumFrames);
+
+  TactileRecordingReader* reader =
+      CHECK_NOTNULL(TactileRecordingReaderOpen(filename));
+  CHECK(reader->num_channels == 3);
+  CHECK(reader->quantization_bits == quantization_bits);
+  CHECK(reader->decimation_factor == 1);
+  CHECK(fabs(reader->sample_rate_hz - params.input_sample_rate_hz) < 1e-3f);
+  CHECK(reader->num_frames == (size_t)kNumFrames);
+
+  float* output = ReadRecording(reader, 77);
+  const float step = 1.0f / (1 << (quantization_bits - 1));
+  for (i = 0; i < num_samples; ++i) {
+    float expected = input[i];
+    if (expected > 1.0f - step) { expected = 1.0f - step; }
+    CHECK(fabs(output[i] - expected) <= 0.5f * step + 1e-6f);
+  }
+
+  free(output);
+  TactileRecordingReaderClose(reader);
+  free(input);
+  remove(filename);
+}
+
+/* With decimation, a signal band limited below the stored Nyquist frequency is
+ * recovered at the stored sample times within a small error bound.
+ */
+static void TestRoundTripWithDecimation(void) {
+  puts("TestRoundTripWithDecimation");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  TactileRecordingParams params;
+  TactileRecordingSetDefaultParams(&params);
+  params.num_channels = 12;
+  params.input_sample_rate_hz = 16000.0f;
+  params.decimation_factor = 8;
+  params.quantization_bits = 12;
+  const int kNumChannels = 12;
+  const int kNumFrames = 16000 * 2 + 5;
+  float* input = (float*)CHECK_NOTNULL(
+      malloc(sizeof(float) * kNumFrames * kNumChannels));
+  int i;
+  int c;
+  for (i = 0; i < kNumFrames; ++i) {
+    const double t = i / 16000.0;
+    for (c = 0; c < kNumChannels; ++c) {
+      input[i * kNumChannels + c] = (float)(
+          0.5 * sin(2.0 * M_PI * (20.0 + 30.0 * c) * t + c) +
+          0.3 * sin(2.0 * M_PI * 250.0 * t) * (c % 2 ? 1 : -1));
+    }
+  }
+  WriteRecording(filename, &params, input, kNumFrames);
+
+  TactileRecordingReader* reader =
+      CHECK_NOTNULL(TactileRecordingReaderOpen(filename));
+  CHECK(reader->num_channels == kNumChannels);
+  CHECK(reader->decimation_factor == 8);
+  CHECK(fabs(reader->sample_rate_hz - 2000.0f) < 1e-3f);
+  CHECK(reader->num_frames == (size_t)(kNumFrames + 7) / 8);
+
+  float* output = ReadRecording(reader, 256);
+  /* Away from the ends, where the filter sees zero padding, the error is
+   * bounded by the quantization step plus the resampler's passband error.
+   */
+  const int kMargin = 20;
+  float max_error = 0.0f;
+  size_t k;
+  for (k = kMargin; k + kMargin < reader->num_frames; ++k) {
+    for (c = 0; c < kNumChannels; ++c) {
+      const float error = fabs(output[k * kNumChannels + c] -
+                               input[8 * k * kNumChannels + c]);
+      if (error > max_error) { max_error = error; }
+    }
+  }
+  CHECK(max_error < 5e-3f);
+
+  /* The recording is much smaller than the input as 16-bit PCM. */
+  FILE* f = CHECK_NOTNULL(fopen(filename, "rb"));
+  CHECK(fseek(f, 0, SEEK_END) == 0);
+  const long file_size = ftell(f);
+  fclose(f);
+  CHECK(file_size < 2L * kNumFrames * kNumChannels / 8);
+
+  free(output);
+  TactileRecordingReaderClose(reader);
+  free(input);
+  remove(filename);
+}
+
+/* Seeking to random frames gives the same samples as reading sequentially. */
+static void TestSeek(void) {
+  puts("TestSeek");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  TactileRecordingParams params;
+  TactileRecordingSetDefaultParams(&params);
+  params.num_channels = 2;
+  params.decimation_factor = 1;
+  params.block_frames = 64;
+  const int kNumFrames = 1000;
+  float* input = (float*)CHECK_NOTNULL(malloc(sizeof(float) * 2 * kNumFrames));
+  int i;
+  for (i = 0; i < 2 * kNumFrames; ++i) {
+    input[i] = 0.5f * sin(0.05 * i) + 0.1f * RandUniform();
+  }
+  WriteRecording(filename, &params, input, kNumFrames);
+
+  TactileRecordingReader* reader =
+      CHECK_NOTNULL(TactileRecordingReaderOpen(filename));
+  float* expected = ReadRecording(reader, kNumFrames);
+  float samples[2 * 50];
+  int trial;
+  for (trial = 0; trial < 200; ++trial) {
+    const int frame = rand() % (kNumFrames + 1);
+    const int num_frames = 1 + rand() % 50;
+    const int expected_frames = (frame + num_frames <= kNumFrames)
+        ? num_frames : kNumFrames - frame;
+    CHECK(TactileRecordingReaderSeek(reader, frame));
+    CHECK(TactileRecordingReaderRead(reader, samples, num_frames)
+          == expected_frames);
+    CHECK(memcmp(samples, expected + 2 * frame,
+                 sizeof(float) * 2 * expected_frames) == 0);
+  }
+  /* Seeking past the end fails. */
+  CHECK(!TactileRecordingReaderSeek(reader, kNumFrames + 1));
+
+  free(expected);
+  TactileRecordingReaderClose(reader);
+  free(input);
+  remove(filename);
+}
+
+static void TestEmpty(void) {
+  puts("TestEmpty");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  TactileRecordingParams params;
+  TactileRecordingSetDefaultParams(&params);
+  TactileRecordingWriter* writer =
+      CHECK_NOTNULL(TactileRecordingWriterOpen(filename, &params));
+  CHECK(TactileRecordingWriterClose(writer));
+
+  TactileRecordingReader* reader =
+      CHECK_NOTNULL(TactileRecordingReaderOpen(filename));
+  CHECK(reader->num_frames == 0);
+  float sample;
+  CHECK(TactileRecordingReaderRead(reader, &sample, 1) == 0);
+  TactileRecordingReaderClose(reader);
+  remove(filename);
+}
+
+static void TestInvalidAndCorrupt(void) {
+  puts("TestInvalidAndCorrupt");
+  const char* filename = CHECK_NOTNULL(tmpnam(NULL));
+  TactileRecordingParams params;
+  TactileRecordingSetDefaultParams(&params);
+  params.quantization_bits = 17;
+  CHECK(TactileRecordingWriterOpen(filename, &params) == NULL);
+  TactileRecordingSetDefaultParams(&params);
+  params.num_channels = 0;
+  CHECK(TactileRecordingWriterOpen(filename, &params) == NULL);
+
+  /* A file that isn't a tactile recording fails to open. */
+  FILE* f = CHECK_NOTNULL(fopen(filename, "wb"));
+  CHECK(fwrite("not a recording", 1, 15, f) == 15);
+  CHECK(fclose(f) == 0);
+  CHECK(TactileRecordingReaderOpen(filename) == NULL);
+
+  /* Write a valid recording, then corrupt a block's bitstream. */
+  TactileRecordingSetDefaultParams(&params);
+  params.num_channels = 1;
+  params.decimation_factor = 1;
+  params.block_frames = 32;
+  float input[100];
+  int i;
+  for (i = 0; i < 100; ++i) {
+    input[i] = 0.9f * sin(0.3 * i);
+  }
+  WriteRecording(filename, &params, input, 100);
+
+  f = CHECK_NOTNULL(fopen(filename, "r+b"));
+  CHECK(fseek(f, 43, SEEK_SET) == 0);  /* Inside the first block. */
+  const uint8_t kGarbage[4] = {0xff, 0xff, 0xff, 0xff};
+  CHECK(fwrite(kGarbage, 1, 4, f) == 4);
+  CHECK(fclose(f) == 0);
+  TactileRecordingReader* reader =
+      CHECK_NOTNULL(TactileRecordingReaderOpen(filename));
+  float output[100];
+  CHECK(TactileRecordingReaderRead(reader, output, 100) == 0);
+  /* Other blocks are still readable. */
+  CHECK(TactileRecordingReaderSeek(reader, 40));
+  CHECK(TactileRecordingReaderRead(reader, output, 60) == 60);
+  TactileRecordingReaderClose(reader);
+
+  /* Corrupt a middle block. A read loop stops at the corrupt block rather
+   * than starting over from the first block.
+   */
+  WriteRecording(filename, &params, input, 100);
+  reader = CHECK_NOTNULL(TactileRecordingReaderOpen(filename));
+  const long block1_offset = (long)reader->block_offsets[1];
+  TactileRecordingReaderClose(reader);
+  f = CHECK_NOTNULL(fopen(filename, "r+b"));
+  CHECK(fseek(f, block1_offset + 3, SEEK_SET) == 0);
+  CHECK(fwrite(kGarbage, 1, 4, f) == 4);
+  CHECK(fclose(f) == 0);
+  reader = CHECK_NOTNULL(TactileRecordingReaderOpen(filename));
+  int total_read = 0;
+  int num_calls = 0;
+  int n;
+  while ((n = TactileRecordingReaderRead(reader, output, 10)) > 0) {
+    total_read += n;
+    CHECK(++num_calls <= 10);
+  }
+  CHECK(total_read == 32);  /* Only the first block. */
+  CHECK(TactileRecordingReaderRead(reader, output, 10) == 0);
+  /* Seeking past the corrupt block resumes reading. */
+  CHECK(TactileRecordingReaderSeek(reader, 64));
+  CHECK(TactileRecordingReaderRead(reader, output, 100) == 36);
+  TactileRecordingReaderClose(reader);
+
+  /* Truncating the index fails to open. */
+  f = CHECK_NOTNULL(fopen(filename, "r+b"));
+  uint8_t header[40];
+  CHECK(fread(header, 1, 40, f) == 40);
+  LittleEndianWriteU32(1000, header + 32);
+  CHECK(fseek(f, 0, SEEK_SET) == 0);
+  CHECK(fwrite(header, 1, 40, f) == 40);
+  CHECK(fclose(f) == 0);
+  CHECK(TactileRecordingReaderOpen(filename) == NULL);
+
+  remove(filename);
+  CHECK(TactileRecordingReaderOpen(filename) == NULL);
+}
+
+int main(int argc, char** argv) {
+  srand(0);
+  TestRoundTripWithoutDecimation(4);
+  TestRoundTripWithoutDecimation(12);
+  TestRoundTripWithoutDecimation(16);
+  TestRoundTripWithDecimation();
+  TestSeek();
+  TestEmpty();
+  TestInvalidAndCorrupt();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
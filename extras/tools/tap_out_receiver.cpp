@@ -0,0 +1,306 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extras/tools/tap_out_receiver.h"
+
+#include <ctype.h>
+#include <string.h>
+
+namespace audio_tactile {
+namespace {
+
+// Size of stdio buffer for each output file.
+constexpr int kFileBufferSize = 1 << 16;
+// Size of each descriptor in the "Descriptors" message.
+constexpr int kBytesPerDescriptor = 1 + 15 + 1 + kTapOutMaxDims;
+
+// Decodes delta coded data as described in tap_out.h to `num_items` little
+// endian integers of `item_size` bytes. Returns the number of bytes consumed,
+// or -1 if the data is invalid.
+int DeltaDecode(const uint8_t* src, int src_size, int item_size,
+                int num_items, uint8_t* dest) {
+  const uint32_t mask =
+      (item_size == 4) ? 0xffffffffu : (uint32_t(1) << (8 * item_size)) - 1;
+  uint32_t prev = 0;
+  int pos = 0;
+  for (int i = 0; i < num_items; ++i) {
+    uint32_t code = 0;
+    for (int shift = 0;; shift += 7) {
+      if (pos >= src_size || shift > 28) { return -1; }
+      const uint8_t byte = src[pos++];
+      code |= uint32_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) { break; }
+    }
+    const uint32_t delta = (code >> 1) ^ (0u - (code & 1));  // Undo zigzag.
+    prev = (prev + delta) & mask;
+    for (int b = 0; b < item_size; ++b) {
+      *dest++ = static_cast<uint8_t>(prev >> (8 * b));
+    }
+  }
+  return pos;
+}
+
+// Makes a file name for output `name`.
+std::string OutputFilename(const std::string& path_prefix,
+                           const std::string& name) {
+  std::string filename = path_prefix;
+  for (char c : name) {
+    filename += isalnum(static_cast<unsigned char>(c)) ? c : '_';
+  }
+  return filename + ".raw";
+}
+
+}  // namespace
+
+TapOutReceiver::TapOutReceiver(Transport* transport)
+    : transport_(transport),
+      has_descriptors_(false),
+      compression_flags_(0),
+      capturing_(false),
+      next_sequence_(0),
+      last_heartbeat_sequence_(0),
+      stats_{0, 0, 0, 0, 0, 0} {}
+
+TapOutReceiver::~TapOutReceiver() { StopCapture(); }
+
+bool TapOutReceiver::Send(const uint8_t* data, int size) {
+  return transport_->Write(data, size) == size;
+}
+
+bool TapOutReceiver::RequestDescriptors() {
+  const uint8_t message[3] = {kTapOutMarker, kTapOutMessageGetDescriptors, 0};
+  return Send(message, sizeof(message));
+}
+
+bool TapOutReceiver::SendHeartbeat() {
+  const uint8_t message[3] = {kTapOutMarker, kTapOutMessageHeartbeat, 0};
+  return Send(message, sizeof(message));
+}
+
+const TapOutReceiver::Output* TapOutReceiver::FindOutput(
+    const std::string& name) const {
+  for (const Output& output : outputs_) {
+    if (output.name == name) { return &output; }
+  }
+  return nullptr;
+}
+
+bool TapOutReceiver::StartCapture(const std::vector<std::string>& names,
+                                  int compression_flags,
+                                  const std::string& path_prefix) {
+  StopCapture();
+  if (names.empty() || names.size() > kTapOutMaxOutputs) { return false; }
+
+  uint8_t message[3 + 1 + kTapOutMaxOutputs];
+  message[0] = kTapOutMarker;
+  message[1] = kTapOutMessageStartSequencedCapture;
+  message[2] = static_cast<uint8_t>(1 + names.size());
+  message[3] = static_cast<uint8_t>(compression_flags);
+
+  for (int i = 0; i < static_cast<int>(names.size()); ++i) {
+    const Output* output = FindOutput(names[i]);
+    if (output == nullptr || output->num_bytes <= 0) {
+      fprintf(stderr, "Error: Invalid output \"%s\".\n", names[i].c_str());
+      StopCapture();
+      return false;
+    }
+    message[4 + i] = output->token;
+
+    const std::string filename = OutputFilename(path_prefix, output->name);
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+      fprintf(stderr, "Error: Failed to open \"%s\".\n", filename.c_str());
+      StopCapture();
+      return false;
+    }
+    setvbuf(file, nullptr, _IOFBF, kFileBufferSize);
+    files_.push_back({output, file});
+  }
+
+  compression_flags_ = compression_flags;
+  next_sequence_ = 0;  // The device starts sequence numbers from zero.
+  last_heartbeat_sequence_ = 0;
+  capturing_ = true;
+  return Send(message, 3 + message[2]);
+}
+
+void TapOutReceiver::StopCapture() {
+  for (const CaptureFile& capture_file : files_) {
+    fclose(capture_file.file);
+  }
+  files_.clear();
+  capturing_ = false;
+}
+
+int TapOutReceiver::Poll() {
+  uint8_t buffer[1024];
+  int size;
+  while ((size = transport_->Read(buffer, sizeof(buffer))) > 0) {
+    rx_.insert(rx_.end(), buffer, buffer + size);
+  }
+
+  int num_handled = 0;
+  int start = 0;
+  const int end = static_cast<int>(rx_.size());
+  while (start < end) {
+    if (rx_[start] != kTapOutMarker) {  // Skip to the next marker.
+      ++start;
+      ++stats_.bytes_skipped;
+      continue;
+    }
+    if (end - start < 3) { break; }
+    const int payload_size = rx_[start + 2];
+    if (end - start < 3 + payload_size) { break; }  // Wait for more bytes.
+
+    if (HandleMessage(rx_[start + 1], rx_.data() + start + 3, payload_size)) {
+      start += 3 + payload_size;
+      ++num_handled;
+    } else {
+      // Not a valid message. Skip the marker and resync on the next one.
+      ++start;
+      ++stats_.bytes_skipped;
+    }
+  }
+
+  rx_.erase(rx_.begin(), rx_.begin() + start);
+  return num_handled;
+}
+
+bool TapOutReceiver::HandleMessage(int op, const uint8_t* payload,
+                                   int payload_size) {
+  switch (op) {
+    case kTapOutMessageDescriptors:
+      return HandleDescriptors(payload, payload_size);
+    case kTapOutMessageSequencedCapture:
+      return HandleCapture(payload, payload_size);
+    default:
+      return false;
+  }
+}
+
+bool TapOutReceiver::HandleDescriptors(const uint8_t* payload,
+                                       int payload_size) {
+  // Payload is a 4-byte datestamp, the number of descriptors, and descriptors.
+  if (payload_size < 5) { return false; }
+  const int num_descriptors = payload[4];
+  if (payload_size != 5 + num_descriptors * kBytesPerDescriptor) {
+    return false;
+  }
+
+  StopCapture();  // Files refer to the old outputs.
+  outputs_.clear();
+  const uint8_t* src = payload + 5;
+  for (int i = 0; i < num_descriptors; ++i, src += kBytesPerDescriptor) {
+    Output output;
+    output.token = src[0];
+    const char* name = reinterpret_cast<const char*>(src + 1);
+    output.name.assign(name, strnlen(name, 15));
+    output.dtype = src[16];
+    output.item_size = TapOutDTypeItemSize(output.dtype);
+    output.num_dims = 0;
+    output.num_bytes = output.item_size;
+    for (int j = 0; j < kTapOutMaxDims; ++j) {
+      output.shape[j] = src[17 + j];
+      if (output.shape[j] > 0) {
+        output.num_dims = j + 1;
+        output.num_bytes *= output.shape[j];
+      }
+    }
+    outputs_.push_back(output);
+  }
+  has_descriptors_ = true;
+  return true;
+}
+
+bool TapOutReceiver::HandleCapture(const uint8_t* payload, int payload_size) {
+  if (!capturing_) { return true; }  // Ignore a capture we didn't ask for.
+  if (payload_size < kTapOutSequencedHeaderSize) { return false; }
+  const uint16_t sequence = payload[0] | payload[1] << 8;
+  const int device_dropped = payload[2] | payload[3] << 8;
+
+  // Decode all outputs before writing anything, so that a corrupted message is
+  // rejected as a whole.
+  decoded_.clear();
+  const uint8_t* src = payload + kTapOutSequencedHeaderSize;
+  const uint8_t* src_end = payload + payload_size;
+  for (int i = 0; i < static_cast<int>(files_.size()); ++i) {
+    const Output& output = *files_[i].output;
+    const int offset = static_cast<int>(decoded_.size());
+    decoded_.resize(offset + output.num_bytes);
+
+    int encoding = kTapOutEncodingRaw;
+    if (compression_flags_ & (1 << i)) {
+      if (src >= src_end) { return false; }
+      encoding = *src++;
+    }
+
+    if (encoding == kTapOutEncodingRaw) {
+      if (src_end - src < output.num_bytes) { return false; }
+      memcpy(decoded_.data() + offset, src, output.num_bytes);
+      src += output.num_bytes;
+    } else if (encoding == kTapOutEncodingDelta && output.item_size <= 4) {
+      const int consumed = DeltaDecode(
+          src, static_cast<int>(src_end - src), output.item_size,
+          output.num_bytes / output.item_size, decoded_.data() + offset);
+      if (consumed < 0) { return false; }
+      src += consumed;
+    } else {
+      return false;
+    }
+  }
+  if (src != src_end) { return false; }
+
+  // A gap of 2^15 or more means the sequence number is behind the expected one,
+  // as for a duplicate or stale message, rather than that many buffers lost.
+  const uint16_t gap = sequence - next_sequence_;
+  if (gap >= 0x8000) {
+    ++stats_.out_of_order;
+    return true;
+  }
+  // Fill in buffers missing before this one.
+  stats_.buffers_lost += gap;
+  WriteZeros(gap);
+
+  const uint8_t* data = decoded_.data();
+  for (const CaptureFile& capture_file : files_) {
+    const int num_bytes = capture_file.output->num_bytes;
+    fwrite(data, 1, num_bytes, capture_file.file);
+    data += num_bytes;
+  }
+  stats_.bytes_written += decoded_.size();
+  next_sequence_ = sequence + 1;
+  stats_.device_dropped = device_dropped;
+  ++stats_.captures_received;
+
+  if (static_cast<uint16_t>(next_sequence_ - last_heartbeat_sequence_) >=
+      kBuffersPerHeartbeat) {
+    SendHeartbeat();
+    last_heartbeat_sequence_ = next_sequence_;
+  }
+  return true;
+}
+
+void TapOutReceiver::WriteZeros(int64_t num_buffers) {
+  if (num_buffers <= 0) { return; }
+  static const uint8_t kZeros[kTapOutBufferCapacity] = {0};
+  for (const CaptureFile& capture_file : files_) {
+    const int num_bytes = capture_file.output->num_bytes;
+    for (int64_t i = 0; i < num_buffers; ++i) {
+      fwrite(kZeros, 1, num_bytes, capture_file.file);
+    }
+    stats_.bytes_written += num_buffers * num_bytes;
+  }
+}
+
+}  // namespace audio_tactile
@@ -0,0 +1,163 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Native host-side receiver for TapOut sequenced capture.
+//
+// The Python receiver (extras/python/tactile/tap_out.py) is convenient for
+// interactive use, but may not keep up with high-rate capture. TapOutReceiver
+// reads a TapOut byte stream from a Transport (see serial_link_emulator.h),
+// decodes "Sequenced Capture" messages, and writes each captured output
+// straight to its own file as raw little endian data:
+//
+//   TapOutReceiver receiver(transport);
+//   receiver.RequestDescriptors();
+//   while (!receiver.has_descriptors()) { receiver.Poll(); }
+//   receiver.StartCapture({"mic input", "energy"}, /*compression_flags=*/0x1,
+//                         "/tmp/capture_");
+//   while (recording) {
+//     receiver.Poll();
+//   }
+//   receiver.StopCapture();
+//
+// This writes files "/tmp/capture_mic_input.raw" and "/tmp/capture_energy.raw",
+// which may be loaded e.g. with `numpy.fromfile(filename, dtype)`.
+//
+// Buffers lost in transmission or dropped by the device are detected from
+// gaps in the sequence numbers and written as zeros, so that file position
+// stays proportional to time. A capture whose sequence number is behind the
+// expected one, e.g. a duplicate, is counted as out of order and dropped.
+//
+// Poll() sends a heartbeat every kBuffersPerHeartbeat sequence numbers, which
+// keeps the device capturing. The caller should also call SendHeartbeat()
+// periodically by wall clock, in case no buffers get through.
+
+#ifndef AUDIO_TO_TACTILE_EXTRAS_TOOLS_TAP_OUT_RECEIVER_H_
+#define AUDIO_TO_TACTILE_EXTRAS_TOOLS_TAP_OUT_RECEIVER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "extras/tools/serial_link_emulator.h"
+#include "src/tactile/tap_out.h"
+
+namespace audio_tactile {
+
+class TapOutReceiver {
+ public:
+  enum {
+    // Number of buffers between heartbeats sent by Poll().
+    kBuffersPerHeartbeat = 50,
+  };
+
+  // Output descriptor received from the device.
+  struct Output {
+    TapOutToken token;
+    std::string name;
+    // DType code, as written by TapOutWriteDescriptors().
+    int dtype;
+    int num_dims;
+    int shape[kTapOutMaxDims];
+    // Bytes per item, or 0 if the dtype is unknown.
+    int item_size;
+    // Total bytes of one buffer of this output.
+    int num_bytes;
+  };
+
+  struct Stats {
+    // Number of sequenced captures received.
+    int64_t captures_received;
+    // Number of buffers missing according to sequence numbers.
+    int64_t buffers_lost;
+    // Number of captures dropped because their sequence number was behind the
+    // expected one.
+    int64_t out_of_order;
+    // Dropped count last reported by the device.
+    int device_dropped;
+    // Number of bytes skipped while searching for a valid message.
+    int64_t bytes_skipped;
+    // Number of bytes written to output files.
+    int64_t bytes_written;
+  };
+
+  explicit TapOutReceiver(Transport* transport);
+  ~TapOutReceiver();
+  TapOutReceiver(const TapOutReceiver&) = delete;
+  TapOutReceiver& operator=(const TapOutReceiver&) = delete;
+
+  // Sends a "Get Descriptors" request. Returns false if the transport didn't
+  // accept all bytes.
+  bool RequestDescriptors();
+  // Sends a heartbeat to keep the device capturing.
+  bool SendHeartbeat();
+
+  // Whether descriptors have been received.
+  bool has_descriptors() const { return has_descriptors_; }
+  // Output descriptors received from the device.
+  const std::vector<Output>& outputs() const { return outputs_; }
+  // Finds an output by name, or returns nullptr if not found.
+  const Output* FindOutput(const std::string& name) const;
+
+  // Starts sequenced capture of the named outputs. Bit i of
+  // `compression_flags` requests delta compression of the ith output. Each
+  // output is written to file `path_prefix` + name + ".raw", in which
+  // characters other than letters and digits in the name are replaced with
+  // '_'. Returns false on failure.
+  bool StartCapture(const std::vector<std::string>& names,
+                    int compression_flags, const std::string& path_prefix);
+  // Closes the output files. The device stops once heartbeats stop.
+  void StopCapture();
+
+  // Reads available bytes and handles complete messages. Returns the number of
+  // messages handled.
+  int Poll();
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct CaptureFile {
+    const Output* output;
+    FILE* file;
+  };
+
+  bool Send(const uint8_t* data, int size);
+  // Handles one message, returning false if it is invalid.
+  bool HandleMessage(int op, const uint8_t* payload, int payload_size);
+  bool HandleDescriptors(const uint8_t* payload, int payload_size);
+  bool HandleCapture(const uint8_t* payload, int payload_size);
+  void WriteZeros(int64_t num_buffers);
+
+  Transport* transport_;
+  // Received bytes not yet handled.
+  std::vector<uint8_t> rx_;
+  bool has_descriptors_;
+  std::vector<Output> outputs_;
+
+  std::vector<CaptureFile> files_;
+  int compression_flags_;
+  bool capturing_;
+  // Sequence number expected in the next capture.
+  uint16_t next_sequence_;
+  uint16_t last_heartbeat_sequence_;
+  // Decoded data of one capture, before writing to files.
+  std::vector<uint8_t> decoded_;
+  Stats stats_;
+};
+
+}  // namespace audio_tactile
+
+#endif  // AUDIO_TO_TACTILE_EXTRAS_TOOLS_TAP_OUT_RECEIVER_H_
@@ -0,0 +1,365 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extras/tools/tap_out_receiver.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "src/dsp/logging.h"
+
+// NOLINTBEGIN(readability/check)
+
+namespace audio_tactile {
+
+constexpr int kSamplesPerBuffer = 64;
+constexpr int kNumEnergies = 4;
+// Duration of one buffer at 16 kHz.
+constexpr double kBufferSeconds = kSamplesPerBuffer / 16000.0;
+constexpr double kLatency = 0.0005;
+// Size of the device's transmit FIFO.
+constexpr int kTxFifoSize = 512;
+
+const TapOutDescriptor kMicDescriptor =
+    {"mic input", "int16", 1, {kSamplesPerBuffer}};
+const TapOutDescriptor kEnergyDescriptor =
+    {"energy", "float", 1, {kNumEnergies}};
+
+// The emulated device writes to end a() of this link.
+LoopbackLink* g_link = nullptr;
+double g_bytes_per_second = 0.0;
+// If true, the device sends each sequenced capture message twice.
+bool g_duplicate_captures = false;
+
+void DeviceTx(const char* data, int size) {
+  g_link->a()->Write(reinterpret_cast<const uint8_t*>(data), size);
+  if (g_duplicate_captures && size >= 2 &&
+      static_cast<uint8_t>(data[1]) == kTapOutMessageSequencedCapture) {
+    g_link->a()->Write(reinterpret_cast<const uint8_t*>(data), size);
+  }
+}
+
+// Bytes still sending on the link occupy the transmit FIFO.
+int DeviceTxAvailable() {
+  const double in_flight = std::max(
+      0.0, (g_link->IdleTime() - kLatency - g_link->now()) *
+               g_bytes_per_second);
+  return kTxFifoSize - static_cast<int>(ceil(in_flight));
+}
+
+void DeviceReceive() {
+  uint8_t data[256];
+  const int size = g_link->a()->Read(data, sizeof(data));
+  for (int i = 0; i < size; ++i) {
+    if (data[i] == kTapOutMarker) {
+      TapOutReceiveMessage(reinterpret_cast<const char*>(data) + i, size - i);
+    }
+  }
+}
+
+// Data sent by the device, one buffer after another.
+struct SentData {
+  std::vector<int16_t> mic;
+  std::vector<float> energy;
+};
+
+// Emulates a device capturing `num_buffers` buffers, with the receiver
+// polling after each buffer. If `garbage` is nonempty, it is written to the
+// link every 10 buffers, as if printed by other firmware code.
+void RunDevice(int num_buffers, TapOutReceiver* receiver, SentData* sent,
+               const std::string& garbage = "") {
+  const TapOutToken mic_token = 1;
+  const TapOutToken energy_token = 2;
+  for (int n = 0; n < num_buffers; ++n) {
+    DeviceReceive();
+    CHECK(TapOutIsActive());
+
+    const TapOutSlice* slice = TapOutGetSlice(mic_token);
+    CHECK(slice != nullptr);
+    int16_t mic[kSamplesPerBuffer];
+    for (int i = 0; i < kSamplesPerBuffer; ++i) {
+      // A quiet 250 Hz tone, whose deltas fit in one varint byte.
+      const double t = (n * kSamplesPerBuffer + i) / 16000.0;
+      mic[i] = static_cast<int16_t>(lround(500.0 * sin(2 * M_PI * 250.0 * t)));
+    }
+    memcpy(slice->data, mic, sizeof(mic));
+    sent->mic.insert(sent->mic.end(), mic, mic + kSamplesPerBuffer);
+
+    slice = TapOutGetSlice(energy_token);
+    CHECK(slice != nullptr);
+    float energy[kNumEnergies];
+    for (int k = 0; k < kNumEnergies; ++k) { energy[k] = n + 1 + 0.25f * k; }
+    memcpy(slice->data, energy, sizeof(energy));
+    sent->energy.insert(sent->energy.end(), energy, energy + kNumEnergies);
+
+    TapOutFinishedCaptureBuffer();
+    if (!garbage.empty() && n % 10 == 5) {
+      DeviceTx(garbage.data(), static_cast<int>(garbage.size()));
+    }
+
+    g_link->AdvanceTime(kBufferSeconds);
+    TapOutFlush();
+    receiver->Poll();
+  }
+
+  // Drain the ring.
+  for (int n = 0; n < 20; ++n) {
+    g_link->AdvanceTime(kBufferSeconds);
+    TapOutFlush();
+    receiver->Poll();
+  }
+}
+
+// Sets up the device and gets descriptors over a link with `bytes_per_second`.
+void SetUp(LoopbackLink* link, double bytes_per_second,
+           TapOutReceiver* receiver) {
+  g_link = link;
+  g_bytes_per_second = bytes_per_second;
+  TapOutEnable(nullptr, 0);
+  TapOutClearDescriptors();
+  CHECK(TapOutAddDescriptor(&kMicDescriptor) == 1);
+  CHECK(TapOutAddDescriptor(&kEnergyDescriptor) == 2);
+  TapOutSetTxFun(DeviceTx);
+  TapOutSetTxAvailableFun(DeviceTxAvailable);
+
+  CHECK(receiver->RequestDescriptors());
+  link->AdvanceTime(0.01);
+  DeviceReceive();
+  link->AdvanceTime(0.1);
+  receiver->Poll();
+  CHECK(receiver->has_descriptors());
+}
+
+// Starts capture and waits for the device to receive the request.
+void StartCapture(TapOutReceiver* receiver, int compression_flags,
+                  const std::string& path_prefix) {
+  CHECK(receiver->StartCapture({"mic input", "energy"}, compression_flags,
+                               path_prefix));
+  g_link->AdvanceTime(0.01);
+}
+
+template <typename T>
+std::vector<T> ReadFile(const std::string& filename) {
+  FILE* f = CHECK_NOTNULL(fopen(filename.c_str(), "rb"));
+  std::vector<T> data;
+  T value;
+  while (fread(&value, sizeof(T), 1, f) == 1) { data.push_back(value); }
+  fclose(f);
+  return data;
+}
+
+// Descriptors are parsed.
+void TestDescriptors() {
+  puts("TestDescriptors");
+  LoopbackLink link({/*bytes_per_second=*/1e6, kLatency});
+  TapOutReceiver receiver(link.b());
+  SetUp(&link, 1e6, &receiver);
+
+  CHECK(receiver.outputs().size() == 2);
+  const TapOutReceiver::Output* mic = receiver.FindOutput("mic input");
+  CHECK(mic != nullptr);
+  CHECK(mic->token == 1);
+  CHECK(mic->num_dims == 1);
+  CHECK(mic->shape[0] == kSamplesPerBuffer);
+  CHECK(mic->item_size == 2);
+  CHECK(mic->num_bytes == 2 * kSamplesPerBuffer);
+  const TapOutReceiver::Output* energy = receiver.FindOutput("energy");
+  CHECK(energy != nullptr);
+  CHECK(energy->token == 2);
+  CHECK(energy->num_bytes == 4 * kNumEnergies);
+  CHECK(receiver.FindOutput("nonexistent") == nullptr);
+  CHECK(!receiver.StartCapture({"nonexistent"}, 0, "unused"));
+}
+
+// Over a fast link, all buffers are received and written to disk.
+void TestCaptureToDisk() {
+  puts("TestCaptureToDisk");
+  constexpr int kNumBuffers = 1000;
+  LoopbackLink link({/*bytes_per_second=*/1e6, kLatency});
+  TapOutReceiver receiver(link.b());
+  SetUp(&link, 1e6, &receiver);
+  const std::string prefix = std::string(CHECK_NOTNULL(tmpnam(nullptr))) + "_";
+  StartCapture(&receiver, /*compression_flags=*/0x1, prefix);
+
+  SentData sent;
+  RunDevice(kNumBuffers, &receiver, &sent);
+  receiver.StopCapture();
+
+  // More than kMaxBuffersPerHeartbeat buffers were captured, so heartbeats
+  // kept the device active.
+  CHECK(receiver.stats().captures_received == kNumBuffers);
+  CHECK(receiver.stats().buffers_lost == 0);
+  CHECK(receiver.stats().device_dropped == 0);
+  CHECK(receiver.stats().bytes_skipped == 0);
+  CHECK(receiver.stats().bytes_written ==
+        kNumBuffers * (2 * kSamplesPerBuffer + 4 * kNumEnergies));
+  CHECK(ReadFile<int16_t>(prefix + "mic_input.raw") == sent.mic);
+  CHECK(ReadFile<float>(prefix + "energy.raw") == sent.energy);
+  // Compression nearly halved the bytes on the wire.
+  CHECK(link.stats().bytes_written < kNumBuffers * 100);
+
+  remove((prefix + "mic_input.raw").c_str());
+  remove((prefix + "energy.raw").c_str());
+}
+
+// When the link is too slow, the device drops buffers. The receiver detects
+// the gaps and fills them with zeros.
+void TestSlowLinkDropsBuffers() {
+  puts("TestSlowLinkDropsBuffers");
+  constexpr int kNumBuffers = 500;
+  // Uncompressed, a buffer is 152 bytes per 4 ms, or 38 kB/s.
+  constexpr double kBytesPerSecond = 30000.0;
+  LoopbackLink link({kBytesPerSecond, kLatency});
+  TapOutReceiver receiver(link.b());
+  SetUp(&link, kBytesPerSecond, &receiver);
+  const std::string prefix = std::string(CHECK_NOTNULL(tmpnam(nullptr))) + "_";
+  StartCapture(&receiver, /*compression_flags=*/0, prefix);
+
+  SentData sent;
+  RunDevice(kNumBuffers, &receiver, &sent);
+  receiver.StopCapture();
+
+  const TapOutReceiver::Stats& stats = receiver.stats();
+  CHECK(stats.buffers_lost > kNumBuffers / 10);
+  // The link itself is lossless, so all gaps are buffers the device dropped.
+  CHECK(stats.buffers_lost == stats.device_dropped);
+  CHECK(TapOutGetRingStats().num_dropped >= stats.device_dropped);
+  const int num_written = stats.captures_received + stats.buffers_lost;
+  CHECK(num_written <= kNumBuffers);
+
+  const std::vector<int16_t> mic = ReadFile<int16_t>(prefix + "mic_input.raw");
+  const std::vector<float> energy = ReadFile<float>(prefix + "energy.raw");
+  CHECK(static_cast<int>(energy.size()) == num_written * kNumEnergies);
+  CHECK(static_cast<int>(mic.size()) == num_written * kSamplesPerBuffer);
+  int num_zero_filled = 0;
+  for (int n = 0; n < num_written; ++n) {
+    const float* e = &energy[n * kNumEnergies];
+    const int16_t* m = &mic[n * kSamplesPerBuffer];
+    if (e[0] == 0.0f) {  // A lost buffer.
+      ++num_zero_filled;
+      CHECK(std::all_of(m, m + kSamplesPerBuffer,
+                        [](int16_t x) { return x == 0; }));
+    } else {  // A received buffer is at the right position in the file.
+      CHECK(std::equal(e, e + kNumEnergies, &sent.energy[n * kNumEnergies]));
+      CHECK(std::equal(m, m + kSamplesPerBuffer,
+                       &sent.mic[n * kSamplesPerBuffer]));
+    }
+  }
+  CHECK(num_zero_filled == stats.buffers_lost);
+  printf("  received: %d, lost: %d\n",
+         static_cast<int>(stats.captures_received),
+         static_cast<int>(stats.buffers_lost));
+
+  remove((prefix + "mic_input.raw").c_str());
+  remove((prefix + "energy.raw").c_str());
+}
+
+// With compression, the same slow link keeps up.
+void TestCompressionAvoidsDrops() {
+  puts("TestCompressionAvoidsDrops");
+  constexpr int kNumBuffers = 500;
+  constexpr double kBytesPerSecond = 30000.0;
+  LoopbackLink link({kBytesPerSecond, kLatency});
+  TapOutReceiver receiver(link.b());
+  SetUp(&link, kBytesPerSecond, &receiver);
+  const std::string prefix = std::string(CHECK_NOTNULL(tmpnam(nullptr))) + "_";
+  StartCapture(&receiver, /*compression_flags=*/0x1, prefix);
+
+  SentData sent;
+  RunDevice(kNumBuffers, &receiver, &sent);
+  receiver.StopCapture();
+
+  CHECK(receiver.stats().captures_received == kNumBuffers);
+  CHECK(receiver.stats().buffers_lost == 0);
+  CHECK(ReadFile<int16_t>(prefix + "mic_input.raw") == sent.mic);
+
+  remove((prefix + "mic_input.raw").c_str());
+  remove((prefix + "energy.raw").c_str());
+}
+
+// The receiver skips bytes from other serial output between messages,
+// including stray marker bytes and incomplete message headers.
+void TestResyncAfterGarbage() {
+  puts("TestResyncAfterGarbage");
+  constexpr int kNumBuffers = 200;
+  LoopbackLink link({/*bytes_per_second=*/1e6, kLatency});
+  TapOutReceiver receiver(link.b());
+  SetUp(&link, 1e6, &receiver);
+  const std::string prefix = std::string(CHECK_NOTNULL(tmpnam(nullptr))) + "_";
+  StartCapture(&receiver, /*compression_flags=*/0x3, prefix);
+
+  const std::string garbage = "Hello\xfe\n\xfe\x07\x05world\n";
+  SentData sent;
+  RunDevice(kNumBuffers, &receiver, &sent, garbage);
+  receiver.StopCapture();
+
+  CHECK(receiver.stats().captures_received == kNumBuffers);
+  CHECK(receiver.stats().buffers_lost == 0);
+  CHECK(receiver.stats().bytes_skipped ==
+        static_cast<int64_t>(garbage.size()) * (kNumBuffers / 10));
+  CHECK(ReadFile<int16_t>(prefix + "mic_input.raw") == sent.mic);
+  CHECK(ReadFile<float>(prefix + "energy.raw") == sent.energy);
+
+  remove((prefix + "mic_input.raw").c_str());
+  remove((prefix + "energy.raw").c_str());
+}
+
+// Duplicate captures are dropped as out of order, rather than read as a gap of
+// nearly 2^16 lost buffers.
+void TestDuplicateCaptures() {
+  puts("TestDuplicateCaptures");
+  constexpr int kNumBuffers = 100;
+  LoopbackLink link({/*bytes_per_second=*/1e6, kLatency});
+  TapOutReceiver receiver(link.b());
+  SetUp(&link, 1e6, &receiver);
+  const std::string prefix = std::string(CHECK_NOTNULL(tmpnam(nullptr))) + "_";
+  StartCapture(&receiver, /*compression_flags=*/0, prefix);
+
+  g_duplicate_captures = true;
+  SentData sent;
+  RunDevice(kNumBuffers, &receiver, &sent);
+  g_duplicate_captures = false;
+  receiver.StopCapture();
+
+  CHECK(receiver.stats().captures_received == kNumBuffers);
+  CHECK(receiver.stats().out_of_order == kNumBuffers);
+  CHECK(receiver.stats().buffers_lost == 0);
+  CHECK(ReadFile<int16_t>(prefix + "mic_input.raw") == sent.mic);
+  CHECK(ReadFile<float>(prefix + "energy.raw") == sent.energy);
+
+  remove((prefix + "mic_input.raw").c_str());
+  remove((prefix + "energy.raw").c_str());
+}
+
+}  // namespace audio_tactile
+
+// NOLINTEND
+
+int main(int argc, char** argv) {
+  audio_tactile::TestDescriptors();
+  audio_tactile::TestCaptureToDisk();
+  audio_tactile::TestSlowLinkDropsBuffers();
+  audio_tactile::TestCompressionAvoidsDrops();
+  audio_tactile::TestResyncAfterGarbage();
+  audio_tactile::TestDuplicateCaptures();
+
+  puts("PASS");
+  return EXIT_SUCCESS;
+}
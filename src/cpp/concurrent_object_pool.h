@@ -0,0 +1,331 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// ConcurrentObjectPool, a lock-free pool of reusable objects.
+//
+// ConcurrentObjectPool<T, kCapacity> has the same interface as ObjectPool (see
+// object_pool.h), but Allocate() and Free() may be called concurrently from
+// multiple threads, or from an interrupt handler and the main thread, e.g. to
+// pass message buffers from an ISR to a worker:
+//
+//   ConcurrentObjectPool<Buffer, 8> pool;
+//
+//   // In the ISR.
+//   Buffer* buffer = pool.Allocate();
+//   if (buffer) { Fill(buffer); queue.Push(buffer); }
+//
+//   // In the worker thread.
+//   Buffer* buffer = queue.Pop();
+//   Process(buffer);
+//   pool.Free(buffer);
+//
+// AllocateBulk() and FreeBulk() allocate or free several objects with a single
+// atomic operation on the free list.
+//
+// A thread that allocates and frees at a high rate may use a `Cache`, which
+// holds free objects for that thread and only touches the shared free list in
+// bulk when it runs empty or full:
+//
+//   ConcurrentObjectPool<Buffer, 64>::Cache<8> cache(&pool);
+//   Buffer* buffer = cache.Allocate();
+//   ...
+//   cache.Free(buffer);
+//
+// A Cache must be used by only one thread at a time, and must be destroyed
+// before the pool.
+//
+// == Implementation ==
+//
+// The free list is a Treiber stack of node indices. The head is a 32-bit word
+// packing a 16-bit node index with a 16-bit tag that is incremented on every
+// update, so that a compare-and-swap fails if the head was popped and pushed
+// back in between (the ABA problem). Only 32-bit atomics are used, so the pool
+// is lock-free on Cortex-M4 (LDREX/STREX) as well as on hosts. The tag may in
+// principle wrap around if a thread is preempted for exactly a multiple of
+// 65536 free list updates, which is negligible in practice.
+//
+// Next indices are stored in an array separate from the object storage, so
+// that reading a stale next index during a contended pop is a well-defined
+// atomic load rather than a data race on object memory.
+//
+// num_free() and num_live() are exact when the pool is quiescent, and
+// approximate while other threads are allocating or freeing. Objects held in a
+// Cache count as live.
+
+#ifndef AUDIO_TO_TACTILE_SRC_CPP_CONCURRENT_OBJECT_POOL_H_
+#define AUDIO_TO_TACTILE_SRC_CPP_CONCURRENT_OBJECT_POOL_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace audio_tactile {
+
+template <typename T, int kCapacity_>
+class ConcurrentObjectPool {
+ public:
+  enum { kCapacity = kCapacity_ };
+  struct TestAccess;
+  template <int kCacheSize> class Cache;
+
+  static_assert(0 < kCapacity && kCapacity < 0xffff,
+                "kCapacity must be between 1 and 65534.");
+
+  ConcurrentObjectPool() noexcept: head_(0), num_free_(kCapacity) {
+    for (int i = 0; i < kCapacity; ++i) {
+      next_[i].store((i + 1 < kCapacity) ? i + 1 : kNil,
+                     std::memory_order_relaxed);
+    }
+  }
+  ConcurrentObjectPool(const ConcurrentObjectPool&) = delete;  // No copying.
+  ConcurrentObjectPool& operator=(const ConcurrentObjectPool&) = delete;
+
+  ~ConcurrentObjectPool() {
+    // Find and free any remaining live objects. We only need to do this if T
+    // has a nontrivial destructor.
+    if (!std::is_trivially_destructible<T>::value && num_live() > 0) {
+      char is_live[kCapacity];
+      MarkLiveObjects(is_live);
+      for (int i = 0; i < kCapacity; ++i) {
+        if (is_live[i]) {
+          Free(GetObject(i));
+        }
+      }
+    }
+  }
+
+  // Number of live objects.
+  int num_live() const noexcept { return kCapacity - num_free(); }
+  // Number of free objects, available for allocation.
+  int num_free() const noexcept {
+    return num_free_.load(std::memory_order_relaxed);
+  }
+
+  // Allocates an object from the pool and invokes T's constructor with `args`.
+  // Returns nullptr if the pool is exhausted. Thread safe and lock free.
+  template <typename... Args>
+  T* Allocate(Args&&... args) {
+    int index;
+    if (PopFree(1, &index) == 0) { return nullptr; }
+    return Construct(index, std::forward<Args>(args)...);
+  }
+
+  // Frees an object from the pool. Thread safe and lock free.
+  //
+  // WARNING: `object` must be a pointer for a live object in this pool
+  // previously obtained from Allocate(), otherwise behavior is undefined.
+  void Free(T* object) {
+    if (object == nullptr) { return; }
+    const int index = Destruct(object);
+    PushFree(&index, 1);
+  }
+
+  // Allocates up to `count` default-constructed objects, writing pointers to
+  // `objects`. Returns the number allocated, which is less than `count` only if
+  // the pool is exhausted.
+  int AllocateBulk(T** objects, int count) {
+    int indices[kBulkChunk];
+    int total = 0;
+    while (total < count) {
+      const int num_popped =
+          PopFree(std::min<int>(count - total, kBulkChunk), indices);
+      for (int i = 0; i < num_popped; ++i) {
+        objects[total++] = Construct(indices[i]);
+      }
+      if (num_popped == 0) { break; }
+    }
+    return total;
+  }
+
+  // Frees `count` objects. As with Free(), each must be a live object of this
+  // pool. Null pointers are ignored.
+  void FreeBulk(T* const* objects, int count) {
+    int indices[kBulkChunk];
+    int num_indices = 0;
+    for (int i = 0; i < count; ++i) {
+      if (objects[i] == nullptr) { continue; }
+      indices[num_indices++] = Destruct(objects[i]);
+      if (num_indices == kBulkChunk) {
+        PushFree(indices, num_indices);
+        num_indices = 0;
+      }
+    }
+    if (num_indices > 0) { PushFree(indices, num_indices); }
+  }
+
+ private:
+  enum {
+    // Null index terminating the free list.
+    kNil = 0xffff,
+    // Max number of objects per free list operation in bulk alloc/free.
+    kBulkChunk = 32,
+  };
+
+  // Storage for one T object.
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Node;
+
+  static uint32_t HeadIndex(uint32_t head) { return head & 0xffff; }
+  // Makes the successor to `head` with index `index` and incremented tag.
+  static uint32_t NextHead(uint32_t head, uint32_t index) {
+    return ((head + 0x10000) & UINT32_C(0xffff0000)) | index;
+  }
+
+  // Returns T pointer to the ith node, assuming it holds a live object.
+  T* GetObject(int i) noexcept { return reinterpret_cast<T*>(&nodes_[i]); }
+
+  template <typename... Args>
+  T* Construct(int index, Args&&... args) {
+    void* memory = &nodes_[index];
+    return new(memory) T(std::forward<Args>(args)...);  // Construct the object.
+  }
+
+  // Destructs `object` and returns its node index.
+  int Destruct(T* object) {
+    object->~T();
+    return static_cast<int>(reinterpret_cast<Node*>(object) - nodes_);
+  }
+
+  // Pops up to `max_count` nodes from the free list with a single CAS, writing
+  // their indices to `indices`. Returns the number popped.
+  int PopFree(int max_count, int* indices) {
+    uint32_t head = head_.load(std::memory_order_acquire);
+    int count;
+    uint32_t next;
+    do {
+      count = 0;
+      next = HeadIndex(head);
+      while (count < max_count && next != kNil) {
+        indices[count++] = next;
+        next = next_[next].load(std::memory_order_relaxed);
+      }
+      if (count == 0) { return 0; }
+      // If another thread changed the free list meanwhile, the indices read
+      // above may be stale, but then the tag differs and the CAS fails.
+    } while (!head_.compare_exchange_weak(head, NextHead(head, next),
+                                          std::memory_order_acquire,
+                                          std::memory_order_acquire));
+    num_free_.fetch_sub(count, std::memory_order_relaxed);
+    return count;
+  }
+
+  // Pushes `count` > 0 nodes onto the free list with a single CAS.
+  void PushFree(const int* indices, int count) {
+    // Link the nodes into a chain.
+    for (int i = 0; i < count - 1; ++i) {
+      next_[indices[i]].store(indices[i + 1], std::memory_order_relaxed);
+    }
+    std::atomic<uint32_t>& last_next = next_[indices[count - 1]];
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    do {
+      last_next.store(HeadIndex(head), std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head, NextHead(head, indices[0]),
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+    num_free_.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  // Fills array `is_live` such that `is_live[i]` is 1 if the ith object is
+  // live or 0 if it is free. The pool must be quiescent.
+  void MarkLiveObjects(char is_live[kCapacity]) const noexcept {
+    std::fill_n(is_live, kCapacity, 1);  // Initialize all objects as live.
+    uint32_t i = HeadIndex(head_.load(std::memory_order_acquire));
+    while (i != kNil) {                  // Iterate the free list.
+      is_live[i] = 0;                    // Mark object as free.
+      i = next_[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  Node nodes_[kCapacity];
+  // Next index in the free list for each free node.
+  std::atomic<uint32_t> next_[kCapacity];
+  // Head of the free list, packing (tag << 16) | index.
+  std::atomic<uint32_t> head_;
+  // Number of nodes in the free list.
+  std::atomic<int> num_free_;
+};
+
+// Per-thread cache of up to `kCacheSize` free objects.
+template <typename T, int kCapacity>
+template <int kCacheSize>
+class ConcurrentObjectPool<T, kCapacity>::Cache {
+ public:
+  static_assert(2 <= kCacheSize && kCacheSize <= kBulkChunk,
+                "kCacheSize must be between 2 and 32.");
+
+  explicit Cache(ConcurrentObjectPool* pool) noexcept
+      : pool_(pool), cached_(), num_cached_(0) {}
+  Cache(const Cache&) = delete;  // No copying.
+  Cache& operator=(const Cache&) = delete;
+  // Returns cached objects to the pool.
+  ~Cache() { Flush(); }
+
+  // Number of free objects held by the cache.
+  int num_cached() const noexcept { return num_cached_; }
+
+  // Allocates an object, refilling the cache from the pool in bulk if empty.
+  template <typename... Args>
+  T* Allocate(Args&&... args) {
+    if (num_cached_ == 0) {
+      num_cached_ = pool_->PopFree(kCacheSize / 2, cached_);
+      if (num_cached_ == 0) { return nullptr; }
+    }
+    return pool_->Construct(cached_[--num_cached_],
+                            std::forward<Args>(args)...);
+  }
+
+  // Frees an object, returning half the cache to the pool in bulk if full.
+  void Free(T* object) {
+    if (object == nullptr) { return; }
+    if (num_cached_ == kCacheSize) {
+      constexpr int kNumToReturn = kCacheSize / 2;
+      pool_->PushFree(cached_ + kCacheSize - kNumToReturn, kNumToReturn);
+      num_cached_ -= kNumToReturn;
+    }
+    cached_[num_cached_++] = pool_->Destruct(object);
+  }
+
+  // Returns all cached objects to the pool.
+  void Flush() {
+    if (num_cached_ > 0) {
+      pool_->PushFree(cached_, num_cached_);
+      num_cached_ = 0;
+    }
+  }
+
+ private:
+  ConcurrentObjectPool* pool_;
+  int cached_[kCacheSize];
+  int num_cached_;
+};
+
+// Test-only access to ConcurrentObjectPool.
+template <typename T, int kCapacity>
+struct ConcurrentObjectPool<T, kCapacity>::TestAccess {
+  static T* GetObject(ConcurrentObjectPool<T, kCapacity>& pool, int i) {
+    return pool.GetObject(i);
+  }
+  static void MarkLiveObjects(const ConcurrentObjectPool<T, kCapacity>& pool,
+                              char is_live[kCapacity]) {
+    return pool.MarkLiveObjects(is_live);
+  }
+};
+
+}  // namespace audio_tactile
+
+#endif  // AUDIO_TO_TACTILE_SRC_CPP_CONCURRENT_OBJECT_POOL_H_
@@ -0,0 +1,138 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpp/ima_adpcm.h"  // NOLINT(build/include)
+
+#include "dsp/serialize.h"  // NOLINT(build/include)
+
+namespace audio_tactile {
+
+namespace {
+constexpr int kMaxStepIndex = 88;
+
+// Step sizes, roughly exponentially spaced by a factor of 1.1.
+const int16_t kStepTable[kMaxStepIndex + 1] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+// Step index adjustment for each code magnitude.
+const int8_t kIndexTable[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+// Updates the predictor and step index for `code`. This is the decoder, and
+// the encoder runs it too so that its state tracks the decoder's exactly.
+inline void Update(int code, int* predictor, int* step_index) {
+  const int step = kStepTable[*step_index];
+  // Compute diff = (code magnitude + 1/2) * step / 4 as in the IMA reference,
+  // using shifts and adds only.
+  int diff = step >> 3;
+  if (code & 4) { diff += step; }
+  if (code & 2) { diff += step >> 1; }
+  if (code & 1) { diff += step >> 2; }
+  int value = (code & 8) ? *predictor - diff : *predictor + diff;
+  if (value > INT16_MAX) {
+    value = INT16_MAX;
+  } else if (value < INT16_MIN) {
+    value = INT16_MIN;
+  }
+  *predictor = value;
+
+  int index = *step_index + kIndexTable[code & 7];
+  if (index < 0) {
+    index = 0;
+  } else if (index > kMaxStepIndex) {
+    index = kMaxStepIndex;
+  }
+  *step_index = index;
+}
+
+// Encodes one sample to a 4-bit code and updates the state.
+inline int EncodeSample(int sample, int* predictor, int* step_index) {
+  int step = kStepTable[*step_index];
+  int diff = sample - *predictor;
+  int code = 0;
+  if (diff < 0) {
+    code = 8;
+    diff = -diff;
+  }
+  if (diff >= step) {
+    code |= 4;
+    diff -= step;
+  }
+  step >>= 1;
+  if (diff >= step) {
+    code |= 2;
+    diff -= step;
+  }
+  step >>= 1;
+  if (diff >= step) { code |= 1; }
+
+  Update(code, predictor, step_index);
+  return code;
+}
+}  // namespace
+
+void ImaAdpcmInit(ImaAdpcmState* state) {
+  state->predictor = 0;
+  state->step_index = 0;
+}
+
+int ImaAdpcmEncodeBlock(Slice<const int16_t> samples, ImaAdpcmState* state,
+                        uint8_t* dest) {
+  LittleEndianWriteS16(state->predictor, dest);
+  dest[2] = state->step_index;
+  uint8_t* codes = dest + kImaAdpcmHeaderSize;
+
+  int predictor = state->predictor;
+  int step_index = state->step_index;
+  const int num_samples = samples.size();
+  for (int i = 0; i < num_samples; i += 2) {
+    const int low = EncodeSample(samples[i], &predictor, &step_index);
+    const int high = EncodeSample(samples[i + 1], &predictor, &step_index);
+    *codes++ = static_cast<uint8_t>(low | (high << 4));
+  }
+
+  state->predictor = static_cast<int16_t>(predictor);
+  state->step_index = static_cast<uint8_t>(step_index);
+  return ImaAdpcmBlockSize(num_samples);
+}
+
+bool ImaAdpcmDecodeBlock(Slice<const uint8_t> block, Slice<int16_t> samples) {
+  const int num_samples = samples.size();
+  if (num_samples % 2 != 0 ||
+      block.size() != ImaAdpcmBlockSize(num_samples) ||
+      block[2] > kMaxStepIndex) {
+    return false;
+  }
+
+  int predictor = LittleEndianReadS16(block.data());
+  int step_index = block[2];
+  const uint8_t* codes = block.data() + kImaAdpcmHeaderSize;
+  for (int i = 0; i < num_samples; i += 2) {
+    const int byte = *codes++;
+    Update(byte & 15, &predictor, &step_index);
+    samples[i] = static_cast<int16_t>(predictor);
+    Update(byte >> 4, &predictor, &step_index);
+    samples[i + 1] = static_cast<int16_t>(predictor);
+  }
+  return true;
+}
+
+}  // namespace audio_tactile
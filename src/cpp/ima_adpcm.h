@@ -0,0 +1,73 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// IMA-ADPCM codec for sending audio over the puck-to-sleeve serial link.
+//
+// IMA-ADPCM codes each int16 sample as a 4-bit difference from a prediction,
+// with an adaptive step size, for 4x compression. Encoding and decoding take a
+// few integer operations per sample and no multiplies, so they are cheap on
+// the MCU.
+//
+// Audio is coded in blocks. Each block is self-contained so that a lost block
+// doesn't corrupt the following ones:
+//
+//   [0] Predictor, low byte     <- Encoder state at the start of the block.
+//   [1] Predictor, high byte
+//   [2] Step index
+//   [3]...  4-bit codes, two samples per byte, first sample in the low nibble.
+//
+// The encoder state carries over between blocks, so encoding a stream in
+// blocks gives the same codes as encoding it all at once.
+
+#ifndef AUDIO_TO_TACTILE_SRC_CPP_IMA_ADPCM_H_
+#define AUDIO_TO_TACTILE_SRC_CPP_IMA_ADPCM_H_
+
+#include <stdint.h>
+
+#include "cpp/slice.h"
+
+namespace audio_tactile {
+
+struct ImaAdpcmState {
+  // Prediction of the next sample.
+  int16_t predictor;
+  // Index into the step size table, in [0, 88].
+  uint8_t step_index;
+};
+
+// Number of header bytes in a block.
+constexpr int kImaAdpcmHeaderSize = 3;
+
+// Size in bytes of a block coding `num_samples` samples, which must be even.
+constexpr int ImaAdpcmBlockSize(int num_samples) {
+  return kImaAdpcmHeaderSize + num_samples / 2;
+}
+
+// Initializes `state` for the start of a stream.
+void ImaAdpcmInit(ImaAdpcmState* state);
+
+// Encodes `samples` as a block to `dest`, which must have space for
+// ImaAdpcmBlockSize(samples.size()) bytes, and updates the encoder `state`.
+// The number of samples must be even. Returns the block size in bytes.
+int ImaAdpcmEncodeBlock(Slice<const int16_t> samples, ImaAdpcmState* state,
+                        uint8_t* dest);
+
+// Decodes `block` to `samples`. Returns false if `block` doesn't have size
+// ImaAdpcmBlockSize(samples.size()) or has an invalid header.
+bool ImaAdpcmDecodeBlock(Slice<const uint8_t> block, Slice<int16_t> samples);
+
+}  // namespace audio_tactile
+
+#endif  // AUDIO_TO_TACTILE_SRC_CPP_IMA_ADPCM_H_
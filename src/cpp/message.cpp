@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "cpp/tactor_samples_codec.h"  // NOLINT(build/include)
 #include "dsp/serialize.h"  // NOLINT(build/include)
 
 namespace audio_tactile {
@@ -42,6 +43,20 @@ bool Message::ReadAudioSamples(Slice<int16_t, kAdcDataSize> samples) const {
   return samples.bytes().CopyFrom(payload());
 }
 
+bool Message::WriteAdpcmAudioSamples(Slice<const int16_t> samples,
+                                     ImaAdpcmState* state) {
+  if (samples.size() % 2 != 0 || samples.size() > kMaxAdpcmAudioSamples) {
+    return false;
+  }
+  bytes_[3] = static_cast<uint8_t>(
+      ImaAdpcmEncodeBlock(samples, state, bytes_ + kHeaderSize));
+  set_type(MessageType::kAdpcmAudioSamples);
+  return true;
+}
+bool Message::ReadAdpcmAudioSamples(Slice<int16_t> samples) const {
+  return ImaAdpcmDecodeBlock(payload(), samples);
+}
+
 void Message::WriteTemperature(float temperature_c) {
   uint8_t bytes[4];
   ::LittleEndianWriteF32(temperature_c, bytes);
@@ -81,6 +96,19 @@ bool Message::ReadAllTactorsSamples(
   return samples.CopyFrom(payload());
 }
 
+void Message::WriteCompressedTactorsSamples(
+    Slice<const uint8_t, kNumTotalPwm * kNumPwmValues> samples) {
+  uint8_t buffer[kMaxCompressedTactorsSamplesSize];
+  const int size = CompressTactorsSamples(
+      samples, Slice<uint8_t, kMaxCompressedTactorsSamplesSize>(buffer));
+  SetTypeAndPayload(MessageType::kCompressedTactorsSamples,
+                    Slice<const uint8_t>(buffer, size));
+}
+bool Message::ReadCompressedTactorsSamples(
+    Slice<uint8_t, kNumTotalPwm * kNumPwmValues> samples) const {
+  return DecompressTactorsSamples(payload(), samples);
+}
+
 void Message::WriteTuning(const TuningKnobs& knobs) {
   SetTypeAndPayload(MessageType::kTuning,
                     Slice<const uint8_t, kNumTuningKnobs>(knobs.values));
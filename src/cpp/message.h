@@ -29,6 +29,7 @@
 #include <stdint.h>
 
 #include "cpp/constants.h"
+#include "cpp/ima_adpcm.h"
 #include "cpp/slice.h"
 #include "cpp/settings.h"
 #include "dsp/channel_map.h"
@@ -78,6 +79,8 @@ enum class MessageType {
   kGetOnConnectionBatch = 34,
   kCalibrateChannel = 35,
   kTactileExPattern = 36,
+  kCompressedTactorsSamples = 37,
+  kAdpcmAudioSamples = 38,
 };
 
 // Recipients of messages.
@@ -101,6 +104,8 @@ class Message {
     kMaxMessageSize = kHeaderSize + kMaxPayloadSize,
     // Start-of-frame code for first byte of serial header.
     kPacketStart = 200,
+    // Max number of samples in a kAdpcmAudioSamples message.
+    kMaxAdpcmAudioSamples = 2 * (kMaxPayloadSize - kImaAdpcmHeaderSize),
   };
 
   // Gets raw data pointer to the full message, including header.
@@ -158,6 +163,18 @@ class Message {
   // Reads the samples from a kAudioSamples message.
   bool ReadAudioSamples(Slice<int16_t, kAdcDataSize> samples) const;
 
+  // Writes a kAdpcmAudioSamples message of int16 audio samples compressed with
+  // IMA-ADPCM (see ima_adpcm.h), using and updating the encoder `state`. The
+  // number of samples must be even and at most kMaxAdpcmAudioSamples (= 250).
+  // Otherwise, returns false and leaves the message and `state` unchanged.
+  // A block of kAdcDataSize samples has a 35-byte payload, vs. 128 bytes for
+  // kAudioSamples.
+  bool WriteAdpcmAudioSamples(Slice<const int16_t> samples,
+                              ImaAdpcmState* state);
+  // Reads and decodes the samples from a kAdpcmAudioSamples message. Returns
+  // false if the message doesn't have exactly `samples.size()` samples.
+  bool ReadAdpcmAudioSamples(Slice<int16_t> samples) const;
+
   // Writes a kTemperature message to send thermistor temperature measurement.
   void WriteTemperature(float temperature_c);
   // Reads the temperature from a kTemperature message.
@@ -186,6 +203,17 @@ class Message {
   bool ReadAllTactorsSamples(
       Slice<uint8_t, kNumTotalPwm * kNumPwmValues> samples) const;
 
+  // Writes a kCompressedTactorsSamples message. This carries the same samples
+  // as kAllTactorsSamples, losslessly compressed with per-channel delta and
+  // Rice coding (see tactor_samples_codec.h). Payloads are at most 97 bytes,
+  // and smooth envelopes compress to less than half of 96 bytes.
+  void WriteCompressedTactorsSamples(
+      Slice<const uint8_t, kNumTotalPwm * kNumPwmValues> samples);
+  // Reads and decompresses the samples from a kCompressedTactorsSamples
+  // message.
+  bool ReadCompressedTactorsSamples(
+      Slice<uint8_t, kNumTotalPwm * kNumPwmValues> samples) const;
+
   // Writes kTuning message of settings for all tuning knobs.
   void WriteTuning(const TuningKnobs& knobs);
   // Reads the tuning knobs from a kTuning message.
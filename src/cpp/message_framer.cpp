@@ -0,0 +1,191 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpp/message_framer.h"  // NOLINT(build/include)
+
+#include <string.h>
+
+#include "dsp/serialize.h"  // NOLINT(build/include)
+
+namespace audio_tactile {
+
+// Views into chunks reinterpret bytes as a Message, which requires that Message
+// is a plain byte array.
+static_assert(sizeof(Message) == Message::kMaxMessageSize,
+              "Message must be a plain byte array");
+static_assert(alignof(Message) == 1, "Message must be a plain byte array");
+
+namespace {
+// Offset in a kBle frame where the checksummed bytes begin, after the checksum.
+constexpr int kChecksumStart = 2;
+}  // namespace
+
+void MessageFramer::Reset() {
+  chunk_ = nullptr;
+  chunk_end_ = nullptr;
+  pending_size_ = 0;
+  pending_checksum_ = 1;
+  pending_summed_ = kChecksumStart;
+  stats_.messages = 0;
+  stats_.bad_frames = 0;
+  stats_.skipped_bytes = 0;
+}
+
+void MessageFramer::Push(const uint8_t* data, int size) {
+  chunk_ = data;
+  chunk_end_ = data + size;
+}
+
+const Message* MessageFramer::Next() {
+  while (true) {
+    if (pending_size_ > 0) {
+      // Complete the frame carried over from previous chunks.
+      if (!FillPending(Message::kHeaderSize)) { return nullptr; }
+      if (ValidHeader(pending_)) {
+        const int frame_size = FrameSize(pending_);
+        if (!FillPending(frame_size)) { return nullptr; }
+        if (mode_ == Mode::kSerial ||
+            LittleEndianReadU16(pending_) == pending_checksum_) {
+          memcpy(message_.data(), pending_, frame_size);
+          ++stats_.messages;
+          DropPending(frame_size);
+          return &message_;
+        }
+        ++stats_.bad_frames;
+      } else if (mode_ == Mode::kSerial) {
+        ++stats_.bad_frames;
+      }
+      ++stats_.skipped_bytes;
+      DropPending(1);
+      continue;
+    }
+
+    if (mode_ == Mode::kSerial) {
+      // Search the chunk for the next start byte.
+      const uint8_t* start = static_cast<const uint8_t*>(
+          memchr(chunk_, Message::kPacketStart, chunk_end_ - chunk_));
+      if (start == nullptr) {
+        stats_.skipped_bytes += chunk_end_ - chunk_;
+        chunk_ = chunk_end_;
+        return nullptr;
+      }
+      stats_.skipped_bytes += start - chunk_;
+      chunk_ = start;
+    } else if (chunk_ == chunk_end_) {
+      return nullptr;
+    }
+
+    if (chunk_end_ - chunk_ < kMaxFrameSize) {
+      // Near the end of the chunk, there might not be enough bytes left for
+      // the frame. Continue by copying into `pending_`, so that the returned
+      // Message may be safely copied by value.
+      pending_[0] = *chunk_++;
+      pending_size_ = 1;
+      continue;
+    }
+
+    if (ValidHeader(chunk_)) {
+      const int frame_size = FrameSize(chunk_);
+      if (mode_ == Mode::kSerial ||
+          LittleEndianReadU16(chunk_) ==
+              ::Fletcher16(chunk_ + kChecksumStart,
+                           frame_size - kChecksumStart, /*init=*/1)) {
+        const Message* message = reinterpret_cast<const Message*>(chunk_);
+        chunk_ += frame_size;
+        ++stats_.messages;
+        return message;
+      }
+      ++stats_.bad_frames;
+    } else if (mode_ == Mode::kSerial) {
+      ++stats_.bad_frames;
+    }
+    // Bad frame. Resume searching after its first byte.
+    ++stats_.skipped_bytes;
+    ++chunk_;
+  }
+}
+
+int MessageFramer::WriteSerialFrame(MessageRecipient recipient,
+                                    Message* message, uint8_t* dest) {
+  message->SetHeader(recipient);
+  memcpy(dest, message->data(), message->size());
+  memset(dest + message->size(), 0,
+         Message::kMaxMessageSize - message->size());
+  return Message::kMaxMessageSize;
+}
+
+int MessageFramer::WriteBleFrame(Message* message, uint8_t* dest) {
+  message->SetBleHeader();
+  memcpy(dest, message->data(), message->size());
+  return message->size();
+}
+
+bool MessageFramer::ValidHeader(const uint8_t* header) const {
+  if (header[3] > Message::kMaxPayloadSize) { return false; }
+  if (mode_ == Mode::kSerial) {
+    return header[0] == Message::kPacketStart &&
+        header[1] <= static_cast<int>(MessageRecipient::kConnectedBleDevice);
+  } else {
+    return header[2] >= 1;  // Check type field, as in AudioTactileBleCom.
+  }
+}
+
+int MessageFramer::FrameSize(const uint8_t* header) const {
+  return (mode_ == Mode::kSerial) ? Message::kMaxMessageSize
+                                  : Message::kHeaderSize + header[3];
+}
+
+bool MessageFramer::FillPending(int size) {
+  if (pending_size_ < size) {
+    const int available = static_cast<int>(chunk_end_ - chunk_);
+    int count = size - pending_size_;
+    if (count > available) { count = available; }
+    memcpy(pending_ + pending_size_, chunk_, count);
+    chunk_ += count;
+    pending_size_ += count;
+  }
+
+  if (mode_ == Mode::kBle) {
+    // Update the running checksum over newly-available bytes of the frame.
+    const int end = (pending_size_ < size) ? pending_size_ : size;
+    if (end > pending_summed_) {
+      pending_checksum_ = ::Fletcher16(
+          pending_ + pending_summed_, end - pending_summed_, pending_checksum_);
+      pending_summed_ = end;
+    }
+  }
+  return pending_size_ >= size;
+}
+
+void MessageFramer::DropPending(int count) {
+  pending_checksum_ = 1;
+  pending_summed_ = kChecksumStart;
+  const uint8_t* rest = pending_ + count;
+  const int rest_size = pending_size_ - count;
+  const uint8_t* start = rest;
+  if (mode_ == Mode::kSerial) {
+    start = static_cast<const uint8_t*>(
+        memchr(rest, Message::kPacketStart, rest_size));
+    if (start == nullptr) {
+      stats_.skipped_bytes += rest_size;
+      pending_size_ = 0;
+      return;
+    }
+    stats_.skipped_bytes += start - rest;
+  }
+  pending_size_ = rest_size - static_cast<int>(start - rest);
+  memmove(pending_, start, pending_size_);
+}
+
+}  // namespace audio_tactile
@@ -0,0 +1,164 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Streaming framer for Messages in a byte stream.
+//
+// `MessageFramer` finds Messages in a stream of bytes that arrives in chunks of
+// arbitrary size, for instance from a serial port, BLE notifications, or a long
+// captured log. It parses the two wire formats used by the firmware, selected
+// by the framer's mode:
+//
+//  * kSerial, as sent by AudioTactileSerialCom. Each frame is a Message with
+//    serial header (see Message::SetHeader()), always transferred as a full
+//    Message::kMaxMessageSize = 132-byte buffer:
+//
+//      [0] Message::kPacketStart
+//      [1] <recipient>
+//      [2] <message type>
+//      [3] <payload size n>
+//      [4]...[3 + n] <payload>
+//      [4 + n]...[131] <unused padding>
+//
+//    There is no checksum, so a frame is accepted if its header is valid, and
+//    corrupted payload bytes are not detected.
+//
+//  * kBle, as sent by AudioTactileBleCom. Each frame is a Message with BLE
+//    header (see Message::SetBleHeader()), with no start byte or padding:
+//
+//      [0] Fletcher16 checksum, low byte
+//      [1] Fletcher16 checksum, high byte
+//      [2] <message type>
+//      [3] <payload size n>
+//      [4]...[3 + n] <payload>
+//
+// Frames are validated in a single pass over the bytes. If a frame is invalid,
+// the framer resynchronizes by searching from the byte after the bad frame's
+// first byte, for the next start byte in kSerial mode or the next position
+// with a valid checksum in kBle mode. So corruption or garbage between frames
+// costs at most the frames it overlaps.
+//
+// Example use:
+//
+//   MessageFramer framer(MessageFramer::Mode::kSerial);
+//   framer.Push(chunk, chunk_size);
+//   const Message* message;
+//   while ((message = framer.Next()) != nullptr) {
+//     HandleMessage(*message);
+//   }
+//
+// Messages returned by Next() are views valid until the next call to Push() or
+// Next(). When the whole frame is in the chunk, the view points directly into
+// the chunk without copying. A frame that straddles chunks is assembled in an
+// internal buffer, updating its checksum incrementally as bytes arrive.
+
+#ifndef AUDIO_TO_TACTILE_SRC_CPP_MESSAGE_FRAMER_H_
+#define AUDIO_TO_TACTILE_SRC_CPP_MESSAGE_FRAMER_H_
+
+#include <stdint.h>
+
+#include "cpp/message.h"
+
+namespace audio_tactile {
+
+class MessageFramer {
+ public:
+  // Wire format of the stream.
+  enum class Mode {
+    // Fixed-size frames of Messages with serial header.
+    kSerial,
+    // Messages with BLE header, back to back.
+    kBle,
+  };
+
+  enum {
+    // Max number of bytes in a frame in either mode.
+    kMaxFrameSize = Message::kMaxMessageSize,
+  };
+
+  // Framing statistics.
+  struct Stats {
+    // Number of valid messages found.
+    uint32_t messages;
+    // Number of frames that failed validation. In kSerial mode, these are
+    // start bytes followed by an invalid header. In kBle mode, these are
+    // frames with a plausible header but a bad checksum.
+    uint32_t bad_frames;
+    // Number of bytes skipped while searching for a frame, including bytes of
+    // bad frames.
+    uint32_t skipped_bytes;
+  };
+
+  explicit MessageFramer(Mode mode) : mode_(mode) { Reset(); }
+
+  // Resets to initial state, discarding any partial frame and the stats.
+  void Reset();
+
+  // Sets `data` as the current chunk of `size` bytes. The caller must keep
+  // `data` alive until Next() returns nullptr. Any bytes not yet consumed
+  // from the previous chunk are discarded, so call Next() until it returns
+  // nullptr before pushing the next chunk.
+  void Push(const uint8_t* data, int size);
+
+  // Returns the next valid message, or nullptr if the current chunk has been
+  // consumed. The returned view is valid until the next call to Push() or
+  // Next().
+  const Message* Next();
+
+  Mode mode() const { return mode_; }
+  const Stats& stats() const { return stats_; }
+
+  // Writes `message` as a kSerial frame to `dest`, which must have space for
+  // kMaxFrameSize bytes, setting its serial header with `recipient`. As with
+  // AudioTactileSerialCom, the frame is always kMaxFrameSize bytes, here with
+  // zero padding after the payload. Returns the frame size in bytes.
+  static int WriteSerialFrame(MessageRecipient recipient, Message* message,
+                              uint8_t* dest);
+  // Writes `message` as a kBle frame to `dest`, which must have space for
+  // kMaxFrameSize bytes, setting its BLE header. Returns the frame size in
+  // bytes.
+  static int WriteBleFrame(Message* message, uint8_t* dest);
+
+ private:
+  // Returns true if `header` is a plausible frame header for the mode.
+  bool ValidHeader(const uint8_t* header) const;
+  // Gets the size of the frame with header `header`.
+  int FrameSize(const uint8_t* header) const;
+  // Appends bytes from the chunk to `pending_` until it has `size` bytes, and
+  // in kBle mode updates the running checksum over the frame's bytes up to
+  // `size`. Returns true if `pending_` has `size` bytes.
+  bool FillPending(int size);
+  // Drops the first `count` bytes of `pending_`. In kSerial mode, then skips to
+  // the next start byte in the remaining pending bytes, if any.
+  void DropPending(int count);
+
+  Mode mode_;
+  // Current chunk.
+  const uint8_t* chunk_;
+  const uint8_t* chunk_end_;
+  // Partial frame carried over from previous chunks. In kSerial mode, when
+  // nonempty, `pending_[0]` is a start byte.
+  uint8_t pending_[kMaxFrameSize];
+  int pending_size_;
+  // Running Fletcher16 of pending_[2, pending_summed_), used in kBle mode.
+  uint16_t pending_checksum_;
+  int pending_summed_;
+  // Assembled message from `pending_`, returned by Next().
+  Message message_;
+  Stats stats_;
+};
+
+}  // namespace audio_tactile
+
+#endif  // AUDIO_TO_TACTILE_SRC_CPP_MESSAGE_FRAMER_H_
@@ -0,0 +1,171 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpp/message_scheduler.h"  // NOLINT(build/include)
+
+#include "cpp/message_framer.h"  // NOLINT(build/include)
+
+namespace audio_tactile {
+
+namespace {
+// Wraparound-safe comparison of uint32 times, returns true if a < b.
+bool TimeBefore(uint32_t a, uint32_t b) {
+  return static_cast<int32_t>(a - b) < 0;
+}
+}  // namespace
+
+MessageScheduler::MessageScheduler(int mtu)
+    : mtu_(mtu), max_background_frame_size_(mtu) {
+  Reset();
+}
+
+void MessageScheduler::Reset() {
+  size_ = 0;
+  next_sequence_ = 0;
+  stats_ = Stats{0, 0, 0, 0};
+}
+
+bool MessageScheduler::Enqueue(const Message& message, Priority priority,
+                               uint32_t deadline) {
+  return EnqueueInternal(message, priority, true, deadline);
+}
+
+bool MessageScheduler::Enqueue(const Message& message, Priority priority) {
+  return EnqueueInternal(message, priority, false, 0);
+}
+
+bool MessageScheduler::EnqueueInternal(const Message& message,
+                                       Priority priority, bool has_deadline,
+                                       uint32_t deadline) {
+  Entry* entry;
+  if (size_ < kCapacity) {
+    entry = &entries_[size_++];
+  } else {
+    // The queue is full. Find the newest entry of the lowest priority.
+    int victim = 0;
+    for (int i = 1; i < size_; ++i) {
+      const Entry& e = entries_[i];
+      const Entry& v = entries_[victim];
+      if (e.priority > v.priority ||
+          (e.priority == v.priority && TimeBefore(v.sequence, e.sequence))) {
+        victim = i;
+      }
+    }
+    ++stats_.overflowed;
+    // Reject the new message unless it is more important than the victim.
+    if (entries_[victim].priority <= priority) { return false; }
+    entry = &entries_[victim];
+  }
+
+  entry->message = message;
+  entry->priority = priority;
+  entry->has_deadline = has_deadline;
+  entry->deadline = deadline;
+  entry->sequence = next_sequence_++;
+  return true;
+}
+
+int MessageScheduler::NextFrame(uint32_t now, uint8_t* dest) {
+  // Drop expired messages.
+  for (int i = size_ - 1; i >= 0; --i) {
+    if (entries_[i].has_deadline && TimeBefore(entries_[i].deadline, now)) {
+      Remove(i);
+      ++stats_.expired;
+    }
+  }
+  if (size_ == 0) { return 0; }
+
+  // Sort entry indices in sending order. Insertion sort is fine for the small
+  // queue size.
+  int order[kCapacity];
+  for (int i = 0; i < size_; ++i) {
+    int j = i;
+    for (; j > 0 && Before(entries_[i], entries_[order[j - 1]]); --j) {
+      order[j] = order[j - 1];
+    }
+    order[j] = i;
+  }
+
+  // Pack messages that fit, in order.
+  bool sent[kCapacity] = {false};
+  int frame_size = 0;
+  int background_size = 0;
+  for (int k = 0; k < size_; ++k) {
+    const Entry& entry = entries_[order[k]];
+    const int size = entry.message.size();
+    if (frame_size + size > mtu_) { continue; }
+    if (entry.priority != kRealTime) {
+      if (frame_size > 0 &&
+          background_size + size > max_background_frame_size_) {
+        continue;
+      }
+      background_size += size;
+    }
+    frame_size += MessageFramer::WriteBleFrame(&entries_[order[k]].message,
+                                               dest + frame_size);
+    sent[order[k]] = true;
+    ++stats_.messages;
+  }
+  for (int i = size_ - 1; i >= 0; --i) {
+    if (sent[i]) { Remove(i); }
+  }
+
+  if (frame_size > 0) { ++stats_.frames; }
+  return frame_size;
+}
+
+MessageScheduler::Priority MessageScheduler::DefaultPriority(
+    MessageType type) {
+  switch (type) {
+    case MessageType::kTactor1Samples:
+    case MessageType::kTactor2Samples:
+    case MessageType::kTactor3Samples:
+    case MessageType::kTactor4Samples:
+    case MessageType::kTactor5Samples:
+    case MessageType::kTactor6Samples:
+    case MessageType::kTactor7Samples:
+    case MessageType::kTactor8Samples:
+    case MessageType::kTactor9Samples:
+    case MessageType::kTactor10Samples:
+    case MessageType::kTactor11Samples:
+    case MessageType::kTactor12Samples:
+    case MessageType::kAudioSamples:
+    case MessageType::kAllTactorsSamples:
+    case MessageType::kCompressedTactorsSamples:
+    case MessageType::kAdpcmAudioSamples:
+      return kRealTime;
+    case MessageType::kTemperature:
+    case MessageType::kStatsRecord:
+    case MessageType::kBatteryVoltage:
+      return kHousekeeping;
+    default:
+      return kNormal;
+  }
+}
+
+bool MessageScheduler::Before(const Entry& a, const Entry& b) {
+  if (a.priority != b.priority) { return a.priority < b.priority; }
+  if (a.has_deadline != b.has_deadline) { return a.has_deadline; }
+  if (a.has_deadline && a.deadline != b.deadline) {
+    return TimeBefore(a.deadline, b.deadline);
+  }
+  return TimeBefore(a.sequence, b.sequence);
+}
+
+void MessageScheduler::Remove(int i) {
+  --size_;
+  if (i != size_) { entries_[i] = entries_[size_]; }
+}
+
+}  // namespace audio_tactile
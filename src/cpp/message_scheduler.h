@@ -0,0 +1,158 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Priority-aware scheduler that coalesces outgoing Messages into frames.
+//
+// `MessageScheduler` queues outgoing messages with a priority and an optional
+// deadline, and packs them into transport frames of up to `mtu` bytes, for
+// instance the BLE ATT MTU or the UART buffer size. This way a burst of small
+// housekeeping messages (stats, temperature, battery voltage) goes out in one
+// frame rather than one frame each, and real-time sample messages never wait
+// in the queue behind housekeeping.
+//
+// Each call to NextFrame() fills a frame as follows:
+//
+//  1. Messages whose deadline has passed are dropped. Deadlines are for
+//     messages that are useless when late, like stale audio.
+//  2. Remaining messages are considered in order of priority, then earliest
+//     deadline, then first in first out. Each message that fits in the space
+//     left in the frame is added. So real-time messages are always packed
+//     first, and lower priority messages fill leftover space.
+//  3. Optionally, messages that aren't real-time are limited to
+//     `max_background_frame_size` bytes per frame, except that a frame always
+//     has at least one message. On a slow link, this bounds how long a
+//     real-time message waits if it arrives while a frame is in flight.
+//
+// The frame is a concatenation of Messages with BLE header, so the receiver
+// splits it with MessageFramer in kBle mode.
+//
+// The scheduler is transport agnostic and has no clock of its own. Times are
+// uint32 ticks in any unit, e.g. from millis() or micros(), and may wrap
+// around. Example use:
+//
+//   MessageScheduler scheduler(kMtu);
+//
+//   // Producers enqueue messages.
+//   scheduler.Enqueue(audio_message, MessageScheduler::kRealTime,
+//                     /*deadline=*/now + 8);
+//   scheduler.Enqueue(temperature_message, MessageScheduler::kHousekeeping);
+//
+//   // When the transport is ready to send.
+//   uint8_t frame[kMtu];
+//   const int frame_size = scheduler.NextFrame(now, frame);
+//   if (frame_size > 0) { Transport.Send(frame, frame_size); }
+//
+// The scheduler is not thread safe. Enqueue() and NextFrame() must not run
+// concurrently, e.g. in an ISR and the main loop.
+
+#ifndef AUDIO_TO_TACTILE_SRC_CPP_MESSAGE_SCHEDULER_H_
+#define AUDIO_TO_TACTILE_SRC_CPP_MESSAGE_SCHEDULER_H_
+
+#include <stdint.h>
+
+#include "cpp/message.h"
+
+namespace audio_tactile {
+
+class MessageScheduler {
+ public:
+  enum {
+    // Max number of queued messages.
+    kCapacity = 16,
+  };
+
+  enum Priority {
+    // Latency-critical messages like audio and tactor samples.
+    kRealTime,
+    // Commands and responses.
+    kNormal,
+    // Periodic stats, temperature, battery voltage, and so on.
+    kHousekeeping,
+  };
+
+  // Scheduling statistics.
+  struct Stats {
+    // Number of frames returned by NextFrame().
+    uint32_t frames;
+    // Number of messages sent in frames.
+    uint32_t messages;
+    // Number of messages dropped because their deadline passed.
+    uint32_t expired;
+    // Number of messages dropped or rejected because the queue was full.
+    uint32_t overflowed;
+  };
+
+  // Constructs a scheduler for frames of up to `mtu` bytes. The `mtu` should
+  // be at least MessageFramer::kMaxFrameSize (= 132) so that any message fits.
+  // The max background frame size is initially `mtu`.
+  explicit MessageScheduler(int mtu);
+
+  // Discards all queued messages and resets the stats.
+  void Reset();
+
+  // Enqueues `message` with `priority` and a `deadline` after which it is
+  // dropped. Returns false if `message` was rejected because the queue is full
+  // of messages of equal or higher priority. When the queue is full, the
+  // newest message of the lowest priority is dropped to make room.
+  bool Enqueue(const Message& message, Priority priority, uint32_t deadline);
+  // Enqueues `message` with no deadline.
+  bool Enqueue(const Message& message, Priority priority);
+
+  // Writes the next frame to `dest`, which must have space for `mtu` bytes.
+  // Returns the frame size in bytes, or 0 if there is nothing to send.
+  int NextFrame(uint32_t now, uint8_t* dest);
+
+  // Number of queued messages.
+  int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  int mtu() const { return mtu_; }
+  // Max bytes of messages that aren't real-time per frame.
+  int max_background_frame_size() const { return max_background_frame_size_; }
+  void set_max_background_frame_size(int size) {
+    max_background_frame_size_ = size;
+  }
+  const Stats& stats() const { return stats_; }
+
+  // Returns the usual priority for messages of `type`.
+  static Priority DefaultPriority(MessageType type);
+
+ private:
+  struct Entry {
+    Message message;
+    Priority priority;
+    bool has_deadline;
+    uint32_t deadline;
+    // Enqueue order, for FIFO among equal priority and deadline.
+    uint32_t sequence;
+  };
+
+  bool EnqueueInternal(const Message& message, Priority priority,
+                       bool has_deadline, uint32_t deadline);
+  // Returns true if `a` should be sent before `b`.
+  static bool Before(const Entry& a, const Entry& b);
+  // Removes entries_[i], filling the hole with the last entry.
+  void Remove(int i);
+
+  int mtu_;
+  int max_background_frame_size_;
+  Entry entries_[kCapacity];
+  int size_;
+  uint32_t next_sequence_;
+  Stats stats_;
+};
+
+}  // namespace audio_tactile
+
+#endif  // AUDIO_TO_TACTILE_SRC_CPP_MESSAGE_SCHEDULER_H_
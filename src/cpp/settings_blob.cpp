@@ -0,0 +1,161 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpp/settings_blob.h"  // NOLINT(build/include)
+
+#include "cpp/std_shim.h"  // NOLINT(build/include)
+#include "dsp/serialize.h"  // NOLINT(build/include)
+
+namespace audio_tactile {
+
+namespace {
+constexpr uint8_t kMagic[2] = {'A', 'S'};
+
+// Reads the next block from [*src, end). Returns the block size, or -1 if the
+// block is truncated. `*src` is updated to point to the block data.
+int NextBlock(const uint8_t** src, const uint8_t* end) {
+  if (end - *src < 1) { return -1; }
+  const int block_size = *(*src)++;
+  return (end - *src < block_size) ? -1 : block_size;
+}
+}  // namespace
+
+int WriteSettingsBlob(const Settings& settings,
+                      Slice<uint8_t, kSettingsBlobMaxSize> dest_slice) {
+  uint8_t* blob = dest_slice.data();
+  blob[0] = kMagic[0];
+  blob[1] = kMagic[1];
+  blob[2] = kSettingsBlobVersion;
+  uint8_t* dest = blob + kSettingsBlobHeaderSize;
+
+  // Write device name.
+  int block_size =
+      std_shim::min<int>(kMaxDeviceNameLength, strlen(settings.device_name));
+  *dest++ = block_size;
+  memcpy(dest, settings.device_name, block_size);
+  dest += block_size;
+
+  // Write input selection.
+  *dest++ = 1;
+  *dest++ = static_cast<uint8_t>(settings.input);
+
+  // Write tuning knobs.
+  *dest++ = kNumTuningKnobs;
+  memcpy(dest, settings.tuning.values, kNumTuningKnobs);
+  dest += kNumTuningKnobs;
+
+  // Write channel map.
+  const ChannelMap& channel_map = settings.channel_map;
+  const int num_out = std_shim::max<int>(0, std_shim::min<int>(
+      kChannelMapMaxChannels, channel_map.num_output_channels));
+  *dest++ = 2 + 2 * num_out;
+  *dest++ = channel_map.num_input_channels;
+  *dest++ = num_out;
+  for (int c = 0; c < num_out; ++c) {
+    *dest++ = channel_map.sources[c];
+  }
+  for (int c = 0; c < num_out; ++c) {
+    *dest++ = ChannelGainToControlValue(channel_map.gains[c]);
+  }
+
+  const int payload_size = dest - (blob + kSettingsBlobHeaderSize);
+  blob[3] = payload_size;
+  const int size = kSettingsBlobHeaderSize + payload_size;
+  ::LittleEndianWriteU32(::Fletcher32(blob, size, /*init=*/1), blob + size);
+  return size + kSettingsBlobChecksumSize;
+}
+
+bool ReadSettingsBlob(Slice<const uint8_t> blob, Settings* settings) {
+  const int size = blob.size();
+  const uint8_t* src = blob.data();
+  if (size < kSettingsBlobHeaderSize + kSettingsBlobChecksumSize ||
+      src[0] != kMagic[0] || src[1] != kMagic[1] ||
+      src[2] != kSettingsBlobVersion) {
+    return false;
+  }
+  const int payload_size = src[3];
+  if (size != kSettingsBlobHeaderSize + payload_size +
+                  kSettingsBlobChecksumSize) {
+    return false;
+  }
+  const int checked_size = kSettingsBlobHeaderSize + payload_size;
+  if (::LittleEndianReadU32(src + checked_size) !=
+      ::Fletcher32(src, checked_size, /*init=*/1)) {
+    return false;
+  }
+
+  // Decode into a temporary so that `settings` is unchanged on failure.
+  Settings decoded(*settings);
+  const uint8_t* end = src + checked_size;
+  src += kSettingsBlobHeaderSize;
+
+  // Read device name.
+  int block_size = NextBlock(&src, end);
+  if (!(0 <= block_size && block_size <= kMaxDeviceNameLength)) {
+    return false;
+  }
+  memcpy(decoded.device_name, src, block_size);
+  decoded.device_name[block_size] = '\0';
+  src += block_size;
+
+  // Read input selection.
+  if (NextBlock(&src, end) != 1 || *src > 1) { return false; }
+  decoded.input = static_cast<InputSelection>(*src++);
+
+  // Read tuning knobs.
+  if (NextBlock(&src, end) != kNumTuningKnobs) { return false; }
+  memcpy(decoded.tuning.values, src, kNumTuningKnobs);
+  src += kNumTuningKnobs;
+
+  // Read channel map.
+  block_size = NextBlock(&src, end);
+  if (block_size < 2) { return false; }
+  const int num_in = src[0];
+  const int num_out = src[1];
+  if (!(1 <= num_in && num_in <= kChannelMapMaxChannels &&
+        num_out <= kChannelMapMaxChannels && block_size == 2 + 2 * num_out)) {
+    return false;
+  }
+  ChannelMap& channel_map = decoded.channel_map;
+  channel_map.num_input_channels = num_in;
+  channel_map.num_output_channels = num_out;
+  src += 2;
+  for (int c = 0; c < num_out; ++c) {
+    if (src[c] >= num_in) { return false; }
+    channel_map.sources[c] = src[c];
+  }
+  src += num_out;
+  for (int c = 0; c < num_out; ++c) {
+    if (src[c] > 63) { return false; }
+    channel_map.gains[c] = ChannelGainFromControlValue(src[c]);
+  }
+  // Any bytes after the known blocks are from a newer writer and are ignored.
+
+  *settings = decoded;
+  return true;
+}
+
+void SettingsBlobWriter::SetStored(Slice<const uint8_t> blob) {
+  stored_size_ = std_shim::min<int>(kSettingsBlobMaxSize, blob.size());
+  memcpy(stored_, blob.data(), stored_size_);
+}
+
+bool SettingsBlobWriter::Changed(const Settings& settings) const {
+  uint8_t blob[kSettingsBlobMaxSize];
+  const int size =
+      WriteSettingsBlob(settings, Slice<uint8_t, kSettingsBlobMaxSize>(blob));
+  return size != stored_size_ || memcmp(blob, stored_, size);
+}
+
+}  // namespace audio_tactile
@@ -0,0 +1,152 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Compact binary encoding of `Settings` for storing in flash.
+//
+// The text format of settings.h is human-readable but slow to parse, since
+// each line goes through ParseKeyValue, knob name lookup, and integer parsing.
+// The binary "settings blob" is a small versioned, checksummed record that is
+// read with a few memcpys, making it suitable for reading on every boot. The
+// text format remains the import/export path.
+//
+// == Format ==
+//
+// All multibyte values are little endian.
+//
+//   Offset  Size  Description
+//   0       2     Magic bytes "AS".
+//   2       1     Format version, currently 1.
+//   3       1     Payload size in bytes, N.
+//   4       N     Payload, a sequence of blocks.
+//   4 + N   4     Fletcher32 checksum (init 1) of bytes [0, 4 + N).
+//
+// As in the OnConnectionBatch message, the payload is a sequence of blocks,
+// each beginning with a byte indicating the size of the block followed by the
+// block data:
+//
+//  * Device name, without null terminator.
+//  * Input selection, 1 byte: 0 = analog mic, 1 = PDM mic.
+//  * Tuning knob control values, one byte per knob.
+//  * Channel map, with one byte each for the number of input and output
+//    channels, then per output channel a base-0 source byte, and then per
+//    output channel a gain control value byte in 0-63.
+//
+// Readers ignore bytes after the known blocks, so that future versions can
+// append blocks without breaking older firmware. The version is incremented
+// only for incompatible changes.
+//
+// == Delta-aware writing ==
+//
+// `SettingsBlobWriter` remembers the blob last stored in flash and only calls
+// its write function when the newly encoded blob differs. Comparison is on
+// the encoded bytes, so a change in a float channel gain that doesn't change
+// its control value doesn't cause a rewrite.
+//
+// Example use:
+//
+//   SettingsBlobWriter writer;
+//   uint8_t blob[kSettingsBlobMaxSize];
+//   int blob_size = ReadBlobFromFlash(blob);  // User-defined.
+//   if (ReadSettingsBlob(Slice<const uint8_t>(blob, blob_size), &settings)) {
+//     writer.SetStored(Slice<const uint8_t>(blob, blob_size));
+//   }
+//   ...
+//   writer.Write(settings, [](const uint8_t* data, int size) {
+//     return WriteBlobToFlash(data, size);  // User-defined.
+//   });
+
+#ifndef AUDIO_TO_TACTILE_SRC_CPP_SETTINGS_BLOB_H_
+#define AUDIO_TO_TACTILE_SRC_CPP_SETTINGS_BLOB_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "cpp/settings.h"
+#include "cpp/slice.h"
+
+namespace audio_tactile {
+
+// Current format version of the settings blob.
+constexpr int kSettingsBlobVersion = 1;
+// Size of the header: magic, version, and payload size.
+constexpr int kSettingsBlobHeaderSize = 4;
+// Size of the trailing checksum.
+constexpr int kSettingsBlobChecksumSize = 4;
+// Max payload size, with all blocks at max size.
+constexpr int kSettingsBlobMaxPayloadSize =
+    (1 + kMaxDeviceNameLength) + (1 + 1) + (1 + kNumTuningKnobs) +
+    (1 + 2 + 2 * kChannelMapMaxChannels);
+// Max size of an encoded settings blob.
+constexpr int kSettingsBlobMaxSize = kSettingsBlobHeaderSize +
+                                     kSettingsBlobMaxPayloadSize +
+                                     kSettingsBlobChecksumSize;
+static_assert(kSettingsBlobMaxPayloadSize <= 255,
+              "Settings blob payload size must fit in one byte.");
+
+// Encodes `settings` as a settings blob in `dest`. Returns the blob size.
+int WriteSettingsBlob(const Settings& settings,
+                      Slice<uint8_t, kSettingsBlobMaxSize> dest);
+
+// Decodes settings blob `blob`. Returns true on success. Fails if the blob is
+// truncated, corrupt (checksum mismatch), has an unsupported version, or has
+// out-of-range fields. On failure, `settings` is not modified.
+bool ReadSettingsBlob(Slice<const uint8_t> blob, Settings* settings);
+
+// Writer that only rewrites the stored blob when settings have changed.
+class SettingsBlobWriter {
+ public:
+  SettingsBlobWriter() : stored_size_(0) {}
+
+  // Sets the blob that is currently stored, e.g. after reading it on boot.
+  void SetStored(Slice<const uint8_t> blob);
+  // Forgets the stored blob, so that the next Write() writes unconditionally.
+  void Reset() { stored_size_ = 0; }
+
+  // Returns true if `settings` differs from the stored blob.
+  bool Changed(const Settings& settings) const;
+
+  // Encodes `settings` and, if it differs from the stored blob, calls
+  // `write_fun` to store it. The callback has the signature
+  //
+  //   bool write_fun(const uint8_t* data, int size)
+  //
+  // and returns true on success. Returns true if the settings are unchanged or
+  // were written successfully, false if `write_fun` failed.
+  template <typename WriteFun>
+  bool Write(const Settings& settings, WriteFun write_fun);
+
+ private:
+  uint8_t stored_[kSettingsBlobMaxSize];
+  int stored_size_;
+};
+
+template <typename WriteFun>
+bool SettingsBlobWriter::Write(const Settings& settings, WriteFun write_fun) {
+  uint8_t blob[kSettingsBlobMaxSize];
+  const int size =
+      WriteSettingsBlob(settings, Slice<uint8_t, kSettingsBlobMaxSize>(blob));
+  if (size == stored_size_ && !memcmp(blob, stored_, size)) {
+    return true;  // Unchanged, skip writing.
+  }
+  if (!write_fun(static_cast<const uint8_t*>(blob), size)) { return false; }
+
+  memcpy(stored_, blob, size);
+  stored_size_ = size;
+  return true;
+}
+
+}  // namespace audio_tactile
+
+#endif  // AUDIO_TO_TACTILE_SRC_CPP_SETTINGS_BLOB_H_
@@ -0,0 +1,194 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpp/tactor_samples_codec.h"  // NOLINT(build/include)
+
+#include <string.h>
+
+namespace audio_tactile {
+
+namespace {
+enum { kFormatRaw = 0, kFormatRice = 1 };
+// Bits for the Rice parameter and the first sample of each channel.
+constexpr int kChannelHeaderBits = 3 + 8;
+constexpr int kNumDeltas = kNumPwmValues - 1;
+constexpr int kMaxRiceParam = 7;
+
+// Writes bits LSB first. The caller ensures there is space.
+class BitWriter {
+ public:
+  explicit BitWriter(uint8_t* dest) : dest_(dest), buffer_(0), num_bits_(0) {}
+
+  // Writes the low `num_bits` bits of `value`, where num_bits <= 24.
+  void Write(uint_fast32_t value, int num_bits) {
+    buffer_ |= (value & ((UINT32_C(1) << num_bits) - 1)) << num_bits_;
+    num_bits_ += num_bits;
+    while (num_bits_ >= 8) {
+      *dest_++ = static_cast<uint8_t>(buffer_);
+      buffer_ >>= 8;
+      num_bits_ -= 8;
+    }
+  }
+
+  // Writes any remaining bits, padding the last byte with zeros.
+  void Flush() {
+    if (num_bits_ > 0) { *dest_++ = static_cast<uint8_t>(buffer_); }
+    buffer_ = 0;
+    num_bits_ = 0;
+  }
+
+ private:
+  uint8_t* dest_;
+  uint_fast32_t buffer_;
+  int num_bits_;
+};
+
+// Reads bits LSB first, checking for reading past the end.
+class BitReader {
+ public:
+  BitReader(const uint8_t* src, int size)
+      : src_(src), end_(src + size), buffer_(0), num_bits_(0) {}
+
+  // Reads `num_bits` bits, where num_bits <= 24. Returns false on overrun.
+  bool Read(int num_bits, uint_fast32_t* value) {
+    while (num_bits_ < num_bits) {
+      if (src_ == end_) { return false; }
+      buffer_ |= static_cast<uint_fast32_t>(*src_++) << num_bits_;
+      num_bits_ += 8;
+    }
+    *value = buffer_ & ((UINT32_C(1) << num_bits) - 1);
+    buffer_ >>= num_bits;
+    num_bits_ -= num_bits;
+    return true;
+  }
+
+ private:
+  const uint8_t* src_;
+  const uint8_t* end_;
+  uint_fast32_t buffer_;
+  int num_bits_;
+};
+
+// Maps int8 delta to unsigned: 0, -1, 1, -2, 2, ... -> 0, 1, 2, 3, 4, ....
+int ZigzagDelta(int from, int to) {
+  const int delta = static_cast<int8_t>(static_cast<uint8_t>(to - from));
+  return (delta >= 0) ? 2 * delta : -2 * delta - 1;
+}
+
+// Inverse of ZigzagDelta, returning `to`.
+int UnzigzagDelta(int from, int u) {
+  const int delta = (u & 1) ? -((u + 1) >> 1) : (u >> 1);
+  return static_cast<uint8_t>(from + delta);
+}
+}  // namespace
+
+int CompressTactorsSamples(
+    Slice<const uint8_t, kNumAllTactorsSamples> samples,
+    Slice<uint8_t, kMaxCompressedTactorsSamplesSize> dest) {
+  uint8_t zigzag[kNumTotalPwm][kNumDeltas];
+  int rice_params[kNumTotalPwm];
+  int total_bits = 0;
+
+  for (int c = 0; c < kNumTotalPwm; ++c) {
+    int sum = 0;
+    for (int i = 0; i < kNumDeltas; ++i) {
+      const int u = ZigzagDelta(samples[c + i * kNumTotalPwm],
+                                samples[c + (i + 1) * kNumTotalPwm]);
+      zigzag[c][i] = static_cast<uint8_t>(u);
+      sum += u;
+    }
+    // Find the Rice parameter that minimizes the coded size of the deltas,
+    //   bits(k) = sum_i (u_i >> k) + kNumDeltas * (1 + k).
+    int best_k = 0;
+    int best_bits = sum + kNumDeltas;
+    for (int k = 1; k <= kMaxRiceParam; ++k) {
+      int bits = kNumDeltas * (1 + k);
+      for (int i = 0; i < kNumDeltas; ++i) { bits += zigzag[c][i] >> k; }
+      if (bits < best_bits) {
+        best_k = k;
+        best_bits = bits;
+      }
+    }
+    rice_params[c] = best_k;
+    total_bits += kChannelHeaderBits + best_bits;
+  }
+
+  if ((total_bits + 7) / 8 >= kNumAllTactorsSamples) {
+    // Rice coding doesn't help. Store the samples raw.
+    dest[0] = kFormatRaw;
+    memcpy(dest.data() + 1, samples.data(), kNumAllTactorsSamples);
+    return 1 + kNumAllTactorsSamples;
+  }
+
+  dest[0] = kFormatRice;
+  BitWriter writer(dest.data() + 1);
+  for (int c = 0; c < kNumTotalPwm; ++c) {
+    const int k = rice_params[c];
+    writer.Write(k, 3);
+    writer.Write(samples[c], 8);
+    for (int i = 0; i < kNumDeltas; ++i) {
+      const int u = zigzag[c][i];
+      // Write q = u >> k in unary as q one bits and a zero bit. Since u <= 255,
+      // q may exceed 24 bits when k = 0, so write in pieces.
+      int q = u >> k;
+      for (; q >= 16; q -= 16) { writer.Write(0xffff, 16); }
+      writer.Write((UINT32_C(1) << q) - 1, q + 1);
+      if (k > 0) { writer.Write(u, k); }
+    }
+  }
+  writer.Flush();
+  return 1 + (total_bits + 7) / 8;
+}
+
+bool DecompressTactorsSamples(Slice<const uint8_t> compressed,
+                              Slice<uint8_t, kNumAllTactorsSamples> samples) {
+  if (compressed.empty()) { return false; }
+
+  switch (compressed[0]) {
+    case kFormatRaw:
+      return samples.CopyFrom(compressed.tail(compressed.size() - 1));
+
+    case kFormatRice: {
+      BitReader reader(compressed.data() + 1, compressed.size() - 1);
+      for (int c = 0; c < kNumTotalPwm; ++c) {
+        uint_fast32_t k;
+        uint_fast32_t value;
+        if (!reader.Read(3, &k) || !reader.Read(8, &value)) { return false; }
+        samples[c] = static_cast<uint8_t>(value);
+        const int max_q = 255 >> k;
+
+        for (int i = 1; i < kNumPwmValues; ++i) {
+          int q = 0;
+          uint_fast32_t bit;
+          while (true) {
+            if (!reader.Read(1, &bit)) { return false; }
+            if (!bit) { break; }
+            if (++q > max_q) { return false; }  // Invalid unary code.
+          }
+          uint_fast32_t remainder = 0;
+          if (k > 0 && !reader.Read(k, &remainder)) { return false; }
+          const int u = static_cast<int>((q << k) | remainder);
+          samples[c + i * kNumTotalPwm] = static_cast<uint8_t>(UnzigzagDelta(
+              samples[c + (i - 1) * kNumTotalPwm], u));
+        }
+      }
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+}  // namespace audio_tactile
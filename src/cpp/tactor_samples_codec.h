@@ -0,0 +1,72 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Lossless compression of all-tactors PWM samples for the serial/BLE link.
+//
+// The samples are the same as in a kAllTactorsSamples message, kNumPwmValues
+// frames of kNumTotalPwm uint8 samples in interleaved order. Tactile signals
+// tend to change slowly over the 8 samples of an update, so each channel is
+// coded as its first sample followed by deltas between successive samples.
+// Deltas are coded with a Rice code, whose parameter `k` is chosen per channel
+// to minimize the size.
+//
+// The compressed format is a format byte followed by data:
+//
+//   Format 0 (raw):  96 bytes, the uncompressed samples.
+//   Format 1 (Rice): A bitstream, where bits are written LSB first in each
+//                    byte. For each channel:
+//
+//                      3 bits       Rice parameter k.
+//                      8 bits       First sample.
+//                      7 codes      Rice codes of the deltas.
+//
+// Each delta is wrapped to int8, then zigzag mapped to an unsigned value u
+// (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...), and coded as u >> k in unary as one
+// bits followed by a zero bit, then the low k bits of u. The encoder falls back
+// to format 0 when Rice coding doesn't help, so the compressed size is at most
+// kMaxCompressedTactorsSamplesSize = 97 bytes. Silence, where all samples are
+// equal, compresses to 28 bytes.
+//
+// Encoding and decoding use no dynamic allocation and a few hundred bytes of
+// stack, so they are suitable for the MCU.
+
+#ifndef AUDIO_TO_TACTILE_SRC_CPP_TACTOR_SAMPLES_CODEC_H_
+#define AUDIO_TO_TACTILE_SRC_CPP_TACTOR_SAMPLES_CODEC_H_
+
+#include <stdint.h>
+
+#include "cpp/constants.h"
+#include "cpp/slice.h"
+
+namespace audio_tactile {
+
+// Number of samples in an all-tactors PWM update.
+constexpr int kNumAllTactorsSamples = kNumTotalPwm * kNumPwmValues;
+// Max size in bytes of compressed samples.
+constexpr int kMaxCompressedTactorsSamplesSize = 1 + kNumAllTactorsSamples;
+
+// Compresses `samples` to `dest`. Returns the compressed size in bytes.
+int CompressTactorsSamples(
+    Slice<const uint8_t, kNumAllTactorsSamples> samples,
+    Slice<uint8_t, kMaxCompressedTactorsSamplesSize> dest);
+
+// Decompresses `compressed` to `samples`. Returns true on success, or false if
+// `compressed` is invalid, in which case `samples` may be partially written.
+bool DecompressTactorsSamples(Slice<const uint8_t> compressed,
+                              Slice<uint8_t, kNumAllTactorsSamples> samples);
+
+}  // namespace audio_tactile
+
+#endif  // AUDIO_TO_TACTILE_SRC_CPP_TACTOR_SAMPLES_CODEC_H_
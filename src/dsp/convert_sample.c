@@ -11,38 +11,233 @@
  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
  * See the License for the specific language governing permissions and
  * limitations under the License.
+ *
+ *
+ * The array conversions are in the hot path, converting every mic input buffer
+ * and every output buffer, so they are vectorized with SSE2 when compiling for
+ * x86. Other targets use the scalar loops, which compilers may auto-vectorize.
+ * The SSE2 code is written to round exactly as the scalar functions do.
  */
 
 #include "dsp/convert_sample.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CONVERT_SAMPLE_USE_SSE2 1
+#else
+#define CONVERT_SAMPLE_USE_SSE2 0
+#endif
+
+/* Converts int16_t to float as `scale * in[i]`. */
+static void Int16ToFloatWithScale(
+    const int16_t* in, int num_samples, float scale, float* out) {
+  int i = 0;
+#if CONVERT_SAMPLE_USE_SSE2
+  const __m128 scale_v = _mm_set1_ps(scale);
+  for (; i + 8 <= num_samples; i += 8) {
+    const __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+    /* Sign extend int16 to int32 by unpacking and arithmetic shifting. */
+    const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+    const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+    _mm_storeu_ps(out + i, _mm_mul_ps(scale_v, _mm_cvtepi32_ps(lo)));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(scale_v, _mm_cvtepi32_ps(hi)));
+  }
+#endif
+  for (; i < num_samples; ++i) {
+    out[i] = scale * in[i];
+  }
+}
+
+/* Converts int32_t to float as `scale * in[i]`. */
+static void Int32ToFloatWithScale(
+    const int32_t* in, int num_samples, float scale, float* out) {
+  int i = 0;
+#if CONVERT_SAMPLE_USE_SSE2
+  const __m128 scale_v = _mm_set1_ps(scale);
+  for (; i + 4 <= num_samples; i += 4) {
+    const __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+    _mm_storeu_ps(out + i, _mm_mul_ps(scale_v, _mm_cvtepi32_ps(x)));
+  }
+#endif
+  for (; i < num_samples; ++i) {
+    out[i] = scale * (float)in[i];
+  }
+}
+
 void ConvertSampleArrayInt16ToFloat(
     const int16_t* in, int num_samples, float* out) {
-  int i;
-  for (i = 0; i < num_samples; ++i) {
-    out[i] = ConvertSampleInt16ToFloat(in[i]);
-  }
+  /* Multiplying by 2^-15 is exact, so this is the same as dividing by 2^15. */
+  Int16ToFloatWithScale(in, num_samples, 1.0f / 32768.0f, out);
 }
 
 void ConvertSampleArrayInt32ToFloat(
     const int32_t* in, int num_samples, float* out) {
-  int i;
-  for (i = 0; i < num_samples; ++i) {
-    out[i] = ConvertSampleInt32ToFloat(in[i]);
-  }
+  Int32ToFloatWithScale(in, num_samples, 1.0f / 2147483648.0f, out);
+}
+
+void ConvertSampleArrayInt16ToFloatWithGain(
+    const int16_t* in, int num_samples, float gain, float* out) {
+  Int16ToFloatWithScale(in, num_samples, gain / 32768.0f, out);
+}
+
+void ConvertSampleArrayInt32ToFloatWithGain(
+    const int32_t* in, int num_samples, float gain, float* out) {
+  Int32ToFloatWithScale(in, num_samples, gain / 2147483648.0f, out);
+}
+
+#if CONVERT_SAMPLE_USE_SSE2
+/* Computes ConvertSampleFloatToInt16() for 4 samples, as int32 values. */
+static __m128i FloatToInt16Sse2(__m128 x) {
+  __m128 value = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(32768.0f), x),
+                            _mm_set1_ps(0.5f));
+  /* Clamping before rounding down is equivalent, since the limits are
+   * integers.
+   */
+  value = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(-32768.0f)),
+                     _mm_set1_ps(32767.0f));
+  /* SSE2 has no floor. Truncate, then subtract 1 where truncation rounded up,
+   * which is where the comparison mask is all ones = -1.
+   */
+  const __m128i truncated = _mm_cvttps_epi32(value);
+  const __m128 rounded_up = _mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), value);
+  return _mm_add_epi32(truncated, _mm_castps_si128(rounded_up));
 }
+#endif
 
 void ConvertSampleArrayFloatToInt16(
     const float* in, int num_samples, int16_t* out) {
-  int i;
-  for (i = 0; i < num_samples; ++i) {
+  int i = 0;
+#if CONVERT_SAMPLE_USE_SSE2
+  for (; i + 8 <= num_samples; i += 8) {
+    const __m128i lo = FloatToInt16Sse2(_mm_loadu_ps(in + i));
+    const __m128i hi = FloatToInt16Sse2(_mm_loadu_ps(in + i + 4));
+    _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(lo, hi));
+  }
+#endif
+  for (; i < num_samples; ++i) {
     out[i] = ConvertSampleFloatToInt16(in[i]);
   }
 }
 
 void ConvertSampleArrayFloatToInt32(
     const float* in, int num_samples, int32_t* out) {
+  int i = 0;
+#if CONVERT_SAMPLE_USE_SSE2
+  const __m128 scale = _mm_set1_ps(2147483648.0f);
+  for (; i + 4 <= num_samples; i += 4) {
+    const __m128 value = _mm_mul_ps(scale, _mm_loadu_ps(in + i));
+    /* Out of range values convert to 0x80000000 = INT32_MIN. This is correct
+     * for large negative values. For large positive values, flip the bits to
+     * get 0x7fffffff = INT32_MAX.
+     */
+    const __m128i too_large = _mm_castps_si128(_mm_cmpge_ps(value, scale));
+    _mm_storeu_si128((__m128i*)(out + i),
+                     _mm_xor_si128(_mm_cvttps_epi32(value), too_large));
+  }
+#endif
+  for (; i < num_samples; ++i) {
+    out[i] = ConvertSampleFloatToInt32(in[i]);
+  }
+}
+
+void ConvertSampleArrayPacked24ToInt32(
+    const uint8_t* in, int num_samples, int32_t* out) {
+  int i = 0;
+#if CONVERT_SAMPLE_USE_SSE2
+  /* Each iteration loads 16 bytes to get 4 samples = 12 bytes, so the loop
+   * stops while 2 samples beyond those remain, to not read out of bounds.
+   */
+  for (; i + 6 <= num_samples; i += 4) {
+    const __m128i x = _mm_loadu_si128((const __m128i*)(in + 3 * i));
+    /* Byte shift so that the kth sample is in the low 3 bytes of s_k. */
+    const __m128i s01 = _mm_unpacklo_epi32(x, _mm_srli_si128(x, 3));
+    const __m128i s23 = _mm_unpacklo_epi32(_mm_srli_si128(x, 6),
+                                           _mm_srli_si128(x, 9));
+    /* Gather the low 32-bit words and shift the samples to the MSBs. */
+    _mm_storeu_si128((__m128i*)(out + i),
+                     _mm_slli_epi32(_mm_unpacklo_epi64(s01, s23), 8));
+  }
+#endif
+  for (; i < num_samples; ++i) {
+    const uint8_t* src = in + 3 * i;
+    out[i] = (int32_t)(((uint32_t)src[0] << 8) |
+                       ((uint32_t)src[1] << 16) |
+                       ((uint32_t)src[2] << 24));
+  }
+}
+
+void ConvertSampleArrayInt32ToPacked24(
+    const int32_t* in, int num_samples, uint8_t* out) {
+  int i = 0;
+#if CONVERT_SAMPLE_USE_SSE2
+  /* Each iteration stores 16 bytes, of which 12 are the packed samples and the
+   * last 4 are overwritten by the next iteration. As above, the loop stops
+   * while 2 samples remain to not write out of bounds.
+   */
+  const __m128i low_24_bits = _mm_set_epi32(0, 0xffffff, 0, 0xffffff);
+  const __m128i high_24_bits = _mm_set_epi32(0xffff, 0xff000000,
+                                             0xffff, 0xff000000);
+  for (; i + 6 <= num_samples; i += 4) {
+    const __m128i x = _mm_srli_epi32(
+        _mm_loadu_si128((const __m128i*)(in + i)), 8);
+    /* Within each 64-bit half, pack the two samples into 6 bytes. */
+    const __m128i pairs = _mm_or_si128(
+        _mm_and_si128(x, low_24_bits),
+        _mm_and_si128(_mm_srli_epi64(x, 8), high_24_bits));
+    /* Move the second pair next to the first. */
+    const __m128i packed = _mm_or_si128(
+        _mm_move_epi64(pairs),
+        _mm_slli_si128(_mm_unpackhi_epi64(pairs, _mm_setzero_si128()), 6));
+    _mm_storeu_si128((__m128i*)(out + 3 * i), packed);
+  }
+#endif
+  for (; i < num_samples; ++i) {
+    const uint32_t value = (uint32_t)in[i];
+    uint8_t* dest = out + 3 * i;
+    dest[0] = (uint8_t)(value >> 8);
+    dest[1] = (uint8_t)(value >> 16);
+    dest[2] = (uint8_t)(value >> 24);
+  }
+}
+
+void ConvertSampleArrayMulawToInt16(
+    const uint8_t* in, int num_samples, int16_t* out) {
+  static const int16_t kMulawTable[0x100] = {
+  -32124, -31100, -30076, -29052, -28028, -27004, -25980, -24956,
+  -23932, -22908, -21884, -20860, -19836, -18812, -17788, -16764,
+  -15996, -15484, -14972, -14460, -13948, -13436, -12924, -12412,
+  -11900, -11388, -10876, -10364,  -9852,  -9340,  -8828,  -8316,
+   -7932,  -7676,  -7420,  -7164,  -6908,  -6652,  -6396,  -6140,
+   -5884,  -5628,  -5372,  -5116,  -4860,  -4604,  -4348,  -4092,
+   -3900,  -3772,  -3644,  -3516,  -3388,  -3260,  -3132,  -3004,
+   -2876,  -2748,  -2620,  -2492,  -2364,  -2236,  -2108,  -1980,
+   -1884,  -1820,  -1756,  -1692,  -1628,  -1564,  -1500,  -1436,
+   -1372,  -1308,  -1244,  -1180,  -1116,  -1052,   -988,   -924,
+    -876,   -844,   -812,   -780,   -748,   -716,   -684,   -652,
+    -620,   -588,   -556,   -524,   -492,   -460,   -428,   -396,
+    -372,   -356,   -340,   -324,   -308,   -292,   -276,   -260,
+    -244,   -228,   -212,   -196,   -180,   -164,   -148,   -132,
+    -120,   -112,   -104,    -96,    -88,    -80,    -72,    -64,
+     -56,    -48,    -40,    -32,    -24,    -16,     -8,      0,
+   32124,  31100,  30076,  29052,  28028,  27004,  25980,  24956,
+   23932,  22908,  21884,  20860,  19836,  18812,  17788,  16764,
+   15996,  15484,  14972,  14460,  13948,  13436,  12924,  12412,
+   11900,  11388,  10876,  10364,   9852,   9340,   8828,   8316,
+    7932,   7676,   7420,   7164,   6908,   6652,   6396,   6140,
+    5884,   5628,   5372,   5116,   4860,   4604,   4348,   4092,
+    3900,   3772,   3644,   3516,   3388,   3260,   3132,   3004,
+    2876,   2748,   2620,   2492,   2364,   2236,   2108,   1980,
+    1884,   1820,   1756,   1692,   1628,   1564,   1500,   1436,
+    1372,   1308,   1244,   1180,   1116,   1052,    988,    924,
+     876,    844,    812,    780,    748,    716,    684,    652,
+     620,    588,    556,    524,    492,    460,    428,    396,
+     372,    356,    340,    324,    308,    292,    276,    260,
+     244,    228,    212,    196,    180,    164,    148,    132,
+     120,    112,    104,     96,     88,     80,     72,     64,
+      56,     48,     40,     32,     24,     16,      8,      0,
+  };
   int i;
   for (i = 0; i < num_samples; ++i) {
-    out[i] = ConvertSampleFloatToInt32(in[i]);
+    out[i] = kMulawTable[in[i]];
   }
 }
@@ -84,7 +84,11 @@ static int ConvertSampleFloatTo0_MaxValue(float sample, int max_value) {
   return (int)value;
 }
 
-/* Same as above, but converting an array of samples at once. */
+/* Same as above, but converting an array of samples at once. These functions
+ * are vectorized with SSE2 where available and give the same results as the
+ * single-sample functions. `in` and `out` may be the same array for
+ * conversions between int32 and float.
+ */
 void ConvertSampleArrayInt16ToFloat(
     const int16_t* in, int num_samples, float* out);
 void ConvertSampleArrayInt32ToFloat(
@@ -94,6 +98,38 @@ void ConvertSampleArrayFloatToInt16(
 void ConvertSampleArrayFloatToInt32(
     const float* in, int num_samples, int32_t* out);
 
+/* Converts int16_t samples to float and multiplies by `gain`, fusing the two
+ * into a single multiply per sample. This is useful to fold the input gain
+ * into converting mic samples, for instance
+ *
+ *   ConvertSampleArrayInt16ToFloatWithGain(
+ *       mic_int16, kAdcDataSize, TuningGetInputGain(&tuning), mic_float);
+ *
+ * The result equals gain * ConvertSampleInt16ToFloat(in[i]) up to round-off.
+ * For 12-bit ADC values in [-2048, 2048], include a factor of 16 in `gain`.
+ */
+void ConvertSampleArrayInt16ToFloatWithGain(
+    const int16_t* in, int num_samples, float gain, float* out);
+/* Same as above for int32_t samples. */
+void ConvertSampleArrayInt32ToFloatWithGain(
+    const int32_t* in, int num_samples, float gain, float* out);
+
+/* Unpacks 24-bit little endian samples, 3 bytes per sample as in 24-bit WAV
+ * files, into the most significant bits of int32_t samples. `in` has
+ * 3 * num_samples bytes.
+ */
+void ConvertSampleArrayPacked24ToInt32(
+    const uint8_t* in, int num_samples, int32_t* out);
+/* Packs the 24 most significant bits of int32_t samples as 3-byte little endian
+ * samples, the inverse of the above. The low 8 bits are truncated.
+ */
+void ConvertSampleArrayInt32ToPacked24(
+    const int32_t* in, int num_samples, uint8_t* out);
+
+/* Decodes 8-bit G.711 mu-law samples to int16_t with a lookup table. */
+void ConvertSampleArrayMulawToInt16(
+    const uint8_t* in, int num_samples, int16_t* out);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
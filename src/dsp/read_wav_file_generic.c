@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "dsp/convert_sample.h"
 #include "dsp/logging.h"
 #include "dsp/serialize.h"
 
@@ -34,6 +35,8 @@
 #define kWavMulawCode 7
 #define kWavPcmGuid "\x00\x00\x00\x00\x10\x00\x80\x00\x00\xAA\x00\x38\x9B\x71"
 #define kWavFactChunkSize 4
+/* Number of samples to read and convert at a time. */
+#define kReadChunkSamples 128
 
 
 static void ReadWithErrorCheck(void* bytes, size_t num_bytes, WavReader* w) {
@@ -69,83 +72,18 @@ static void SeekWithErrorCheck(size_t num_bytes, WavReader* w) {
   }
 }
 
-static uint8_t ReadUint8(WavReader* w) {
-  uint8_t byte;
-  ReadWithErrorCheck(&byte, 1, w);
-  return byte;
-}
-
-static int16_t ReadMulaw(WavReader* w) {
-  static const int16_t mulaw_table[0x100] = {
-  -32124, -31100, -30076, -29052, -28028, -27004, -25980, -24956,
-  -23932, -22908, -21884, -20860, -19836, -18812, -17788, -16764,
-  -15996, -15484, -14972, -14460, -13948, -13436, -12924, -12412,
-  -11900, -11388, -10876, -10364,  -9852,  -9340,  -8828,  -8316,
-   -7932,  -7676,  -7420,  -7164,  -6908,  -6652,  -6396,  -6140,
-   -5884,  -5628,  -5372,  -5116,  -4860,  -4604,  -4348,  -4092,
-   -3900,  -3772,  -3644,  -3516,  -3388,  -3260,  -3132,  -3004,
-   -2876,  -2748,  -2620,  -2492,  -2364,  -2236,  -2108,  -1980,
-   -1884,  -1820,  -1756,  -1692,  -1628,  -1564,  -1500,  -1436,
-   -1372,  -1308,  -1244,  -1180,  -1116,  -1052,   -988,   -924,
-    -876,   -844,   -812,   -780,   -748,   -716,   -684,   -652,
-    -620,   -588,   -556,   -524,   -492,   -460,   -428,   -396,
-    -372,   -356,   -340,   -324,   -308,   -292,   -276,   -260,
-    -244,   -228,   -212,   -196,   -180,   -164,   -148,   -132,
-    -120,   -112,   -104,    -96,    -88,    -80,    -72,    -64,
-     -56,    -48,    -40,    -32,    -24,    -16,     -8,      0,
-   32124,  31100,  30076,  29052,  28028,  27004,  25980,  24956,
-   23932,  22908,  21884,  20860,  19836,  18812,  17788,  16764,
-   15996,  15484,  14972,  14460,  13948,  13436,  12924,  12412,
-   11900,  11388,  10876,  10364,   9852,   9340,   8828,   8316,
-    7932,   7676,   7420,   7164,   6908,   6652,   6396,   6140,
-    5884,   5628,   5372,   5116,   4860,   4604,   4348,   4092,
-    3900,   3772,   3644,   3516,   3388,   3260,   3132,   3004,
-    2876,   2748,   2620,   2492,   2364,   2236,   2108,   1980,
-    1884,   1820,   1756,   1692,   1628,   1564,   1500,   1436,
-    1372,   1308,   1244,   1180,   1116,   1052,    988,    924,
-     876,    844,    812,    780,    748,    716,    684,    652,
-     620,    588,    556,    524,    492,    460,    428,    396,
-     372,    356,    340,    324,    308,    292,    276,    260,
-     244,    228,    212,    196,    180,    164,    148,    132,
-     120,    112,    104,     96,     88,     80,     72,     64,
-      56,     48,     40,     32,     24,     16,      8,      0,
-  };
-  return mulaw_table[ReadUint8(w)];
-}
-
 static uint16_t ReadUint16(WavReader* w) {
   uint8_t bytes[2];
   ReadWithErrorCheck(bytes, 2, w);
   return LittleEndianReadU16(bytes);
 }
 
-/* Reads 24 bits of data into the MSBs of a 32-bit int. */
-static uint32_t Read3BytesIntoUint32(WavReader* w) {
-  uint8_t bytes[3];
-  ReadWithErrorCheck(bytes, 3, w);
-  return (((uint32_t) bytes[0]) << 8)
-      | (((uint32_t) bytes[1]) << 16)
-      | (((uint32_t) bytes[2]) << 24);
-}
-
 static uint32_t ReadUint32(WavReader* w) {
   uint8_t bytes[4];
   ReadWithErrorCheck(bytes, 4, w);
   return LittleEndianReadU32(bytes);
 }
 
-static float ReadFloat32(WavReader* w) {
-  uint8_t bytes[4];
-  ReadWithErrorCheck(bytes, 4, w);
-  return LittleEndianReadF32(bytes);
-}
-
-static float ReadFloat64IntoFloat32(WavReader* w) {
-  uint8_t bytes[8];
-  ReadWithErrorCheck(bytes, 8, w);
-  return (float)LittleEndianReadF64(bytes);
-}
-
 static int ReadWavFmtChunk(WavReader* w, ReadWavInfo* info,
                            uint32_t chunk_size) {
   if (chunk_size < kWavFmtChunkMinSize) {
@@ -337,6 +275,64 @@ fail:
   return 0;
 }
 
+/* Converts `num_samples` samples from `src`, in the WAV file's format with
+ * `src_alignment_bytes` bytes per sample, to `dst`.
+ */
+static void ConvertChunk(const uint8_t* src, int num_samples,
+                         int destination_alignment_bytes,
+                         size_t src_alignment_bytes, char* dst) {
+  int16_t mulaw[kReadChunkSamples];
+  int i;
+  switch (destination_alignment_bytes) {
+    case 2:
+      switch (src_alignment_bytes) {
+        case 1:
+          ConvertSampleArrayMulawToInt16(src, num_samples, (int16_t*)dst);
+          break;
+        case 2:
+          /* Read 16-bit ints into a 16-bit container. */
+          for (i = 0; i < num_samples; ++i, src += 2) {
+            ((int16_t*)dst)[i] = LittleEndianReadS16(src);
+          }
+          break;
+      }
+      break;
+    case 4:
+      switch (src_alignment_bytes) {
+        case 1:
+          ConvertSampleArrayMulawToInt16(src, num_samples, mulaw);
+          for (i = 0; i < num_samples; ++i) {
+            ((int32_t*)dst)[i] = (int32_t)((uint32_t)(uint16_t)mulaw[i] << 16);
+          }
+          break;
+        case 2:
+          /* Read 16-bit ints into a 32-bit container. */
+          for (i = 0; i < num_samples; ++i, src += 2) {
+            ((int32_t*)dst)[i] =
+                (int32_t)((uint32_t)LittleEndianReadU16(src) << 16);
+          }
+          break;
+        case 3:
+          /* Read 24-bit ints into a 32-bit container. */
+          ConvertSampleArrayPacked24ToInt32(src, num_samples, (int32_t*)dst);
+          break;
+        case 4:
+          /* Read 32-bits into a float container. */
+          for (i = 0; i < num_samples; ++i, src += 4) {
+            ((float*)dst)[i] = LittleEndianReadF32(src);
+          }
+          break;
+        case 8:
+          /* Read 64-bits into a float container. */
+          for (i = 0; i < num_samples; ++i, src += 8) {
+            ((float*)dst)[i] = (float)LittleEndianReadF64(src);
+          }
+          break;
+      }
+      break;
+  }
+}
+
 static size_t ReadBytesAsSamples(WavReader* w, ReadWavInfo* info,
                                  char* dst_samples, size_t num_samples) {
   size_t samples_to_read;
@@ -369,46 +365,29 @@ static size_t ReadBytesAsSamples(WavReader* w, ReadWavInfo* info,
   }
   samples_to_read -= samples_to_read % info->num_channels;
 
-  for (current_sample = 0; current_sample < samples_to_read; ++current_sample) {
-    switch (info->destination_alignment_bytes) {
-      case 2:
-        switch (src_alignment_bytes) {
-          case 1:
-            ((int16_t*)dst_samples)[current_sample] = ReadMulaw(w);
-            break;
-          case 2:
-            /* Read 16-bit ints into a 16-bit container. */
-            ((int16_t*)dst_samples)[current_sample] = (int16_t)ReadUint16(w);
-            break;
-        }
-        break;
-      case 4:
-        switch (src_alignment_bytes) {
-          case 1:
-            ((int32_t*)dst_samples)[current_sample] =
-                ((int32_t)ReadMulaw(w)) << 16;
-            break;
-          case 2:
-            /* Read 16-bit ints into a 32-bit container. */
-            ((int32_t*)dst_samples)[current_sample] =
-                ((int32_t)ReadUint16(w)) << 16;
-            break;
-          case 3:
-            /* Read 24-bit ints into a 32-bit container. */
-            ((int32_t*)dst_samples)[current_sample] =
-                Read3BytesIntoUint32(w);
-            break;
-          case 4:
-            /* Read 32-bits into a float container. */
-            ((float*)dst_samples)[current_sample] = ReadFloat32(w);
-            break;
-          case 8:
-            /* Read 64-bits into a float container. */
-            ((float*)dst_samples)[current_sample] = ReadFloat64IntoFloat32(w);
-            break;
-        }
-        break;
+  /* Read the data in chunks and convert each chunk in bulk. */
+  uint8_t buffer[kReadChunkSamples * 8];
+  for (current_sample = 0; current_sample < samples_to_read;) {
+    size_t chunk_samples = samples_to_read - current_sample;
+    if (chunk_samples > kReadChunkSamples) {
+      chunk_samples = kReadChunkSamples;
+    }
+    const size_t num_bytes = chunk_samples * src_alignment_bytes;
+    const size_t read_bytes = w->read_fun(buffer, num_bytes, w->io_ptr);
+    if (read_bytes != num_bytes) {
+      w->has_error = 1;
+      if (w->eof_fun != NULL && w->eof_fun(w->io_ptr)) {
+        LOG_ERROR("Error: WAV file ended unexpectedly.\n");
+      }
+      /* Convert the samples that were read completely. */
+      chunk_samples = read_bytes / src_alignment_bytes;
     }
+
+    ConvertChunk(buffer, (int)chunk_samples, info->destination_alignment_bytes,
+                 src_alignment_bytes, dst_samples +
+                 current_sample * info->destination_alignment_bytes);
+    current_sample += chunk_samples;
+
     if (w->has_error) {
       /* Tolerate a truncated data chunk, just return what was read. */
       current_sample -= current_sample % info->num_channels;
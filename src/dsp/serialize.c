@@ -82,3 +82,33 @@ uint16_t Fletcher16(const uint8_t* data, size_t size, uint16_t init) {
 
   return (uint16_t)(sum2 << 8 | sum1);
 }
+
+uint32_t Fletcher32(const uint8_t* data, size_t size, uint32_t init) {
+  uint_fast32_t sum1 = init & 0xffff;
+  uint_fast32_t sum2 = init >> 16;
+
+  while (size > 0) {
+    /* After n steps:
+     *
+     *   sum1 <= 65534 + 255 n,
+     *   sum2 <= 65534 + 65534 n + 255 (n + 1) n / 2.
+     *
+     * So sum2 <= 2^32 - 1 for n <= 5552.
+     */
+    const size_t kMaxBlockSize = 5552;
+    const int block_size = (int)(size < kMaxBlockSize ? size : kMaxBlockSize);
+
+    int i;
+    for (i = 0; i < block_size; ++i) {
+      sum1 += data[i];
+      sum2 += sum1;
+    }
+
+    sum1 %= 65535;
+    sum2 %= 65535;
+    data += block_size;
+    size -= block_size;
+  }
+
+  return (uint32_t)(sum2 << 16 | sum1);
+}
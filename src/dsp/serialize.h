@@ -136,6 +136,18 @@ uint8_t Fletcher8(const uint8_t* data, size_t size, uint8_t init);
  * value for `init` is 1.
  */
 uint16_t Fletcher16(const uint8_t* data, size_t size, uint16_t init);
+/* Computes a 32-bit Fletcher checksum over bytes,
+ *
+ *   sum1 = (init1 + D0 + D1 + ...) % 65535,
+ *   sum2 = ((init2 + init1 + D0) + (init2 + init1 + D0 + D1) + ...) % 65535,
+ *   checksum = (sum2 << 16) | sum1.
+ *
+ * Unlike the usual Fletcher-32 over 16-bit words, data is summed bytewise, so
+ * that like the functions above it may be computed incrementally over chunks of
+ * any size. It is better than Fletcher16 at detecting errors in large data,
+ * e.g. files. A good starting value for `init` is 1.
+ */
+uint32_t Fletcher32(const uint8_t* data, size_t size, uint32_t init);
 
 
 /* Implementation details only below this line. ----------------------------- */
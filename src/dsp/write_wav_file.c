@@ -53,11 +53,25 @@ int WriteWavSamples24Bit(FILE* f, const int32_t* samples, size_t num_samples) {
   return WriteWavSamplesGeneric24Bit(&w, samples, num_samples);
 }
 
+int WriteWavHeaderFloat(FILE* f, size_t num_samples, int sample_rate_hz,
+                        int num_channels) {
+  WavWriter w = WavWriterLocal(f);
+  return WriteWavHeaderGenericFloat(&w, num_samples, sample_rate_hz,
+                                    num_channels);
+}
+
+int WriteWavSamplesFloat(FILE* f, const float* samples, size_t num_samples) {
+  WavWriter w = WavWriterLocal(f);
+  return WriteWavSamplesGenericFloat(&w, samples, num_samples);
+}
+
 int WriteWavFileInternal(const char* file_name, const void* samples,
                          size_t num_samples, int sample_rate_hz,
-                         int num_channels, int /* bool */ is_24_bit) {
+                         int num_channels, int bits_per_sample) {
+  /* bits_per_sample is 16 or 24 for PCM, or 32 for float. */
   if (file_name == NULL || sample_rate_hz <= 0 || num_channels <= 0 ||
-      num_samples % num_channels != 0 || num_samples > (UINT32_MAX - 60) / 2) {
+      num_samples % num_channels != 0 ||
+      num_samples > (UINT32_MAX - 60) / (bits_per_sample / 8)) {
     goto fail; /* Invalid input arguments. */
   }
   FILE* f = fopen(file_name, "wb");
@@ -67,20 +81,34 @@ int WriteWavFileInternal(const char* file_name, const void* samples,
     goto fail; /* Failed to open file_name for writing. */
   }
 
-  if (is_24_bit) {
-    WriteWavHeaderGeneric24Bit(&w, num_samples, sample_rate_hz, num_channels);
-  } else {
-    WriteWavHeaderGeneric(&w, num_samples, sample_rate_hz, num_channels);
+  switch (bits_per_sample) {
+    case 16:
+      WriteWavHeaderGeneric(&w, num_samples, sample_rate_hz, num_channels);
+      break;
+    case 24:
+      WriteWavHeaderGeneric24Bit(&w, num_samples, sample_rate_hz,
+                                 num_channels);
+      break;
+    case 32:
+      WriteWavHeaderGenericFloat(&w, num_samples, sample_rate_hz,
+                                 num_channels);
+      break;
   }
 
   if (w.has_error) {
     goto fail;
   }
 
-  if (is_24_bit) {
-    WriteWavSamplesGeneric24Bit(&w, (const int32_t*)samples, num_samples);
-  } else {
-    WriteWavSamplesGeneric(&w, (const int16_t*)samples, num_samples);
+  switch (bits_per_sample) {
+    case 16:
+      WriteWavSamplesGeneric(&w, (const int16_t*)samples, num_samples);
+      break;
+    case 24:
+      WriteWavSamplesGeneric24Bit(&w, (const int32_t*)samples, num_samples);
+      break;
+    case 32:
+      WriteWavSamplesGenericFloat(&w, (const float*)samples, num_samples);
+      break;
   }
 
   if (fclose(f)) {
@@ -96,12 +124,19 @@ fail:
 int WriteWavFile(const char* file_name, const int16_t* samples,
                  size_t num_samples, int sample_rate_hz, int num_channels) {
   return WriteWavFileInternal(file_name, samples, num_samples, sample_rate_hz,
-                              num_channels, 0);
+                              num_channels, 16);
 }
 
 int WriteWavFile24Bit(const char* file_name, const int32_t* samples,
                       size_t num_samples, int sample_rate_hz,
                       int num_channels) {
   return WriteWavFileInternal(file_name, samples, num_samples, sample_rate_hz,
-                              num_channels, 1);
+                              num_channels, 24);
+}
+
+int WriteWavFileFloat(const char* file_name, const float* samples,
+                      size_t num_samples, int sample_rate_hz,
+                      int num_channels) {
+  return WriteWavFileInternal(file_name, samples, num_samples, sample_rate_hz,
+                              num_channels, 32);
 }
@@ -13,7 +13,7 @@
  * limitations under the License.
  *
  *
- * C library to write 16 or 24-bit WAV files.
+ * C library to write 16 or 24-bit PCM or 32-bit float WAV files.
  *
  * The simplest usage of this API is to use the WriteWavFile function, which
  * requires the samples to be buffered at the application layer.
@@ -84,6 +84,21 @@ int WriteWavSamples24Bit(FILE* f, const int32_t* samples, size_t num_samples);
 int WriteWavFile24Bit(const char* file_name, const int32_t* samples,
                       size_t num_samples, int sample_rate_hz, int num_channels);
 
+/* Same functionality for 32-bit IEEE float WAV files. Samples are written
+ * as is, without clipping, so full scale is nominally [-1, 1]. The header uses
+ * the WAVE_FORMAT_EXTENSIBLE fmt extension, which is valid for any number of
+ * channels. Speaker positions in the channel mask are assigned as for PCM for
+ * up to 8 channels, and left unassigned (mask 0) otherwise, e.g. for tactile
+ * signals.
+ */
+
+int WriteWavHeaderFloat(FILE* f, size_t num_samples, int sample_rate_hz,
+                        int num_channels);
+int WriteWavSamplesFloat(FILE* f, const float* samples, size_t num_samples);
+
+int WriteWavFileFloat(const char* file_name, const float* samples,
+                      size_t num_samples, int sample_rate_hz, int num_channels);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
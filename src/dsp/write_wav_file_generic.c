@@ -19,9 +19,17 @@
 
 #include "dsp/write_wav_file_generic.h"
 
+#include "dsp/serialize.h"
+
 #define kWavFmtExtensionCode 0xFFFE
 #define kWavPcmCode 1
+#define kWavIeeeFloatingPointCode 3
+/* The fmt extension's SubFormat GUID is the format code followed by these 14
+ * bytes, for either PCM or IEEE float.
+ */
 #define kWavPcmGuid "\x00\x00\x00\x00\x10\x00\x80\x00\x00\xAA\x00\x38\x9B\x71"
+/* Number of samples to convert per write_fun call when writing float. */
+#define kFloatChunkSamples 256
 
 static void WriteWithErrorCheck(const void* bytes, size_t num_bytes,
                                 WavWriter* w) {
@@ -95,12 +103,15 @@ static uint32_t GetChannelMask(int num_channels) {
 
 int WriteWavHeaderGenericInternal(WavWriter* w, size_t num_samples,
                                   int sample_rate_hz, int num_channels,
-                                  int bits_per_sample) {
+                                  int bits_per_sample, int format_code) {
   /* The fmt chunk extension should be used when num_channels is more than 2,
    * when the number of bits per sample exceeds 16, when the number of bits per
    * sample does not match the container size, or when the channel to speaker
-   * mapping must be specified. Only these first two conditions are relevant. */
-  const int extended = num_channels > 2 || bits_per_sample > 16;
+   * mapping must be specified. Only these first two conditions are relevant.
+   * Non-PCM formats require a fact chunk, which we write only with the fmt
+   * extension, so we always use the extension for float. */
+  const int extended = num_channels > 2 || bits_per_sample > 16 ||
+      format_code != kWavPcmCode;
   const uint32_t fmt_chunk_size = extended ? 40 : 16;
   const uint32_t data_chunk_size = (bits_per_sample / 8) * num_samples;
   const uint32_t data_chunk_padding = data_chunk_size % 2;
@@ -140,7 +151,7 @@ int WriteWavHeaderGenericInternal(WavWriter* w, size_t num_samples,
     WriteUint16(22, w);             /* Size of the fmt extension. */
     WriteUint16(bits_per_sample, w); /* Valid bits per sample. */
     WriteUint32(GetChannelMask(num_channels), w); /* Channel mask. */
-    WriteUint16(kWavPcmCode, w);    /* Set linear PCM sample format. */
+    WriteUint16(format_code, w);    /* Set the sample format. */
     WriteWithErrorCheck(kWavPcmGuid, 14, w);
 
     /* Also write a fact chunk when using fmt extension. */
@@ -161,13 +172,20 @@ int WriteWavHeaderGenericInternal(WavWriter* w, size_t num_samples,
 int WriteWavHeaderGeneric(WavWriter* w, size_t num_samples, int sample_rate_hz,
                           int num_channels) {
   return WriteWavHeaderGenericInternal(w, num_samples, sample_rate_hz,
-                                       num_channels, 16);
+                                       num_channels, 16, kWavPcmCode);
 }
 
 int WriteWavHeaderGeneric24Bit(WavWriter* w, size_t num_samples,
                                int sample_rate_hz, int num_channels) {
   return WriteWavHeaderGenericInternal(w, num_samples, sample_rate_hz,
-                                       num_channels, 24);
+                                       num_channels, 24, kWavPcmCode);
+}
+
+int WriteWavHeaderGenericFloat(WavWriter* w, size_t num_samples,
+                               int sample_rate_hz, int num_channels) {
+  return WriteWavHeaderGenericInternal(w, num_samples, sample_rate_hz,
+                                       num_channels, 32,
+                                       kWavIeeeFloatingPointCode);
 }
 
 int WriteWavSamplesGeneric(WavWriter* w, const int16_t* samples,
@@ -208,3 +226,31 @@ int WriteWavSamplesGeneric24Bit(WavWriter* w, const int32_t* samples,
 
   return 1;
 }
+
+int WriteWavSamplesGenericFloat(WavWriter* w, const float* samples,
+                                size_t num_samples) {
+  /* Convert in chunks to make one write_fun call per chunk rather than one per
+   * byte, which matters for high channel counts.
+   */
+  uint8_t buffer[4 * kFloatChunkSamples];
+  if (w == NULL || w->io_ptr == NULL || samples == NULL) {
+    return 0;
+  }
+  w->has_error = 0; /* Clear the error flag. */
+  while (num_samples > 0) {
+    const size_t chunk_samples = num_samples < kFloatChunkSamples
+        ? num_samples : kFloatChunkSamples;
+    size_t i;
+    for (i = 0; i < chunk_samples; ++i) {
+      LittleEndianWriteF32(samples[i], buffer + 4 * i);
+    }
+    WriteWithErrorCheck(buffer, 4 * chunk_samples, w);
+    if (w->has_error) {
+      return 0;
+    }
+    samples += chunk_samples;
+    num_samples -= chunk_samples;
+  }
+  /* 32-bit samples never need a pad byte. */
+  return 1;
+}
@@ -13,8 +13,8 @@
  * limitations under the License.
  *
  *
- * 16 or 24-bit WAV writer. Don't use this file directly unless you are
- * adding support for a different kind of filesystem.
+ * 16 or 24-bit PCM or 32-bit float WAV writer. Don't use this file directly
+ * unless you are adding support for a different kind of filesystem.
  *
  * For reading local files, see write_wav_file.h.
  */
@@ -52,6 +52,12 @@ int WriteWavHeaderGeneric(WavWriter* w, size_t num_samples, int sample_rate_hz,
 int WriteWavHeaderGeneric24Bit(WavWriter* w, size_t num_samples,
                                int sample_rate_hz, int num_channels);
 
+/* Same as above but for 32-bit IEEE float samples. The header uses the
+ * WAVE_FORMAT_EXTENSIBLE fmt extension with a fact chunk.
+ */
+int WriteWavHeaderGenericFloat(WavWriter* w, size_t num_samples,
+                               int sample_rate_hz, int num_channels);
+
 /* Write samples into a WAV file.  samples should be interleaved, and
  * num_samples must be an integer multiple of num_channels. Returns 1 on
  * success, 0 on failure.
@@ -63,6 +69,10 @@ int WriteWavSamplesGeneric(WavWriter* w, const int16_t* samples,
 int WriteWavSamplesGeneric24Bit(WavWriter* w, const int32_t* samples,
                                 size_t num_samples);
 
+/* Same as above but writing 32-bit float samples. */
+int WriteWavSamplesGenericFloat(WavWriter* w, const float* samples,
+                                size_t num_samples);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
@@ -40,8 +40,17 @@ void AudioToTactileFlashSettings::Initialize() {
 }
 
 bool AudioToTactileFlashSettings::ReadSettingsFile(Settings* settings) {
-  if (!have_file_system_ ||
-      !(g_flash_file = g_flash_file_system.open(
+  if (!have_file_system_) { return false; }
+
+  // Read the blob. If the blob file is missing or corrupt, a write may have
+  // been interrupted before renaming the temporary file, so try that next.
+  if (ReadBlobFile(kFlashSettingsBlobFile, settings) ||
+      ReadBlobFile(kFlashSettingsTempFile, settings)) {
+    return true;
+  }
+
+  // Otherwise, import the text file.
+  if (!(g_flash_file = g_flash_file_system.open(
           kFlashSettingsFile, FILE_READ))) {
     return false;
   }
@@ -63,33 +72,90 @@ bool AudioToTactileFlashSettings::ReadSettingsFile(Settings* settings) {
       });
 
   g_flash_file.close();
-  last_written_settings_ = *settings;
+  // There is no valid blob yet, so the next WriteSettingsFile() writes one.
+  blob_writer_.Reset();
   Serial.println("FlashSettings: Read " kFlashSettingsFile);
   return true;
 }
 
 bool AudioToTactileFlashSettings::WriteSettingsFile(const Settings& settings) {
-  if (last_written_settings_ == settings) { return true; }
+  if (!blob_writer_.Changed(settings)) { return true; }
+
+  if (!have_file_system_) {
+    Serial.println("Unknown error writing to flash");
+    return false;
+  }
+
+  // Export the text file first. The blob writer records the blob once it is
+  // written, so writing the text file afterward would not be retried on
+  // failure.
+  if (!WriteTextFile(settings)) {
+    Serial.println("Unknown error writing to flash");
+    return false;
+  }
+
+  const bool success = blob_writer_.Write(
+      settings, [](const uint8_t* data, int size) {
+        // Write the blob to the temporary file, then replace the blob file.
+        if (!(g_flash_file = g_flash_file_system.open(
+                kFlashSettingsTempFile, O_WRONLY | O_CREAT | O_TRUNC))) {
+          return false;
+        }
+        const bool written =
+            static_cast<int>(g_flash_file.write(data, size)) == size;
+        g_flash_file.close();
+        if (!written) { return false; }
+        g_flash_file_system.remove(kFlashSettingsBlobFile);
+        return g_flash_file_system.rename(
+            kFlashSettingsTempFile, kFlashSettingsBlobFile);
+      });
+  if (!success) {
+    Serial.println("Unknown error writing to flash");
+    return false;
+  }
 
-  if (!have_file_system_ ||
-      !(g_flash_file = g_flash_file_system.open(
+  Serial.println("FlashSettings: Wrote " kFlashSettingsBlobFile);
+  return true;
+}
+
+bool AudioToTactileFlashSettings::ReadBlobFile(
+    const char* path, Settings* settings) {
+  if (!(g_flash_file = g_flash_file_system.open(path, FILE_READ))) {
+    return false;
+  }
+  uint8_t blob[kSettingsBlobMaxSize];
+  const int size = g_flash_file.read(blob, sizeof(blob));
+  g_flash_file.close();
+
+  if (size <= 0 ||
+      !ReadSettingsBlob(Slice<const uint8_t>(blob, size), settings)) {
+    Serial.print("FlashSettings: Invalid ");
+    Serial.println(path);
+    return false;
+  }
+
+  blob_writer_.SetStored(Slice<const uint8_t>(blob, size));
+  Serial.print("FlashSettings: Read ");
+  Serial.println(path);
+  return true;
+}
+
+bool AudioToTactileFlashSettings::WriteTextFile(const Settings& settings) {
+  if (!(g_flash_file = g_flash_file_system.open(
           kFlashSettingsFile,
           // Open file for writing. If the file does not yet exist, create it,
           // or if it already exists, overwrite it.
           O_WRONLY | O_CREAT | O_TRUNC))) {
-    Serial.println("Unknown error writing to flash");
     return false;
   }
 
-  settings.WriteFile(
+  const bool success = settings.WriteFile(
       [](const char* line) {
         return g_flash_file.write(line) >= 0 && g_flash_file.write('\n') == 1;
       });
 
   g_flash_file.close();
-  last_written_settings_ = settings;
-  Serial.println("FlashSettings: Wrote " kFlashSettingsFile);
-  return true;
+  return success;
 }
 
 }  // namespace audio_tactile
@@ -19,10 +19,20 @@
 #define AUDIO_TO_TACTILE_SRC_FLASH_SETTINGS_H_
 
 #include "cpp/settings.h"  // NOLINT(build/include)
+#include "cpp/settings_blob.h"  // NOLINT(build/include)
 
-// Path for the settings file. Must be a valid 8.3 FAT filename.
+// Paths for the settings files. Must be valid 8.3 FAT filenames.
 // https://en.wikipedia.org/wiki/8.3_filename
+//
+// Settings are stored as a binary settings blob (see settings_blob.h), which is
+// fast to read on boot. The blob is written to a temporary file that is then
+// renamed, so that an interrupted write leaves a valid blob in one of the two
+// files. The human-readable text file is exported alongside it. It is read
+// only if there is no valid blob, e.g. after updating from older firmware.
+// To import an edited text file, delete the blob file.
 #define kFlashSettingsFile "settings.cfg"
+#define kFlashSettingsBlobFile "settings.bin"
+#define kFlashSettingsTempFile "settings.tmp"
 
 namespace audio_tactile {
 
@@ -43,19 +53,25 @@ class AudioToTactileFlashSettings {
   // True if a FAT flash file system was found on the device.
   bool have_file_system() const { return have_file_system_; }
 
-  // Reads from settings.cfg flash file. Returns true on success.
+  // Reads settings from flash, from settings.bin if it is valid and otherwise
+  // from settings.cfg. Returns true on success.
   bool ReadSettingsFile(Settings* settings);
 
-  // Writes to settings.cfg flash file. The function compares `settings` to the
-  // last written settings, and only writes to flash if they differ. Returns
-  // true on success.
+  // Writes settings.bin and settings.cfg flash files. The function compares
+  // the encoded `settings` to the last written blob, and only writes to flash
+  // if they differ. Returns true on success.
   //
   // NOTE: Calls to this function should be rate limited to prevent prematurely
   // wearing out the flash.
   bool WriteSettingsFile(const Settings& settings);
 
  private:
-  Settings last_written_settings_;
+  // Reads a settings blob from flash file `path`. Returns true on success.
+  bool ReadBlobFile(const char* path, Settings* settings);
+  // Writes settings.cfg text file.
+  bool WriteTextFile(const Settings& settings);
+
+  SettingsBlobWriter blob_writer_;
   bool have_file_system_;
 };
 extern AudioToTactileFlashSettings FlashSettings;
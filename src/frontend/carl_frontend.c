@@ -81,9 +81,8 @@ CarlFrontend* CarlFrontendMake(const CarlFrontendParams* params) {
       !(params->pcen_delta > 0.0f)) {
     fprintf(stderr, "CarlFrontendMake: Invalid CarlFrontendParams.\n");
     return NULL;
-  } else if (!(params->block_size >= 1) ||
-             !((params->block_size & (params->block_size - 1)) == 0)) {
-    fprintf(stderr, "CarlFrontendMake: block_size must be a power of 2.\n");
+  } else if (!(params->block_size >= 1)) {
+    fprintf(stderr, "CarlFrontendMake: block_size must be positive.\n");
     return NULL;
   }
 
@@ -145,16 +144,23 @@ CarlFrontend* CarlFrontendMake(const CarlFrontendParams* params) {
 
   double pole = params->highest_pole_frequency_hz;
   double sample_rate_hz = params->input_sample_rate_hz;
+  int decimation = 1;  /* Total decimation factor applied so far. */
   int c = 0;
 
   /* Iterate channels, starting with the highest frequency and going down. */
   for (c = 0; c < num_channels; ++c) {
     const double kMaxSamplesPerCycle = 12.0;
-    /* Decimate by factor 2 if possible before the next filter. */
+    /* Decimate by factor 2 if possible before the next filter. The total
+     * decimation must divide block_size, so that every stage processes a whole
+     * number of samples per block. For a non-power-of-two block_size, e.g. 48 =
+     * 3 * 16, decimation stops at the largest power of two dividing it.
+     */
     if (pole < params->highest_pole_frequency_hz &&
         pole * kMaxSamplesPerCycle < sample_rate_hz &&
-        sample_rate_hz >= 2 * output_sample_rate_hz) {
+        sample_rate_hz >= 2 * output_sample_rate_hz &&
+        params->block_size % (2 * decimation) == 0) {
       sample_rate_hz /= 2.0;
+      decimation *= 2;
       frontend->channel_data[c].should_decimate = 1;
     } else {
       frontend->channel_data[c].should_decimate = 0;
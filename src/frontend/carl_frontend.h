@@ -39,7 +39,9 @@ struct CarlFrontendParams {
   /* Input sample rate in Hz. */
   float input_sample_rate_hz;
   /* Input block size, also the decimation factor. The output sample rate is
-   * input_sample_rate_hz / block_size. Must be a power of two.
+   * input_sample_rate_hz / block_size. Any positive size is allowed, but
+   * internal decimation of the low-frequency channels is limited to the largest
+   * power of two dividing block_size, so power-of-two sizes are cheapest.
    */
   int block_size;
   /* Highest frequency to look at in Hz. Pole frequency of channel 0. */
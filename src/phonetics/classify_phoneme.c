@@ -15,7 +15,10 @@
 
 #include "phonetics/classify_phoneme.h"
 
+#include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "phonetics/classify_phoneme_params.h"
 #include "phonetics/nn_ops.h"
@@ -35,6 +38,97 @@ const char* kClassifyPhonemeMannerNames[kClassifyPhonemeNumManners] = {
 const char* kClassifyPhonemePlaceNames[kClassifyPhonemeNumPlaces] = {
     "front", "middle", "back"};
 
+const ClassifyPhonemeModel kClassifyPhonemeDefaultModel = {
+    kDense1Weights, kDense1Bias,
+    kDense2Weights, kDense2Bias,
+    kDense3Weights, kDense3Bias,
+    kPhonemeWeights, kPhonemeBias,
+    kVadOutputWeights, kVadOutputBias,
+    kVowelOutputWeights, kVowelOutputBias,
+    kDiphthongOutputWeights, kDiphthongOutputBias,
+    kLaxVowelOutputWeights, kLaxVowelOutputBias,
+    kMannerOutputWeights, kMannerOutputBias,
+    kPlaceOutputWeights, kPlaceOutputBias,
+    kVoicedOutputWeights, kVoicedOutputBias,
+};
+
+/* Names, sizes, and ClassifyPhonemeModel fields of the tensors in model data.
+ * The names match the C names of the compiled-in weights, without the "k".
+ */
+typedef struct {
+  const char* name;
+  int size;
+  size_t field_offset;
+} TensorInfo;
+#define TENSOR_INFO(name, field, size) \
+  {name, size, offsetof(ClassifyPhonemeModel, field)}
+static const TensorInfo kTensorInfo[kClassifyPhonemeModelNumTensors] = {
+    TENSOR_INFO("Dense1Weights", dense1_weights, kInputUnits * kDense1Units),
+    TENSOR_INFO("Dense1Bias", dense1_bias, kDense1Units),
+    TENSOR_INFO("Dense2Weights", dense2_weights, kDense1Units * kDense2Units),
+    TENSOR_INFO("Dense2Bias", dense2_bias, kDense2Units),
+    TENSOR_INFO("Dense3Weights", dense3_weights, kDense2Units * kDense3Units),
+    TENSOR_INFO("Dense3Bias", dense3_bias, kDense3Units),
+    TENSOR_INFO("PhonemeWeights", phoneme_weights,
+                kDense3Units * kPhonemeUnits),
+    TENSOR_INFO("PhonemeBias", phoneme_bias, kPhonemeUnits),
+    TENSOR_INFO("VadOutputWeights", vad_output_weights,
+                kPhonemeUnits * kVadOutputUnits),
+    TENSOR_INFO("VadOutputBias", vad_output_bias, kVadOutputUnits),
+    TENSOR_INFO("VowelOutputWeights", vowel_output_weights,
+                kPhonemeUnits * kVowelOutputUnits),
+    TENSOR_INFO("VowelOutputBias", vowel_output_bias, kVowelOutputUnits),
+    TENSOR_INFO("DiphthongOutputWeights", diphthong_output_weights,
+                kPhonemeUnits * kDiphthongOutputUnits),
+    TENSOR_INFO("DiphthongOutputBias", diphthong_output_bias,
+                kDiphthongOutputUnits),
+    TENSOR_INFO("LaxVowelOutputWeights", lax_vowel_output_weights,
+                kPhonemeUnits * kLaxVowelOutputUnits),
+    TENSOR_INFO("LaxVowelOutputBias", lax_vowel_output_bias,
+                kLaxVowelOutputUnits),
+    TENSOR_INFO("MannerOutputWeights", manner_output_weights,
+                kPhonemeUnits * kMannerOutputUnits),
+    TENSOR_INFO("MannerOutputBias", manner_output_bias, kMannerOutputUnits),
+    TENSOR_INFO("PlaceOutputWeights", place_output_weights,
+                kPhonemeUnits * kPlaceOutputUnits),
+    TENSOR_INFO("PlaceOutputBias", place_output_bias, kPlaceOutputUnits),
+    TENSOR_INFO("VoicedOutputWeights", voiced_output_weights,
+                kPhonemeUnits * kVoicedOutputUnits),
+    TENSOR_INFO("VoicedOutputBias", voiced_output_bias, kVoicedOutputUnits),
+};
+#undef TENSOR_INFO
+
+int ClassifyPhonemeModelFromData(const ModelData* data,
+                                 ClassifyPhonemeModel* model) {
+  if (data->model_type != kModelDataClassifyPhoneme) {
+    fprintf(stderr, "Error: Model data is not a ClassifyPhoneme model.\n");
+    return 0;
+  }
+
+  ClassifyPhonemeModel result;
+  int i;
+  for (i = 0; i < kClassifyPhonemeModelNumTensors; ++i) {
+    const float* tensor = ModelDataFindTensor(
+        data, kTensorInfo[i].name, kTensorInfo[i].size);
+    if (tensor == NULL) { return 0; }
+    *(const float**)((char*)&result + kTensorInfo[i].field_offset) = tensor;
+  }
+
+  *model = result;
+  return 1;
+}
+
+void ClassifyPhonemeModelTensors(const ClassifyPhonemeModel* model,
+                                 ModelDataTensor* tensors) {
+  int i;
+  for (i = 0; i < kClassifyPhonemeModelNumTensors; ++i) {
+    tensors[i].name = kTensorInfo[i].name;
+    tensors[i].data = *(const float* const*)(
+        (const char*)model + kTensorInfo[i].field_offset);
+    tensors[i].size = kTensorInfo[i].size;
+  }
+}
+
 /* Finds the index of the largest score. */
 static int ScoreArgMax(const float* scores, int num_scores) {
   float max_value = scores[0];
@@ -63,40 +157,35 @@ static float BinaryScore(int in_size,
   return out[1];
 }
 
-void ClassifyPhoneme(const float* frames, ClassifyPhonemeLabels* labels,
-                     ClassifyPhonemeScores* scores) {
-  float buffer1[kDense1Units];
-  float buffer2[kDense2Units];
-
-  /* Run the common portion of the network. */
-  DenseReluLayer(kInputUnits, kDense1Units, frames,
-                 kDense1Weights, kDense1Bias, buffer1);
-  DenseReluLayer(kDense1Units, kDense2Units, buffer1,
-                 kDense2Weights, kDense2Bias, buffer2);
-  /* We can reuse buffer1 for the output, since kDense3Units < kDense1Units. */
-  DenseReluLayer(kDense2Units, kDense3Units, buffer2,
-                 kDense3Weights, kDense3Bias, buffer1);
+void ClassifyPhonemeLabelsFromPhoneme(int phoneme,
+                                      ClassifyPhonemeLabels* labels) {
+  labels->phoneme = phoneme;
 
-  /* If needed, reuse buffer2 for phonemes; kPhonemeUnits < kDense2Units. */
-  float* phoneme_scores = (scores != NULL) ? scores->phoneme : buffer2;
-  DenseLinearLayer(kDense3Units, kPhonemeUnits, buffer1,
-                   kPhonemeWeights, kPhonemeBias, phoneme_scores);
+  /* Category labels for manner, place, etc. are determined from the phoneme
+   * label (and not by argmax of category scores) through kCategoryLookUp.
+   * This ensures labels are consistent, e.g. phoneme 'n' is always a nasal.
+   */
+  const uint16_t categories = kCategoryLookUp[phoneme];
+  labels->manner = categories & 7;
+  labels->place = (categories >> 3) & 3;
+  labels->vad = (phoneme != 0);
+  labels->vowel = (categories >> 5) & 1;
+  labels->diphthong = (categories >> 6) & 1;
+  labels->lax_vowel = (categories >> 7) & 1;
+  labels->voiced = (categories >> 8) & 1;
+}
 
+/* Fills `labels` and `scores` from the phoneme output layer. `phoneme_scores`
+ * holds the phoneme logits; when `scores` is non-NULL, it must point to
+ * `scores->phoneme`.
+ */
+static void ClassifyFromPhonemeLogits(const ClassifyPhonemeModel* model,
+                                      const float* phoneme_scores,
+                                      ClassifyPhonemeLabels* labels,
+                                      ClassifyPhonemeScores* scores) {
   if (labels != NULL) {  /* Hard classification labels were requested. */
-    labels->phoneme = ScoreArgMax(phoneme_scores, kPhonemeUnits);
-
-    /* Category labels for manner, place, etc. are determined from the phoneme
-     * label (and not by argmax of category scores) through kCategoryLookUp.
-     * This ensures labels are consistent, e.g. phoneme 'n' is always a nasal.
-     */
-    const uint16_t categories = kCategoryLookUp[labels->phoneme];
-    labels->manner = categories & 7;
-    labels->place = (categories >> 3) & 3;
-    labels->vad = (labels->phoneme != 0);
-    labels->vowel = (categories >> 5) & 1;
-    labels->diphthong = (categories >> 6) & 1;
-    labels->lax_vowel = (categories >> 7) & 1;
-    labels->voiced = (categories >> 8) & 1;
+    ClassifyPhonemeLabelsFromPhoneme(
+        ScoreArgMax(phoneme_scores, kPhonemeUnits), labels);
   }
 
   if (scores != NULL) {  /* Soft classification scores were requested. */
@@ -104,29 +193,119 @@ void ClassifyPhoneme(const float* frames, ClassifyPhonemeLabels* labels,
 
     /* Manner classification output. */
     DenseLinearLayer(kPhonemeUnits, kMannerOutputUnits, scores->phoneme,
-                     kMannerOutputWeights, kMannerOutputBias,
+                     model->manner_output_weights, model->manner_output_bias,
                      scores->manner);
     Softmax(scores->manner, kMannerOutputUnits);
     /* Place classification output. */
     DenseLinearLayer(kPhonemeUnits, kPlaceOutputUnits, scores->phoneme,
-                     kPlaceOutputWeights, kPlaceOutputBias, scores->place);
+                     model->place_output_weights,
+                     model->place_output_bias, scores->place);
     Softmax(scores->place, kPlaceOutputUnits);
     /* Voice activity detection score. */
     scores->vad = BinaryScore(kPhonemeUnits, scores->phoneme,
-                              kVadOutputWeights, kVadOutputBias);
+                              model->vad_output_weights,
+                              model->vad_output_bias);
     /* Vowel / consonant score. */
     scores->vowel = BinaryScore(kPhonemeUnits, scores->phoneme,
-                                kVowelOutputWeights, kVowelOutputBias);
+                                model->vowel_output_weights,
+                                model->vowel_output_bias);
     /* Monophthong / diphthong score. */
     scores->diphthong = BinaryScore(
         kPhonemeUnits, scores->phoneme,
-        kDiphthongOutputWeights, kDiphthongOutputBias);
+        model->diphthong_output_weights, model->diphthong_output_bias);
     /* Lax / tense vowel score. */
     scores->lax_vowel = BinaryScore(
         kPhonemeUnits, scores->phoneme,
-        kLaxVowelOutputWeights, kLaxVowelOutputBias);
+        model->lax_vowel_output_weights, model->lax_vowel_output_bias);
     /* Voiced / unvoiced score. */
     scores->voiced = BinaryScore(kPhonemeUnits, scores->phoneme,
-                                 kVoicedOutputWeights, kVoicedOutputBias);
+                                 model->voiced_output_weights,
+                                 model->voiced_output_bias);
+  }
+}
+
+void ClassifyPhoneme(const float* frames, ClassifyPhonemeLabels* labels,
+                     ClassifyPhonemeScores* scores) {
+  ClassifyPhonemeWithModel(&kClassifyPhonemeDefaultModel, frames,
+                           labels, scores);
+}
+
+void ClassifyPhonemeWithModel(const ClassifyPhonemeModel* model,
+                              const float* frames,
+                              ClassifyPhonemeLabels* labels,
+                              ClassifyPhonemeScores* scores) {
+  float buffer1[kDense1Units];
+  float buffer2[kDense2Units];
+
+  /* Run the common portion of the network. */
+  DenseReluLayer(kInputUnits, kDense1Units, frames,
+                 model->dense1_weights, model->dense1_bias, buffer1);
+  DenseReluLayer(kDense1Units, kDense2Units, buffer1,
+                 model->dense2_weights, model->dense2_bias, buffer2);
+  /* We can reuse buffer1 for the output, since kDense3Units < kDense1Units. */
+  DenseReluLayer(kDense2Units, kDense3Units, buffer2,
+                 model->dense3_weights, model->dense3_bias, buffer1);
+
+  /* If needed, reuse buffer2 for phonemes; kPhonemeUnits < kDense2Units. */
+  float* phoneme_scores = (scores != NULL) ? scores->phoneme : buffer2;
+  DenseLinearLayer(kDense3Units, kPhonemeUnits, buffer1,
+                   model->phoneme_weights, model->phoneme_bias, phoneme_scores);
+
+  ClassifyFromPhonemeLogits(model, phoneme_scores, labels, scores);
+}
+
+/* Number of windows per chunk in ClassifyPhonemeBatch. */
+#define kBatchChunk 32
+
+void ClassifyPhonemeBatch(const float* frames, int num_outputs,
+                          ClassifyPhonemeLabels* labels,
+                          ClassifyPhonemeScores* scores) {
+  ClassifyPhonemeBatchWithModel(&kClassifyPhonemeDefaultModel, frames,
+                                num_outputs, labels, scores);
+}
+
+void ClassifyPhonemeBatchWithModel(const ClassifyPhonemeModel* model,
+                                   const float* frames, int num_outputs,
+                                   ClassifyPhonemeLabels* labels,
+                                   ClassifyPhonemeScores* scores) {
+  float buffer1[kBatchChunk * kDense1Units];
+  float buffer2[kBatchChunk * kDense2Units];
+
+  int start;
+  for (start = 0; start < num_outputs; start += kBatchChunk) {
+    const int chunk = (num_outputs - start < kBatchChunk)
+        ? num_outputs - start : kBatchChunk;
+    /* Windows overlap, so consecutive input rows are one frame apart. */
+    const float* in = frames + start * kNumCarlChannels;
+
+    /* Run the common portion of the network. */
+    DenseReluLayerBatch(chunk, kInputUnits, kNumCarlChannels, kDense1Units,
+                        in, model->dense1_weights, model->dense1_bias,
+                        buffer1);
+    DenseReluLayerBatch(chunk, kDense1Units, kDense1Units, kDense2Units,
+                        buffer1, model->dense2_weights, model->dense2_bias,
+                        buffer2);
+    DenseReluLayerBatch(chunk, kDense2Units, kDense2Units, kDense3Units,
+                        buffer2, model->dense3_weights, model->dense3_bias,
+                        buffer1);
+    /* Phoneme logits for all windows in the chunk, written to buffer2. */
+    DenseLinearLayerBatch(chunk, kDense3Units, kDense3Units, kPhonemeUnits,
+                          buffer1, model->phoneme_weights, model->phoneme_bias,
+                          buffer2);
+
+    int t;
+    for (t = 0; t < chunk; ++t) {
+      float* phoneme_scores = buffer2 + t * kPhonemeUnits;
+      ClassifyPhonemeScores* scores_t = NULL;
+      if (scores != NULL) {
+        scores_t = &scores[start + t];
+        memcpy(scores_t->phoneme, phoneme_scores,
+               sizeof(float) * kPhonemeUnits);
+        phoneme_scores = scores_t->phoneme;
+      }
+      ClassifyFromPhonemeLogits(model, phoneme_scores,
+                                (labels != NULL) ? &labels[start + t] : NULL,
+                                scores_t);
+    }
   }
 }
@@ -30,6 +30,8 @@
 #ifndef AUDIO_TO_TACTILE_SRC_PHONETICS_CLASSIFY_PHONEME_H_
 #define AUDIO_TO_TACTILE_SRC_PHONETICS_CLASSIFY_PHONEME_H_
 
+#include "phonetics/model_data.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -113,6 +115,90 @@ extern const char* kClassifyPhonemePlaceNames[kClassifyPhonemeNumPlaces];
 void ClassifyPhoneme(const float* frames, ClassifyPhonemeLabels* labels,
                      ClassifyPhonemeScores* scores);
 
+/* Batched version of ClassifyPhoneme for offline processing, classifying
+ * `num_outputs` consecutive windows at once. `frames` is a row-major array of
+ * `num_outputs + kClassifyPhonemeNumFrames - 1` consecutive CARL+PCEN frames.
+ * Output t classifies the window starting at frame t, the same as
+ *
+ *   ClassifyPhoneme(frames + t * kClassifyPhonemeNumChannels,
+ *                   &labels[t], &scores[t]).
+ *
+ * `labels` and `scores` are arrays of `num_outputs` elements; either may be
+ * NULL if that output isn't needed. The layers are evaluated as matrix-matrix
+ * products over a chunk of windows, so that weights are streamed from memory
+ * once per chunk instead of once per window. Disjoint ranges of windows may be
+ * processed concurrently from different threads.
+ */
+void ClassifyPhonemeBatch(const float* frames, int num_outputs,
+                          ClassifyPhonemeLabels* labels,
+                          ClassifyPhonemeScores* scores);
+
+/* Fills `labels` for a given phoneme index, as ClassifyPhoneme() does for the
+ * top-scoring phoneme. For instance, phoneme 0 gives the labels for silence.
+ */
+void ClassifyPhonemeLabelsFromPhoneme(int phoneme,
+                                      ClassifyPhonemeLabels* labels);
+
+/* Network weights. Each field points to a weights matrix in column-major order
+ * or a bias vector. ClassifyPhoneme() and ClassifyPhonemeBatch() use
+ * kClassifyPhonemeDefaultModel, the compiled-in weights. Alternatively, weights
+ * may be loaded at runtime from model data, see model_data.h.
+ */
+typedef struct {
+  const float* dense1_weights;
+  const float* dense1_bias;
+  const float* dense2_weights;
+  const float* dense2_bias;
+  const float* dense3_weights;
+  const float* dense3_bias;
+  const float* phoneme_weights;
+  const float* phoneme_bias;
+  const float* vad_output_weights;
+  const float* vad_output_bias;
+  const float* vowel_output_weights;
+  const float* vowel_output_bias;
+  const float* diphthong_output_weights;
+  const float* diphthong_output_bias;
+  const float* lax_vowel_output_weights;
+  const float* lax_vowel_output_bias;
+  const float* manner_output_weights;
+  const float* manner_output_bias;
+  const float* place_output_weights;
+  const float* place_output_bias;
+  const float* voiced_output_weights;
+  const float* voiced_output_bias;
+} ClassifyPhonemeModel;
+
+#define kClassifyPhonemeModelNumTensors 22
+
+/* Compiled-in network weights. */
+extern const ClassifyPhonemeModel kClassifyPhonemeDefaultModel;
+
+/* Sets `model` to point at the tensors in parsed model `data`, checking the
+ * model type and tensor sizes. The tensors are used in place, so `data` must
+ * remain valid while `model` is in use. Returns 1 on success, 0 on failure.
+ */
+int ClassifyPhonemeModelFromData(const ModelData* data,
+                                 ClassifyPhonemeModel* model);
+
+/* Gets the tensors of `model` for ModelDataSerialize(), filling `tensors`, an
+ * array of size kClassifyPhonemeModelNumTensors.
+ */
+void ClassifyPhonemeModelTensors(const ClassifyPhonemeModel* model,
+                                 ModelDataTensor* tensors);
+
+/* Same as ClassifyPhoneme, but using the weights in `model`. */
+void ClassifyPhonemeWithModel(const ClassifyPhonemeModel* model,
+                              const float* frames,
+                              ClassifyPhonemeLabels* labels,
+                              ClassifyPhonemeScores* scores);
+
+/* Same as ClassifyPhonemeBatch, but using the weights in `model`. */
+void ClassifyPhonemeBatchWithModel(const ClassifyPhonemeModel* model,
+                                   const float* frames, int num_outputs,
+                                   ClassifyPhonemeLabels* labels,
+                                   ClassifyPhonemeScores* scores);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
@@ -16,6 +16,9 @@
 #include "phonetics/embed_vowel.h"
 
 #include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "dsp/fast_fun.h"
 #include "phonetics/hexagon_interpolation.h"
@@ -36,6 +39,62 @@ const int kEmbedVowelNumTargets =
   sizeof(kEmbedVowelTargets) / sizeof(*kEmbedVowelTargets);
 const int kEmbedVowelNumChannels = kNumChannels;
 
+const EmbedVowelModel kEmbedVowelDefaultModel = {
+    kDense1Weights, kDense1Bias,
+    kDense2Weights, kDense2Bias,
+    kDense3Weights, kDense3Bias,
+};
+
+/* Names, sizes, and EmbedVowelModel fields of the tensors in model data. The
+ * names match the C names of the compiled-in weights, without the "k".
+ */
+typedef struct {
+  const char* name;
+  int size;
+  size_t field_offset;
+} TensorInfo;
+#define TENSOR_INFO(name, field, size) \
+  {name, size, offsetof(EmbedVowelModel, field)}
+static const TensorInfo kTensorInfo[kEmbedVowelModelNumTensors] = {
+    TENSOR_INFO("Dense1Weights", dense1_weights, kNumChannels * kDense1Units),
+    TENSOR_INFO("Dense1Bias", dense1_bias, kDense1Units),
+    TENSOR_INFO("Dense2Weights", dense2_weights, kDense1Units * kDense2Units),
+    TENSOR_INFO("Dense2Bias", dense2_bias, kDense2Units),
+    TENSOR_INFO("Dense3Weights", dense3_weights, kDense2Units * kDense3Units),
+    TENSOR_INFO("Dense3Bias", dense3_bias, kDense3Units),
+};
+#undef TENSOR_INFO
+
+int EmbedVowelModelFromData(const ModelData* data, EmbedVowelModel* model) {
+  if (data->model_type != kModelDataEmbedVowel) {
+    fprintf(stderr, "Error: Model data is not an EmbedVowel model.\n");
+    return 0;
+  }
+
+  EmbedVowelModel result;
+  int i;
+  for (i = 0; i < kEmbedVowelModelNumTensors; ++i) {
+    const float* tensor = ModelDataFindTensor(
+        data, kTensorInfo[i].name, kTensorInfo[i].size);
+    if (tensor == NULL) { return 0; }
+    *(const float**)((char*)&result + kTensorInfo[i].field_offset) = tensor;
+  }
+
+  *model = result;
+  return 1;
+}
+
+void EmbedVowelModelTensors(const EmbedVowelModel* model,
+                            ModelDataTensor* tensors) {
+  int i;
+  for (i = 0; i < kEmbedVowelModelNumTensors; ++i) {
+    tensors[i].name = kTensorInfo[i].name;
+    tensors[i].data = *(const float* const*)(
+        (const char*)model + kTensorInfo[i].field_offset);
+    tensors[i].size = kTensorInfo[i].size;
+  }
+}
+
 static float SquareDistance(const float coord[2],
                             const EmbedVowelTarget* target) {
   const float diff_x = coord[0] - target->coord[0];
@@ -68,18 +127,23 @@ int EmbedVowelTargetByName(const char* target_name) {
 }
 
 void EmbedVowel(const float* frame, float coord[2]) {
+  EmbedVowelWithModel(&kEmbedVowelDefaultModel, frame, coord);
+}
+
+void EmbedVowelWithModel(const EmbedVowelModel* model,
+                         const float* frame, float coord[2]) {
   float buffer1[kDense1Units];
   float buffer2[kDense2Units];
 
   /* First dense layer. */
   DenseReluLayer(kNumChannels, kDense1Units, frame,
-                 kDense1Weights, kDense1Bias, buffer1);
+                 model->dense1_weights, model->dense1_bias, buffer1);
   /* Second dense layer. */
   DenseReluLayer(kDense1Units, kDense2Units, buffer1,
-                 kDense2Weights, kDense2Bias, buffer2);
+                 model->dense2_weights, model->dense2_bias, buffer2);
   /* Third dense layer, bottleneck layer. */
   DenseLinearLayer(kDense2Units, kDense3Units, buffer2,
-                   kDense3Weights, kDense3Bias, coord);
+                   model->dense3_weights, model->dense3_bias, coord);
 
   const float radius = 1e-4f + HexagonNorm(coord[0], coord[1]);
   const float scale = FastTanh(radius) / radius;
@@ -42,6 +42,8 @@
 #ifndef AUDIO_TO_TACTILE_SRC_PHONETICS_EMBED_VOWEL_H_
 #define AUDIO_TO_TACTILE_SRC_PHONETICS_EMBED_VOWEL_H_
 
+#include "phonetics/model_data.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -76,6 +78,41 @@ int EmbedVowelClosestTarget(const float coord[2]);
  */
 int EmbedVowelTargetByName(const char* target_name);
 
+/* Network weights. Each field points to a weights matrix in column-major order
+ * or a bias vector. EmbedVowel() uses kEmbedVowelDefaultModel, the compiled-in
+ * weights. Alternatively, weights may be loaded at runtime from model data,
+ * see model_data.h.
+ */
+typedef struct {
+  const float* dense1_weights;
+  const float* dense1_bias;
+  const float* dense2_weights;
+  const float* dense2_bias;
+  const float* dense3_weights;
+  const float* dense3_bias;
+} EmbedVowelModel;
+
+#define kEmbedVowelModelNumTensors 6
+
+/* Compiled-in network weights. */
+extern const EmbedVowelModel kEmbedVowelDefaultModel;
+
+/* Sets `model` to point at the tensors in parsed model `data`, checking the
+ * model type and tensor sizes. The tensors are used in place, so `data` must
+ * remain valid while `model` is in use. Returns 1 on success, 0 on failure.
+ */
+int EmbedVowelModelFromData(const ModelData* data, EmbedVowelModel* model);
+
+/* Gets the tensors of `model` for ModelDataSerialize(), filling `tensors`, an
+ * array of size kEmbedVowelModelNumTensors.
+ */
+void EmbedVowelModelTensors(const EmbedVowelModel* model,
+                            ModelDataTensor* tensors);
+
+/* Same as EmbedVowel, but using the weights in `model`. */
+void EmbedVowelWithModel(const EmbedVowelModel* model,
+                         const float* frame, float coord[2]);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
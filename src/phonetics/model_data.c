@@ -0,0 +1,172 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "phonetics/model_data.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dsp/serialize.h"
+
+static const char kModelDataMagic[4] = {'A', '2', 'T', 'M'};
+/* Tensor data alignment in bytes. */
+#define kAlignment 16
+
+static size_t RoundUpToAlignment(size_t offset) {
+  return (offset + (kAlignment - 1)) & ~(size_t)(kAlignment - 1);
+}
+
+static int IsLittleEndianHost(void) {
+  const uint16_t one = 1;
+  return *(const uint8_t*)&one == 1;
+}
+
+int ModelDataParse(const void* bytes, size_t size, ModelData* model) {
+  const uint8_t* p = (const uint8_t*)bytes;
+  if (p == NULL || model == NULL) {
+    fprintf(stderr, "Error: Null argument.\n");
+    return 0;
+  } else if (!IsLittleEndianHost()) {
+    fprintf(stderr, "Error: Model data requires a little endian host.\n");
+    return 0;
+  } else if (((uintptr_t)p & (kAlignment - 1)) != 0) {
+    fprintf(stderr, "Error: Model data must be 16-byte aligned.\n");
+    return 0;
+  } else if (size < kModelDataHeaderSize ||
+             memcmp(p, kModelDataMagic, sizeof(kModelDataMagic)) != 0) {
+    fprintf(stderr, "Error: Not model data.\n");
+    return 0;
+  }
+
+  const uint32_t version = LittleEndianReadU32(p + 4);
+  const uint32_t num_tensors = LittleEndianReadU32(p + 12);
+  const uint32_t total_size = LittleEndianReadU32(p + 16);
+  if (version != kModelDataVersion) {
+    fprintf(stderr, "Error: Unsupported model data version %u.\n",
+            (unsigned)version);
+    return 0;
+  } else if (total_size != size ||
+             num_tensors > (size - kModelDataHeaderSize)
+                 / kModelDataDirectoryEntrySize) {
+    fprintf(stderr, "Error: Model data is truncated.\n");
+    return 0;
+  } else if (LittleEndianReadU32(p + 20) !=
+             Fletcher32(p + kModelDataHeaderSize,
+                        size - kModelDataHeaderSize, 1)) {
+    fprintf(stderr, "Error: Model data checksum mismatch.\n");
+    return 0;
+  }
+
+  uint32_t i;
+  for (i = 0; i < num_tensors; ++i) {
+    const uint8_t* entry =
+        p + kModelDataHeaderSize + i * kModelDataDirectoryEntrySize;
+    const uint32_t offset = LittleEndianReadU32(entry + 24);
+    const uint32_t tensor_size = LittleEndianReadU32(entry + 28);
+    if (memchr(entry, '\0', kModelDataMaxNameLength + 1) == NULL ||
+        (offset & (kAlignment - 1)) != 0 || offset > size ||
+        tensor_size > (size - offset) / sizeof(float)) {
+      fprintf(stderr, "Error: Model data has an invalid tensor entry.\n");
+      return 0;
+    }
+  }
+
+  model->model_type = (ModelDataType)LittleEndianReadU32(p + 8);
+  model->num_tensors = (int)num_tensors;
+  model->bytes = p;
+  model->size = size;
+  return 1;
+}
+
+const float* ModelDataFindTensor(const ModelData* model,
+                                 const char* name,
+                                 int expected_size) {
+  int i;
+  for (i = 0; i < model->num_tensors; ++i) {
+    const uint8_t* entry =
+        model->bytes + kModelDataHeaderSize + i * kModelDataDirectoryEntrySize;
+    if (strcmp((const char*)entry, name) == 0) {
+      const uint32_t offset = LittleEndianReadU32(entry + 24);
+      const uint32_t size = LittleEndianReadU32(entry + 28);
+      if (size != (uint32_t)expected_size) {
+        fprintf(stderr, "Error: Tensor \"%s\" has size %u, expected %d.\n",
+                name, (unsigned)size, expected_size);
+        return NULL;
+      }
+      return (const float*)(model->bytes + offset);
+    }
+  }
+
+  fprintf(stderr, "Error: Tensor \"%s\" not found in model data.\n", name);
+  return NULL;
+}
+
+size_t ModelDataSerializedSize(const ModelDataTensor* tensors,
+                               int num_tensors) {
+  size_t size = kModelDataHeaderSize
+      + (size_t)num_tensors * kModelDataDirectoryEntrySize;
+  int i;
+  for (i = 0; i < num_tensors; ++i) {
+    size = RoundUpToAlignment(size) + tensors[i].size * sizeof(float);
+  }
+  return size;
+}
+
+size_t ModelDataSerialize(ModelDataType model_type,
+                          const ModelDataTensor* tensors,
+                          int num_tensors,
+                          uint8_t* out) {
+  const size_t total_size = ModelDataSerializedSize(tensors, num_tensors);
+  if (total_size > UINT32_MAX) {
+    fprintf(stderr, "Error: Model data is too large.\n");
+    return 0;
+  }
+  memset(out, 0, total_size);
+
+  memcpy(out, kModelDataMagic, sizeof(kModelDataMagic));
+  LittleEndianWriteU32(kModelDataVersion, out + 4);
+  LittleEndianWriteU32((uint32_t)model_type, out + 8);
+  LittleEndianWriteU32((uint32_t)num_tensors, out + 12);
+  LittleEndianWriteU32((uint32_t)total_size, out + 16);
+
+  size_t offset = kModelDataHeaderSize
+      + (size_t)num_tensors * kModelDataDirectoryEntrySize;
+  int i;
+  for (i = 0; i < num_tensors; ++i) {
+    uint8_t* entry = out + kModelDataHeaderSize
+        + i * kModelDataDirectoryEntrySize;
+    const size_t name_length = strlen(tensors[i].name);
+    if (name_length > kModelDataMaxNameLength) {
+      fprintf(stderr, "Error: Tensor name \"%s\" is too long.\n",
+              tensors[i].name);
+      return 0;
+    }
+    memcpy(entry, tensors[i].name, name_length);
+
+    offset = RoundUpToAlignment(offset);
+    LittleEndianWriteU32((uint32_t)offset, entry + 24);
+    LittleEndianWriteU32((uint32_t)tensors[i].size, entry + 28);
+
+    int k;
+    for (k = 0; k < tensors[i].size; ++k, offset += sizeof(float)) {
+      LittleEndianWriteF32(tensors[i].data[k], out + offset);
+    }
+  }
+
+  LittleEndianWriteU32(Fletcher32(out + kModelDataHeaderSize,
+                                  total_size - kModelDataHeaderSize, 1),
+                       out + 20);
+  return total_size;
+}
@@ -0,0 +1,108 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Versioned binary format for phonetics network weights.
+ *
+ * Model data holds named float32 tensors so that network weights may be loaded
+ * at runtime instead of compiled in. The format is designed to be used in
+ * place, e.g. from a read-only memory-mapped file (see
+ * extras/tools/model_file.h) or from flash, without copying: tensors are stored
+ * 16-byte aligned in little endian order so that inference code can point
+ * directly at them. All integers are little endian uint32:
+ *
+ *   Offset  Size  Field
+ *   0       4     Magic "A2TM".
+ *   4       4     Format version, currently 1.
+ *   8       4     Model type, a ModelDataType value.
+ *   12      4     Number of tensors, N.
+ *   16      4     Total size in bytes.
+ *   20      4     Fletcher32 checksum of all bytes after this field.
+ *   24      32 N  Tensor directory. For each tensor:
+ *                   char name[24]   Name, NUL terminated and padded.
+ *                   uint32 offset   Byte offset of the tensor data.
+ *                   uint32 size     Number of float32 elements.
+ *   ...           Tensor data.
+ *
+ * In-place use requires a little endian host, which is checked by
+ * ModelDataParse.
+ */
+
+#ifndef AUDIO_TO_TACTILE_SRC_PHONETICS_MODEL_DATA_H_
+#define AUDIO_TO_TACTILE_SRC_PHONETICS_MODEL_DATA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define kModelDataVersion 1
+#define kModelDataHeaderSize 24
+#define kModelDataDirectoryEntrySize 32
+/* Max tensor name length, not counting the terminating NUL. */
+#define kModelDataMaxNameLength 23
+
+typedef enum {
+  kModelDataClassifyPhoneme = 1,
+  kModelDataEmbedVowel = 2,
+} ModelDataType;
+
+/* Parsed view of model data. It points into the parsed bytes. */
+typedef struct {
+  ModelDataType model_type;
+  int num_tensors;
+  const uint8_t* bytes;
+  size_t size;
+} ModelData;
+
+/* Parses and validates model data of `size` bytes, checking the header, that
+ * all tensors are in bounds and 16-byte aligned, and the checksum. `bytes`
+ * must itself be 16-byte aligned. No data is copied; `bytes` must remain valid
+ * while `model` is in use. Returns 1 on success, 0 on failure.
+ */
+int ModelDataParse(const void* bytes, size_t size, ModelData* model);
+
+/* Finds a tensor by name and checks that it has `expected_size` elements.
+ * Returns a pointer to the tensor data, or NULL on failure.
+ */
+const float* ModelDataFindTensor(const ModelData* model,
+                                 const char* name,
+                                 int expected_size);
+
+/* Tensor to serialize with ModelDataSerialize. */
+typedef struct {
+  const char* name;
+  const float* data;
+  int size;
+} ModelDataTensor;
+
+/* Computes the serialized size in bytes for the given tensors. */
+size_t ModelDataSerializedSize(const ModelDataTensor* tensors,
+                               int num_tensors);
+
+/* Serializes tensors to `out`, which must have space for
+ * ModelDataSerializedSize() bytes. Returns the number of bytes written, or 0 on
+ * failure (e.g. if a name is too long).
+ */
+size_t ModelDataSerialize(ModelDataType model_type,
+                          const ModelDataTensor* tensors,
+                          int num_tensors,
+                          uint8_t* out);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+#endif /* AUDIO_TO_TACTILE_SRC_PHONETICS_MODEL_DATA_H_ */
@@ -14,6 +14,11 @@
  */
 
 #include "phonetics/nn_ops.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
 #include "dsp/fast_fun.h"
 
 static float DotProduct(const float* x, const float* y, int size) {
@@ -53,6 +58,306 @@ void DenseReluLayer(int in_size,
   }
 }
 
+/* Block sizes for the batched dense layers. Rows are processed in blocks of
+ * kBatchRowBlock, small enough that the block of inputs stays in L1 cache while
+ * all weights columns are swept over it. Within a block, a micro tile of 4 rows
+ * x 4 columns is accumulated in registers.
+ */
+enum { kBatchRowBlock = 16, kTileSize = 4 };
+
+/* Computes a 4x4 tile of out[n, j] = relu?(in_n . weights_j + bias[j]). */
+static void DenseTile4x4(int in_size, int in_stride, int out_size,
+                         const float* in, const float* weights_col_j,
+                         const float* bias, int relu, float* out) {
+  const float* in0 = in;
+  const float* in1 = in0 + in_stride;
+  const float* in2 = in1 + in_stride;
+  const float* in3 = in2 + in_stride;
+  const float* w0 = weights_col_j;
+  const float* w1 = w0 + in_size;
+  const float* w2 = w1 + in_size;
+  const float* w3 = w2 + in_size;
+  float acc[kTileSize][kTileSize] = {{0.0f}};
+  int k;
+  for (k = 0; k < in_size; ++k) {
+    const float x0 = in0[k];
+    const float x1 = in1[k];
+    const float x2 = in2[k];
+    const float x3 = in3[k];
+    const float y0 = w0[k];
+    const float y1 = w1[k];
+    const float y2 = w2[k];
+    const float y3 = w3[k];
+    acc[0][0] += x0 * y0; acc[0][1] += x0 * y1;
+    acc[0][2] += x0 * y2; acc[0][3] += x0 * y3;
+    acc[1][0] += x1 * y0; acc[1][1] += x1 * y1;
+    acc[1][2] += x1 * y2; acc[1][3] += x1 * y3;
+    acc[2][0] += x2 * y0; acc[2][1] += x2 * y1;
+    acc[2][2] += x2 * y2; acc[2][3] += x2 * y3;
+    acc[3][0] += x3 * y0; acc[3][1] += x3 * y1;
+    acc[3][2] += x3 * y2; acc[3][3] += x3 * y3;
+  }
+
+  int r;
+  for (r = 0; r < kTileSize; ++r, out += out_size) {
+    int c;
+    for (c = 0; c < kTileSize; ++c) {
+      const float value = acc[r][c] + bias[c];
+      out[c] = relu ? Relu(value) : value;
+    }
+  }
+}
+
+static void DenseLayerBatch(int num_rows,
+                            int in_size,
+                            int in_stride,
+                            int out_size,
+                            const float* in,
+                            const float* weights,
+                            const float* bias,
+                            int relu,
+                            float* out) {
+  int row_block;
+  for (row_block = 0; row_block < num_rows; row_block += kBatchRowBlock) {
+    const int block_end = (row_block + kBatchRowBlock < num_rows)
+        ? row_block + kBatchRowBlock : num_rows;
+    /* Rows [row_block, tiled_end) are handled with 4x4 tiles. */
+    const int tiled_end =
+        row_block + ((block_end - row_block) / kTileSize) * kTileSize;
+    const float* weights_col_j = weights;
+    int j;
+    for (j = 0; j + kTileSize <= out_size;
+         j += kTileSize, weights_col_j += kTileSize * in_size) {
+      int n;
+      for (n = row_block; n < tiled_end; n += kTileSize) {
+        DenseTile4x4(in_size, in_stride, out_size, in + n * in_stride,
+                     weights_col_j, bias + j, relu, out + n * out_size + j);
+      }
+    }
+
+    /* Handle leftover rows and columns one dot product at a time. */
+    int n;
+    for (n = row_block; n < block_end; ++n) {
+      const float* in_n = in + n * in_stride;
+      float* out_n = out + n * out_size;
+      const int j_start = (n < tiled_end) ? j : 0;
+      int jj;
+      for (jj = j_start; jj < out_size; ++jj) {
+        const float value =
+            DotProduct(in_n, weights + jj * in_size, in_size) + bias[jj];
+        out_n[jj] = relu ? Relu(value) : value;
+      }
+    }
+  }
+}
+
+void DenseLinearLayerBatch(int num_rows,
+                           int in_size,
+                           int in_stride,
+                           int out_size,
+                           const float* in,
+                           const float* weights,
+                           const float* bias,
+                           float* out) {
+  DenseLayerBatch(num_rows, in_size, in_stride, out_size,
+                  in, weights, bias, 0, out);
+}
+
+void DenseReluLayerBatch(int num_rows,
+                         int in_size,
+                         int in_stride,
+                         int out_size,
+                         const float* in,
+                         const float* weights,
+                         const float* bias,
+                         float* out) {
+  DenseLayerBatch(num_rows, in_size, in_stride, out_size,
+                  in, weights, bias, 1, out);
+}
+
+/* Computes sum_k in[k] * weights[k, j] for column j of a block-sparse matrix.
+ * The sum is accumulated in the same order as DotProduct, so that a sparse
+ * matrix without pruning gives the same result as the dense layer.
+ */
+static float SparseColumnDot(const BlockSparseMatrix* weights, int j,
+                             const float* in) {
+  const int block_size = weights->block_size;
+  const int b_end = weights->col_start[j + 1];
+  const uint16_t* block_row = weights->block_row;
+  const float* w = weights->values + weights->col_start[j] * block_size;
+  float sum = 0.0f;
+  int b;
+  switch (block_size) {
+    case 4:
+      for (b = weights->col_start[j]; b < b_end; ++b, w += 4) {
+        const float* x = in + 4 * block_row[b];
+        sum += x[0] * w[0];
+        sum += x[1] * w[1];
+        sum += x[2] * w[2];
+        sum += x[3] * w[3];
+      }
+      break;
+    case 8:
+      for (b = weights->col_start[j]; b < b_end; ++b, w += 8) {
+        const float* x = in + 8 * block_row[b];
+        sum += x[0] * w[0];
+        sum += x[1] * w[1];
+        sum += x[2] * w[2];
+        sum += x[3] * w[3];
+        sum += x[4] * w[4];
+        sum += x[5] * w[5];
+        sum += x[6] * w[6];
+        sum += x[7] * w[7];
+      }
+      break;
+    default:
+      for (b = weights->col_start[j]; b < b_end; ++b, w += block_size) {
+        const float* x = in + block_size * block_row[b];
+        int i;
+        for (i = 0; i < block_size; ++i) {
+          sum += x[i] * w[i];
+        }
+      }
+  }
+  return sum;
+}
+
+void SparseDenseLinearLayer(const BlockSparseMatrix* weights,
+                            const float* in,
+                            const float* bias,
+                            float* out) {
+  const int out_size = weights->out_size;
+  int j;
+  for (j = 0; j < out_size; ++j) {
+    out[j] = SparseColumnDot(weights, j, in) + bias[j];
+  }
+}
+
+void SparseDenseReluLayer(const BlockSparseMatrix* weights,
+                          const float* in,
+                          const float* bias,
+                          float* out) {
+  const int out_size = weights->out_size;
+  int j;
+  for (j = 0; j < out_size; ++j) {
+    out[j] = Relu(SparseColumnDot(weights, j, in) + bias[j]);
+  }
+}
+
+/* BlockSparseMatrix with owned arrays, as allocated by BlockSparseMatrixMake.
+ * `matrix` must be the first member so that the two can be cast.
+ */
+typedef struct {
+  BlockSparseMatrix matrix;
+  uint16_t* col_start;
+  uint16_t* block_row;
+  float* values;
+} OwnedBlockSparseMatrix;
+
+static float BlockNorm(const float* w, int block_size) {
+  float sum = 0.0f;
+  int i;
+  for (i = 0; i < block_size; ++i) {
+    sum += w[i] * w[i];
+  }
+  return sqrt(sum);
+}
+
+/* Returns 1 if the block should be kept. */
+static int KeepBlock(const float* w, int block_size, float prune_threshold) {
+  if (prune_threshold > 0.0f) {
+    return BlockNorm(w, block_size) > prune_threshold;
+  }
+  int i;
+  for (i = 0; i < block_size; ++i) {
+    if (w[i] != 0.0f) { return 1; }
+  }
+  return 0;
+}
+
+BlockSparseMatrix* BlockSparseMatrixMake(int in_size,
+                                         int out_size,
+                                         int block_size,
+                                         const float* weights,
+                                         float prune_threshold) {
+  if (!(block_size >= 1) || !(in_size >= block_size) ||
+      in_size % block_size != 0 || !(out_size >= 1) ||
+      /* Block indices must fit in uint16_t. */
+      (long)(in_size / block_size) * out_size > 0xffff) {
+    fprintf(stderr, "BlockSparseMatrixMake: Invalid arguments.\n");
+    return NULL;
+  }
+
+  const int blocks_per_col = in_size / block_size;
+  int num_blocks = 0;
+  int j;
+  int r;
+  for (j = 0; j < out_size; ++j) {
+    for (r = 0; r < blocks_per_col; ++r) {
+      num_blocks += KeepBlock(weights + j * in_size + r * block_size,
+                              block_size, prune_threshold);
+    }
+  }
+
+  OwnedBlockSparseMatrix* owned = (OwnedBlockSparseMatrix*)malloc(
+      sizeof(OwnedBlockSparseMatrix));
+  if (owned == NULL) {
+    fprintf(stderr, "Error: Memory allocation failed.\n");
+    return NULL;
+  }
+  /* Allocate at least one element so that malloc doesn't return NULL. */
+  owned->col_start = (uint16_t*)malloc(sizeof(uint16_t) * (out_size + 1));
+  owned->block_row = (uint16_t*)malloc(
+      sizeof(uint16_t) * (num_blocks > 0 ? num_blocks : 1));
+  owned->values = (float*)malloc(
+      sizeof(float) * block_size * (num_blocks > 0 ? num_blocks : 1));
+  if (owned->col_start == NULL || owned->block_row == NULL ||
+      owned->values == NULL) {
+    fprintf(stderr, "Error: Memory allocation failed.\n");
+    BlockSparseMatrixFree(&owned->matrix);
+    return NULL;
+  }
+
+  int b = 0;
+  for (j = 0; j < out_size; ++j) {
+    owned->col_start[j] = b;
+    for (r = 0; r < blocks_per_col; ++r) {
+      const float* w = weights + j * in_size + r * block_size;
+      if (KeepBlock(w, block_size, prune_threshold)) {
+        int i;
+        for (i = 0; i < block_size; ++i) {
+          owned->values[b * block_size + i] = w[i];
+        }
+        owned->block_row[b] = r;
+        ++b;
+      }
+    }
+  }
+  owned->col_start[out_size] = b;
+
+  owned->matrix.in_size = in_size;
+  owned->matrix.out_size = out_size;
+  owned->matrix.block_size = block_size;
+  owned->matrix.col_start = owned->col_start;
+  owned->matrix.block_row = owned->block_row;
+  owned->matrix.values = owned->values;
+  return &owned->matrix;
+}
+
+void BlockSparseMatrixFree(BlockSparseMatrix* matrix) {
+  if (matrix != NULL) {
+    OwnedBlockSparseMatrix* owned = (OwnedBlockSparseMatrix*)matrix;
+    free(owned->values);
+    free(owned->block_row);
+    free(owned->col_start);
+    free(owned);
+  }
+}
+
+int BlockSparseMatrixNumBlocks(const BlockSparseMatrix* matrix) {
+  return matrix->col_start[matrix->out_size];
+}
+
 void Conv1DReluLayer(int in_frames,
                      int in_channels,
                      int out_channels,
@@ -19,6 +19,8 @@
 #ifndef AUDIO_TO_TACTILE_SRC_PHONETICS_NN_OPS_H_
 #define AUDIO_TO_TACTILE_SRC_PHONETICS_NN_OPS_H_
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -51,6 +53,99 @@ void DenseReluLayer(int in_size,
                     const float* bias,
                     float* out);
 
+/* Batched dense layer, applying DenseLinearLayer to `num_rows` inputs at once,
+ *
+ *   out[n, j] = (sum_k in[n * in_stride + k] * weights[k, j]) + bias[j],
+ *
+ * where
+ *   `in` holds `num_rows` input rows of size in_size, with row n starting at
+ *      `in + n * in_stride`. Rows may overlap (in_stride < in_size), e.g. to
+ *      run on sliding windows of frames without copying,
+ *   `weights` is a column-major matrix of shape [in_size, out_size],
+ *   `bias` is an array of size out_size,
+ *   `out` is a row-major matrix of shape [num_rows, out_size].
+ *
+ * This is a cache-blocked matrix-matrix product: each weights column is loaded
+ * once per block of rows rather than once per row, so it is much faster than
+ * calling DenseLinearLayer in a loop for offline processing. Results match
+ * DenseLinearLayer exactly, as each dot product is summed in the same order.
+ */
+void DenseLinearLayerBatch(int num_rows,
+                           int in_size,
+                           int in_stride,
+                           int out_size,
+                           const float* in,
+                           const float* weights,
+                           const float* bias,
+                           float* out);
+
+/* Same as above but with ReLU activation. */
+void DenseReluLayerBatch(int num_rows,
+                         int in_size,
+                         int in_stride,
+                         int out_size,
+                         const float* in,
+                         const float* weights,
+                         const float* bias,
+                         float* out);
+
+/* Block-sparse weights matrix of shape [in_size, out_size]. Each column is
+ * partitioned into blocks of `block_size` consecutive inputs (block_size x 1
+ * blocks), and only the nonzero blocks are stored. Column j has blocks
+ * b = col_start[j], ..., col_start[j + 1] - 1, where block b covers inputs
+ *
+ *   k = block_row[b] * block_size, ..., (block_row[b] + 1) * block_size - 1
+ *
+ * with weights values[b * block_size], ..., values[(b + 1) * block_size - 1].
+ * This is the same column-major order as dense weights, with zero blocks
+ * skipped, so tables can be exported the same way as dense ones.
+ */
+typedef struct {
+  int in_size;
+  int out_size;
+  int block_size;
+  const uint16_t* col_start;  /* Array of size out_size + 1. */
+  const uint16_t* block_row;  /* Array of size num_blocks. */
+  const float* values;        /* Array of size num_blocks * block_size. */
+} BlockSparseMatrix;
+
+/* Sparse counterpart of DenseLinearLayer,
+ *
+ *   out[j] = (sum_k in[k] * weights[k, j]) + bias[j],
+ *
+ * where `weights` is a BlockSparseMatrix. Block sizes 4 and 8 have unrolled
+ * kernels; other sizes work but are slower.
+ */
+void SparseDenseLinearLayer(const BlockSparseMatrix* weights,
+                            const float* in,
+                            const float* bias,
+                            float* out);
+
+/* Same as above but with ReLU activation. */
+void SparseDenseReluLayer(const BlockSparseMatrix* weights,
+                          const float* in,
+                          const float* bias,
+                          float* out);
+
+/* Makes a BlockSparseMatrix from dense column-major `weights` of shape
+ * [in_size, out_size], dropping blocks whose L2 norm is at most
+ * `prune_threshold`. With prune_threshold = 0, only all-zero blocks are dropped
+ * and the result is exactly equivalent to `weights`. `in_size` must be a
+ * multiple of `block_size`. The caller should free the result with
+ * BlockSparseMatrixFree. Returns NULL on failure.
+ */
+BlockSparseMatrix* BlockSparseMatrixMake(int in_size,
+                                         int out_size,
+                                         int block_size,
+                                         const float* weights,
+                                         float prune_threshold);
+
+/* Frees a BlockSparseMatrix made by BlockSparseMatrixMake. */
+void BlockSparseMatrixFree(BlockSparseMatrix* matrix);
+
+/* Gets the number of stored (nonzero) blocks. */
+int BlockSparseMatrixNumBlocks(const BlockSparseMatrix* matrix);
+
 /* Computes a 1D conv layer with ReLU activation,
  *
  *   out[n, k] = relu(sum_{dn, q} in[n + dn, q] * filters[q, dn, k] + bias[k]).
@@ -0,0 +1,207 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "phonetics/phoneme_scheduler.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Block energy below which input is considered digital silence, -120 dBFS.
+ * This is below the quantization noise of 16-bit audio.
+ */
+#define kDigitalSilenceEnergy 1e-12f
+
+void PhonemeSchedulerSetDefaultParams(PhonemeSchedulerParams* params) {
+  params->energy_threshold_db = 9.0f;
+  params->min_energy_db = -70.0f;
+  params->noise_floor_rise_db_per_s = 3.0f;
+  params->hangover_blocks = 12;  /* ~100 ms. */
+  params->silence_interval_blocks = 8;  /* 64 ms. */
+  params->score_decay = 0.8f;
+  params->model = NULL;
+}
+
+PhonemeScheduler* PhonemeSchedulerMake(const PhonemeSchedulerParams* params) {
+  if (params == NULL) {
+    fprintf(stderr, "Error: Null argument.\n");
+    return NULL;
+  } else if (!(params->hangover_blocks >= 0 &&
+               params->silence_interval_blocks >= 1 &&
+               0.0f <= params->score_decay && params->score_decay <= 1.0f &&
+               params->noise_floor_rise_db_per_s >= 0.0f)) {
+    fprintf(stderr, "Error: Invalid PhonemeSchedulerParams.\n");
+    return NULL;
+  }
+
+  PhonemeScheduler* scheduler =
+      (PhonemeScheduler*)malloc(sizeof(PhonemeScheduler));
+  if (scheduler == NULL) {
+    fprintf(stderr, "Error: Out of memory.\n");
+    return NULL;
+  }
+  scheduler->params = *params;
+  if (scheduler->params.model == NULL) {
+    scheduler->params.model = &kClassifyPhonemeDefaultModel;
+  }
+
+  /* Make frontend with the settings that ClassifyPhoneme expects. */
+  CarlFrontendParams frontend_params = kCarlFrontendDefaultParams;
+  frontend_params.input_sample_rate_hz = kPhonemeSchedulerSampleRateHz;
+  frontend_params.block_size = kPhonemeSchedulerBlockSize;
+  frontend_params.pcen_cross_channel_diffusivity = 60.0f;
+  scheduler->frontend = CarlFrontendMake(&frontend_params);
+  scheduler->workspace =
+      (float*)malloc(sizeof(float) * kPhonemeSchedulerBlockSize);
+  scheduler->frames = (float*)malloc(sizeof(float) *
+      kClassifyPhonemeNumFrames * kClassifyPhonemeNumChannels);
+  if (scheduler->frontend == NULL || scheduler->workspace == NULL ||
+      scheduler->frames == NULL) {
+    fprintf(stderr, "Error: Failed to make PhonemeScheduler.\n");
+    PhonemeSchedulerFree(scheduler);
+    return NULL;
+  }
+
+  const float block_duration_s =
+      (float)kPhonemeSchedulerBlockSize / kPhonemeSchedulerSampleRateHz;
+  scheduler->energy_threshold_ratio =
+      pow(10.0, params->energy_threshold_db / 10.0);
+  /* Full scale here is a sine wave of amplitude 1, with mean square 0.5. */
+  scheduler->min_energy = 0.5 * pow(10.0, params->min_energy_db / 10.0);
+  scheduler->noise_floor_rise =
+      pow(10.0, params->noise_floor_rise_db_per_s * block_duration_s / 10.0);
+
+  PhonemeSchedulerReset(scheduler);
+  return scheduler;
+}
+
+void PhonemeSchedulerFree(PhonemeScheduler* scheduler) {
+  if (scheduler) {
+    CarlFrontendFree(scheduler->frontend);
+    free(scheduler->workspace);
+    free(scheduler->frames);
+    free(scheduler);
+  }
+}
+
+void PhonemeSchedulerReset(PhonemeScheduler* scheduler) {
+  CarlFrontendReset(scheduler->frontend);
+  scheduler->num_frames = 0;
+  scheduler->noise_floor = -1.0f;
+  scheduler->hangover_counter = 0;
+  scheduler->blocks_since_eval = 0;
+
+  /* Start in silence. */
+  ClassifyPhonemeLabelsFromPhoneme(0, &scheduler->labels);
+  memset(&scheduler->scores, 0, sizeof(scheduler->scores));
+  scheduler->scores.phoneme[0] = 1.0f;
+
+  scheduler->num_blocks = 0;
+  scheduler->num_evals = 0;
+}
+
+/* Returns 1 if `input` is likely speech according to the energy gate, and
+ * updates the noise floor estimate.
+ */
+static int EnergyGate(PhonemeScheduler* scheduler, const float* input) {
+  float sum = 0.0f;
+  int i;
+  for (i = 0; i < kPhonemeSchedulerBlockSize; ++i) {
+    sum += input[i] * input[i];
+  }
+  const float energy = sum / kPhonemeSchedulerBlockSize;
+
+  if (energy < kDigitalSilenceEnergy) {
+    /* Digital silence, e.g. before a stream starts, says nothing about the
+     * noise. Letting it set the floor would latch the floor near zero, since
+     * the floor only rises by multiplication.
+     */
+  } else if (scheduler->noise_floor < 0.0f ||
+             energy < scheduler->noise_floor) {
+    scheduler->noise_floor = energy;
+  } else {
+    scheduler->noise_floor *= scheduler->noise_floor_rise;
+  }
+
+  return energy > scheduler->min_energy &&
+         energy > scheduler->energy_threshold_ratio * scheduler->noise_floor;
+}
+
+/* Decays held scores toward silence and updates held labels. */
+static void DecayHeldOutputs(PhonemeScheduler* scheduler) {
+  ClassifyPhonemeScores* scores = &scheduler->scores;
+  const float decay = scheduler->params.score_decay;
+  int i;
+  for (i = 0; i < kClassifyPhonemeNumPhonemes; ++i) {
+    scores->phoneme[i] *= decay;
+  }
+  scores->phoneme[0] += 1.0f - decay;  /* Phoneme 0 is silence. */
+  scores->vad *= decay;
+
+  if (scheduler->hangover_counter == 0 && scheduler->labels.phoneme != 0) {
+    ClassifyPhonemeLabelsFromPhoneme(0, &scheduler->labels);
+  }
+}
+
+int PhonemeSchedulerProcessSamples(PhonemeScheduler* scheduler,
+                                   const float* input,
+                                   ClassifyPhonemeLabels* labels,
+                                   ClassifyPhonemeScores* scores) {
+  const int num_channels = kClassifyPhonemeNumChannels;
+  const int window_size = kClassifyPhonemeNumFrames * num_channels;
+  const int speech_likely = EnergyGate(scheduler, input);
+
+  /* Shift the frame window and append the new frame. The frontend modifies
+   * its input, so it runs on a copy.
+   */
+  memmove(scheduler->frames, scheduler->frames + num_channels,
+          sizeof(float) * (window_size - num_channels));
+  memcpy(scheduler->workspace, input,
+         sizeof(float) * kPhonemeSchedulerBlockSize);
+  CarlFrontendProcessSamples(scheduler->frontend, scheduler->workspace,
+                             scheduler->frames + window_size - num_channels);
+  if (scheduler->num_frames < kClassifyPhonemeNumFrames) {
+    ++scheduler->num_frames;
+  }
+  ++scheduler->num_blocks;
+
+  if (speech_likely) {
+    scheduler->hangover_counter = scheduler->params.hangover_blocks + 1;
+  }
+  ++scheduler->blocks_since_eval;
+  const int evaluate =
+      scheduler->num_frames == kClassifyPhonemeNumFrames &&
+      (scheduler->hangover_counter > 0 ||
+       scheduler->blocks_since_eval >=
+           scheduler->params.silence_interval_blocks);
+
+  if (evaluate) {
+    ClassifyPhonemeWithModel(scheduler->params.model, scheduler->frames,
+                             &scheduler->labels, &scheduler->scores);
+    scheduler->blocks_since_eval = 0;
+    ++scheduler->num_evals;
+    if (scheduler->labels.vad) {  /* Network detected speech the gate missed. */
+      scheduler->hangover_counter = scheduler->params.hangover_blocks + 1;
+    }
+  } else {
+    DecayHeldOutputs(scheduler);
+  }
+  if (scheduler->hangover_counter > 0) { --scheduler->hangover_counter; }
+
+  if (labels != NULL) { *labels = scheduler->labels; }
+  if (scores != NULL) { *scores = scheduler->scores; }
+  return evaluate;
+}
@@ -0,0 +1,131 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Streaming CarlFrontend + ClassifyPhoneme with energy-gated inference.
+ *
+ * PhonemeScheduler runs the CarlFrontend on every block of input, but runs the
+ * phoneme classification network only when the block is likely to contain
+ * speech. The gate is a cheap energy check: the block's mean square is compared
+ * to an adaptive noise floor, costing one multiply-add per sample. Then:
+ *
+ *  - When the energy exceeds the noise floor by `energy_threshold_db`, the
+ *    network runs on every block, and keeps running for `hangover_blocks`
+ *    afterward so that weak phoneme tails are classified.
+ *
+ *  - Otherwise, the network runs at a reduced cadence, once every
+ *    `silence_interval_blocks` blocks, as a safety net for speech the energy
+ *    check misses. If such an evaluation detects speech (vad label), the
+ *    hangover is restarted as if the energy gate had opened.
+ *
+ * Between evaluations, labels are held from the last evaluation, except that
+ * once the hangover has ended they become silence. The phoneme and vad scores
+ * decay from the last evaluation toward silence by a factor `score_decay` per
+ * block; other scores are held.
+ *
+ * Input must be at 16 kHz in blocks of 128 samples, as ClassifyPhoneme
+ * requires.
+ */
+
+#ifndef AUDIO_TO_TACTILE_SRC_PHONETICS_PHONEME_SCHEDULER_H_
+#define AUDIO_TO_TACTILE_SRC_PHONETICS_PHONEME_SCHEDULER_H_
+
+#include "frontend/carl_frontend.h"
+#include "phonetics/classify_phoneme.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Input sample rate and block size that PhonemeScheduler requires. */
+#define kPhonemeSchedulerSampleRateHz 16000
+#define kPhonemeSchedulerBlockSize 128
+
+typedef struct {
+  /* Energy above the noise floor in dB at which a block is likely speech. */
+  float energy_threshold_db;
+  /* Absolute energy in dB (relative to full scale) below which a block is
+   * always considered silence.
+   */
+  float min_energy_db;
+  /* Rate in dB/s at which the noise floor estimate rises. It falls
+   * immediately to the energy of quieter blocks, except blocks of digital
+   * silence, which don't affect the estimate.
+   */
+  float noise_floor_rise_db_per_s;
+  /* Number of blocks to keep running the network after speech. */
+  int hangover_blocks;
+  /* Interval in blocks between network evaluations in silence. */
+  int silence_interval_blocks;
+  /* Factor in [0, 1] by which held scores decay toward silence per block. */
+  float score_decay;
+  /* Network weights, or NULL to use kClassifyPhonemeDefaultModel. */
+  const ClassifyPhonemeModel* model;
+} PhonemeSchedulerParams;
+
+/* Sets `params` to default values. */
+void PhonemeSchedulerSetDefaultParams(PhonemeSchedulerParams* params);
+
+typedef struct {
+  PhonemeSchedulerParams params;
+  CarlFrontend* frontend;
+  /* Workspace buffer with space for kPhonemeSchedulerBlockSize floats. */
+  float* workspace;
+  /* The kClassifyPhonemeNumFrames most recent frames, oldest first. */
+  float* frames;
+  /* Number of frames received since reset, saturating at the window size. */
+  int num_frames;
+  /* Linear energy thresholds and noise floor rise factor per block. */
+  float energy_threshold_ratio;
+  float min_energy;
+  float noise_floor_rise;
+  /* Noise floor estimate, or negative if not yet initialized. */
+  float noise_floor;
+  /* Blocks remaining in the hangover. */
+  int hangover_counter;
+  /* Blocks since the last network evaluation. */
+  int blocks_since_eval;
+  /* Labels and scores from the last evaluation, decayed between evaluations. */
+  ClassifyPhonemeLabels labels;
+  ClassifyPhonemeScores scores;
+
+  /* Statistics since reset. */
+  long num_blocks;
+  long num_evals;
+} PhonemeScheduler;
+
+/* Makes a PhonemeScheduler. The caller should free it when done with
+ * PhonemeSchedulerFree. Returns NULL on failure.
+ */
+PhonemeScheduler* PhonemeSchedulerMake(const PhonemeSchedulerParams* params);
+
+/* Frees a PhonemeScheduler. */
+void PhonemeSchedulerFree(PhonemeScheduler* scheduler);
+
+/* Resets to initial state. */
+void PhonemeSchedulerReset(PhonemeScheduler* scheduler);
+
+/* Processes a block of kPhonemeSchedulerBlockSize samples. `labels` and
+ * `scores` are filled with the current classification; either may be NULL.
+ * Returns 1 if the network was evaluated for this block, 0 if not.
+ */
+int PhonemeSchedulerProcessSamples(PhonemeScheduler* scheduler,
+                                   const float* input,
+                                   ClassifyPhonemeLabels* labels,
+                                   ClassifyPhonemeScores* scores);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+#endif /* AUDIO_TO_TACTILE_SRC_PHONETICS_PHONEME_SCHEDULER_H_ */
@@ -135,6 +135,68 @@ void EnvelopeTrackerDecodeRecord(const uint8_t* record, float* dest) {
   }
 }
 
+void EnvelopeTrackerDecoderInit(EnvelopeTrackerDecoder* decoder) {
+  int value;
+  for (value = 0; value < 256; ++value) {
+    decoder->energy_table[value] = DecodeEnergy((uint8_t)value);
+  }
+}
+
+/* Number of records decoded in parallel by EnvelopeTrackerDecodeRecords. */
+#define kDecodeLanes 16
+
+void EnvelopeTrackerDecodeRecords(const EnvelopeTrackerDecoder* decoder,
+                                  const uint8_t* records,
+                                  int num_records,
+                                  int dest_stride,
+                                  float* dest) {
+  const float* energy_table = decoder->energy_table;
+  int start;
+  /* Each iteration decodes a block of up to kDecodeLanes records. Within the
+   * block, the inner loops run over records with no dependence between lanes,
+   * so that lanes execute in parallel and may be vectorized on targets with
+   * gather instructions.
+   */
+  for (start = 0; start < num_records; start += kDecodeLanes) {
+    const int num_lanes = (num_records - start < kDecodeLanes)
+        ? num_records - start : kDecodeLanes;
+    const uint8_t* block = records + start * kEnvelopeTrackerRecordBytes;
+    float* block_dest = dest + start;
+    int cumulative[kDecodeLanes];
+    int r;
+    int i;
+
+    for (r = 0; r < num_lanes; ++r) {
+      cumulative[r] = block[r * kEnvelopeTrackerRecordBytes];
+      block_dest[r] = energy_table[cumulative[r]];
+    }
+
+    for (i = 1; i < kEnvelopeTrackerRecordPoints; i += 8) {
+      /* Offset of the current 24-bit group of codes within each record. */
+      const int offset = 1 + 3 * ((i - 1) / 8);
+      uint32_t pack24[kDecodeLanes];
+      int j;
+      for (r = 0; r < num_lanes; ++r) {
+        const uint8_t* src = block + r * kEnvelopeTrackerRecordBytes + offset;
+        pack24[r] = (uint32_t)src[0]
+                  | (uint32_t)src[1] << 8
+                  | (uint32_t)src[2] << 16;
+      }
+
+      for (j = 0; j < 8; ++j) {
+        float* column = block_dest + (i + j) * dest_stride;
+        for (r = 0; r < num_lanes; ++r) {
+          cumulative[r] += DecodeDelta((pack24[r] >> (3 * j)) & 7);
+          /* As in EnvelopeTrackerDecodeRecord, which passes `cumulative` to
+           * DecodeEnergy as a uint8_t, values wrap modulo 256.
+           */
+          column[r] = energy_table[cumulative[r] & 255];
+        }
+      }
+    }
+  }
+}
+
 /* Records `energy` as the next measurement, saving it in `buffer`. If the
  * buffer is filled, the record is encoded and the function returns 1.
  * Otherwise, it returns 0.
@@ -38,6 +38,12 @@
  *   uint8_t record[kEnvelopeTrackerRecordBytes] = ...
  *   float powers[kEnvelopeTrackerRecordPoints];
  *   EnvelopeTrackerDecodeRecord(record, powers);
+ *
+ *   // Decoding many records at once, e.g. server side.
+ *   EnvelopeTrackerDecoder decoder;
+ *   EnvelopeTrackerDecoderInit(&decoder);
+ *   EnvelopeTrackerDecodeRecords(&decoder, records, num_records,
+ *                                num_records, columns);
  */
 
 #ifndef AUDIO_TO_TACTILE_SRC_TACTILE_ENVELOPE_TRACKER_H_
@@ -98,6 +104,32 @@ void EnvelopeTrackerGetRecord(const EnvelopeTracker* tracker, uint8_t* dest);
  */
 void EnvelopeTrackerDecodeRecord(const uint8_t* record, float* dest);
 
+/* Decoder for bulk decoding of many records. */
+typedef struct {
+  /* Lookup table mapping encoded energy values to powers. */
+  float energy_table[256];
+} EnvelopeTrackerDecoder;
+
+/* Initializes the decoder's lookup table. */
+void EnvelopeTrackerDecoderInit(EnvelopeTrackerDecoder* decoder);
+
+/* Decodes `num_records` records, concatenated in `records`, to a columnar
+ * layout: the ith power of record r is written to `dest[i * dest_stride + r]`
+ * for i = 0, ..., kEnvelopeTrackerRecordPoints - 1. Column i is then a
+ * contiguous array of the ith point from all records. `dest_stride` must be at
+ * least `num_records`. The results are identical to decoding each record with
+ * EnvelopeTrackerDecodeRecord, but faster: records are decoded in
+ * independent lanes with a table lookup in place of a pow() per point.
+ *
+ * NOTE: Avoid a power-of-two `dest_stride` for large batches. Columns then map
+ * to the same cache sets, and writes to them evict each other.
+ */
+void EnvelopeTrackerDecodeRecords(const EnvelopeTrackerDecoder* decoder,
+                                  const uint8_t* records,
+                                  int num_records,
+                                  int dest_stride,
+                                  float* dest);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
@@ -19,6 +19,7 @@
 #include <stdlib.h>
 
 #include "dsp/butterworth.h"
+#include "tactile/stage_profiler.h"
 #include "tactile/tactor_equalizer.h"
 
 void PostProcessorSetDefaultParams(PostProcessorParams* params) {
@@ -84,6 +85,7 @@ void PostProcessorProcessSamples(PostProcessor* state,
                                  int num_frames) {
   const int num_channels = state->num_channels;
   const float max_amplitude = state->max_amplitude;
+  PROFILE_STAGE_BEGIN(kProfileStagePostProcessor);
   int n;
   for (n = 0; n < num_frames; ++n) {
     int c;
@@ -112,4 +114,5 @@ void PostProcessorProcessSamples(PostProcessor* state,
       ++input_output;
     }
   }
+  PROFILE_STAGE_END(kProfileStagePostProcessor);
 }
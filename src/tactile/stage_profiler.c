@@ -0,0 +1,111 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tactile/stage_profiler.h"
+
+#include "dsp/serialize.h"
+
+/* Accumulated measurements of the current window. */
+typedef struct {
+  uint32_t min;
+  uint32_t max;
+  uint64_t sum;
+  int count;
+} Accumulator;
+
+const TapOutDescriptor kStageProfilerTapOutDescriptor =
+    {"stage_profile", "uint32", 2, {kNumProfileStages, 3}};
+
+static uint32_t (*g_clock_fun)(void) = NULL;
+static Accumulator g_accumulators[kNumProfileStages];
+static StageProfilerStats g_stats[kNumProfileStages];
+static int g_has_stats[kNumProfileStages];
+
+static void ResetAccumulator(Accumulator* accumulator) {
+  accumulator->min = UINT32_MAX;
+  accumulator->max = 0;
+  accumulator->sum = 0;
+  accumulator->count = 0;
+}
+
+void StageProfilerSetClockFun(uint32_t (*fun)(void)) {
+  g_clock_fun = fun;
+}
+
+void StageProfilerReset(void) {
+  int stage;
+  for (stage = 0; stage < kNumProfileStages; ++stage) {
+    ResetAccumulator(&g_accumulators[stage]);
+    g_has_stats[stage] = 0;
+  }
+}
+
+uint32_t StageProfilerNow(void) {
+  return g_clock_fun ? g_clock_fun() : 0;
+}
+
+void StageProfilerRecord(int stage, uint32_t start) {
+  if (g_clock_fun == NULL || !(0 <= stage && stage < kNumProfileStages)) {
+    return;
+  }
+  /* Unsigned subtraction is correct when the clock wraps around. */
+  const uint32_t elapsed = g_clock_fun() - start;
+  Accumulator* accumulator = &g_accumulators[stage];
+  if (accumulator->count == 0) { ResetAccumulator(accumulator); }
+  if (elapsed < accumulator->min) { accumulator->min = elapsed; }
+  if (elapsed > accumulator->max) { accumulator->max = elapsed; }
+  accumulator->sum += elapsed;
+
+  if (++accumulator->count >= kStageProfilerWindow) {
+    /* Window complete. Publish the stats and start the next window. */
+    StageProfilerStats* stats = &g_stats[stage];
+    stats->min = accumulator->min;
+    stats->mean = (uint32_t)(accumulator->sum / accumulator->count);
+    stats->max = accumulator->max;
+    g_has_stats[stage] = 1;
+    ResetAccumulator(accumulator);
+  }
+}
+
+int StageProfilerGetStats(int stage, StageProfilerStats* stats) {
+  if (!(0 <= stage && stage < kNumProfileStages) || !g_has_stats[stage]) {
+    return 0;
+  }
+  *stats = g_stats[stage];
+  return 1;
+}
+
+const char* StageProfilerStageName(int stage) {
+  static const char* kNames[kNumProfileStages] = {
+    "CarlFrontend", "EmbedVowel", "Enveloper", "PostProcessor", "Pattern",
+  };
+  return (0 <= stage && stage < kNumProfileStages) ? kNames[stage] : NULL;
+}
+
+void StageProfilerCaptureTapOut(TapOutToken token) {
+  const TapOutSlice* slice = TapOutGetSlice(token);
+  if (slice == NULL || slice->size != 3 * 4 * kNumProfileStages) { return; }
+  uint8_t* dest = slice->data;
+  int stage;
+  for (stage = 0; stage < kNumProfileStages; ++stage) {
+    /* Stages without a complete window are written as zeros. */
+    const StageProfilerStats* stats = &g_stats[stage];
+    const int has_stats = g_has_stats[stage];
+    LittleEndianWriteU32(has_stats ? stats->min : 0, dest);
+    LittleEndianWriteU32(has_stats ? stats->mean : 0, dest + 4);
+    LittleEndianWriteU32(has_stats ? stats->max : 0, dest + 8);
+    dest += 12;
+  }
+}
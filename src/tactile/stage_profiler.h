@@ -0,0 +1,122 @@
+/* Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Lightweight per-stage profiling of the tactile processing.
+ *
+ * When compiled with STAGE_PROFILER_ENABLED=1, the processing stages
+ *
+ *   CarlFrontend     CarlFrontendProcessSamples() in TactileProcessor.
+ *   EmbedVowel       EmbedVowel() in TactileProcessor.
+ *   Enveloper        EnveloperProcessSamples() in TactileProcessor.
+ *   PostProcessor    PostProcessorProcessSamples().
+ *   Pattern          TactilePatternSynthesize().
+ *
+ * are timed with a clock function set by `StageProfilerSetClockFun()`. The
+ * clock returns a free-running 32-bit tick count in any unit, for instance
+ * the Cortex-M DWT cycle counter on the device or `clock_gettime()`
+ * nanoseconds on the host. Each call to a stage is one measurement. The
+ * profiler keeps min, mean, and max of each stage over a rolling window of
+ * kStageProfilerWindow calls, and publishes those of the last complete window.
+ *
+ * When STAGE_PROFILER_ENABLED is 0 (the default), the PROFILE_STAGE_* macros
+ * compile to nothing and processing has no overhead.
+ *
+ * Example use, publishing the stats as a tap-out output:
+ *
+ *   StageProfilerSetClockFun(ReadCycleCounter);
+ *   TapOutToken token = TapOutAddDescriptor(&kStageProfilerTapOutDescriptor);
+ *   ...
+ *   StageProfilerCaptureTapOut(token);  // Once per mic buffer.
+ *   TapOutFinishedCaptureBuffer();
+ *
+ * The tap-out output is a kNumProfileStages x 3 uint32 array, where the
+ * columns are min, mean, and max ticks.
+ */
+
+#ifndef AUDIO_TO_TACTILE_SRC_TACTILE_STAGE_PROFILER_H_
+#define AUDIO_TO_TACTILE_SRC_TACTILE_STAGE_PROFILER_H_
+
+#include <stdint.h>
+
+#include "tactile/tap_out.h"
+
+#ifndef STAGE_PROFILER_ENABLED
+#define STAGE_PROFILER_ENABLED 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Profiled processing stages. */
+enum {
+  kProfileStageCarlFrontend,
+  kProfileStageEmbedVowel,
+  kProfileStageEnveloper,
+  kProfileStagePostProcessor,
+  kProfileStagePattern,
+  kNumProfileStages,
+};
+
+/* Number of calls per rolling window. */
+enum { kStageProfilerWindow = 64 };
+
+/* Stats of one stage over a window, in clock ticks. */
+typedef struct {
+  uint32_t min;
+  uint32_t mean;
+  uint32_t max;
+} StageProfilerStats;
+
+/* Tap-out descriptor for the stats, a kNumProfileStages x 3 uint32 array. */
+extern const TapOutDescriptor kStageProfilerTapOutDescriptor;
+
+/* Sets the clock function. Profiling is inactive while it is NULL. */
+void StageProfilerSetClockFun(uint32_t (*fun)(void));
+
+/* Clears all measurements. */
+void StageProfilerReset(void);
+
+/* Returns the current clock ticks, or 0 if no clock is set. */
+uint32_t StageProfilerNow(void);
+
+/* Records a call to `stage` that started at tick `start`. */
+void StageProfilerRecord(int stage, uint32_t start);
+
+/* Gets stats of `stage` over the last complete window. Returns 1 on success, or
+ * 0 if no window has completed yet.
+ */
+int /*bool*/ StageProfilerGetStats(int stage, StageProfilerStats* stats);
+
+/* Gets the name of `stage`. */
+const char* StageProfilerStageName(int stage);
+
+/* If `token` is enabled, writes the stats to its tap-out slice. */
+void StageProfilerCaptureTapOut(TapOutToken token);
+
+#if STAGE_PROFILER_ENABLED
+#define PROFILE_STAGE_BEGIN(stage) \
+  const uint32_t profile_start_##stage = StageProfilerNow()
+#define PROFILE_STAGE_END(stage) \
+  StageProfilerRecord(stage, profile_start_##stage)
+#else
+#define PROFILE_STAGE_BEGIN(stage) ((void)0)
+#define PROFILE_STAGE_END(stage) ((void)0)
+#endif
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+#endif /* AUDIO_TO_TACTILE_SRC_TACTILE_STAGE_PROFILER_H_ */
@@ -19,11 +19,14 @@
 #include <math.h>
 #include <string.h>
 #include "dsp/fast_fun.h"
+#include "tactile/stage_profiler.h"
 
 /* Default gain in [0, 1]. SetGain and SetAllGain ops can override this. */
 static const float kDefaultGain = 0.15f;
 /* Duration of fading in or out. Must be <= 0.02 s, the min play duration. */
 static const float kFadeSeconds = 0.02f;
+/* Max frames rendered at a time per channel by TactilePatternRender(). */
+enum { kRenderChunkFrames = 64 };
 /* Parameters for the Chirp waveform. */
 static const float kChirpSeconds = 0.3f;
 static const float kChirpStartHz = 40.0f;
@@ -320,6 +323,7 @@ void TactilePatternStartEx(TactilePattern* p, const uint8_t* ex_pattern) {
 
 int TactilePatternSynthesize(TactilePattern* p, int num_frames, float* output) {
   const int num_channels = p->num_channels;
+  PROFILE_STAGE_BEGIN(kProfileStagePattern);
 
   int i;
   for (i = 0; i < num_frames; ++i, output += num_channels) {
@@ -338,6 +342,7 @@ int TactilePatternSynthesize(TactilePattern* p, int num_frames, float* output) {
     }
   }
 
+  PROFILE_STAGE_END(kProfileStagePattern);
   return p->playback_state != kTactilePatternStateStopped;
 }
 
@@ -474,3 +479,290 @@ int TactilePatternTranslateSimplePattern(const char* simple_pattern,
   *output = kTactilePatternOpEnd;
   return 1;
 }
+
+/* Advances the fade state of `p` by `num_frames` frames, as synthesizing them
+ * with TactilePatternSynthesize() would.
+ */
+static void AdvanceFade(TactilePattern* p, int num_frames) {
+  if (p->fade_counter == 0) { return; }
+  if (num_frames >= p->fade_counter) {
+    p->fade_counter = 1;
+    UpdateFadingState(p); /* Completes the fade. */
+  } else {
+    p->fade_counter -= num_frames;
+    p->fade.phase += (uint32_t)num_frames * p->fade.frequency;
+  }
+}
+
+int TactilePatternCompileEx(TactilePatternTimeline* timeline,
+                            float sample_rate_hz, int num_channels,
+                            const uint8_t* ex_pattern) {
+  /* Run the interpreter's op state machine on `p`, recording its state at the
+   * start of each segment. `frequency`, `chirp`, `amplitude`, and
+   * `amplitude_fade_delta` track the channel state that the renderer will
+   * have before applying a segment's voices, so that voices are emitted only
+   * for channels whose state changes.
+   */
+  TactilePattern p;
+  TactilePatternInit(&p, sample_rate_hz, num_channels);
+  TactilePatternStartEx(&p, ex_pattern);
+  Phase32 frequency[kTactilePatternMaxChannels] = {0};
+  uint8_t chirp[kTactilePatternMaxChannels] = {0};
+  float amplitude[kTactilePatternMaxChannels] = {0.0f};
+  float amplitude_fade_delta[kTactilePatternMaxChannels] = {0.0f};
+
+  timeline->num_segments = 0;
+  timeline->num_voices = 0;
+  timeline->num_channels = p.num_channels;
+  timeline->fade_frames = p.fade_frames;
+  timeline->fade_frequency = p.fade.frequency;
+  timeline->chirp_rate = p.chirp_rate;
+
+  while (p.playback_state == kTactilePatternStatePlaying) {
+    if (timeline->num_segments >= kTactilePatternMaxSegments) { return 0; }
+    TactilePatternSegment* segment =
+        &timeline->segments[timeline->num_segments++];
+
+    /* ExecuteOps() doesn't read fade_counter, but sets it if a fade starts. */
+    const int prev_fade_counter = p.fade_counter;
+    p.fade_counter = -1;
+    ExecuteOps(&p);
+    segment->fade = (p.fade_counter != -1);
+    if (!segment->fade) { p.fade_counter = prev_fade_counter; }
+    segment->num_frames = p.num_frames_until_next_op;
+    segment->stopping = (p.playback_state == kTactilePatternStateStopping);
+    segment->first_voice = (uint16_t)timeline->num_voices;
+    segment->num_voices = 0;
+
+    int c;
+    for (c = 0; c < p.num_channels; ++c) {
+      const TactilePatternChannel* channel = &p.channels[c];
+      const uint8_t is_chirp =
+          (channel->waveform == kTactilePatternWaveformChirp);
+      if (channel->tone.frequency == frequency[c] && is_chirp == chirp[c] &&
+          channel->amplitude == amplitude[c] &&
+          channel->amplitude_fade_delta == amplitude_fade_delta[c]) {
+        continue; /* Channel state carries over from the previous segment. */
+      }
+
+      if (timeline->num_voices >= kTactilePatternMaxVoices) { return 0; }
+      TactilePatternVoice* voice = &timeline->voices[timeline->num_voices++];
+      voice->frequency = channel->tone.frequency;
+      voice->amplitude = channel->amplitude;
+      voice->amplitude_fade_delta = channel->amplitude_fade_delta;
+      voice->channel = (uint8_t)c;
+      voice->chirp = is_chirp;
+      ++segment->num_voices;
+      frequency[c] = channel->tone.frequency;
+      chirp[c] = is_chirp;
+      amplitude[c] = channel->amplitude;
+      amplitude_fade_delta[c] = channel->amplitude_fade_delta;
+    }
+
+    if (segment->stopping) { break; }
+
+    /* Advance the state to the end of the segment. Completing a fade zeros
+     * the fade deltas, in the renderer as in `p`.
+     */
+    AdvanceFade(&p, segment->num_frames);
+    for (c = 0; c < p.num_channels; ++c) {
+      Oscillator* tone = &p.channels[c].tone;
+      if (chirp[c]) {
+        int i;
+        for (i = 0; i < segment->num_frames; ++i) {
+          tone->frequency *= p.chirp_rate;
+        }
+      }
+      frequency[c] = tone->frequency;
+      amplitude_fade_delta[c] = p.channels[c].amplitude_fade_delta;
+    }
+    p.num_frames_until_next_op = 0;
+  }
+
+  return 1;
+}
+
+int TactilePatternCompile(TactilePatternTimeline* timeline,
+                          float sample_rate_hz, int num_channels,
+                          const char* simple_pattern) {
+  uint8_t buffer[kTactilePatternBufferSize];
+  if (!TactilePatternTranslateSimplePattern(simple_pattern, buffer,
+                                            kTactilePatternBufferSize)) {
+    TactilePatternCompileEx(timeline, sample_rate_hz, num_channels, NULL);
+    return 0;
+  }
+  return TactilePatternCompileEx(timeline, sample_rate_hz, num_channels,
+                                 buffer);
+}
+
+void TactilePatternRendererStart(TactilePatternRenderer* r,
+                                 const TactilePatternTimeline* timeline) {
+  r->timeline = timeline;
+  r->segment = -1;
+  r->num_frames_until_next_segment = 0;
+  r->playback_state = (timeline->num_segments > 0)
+      ? kTactilePatternStatePlaying : kTactilePatternStateStopped;
+  r->fade.phase = 0;
+  r->fade.frequency = timeline->fade_frequency;
+  r->fade_counter = 0;
+
+  int c;
+  for (c = 0; c < timeline->num_channels; ++c) {
+    r->tones[c].phase = 0;
+    r->tones[c].frequency = 0;
+    r->chirp[c] = 0;
+    r->amplitude[c] = 0.0f;
+    r->amplitude_fade_delta[c] = 0.0f;
+  }
+}
+
+/* Begins the next segment of the timeline. */
+static void BeginSegment(TactilePatternRenderer* r) {
+  const TactilePatternTimeline* timeline = r->timeline;
+  if (r->segment + 1 >= timeline->num_segments) {
+    /* Already in the final segment, as after the End op. */
+    r->num_frames_until_next_segment = INT_MAX;
+    return;
+  }
+  const TactilePatternSegment* segment = &timeline->segments[++r->segment];
+
+  /* Channels without a voice keep their state from the previous segment. */
+  const TactilePatternVoice* voice = &timeline->voices[segment->first_voice];
+  int i;
+  for (i = 0; i < segment->num_voices; ++i, ++voice) {
+    const int c = voice->channel;
+    r->tones[c].frequency = voice->frequency;
+    r->chirp[c] = voice->chirp;
+    r->amplitude[c] = voice->amplitude;
+    r->amplitude_fade_delta[c] = voice->amplitude_fade_delta;
+  }
+
+  if (segment->fade) {
+    r->fade.phase = 0;
+    r->fade_counter = timeline->fade_frames;
+  }
+  if (segment->stopping) {
+    r->playback_state = kTactilePatternStateStopping;
+  }
+  r->num_frames_until_next_segment = segment->num_frames;
+}
+
+/* Updates the fade state for the next `num_frames` frames, writing the Hann
+ * window fade weights to `fade_weights`. Returns the number of leading frames
+ * that are weighted, after which the fade is complete.
+ */
+static int ComputeFadeWeights(TactilePatternRenderer* r, int num_frames,
+                              float* fade_weights) {
+  int i;
+  for (i = 0; i < num_frames && r->fade_counter; ++i) {
+    if (--r->fade_counter == 0) { break; } /* Fading just completed. */
+    OscillatorNext(&r->fade);
+    fade_weights[i] = 0.5f * (1.0f + Phase32Cos(r->fade.phase));
+  }
+  return i;
+}
+
+/* Renders `num_frames` frames of channel `c` to `output` with stride
+ * `num_channels`.
+ */
+static void RenderChannel(TactilePatternRenderer* r, int c, int num_frames,
+                          int fade_frames, const float* fade_weights,
+                          float* output) {
+  const int stride = r->timeline->num_channels;
+  const float chirp_rate = r->timeline->chirp_rate;
+  Oscillator* tone = &r->tones[c];
+  const float amplitude = r->amplitude[c];
+  const float amplitude_fade_delta = r->amplitude_fade_delta[c];
+  int i;
+
+  if (amplitude == 0.0f && (fade_frames == 0 || amplitude_fade_delta == 0.0f)) {
+    /* Channel is silent. Only the oscillator needs to advance. */
+    for (i = 0; i < num_frames; ++i) { output[i * stride] = 0.0f; }
+    if (r->chirp[c]) {
+      for (i = 0; i < num_frames; ++i) {
+        tone->phase += tone->frequency;
+        tone->frequency *= chirp_rate;
+      }
+    } else {
+      tone->phase += (uint32_t)num_frames * tone->frequency;
+    }
+    return;
+  }
+
+  if (r->chirp[c]) {
+    for (i = 0; i < num_frames; ++i) {
+      tone->phase += tone->frequency;
+      float value = Phase32Sin(tone->phase);
+      tone->frequency *= chirp_rate;
+      if (i < fade_frames) {
+        value *= amplitude + amplitude_fade_delta * fade_weights[i];
+      } else {
+        value *= amplitude;
+      }
+      output[i * stride] = value;
+    }
+    return;
+  }
+
+  /* Compute phases in closed form, so that iterations are independent. */
+  const Phase32 phase = tone->phase;
+  const Phase32 frequency = tone->frequency;
+  for (i = 0; i < fade_frames; ++i) {
+    output[i * stride] = Phase32Sin(phase + (uint32_t)(i + 1) * frequency)
+        * (amplitude + amplitude_fade_delta * fade_weights[i]);
+  }
+  for (; i < num_frames; ++i) {
+    output[i * stride] =
+        Phase32Sin(phase + (uint32_t)(i + 1) * frequency) * amplitude;
+  }
+  tone->phase = phase + (uint32_t)num_frames * frequency;
+}
+
+int TactilePatternRender(TactilePatternRenderer* r, int num_frames,
+                         float* output) {
+  const int num_channels = r->timeline->num_channels;
+  PROFILE_STAGE_BEGIN(kProfileStagePattern);
+
+  while (num_frames > 0) {
+    if (r->playback_state == kTactilePatternStateStopped) {
+      memset(output, 0, num_frames * num_channels * sizeof(float));
+      break;
+    }
+    if (r->num_frames_until_next_segment <= 0) {
+      BeginSegment(r);
+    }
+
+    int chunk_frames = num_frames;
+    if (chunk_frames > r->num_frames_until_next_segment) {
+      chunk_frames = r->num_frames_until_next_segment;
+    }
+    if (chunk_frames > kRenderChunkFrames) {
+      chunk_frames = kRenderChunkFrames;
+    }
+    r->num_frames_until_next_segment -= chunk_frames;
+
+    /* The fade weights are the same for all channels. */
+    float fade_weights[kRenderChunkFrames];
+    const int was_fading = (r->fade_counter != 0);
+    const int fade_frames =
+        was_fading ? ComputeFadeWeights(r, chunk_frames, fade_weights) : 0;
+
+    int c;
+    for (c = 0; c < num_channels; ++c) {
+      RenderChannel(r, c, chunk_frames, fade_frames, fade_weights, output + c);
+    }
+
+    if (was_fading && r->fade_counter == 0) { /* Fading completed. */
+      memset(r->amplitude_fade_delta, 0, num_channels * sizeof(float));
+      if (r->playback_state == kTactilePatternStateStopping) {
+        r->playback_state = kTactilePatternStateStopped;
+      }
+    }
+
+    output += chunk_frames * num_channels;
+    num_frames -= chunk_frames;
+  }
+
+  PROFILE_STAGE_END(kProfileStagePattern);
+  return r->playback_state != kTactilePatternStateStopped;
+}
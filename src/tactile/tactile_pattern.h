@@ -59,6 +59,23 @@
  *   while (TactilePatternSynthesize(&p, kNumFrames, samples)) {
  *     // ...
  *   }
+ *
+ * Alternatively, a pattern may be compiled to a timeline of segments and played
+ * with a renderer. This produces the same output as TactilePatternSynthesize(),
+ * but at lower cost: the ops are interpreted once at compile time, and the
+ * renderer synthesizes each channel a segment at a time, skipping silent
+ * channels. The timeline may be rendered any number of times.
+ *
+ *   static TactilePatternTimeline timeline;  // About 18 KB.
+ *   TactilePatternCompileEx(&timeline, kSampleRateHz, kNumChannels,
+ *                           ex_pattern);
+ *   TactilePatternRenderer renderer;
+ *   TactilePatternRendererStart(&renderer, &timeline);
+ *
+ *   float samples[kNumFrames * kNumChannels];
+ *   while (TactilePatternRender(&renderer, kNumFrames, samples)) {
+ *     // ...
+ *   }
  */
 
 #ifndef AUDIO_TO_TACTILE_SRC_TACTILE_TACTILE_PATTERN_H_
@@ -82,6 +99,18 @@ extern "C" {
 
 enum { kTactilePatternMaxChannels = 16, kTactilePatternBufferSize = 129 };
 
+/* Capacity of a TactilePatternTimeline, enough for any pattern that fits in
+ * kTactilePatternBufferSize bytes. Such a pattern has at most 129 segments.
+ * A voice is emitted only when a channel's state changes, which takes an op
+ * setting the channel or the implicit silencing after the next Play. So each
+ * op byte accounts for at most 8 voices (e.g. SetAllWaveform, 2 bytes, sets
+ * 16 channels that the next Play silences).
+ */
+enum {
+  kTactilePatternMaxSegments = 130,
+  kTactilePatternMaxVoices = 8 * kTactilePatternBufferSize,
+};
+
 /* Opcodes. */
 enum {
   /* "End" op.
@@ -217,6 +246,64 @@ typedef struct {
   int fade_counter;
 } TactilePattern;
 
+/* State of one channel during a timeline segment. */
+typedef struct {
+  /* Oscillator frequency at the start of the segment. */
+  Phase32 frequency;
+  /* Amplitude and fade delta, as in TactilePatternChannel. */
+  float amplitude;
+  float amplitude_fade_delta;
+  uint8_t channel;
+  /* Nonzero if the channel plays a chirp. */
+  uint8_t chirp;
+} TactilePatternVoice;
+
+/* Segment of a timeline, the interval between two Play ops. */
+typedef struct {
+  /* Duration in frames, or INT_MAX for the final segment. */
+  int num_frames;
+  /* Voices for channels whose state changes at the start of this segment.
+   * Other channels keep their state from the previous segment.
+   */
+  uint16_t first_voice;
+  uint8_t num_voices;
+  /* Nonzero if a fade begins at the start of the segment. */
+  uint8_t fade;
+  /* Nonzero for the final segment, after the End op. */
+  uint8_t stopping;
+} TactilePatternSegment;
+
+/* Pattern compiled to a flat timeline of segments. */
+typedef struct {
+  TactilePatternSegment segments[kTactilePatternMaxSegments];
+  TactilePatternVoice voices[kTactilePatternMaxVoices];
+  int num_segments;
+  int num_voices;
+  int num_channels;
+  /* Fade and chirp parameters, as in TactilePattern. */
+  int fade_frames;
+  Phase32 fade_frequency;
+  float chirp_rate;
+} TactilePatternTimeline;
+
+/* Renderer for playing a TactilePatternTimeline. */
+typedef struct {
+  const TactilePatternTimeline* timeline;
+  /* Oscillator and waveform state for each channel. */
+  Oscillator tones[kTactilePatternMaxChannels];
+  uint8_t chirp[kTactilePatternMaxChannels];
+  float amplitude[kTactilePatternMaxChannels];
+  float amplitude_fade_delta[kTactilePatternMaxChannels];
+
+  /* Index of the current segment and frames left in it. */
+  int segment;
+  int num_frames_until_next_segment;
+  int playback_state;
+
+  Oscillator fade;
+  int fade_counter;
+} TactilePatternRenderer;
+
 extern const char* kTactilePatternConnect;
 extern const char* kTactilePatternDisconnect;
 extern const char* kTactilePatternConfirm;
@@ -282,6 +369,39 @@ static int /*bool*/ TactilePatternIsActive(const TactilePattern* p) {
   return p->playback_state != kTactilePatternStateStopped;
 }
 
+/* Compiles an extended format pattern to `timeline`, for playing with
+ * `num_channels` channels at `sample_rate_hz`. Returns 1 on success, or 0 if
+ * the timeline capacity is exceeded, which can't happen for patterns that fit
+ * in kTactilePatternBufferSize bytes.
+ */
+int /*bool*/ TactilePatternCompileEx(TactilePatternTimeline* timeline,
+                                     float sample_rate_hz, int num_channels,
+                                     const uint8_t* ex_pattern);
+
+/* Compiles a simple pattern, as in TactilePatternStart(), to `timeline`.
+ * Returns 1 on success, 0 on failure.
+ */
+int /*bool*/ TactilePatternCompile(TactilePatternTimeline* timeline,
+                                   float sample_rate_hz, int num_channels,
+                                   const char* simple_pattern);
+
+/* Starts rendering `timeline`. The timeline must outlive the rendering. */
+void TactilePatternRendererStart(TactilePatternRenderer* r,
+                                 const TactilePatternTimeline* timeline);
+
+/* Renders `num_frames` frames of the timeline, with the same output and return
+ * value as TactilePatternSynthesize().
+ */
+int /*bool*/ TactilePatternRender(TactilePatternRenderer* r,
+                                  int num_frames,
+                                  float* output);
+
+/* Returns 1 if the renderer is still playing, or 0 if completed. */
+static int /*bool*/ TactilePatternRendererIsActive(
+    const TactilePatternRenderer* r) {
+  return r->playback_state != kTactilePatternStateStopped;
+}
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
@@ -21,6 +21,7 @@
 
 #include "dsp/decibels.h"
 #include "phonetics/hexagon_interpolation.h"
+#include "tactile/stage_profiler.h"
 
 const int kTactileProcessorNumTactors = 10;
 
@@ -29,6 +30,7 @@ void TactileProcessorSetDefaultParams(TactileProcessorParams* params) {
     params->enveloper_params = kDefaultEnveloperParams;
     params->decimation_factor = 1;
     params->frontend_params = kCarlFrontendDefaultParams;
+    params->vowel_hop = 1;
   }
 }
 
@@ -49,10 +51,12 @@ TactileProcessor* TactileProcessorMake(TactileProcessorParams* params) {
   processor->frontend = NULL;
   processor->workspace = NULL;
   processor->frame = NULL;
-  int i;
-  for (i = 0; i < 7; ++i) {
-    processor->vowel_hex_weights[i] = 0.0f;
+
+  if (!(params->vowel_hop >= 1)) {
+    fprintf(stderr, "Error: vowel_hop must be positive.\n");
+    goto fail;
   }
+  processor->vowel_hop = params->vowel_hop;
 
   const int sample_rate_hz = params->frontend_params.input_sample_rate_hz;
   processor->decimation_factor = params->decimation_factor;
@@ -87,6 +91,7 @@ TactileProcessor* TactileProcessorMake(TactileProcessorParams* params) {
     goto fail;
   }
 
+  TactileProcessorReset(processor);
   return processor;
 
 fail:
@@ -109,7 +114,10 @@ void TactileProcessorReset(TactileProcessor* processor) {
   int i;
   for (i = 0; i < 7; ++i) {
     processor->vowel_hex_weights[i] = 0.0f;
+    processor->next_vowel_hex_weights[i] = 0.0f;
+    processor->vowel_hex_weights_step[i] = 0.0f;
   }
+  processor->vowel_hop_counter = 0;
 }
 
 void TactileProcessorProcessSamples(TactileProcessor* processor,
@@ -120,12 +128,40 @@ void TactileProcessorProcessSamples(TactileProcessor* processor,
   /* Run the CARL frontend. */
   float* workspace = processor->workspace;
   memcpy(workspace, input, sizeof(float) * block_size);
+  PROFILE_STAGE_BEGIN(kProfileStageCarlFrontend);
   CarlFrontendProcessSamples(processor->frontend, workspace, processor->frame);
-  /* Get 2-D vowel space coordinate. */
-  EmbedVowel(processor->frame, processor->vowel_coord);
+  PROFILE_STAGE_END(kProfileStageCarlFrontend);
+
+  float* vowel_hex_weights = processor->vowel_hex_weights;
+  float* next_vowel_hex_weights = processor->next_vowel_hex_weights;
+  float* weights_step = processor->vowel_hex_weights_step;
+  int c;
+  if (processor->vowel_hop_counter == 0) {
+    /* Get 2-D vowel space coordinate. */
+    PROFILE_STAGE_BEGIN(kProfileStageEmbedVowel);
+    EmbedVowel(processor->frame, processor->vowel_coord);
+    PROFILE_STAGE_END(kProfileStageEmbedVowel);
+    /* Get the next hexagonal interpolation weights based on `vowel_coord`. The
+     * fine-time signal is modulated by the hex weights.
+     */
+    GetHexagonInterpolationWeights(processor->vowel_coord[0],
+                                   processor->vowel_coord[1],
+                                   next_vowel_hex_weights);
+    /* We will blend linearly from `vowel_hex_weights` to
+     * `next_vowel_hex_weights` over the next `vowel_hop` blocks.
+     */
+    const float hop_scale = 1.0f / processor->vowel_hop;
+    for (c = 0; c < 7; ++c) {
+      weights_step[c] =
+          (next_vowel_hex_weights[c] - vowel_hex_weights[c]) * hop_scale;
+    }
+    processor->vowel_hop_counter = processor->vowel_hop;
+  }
 
   /* Compute energy envelopes, writing into `workspace`. */
+  PROFILE_STAGE_BEGIN(kProfileStageEnveloper);
   EnveloperProcessSamples(&processor->enveloper, input, block_size, workspace);
+  PROFILE_STAGE_END(kProfileStageEnveloper);
 
   const float* src = workspace;
   float* dest = output;
@@ -138,23 +174,6 @@ void TactileProcessorProcessSamples(TactileProcessor* processor,
     dest += kTactileProcessorNumTactors;
   }
 
-  float* vowel_hex_weights = processor->vowel_hex_weights;
-  float next_vowel_hex_weights[7];
-  /* Get the next hexagonal interpolation weights based on `vowel_coord`. The
-   * fine-time signal is modulated by the hex weights.
-   */
-  GetHexagonInterpolationWeights(processor->vowel_coord[0],
-                                 processor->vowel_coord[1],
-                                 next_vowel_hex_weights);
-  /* We will blend linearly from `vowel_hex_weights` to `next_vowel_hex_weights`
-   * over the block.
-   */
-  float weights_diff[7];
-  int c;
-  for (c = 0; c < 7; ++c) {
-    weights_diff[c] = next_vowel_hex_weights[c] - vowel_hex_weights[c];
-  }
-
   /* Map to the vowel hex cluster. */
   const float blend_step = 1.0f / decimated_block_size;
   float blend = 0.0f;
@@ -163,16 +182,21 @@ void TactileProcessorProcessSamples(TactileProcessor* processor,
   for (i = 0; i < decimated_block_size; ++i) {
     blend += blend_step;
     const float sample = *src; /* Get the next fine-time sample. */
-    int c;
     for (c = 0; c < 7; ++c) {  /* Fill the vowel channels. */
-      dest[c] = (vowel_hex_weights[c] + blend * weights_diff[c]) * sample;
+      dest[c] = (vowel_hex_weights[c] + blend * weights_step[c]) * sample;
     }
     src += kEnveloperNumChannels;
     dest += kTactileProcessorNumTactors;
   }
 
-  memcpy(vowel_hex_weights, next_vowel_hex_weights,
-         sizeof(next_vowel_hex_weights));
+  if (--processor->vowel_hop_counter == 0) {
+    /* End of the span. Snap to the target to avoid accumulating round off. */
+    memcpy(vowel_hex_weights, next_vowel_hex_weights, sizeof(float) * 7);
+  } else {
+    for (c = 0; c < 7; ++c) {
+      vowel_hex_weights[c] += weights_step[c];
+    }
+  }
 }
 
 void TactileProcessorApplyTuning(TactileProcessor* processor,
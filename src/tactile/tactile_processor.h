@@ -70,6 +70,12 @@ typedef struct {
    * rate and `frontend_params.block_size` to the desired block size.
    */
   CarlFrontendParams frontend_params;
+  /* Number of CarlFrontend blocks between vowel embedding updates. With
+   * vowel_hop > 1, EmbedVowel runs once every `vowel_hop` blocks and the hex
+   * cluster weights are interpolated linearly across the longer span. This
+   * trades vowel-update rate for CPU independently of `block_size`.
+   */
+  int vowel_hop;
 } TactileProcessorParams;
 
 /* Set `params` to default values. */
@@ -93,6 +99,14 @@ typedef struct {
   float vowel_coord[2];
   /* Interpolation weights for the hexagonal vowel cluster. */
   float vowel_hex_weights[7];
+  /* Hex weights at the end of the current interpolation span. */
+  float next_vowel_hex_weights[7];
+  /* Per-block increment from `vowel_hex_weights` toward the next weights. */
+  float vowel_hex_weights_step[7];
+  /* Number of blocks between vowel embedding updates. */
+  int vowel_hop;
+  /* Blocks remaining in the current interpolation span. */
+  int vowel_hop_counter;
 } TactileProcessor;
 
 /* Makes a `TactileProcessor`. The caller should free it when done with
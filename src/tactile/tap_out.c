@@ -64,7 +64,19 @@ static TapOutSlice g_slices[kTapOutMaxOutputs];
 static int g_num_outputs = 0;
 static int g_heartbeat_countdown = 0;
 
+/* Sequenced capture state. */
+static int /*bool*/ g_sequenced = 0;
+static int g_compression_flags = 0;
+static uint16_t g_sequence = 0;
+static uint16_t g_num_dropped = 0;
+/* Ring of queued messages, in order starting from index `g_ring_start`. */
+static uint8_t g_ring[kTapOutRingSize][kTapOutBufferCapacity];
+static int g_ring_sizes[kTapOutRingSize];
+static int g_ring_start = 0;
+static int g_ring_count = 0;
+
 static void (*g_tx_fun)(const char*, int) = NULL;
+static int (*g_tx_available_fun)(void) = NULL;
 static void (*g_error_fun)(const char*) = NULL;
 
 /* Prints a formatted error message with g_error_fun, if set. */
@@ -106,10 +118,10 @@ static DType DTypeParse(const char* dtype) {
   return kDTypeInvalid;
 }
 
-/* Gets the number of bytes per item for `dtype`. */
-static int DTypeItemSize(DType dtype) {
+int TapOutDTypeItemSize(int dtype_code) {
   static const int kNumBytes[] = {0, 1, 1, 2, 2, 4, 4, 8, 8, 4, 8, 1};
-  return kNumBytes[dtype];
+  return (0 <= dtype_code && dtype_code <= kDTypeText) ? kNumBytes[dtype_code]
+                                                       : 0;
 }
 
 /* Computes the number of bytes from dtype and shape. */
@@ -118,7 +130,7 @@ static int ComputeNumBytes(const TapOutDescriptor* descriptor) {
     Error("%s: Invalid num_dims: %d", descriptor->name, descriptor->num_dims);
     return 0;
   }
-  int num_bytes = DTypeItemSize(DTypeParse(descriptor->dtype));
+  int num_bytes = TapOutDTypeItemSize(DTypeParse(descriptor->dtype));
   if (num_bytes <= 0) {
     Error("%s: Invalid dtype: \"%s\"", descriptor->name, descriptor->dtype);
     return 0;
@@ -148,6 +160,10 @@ void TapOutSetTxFun(void (*fun)(const char*, int)) {
   g_tx_fun = fun;
 }
 
+void TapOutSetTxAvailableFun(int (*fun)(void)) {
+  g_tx_available_fun = fun;
+}
+
 void TapOutSetErrorFun(void (*fun)(const char*)) {
   g_error_fun = fun;
 }
@@ -218,9 +234,17 @@ void TapOutClearDescriptors(void) {
   g_num_descriptors = 0;
 }
 
-int TapOutEnable(const TapOutToken* outputs, int num_outputs) {
+/* Sets up capture of `outputs` into g_tap_out_buffer as message `op`. Output
+ * data begins after `header_size` bytes, and each output whose bit is set in
+ * `compression_flags` is preceded by an encoding byte.
+ */
+static int /*bool*/ EnableOutputs(const TapOutToken* outputs, int num_outputs,
+                                  int op, int header_size,
+                                  int compression_flags) {
   g_tap_out_buffer_size = 0;
   g_num_outputs = 0;
+  g_sequenced = 0;
+  g_ring_count = 0;
   if (outputs == NULL || num_outputs <= 0) {
     return 1;
   }
@@ -230,15 +254,16 @@ int TapOutEnable(const TapOutToken* outputs, int num_outputs) {
     return 0;
   }
 
-  int offset = 3;
+  int offset = header_size;
   g_tap_out_buffer[0] = kTapOutMarker;
-  g_tap_out_buffer[1] = kTapOutMessageCapture;
+  g_tap_out_buffer[1] = (uint8_t)op;
 
   int i;
   for (i = 0; i < num_outputs; ++i) {
     if (!(1 <= outputs[i] && outputs[i] <= g_num_descriptors)) { return 0; }
     const int num_bytes = ComputeNumBytes(g_descriptors[outputs[i] - 1]);
     if (num_bytes <= 0) { return 0; }
+    if (compression_flags & (1 << i)) { ++offset; } /* Encoding byte. */
 
     g_outputs[i] = outputs[i];
     g_slices[i].data = g_tap_out_buffer + offset;
@@ -257,6 +282,33 @@ int TapOutEnable(const TapOutToken* outputs, int num_outputs) {
   return 1;
 }
 
+int TapOutEnable(const TapOutToken* outputs, int num_outputs) {
+  return EnableOutputs(outputs, num_outputs, kTapOutMessageCapture, 3, 0);
+}
+
+int TapOutEnableSequenced(const TapOutToken* outputs, int num_outputs,
+                          int compression_flags) {
+  compression_flags &= (1 << kTapOutMaxOutputs) - 1;
+  if (!EnableOutputs(outputs, num_outputs, kTapOutMessageSequencedCapture,
+                     3 + kTapOutSequencedHeaderSize, compression_flags)) {
+    return 0;
+  }
+  g_sequenced = (g_num_outputs > 0);
+  g_compression_flags = compression_flags;
+  g_sequence = 0;
+  g_num_dropped = 0;
+  g_ring_start = 0;
+  return 1;
+}
+
+TapOutRingStats TapOutGetRingStats(void) {
+  TapOutRingStats stats;
+  stats.sequence = g_sequence;
+  stats.num_queued = g_ring_count;
+  stats.num_dropped = g_num_dropped;
+  return stats;
+}
+
 int TapOutIsActive(void) {
   return g_heartbeat_countdown > 0;
 }
@@ -287,6 +339,104 @@ static void SendBuffer(void) {
   }
 }
 
+/* Reads a little endian unsigned integer of `item_size` bytes. */
+static uint32_t ReadItem(const uint8_t* src, int item_size) {
+  switch (item_size) {
+    case 1: return src[0];
+    case 2: return LittleEndianReadU16(src);
+    default: return LittleEndianReadU32(src);
+  }
+}
+
+/* Delta codes an array of `num_items` integers of `item_size` bytes (1, 2, or
+ * 4) as described in tap_out.h. Returns the number of bytes written, or 0 if
+ * more than `max_bytes` would be needed.
+ */
+static int DeltaEncode(const uint8_t* src, int item_size, int num_items,
+                       uint8_t* dest, int max_bytes) {
+  const uint32_t mask =
+      (item_size == 4) ? 0xffffffffUL : ((uint32_t)1 << (8 * item_size)) - 1;
+  const uint32_t sign_bit = (mask >> 1) + 1;
+  uint32_t prev = 0;
+  int size = 0;
+  int i;
+  for (i = 0; i < num_items; ++i, src += item_size) {
+    const uint32_t value = ReadItem(src, item_size);
+    uint32_t delta = (value - prev) & mask;
+    prev = value;
+    if (delta & sign_bit) { delta |= ~mask; } /* Sign extend to 32 bits. */
+    uint32_t code = (delta << 1) ^ (0 - (delta >> 31)); /* Zigzag map. */
+
+    do { /* Write base-128 varint. */
+      if (size >= max_bytes) { return 0; }
+      const uint8_t low_bits = (uint8_t)(code & 0x7f);
+      code >>= 7;
+      dest[size++] = low_bits | (code ? 0x80 : 0);
+    } while (code);
+  }
+  return size;
+}
+
+/* Encodes the current g_tap_out_buffer into the ring as a sequenced capture
+ * message, or counts it as dropped if the ring is full.
+ */
+static void QueueBuffer(void) {
+  const uint16_t sequence = g_sequence++;
+  if (g_ring_count >= kTapOutRingSize) {
+    ++g_num_dropped;
+    return;
+  }
+
+  const int slot = (g_ring_start + g_ring_count) % kTapOutRingSize;
+  uint8_t* message = g_ring[slot];
+  memcpy(message, g_tap_out_buffer, 3);
+  LittleEndianWriteU16(sequence, message + 3);
+  LittleEndianWriteU16(g_num_dropped, message + 5);
+  uint8_t* dest = message + 3 + kTapOutSequencedHeaderSize;
+
+  int i;
+  for (i = 0; i < g_num_outputs; ++i) {
+    const TapOutSlice* slice = &g_slices[i];
+    if (g_compression_flags & (1 << i)) {
+      const DType dtype = DTypeParse(g_descriptors[g_outputs[i] - 1]->dtype);
+      const int item_size = TapOutDTypeItemSize(dtype);
+      int coded_size = 0;
+      if (kDTypeUint8 <= dtype && dtype <= kDTypeInt32) {
+        coded_size = DeltaEncode(slice->data, item_size,
+                                 slice->size / item_size, dest + 1,
+                                 slice->size - 1);
+      }
+      if (coded_size > 0) {
+        *dest++ = kTapOutEncodingDelta;
+        dest += coded_size;
+        continue;
+      }
+      *dest++ = kTapOutEncodingRaw;
+    }
+    memcpy(dest, slice->data, slice->size);
+    dest += slice->size;
+  }
+
+  const int size = (int)(dest - message);
+  message[2] = (uint8_t)(size - 3);  /* Set payload size. */
+  g_ring_sizes[slot] = size;
+  ++g_ring_count;
+}
+
+void TapOutFlush(void) {
+  while (g_ring_count > 0) {
+    const int size = g_ring_sizes[g_ring_start];
+    if (g_tx_available_fun && g_tx_available_fun() < size) {
+      break; /* Transmitter is busy, try again later. */
+    }
+    if (g_tx_fun) {
+      g_tx_fun((const char*)g_ring[g_ring_start], size);
+    }
+    g_ring_start = (g_ring_start + 1) % kTapOutRingSize;
+    --g_ring_count;
+  }
+}
+
 /* Handles a received message. */
 static void HandleMessage(int op, const uint8_t* payload, int payload_size) {
   g_heartbeat_countdown = kMaxBuffersPerHeartbeat; /* Reset the countdown. */
@@ -307,6 +457,12 @@ static void HandleMessage(int op, const uint8_t* payload, int payload_size) {
       }
       break;
 
+    case kTapOutMessageStartSequencedCapture:
+      if (2 <= payload_size && payload_size <= 1 + kTapOutMaxOutputs) {
+        TapOutEnableSequenced(payload + 1, payload_size - 1, payload[0]);
+      }
+      break;
+
     default:
       Error("Unknown op: 0x%02x", op);
   }
@@ -336,6 +492,9 @@ void TapOutFinishedCaptureBuffer(void) {
   --g_heartbeat_countdown;
   if (g_heartbeat_countdown == 0) {
     TapOutEnable(NULL, 0); /* Deactivate tap_out. */
+  } else if (g_sequenced) {
+    QueueBuffer();
+    TapOutFlush();
   } else if (g_num_outputs > 0) {
     SendBuffer();
   }
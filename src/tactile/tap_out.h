@@ -75,6 +75,44 @@
  *  [2] <payload size> - The size of the payload.
  *
  * Followed by the payload data.
+ *
+ * == Sequenced capture ==
+ *
+ * With "Start Capture", each buffer is sent immediately from
+ * `TapOutFinishedCaptureBuffer()`, and is silently lost if the transmitter
+ * can't take it. For continuous high-rate capture, the receiver may instead
+ * send "Start Sequenced Capture". Then finished buffers are queued in a ring of
+ * kTapOutRingSize buffers and sent as the transmitter has room:
+ *
+ *  - Use `TapOutSetTxAvailableFun()` to set a callback returning how many
+ *    bytes the transmitter can accept without blocking, for instance
+ *    `Serial.availableForWrite()`. Buffers are only sent if they fit.
+ *
+ *  - Call `TapOutFlush()` periodically, e.g. in the main loop, to send queued
+ *    buffers. `TapOutFinishedCaptureBuffer()` also flushes.
+ *
+ *  - Each "Sequenced Capture" message has a sequence number, incremented for
+ *    every finished buffer, and the total number of buffers dropped because
+ *    the ring was full. The receiver detects gaps from the sequence numbers.
+ *
+ *  - Integer-valued outputs may optionally be delta compressed. Each element
+ *    is coded as the difference from the previous element, zigzag mapped to
+ *    unsigned, and written as a little endian base-128 varint. If this is not
+ *    smaller than the raw data, raw data is sent instead.
+ *
+ * The "Start Sequenced Capture" payload is
+ *
+ *  [0] <compression flags> - Bit i set requests compression of output i.
+ *  [1...] <tokens> - Tokens of the outputs to capture, as for Start Capture.
+ *
+ * The "Sequenced Capture" payload is
+ *
+ *  [0-1] <sequence number> - uint16, little endian.
+ *  [2-3] <dropped count> - uint16, little endian, total buffers dropped.
+ *
+ * Followed by the data for each output in order. For outputs with compression
+ * requested, the data is preceded by a byte indicating the encoding,
+ * kTapOutEncodingRaw or kTapOutEncodingDelta.
  */
 
 #ifndef AUDIO_TO_TACTILE_SRC_TACTILE_TAP_OUT_H_
@@ -95,6 +133,10 @@ enum {
   kTapOutMaxOutputs = 4,
   /* Marker byte to help detect and skip across extra bytes. */
   kTapOutMarker = 0xfe,
+  /* Number of buffers in the ring for sequenced capture. */
+  kTapOutRingSize = 4,
+  /* Size of the sequence number and dropped count in a sequenced capture. */
+  kTapOutSequencedHeaderSize = 4,
 };
 
 /* Message ops for communication. */
@@ -109,6 +151,20 @@ enum {
   kTapOutMessageStartCapture = 0x04,
   /* Message containing captured tap out output. */
   kTapOutMessageCapture = 0x05,
+  /* Request to begin sequenced capture. Payload specifies compression flags
+   * and which outputs.
+   */
+  kTapOutMessageStartSequencedCapture = 0x06,
+  /* Message containing sequenced captured tap out output. */
+  kTapOutMessageSequencedCapture = 0x07,
+};
+
+/* Encodings of a compressed output in a sequenced capture. */
+enum {
+  /* Raw data, as in an uncompressed output. */
+  kTapOutEncodingRaw = 0,
+  /* Zigzag varint-coded deltas between successive elements. */
+  kTapOutEncodingDelta = 1,
 };
 
 /* Descriptor metadata for one tap-out output. */
@@ -153,6 +209,12 @@ extern int g_tap_out_buffer_size;
 /* Sets callback for transmitting serial data. */
 void TapOutSetTxFun(void (*fun)(const char*, int));
 
+/* Sets callback that returns the number of bytes that may be transmitted
+ * without blocking. This is used in sequenced capture to only send buffers
+ * that fit. If not set, the transmitter is assumed to always have room.
+ */
+void TapOutSetTxAvailableFun(int (*fun)(void));
+
 /* Sets an error callback for printing error messages. */
 void TapOutSetErrorFun(void (*fun)(const char*));
 
@@ -171,6 +233,11 @@ TapOutToken TapOutAddDescriptor(const TapOutDescriptor* descriptor);
  */
 int /*bool*/ TapOutWriteDescriptors(void);
 
+/* Gets the number of bytes per item for a dtype code, as written in the
+ * descriptors by `TapOutWriteDescriptors()`. Returns 0 for an invalid code.
+ */
+int TapOutDTypeItemSize(int dtype_code);
+
 /* Clears all descriptors. */
 void TapOutClearDescriptors(void);
 
@@ -185,6 +252,11 @@ void TapOutReceiveMessage(const char* data, int size);
 /* Indicates that a buffer has just finished. */
 void TapOutFinishedCaptureBuffer(void);
 
+/* In sequenced capture, sends queued buffers while the transmitter has room.
+ * Otherwise, does nothing.
+ */
+void TapOutFlush(void);
+
 /* Enables `outputs` for capture. For each output, the function prepares a
  * TapOutSlice of g_tap_out_buffer to write data for that output. Returns 1 on
  * success, or 0 on failure (e.g. if buffer capacity is exceeded).
@@ -193,6 +265,27 @@ void TapOutFinishedCaptureBuffer(void);
  */
 int /*bool*/ TapOutEnable(const TapOutToken* outputs, int num_outputs);
 
+/* Enables `outputs` for sequenced capture. Bit i of `compression_flags`
+ * requests delta compression of the ith output, which applies only to outputs
+ * with 8-, 16-, or 32-bit integer dtypes. Slices are prepared as with
+ * `TapOutEnable()`. Returns 1 on success, or 0 on failure.
+ */
+int /*bool*/ TapOutEnableSequenced(const TapOutToken* outputs, int num_outputs,
+                                   int compression_flags);
+
+/* Statistics of sequenced capture. */
+typedef struct {
+  /* Sequence number of the next finished buffer. */
+  uint16_t sequence;
+  /* Number of buffers queued in the ring, not yet sent. */
+  int num_queued;
+  /* Total number of buffers dropped because the ring was full. */
+  uint16_t num_dropped;
+} TapOutRingStats;
+
+/* Gets sequenced capture statistics. */
+TapOutRingStats TapOutGetRingStats(void);
+
 
 /* Gets the buffer slice associated with `output`, if it is enabled, or returns
  * NULL if that output is disabled.